@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdint.h>
+
+// Staged boot: readiness flags, stage dependencies and a per-stage profile.
+//
+// setup() brings up only what metering needs (LED PWM, then I2S) and hands the slow subsystems
+// to short-lived tasks: SD (mount, first-boot benchmark, db ring, storage manager), RTC (probe
+// and the up-to-1.1 s discipline wait) and the Wi-Fi radio with the setup AP. Stages that must
+// run on the loop task (the STA connect, HTTP server, NTP, the MP3 module's power-up wait) are
+// advanced by the loop once their dependencies are ready. Anything that touches a subsystem
+// checks ready() first, so it can never see one half initialised.
+//
+// finish() publishes a stage with one atomic OR after its state is written; ready() and
+// depsReady() pair with it, so readers on other tasks see the state the stage left. A stage
+// that failed (no card, no RTC) is still ready: ok says whether it works. Times are ms since
+// the app started (millis()); the ROM and bootloader run ~0.3 s before that.
+// No Arduino dependencies; tools/boot_sim.cpp compares the sequential and staged boot orders.
+
+enum BootStage : uint8_t {
+  BOOT_LEDS = 0,
+  BOOT_I2S,
+  BOOT_SD,
+  BOOT_RTC,
+  BOOT_WIFI,     // radio and setup AP up
+  BOOT_STA,      // station connect started (lease reuse wants the RTC time)
+  BOOT_HTTP,
+  BOOT_NTP,
+  BOOT_MP3,      // module's power-up wait over, probe sent
+  BOOT_STAGE_COUNT
+};
+
+static const char *const BOOT_STAGE_NAMES[BOOT_STAGE_COUNT] = { "leds", "i2s",  "sd",  "rtc", "wifi",
+                                                                "sta",  "http", "ntp", "mp3" };
+
+struct BootStageInfo {
+  uint32_t startMs;
+  uint32_t readyMs;
+  uint8_t started;
+  uint8_t ok;
+};
+
+struct BootStages {
+  uint32_t deps[BOOT_STAGE_COUNT] = {};   // stages each one waits for, as a bit mask
+  BootStageInfo st[BOOT_STAGE_COUNT] = {};
+  uint32_t readyMask = 0;
+  uint32_t firstFrameMs = 0;              // first dB frame; 0 = none yet
+  uint32_t completeMs = 0;                // every stage ready
+
+  static uint32_t bit(BootStage s) { return 1u << s; }
+  static uint32_t allMask() { return (1u << BOOT_STAGE_COUNT) - 1; }
+
+  void need(BootStage s, BootStage dep) { deps[s] |= bit(dep); }
+
+  bool ready(BootStage s) const { return (__atomic_load_n(&readyMask, __ATOMIC_ACQUIRE) & bit(s)) != 0; }
+  bool depsReady(BootStage s) const { return (__atomic_load_n(&readyMask, __ATOMIC_ACQUIRE) & deps[s]) == deps[s]; }
+  bool complete() const { return __atomic_load_n(&readyMask, __ATOMIC_ACQUIRE) == allMask(); }
+
+  // Each stage is begun and finished by one task.
+  void begin(BootStage s, uint32_t nowMs) {
+    st[s].startMs = nowMs;
+    st[s].started = 1;
+  }
+
+  void finish(BootStage s, uint32_t nowMs, bool ok) {
+    if (!st[s].started) begin(s, nowMs);
+    st[s].readyMs = nowMs;
+    st[s].ok = ok ? 1 : 0;
+    const uint32_t m = __atomic_or_fetch(&readyMask, bit(s), __ATOMIC_ACQ_REL);
+    if (m == allMask()) completeMs = nowMs;
+  }
+
+  void noteFirstFrame(uint32_t nowMs) {
+    if (firstFrameMs == 0) firstFrameMs = nowMs ? nowMs : 1;
+  }
+
+  uint32_t tookMs(BootStage s) const { return st[s].readyMs - st[s].startMs; }
+};
+
+// Time to first dB frame over the last few boots, persisted as raw bytes (NVS blob).
+static const int BOOT_HISTORY_LEN = 8;
+static const uint8_t BOOT_HISTORY_VERSION = 1;
+
+struct BootHistory {
+  uint8_t version;
+  uint8_t count;           // valid entries, up to BOOT_HISTORY_LEN
+  uint8_t next;            // slot the next boot writes
+  uint8_t reserved;
+  uint32_t boots;          // boots recorded, ever
+  uint16_t ttffMs[BOOT_HISTORY_LEN];
+
+  void reset() { *this = {}; version = BOOT_HISTORY_VERSION; }
+
+  bool valid() const { return version == BOOT_HISTORY_VERSION && count <= BOOT_HISTORY_LEN && next < BOOT_HISTORY_LEN; }
+
+  void add(uint32_t ms) {
+    if (!valid()) reset();
+    ttffMs[next] = (uint16_t)(ms > 0xFFFF ? 0xFFFF : ms);
+    next = (uint8_t)((next + 1) % BOOT_HISTORY_LEN);
+    if (count < BOOT_HISTORY_LEN) count++;
+    boots++;
+  }
+
+  uint32_t maxMs() const {
+    uint32_t m = 0;
+    for (int i = 0; i < count; i++) {
+      if (ttffMs[i] > m) m = ttffMs[i];
+    }
+    return m;
+  }
+
+  uint32_t avgMs() const {
+    if (count == 0) return 0;
+    uint32_t s = 0;
+    for (int i = 0; i < count; i++) s += ttffMs[i];
+    return s / count;
+  }
+};
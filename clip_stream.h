@@ -0,0 +1,229 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Streams a MAJOR clip to Storage while it is being recorded, instead of writing it to SD and
+// reading it back for the upload.
+//
+// The recorder appends the WAV (header first, its size known up front since clips have a fixed
+// length) to a ClipBuffer and publishes how far it got in ClipUpload::captured. clipStreamRun()
+// runs beside it (its own task on the ESP32) and sends whatever has been published as HTTP/1.1
+// chunks (Transfer-Encoding: chunked) of a PUT, so the clip is in Storage a round trip after the
+// last sample. The buffer keeps the whole clip until the upload is confirmed: when the stream
+// fails, the caller writes it to SD in one pass and the clip goes the old way.
+//
+// ClipBuffer takes fixed-size chunks from a caller-supplied allocator (PSRAM when the board has
+// it), so a clip never needs one contiguous block. The connection is duck-typed:
+//   bool connect(const char *host, uint16_t port)
+//   size_t write(const uint8_t *p, size_t n)   bytes accepted, 0 on failure (may block)
+//   int read(uint8_t *p, size_t n)             bytes read, 0 if none yet, -1 once closed
+//   void stop()
+// No Arduino dependencies; tools/clip_stream_sim.cpp runs it against a local Storage stand-in.
+
+static const size_t CLIP_CHUNK_BYTES = 8192;
+static const int CLIP_MAX_CHUNKS = 24;            // 192 KB: 5 s of 16 kHz mono with room to spare
+static const size_t CLIP_WAV_HEADER_BYTES = 44;
+static const size_t CLIP_SEND_BYTES = 4096;       // largest HTTP chunk
+
+static inline void clipWavHeader(uint8_t *h, uint32_t sampleRate, uint16_t bitsPerSample, uint16_t channels, uint32_t dataBytes) {
+  const uint32_t byteRate = sampleRate * channels * (bitsPerSample / 8);
+  const uint16_t blockAlign = channels * (bitsPerSample / 8);
+  const uint32_t chunkSize = 36 + dataBytes;
+  const uint32_t fmtSize = 16;
+  const uint16_t pcm = 1;
+  memcpy(h, "RIFF", 4);
+  memcpy(h + 4, &chunkSize, 4);
+  memcpy(h + 8, "WAVEfmt ", 8);
+  memcpy(h + 16, &fmtSize, 4);
+  memcpy(h + 20, &pcm, 2);
+  memcpy(h + 22, &channels, 2);
+  memcpy(h + 24, &sampleRate, 4);
+  memcpy(h + 28, &byteRate, 4);
+  memcpy(h + 32, &blockAlign, 2);
+  memcpy(h + 34, &bitsPerSample, 2);
+  memcpy(h + 36, "data", 4);
+  memcpy(h + 40, &dataBytes, 4);
+}
+
+struct ClipBuffer {
+  uint8_t *chunk[CLIP_MAX_CHUNKS];
+  int chunks = 0;
+  size_t len = 0;
+  void (*release)(void *) = nullptr;
+
+  size_t capacity() const { return (size_t)chunks * CLIP_CHUNK_BYTES; }
+
+  // All or nothing.
+  bool reserve(size_t bytes, void *(*alloc)(size_t), void (*rel)(void *)) {
+    clear();
+    release = rel;
+    const int need = (int)((bytes + CLIP_CHUNK_BYTES - 1) / CLIP_CHUNK_BYTES);
+    if (need > CLIP_MAX_CHUNKS) return false;
+    for (int i = 0; i < need; i++) {
+      chunk[i] = (uint8_t *)alloc(CLIP_CHUNK_BYTES);
+      if (!chunk[i]) {
+        clear();
+        return false;
+      }
+      chunks = i + 1;
+    }
+    return true;
+  }
+
+  void clear() {
+    for (int i = 0; i < chunks; i++) release(chunk[i]);
+    chunks = 0;
+    len = 0;
+  }
+
+  size_t append(const uint8_t *p, size_t n) {
+    size_t done = 0;
+    while (done < n && len < capacity()) {
+      const size_t off = len % CLIP_CHUNK_BYTES;
+      size_t k = CLIP_CHUNK_BYTES - off;
+      if (k > n - done) k = n - done;
+      memcpy(chunk[len / CLIP_CHUNK_BYTES] + off, p + done, k);
+      len += k;
+      done += k;
+    }
+    return done;
+  }
+
+  // Contiguous bytes at `off`; n is clipped to the chunk end.
+  const uint8_t *span(size_t off, size_t &n) const {
+    const size_t left = CLIP_CHUNK_BYTES - off % CLIP_CHUNK_BYTES;
+    if (n > left) n = left;
+    return chunk[off / CLIP_CHUNK_BYTES] + off % CLIP_CHUNK_BYTES;
+  }
+};
+
+enum ClipStreamState : uint8_t {
+  CLIP_IDLE = 0,
+  CLIP_STREAMING = 1,   // recorder and uploader both running
+  CLIP_STORED = 2,      // Storage answered 2xx
+  CLIP_FAILED = 3,      // connect, send or response failed; the buffer still holds the clip
+};
+
+struct ClipUpload {
+  ClipBuffer buf;
+  size_t total = 0;         // WAV bytes the clip will have
+  size_t captured = 0;      // published by the recorder (atomic)
+  uint8_t abort = 0;        // recorder gave up (atomic)
+  uint8_t state = CLIP_IDLE;
+
+  // Request
+  char host[96];
+  uint16_t port = 443;
+  char path[192];           // /storage/v1/object/<bucket>/<object>
+  const char *apiKey = "";
+  const char *contentType = "audio/wav";
+
+  // Result and timing (ms on the caller's clock)
+  int httpCode = 0;
+  size_t sent = 0;
+  uint32_t startMs = 0;
+  uint32_t connectedMs = 0;
+  uint32_t captureEndMs = 0;   // set by the recorder
+  uint32_t doneMs = 0;
+  char error[24];
+
+  // Called by the recorder after appending; set captureEndMs before the last call.
+  void publish(size_t n) { __atomic_store_n(&captured, n, __ATOMIC_RELEASE); }
+  size_t available() const { return __atomic_load_n(&captured, __ATOMIC_ACQUIRE); }
+  void setState(uint8_t s) { __atomic_store_n(&state, s, __ATOMIC_RELEASE); }
+  uint8_t getState() const { return __atomic_load_n(&state, __ATOMIC_ACQUIRE); }
+};
+
+template <typename Conn>
+static bool clipWriteAll(Conn &c, const uint8_t *p, size_t n) {
+  while (n > 0) {
+    size_t w = c.write(p, n);
+    if (w == 0) return false;
+    p += w;
+    n -= w;
+  }
+  return true;
+}
+
+// Runs one upload to completion. stallMs bounds both waiting for the recorder and waiting for
+// the response. Sets u.state to CLIP_STORED or CLIP_FAILED last, after every other field.
+template <typename Conn>
+void clipStreamRun(ClipUpload &u, Conn &c, uint32_t (*nowMs)(), void (*sleepMs)(uint32_t), uint32_t stallMs) {
+  u.startMs = nowMs();
+  u.sent = 0;
+  u.httpCode = 0;
+  u.error[0] = '\0';
+  auto fail = [&](const char *why) {
+    snprintf(u.error, sizeof(u.error), "%s", why);
+    c.stop();
+    u.doneMs = nowMs();
+    u.setState(CLIP_FAILED);
+  };
+
+  if (!c.connect(u.host, u.port)) return fail("connect");
+  u.connectedMs = nowMs();
+
+  char head[512];
+  int n = snprintf(head, sizeof(head),
+                   "PUT %s HTTP/1.1\r\nHost: %s\r\napikey: %s\r\nAuthorization: Bearer %s\r\nx-upsert: true\r\n"
+                   "Content-Type: %s\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n",
+                   u.path, u.host, u.apiKey, u.apiKey, u.contentType);
+  if (n <= 0 || n >= (int)sizeof(head)) return fail("header");
+  if (!clipWriteAll(c, (const uint8_t *)head, (size_t)n)) return fail("send");
+
+  uint32_t lastProgress = nowMs();
+  while (u.sent < u.total) {
+    const size_t have = u.available();
+    if (have <= u.sent) {
+      if (__atomic_load_n(&u.abort, __ATOMIC_ACQUIRE)) return fail("aborted");
+      if (nowMs() - lastProgress > stallMs) return fail("recorder stalled");
+      sleepMs(5);
+      continue;
+    }
+    size_t k = have - u.sent;
+    if (k > CLIP_SEND_BYTES) k = CLIP_SEND_BYTES;
+    const uint8_t *p = u.buf.span(u.sent, k);
+    char size[12];
+    int sn = snprintf(size, sizeof(size), "%X\r\n", (unsigned)k);
+    if (!clipWriteAll(c, (const uint8_t *)size, (size_t)sn) || !clipWriteAll(c, p, k) ||
+        !clipWriteAll(c, (const uint8_t *)"\r\n", 2)) {
+      return fail("send");
+    }
+    u.sent += k;
+    lastProgress = nowMs();
+  }
+  if (!clipWriteAll(c, (const uint8_t *)"0\r\n\r\n", 5)) return fail("send");
+
+  // Status line only: "HTTP/1.1 200 OK".
+  char line[48];
+  size_t got = 0;
+  const uint32_t waitFrom = nowMs();
+  while (got < sizeof(line) - 1) {
+    uint8_t ch;
+    int r = c.read(&ch, 1);
+    if (r < 0) break;
+    if (r == 0) {
+      if (nowMs() - waitFrom > stallMs) return fail("response timeout");
+      sleepMs(2);
+      continue;
+    }
+    if (ch == '\n') break;
+    line[got++] = (char)ch;
+  }
+  line[got] = '\0';
+  int code = 0;
+  if (sscanf(line, "HTTP/%*d.%*d %d", &code) != 1) return fail("bad response");
+  u.httpCode = code;
+  c.stop();
+  if (code < 200 || code >= 300) {
+    snprintf(u.error, sizeof(u.error), "HTTP %d", code);
+    u.doneMs = nowMs();
+    u.setState(CLIP_FAILED);
+    return;
+  }
+  u.doneMs = nowMs();
+  u.setState(CLIP_STORED);
+}
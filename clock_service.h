@@ -0,0 +1,144 @@
+#pragma once
+
+#include <stdint.h>
+
+// Monotonic epoch clock on top of a 64-bit microsecond counter (esp_timer_get_time()).
+//
+// epoch(mono) = baseEpochUs + dt + dt * driftPpb / 1e9 (+ the part of a pending slew applied so far),
+// with dt = mono - baseMonoUs. Reference samples (NTP, DS3231 second edge) re-anchor the mapping
+// at the current reading and then:
+//   - corrections up to slewMaxUs are slewed in over slewWindowUs, so the clock never jumps
+//   - larger ones step; a backward step up to clampMaxUs holds the output until real time
+//     catches up, anything larger is accepted as a discontinuity and counted
+//   - two samples from the same source at least driftMinIntervalUs apart measure the counter's
+//     drift, which is smoothed into driftPpb
+// A few integer ops per call and no syscalls, so it is fine to call per audio frame.
+//
+// toEpochUs() maps any earlier counter value with the current estimate (no clamp); that is how
+// samples taken before the first sync get their timestamps once it arrives.
+
+enum ClockSource { CLOCK_NONE = 0, CLOCK_RTC = 1, CLOCK_NTP = 2 };
+
+static const char *const CLOCK_SOURCE_NAMES[] = { "none", "rtc", "ntp" };
+
+struct ClockService {
+  int64_t slewMaxUs = 200000;
+  int64_t slewWindowUs = 60000000;
+  int64_t clampMaxUs = 5000000;
+  int64_t driftMinIntervalUs = 600000000;   // 10 min between samples before drift is measured
+  int32_t driftMaxPpb = 500000;             // +-500 ppm; anything beyond is a bad sample
+
+  ClockSource source = CLOCK_NONE;
+  bool synced = false;
+  int64_t baseMonoUs = 0;
+  int64_t baseEpochUs = 0;
+  int32_t driftPpb = 0;
+  int64_t slewUs = 0;
+  int64_t slewStartMonoUs = 0;
+  int64_t lastIssuedUs = 0;
+
+  // Last reference sample, for drift.
+  ClockSource refSource = CLOCK_NONE;
+  int64_t refMonoUs = 0;
+  int64_t refEpochUs = 0;
+
+  // Stats.
+  uint32_t syncs = 0;
+  uint32_t steps = 0;
+  uint32_t slews = 0;
+  uint32_t backwardSteps = 0;     // steps larger than clampMaxUs; output went back in time
+  uint32_t clampedReads = 0;      // nowEpochUs() calls held at the last issued value
+  uint32_t driftSamples = 0;
+  int64_t lastOffsetUs = 0;       // reference minus our estimate at the last sync
+  int64_t maxAbsOffsetUs = 0;
+  int64_t lastSyncMonoUs = 0;
+
+  int64_t mapped(int64_t mono) const {
+    int64_t dt = mono - baseMonoUs;
+    int64_t e = baseEpochUs + dt + (dt * (int64_t)driftPpb) / 1000000000LL;
+    if (slewUs != 0) {
+      int64_t s = mono - slewStartMonoUs;
+      if (s >= slewWindowUs) e += slewUs;
+      else if (s > 0) e += (slewUs * s) / slewWindowUs;
+    }
+    return e;
+  }
+
+  // Epoch µs for the counter value `mono`, or 0 before the first sync. Never goes backwards.
+  uint64_t nowEpochUs(int64_t mono) {
+    if (!synced) return 0;
+    int64_t e = mapped(mono);
+    if (e <= lastIssuedUs) {
+      e = lastIssuedUs + 1;
+      clampedReads++;
+    }
+    lastIssuedUs = e;
+    return (uint64_t)e;
+  }
+
+  uint64_t nowEpochMs(int64_t mono) { return nowEpochUs(mono) / 1000ULL; }
+
+  // Retroactive mapping with the current estimate; 0 before the first sync.
+  uint64_t toEpochUs(int64_t mono) const { return synced ? (uint64_t)mapped(mono) : 0; }
+  uint64_t toEpochMs(int64_t mono) const { return toEpochUs(mono) / 1000ULL; }
+
+  // Feeds one reference sample: the source says it is epochUs at counter value mono.
+  // A lower-quality source never overrides a better one once synced. Returns false if ignored.
+  bool discipline(int64_t mono, int64_t epochUs, ClockSource src) {
+    if (synced && src < source) return false;
+    syncs++;
+    lastSyncMonoUs = mono;
+
+    if (!synced) {
+      baseMonoUs = mono;
+      baseEpochUs = epochUs;
+      slewUs = 0;
+      synced = true;
+      source = src;
+      noteReference(mono, epochUs, src);
+      return true;
+    }
+
+    int64_t cur = mapped(mono);
+    int64_t off = epochUs - cur;
+    lastOffsetUs = off;
+    int64_t absOff = off < 0 ? -off : off;
+    if (absOff > maxAbsOffsetUs) maxAbsOffsetUs = absOff;
+
+    if (src == refSource && mono - refMonoUs >= driftMinIntervalUs) {
+      int64_t dMono = mono - refMonoUs;
+      int64_t ppb = ((epochUs - refEpochUs) - dMono) * 1000000000LL / dMono;
+      if (ppb >= -(int64_t)driftMaxPpb && ppb <= (int64_t)driftMaxPpb) {
+        driftPpb = (driftSamples == 0) ? (int32_t)ppb : (int32_t)(driftPpb + (ppb - driftPpb) / 4);
+        driftSamples++;
+      }
+    }
+
+    // Re-anchor where the output is now; the new drift only applies from here on.
+    baseMonoUs = mono;
+    baseEpochUs = cur;
+    slewUs = 0;
+    if (absOff <= slewMaxUs) {
+      slewUs = off;
+      slewStartMonoUs = mono;
+      slews++;
+    } else {
+      baseEpochUs = epochUs;
+      steps++;
+      if (off < -clampMaxUs) {
+        lastIssuedUs = 0;
+        backwardSteps++;
+      }
+    }
+    source = src;
+    noteReference(mono, epochUs, src);
+    return true;
+  }
+
+ private:
+  void noteReference(int64_t mono, int64_t epochUs, ClockSource src) {
+    refSource = src;
+    refMonoUs = mono;
+    refEpochUs = epochUs;
+  }
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3, reflected 0xEDB88320). Bitwise, no table: callers hash a few hundred
+// bytes at a time, so the 1 KB table isn't worth the RAM.
+static inline uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t len) {
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+  }
+  return ~crc;
+}
+
+static inline uint32_t crc32Of(const uint8_t *data, size_t len) {
+  return crc32Update(0, data, len);
+}
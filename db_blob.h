@@ -0,0 +1,324 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "crc32.h"
+
+// Compressed hourly blob of one zone's dB series (Gorilla-style), uploaded to Storage in place of
+// one noise_db_series row per sample.
+//
+// Layout, little endian:
+//   header   16 bytes: magic "DBZ1", version u8, zone u8, reserved u16, hourStartMs u64
+//   body     bit stream, MSB first, one entry per sample:
+//              time:  delta-of-delta in ms (zigzag), the first delta counted from hourStartMs
+//                     '0' same delta | '10' + 7 bits | '110' + 10 bits | '1110' + 14 bits | '1111' + 32 bits
+//              value: db10 change from the previous sample (zigzag; the first is counted from 0)
+//                     '0' unchanged | '10' + 4 bits | '110' + 7 bits | '111' + raw 16-bit db10
+//            padded with zero bits to a byte boundary
+//   trailer  8 bytes: sample count u32, CRC-32 of everything before it
+//
+// db10 is an integer that mostly moves by a few tenths, so a zigzag delta in a short bit-level
+// varint beats Gorilla's float XOR here; tools/db_blob_bench.cpp measures both. Samples may arrive
+// out of order (late-stamped pre-sync samples); they only cost the 32-bit escape.
+//
+// DbBlobWriter streams into a duck-typed Sink (bool write(const uint8_t*, size_t)), so a blob is
+// never held in RAM. dbBlobEncodeHour() cuts the oldest closed hour off a record stream and hands
+// one blob per zone to a Dst; see its comment for the Src/Dst interfaces.
+// No Arduino dependencies; tools/db_blob_bench.cpp holds the ratio/throughput benchmark and the
+// test against an in-memory Storage stand-in.
+
+static const uint32_t DB_BLOB_MAGIC = 0x315A4244;   // "DBZ1"
+static const uint8_t DB_BLOB_VERSION = 1;
+static const size_t DB_BLOB_HEADER_BYTES = 16;
+static const size_t DB_BLOB_TRAILER_BYTES = 8;
+static const uint64_t DB_BLOB_HOUR_MS = 3600000ULL;
+static const int DB_BLOB_MAX_ZONES = 2;
+
+struct DbSample {
+  uint64_t tsMs = 0;
+  int16_t db10 = 0;
+  uint8_t zone = 0;
+};
+
+// What the index row records about one blob.
+struct DbBlobInfo {
+  uint8_t zone = 0;
+  uint64_t hourStartMs = 0;
+  uint64_t firstTsMs = 0;
+  uint64_t lastTsMs = 0;
+  uint32_t samples = 0;
+  uint32_t bytes = 0;
+  uint32_t crc = 0;
+  int16_t minDb10 = 0;
+  int16_t maxDb10 = 0;
+  bool ok = true;        // false when the sink failed a write
+};
+
+static inline uint64_t dbBlobZigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static inline int64_t dbBlobUnzigzag(uint64_t u) { return (int64_t)(u >> 1) ^ -(int64_t)(u & 1); }
+
+template <typename Sink>
+struct DbBlobWriter {
+  Sink *sink = nullptr;
+  DbBlobInfo info;
+
+  uint8_t buf[64];
+  size_t bufLen = 0;
+  uint64_t acc = 0;
+  int accBits = 0;
+  uint32_t crc = 0;
+  uint64_t prevTs = 0;
+  int64_t prevDelta = 0;
+  int16_t prevDb10 = 0;
+
+  void begin(Sink *s, uint8_t zone, uint64_t hourStartMs) {
+    sink = s;
+    info = DbBlobInfo();
+    info.zone = zone;
+    info.hourStartMs = hourStartMs;
+    bufLen = 0;
+    acc = 0;
+    accBits = 0;
+    crc = 0;
+    prevTs = hourStartMs;
+    prevDelta = 0;
+    prevDb10 = 0;
+    uint8_t h[DB_BLOB_HEADER_BYTES];
+    memcpy(h, &DB_BLOB_MAGIC, 4);
+    h[4] = DB_BLOB_VERSION;
+    h[5] = zone;
+    h[6] = h[7] = 0;
+    memcpy(h + 8, &hourStartMs, 8);
+    putBytes(h, sizeof(h));
+  }
+
+  // False (sample not added) when its delta-of-delta needs more than 32 bits, i.e. it lies weeks
+  // away from its neighbour; dbBlobEncodeHour() only feeds samples inside one hour.
+  bool add(uint64_t tsMs, int16_t db10) {
+    int64_t delta = (int64_t)(tsMs - prevTs);
+    uint64_t dod = dbBlobZigzag(delta - prevDelta);
+    if (dod > 0xFFFFFFFFULL) return false;
+    if (dod == 0) putBits(0, 1);
+    else if (dod < (1u << 7)) putBits((0x2u << 7) | (uint32_t)dod, 2 + 7);
+    else if (dod < (1u << 10)) putBits((0x6u << 10) | (uint32_t)dod, 3 + 10);
+    else if (dod < (1u << 14)) putBits((0xEu << 14) | (uint32_t)dod, 4 + 14);
+    else {
+      putBits(0xF, 4);
+      putBits((uint32_t)dod, 32);
+    }
+
+    uint64_t dv = dbBlobZigzag((int64_t)db10 - prevDb10);
+    if (dv == 0) putBits(0, 1);
+    else if (dv < (1u << 4)) putBits((0x2u << 4) | (uint32_t)dv, 2 + 4);
+    else if (dv < (1u << 7)) putBits((0x6u << 7) | (uint32_t)dv, 3 + 7);
+    else putBits((0x7u << 16) | (uint16_t)db10, 3 + 16);
+
+    if (info.samples == 0) {
+      info.firstTsMs = tsMs;
+      info.minDb10 = info.maxDb10 = db10;
+    }
+    if (db10 < info.minDb10) info.minDb10 = db10;
+    if (db10 > info.maxDb10) info.maxDb10 = db10;
+    info.lastTsMs = tsMs;
+    info.samples++;
+    prevDelta = delta;
+    prevTs = tsMs;
+    prevDb10 = db10;
+    return true;
+  }
+
+  const DbBlobInfo &finish() {
+    if (accBits > 0) putBits(0, 8 - accBits);
+    flushBuf();
+    memcpy(buf, &info.samples, 4);
+    info.crc = crc = crc32Update(crc, buf, 4);
+    memcpy(buf + 4, &info.crc, 4);
+    bufLen = DB_BLOB_TRAILER_BYTES;
+    info.bytes += DB_BLOB_TRAILER_BYTES;
+    if (sink && !sink->write(buf, bufLen)) info.ok = false;
+    bufLen = 0;
+    return info;
+  }
+
+ private:
+  void putBits(uint32_t v, int n) {
+    acc = (acc << n) | v;
+    accBits += n;
+    while (accBits >= 8) {
+      accBits -= 8;
+      pushByte((uint8_t)(acc >> accBits));
+    }
+    acc &= (1ULL << accBits) - 1;
+  }
+
+  void putBytes(const uint8_t *p, size_t n) {
+    for (size_t i = 0; i < n; i++) pushByte(p[i]);
+  }
+
+  void pushByte(uint8_t b) {
+    buf[bufLen++] = b;
+    info.bytes++;
+    if (bufLen == sizeof(buf)) flushBuf();
+  }
+
+  void flushBuf() {
+    if (bufLen == 0) return;
+    crc = crc32Update(crc, buf, bufLen);
+    if (sink && !sink->write(buf, bufLen)) info.ok = false;
+    bufLen = 0;
+  }
+};
+
+struct DbBlobBitReader {
+  const uint8_t *p;
+  size_t bits;      // available
+  size_t pos = 0;
+  bool overrun = false;
+
+  uint32_t get(int n) {
+    uint32_t v = 0;
+    for (int i = 0; i < n; i++) {
+      if (pos >= bits) {
+        overrun = true;
+        return 0;
+      }
+      v = (v << 1) | ((p[pos >> 3] >> (7 - (pos & 7))) & 1u);
+      pos++;
+    }
+    return v;
+  }
+
+  // Number of leading 1 bits before a 0, up to max (the last code has no terminating 0).
+  int ones(int max) {
+    int k = 0;
+    while (k < max && get(1)) k++;
+    return k;
+  }
+};
+
+// Checks a whole blob (magic, size, CRC) and calls fn(tsMs, db10) for each sample in order.
+// Returns false (after delivering nothing) when it is damaged.
+template <typename Fn>
+bool dbBlobDecode(const uint8_t *p, size_t n, DbBlobInfo &info, Fn fn) {
+  if (n < DB_BLOB_HEADER_BYTES + DB_BLOB_TRAILER_BYTES) return false;
+  uint32_t magic, count, crc;
+  memcpy(&magic, p, 4);
+  if (magic != DB_BLOB_MAGIC || p[4] != DB_BLOB_VERSION) return false;
+  memcpy(&count, p + n - 8, 4);
+  memcpy(&crc, p + n - 4, 4);
+  if (crc32Of(p, n - 4) != crc) return false;
+
+  info = DbBlobInfo();
+  info.zone = p[5];
+  memcpy(&info.hourStartMs, p + 8, 8);
+  info.bytes = (uint32_t)n;
+  info.crc = crc;
+  info.samples = count;
+
+  for (int pass = 0; pass < 2; pass++) {   // validate everything before delivering anything
+    DbBlobBitReader r = { p + DB_BLOB_HEADER_BYTES, (n - DB_BLOB_HEADER_BYTES - DB_BLOB_TRAILER_BYTES) * 8 };
+    uint64_t ts = info.hourStartMs;
+    int64_t delta = 0;
+    int16_t db10 = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      static const int TS_BITS[5] = { 0, 7, 10, 14, 32 };
+      int k = r.ones(4);
+      uint64_t dod = k ? r.get(TS_BITS[k]) : 0;
+      delta += dbBlobUnzigzag(dod);
+      ts += (uint64_t)delta;
+
+      static const int DB_BITS[3] = { 0, 4, 7 };
+      int m = r.ones(3);
+      if (m == 3) db10 = (int16_t)r.get(16);
+      else if (m > 0) db10 = (int16_t)(db10 + dbBlobUnzigzag(r.get(DB_BITS[m])));
+      if (r.overrun) return false;
+
+      if (pass == 1) {
+        fn(ts, db10);
+      } else {
+        if (i == 0) {
+          info.firstTsMs = ts;
+          info.minDb10 = info.maxDb10 = db10;
+        }
+        if (db10 < info.minDb10) info.minDb10 = db10;
+        if (db10 > info.maxDb10) info.maxDb10 = db10;
+        info.lastTsMs = ts;
+      }
+    }
+  }
+  return true;
+}
+
+enum DbBlobStep {
+  DB_BLOB_EMPTY = 0,    // nothing to read
+  DB_BLOB_OPEN = 1,     // the oldest hour is still being written; try again later
+  DB_BLOB_STORED = 2,   // every zone's blob and index row stored; the caller may commit the source
+  DB_BLOB_FAILED = 3,   // a write, upload or index insert failed; retry from the same position
+};
+
+// Encodes the oldest hour in `src` into one blob per zone and stores them through `dst`.
+// The hour is closed once a record from another hour follows it or wall time has moved past it
+// (nowEpochMs, 0 if unknown); records stop at the first one outside the hour, so a late-stamped
+// record ends the blob and starts its own. Stored blobs are keyed by (zone, hour, first sample),
+// so retrying after a partial failure overwrites rather than duplicates.
+//
+//   Src: bool peek(DbSample &s)   next record without consuming it; false at the end
+//        void pop()
+//   Dst: Sink *open(uint8_t zone, uint64_t hourStartMs)   nullptr on failure
+//        bool store(const DbBlobInfo &info)              finishes info.zone's blob: upload + index row
+//        void discard(uint8_t zone)                      drops an unfinished blob
+template <typename Src, typename Dst, typename Sink>
+DbBlobStep dbBlobEncodeHour(Src &src, Dst &dst, uint64_t nowEpochMs, DbBlobInfo *out = nullptr, int *outCount = nullptr) {
+  DbSample s;
+  if (!src.peek(s)) return DB_BLOB_EMPTY;
+  const uint64_t hour = s.tsMs - s.tsMs % DB_BLOB_HOUR_MS;
+
+  DbBlobWriter<Sink> w[DB_BLOB_MAX_ZONES];
+  bool used[DB_BLOB_MAX_ZONES] = { false, false };
+  bool closed = false;
+  bool failed = false;
+  while (src.peek(s)) {
+    if (s.tsMs < hour || s.tsMs >= hour + DB_BLOB_HOUR_MS) {
+      closed = true;
+      break;
+    }
+    const uint8_t z = s.zone < DB_BLOB_MAX_ZONES ? s.zone : DB_BLOB_MAX_ZONES - 1;
+    if (!used[z]) {
+      Sink *sink = dst.open(z, hour);
+      if (!sink) {
+        failed = true;
+        break;
+      }
+      w[z].begin(sink, z, hour);
+      used[z] = true;
+    }
+    w[z].add(s.tsMs, s.db10);
+    src.pop();
+  }
+  if (!closed && !failed && nowEpochMs >= hour + DB_BLOB_HOUR_MS) closed = true;
+
+  if (!closed || failed) {
+    for (int z = 0; z < DB_BLOB_MAX_ZONES; z++) {
+      if (used[z]) dst.discard((uint8_t)z);
+    }
+    return failed ? DB_BLOB_FAILED : DB_BLOB_OPEN;
+  }
+
+  int n = 0;
+  bool ok = true;
+  for (int z = 0; z < DB_BLOB_MAX_ZONES; z++) {
+    if (!used[z]) continue;
+    const DbBlobInfo &info = w[z].finish();
+    if (!ok || !info.ok || !dst.store(info)) {
+      ok = false;
+      dst.discard((uint8_t)z);
+      continue;
+    }
+    if (out) out[n] = info;
+    n++;
+  }
+  if (outCount) *outCount = n;
+  return ok ? DB_BLOB_STORED : DB_BLOB_FAILED;
+}
@@ -0,0 +1,373 @@
+#pragma once
+
+#if __cplusplus < 201703L
+#error "dsp_pipeline.h needs C++17 (Arduino-ESP32 3.x)"
+#endif
+
+#include <math.h>
+#include <stdint.h>
+
+// The dB meter's signal chain, put together from template stages at compile time.
+//
+// A profile is a struct of constants plus the list of per-sample stages. DspPipeline<Profile>
+// runs one zone's I2S block through those stages into a mean square, then the log mapping (RMS
+// above noiseFloor, 20*log10 * sensitivity, as readMicDB() always did) and the EMA; the firmware
+// averages the loudest zone over avgWindow frames with DspWindowAvg. Every coefficient (DC
+// blocker pole, A-weighting biquads, EMA alpha) is a constexpr function of the sample rate and
+// block length, so a profile compiles to one straight loop over the block with the filters
+// inlined: no tables, no heap, no virtual calls.
+//
+// Sample stages take the INMP441's 24-bit value (word >> 8) as float and implement
+//   bool step(float x, float &y)     // false: nothing to pass on for this input (decimation)
+// With no sample stages the mean square is summed in int64 exactly as zoneSplit() does it, and
+// the legacy profile gives bit-identical levels to the old RMS / EMA / moving-average code.
+// Needs C++17 (constexpr loops, inline static members), Arduino-ESP32 3.x's default; older
+// toolchains stop at the #error above instead of an opaque constexpr diagnostic.
+// No Arduino dependencies; tools/dsp_bench.cpp checks the profiles against the old chain and
+// times them.
+
+// ---------- constexpr math (coefficients only, never called at run time) ----------
+
+constexpr double dspPi = 3.14159265358979323846;
+
+constexpr double dspExp(double x) {
+  int halvings = 0;
+  while (x > 0.5 || x < -0.5) {
+    x *= 0.5;
+    halvings++;
+  }
+  double term = 1, sum = 1;
+  for (int i = 1; i < 20; i++) {
+    term *= x / i;
+    sum += term;
+  }
+  while (halvings-- > 0) sum *= sum;
+  return sum;
+}
+
+constexpr double dspSin(double x) {
+  while (x > dspPi) x -= 2 * dspPi;
+  while (x < -dspPi) x += 2 * dspPi;
+  double term = x, sum = x;
+  for (int i = 1; i < 16; i++) {
+    term *= -x * x / ((2 * i) * (2 * i + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+constexpr double dspCos(double x) { return dspSin(x + dspPi / 2); }
+
+constexpr double dspTan(double x) { return dspSin(x) / dspCos(x); }
+
+constexpr double dspSqrt(double x) {
+  if (x <= 0) return 0;
+  double r = x > 1 ? x : 1;
+  for (int i = 0; i < 200; i++) {
+    const double n = 0.5 * (r + x / r);
+    if (n == r) break;
+    r = n;
+  }
+  return r;
+}
+
+// Per-block EMA weight for a time constant of tauMs at blockLen samples per block.
+constexpr double dspEmaAlpha(int blockLen, uint32_t rateHz, uint32_t tauMs) {
+  return 1.0 - dspExp(-(double)blockLen * 1000.0 / ((double)rateHz * tauMs));
+}
+
+// ---------- biquads ----------
+
+struct DspBiquadCoef {
+  double b0, b1, b2, a1, a2;   // a0 = 1
+};
+
+// First-order bilinear sections. Corners well below Nyquist map as they are (then the curve
+// fits the analog one better across the band once it is normalised at 1 kHz); prewarp moves the
+// corner so it lands on hz exactly, which matters near Nyquist.
+struct DspFirstOrder {
+  double b0, b1, a1;
+};
+
+constexpr double dspBilinearW(double hz, double rateHz, bool prewarp) {
+  return prewarp ? 2 * rateHz * dspTan(dspPi * hz / rateHz) : 2 * dspPi * hz;
+}
+
+constexpr DspFirstOrder dspHighPass1(double hz, double rateHz, bool prewarp) {
+  const double k = 2 * rateHz;
+  const double w = dspBilinearW(hz, rateHz, prewarp);
+  return { k / (k + w), -k / (k + w), (w - k) / (k + w) };
+}
+
+constexpr DspFirstOrder dspLowPass1(double hz, double rateHz, bool prewarp) {
+  const double k = 2 * rateHz;
+  const double w = dspBilinearW(hz, rateHz, prewarp);
+  return { w / (k + w), w / (k + w), (w - k) / (k + w) };
+}
+
+constexpr DspBiquadCoef dspCascade(DspFirstOrder p, DspFirstOrder q) {
+  return { p.b0 * q.b0, p.b0 * q.b1 + p.b1 * q.b0, p.b1 * q.b1, p.a1 + q.a1, p.a1 * q.a1 };
+}
+
+// |H| of a biquad at hz.
+constexpr double dspBiquadGain(const DspBiquadCoef &c, double hz, double rateHz) {
+  const double t = 2 * dspPi * hz / rateHz;
+  const double c1 = dspCos(t), s1 = dspSin(t), c2 = dspCos(2 * t), s2 = dspSin(2 * t);
+  const double nr = c.b0 + c.b1 * c1 + c.b2 * c2, ni = -(c.b1 * s1 + c.b2 * s2);
+  const double dr = 1 + c.a1 * c1 + c.a2 * c2, di = -(c.a1 * s1 + c.a2 * s2);
+  return dspSqrt((nr * nr + ni * ni) / (dr * dr + di * di));
+}
+
+// IEC 61672 A-weighting: zeros at 0 Hz, poles at 20.6 Hz (x2), 107.7 Hz, 737.9 Hz and
+// 12194 Hz (x2), normalised to 0 dB at 1 kHz. The 12194 Hz pair needs a rate above 27 kHz; below
+// that one first-order low-pass at 0.44 fs stands in for it (the value that fits best at 16 kHz).
+// Against the analog curve up to 0.45 fs: within 1.0 dB at 16 kHz (worst at 5 kHz), 0.6 dB at 8 kHz.
+static const int DSP_AWEIGHT_SECTIONS = 3;
+
+struct DspAWeightCoef {
+  DspBiquadCoef s[DSP_AWEIGHT_SECTIONS];
+};
+
+constexpr DspAWeightCoef dspAWeightCoef(uint32_t rateHz) {
+  const double fs = rateHz;
+  DspAWeightCoef a = {};
+  a.s[0] = dspCascade(dspHighPass1(20.598997, fs, false), dspHighPass1(20.598997, fs, false));
+  a.s[1] = dspCascade(dspHighPass1(107.65265, fs, false), dspHighPass1(737.86223, fs, false));
+  if (12194.217 < 0.45 * fs) {
+    a.s[2] = dspCascade(dspLowPass1(12194.217, fs, true), dspLowPass1(12194.217, fs, true));
+  } else {
+    const DspFirstOrder lp = dspLowPass1(0.44 * fs, fs, true);
+    a.s[2] = { lp.b0, lp.b1, 0, lp.a1, 0 };
+  }
+  double g = 1;
+  for (int i = 0; i < DSP_AWEIGHT_SECTIONS; i++) g *= dspBiquadGain(a.s[i], 1000, fs);
+  a.s[0].b0 /= g;
+  a.s[0].b1 /= g;
+  a.s[0].b2 /= g;
+  return a;
+}
+
+// ---------- sample stages ----------
+
+// One-pole DC blocker, y = x - x[-1] + r*y[-1]; the corner is cutoffHz.
+template <uint32_t RateHz, uint32_t CutoffHz>
+struct DspDcBlock {
+  static constexpr float r = (float)dspExp(-2 * dspPi * CutoffHz / RateHz);
+  float x1 = 0, y1 = 0;
+
+  inline bool step(float x, float &y) {
+    y = x - x1 + r * y1;
+    x1 = x;
+    y1 = y;
+    return true;
+  }
+};
+
+// A-weighting as a cascade of transposed direct-form II biquads.
+template <uint32_t RateHz>
+struct DspAWeight {
+  static constexpr DspAWeightCoef c = dspAWeightCoef(RateHz);
+  static constexpr float k[DSP_AWEIGHT_SECTIONS][5] = {
+    { (float)c.s[0].b0, (float)c.s[0].b1, (float)c.s[0].b2, (float)c.s[0].a1, (float)c.s[0].a2 },
+    { (float)c.s[1].b0, (float)c.s[1].b1, (float)c.s[1].b2, (float)c.s[1].a1, (float)c.s[1].a2 },
+    { (float)c.s[2].b0, (float)c.s[2].b1, (float)c.s[2].b2, (float)c.s[2].a1, (float)c.s[2].a2 },
+  };
+  float z[DSP_AWEIGHT_SECTIONS][2] = {};
+
+  inline bool step(float x, float &y) {
+    for (int i = 0; i < DSP_AWEIGHT_SECTIONS; i++) {
+      const float o = k[i][0] * x + z[i][0];
+      z[i][0] = k[i][1] * x - k[i][3] * o + z[i][1];
+      z[i][1] = k[i][2] * x - k[i][4] * o;
+      x = o;
+    }
+    y = x;
+    return true;
+  }
+};
+
+// Averages Factor inputs into one output. A boxcar is a poor anti-alias filter (-3.9 dB at the new
+// Nyquist for Factor 2), so put it where the band above the new Nyquist carries little weight.
+template <int Factor>
+struct DspDecimate {
+  static_assert(Factor >= 1, "Factor must be at least 1");
+  float acc = 0;
+  int n = 0;
+
+  inline bool step(float x, float &y) {
+    acc += x;
+    if (++n < Factor) return false;
+    y = acc * (1.0f / Factor);
+    acc = 0;
+    n = 0;
+    return true;
+  }
+};
+
+// The per-sample stages, in order. push() hands the sample to each in turn and calls sink(y) for
+// what comes out of the last one; the recursion unrolls at compile time.
+template <class... Stages>
+struct DspChain;
+
+template <>
+struct DspChain<> {
+  static constexpr bool empty = true;
+  void reset() {}
+  template <class Sink>
+  inline void push(float x, Sink &sink) { sink(x); }
+};
+
+template <class Head, class... Tail>
+struct DspChain<Head, Tail...> {
+  static constexpr bool empty = false;
+  Head head;
+  DspChain<Tail...> tail;
+
+  void reset() {
+    head = Head();
+    tail.reset();
+  }
+
+  template <class Sink>
+  inline void push(float x, Sink &sink) {
+    float y;
+    if (head.step(x, y)) tail.push(y, sink);
+  }
+};
+
+// ---------- block stages ----------
+
+// Sum of squares of what the sample stages put out.
+struct DspMeanSquare {
+  float sum = 0;
+  int n = 0;
+
+  inline void operator()(float y) {
+    sum += y * y;
+    n++;
+  }
+};
+
+// Same mapping readMicDB() has always used: RMS above the floor, log-scaled, truncated.
+// sumSq is in 32-bit word units (the 24-bit value squared times 65536).
+static inline int dspLevelDb(double sumSq, int frames, double noiseFloor, double sensitivity) {
+  if (frames <= 0) return 0;
+  double rms = sqrt(sumSq / frames) - noiseFloor;
+  if (rms < 0) rms = 0;
+  return (int)(20.0 * log10(rms + 1) * sensitivity);
+}
+
+// Integer moving average over the last N values (fewer until it has filled).
+template <int N>
+struct DspWindowAvg {
+  static_assert(N >= 1, "N must be at least 1");
+  int buf[N] = {};
+  int idx = 0;
+  bool filled = false;
+
+  int add(int value) {
+    buf[idx++] = value;
+    if (idx >= N) {
+      idx = 0;
+      filled = true;
+    }
+    int sum = 0;
+    const int count = filled ? N : idx;
+    for (int i = 0; i < count; i++) sum += buf[i];
+    return sum / count;
+  }
+};
+
+// ---------- profiles ----------
+// rateHz and blockLen are what the I2S driver delivers; Stages run at rateHz.
+
+// The original chain: plain RMS, EMA 0.1 per block, 10-block average.
+struct DspProfileLegacy {
+  static constexpr const char *name = "legacy";
+  static constexpr uint32_t rateHz = 16000;
+  static constexpr int blockLen = 256;
+  using Stages = DspChain<>;
+  static constexpr double noiseFloor = 25000;
+  static constexpr double sensitivity = 0.5;
+  static constexpr double smoothAlpha = 0.1;
+  static constexpr int avgWindow = 10;
+};
+
+// Legacy levels without the mic's DC offset, which otherwise reads as a raised floor.
+struct DspProfileDcBlocked {
+  static constexpr const char *name = "dc-blocked";
+  static constexpr uint32_t rateHz = 16000;
+  static constexpr int blockLen = 256;
+  using Stages = DspChain<DspDcBlock<rateHz, 10>>;
+  static constexpr double noiseFloor = 25000;
+  static constexpr double sensitivity = 0.5;
+  static constexpr double smoothAlpha = 0.1;
+  static constexpr int avgWindow = 10;
+};
+
+// dB(A) with the sound-level meter's "fast" (125 ms) time weighting. 1 kHz reads as before;
+// traffic rumble and HVAC hum read lower.
+struct DspProfileAWeighted {
+  static constexpr const char *name = "a-weighted";
+  static constexpr uint32_t rateHz = 16000;
+  static constexpr int blockLen = 256;
+  using Stages = DspChain<DspDcBlock<rateHz, 10>, DspAWeight<rateHz>>;
+  static constexpr double noiseFloor = 25000;
+  static constexpr double sensitivity = 0.5;
+  static constexpr double smoothAlpha = dspEmaAlpha(blockLen, rateHz, 125);
+  static constexpr int avgWindow = 10;
+};
+
+// dB(A) over 0-4 kHz: halve the rate first so the filters run on half the samples.
+struct DspProfileAWeightedLite {
+  static constexpr const char *name = "a-weighted-lite";
+  static constexpr uint32_t rateHz = 16000;
+  static constexpr int blockLen = 256;
+  using Stages = DspChain<DspDecimate<2>, DspDcBlock<rateHz / 2, 10>, DspAWeight<rateHz / 2>>;
+  static constexpr double noiseFloor = 25000;
+  static constexpr double sensitivity = 0.5;
+  static constexpr double smoothAlpha = dspEmaAlpha(blockLen, rateHz, 125);
+  static constexpr int avgWindow = 10;
+};
+
+// ---------- pipeline ----------
+
+template <class Profile>
+struct DspPipeline {
+  typename Profile::Stages stages;
+  double smoothDb = 0;
+
+  static constexpr bool filtered = !Profile::Stages::empty;
+
+  // One zone's block of I2S words: the level in dB, before smoothing.
+  int levelDb(const int32_t *x, int n) {
+    if (!filtered) {
+      int64_t s = 0;
+      for (int i = 0; i < n; i++) {
+        const int32_t v = x[i] >> 8;
+        s += (int64_t)v * v;
+      }
+      return levelDbFromSumSq((double)s * 65536.0, n);
+    }
+    DspMeanSquare ms;
+    for (int i = 0; i < n; i++) stages.push((float)(x[i] >> 8), ms);
+    return dspLevelDb((double)ms.sum * 65536.0, ms.n, Profile::noiseFloor, Profile::sensitivity);
+  }
+
+  // For the unfiltered chain, when the caller already has the block's sum of squares
+  // (zoneSplit() gets it in the deinterleave pass).
+  int levelDbFromSumSq(double sumSq, int frames) const {
+    return dspLevelDb(sumSq, frames, Profile::noiseFloor, Profile::sensitivity);
+  }
+
+  // Once per frame, also when the block was dropped (the EMA keeps converging on the last level).
+  double smooth(int rawDb) {
+    smoothDb = smoothDb + Profile::smoothAlpha * (rawDb - smoothDb);
+    return smoothDb;
+  }
+
+  void reset() {
+    stages.reset();
+    smoothDb = 0;
+  }
+};
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Structured event log with deferred formatting.
+//
+// log() stores a compact binary record in a preallocated byte ring: sequence number, millis()
+// timestamp, a pointer to the (string literal) format, subsystem, level and the typed arguments.
+// Nothing is formatted until someone reads the record (/events, Serial, SD export), so a log call
+// on a hot path is a level check, a few memcpy()s and no heap. The oldest records are evicted
+// when the ring is full.
+//
+// Formats use "{}" for each argument, in order; the stored type decides how it prints
+// (integers in decimal, floats with one decimal, strings as-is). Strings are truncated to
+// LOG_MAX_STR bytes. The format pointer must outlive the record, so only pass literals.
+//
+// Levels are filtered per subsystem at write time (threshold[]), so disabled records cost
+// one compare.
+
+enum LogLevel : uint8_t { LOG_ERROR = 0, LOG_WARN = 1, LOG_INFO = 2, LOG_DEBUG = 3 };
+
+enum LogSubsystem : uint8_t {
+  LOG_SYS = 0,
+  LOG_CFG,
+  LOG_NOISE,
+  LOG_SYNC,
+  LOG_DBS,
+  LOG_EVQ,
+  LOG_SD,
+  LOG_NET,
+  LOG_AUDIO,
+  LOG_CLOCK,
+  LOG_MON,
+  LOG_SUB_COUNT
+};
+
+static const char *const LOG_SUB_NAMES[LOG_SUB_COUNT] = { "sys", "cfg", "noise", "sync", "db", "evq",
+                                                          "sd", "net", "audio", "clock", "mon" };
+static const char *const LOG_LEVEL_NAMES[] = { "error", "warn", "info", "debug" };
+
+static const int LOG_MAX_STR = 96;
+static const int LOG_MAX_RECORD = 224;
+
+enum LogArgTag : uint8_t { LA_I32 = 1, LA_U32, LA_I64, LA_U64, LA_F32, LA_STR };
+
+struct LogArgWriter {
+  uint8_t *p;
+  uint8_t *end;
+
+  void put(uint8_t tag, const void *v, size_t n) {
+    if (p + 1 + n > end) return;
+    *p++ = tag;
+    memcpy(p, v, n);
+    p += n;
+  }
+  void putStr(const char *s) {
+    size_t n = s ? strlen(s) : 0;
+    if (n > (size_t)LOG_MAX_STR) n = LOG_MAX_STR;
+    if (p + 2 > end) return;
+    if (p + 2 + n > end) n = (size_t)(end - p - 2);
+    *p++ = LA_STR;
+    *p++ = (uint8_t)n;
+    memcpy(p, s, n);
+    p += n;
+  }
+};
+
+static inline void logPutArg(LogArgWriter &w, int v) { int32_t x = v; w.put(LA_I32, &x, 4); }
+static inline void logPutArg(LogArgWriter &w, long v) { int32_t x = (int32_t)v; w.put(LA_I32, &x, 4); }
+static inline void logPutArg(LogArgWriter &w, unsigned int v) { uint32_t x = v; w.put(LA_U32, &x, 4); }
+static inline void logPutArg(LogArgWriter &w, unsigned long v) { uint32_t x = (uint32_t)v; w.put(LA_U32, &x, 4); }
+static inline void logPutArg(LogArgWriter &w, long long v) { int64_t x = v; w.put(LA_I64, &x, 8); }
+static inline void logPutArg(LogArgWriter &w, unsigned long long v) { uint64_t x = v; w.put(LA_U64, &x, 8); }
+static inline void logPutArg(LogArgWriter &w, bool v) { w.putStr(v ? "1" : "0"); }
+static inline void logPutArg(LogArgWriter &w, float v) { w.put(LA_F32, &v, 4); }
+static inline void logPutArg(LogArgWriter &w, double v) { float x = (float)v; w.put(LA_F32, &x, 4); }
+static inline void logPutArg(LogArgWriter &w, const char *s) { w.putStr(s); }
+// Anything with c_str() (Arduino String, std::string).
+template <typename T>
+static inline auto logPutArg(LogArgWriter &w, const T &s) -> decltype(s.c_str(), void()) { w.putStr(s.c_str()); }
+
+struct LogRecord {
+  uint32_t seq;
+  uint32_t monoMs;
+  const char *fmt;
+  uint8_t sub;
+  uint8_t level;
+  const uint8_t *args;
+  uint16_t argBytes;
+};
+
+// Renders fmt with the record's arguments. Returns the length written (always NUL-terminated).
+static inline size_t logFormatMessage(const LogRecord &r, char *out, size_t n) {
+  if (n == 0) return 0;
+  size_t o = 0;
+  const uint8_t *a = r.args;
+  const uint8_t *ae = r.args + r.argBytes;
+  for (const char *f = r.fmt; *f && o + 1 < n; f++) {
+    if (f[0] != '{' || f[1] != '}') {
+      out[o++] = *f;
+      continue;
+    }
+    f++;
+    if (a >= ae) continue;
+    uint8_t tag = *a++;
+    char tmp[24];
+    const char *s = tmp;
+    size_t sl = 0;
+    if (tag == LA_STR) {
+      sl = *a++;
+      s = (const char *)a;
+      a += sl;
+    } else if (tag == LA_I32 || tag == LA_U32 || tag == LA_F32) {
+      uint32_t u;
+      memcpy(&u, a, 4);
+      a += 4;
+      if (tag == LA_I32) sl = (size_t)snprintf(tmp, sizeof(tmp), "%ld", (long)(int32_t)u);
+      else if (tag == LA_U32) sl = (size_t)snprintf(tmp, sizeof(tmp), "%lu", (unsigned long)u);
+      else {
+        float fv;
+        memcpy(&fv, &u, 4);
+        sl = (size_t)snprintf(tmp, sizeof(tmp), "%.1f", (double)fv);
+      }
+    } else if (tag == LA_I64 || tag == LA_U64) {
+      uint64_t u;
+      memcpy(&u, a, 8);
+      a += 8;
+      if (tag == LA_I64) sl = (size_t)snprintf(tmp, sizeof(tmp), "%lld", (long long)(int64_t)u);
+      else sl = (size_t)snprintf(tmp, sizeof(tmp), "%llu", (unsigned long long)u);
+    } else {
+      break;  // unknown tag: stop decoding args
+    }
+    if (sl >= sizeof(tmp) && s == tmp) sl = sizeof(tmp) - 1;
+    for (size_t i = 0; i < sl && o + 1 < n; i++) out[o++] = s[i];
+  }
+  out[o] = '\0';
+  return o;
+}
+
+template <int N>
+struct StructLog {
+  static const size_t HEADER = 2 + 4 + 4 + sizeof(const char *) + 2;
+
+  uint8_t threshold[LOG_SUB_COUNT];
+  uint8_t buf[N];
+  uint32_t head = 0;   // write offset
+  uint32_t tail = 0;   // oldest record
+  uint32_t count = 0;
+  uint32_t nextSeq = 1;
+
+  // Stats.
+  uint32_t written = 0;
+  uint32_t evicted = 0;
+  uint32_t filtered = 0;
+  uint32_t bytesUsed = 0;
+
+  StructLog() {
+    for (int i = 0; i < LOG_SUB_COUNT; i++) threshold[i] = LOG_INFO;
+  }
+
+  bool enabled(uint8_t sub, uint8_t level) const { return sub < LOG_SUB_COUNT && level <= threshold[sub]; }
+
+  template <typename... Args>
+  bool log(uint32_t monoMs, uint8_t sub, uint8_t level, const char *fmt, const Args &...args) {
+    if (!enabled(sub, level)) {
+      filtered++;
+      return false;
+    }
+    uint8_t rec[LOG_MAX_RECORD];
+    LogArgWriter w{ rec + HEADER, rec + sizeof(rec) };
+    int expand[] = { 0, (logPutArg(w, args), 0)... };
+    (void)expand;
+    const uint16_t len = (uint16_t)(w.p - rec);
+    const uint32_t seq = nextSeq++;
+    size_t o = 0;
+    memcpy(rec + o, &len, 2); o += 2;
+    memcpy(rec + o, &seq, 4); o += 4;
+    memcpy(rec + o, &monoMs, 4); o += 4;
+    memcpy(rec + o, &fmt, sizeof(fmt)); o += sizeof(fmt);
+    rec[o++] = sub;
+    rec[o++] = level;
+
+    if (!makeRoom(len)) return false;
+    memcpy(buf + head, rec, len);
+    head += len;
+    count++;
+    written++;
+    bytesUsed += len;
+    return true;
+  }
+
+  uint32_t oldestSeq() const { return count ? nextSeq - count : nextSeq; }
+
+  // Calls fn(const LogRecord &) for each retained record with seq >= fromSeq, oldest first.
+  // Returns the seq after the last record visited (a cursor for the next call).
+  template <typename Fn>
+  uint32_t forEach(uint32_t fromSeq, Fn fn, uint32_t maxRecords = 0xFFFFFFFFu) const {
+    uint32_t o = tail;
+    uint32_t next = fromSeq < oldestSeq() ? oldestSeq() : fromSeq;
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      if (N - o < 2 || get16(o) == 0) o = 0;
+      LogRecord r;
+      uint16_t len = get16(o);
+      size_t p = o + 2;
+      memcpy(&r.seq, buf + p, 4); p += 4;
+      memcpy(&r.monoMs, buf + p, 4); p += 4;
+      memcpy(&r.fmt, buf + p, sizeof(r.fmt)); p += sizeof(r.fmt);
+      r.sub = buf[p++];
+      r.level = buf[p++];
+      r.args = buf + p;
+      r.argBytes = (uint16_t)(len - HEADER);
+      o += len;
+      if (r.seq < next) continue;
+      if (seen >= maxRecords) break;
+      fn(r);
+      seen++;
+      next = r.seq + 1;
+    }
+    return next;
+  }
+
+ private:
+  uint16_t get16(uint32_t o) const {
+    uint16_t v;
+    memcpy(&v, buf + o, 2);
+    return v;
+  }
+
+  void evictOldest() {
+    if (N - tail < 2 || get16(tail) == 0) tail = 0;
+    uint16_t len = get16(tail);
+    tail += len;
+    bytesUsed -= len;
+    count--;
+    evicted++;
+    if (count == 0) {
+      head = tail = 0;
+      return;
+    }
+    if (N - tail < 2 || get16(tail) == 0) tail = 0;
+  }
+
+  // Makes len contiguous bytes available at head, evicting the oldest records as needed.
+  // A record that does not fit at the end leaves a zero-length marker and wraps to offset 0.
+  bool makeRoom(uint16_t len) {
+    if (len > N) return false;
+    for (;;) {
+      if (count == 0) {
+        head = tail = 0;
+        return true;
+      }
+      if (head > tail) {
+        if (N - head >= len) return true;
+        if (tail >= len) {
+          if (N - head >= 2) memset(buf + head, 0, 2);
+          head = 0;
+          return true;
+        }
+      } else if (tail - head >= len) {
+        return true;
+      }
+      evictOldest();
+    }
+  }
+};
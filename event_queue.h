@@ -0,0 +1,203 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// RAM-first queue for RED warning events.
+//
+// While the uplink is healthy, events stay in a small in-memory queue and are uploaded straight
+// from it, so the common online case never touches /pending_events.txt. Events are spilled to SD
+// (same pipe-delimited line as before, drained by trySyncPendingEvents()) when:
+//   - the uplink is down (no Wi-Fi, Supabase not configured, or repeated upload failures)
+//   - the queue reaches highWater
+//   - an event has waited in RAM longer than maxRamAgeMs
+//   - shutdown is signalled
+// EVQ_WRITE_THROUGH restores the old behaviour: every event goes to SD before anything else.
+//
+// No Arduino dependencies; tools/event_queue_sim.cpp drives the same policy on the host.
+
+enum EventDurability {
+  EVQ_RAM_FIRST = 0,      // RAM while online, SD only when needed (loses at most maxRamAgeMs of events on power cut)
+  EVQ_WRITE_THROUGH = 1,  // every event is appended to SD first (never loses an acknowledged event)
+};
+
+enum EventSpillReason {
+  EVQ_SPILL_NONE = 0,
+  EVQ_SPILL_POLICY,       // write-through mode
+  EVQ_SPILL_OFFLINE,
+  EVQ_SPILL_FULL,
+  EVQ_SPILL_AGE,
+  EVQ_SPILL_SHUTDOWN,
+};
+
+static const char *const EVQ_SPILL_NAMES[] = { "none", "policy", "offline", "full", "age", "shutdown" };
+
+struct PendingEvent {
+  char id[37];
+  char groupId[37];
+  char level[8];
+  int32_t durationSeconds;
+  int32_t decibel;
+  uint8_t buzzer;
+  uint8_t audio;
+  char audioPath[48];
+  uint64_t eventTsMs;   // epoch ms, 0 if the clock was not set
+  uint32_t queuedMs;    // millis() when queued, for latency
+  uint8_t zone;         // 0-based zone (zone_meter.h)
+};
+
+static inline void pendingEventCopy(char *dst, size_t n, const char *src) {
+  size_t len = src ? strlen(src) : 0;
+  if (len > n - 1) len = n - 1;
+  if (len) memcpy(dst, src, len);
+  dst[len] = '\0';
+}
+
+// Writes the /pending_events.txt line (no newline): 9 fields, plus the zone as a 10th for zones
+// other than the first. Returns its length.
+static inline int pendingEventFormat(const PendingEvent &e, char *buf, size_t n) {
+  int len = snprintf(buf, n, "%s|%s|%s|%ld|%ld|%d|%d|%s|%llu", e.id, e.groupId, e.level, (long)e.durationSeconds,
+                     (long)e.decibel, e.buzzer ? 1 : 0, e.audio ? 1 : 0, e.audioPath, (unsigned long long)e.eventTsMs);
+  if (e.zone != 0 && len > 0 && (size_t)len < n) len += snprintf(buf + len, n - (size_t)len, "|%d", (int)e.zone);
+  return len;
+}
+
+static inline void pendingFieldCopy(char *dst, size_t n, const char *src, size_t len) {
+  if (len > n - 1) len = n - 1;
+  if (len) memcpy(dst, src, len);
+  dst[len] = '\0';
+}
+
+// Parses a /pending_events.txt line without allocating:
+//   7 fields: id|level|dur|db|buz|audio|path (groupId = id)
+//   8 fields: id|groupId|level|dur|db|buz|audio|path
+//   9 fields: ...|eventTsMs
+//   10 fields: ...|zone
+// Returns false for a line with fewer than 7 fields. queuedMs is left at 0.
+static inline bool pendingEventParse(const char *line, PendingEvent &e) {
+  const char *f[10];
+  size_t len[10];
+  int n = 0;
+  const char *p = line;
+  while (n < 10) {
+    const char *sep = strchr(p, '|');
+    f[n] = p;
+    len[n] = sep ? (size_t)(sep - p) : strlen(p);
+    n++;
+    if (!sep) break;
+    p = sep + 1;
+  }
+  if (n < 7) return false;
+
+  const int o = (n == 7) ? 0 : 1;   // old lines have no groupId column
+  pendingFieldCopy(e.id, sizeof(e.id), f[0], len[0]);
+  pendingFieldCopy(e.groupId, sizeof(e.groupId), f[o], len[o]);
+  pendingFieldCopy(e.level, sizeof(e.level), f[1 + o], len[1 + o]);
+  e.durationSeconds = (int32_t)strtol(f[2 + o], nullptr, 10);
+  e.decibel = (int32_t)strtol(f[3 + o], nullptr, 10);
+  e.buzzer = (len[4 + o] == 1 && f[4 + o][0] == '1') ? 1 : 0;
+  e.audio = (len[5 + o] == 1 && f[5 + o][0] == '1') ? 1 : 0;
+  pendingFieldCopy(e.audioPath, sizeof(e.audioPath), f[6 + o], len[6 + o]);
+  e.eventTsMs = (n >= 9) ? (uint64_t)strtoull(f[8], nullptr, 10) : 0;
+  e.zone = (n >= 10) ? (uint8_t)strtoul(f[9], nullptr, 10) : 0;
+  e.queuedMs = 0;
+  return true;
+}
+
+struct EventLatencyStats {
+  uint32_t count = 0;
+  uint64_t sumMs = 0;
+  uint32_t maxMs = 0;
+
+  void note(uint32_t ms) {
+    count++;
+    sumMs += ms;
+    if (ms > maxMs) maxMs = ms;
+  }
+  uint32_t avgMs() const { return count ? (uint32_t)(sumMs / count) : 0; }
+};
+
+template <int N>
+struct EventQueue {
+  EventDurability mode = EVQ_RAM_FIRST;
+  uint32_t maxRamAgeMs = 60000;
+  int highWater = (N * 3) / 4;
+
+  PendingEvent items[N];   // FIFO, items[0] is the oldest
+  int count = 0;
+
+  // Stats.
+  uint32_t queuedRam = 0;
+  uint32_t queuedSd = 0;
+  uint32_t uploadedDirect = 0;
+  uint32_t spilled = 0;
+  uint32_t spillFailures = 0;
+  uint32_t sdBytes = 0;           // bytes appended to the pending file (either path)
+  uint32_t sdBytesSaved = 0;      // line bytes of events uploaded without touching SD
+  EventSpillReason lastSpill = EVQ_SPILL_NONE;
+  EventLatencyStats ramLatency;   // queue -> upload ack, RAM path
+  EventLatencyStats sdLatency;    // event time -> upload ack, SD path
+
+  // Where a new event should go right now: EVQ_SPILL_NONE means RAM.
+  EventSpillReason route(bool uplinkUp) const {
+    if (mode == EVQ_WRITE_THROUGH) return EVQ_SPILL_POLICY;
+    if (!uplinkUp) return EVQ_SPILL_OFFLINE;
+    if (count >= highWater) return EVQ_SPILL_FULL;
+    return EVQ_SPILL_NONE;
+  }
+
+  bool push(const PendingEvent &e) {
+    if (count >= N) return false;
+    items[count++] = e;
+    queuedRam++;
+    return true;
+  }
+
+  void remove(int i) {
+    if (i < 0 || i >= count) return;
+    for (int k = i + 1; k < count; k++) items[k - 1] = items[k];
+    count--;
+  }
+
+  // Reason the queued events should move to SD now, or EVQ_SPILL_NONE.
+  EventSpillReason spillDue(bool uplinkUp, uint32_t now) const {
+    if (count == 0) return EVQ_SPILL_NONE;
+    if (mode == EVQ_WRITE_THROUGH) return EVQ_SPILL_POLICY;
+    if (!uplinkUp) return EVQ_SPILL_OFFLINE;
+    if (count >= highWater) return EVQ_SPILL_FULL;
+    if (now - items[0].queuedMs >= maxRamAgeMs) return EVQ_SPILL_AGE;
+    return EVQ_SPILL_NONE;
+  }
+
+  // Moves queued events to SD through write(line, len), oldest first; stops at the first failure
+  // so nothing is dropped. Returns the number spilled.
+  template <typename WriteFn>
+  int spill(EventSpillReason why, WriteFn write) {
+    char line[200];
+    int n = 0;
+    while (count > 0) {
+      int len = pendingEventFormat(items[0], line, sizeof(line));
+      if (!write(line, len)) {
+        spillFailures++;
+        break;
+      }
+      sdBytes += (uint32_t)len + 1;
+      remove(0);
+      n++;
+    }
+    if (n > 0) {
+      spilled += (uint32_t)n;
+      lastSpill = why;
+    }
+    return n;
+  }
+
+  void noteUploaded(const PendingEvent &e, uint32_t now) {
+    char line[200];
+    uploadedDirect++;
+    sdBytesSaved += (uint32_t)pendingEventFormat(e, line, sizeof(line)) + 1;
+    ramLatency.note(now - e.queuedMs);
+  }
+};
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Admin file export: list the SD card and download files over HTTP without pulling the card.
+//
+// A download is planned from the request's Range, If-Range and If-None-Match headers
+// (fileExportPlan(): 200, 206 for one byte range, 304 or 416) and then streamed by FileExport,
+// one chunk at a time from a loop job: the HTTP handler only sends the headers. Each pump() reads
+// at most maxReadsPerPump chunks into the one caller-supplied buffer and hands them to a
+// non-blocking sink; what the socket does not take stays in the buffer for the next pump. So a
+// download never holds more than one chunk in RAM and never waits on the network inside the loop.
+//
+// The ETag is the file's size and modification time. Appending changes both, so a client that
+// resumes (Range plus If-Range) after the file grew gets the whole file again instead of a splice
+// of two versions. A download in progress keeps the length it started with. Every chunk is read by
+// opening the file afresh; a file that disappears or shrinks under a download (rotation,
+// roll-up, a recording evicted) ends it rather than sending bytes from another file.
+//
+// Fs and Sink are duck-typed:
+//   bool stat(const char *path, uint32_t &size, uint32_t &mtime)        false if missing
+//   int readAt(const char *path, uint32_t off, uint8_t *buf, int n)     bytes read, -1 if missing
+//   int write(const uint8_t *p, size_t n)   bytes taken, 0 if the socket is full, -1 once closed
+//   void close()
+// No Arduino dependencies; tools/file_export_sim.cpp runs it against a directory-backed SD shim.
+
+static const size_t FILE_EXPORT_CHUNK = 4096;
+static const int FILE_EXPORT_PATH_MAX = 64;
+
+// ---------- request planning ----------
+
+enum FileRangeKind : uint8_t {
+  FILE_RANGE_NONE = 0,         // no usable Range header: whole file
+  FILE_RANGE_OK,
+  FILE_RANGE_UNSATISFIABLE,    // 416
+};
+
+// One range of "bytes=a-b", "bytes=a-" or "bytes=-n". A list of ranges, another unit or anything
+// malformed is ignored (the whole file is a valid answer to those).
+static inline FileRangeKind fileParseRange(const char *h, uint32_t size, uint32_t &start, uint32_t &len) {
+  if (!h) return FILE_RANGE_NONE;
+  while (*h == ' ') h++;
+  if (strncmp(h, "bytes=", 6) != 0) return FILE_RANGE_NONE;
+  h += 6;
+  while (*h == ' ') h++;
+  if (strchr(h, ',')) return FILE_RANGE_NONE;
+
+  bool haveFirst = false, haveLast = false;
+  uint64_t first = 0, last = 0;
+  while (*h >= '0' && *h <= '9') {
+    first = first * 10 + (uint64_t)(*h++ - '0');
+    if (first > 0xFFFFFFFFull) return FILE_RANGE_NONE;
+    haveFirst = true;
+  }
+  if (*h++ != '-') return FILE_RANGE_NONE;
+  while (*h >= '0' && *h <= '9') {
+    last = last * 10 + (uint64_t)(*h++ - '0');
+    if (last > 0xFFFFFFFFull) last = 0xFFFFFFFFull;
+    haveLast = true;
+  }
+  while (*h == ' ') h++;
+  if (*h != '\0' || (!haveFirst && !haveLast)) return FILE_RANGE_NONE;
+
+  if (!haveFirst) {   // suffix: the last n bytes
+    if (last == 0 || size == 0) return FILE_RANGE_UNSATISFIABLE;
+    const uint32_t n = last < size ? (uint32_t)last : size;
+    start = size - n;
+    len = n;
+    return FILE_RANGE_OK;
+  }
+  if (haveLast && last < first) return FILE_RANGE_NONE;
+  if (first >= size) return FILE_RANGE_UNSATISFIABLE;
+  if (!haveLast || last >= size) last = size - 1;
+  start = (uint32_t)first;
+  len = (uint32_t)(last - first + 1);
+  return FILE_RANGE_OK;
+}
+
+// Quoted, so it can be compared with If-Range / If-None-Match as sent.
+static inline void fileEtag(uint32_t size, uint32_t mtime, char *out, size_t cap) {
+  snprintf(out, cap, "\"%lx-%lx\"", (unsigned long)size, (unsigned long)mtime);
+}
+
+// If-None-Match: "*" or a comma-separated list of ETags (W/ prefixes compare weakly, as allowed).
+static inline bool fileEtagListMatches(const char *list, const char *etag) {
+  if (!list) return false;
+  const size_t n = strlen(etag);
+  const char *p = list;
+  while (*p) {
+    while (*p == ' ' || *p == ',') p++;
+    if (*p == '*') return true;
+    if (p[0] == 'W' && p[1] == '/') p += 2;
+    if (strncmp(p, etag, n) == 0 && (p[n] == '\0' || p[n] == ',' || p[n] == ' ')) return true;
+    while (*p && *p != ',') p++;
+  }
+  return false;
+}
+
+struct FileExportPlan {
+  int status;          // 200, 206, 304 or 416
+  uint32_t start;
+  uint32_t len;        // body bytes (0 for 304/416)
+  char etag[24];
+};
+
+// If-Range only honours the Range when it is this file's (strong) ETag; a date or another ETag
+// gets the whole file.
+static inline FileExportPlan fileExportPlan(uint32_t size, uint32_t mtime, const char *range, const char *ifRange,
+                                            const char *ifNoneMatch) {
+  FileExportPlan p = {};
+  fileEtag(size, mtime, p.etag, sizeof(p.etag));
+  if (ifNoneMatch && *ifNoneMatch && fileEtagListMatches(ifNoneMatch, p.etag)) {
+    p.status = 304;
+    return p;
+  }
+  p.status = 200;
+  p.start = 0;
+  p.len = size;
+  if (ifRange && *ifRange && strcmp(ifRange, p.etag) != 0) return p;
+  uint32_t start = 0, len = 0;
+  switch (fileParseRange(range, size, start, len)) {
+    case FILE_RANGE_OK:
+      p.status = 206;
+      p.start = start;
+      p.len = len;
+      break;
+    case FILE_RANGE_UNSATISFIABLE:
+      p.status = 416;
+      p.len = 0;
+      break;
+    default:
+      break;
+  }
+  return p;
+}
+
+// Absolute, at most FILE_EXPORT_PATH_MAX - 1 characters, no "." or ".." components, no empty ones,
+// nothing that would need quoting in a Content-Disposition filename.
+static inline bool fileExportPathOk(const char *path) {
+  if (!path || path[0] != '/') return false;
+  const size_t n = strlen(path);
+  if (n < 2 || n >= (size_t)FILE_EXPORT_PATH_MAX) return false;
+  const char *seg = path + 1;
+  for (const char *p = path + 1;; p++) {
+    if (*p == '/' || *p == '\0') {
+      const size_t len = (size_t)(p - seg);
+      if (len == 0) return false;
+      if (seg[0] == '.' && (len == 1 || (len == 2 && seg[1] == '.'))) return false;
+      if (*p == '\0') return true;
+      seg = p + 1;
+    } else if (*p == '\\' || *p == '"' || (unsigned char)*p < 0x20) {
+      return false;
+    }
+  }
+}
+
+static inline const char *fileExportMime(const char *path) {
+  const char *dot = strrchr(path, '.');
+  if (!dot) return "application/octet-stream";
+  if (!strcmp(dot, ".wav")) return "audio/wav";
+  if (!strcmp(dot, ".txt") || !strcmp(dot, ".csv") || !strcmp(dot, ".log")) return "text/plain";
+  if (!strcmp(dot, ".json")) return "application/json";
+  return "application/octet-stream";
+}
+
+// ---------- streaming ----------
+
+enum FileExportStep : uint8_t {
+  FILE_EXPORT_SENT = 0,   // made progress; pump again soon
+  FILE_EXPORT_BLOCKED,    // the socket is full; pump again later
+  FILE_EXPORT_DONE,
+  FILE_EXPORT_FAILED,     // client gone or stalled, or the file went away or shrank
+};
+
+struct FileExportStats {
+  uint32_t exports = 0;       // downloads finished
+  uint32_t aborts = 0;
+  uint64_t bytes = 0;         // body bytes sent, finished or not
+  uint32_t reads = 0;         // chunk reads
+  uint32_t lastKBps = 0;      // last finished download of at least one chunk
+  uint32_t maxKBps = 0;
+  uint32_t lastBytes = 0;
+  uint32_t lastMs = 0;
+};
+
+template <class Fs, class Sink>
+struct FileExport {
+  Fs *fs = nullptr;
+  uint8_t *buf = nullptr;
+  size_t chunk = FILE_EXPORT_CHUNK;
+  int maxReadsPerPump = 1;
+  uint32_t idleTimeoutMs = 15000;   // no byte taken for this long: the client is gone
+
+  bool active = false;
+  Sink sink;
+  char path[FILE_EXPORT_PATH_MAX] = {};
+  uint32_t pos = 0;                 // next file offset to read
+  uint32_t end = 0;
+  size_t bufLen = 0;
+  size_t bufOff = 0;
+  uint32_t startMs = 0;
+  uint32_t lastProgressMs = 0;
+  uint32_t sent = 0;
+  FileExportStats stats;
+
+  // Streams len bytes of path from start into sink; the headers are already out.
+  bool begin(const char *p, uint32_t start, uint32_t len, const Sink &s, uint32_t now) {
+    if (active || !fs || !buf || chunk == 0 || strlen(p) >= sizeof(path)) return false;
+    snprintf(path, sizeof(path), "%s", p);
+    sink = s;
+    pos = start;
+    end = start + len;
+    bufLen = bufOff = 0;
+    sent = 0;
+    startMs = lastProgressMs = now;
+    active = true;
+    return true;
+  }
+
+  FileExportStep pump(uint32_t now) {
+    if (!active) return FILE_EXPORT_DONE;
+    int reads = 0;
+    bool progressed = false;
+    while (true) {
+      if (bufOff == bufLen) {
+        if (pos >= end) return finish(now, true);
+        if (reads >= maxReadsPerPump) return FILE_EXPORT_SENT;
+        const uint32_t want = (end - pos) < chunk ? (end - pos) : (uint32_t)chunk;
+        const int got = fs->readAt(path, pos, buf, (int)want);
+        reads++;
+        stats.reads++;
+        if (got != (int)want) return finish(now, false);
+        pos += want;
+        bufLen = want;
+        bufOff = 0;
+      }
+      const int w = sink.write(buf + bufOff, bufLen - bufOff);
+      if (w < 0) return finish(now, false);
+      if (w == 0) {
+        if (now - lastProgressMs >= idleTimeoutMs) return finish(now, false);
+        return progressed ? FILE_EXPORT_SENT : FILE_EXPORT_BLOCKED;
+      }
+      bufOff += (size_t)w;
+      sent += (uint32_t)w;
+      stats.bytes += (uint32_t)w;
+      lastProgressMs = now;
+      progressed = true;
+    }
+  }
+
+  void abort(uint32_t now) {
+    if (active) finish(now, false);
+  }
+
+ private:
+  FileExportStep finish(uint32_t now, bool ok) {
+    sink.close();
+    active = false;
+    if (!ok) {
+      stats.aborts++;
+      return FILE_EXPORT_FAILED;
+    }
+    stats.exports++;
+    stats.lastBytes = sent;
+    stats.lastMs = now - startMs;
+    if (sent >= chunk) {
+      stats.lastKBps = (uint32_t)((uint64_t)sent * 1000 / 1024 / (stats.lastMs ? stats.lastMs : 1));
+      if (stats.lastKBps > stats.maxKBps) stats.maxKBps = stats.lastKBps;
+    }
+    return FILE_EXPORT_DONE;
+  }
+};
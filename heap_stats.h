@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+
+// Heap instrumentation for multi-week uptimes.
+//
+// - Allocator hooks: noteAlloc()/noteFree()/noteFailed(). The firmware wires them to ESP-IDF's
+//   esp_heap_trace_alloc_hook/free_hook (cores built with CONFIG_HEAP_USE_HOOKS) and the failed-alloc
+//   callback; tools/heap_soak.cpp wires them to malloc on the host. Counters for the loop task are
+//   kept apart from the all-task ones, since Wi-Fi and lwIP allocate on other tasks all the time.
+// - Snapshot: free bytes, bytes in use, largest free block and the low-water marks, filled by the
+//   caller (heap_caps_get_info() on the device).
+// - Frames: beginFrame()/endFrame() bracket the sampling + logging path. markEvent() flags a frame
+//   in which event-driven work ran (warning, upload, SD flush); any loop-task allocation in an
+//   unflagged frame is a steady-state allocation, which should stay at zero.
+// No Arduino dependencies.
+
+#define HEAP_STATS_INLINE inline __attribute__((always_inline))
+
+struct HeapStats {
+  bool hooked = false;            // allocation counts are live (hooks installed)
+
+  // All tasks (relaxed atomics: hooks run on both cores).
+  uint32_t allocs = 0;
+  uint32_t frees = 0;
+  uint32_t failed = 0;
+  uint32_t largestFailed = 0;
+
+  // Loop task only.
+  uint32_t loopAllocs = 0;
+  uint32_t loopFrees = 0;
+  uint64_t loopAllocBytes = 0;
+
+  // Snapshot.
+  uint32_t freeBytes = 0;
+  uint32_t usedBytes = 0;
+  uint32_t largestFree = 0;
+  uint32_t minFree = 0;           // allocator's own low-water mark
+  uint32_t minLargestFree = 0;    // smallest largest-free-block seen; what TLS handshakes care about
+  uint32_t usedBlocks = 0;
+  uint32_t snapshots = 0;
+
+  // Frames.
+  uint32_t frames = 0;
+  uint32_t eventFrames = 0;
+  uint32_t steadyAllocFrames = 0;
+  uint32_t steadyAllocs = 0;
+  uint32_t frameMark = 0;
+  bool frameEvent = false;
+
+  HEAP_STATS_INLINE void noteAlloc(uint32_t size, bool loopTask) {
+    __atomic_add_fetch(&allocs, 1u, __ATOMIC_RELAXED);
+    if (loopTask) {
+      loopAllocs++;
+      loopAllocBytes += size;
+    }
+  }
+
+  HEAP_STATS_INLINE void noteFree(bool loopTask) {
+    __atomic_add_fetch(&frees, 1u, __ATOMIC_RELAXED);
+    if (loopTask) loopFrees++;
+  }
+
+  HEAP_STATS_INLINE void noteFailed(uint32_t size) {
+    __atomic_add_fetch(&failed, 1u, __ATOMIC_RELAXED);
+    if (size > largestFailed) largestFailed = size;
+  }
+
+  void snapshot(uint32_t freeNow, uint32_t usedNow, uint32_t largestNow, uint32_t minFreeNow, uint32_t blocksNow) {
+    freeBytes = freeNow;
+    usedBytes = usedNow;
+    largestFree = largestNow;
+    minFree = minFreeNow;
+    usedBlocks = blocksNow;
+    if (snapshots == 0 || largestNow < minLargestFree) minLargestFree = largestNow;
+    snapshots++;
+  }
+
+  // Share of free memory not usable as one block: 0 = one contiguous region.
+  uint32_t fragPct() const {
+    if (freeBytes == 0) return 0;
+    return 100u - (uint32_t)(((uint64_t)largestFree * 100u) / freeBytes);
+  }
+
+  void beginFrame() {
+    frameMark = loopAllocs;
+    frameEvent = false;
+  }
+
+  void markEvent() { frameEvent = true; }
+
+  // Returns the loop-task allocations made since beginFrame().
+  uint32_t endFrame() {
+    uint32_t n = loopAllocs - frameMark;
+    frames++;
+    if (frameEvent) {
+      eventFrames++;
+    } else if (n > 0) {
+      steadyAllocFrames++;
+      steadyAllocs += n;
+    }
+    return n;
+  }
+};
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Live levels for in-building displays: one small UDP multicast datagram per device per frame
+// (or per LiveFeedPacer::intervalMs), so a hallway screen can show every classroom without
+// polling each device's /monitor.
+//
+// Datagram, little-endian, 18 + 3 * zones + idLen bytes (35 for a one-zone "esp32_noise_01"):
+//   0   'N' 'L'      magic
+//   2   u8  version  LIVE_FEED_VERSION
+//   3   u8  idLen    device id bytes at the end, no terminator (1..LIVE_FEED_MAX_ID)
+//   4   u32 seq      +1 per datagram, from 0 at boot
+//   8   u64 tsMs     epoch ms, or ms since boot when LIVE_FLAG_UPTIME is set (clock not synced)
+//   16  u8  zones    1..LIVE_FEED_MAX_ZONES
+//   17  u8  flags
+//   18  per zone: i16 db10 (smoothed dB x 10), u8 led (LedState: 0 green, 1 yellow, 2 red)
+//   ..  device id
+// Zone z of device "x" is the same classroom as the cloud rows of zoneDeviceId(z).
+//
+// Nothing is acknowledged or retried: a lost datagram is superseded by the next frame's.
+// LiveFeedTable is the receiving end: the latest levels per device plus per-device loss,
+// late/duplicate and reboot counts from the sequence numbers.
+// No Arduino dependencies; tools/live_feed_rx.h wraps the table in a multicast socket and
+// tools/live_feed_bench.cpp loads it with simulated senders over loopback.
+
+static const uint8_t LIVE_FEED_VERSION = 1;
+static const uint16_t LIVE_FEED_PORT = 5600;
+static const uint8_t LIVE_FEED_GROUP[4] = { 239, 255, 60, 60 };   // organisation-local scope
+static const int LIVE_FEED_MAX_ID = 32;
+static const int LIVE_FEED_MAX_ZONES = 2;
+static const size_t LIVE_FEED_HEADER_BYTES = 18;
+static const size_t LIVE_FEED_MAX_BYTES = LIVE_FEED_HEADER_BYTES + 3 * LIVE_FEED_MAX_ZONES + LIVE_FEED_MAX_ID;
+
+enum LiveFeedFlags : uint8_t {
+  LIVE_FLAG_UPTIME = 0x01,   // tsMs is ms since boot
+  LIVE_FLAG_QUIET = 0x02,    // device is in its slow-frame power mode
+};
+
+struct LiveFeedFrame {
+  char id[LIVE_FEED_MAX_ID + 1];
+  uint32_t seq = 0;
+  uint64_t tsMs = 0;
+  uint8_t zones = 1;
+  uint8_t flags = 0;
+  int16_t db10[LIVE_FEED_MAX_ZONES];
+  uint8_t led[LIVE_FEED_MAX_ZONES];
+};
+
+// Returns the datagram length, or 0 if the frame does not fit the format.
+static inline size_t liveFeedEncode(uint8_t *out, size_t cap, const LiveFeedFrame &f) {
+  const size_t idLen = strnlen(f.id, LIVE_FEED_MAX_ID + 1);
+  if (idLen == 0 || idLen > (size_t)LIVE_FEED_MAX_ID || f.zones == 0 || f.zones > LIVE_FEED_MAX_ZONES) return 0;
+  const size_t n = LIVE_FEED_HEADER_BYTES + 3 * (size_t)f.zones + idLen;
+  if (n > cap) return 0;
+  out[0] = 'N';
+  out[1] = 'L';
+  out[2] = LIVE_FEED_VERSION;
+  out[3] = (uint8_t)idLen;
+  for (int i = 0; i < 4; i++) out[4 + i] = (uint8_t)(f.seq >> (8 * i));
+  for (int i = 0; i < 8; i++) out[8 + i] = (uint8_t)(f.tsMs >> (8 * i));
+  out[16] = f.zones;
+  out[17] = f.flags;
+  uint8_t *p = out + LIVE_FEED_HEADER_BYTES;
+  for (int z = 0; z < f.zones; z++) {
+    const uint16_t d = (uint16_t)f.db10[z];
+    *p++ = (uint8_t)d;
+    *p++ = (uint8_t)(d >> 8);
+    *p++ = f.led[z];
+  }
+  memcpy(p, f.id, idLen);
+  return n;
+}
+
+// Rejects anything that is not exactly one well-formed datagram of this version.
+static inline bool liveFeedDecode(const uint8_t *p, size_t n, LiveFeedFrame &f) {
+  if (n < LIVE_FEED_HEADER_BYTES || p[0] != 'N' || p[1] != 'L' || p[2] != LIVE_FEED_VERSION) return false;
+  const size_t idLen = p[3];
+  const uint8_t zones = p[16];
+  if (idLen == 0 || idLen > (size_t)LIVE_FEED_MAX_ID || zones == 0 || zones > LIVE_FEED_MAX_ZONES) return false;
+  if (n != LIVE_FEED_HEADER_BYTES + 3 * (size_t)zones + idLen) return false;
+  f.seq = 0;
+  for (int i = 0; i < 4; i++) f.seq |= (uint32_t)p[4 + i] << (8 * i);
+  f.tsMs = 0;
+  for (int i = 0; i < 8; i++) f.tsMs |= (uint64_t)p[8 + i] << (8 * i);
+  f.zones = zones;
+  f.flags = p[17];
+  const uint8_t *q = p + LIVE_FEED_HEADER_BYTES;
+  for (int z = 0; z < zones; z++) {
+    f.db10[z] = (int16_t)(uint16_t)(q[0] | (q[1] << 8));
+    f.led[z] = q[2];
+    q += 3;
+  }
+  memcpy(f.id, q, idLen);
+  f.id[idLen] = '\0';
+  return true;
+}
+
+// Sender side: every frame when intervalMs is 0, otherwise once per intervalMs; a zone's LED
+// changing always goes out on the frame it changes, so displays switch colour with the device.
+struct LiveFeedPacer {
+  uint32_t intervalMs = 0;
+  uint32_t lastSendMs = 0;
+  bool primed = false;
+  uint8_t lastLed[LIVE_FEED_MAX_ZONES];
+
+  bool due(uint32_t now, const uint8_t *led, int zones) {
+    bool changed = !primed;
+    for (int z = 0; z < zones && z < LIVE_FEED_MAX_ZONES; z++) {
+      if (led[z] != lastLed[z]) changed = true;
+    }
+    if (!changed && intervalMs > 0 && now - lastSendMs < intervalMs) return false;
+    for (int z = 0; z < zones && z < LIVE_FEED_MAX_ZONES; z++) lastLed[z] = led[z];
+    lastSendMs = now;
+    primed = true;
+    return true;
+  }
+};
+
+// Late or duplicate datagrams within this many sequence numbers of the newest are counted and
+// dropped; anything further back is taken as the device having rebooted.
+static const uint32_t LIVE_FEED_REORDER_WINDOW = 64;
+
+struct LiveFeedDevice {
+  char id[LIVE_FEED_MAX_ID + 1];
+  uint32_t hash = 0;
+  bool used = false;
+  uint8_t zones = 0;
+  uint8_t flags = 0;
+  int16_t db10[LIVE_FEED_MAX_ZONES];
+  uint8_t led[LIVE_FEED_MAX_ZONES];
+  uint32_t seq = 0;
+  uint64_t tsMs = 0;
+  uint32_t lastRxMs = 0;     // receiver clock
+  uint32_t received = 0;
+  uint32_t lost = 0;         // sequence gaps not (yet) filled by a late datagram
+  uint32_t late = 0;         // late or duplicate, not applied
+  uint32_t restarts = 0;     // sequence went back: device rebooted
+};
+
+// Open-addressed by a hash of the device id, CAP a power of two. Devices are never evicted (a
+// display wants to show a silent classroom as offline, not forget it); when the table is full,
+// datagrams from new devices are counted in `dropped`.
+template <int CAP>
+struct LiveFeedTable {
+  static_assert(CAP > 0 && (CAP & (CAP - 1)) == 0, "CAP must be a power of two");
+
+  LiveFeedDevice dev[CAP];
+  int count = 0;
+  uint32_t dropped = 0;
+  uint32_t staleMs = 5000;   // silence after which the next datagram re-syncs instead of counting a gap
+
+  static uint32_t hashId(const char *id) {
+    uint32_t h = 2166136261u;
+    for (; *id; id++) h = (h ^ (uint8_t)*id) * 16777619u;
+    return h;
+  }
+
+  LiveFeedDevice *find(const char *id) {
+    const uint32_t h = hashId(id);
+    for (int i = 0; i < CAP; i++) {
+      LiveFeedDevice &d = dev[(h + i) & (CAP - 1)];
+      if (!d.used) return nullptr;
+      if (d.hash == h && !strcmp(d.id, id)) return &d;
+    }
+    return nullptr;
+  }
+
+  bool online(const LiveFeedDevice &d, uint32_t nowMs) const { return d.used && nowMs - d.lastRxMs <= staleMs; }
+
+  // Applies one decoded datagram; returns its device, or nullptr if the table is full.
+  LiveFeedDevice *update(const LiveFeedFrame &f, uint32_t nowMs) {
+    const uint32_t h = hashId(f.id);
+    LiveFeedDevice *d = nullptr;
+    for (int i = 0; i < CAP; i++) {
+      LiveFeedDevice &e = dev[(h + i) & (CAP - 1)];
+      if (!e.used) {
+        if (count >= CAP - 1) break;   // keep one hole so lookups of unknown ids terminate
+        memcpy(e.id, f.id, sizeof(e.id));
+        e.hash = h;
+        e.used = true;
+        count++;
+        apply(e, f, nowMs);
+        return &e;
+      }
+      if (e.hash == h && !strcmp(e.id, f.id)) {
+        d = &e;
+        break;
+      }
+    }
+    if (!d) {
+      dropped++;
+      return nullptr;
+    }
+    const int32_t gap = (int32_t)(f.seq - d->seq);
+    const bool stale = nowMs - d->lastRxMs > staleMs;
+    if (!stale && gap > 0) {
+      d->lost += (uint32_t)gap - 1;
+    } else if (!stale && 0u - (uint32_t)gap < LIVE_FEED_REORDER_WINDOW) {
+      d->late++;
+      if (gap < 0 && d->lost > 0) d->lost--;
+      return d;
+    } else if (gap <= 0) {
+      d->restarts++;
+    }
+    apply(*d, f, nowMs);
+    return d;
+  }
+
+ private:
+  static void apply(LiveFeedDevice &d, const LiveFeedFrame &f, uint32_t nowMs) {
+    d.zones = f.zones;
+    d.flags = f.flags;
+    for (int z = 0; z < f.zones; z++) {
+      d.db10[z] = f.db10[z];
+      d.led[z] = f.led[z];
+    }
+    d.seq = f.seq;
+    d.tsMs = f.tsMs;
+    d.lastRxMs = nowMs;
+    d.received++;
+  }
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Fixed-memory loop instrumentation: per-stage latency histograms plus a few counters,
+// rendered as Prometheus text at /metrics. Timing itself (cycle counter) lives in the sketch;
+// this header only stores and formats, so it builds on the host too.
+
+enum LoopStage {
+  STAGE_MIC_READ = 0,
+  STAGE_DSP,
+  STAGE_CLASSIFY,
+  STAGE_LED,
+  STAGE_WARNINGS,
+  STAGE_SD_APPEND,
+  STAGE_SYNC,
+  STAGE_HTTP,
+  STAGE_LOOP,        // whole loop() pass, excluding the trailing frame delay
+  STAGE_COUNT
+};
+
+static const char *const LOOP_STAGE_NAMES[STAGE_COUNT] = {
+  "mic_read", "dsp", "classify", "led", "warnings", "sd_append", "sync", "handle_client", "loop"
+};
+
+// Log-linear histogram in microseconds: 4 linear sub-buckets per power of two,
+// from 16 us up to 2^25 us (~33 s), plus underflow and overflow buckets.
+struct LatencyHistogram {
+  static const int MIN_OCTAVE = 4;
+  static const int MAX_OCTAVE = 24;
+  static const int SUB_BITS = 2;
+  static const int SUBS = 1 << SUB_BITS;
+  static const int OCTAVES = MAX_OCTAVE - MIN_OCTAVE + 1;
+  static const int BUCKETS = 1 + OCTAVES * SUBS + 1;
+
+  uint32_t counts[BUCKETS] = {};
+  uint32_t count = 0;
+  uint64_t sumUs = 0;
+  uint32_t maxUs = 0;
+
+  static int octaveOf(uint32_t v) {
+    return 31 - __builtin_clz(v);
+  }
+
+  static int bucketOf(uint32_t us) {
+    if (us < (1u << MIN_OCTAVE)) return 0;
+    int k = octaveOf(us);
+    if (k > MAX_OCTAVE) return BUCKETS - 1;
+    int sub = (int)((us >> (k - SUB_BITS)) & (SUBS - 1));
+    return 1 + (k - MIN_OCTAVE) * SUBS + sub;
+  }
+
+  void record(uint32_t us) {
+    counts[bucketOf(us)]++;
+    count++;
+    sumUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+
+  // Upper bound (us) of the bucket holding the p-th quantile, p in [0,1].
+  uint32_t quantileUs(float p) const {
+    if (count == 0) return 0;
+    uint32_t target = (uint32_t)(p * (float)count);
+    if (target >= count) target = count - 1;
+    uint32_t acc = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+      acc += counts[i];
+      if (acc > target) {
+        if (i == 0) return 1u << MIN_OCTAVE;
+        if (i == BUCKETS - 1) return maxUs;
+        int k = MIN_OCTAVE + (i - 1) / SUBS;
+        int sub = (i - 1) % SUBS;
+        return (1u << k) + (uint32_t)(sub + 1) * (1u << (k - SUB_BITS));
+      }
+    }
+    return maxUs;
+  }
+};
+
+struct LoopMetrics {
+  LatencyHistogram stages[STAGE_COUNT];
+
+  uint32_t frames = 0;            // mic frames processed
+  uint32_t frameDrops = 0;        // i2s_read returned no data
+  uint32_t http2xx = 0;
+  uint32_t http4xx = 0;
+  uint32_t http5xx = 0;
+  uint32_t httpOther = 0;         // 1xx/3xx
+  uint32_t httpTransportErr = 0;  // negative codes: connect/TLS/timeout
+  uint32_t sdErrors = 0;
+
+  // Overhead is converted from cycles at the clock it ran at, so the ratio holds across the
+  // 240/80 MHz switches of the power policy.
+  uint64_t overheadNs = 0;        // time spent inside the profiler itself
+  uint64_t loopBusyUs = 0;        // sum of STAGE_LOOP samples
+  bool overBudget = false;        // latched once the ratio exceeds OVERHEAD_BUDGET
+
+  static constexpr float OVERHEAD_BUDGET = 0.01f;
+  static const uint64_t OVERHEAD_MIN_LOOP_US = 10000000ULL;   // judge only after 10 s of loop time
+
+  void noteHttp(int code) {
+    if (code < 0) httpTransportErr++;
+    else if (code >= 200 && code < 300) http2xx++;
+    else if (code >= 400 && code < 500) http4xx++;
+    else if (code >= 500) http5xx++;
+    else httpOther++;
+  }
+
+  float overheadRatio() const {
+    return loopBusyUs ? (float)overheadNs / 1000.0f / (float)loopBusyUs : 0.0f;
+  }
+
+  // True once, the first time the profiler costs more than OVERHEAD_BUDGET of the loop.
+  bool checkOverheadBudget() {
+    if (overBudget || loopBusyUs < OVERHEAD_MIN_LOOP_US || overheadRatio() <= OVERHEAD_BUDGET) return false;
+    overBudget = true;
+    return true;
+  }
+
+  // Emits Prometheus text exposition, one line per emit() call.
+  template <typename Emit>
+  void writePrometheus(const char *deviceId, Emit emit) const {
+    char line[160];
+    emit("# HELP noise_loop_stage_seconds Latency of each loop() stage.\n");
+    emit("# TYPE noise_loop_stage_seconds histogram\n");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+      const LatencyHistogram &h = stages[s];
+      uint32_t acc = h.counts[0];
+      snprintf(line, sizeof(line), "noise_loop_stage_seconds_bucket{device=\"%s\",stage=\"%s\",le=\"%.6f\"} %lu\n",
+               deviceId, LOOP_STAGE_NAMES[s], (double)(1u << LatencyHistogram::MIN_OCTAVE) / 1e6, (unsigned long)acc);
+      emit(line);
+      for (int o = 0; o < LatencyHistogram::OCTAVES; o++) {
+        for (int k = 0; k < LatencyHistogram::SUBS; k++) acc += h.counts[1 + o * LatencyHistogram::SUBS + k];
+        double le = (double)(1u << (LatencyHistogram::MIN_OCTAVE + o + 1)) / 1e6;
+        snprintf(line, sizeof(line), "noise_loop_stage_seconds_bucket{device=\"%s\",stage=\"%s\",le=\"%.6f\"} %lu\n",
+                 deviceId, LOOP_STAGE_NAMES[s], le, (unsigned long)acc);
+        emit(line);
+      }
+      snprintf(line, sizeof(line), "noise_loop_stage_seconds_bucket{device=\"%s\",stage=\"%s\",le=\"+Inf\"} %lu\n",
+               deviceId, LOOP_STAGE_NAMES[s], (unsigned long)h.count);
+      emit(line);
+      snprintf(line, sizeof(line), "noise_loop_stage_seconds_sum{device=\"%s\",stage=\"%s\"} %.6f\n",
+               deviceId, LOOP_STAGE_NAMES[s], (double)h.sumUs / 1e6);
+      emit(line);
+      snprintf(line, sizeof(line), "noise_loop_stage_seconds_count{device=\"%s\",stage=\"%s\"} %lu\n",
+               deviceId, LOOP_STAGE_NAMES[s], (unsigned long)h.count);
+      emit(line);
+    }
+
+    emit("# TYPE noise_loop_stage_max_seconds gauge\n");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+      snprintf(line, sizeof(line), "noise_loop_stage_max_seconds{device=\"%s\",stage=\"%s\"} %.6f\n",
+               deviceId, LOOP_STAGE_NAMES[s], (double)stages[s].maxUs / 1e6);
+      emit(line);
+    }
+
+    emit("# TYPE noise_frames_total counter\n");
+    snprintf(line, sizeof(line), "noise_frames_total{device=\"%s\"} %lu\n", deviceId, (unsigned long)frames);
+    emit(line);
+    emit("# TYPE noise_frame_drops_total counter\n");
+    snprintf(line, sizeof(line), "noise_frame_drops_total{device=\"%s\"} %lu\n", deviceId, (unsigned long)frameDrops);
+    emit(line);
+
+    emit("# TYPE noise_http_responses_total counter\n");
+    const char *classes[5] = { "2xx", "4xx", "5xx", "other", "transport_error" };
+    const uint32_t vals[5] = { http2xx, http4xx, http5xx, httpOther, httpTransportErr };
+    for (int i = 0; i < 5; i++) {
+      snprintf(line, sizeof(line), "noise_http_responses_total{device=\"%s\",code=\"%s\"} %lu\n",
+               deviceId, classes[i], (unsigned long)vals[i]);
+      emit(line);
+    }
+
+    emit("# TYPE noise_sd_errors_total counter\n");
+    snprintf(line, sizeof(line), "noise_sd_errors_total{device=\"%s\"} %lu\n", deviceId, (unsigned long)sdErrors);
+    emit(line);
+
+    emit("# TYPE noise_profiler_overhead_ratio gauge\n");
+    snprintf(line, sizeof(line), "noise_profiler_overhead_ratio{device=\"%s\"} %.6f\n", deviceId, (double)overheadRatio());
+    emit(line);
+    emit("# TYPE noise_profiler_over_budget gauge\n");
+    snprintf(line, sizeof(line), "noise_profiler_over_budget{device=\"%s\"} %d\n", deviceId, overBudget ? 1 : 0);
+    emit(line);
+  }
+};
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Tickless cooperative scheduler for the periodic work in loop().
+//
+// Jobs sit in a three-level hierarchical timer wheel with 1 ms ticks and 64 slots per level
+// (64 ms, 4.1 s and 4.4 min spans; later deadlines park in the top level and are re-filed when
+// it cascades). Arming a job is O(1). Advancing the clock touches one level-0 slot per elapsed ms
+// plus one higher-level slot every 64 ms, independent of how many jobs exist.
+// - run(now) expires every job whose deadline has passed and runs them in priority order
+//   (0 = most urgent, ties by deadline). Once passBudgetUs is spent the remaining ready jobs wait
+//   for the next pass and count as deferred; the first job of a pass always runs.
+// - A job returns the delay to its next run, counted from its deadline so periodic jobs do not
+//   drift. A job that has fallen whole periods behind skips the missed runs (keeping its phase)
+//   instead of bursting to catch up. LOOP_JOB_STOP disarms it until kick()/armAt().
+// - slackMs is how late a job may run (timer coalescing, like Linux timer slack): it still runs on
+//   the first pass after its deadline, but only wakes the loop by itself at deadline + slack, so
+//   imprecise jobs ride along on an audio frame or another job's wakeup.
+// - msUntilNext(now) is the exact time to the earliest such wakeup, so the caller can sleep until
+//   then instead of polling.
+// - Per job: runs, overruns (a run longer than budgetUs), skipped periods, deferrals, worst and
+//   total lateness (deadline to start) and worst run time.
+// No Arduino dependencies: the caller supplies a microsecond clock; tools/sched_sim.cpp drives
+// the wheel from a virtual clock.
+
+static const uint32_t LOOP_JOB_STOP = 0xFFFFFFFFu;
+static const uint32_t LOOP_SCHED_IDLE = 0xFFFFFFFFu;   // msUntilNext() with nothing armed
+
+typedef uint32_t (*LoopJobFn)(void *ctx, uint32_t now);
+
+struct LoopJob {
+  const char *name = "";
+  LoopJobFn fn = nullptr;
+  void *ctx = nullptr;
+  uint8_t prio = 0;
+  uint32_t budgetUs = 0;     // 0 = no per-run budget
+  uint32_t slackMs = 0;      // may run this much late to share another wakeup
+
+  // ---- state ----
+  uint32_t due = 0;
+  bool armed = false;
+  bool ready = false;
+  int16_t slot = -1;         // level * 64 + index while filed in the wheel
+  int8_t prev = -1;
+  int8_t next = -1;
+
+  // ---- stats ----
+  uint32_t runs = 0;
+  uint32_t overruns = 0;
+  uint32_t skipped = 0;
+  uint32_t deferred = 0;
+  uint32_t lateMaxMs = 0;
+  uint64_t lateSumMs = 0;
+  uint32_t runMaxUs = 0;
+  uint64_t runSumUs = 0;
+};
+
+template <int MaxJobs = 16>
+struct LoopScheduler {
+  static const int SLOT_BITS = 6;
+  static const int SLOTS = 1 << SLOT_BITS;
+  static const int LEVELS = 3;
+  static const uint32_t SPAN = 1u << (SLOT_BITS * LEVELS);
+
+  uint32_t (*clockUs)() = nullptr;
+  void (*spanHook)(const char *name, bool begin) = nullptr;   // around every job run (stall tracer)
+  uint32_t passBudgetUs = 0;   // 0 = run every ready job each pass
+
+  LoopJob jobs[MaxJobs];
+  int count = 0;
+  int8_t heads[LEVELS * SLOTS];
+  uint32_t curTick = 0;        // last ms the wheel has processed
+  bool started = false;
+
+  // ---- stats ----
+  uint32_t passes = 0;
+  uint32_t passesDeferred = 0;
+  uint32_t cascades = 0;
+  uint32_t sleeps = 0;
+  uint64_t sleptMs = 0;
+
+  LoopScheduler() {
+    for (int i = 0; i < LEVELS * SLOTS; i++) heads[i] = -1;
+  }
+
+  // Returns the job id, or -1 when full. The job first runs firstInMs after now.
+  int add(const char *name, LoopJobFn fn, void *ctx, uint8_t prio, uint32_t budgetUs, uint32_t slackMs, uint32_t now,
+          uint32_t firstInMs) {
+    if (count >= MaxJobs) return -1;
+    int id = count++;
+    LoopJob &j = jobs[id];
+    j.name = name;
+    j.fn = fn;
+    j.ctx = ctx;
+    j.prio = prio;
+    j.budgetUs = budgetUs;
+    j.slackMs = slackMs;
+    if (!started) {
+      curTick = now;
+      started = true;
+    }
+    armAt(id, now + firstInMs);
+    return id;
+  }
+
+  // (Re)arms a job for an absolute deadline; a deadline in the past makes it ready now.
+  void armAt(int id, uint32_t due) {
+    if (id < 0 || id >= count) return;
+    LoopJob &j = jobs[id];
+    unlink(id);
+    j.ready = false;
+    j.armed = true;
+    j.due = due;
+    file(id);
+  }
+
+  // Runs the job on the next pass, e.g. when it has new work ahead of its period.
+  void kick(int id, uint32_t now) {
+    if (id < 0 || id >= count) return;
+    if (jobs[id].armed && (int32_t)(jobs[id].due - now) <= 0) return;
+    armAt(id, now);
+  }
+
+  void setSlack(int id, uint32_t ms) {
+    if (id >= 0 && id < count) jobs[id].slackMs = ms;
+  }
+
+  void disarm(int id) {
+    if (id < 0 || id >= count) return;
+    unlink(id);
+    jobs[id].ready = false;
+    jobs[id].armed = false;
+  }
+
+  void run(uint32_t now) {
+    advance(now);
+    passes++;
+    uint32_t t0 = clockUs ? clockUs() : 0;
+    bool first = true;
+    for (;;) {
+      int best = -1;
+      for (int i = 0; i < count; i++) {
+        if (!jobs[i].ready) continue;
+        if (best < 0 || jobs[i].prio < jobs[best].prio ||
+            (jobs[i].prio == jobs[best].prio && (int32_t)(jobs[i].due - jobs[best].due) < 0)) {
+          best = i;
+        }
+      }
+      if (best < 0) return;
+      uint32_t spentUs = clockUs ? clockUs() - t0 : 0;
+      if (!first && passBudgetUs && spentUs >= passBudgetUs) {
+        for (int i = 0; i < count; i++) {
+          if (jobs[i].ready) jobs[i].deferred++;
+        }
+        passesDeferred++;
+        return;
+      }
+      first = false;
+      runJob(best, now + spentUs / 1000);
+    }
+  }
+
+  // Milliseconds from now to the earliest wakeup (deadline + slack): 0 when a job is ready,
+  // LOOP_SCHED_IDLE when nothing is armed. A scan of the job table rather than the slots, since
+  // slack reorders deadlines and a parked top-level job would hide earlier ones behind it.
+  uint32_t msUntilNext(uint32_t now) const {
+    bool found = false;
+    uint32_t best = 0;
+    for (int i = 0; i < count; i++) {
+      const LoopJob &j = jobs[i];
+      if (j.ready) return 0;
+      if (!j.armed) continue;
+      const uint32_t wake = j.due + j.slackMs;
+      if (!found || (int32_t)(wake - best) < 0) best = wake;
+      found = true;
+    }
+    if (!found) return LOOP_SCHED_IDLE;
+    int32_t d = (int32_t)(best - now);
+    return d > 0 ? (uint32_t)d : 0;
+  }
+
+  // The caller reports each sleep it takes, for the wakeup and idle-time counters.
+  void noteSleep(uint32_t ms) {
+    sleeps++;
+    sleptMs += ms;
+  }
+
+  // Emits Prometheus text exposition, one line per emit() call.
+  template <typename Emit>
+  void writePrometheus(const char *deviceId, Emit emit) const {
+    char line[160];
+    emit("# TYPE noise_job_runs_total counter\n");
+    for (int i = 0; i < count; i++) {
+      snprintf(line, sizeof(line), "noise_job_runs_total{device=\"%s\",job=\"%s\"} %lu\n", deviceId, jobs[i].name,
+               (unsigned long)jobs[i].runs);
+      emit(line);
+    }
+    emit("# TYPE noise_job_overruns_total counter\n");
+    for (int i = 0; i < count; i++) {
+      snprintf(line, sizeof(line), "noise_job_overruns_total{device=\"%s\",job=\"%s\"} %lu\n", deviceId, jobs[i].name,
+               (unsigned long)jobs[i].overruns);
+      emit(line);
+    }
+    emit("# TYPE noise_job_skipped_total counter\n");
+    for (int i = 0; i < count; i++) {
+      snprintf(line, sizeof(line), "noise_job_skipped_total{device=\"%s\",job=\"%s\"} %lu\n", deviceId, jobs[i].name,
+               (unsigned long)jobs[i].skipped);
+      emit(line);
+    }
+    emit("# TYPE noise_job_deferred_total counter\n");
+    for (int i = 0; i < count; i++) {
+      snprintf(line, sizeof(line), "noise_job_deferred_total{device=\"%s\",job=\"%s\"} %lu\n", deviceId, jobs[i].name,
+               (unsigned long)jobs[i].deferred);
+      emit(line);
+    }
+    emit("# TYPE noise_job_lateness_seconds_sum counter\n");
+    for (int i = 0; i < count; i++) {
+      snprintf(line, sizeof(line), "noise_job_lateness_seconds_sum{device=\"%s\",job=\"%s\"} %.3f\n", deviceId,
+               jobs[i].name, (double)jobs[i].lateSumMs / 1e3);
+      emit(line);
+    }
+    emit("# TYPE noise_job_lateness_max_seconds gauge\n");
+    for (int i = 0; i < count; i++) {
+      snprintf(line, sizeof(line), "noise_job_lateness_max_seconds{device=\"%s\",job=\"%s\"} %.3f\n", deviceId,
+               jobs[i].name, (double)jobs[i].lateMaxMs / 1e3);
+      emit(line);
+    }
+    emit("# TYPE noise_job_run_max_seconds gauge\n");
+    for (int i = 0; i < count; i++) {
+      snprintf(line, sizeof(line), "noise_job_run_max_seconds{device=\"%s\",job=\"%s\"} %.6f\n", deviceId,
+               jobs[i].name, (double)jobs[i].runMaxUs / 1e6);
+      emit(line);
+    }
+    emit("# TYPE noise_sched_passes_total counter\n");
+    snprintf(line, sizeof(line), "noise_sched_passes_total{device=\"%s\"} %lu\n", deviceId, (unsigned long)passes);
+    emit(line);
+    emit("# TYPE noise_sched_passes_deferred_total counter\n");
+    snprintf(line, sizeof(line), "noise_sched_passes_deferred_total{device=\"%s\"} %lu\n", deviceId,
+             (unsigned long)passesDeferred);
+    emit(line);
+    emit("# TYPE noise_sched_sleep_seconds_total counter\n");
+    snprintf(line, sizeof(line), "noise_sched_sleep_seconds_total{device=\"%s\"} %.3f\n", deviceId, (double)sleptMs / 1e3);
+    emit(line);
+  }
+
+ private:
+  void runJob(int id, uint32_t startMs) {
+    LoopJob &j = jobs[id];
+    j.ready = false;
+    int32_t late = (int32_t)(startMs - j.due);
+    if (late < 0) late = 0;
+    if ((uint32_t)late > j.lateMaxMs) j.lateMaxMs = (uint32_t)late;
+    j.lateSumMs += (uint32_t)late;
+    j.runs++;
+
+    if (spanHook) spanHook(j.name, true);
+    uint32_t t0 = clockUs ? clockUs() : 0;
+    uint32_t delay = j.fn(j.ctx, startMs);
+    uint32_t tookUs = clockUs ? clockUs() - t0 : 0;
+    if (spanHook) spanHook(j.name, false);
+    if (tookUs > j.runMaxUs) j.runMaxUs = tookUs;
+    j.runSumUs += tookUs;
+    if (j.budgetUs && tookUs > j.budgetUs) j.overruns++;
+
+    if (!j.armed || j.ready || j.slot >= 0) return;   // the job re-armed or disarmed itself
+    if (delay == LOOP_JOB_STOP) {
+      j.armed = false;
+      return;
+    }
+    if (delay == 0) delay = 1;
+    uint32_t doneMs = startMs + tookUs / 1000;
+    uint32_t nextDue = j.due + delay;
+    if ((int32_t)(nextDue - doneMs) <= 0) {
+      uint32_t missed = (doneMs - j.due) / delay;
+      j.skipped += missed;
+      nextDue = j.due + delay * (missed + 1);
+    }
+    j.due = nextDue;
+    file(id);
+  }
+
+  void advance(uint32_t now) {
+    if (!started) {
+      curTick = now;
+      started = true;
+      return;
+    }
+    while ((int32_t)(now - curTick) > 0) {
+      uint32_t t = ++curTick;
+      if ((t & (SLOTS - 1)) == 0) {
+        if ((t & (SLOTS * SLOTS - 1)) == 0) cascade(2 * SLOTS + (int)((t >> (2 * SLOT_BITS)) & (SLOTS - 1)));
+        cascade(SLOTS + (int)((t >> SLOT_BITS) & (SLOTS - 1)));
+      }
+      int s = (int)(t & (SLOTS - 1));
+      while (heads[s] >= 0) {
+        int id = heads[s];
+        unlink(id);
+        jobs[id].ready = true;
+      }
+    }
+  }
+
+  void cascade(int slot) {
+    int id = heads[slot];
+    if (id < 0) return;
+    cascades++;
+    heads[slot] = -1;
+    while (id >= 0) {
+      int nxt = jobs[id].next;
+      jobs[id].slot = -1;
+      jobs[id].prev = jobs[id].next = -1;
+      file(id);
+      id = nxt;
+    }
+  }
+
+  void file(int id) {
+    LoopJob &j = jobs[id];
+    int32_t d = (int32_t)(j.due - curTick);
+    if (d <= 0) {
+      j.ready = true;
+      return;
+    }
+    int slot;
+    if (d < SLOTS) {
+      slot = (int)(j.due & (SLOTS - 1));
+    } else if (d < SLOTS * SLOTS) {
+      slot = SLOTS + (int)((j.due >> SLOT_BITS) & (SLOTS - 1));
+    } else {
+      uint32_t at = ((uint32_t)d < SPAN) ? j.due : curTick + SPAN - 1;
+      slot = 2 * SLOTS + (int)((at >> (2 * SLOT_BITS)) & (SLOTS - 1));
+    }
+    j.slot = (int16_t)slot;
+    j.prev = -1;
+    j.next = heads[slot];
+    if (heads[slot] >= 0) jobs[heads[slot]].prev = (int8_t)id;
+    heads[slot] = (int8_t)id;
+  }
+
+  void unlink(int id) {
+    LoopJob &j = jobs[id];
+    if (j.slot < 0) return;
+    if (j.prev >= 0) jobs[j.prev].next = j.next;
+    else heads[j.slot] = j.next;
+    if (j.next >= 0) jobs[j.next].prev = j.prev;
+    j.slot = -1;
+    j.prev = j.next = -1;
+  }
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Non-blocking driver for the UART MP3 module (7E LEN CMD [data..] EF frames, LEN counting
+// itself, CMD and data).
+//
+// - Mp3FrameParser is fed one byte at a time and reports each complete frame. A frame that
+//   does not end in EF, or whose LEN is out of range, is counted and dropped; a 7E inside the
+//   bad frame starts the next one, so one corrupt byte costs at most one frame.
+// - Mp3Driver keeps an outbound command queue. Each command carries the gap the module needs
+//   before the next one (it drops commands sent back to back), and tick() sends at most one
+//   command per call once that gap has passed.
+// - Queries (commands that expect a reply with the same CMD) complete through hooks: onReply
+//   when the reply arrives, onTimeout after queryTimeoutMs. One query is outstanding at a time;
+//   plain commands keep flowing while it waits.
+//
+// tick() never waits: it reads at most rxBudget bytes that the UART ISR has already buffered,
+// checks timers and writes at most one short frame into the TX buffer.
+// Port is duck-typed on Stream: int available(), int read(), size_t write(const uint8_t*, size_t).
+// No Arduino dependencies; tools/mp3_uart_sim.cpp drives it with scripted byte streams.
+
+static const uint8_t MP3_FRAME_START = 0x7E;
+static const uint8_t MP3_FRAME_END = 0xEF;
+static const int MP3_MAX_DATA = 8;
+
+struct Mp3Frame {
+  uint8_t cmd = 0;
+  uint8_t data[MP3_MAX_DATA];
+  uint8_t len = 0;
+};
+
+struct Mp3FrameParser {
+  enum State : uint8_t { IDLE, LEN, BODY, END };
+  State state = IDLE;
+  uint8_t need = 0;     // CMD + data bytes still expected
+  uint8_t got = 0;
+  uint8_t body[1 + MP3_MAX_DATA];
+  Mp3Frame frame;
+
+  uint32_t framesOk = 0;
+  uint32_t framesBad = 0;
+  uint32_t bytesSkipped = 0;   // noise between frames
+
+  // Returns true when b completes a frame (then in `frame`).
+  bool feed(uint8_t b) {
+    switch (state) {
+      case IDLE:
+        if (b == MP3_FRAME_START) state = LEN;
+        else bytesSkipped++;
+        return false;
+      case LEN:
+        if (b < 2 || b > 1 + 1 + MP3_MAX_DATA) return fail(b);
+        need = (uint8_t)(b - 1);
+        got = 0;
+        state = BODY;
+        return false;
+      case BODY:
+        body[got++] = b;
+        if (got == need) state = END;
+        return false;
+      case END:
+        if (b != MP3_FRAME_END) return fail(b);
+        state = IDLE;
+        frame.cmd = body[0];
+        frame.len = (uint8_t)(need - 1);
+        memcpy(frame.data, body + 1, frame.len);
+        framesOk++;
+        return true;
+    }
+    return false;
+  }
+
+ private:
+  bool fail(uint8_t b) {
+    framesBad++;
+    state = (b == MP3_FRAME_START) ? LEN : IDLE;
+    return false;
+  }
+};
+
+struct Mp3Command {
+  uint8_t cmd;
+  uint8_t data[2];
+  uint8_t len;
+  uint16_t gapMs;   // quiet time the module needs after this command
+  bool query;
+};
+
+struct Mp3DriverHooks {
+  void *ctx = nullptr;
+  // Any valid frame, including unsolicited ones (e.g. track finished).
+  void (*onFrame)(void *ctx, const Mp3Frame &f, uint32_t now) = nullptr;
+  // The outstanding query was answered; f.cmd == the query's CMD.
+  void (*onReply)(void *ctx, const Mp3Frame &f, uint32_t now) = nullptr;
+  void (*onTimeout)(void *ctx, uint8_t cmd, uint32_t now) = nullptr;
+};
+
+template <typename Port, int N = 12>
+struct Mp3Driver {
+  Port *port = nullptr;
+  Mp3DriverHooks hooks;
+  Mp3FrameParser parser;
+
+  uint32_t queryTimeoutMs = 180;
+  int rxBudget = 32;
+
+  Mp3Command queue[N];
+  int head = 0;
+  int count = 0;
+  uint32_t nextSendMs = 0;
+
+  bool queryPending = false;
+  uint8_t queryCmd = 0;
+  uint32_t querySentMs = 0;
+
+  uint32_t lastRxMs = 0;
+
+  // Stats.
+  uint32_t sent = 0;
+  uint32_t dropped = 0;      // queue full
+  uint32_t replies = 0;
+  uint32_t timeouts = 0;
+  uint32_t bytesRx = 0;
+  int maxDepth = 0;
+
+  bool send(uint8_t cmd, const uint8_t *data, uint8_t len, uint16_t gapMs) { return push(cmd, data, len, gapMs, false); }
+
+  // Queues a query; skipped (returns false) while the same query is pending or queued.
+  bool query(uint8_t cmd, uint16_t gapMs = 0) {
+    if (queryPending && queryCmd == cmd) return false;
+    for (int i = 0; i < count; i++) {
+      const Mp3Command &c = queue[(head + i) % N];
+      if (c.query && c.cmd == cmd) return false;
+    }
+    return push(cmd, nullptr, 0, gapMs, true);
+  }
+
+  // Drops everything not yet sent (e.g. stop pre-empting a queued play).
+  void clear() {
+    head = 0;
+    count = 0;
+  }
+
+  bool idle() const { return count == 0 && !queryPending; }
+
+  void tick(uint32_t now) {
+    for (int i = 0; i < rxBudget && port->available() > 0; i++) {
+      int c = port->read();
+      if (c < 0) break;
+      bytesRx++;
+      lastRxMs = now;
+      if (!parser.feed((uint8_t)c)) continue;
+      const Mp3Frame &f = parser.frame;
+      if (hooks.onFrame) hooks.onFrame(hooks.ctx, f, now);
+      if (queryPending && f.cmd == queryCmd) {
+        queryPending = false;
+        replies++;
+        if (hooks.onReply) hooks.onReply(hooks.ctx, f, now);
+      }
+    }
+
+    if (queryPending && now - querySentMs >= queryTimeoutMs) {
+      queryPending = false;
+      timeouts++;
+      if (hooks.onTimeout) hooks.onTimeout(hooks.ctx, queryCmd, now);
+    }
+
+    if (count == 0 || (int32_t)(now - nextSendMs) < 0) return;
+    const Mp3Command &c = queue[head];
+    if (c.query && queryPending) return;
+    uint8_t out[4 + 2];
+    out[0] = MP3_FRAME_START;
+    out[1] = (uint8_t)(2 + c.len);
+    out[2] = c.cmd;
+    memcpy(out + 3, c.data, c.len);
+    out[3 + c.len] = MP3_FRAME_END;
+    port->write(out, (size_t)(4 + c.len));
+    sent++;
+    nextSendMs = now + c.gapMs;
+    if (c.query) {
+      queryPending = true;
+      queryCmd = c.cmd;
+      querySentMs = now;
+    }
+    head = (head + 1) % N;
+    count--;
+  }
+
+ private:
+  bool push(uint8_t cmd, const uint8_t *data, uint8_t len, uint16_t gapMs, bool isQuery) {
+    if (count >= N || len > 2) {
+      dropped++;
+      return false;
+    }
+    Mp3Command &c = queue[(head + count) % N];
+    c.cmd = cmd;
+    c.len = len;
+    if (len) memcpy(c.data, data, len);
+    c.gapMs = gapMs;
+    c.query = isQuery;
+    count++;
+    if (count > maxDepth) maxDepth = count;
+    return true;
+  }
+};
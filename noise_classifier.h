@@ -0,0 +1,294 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// Noise-source classifier: labels each ~1 s window as crowd (speech/babble), impulsive
+// (bangs, slams), tonal (bells, alarms, PA feedback) or machinery (fans, HVAC, hum).
+//
+// Per mic frame (256 samples): Hann window + 256-point FFT -> 16 log-mel bands, frame energy,
+// peak-to-mean tonality and spectral flux. Per window: 16 mean log-mel values + energy std,
+// energy crest, mean tonality, mean flux -> standardized -> int8 -> 20x16x4 int8 MLP.
+//
+// The frame cost is fixed (one FFT, no data-dependent loops); the classifier also skips frames
+// (stride 1..4) if the measured cost goes over budgetUs, e.g. at the 80 MHz quiet-mode clock.
+// Weights come from tools/noise_classify.cpp (noise_classifier_weights.h). No Arduino dependencies.
+
+enum NoiseClass { NC_CROWD = 0, NC_IMPULSIVE = 1, NC_TONAL = 2, NC_MACHINERY = 3, NC_CLASS_COUNT = 4 };
+
+static const char *const NOISE_CLASS_NAMES[NC_CLASS_COUNT] = { "crowd", "impulsive", "tonal", "machinery" };
+
+static const int NC_FFT = 256;
+static const int NC_FFT_LOG2 = 8;
+static const int NC_BINS = NC_FFT / 2 + 1;
+static const int NC_MELS = 16;
+static const int NC_FEATURES = NC_MELS + 4;
+static const int NC_HIDDEN = 16;
+static const float NC_SAMPLE_RATE = 16000.0f;
+static const float NC_INPUT_SCALE = 24.0f;  // int8 steps per standard deviation of a feature
+static const float NC_PI = 3.14159265358979f;
+
+struct NoiseClassifierModel {
+  float featMean[NC_FEATURES];
+  float featInvStd[NC_FEATURES];
+  int8_t w1[NC_HIDDEN][NC_FEATURES];
+  int32_t b1[NC_HIDDEN];              // accumulator units (w1 scale / NC_INPUT_SCALE)
+  int32_t m1;                         // Q16 multiplier: layer-1 accumulator -> int8 hidden
+  int8_t w2[NC_CLASS_COUNT][NC_HIDDEN];
+  int32_t b2[NC_CLASS_COUNT];         // accumulator units (w2 scale * hidden scale)
+  float logitScale;                   // layer-2 accumulator -> logits, for the confidence only
+};
+
+// Standardize + quantize one feature vector.
+static inline void noiseClassifierQuantize(const NoiseClassifierModel &m, const float *f, int8_t *x) {
+  for (int i = 0; i < NC_FEATURES; i++) {
+    float z = (f[i] - m.featMean[i]) * m.featInvStd[i] * NC_INPUT_SCALE;
+    long q = lroundf(z);
+    x[i] = (int8_t)(q > 127 ? 127 : (q < -127 ? -127 : q));
+  }
+}
+
+// Integer-only MLP. Returns the argmax class; logits are layer-2 accumulators.
+static inline int noiseClassifierInfer(const NoiseClassifierModel &m, const int8_t *x, int32_t *logits) {
+  int8_t h[NC_HIDDEN];
+  for (int j = 0; j < NC_HIDDEN; j++) {
+    int32_t acc = m.b1[j];
+    for (int i = 0; i < NC_FEATURES; i++) acc += (int32_t)m.w1[j][i] * (int32_t)x[i];
+    if (acc < 0) acc = 0;
+    int64_t v = ((int64_t)acc * m.m1 + 32768) >> 16;
+    h[j] = (int8_t)(v > 127 ? 127 : v);
+  }
+  int best = 0;
+  for (int c = 0; c < NC_CLASS_COUNT; c++) {
+    int32_t acc = m.b2[c];
+    for (int j = 0; j < NC_HIDDEN; j++) acc += (int32_t)m.w2[c][j] * (int32_t)h[j];
+    logits[c] = acc;
+    if (acc > logits[best]) best = c;
+  }
+  return best;
+}
+
+struct NoiseFrontend {
+  float window[NC_FFT];
+  float cosT[NC_FFT / 2];
+  float sinT[NC_FFT / 2];
+  uint8_t bitrev[NC_FFT];
+  int16_t melEdge[NC_MELS + 2];  // FFT bin of each triangle edge/center
+  bool inited = false;
+
+  float re[NC_FFT];
+  float im[NC_FFT];
+  float logMel[NC_MELS];
+  float prevLogMel[NC_MELS];
+  bool havePrev = false;
+
+  // Window accumulators.
+  int frames = 0;
+  float sumLogMel[NC_MELS];
+  float sumE = 0, sumE2 = 0, maxE = -1000.0f;
+  float sumTonality = 0, sumFlux = 0;
+
+  static float hzToMel(float hz) { return 2595.0f * log10f(1.0f + hz / 700.0f); }
+  static float melToHz(float mel) { return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f); }
+
+  void init() {
+    for (int i = 0; i < NC_FFT; i++) {
+      window[i] = 0.5f - 0.5f * cosf(2.0f * NC_PI * (float)i / (float)(NC_FFT - 1));
+      uint32_t r = 0;
+      for (int b = 0; b < NC_FFT_LOG2; b++) r |= ((uint32_t)(i >> b) & 1u) << (NC_FFT_LOG2 - 1 - b);
+      bitrev[i] = (uint8_t)r;
+    }
+    for (int k = 0; k < NC_FFT / 2; k++) {
+      cosT[k] = cosf(2.0f * NC_PI * (float)k / (float)NC_FFT);
+      sinT[k] = -sinf(2.0f * NC_PI * (float)k / (float)NC_FFT);
+    }
+    const float lo = hzToMel(100.0f), hi = hzToMel(7600.0f);
+    for (int m = 0; m < NC_MELS + 2; m++) {
+      float hz = melToHz(lo + (hi - lo) * (float)m / (float)(NC_MELS + 1));
+      int bin = (int)lroundf(hz * (float)NC_FFT / NC_SAMPLE_RATE);
+      if (m > 0 && bin <= melEdge[m - 1]) bin = melEdge[m - 1] + 1;  // keep triangles non-empty
+      melEdge[m] = (int16_t)(bin < NC_BINS - 1 ? bin : NC_BINS - 1);
+    }
+    resetWindow();
+    havePrev = false;
+    inited = true;
+  }
+
+  void resetWindow() {
+    frames = 0;
+    memset(sumLogMel, 0, sizeof(sumLogMel));
+    sumE = sumE2 = 0;
+    maxE = -1000.0f;
+    sumTonality = sumFlux = 0;
+  }
+
+  void fft() {
+    for (int i = 0; i < NC_FFT; i++) {
+      int j = bitrev[i];
+      if (j > i) {
+        float t = re[i]; re[i] = re[j]; re[j] = t;
+        t = im[i]; im[i] = im[j]; im[j] = t;
+      }
+    }
+    for (int len = 2; len <= NC_FFT; len <<= 1) {
+      int half = len >> 1;
+      int step = NC_FFT / len;
+      for (int i = 0; i < NC_FFT; i += len) {
+        for (int k = 0; k < half; k++) {
+          float wr = cosT[k * step], wi = sinT[k * step];
+          float xr = re[i + k + half] * wr - im[i + k + half] * wi;
+          float xi = re[i + k + half] * wi + im[i + k + half] * wr;
+          re[i + k + half] = re[i + k] - xr;
+          im[i + k + half] = im[i + k] - xi;
+          re[i + k] += xr;
+          im[i + k] += xi;
+        }
+      }
+    }
+  }
+
+  // s: mic samples (I2S 32-bit words are scaled by >> shift); n < NC_FFT is zero padded.
+  void addFrame(const int32_t *s, int n, int shift) {
+    if (!inited) init();
+    if (n > NC_FFT) n = NC_FFT;
+    float mean = 0;
+    for (int i = 0; i < n; i++) mean += (float)(s[i] >> shift);
+    mean = n > 0 ? mean / (float)n : 0.0f;
+    for (int i = 0; i < NC_FFT; i++) {
+      re[i] = (i < n) ? ((float)(s[i] >> shift) - mean) * window[i] : 0.0f;
+      im[i] = 0.0f;
+    }
+    fft();
+
+    // Power spectrum in place (re[k] = |X_k|^2), k = 0..NC_FFT/2.
+    float total = 0, peak = 0;
+    for (int k = 0; k < NC_BINS; k++) {
+      float p = re[k] * re[k] + im[k] * im[k];
+      re[k] = p;
+      if (k >= 2) {
+        total += p;
+        if (p > peak) peak = p;
+      }
+    }
+    const float eps = 1e-3f;
+    const float meanBin = total / (float)(NC_BINS - 2);
+    const float energyDb = 10.0f * log10f(total + eps);
+    const float tonality = 10.0f * log10f((peak + eps) / (meanBin + eps));
+
+    float flux = 0;
+    for (int m = 0; m < NC_MELS; m++) {
+      const int a = melEdge[m], c = melEdge[m + 1], b = melEdge[m + 2];
+      float acc = 0;
+      for (int k = a; k < c; k++) acc += re[k] * (float)(k - a) / (float)(c - a);
+      for (int k = c; k < b; k++) acc += re[k] * (float)(b - k) / (float)(b - c);
+      logMel[m] = 10.0f * log10f(acc + eps);
+      if (havePrev && logMel[m] > prevLogMel[m]) flux += logMel[m] - prevLogMel[m];
+      sumLogMel[m] += logMel[m];
+    }
+    memcpy(prevLogMel, logMel, sizeof(logMel));
+    havePrev = true;
+
+    frames++;
+    sumE += energyDb;
+    sumE2 += energyDb * energyDb;
+    if (energyDb > maxE) maxE = energyDb;
+    sumTonality += tonality;
+    sumFlux += flux;
+  }
+
+  // Window summary (NC_FEATURES floats); resets the accumulators.
+  void features(float *out) {
+    const float inv = frames > 0 ? 1.0f / (float)frames : 0.0f;
+    for (int m = 0; m < NC_MELS; m++) out[m] = sumLogMel[m] * inv;
+    const float meanE = sumE * inv;
+    float var = sumE2 * inv - meanE * meanE;
+    out[NC_MELS + 0] = sqrtf(var > 0 ? var : 0);  // loudness modulation
+    out[NC_MELS + 1] = maxE - meanE;              // crest: impulses stand out
+    out[NC_MELS + 2] = sumTonality * inv;         // strong single peaks: bells/alarms
+    out[NC_MELS + 3] = sumFlux * inv;             // onset rate: speech is high, fans are low
+    resetWindow();
+  }
+};
+
+struct NoiseClassifier {
+  NoiseFrontend fe;
+  const NoiseClassifierModel *model = nullptr;
+
+  uint32_t windowMs = 1000;
+  int minFrames = 3;
+  uint32_t staleMs = 2500;            // a label older than this is ignored by suppress()
+  uint8_t minConfidencePct = 60;      // suppress() only trusts confident non-crowd labels
+
+  // Per-frame budget.
+  uint32_t budgetUs = 2000;
+  uint8_t stride = 1;                 // process every stride-th frame
+  uint8_t strideCount = 0;
+  uint32_t lastCostUs = 0;
+  uint32_t maxCostUs = 0;
+
+  // Latest result.
+  bool started = false;
+  uint32_t windowStartMs = 0;
+  float lastFeatures[NC_FEATURES];
+  bool hasLabel = false;
+  NoiseClass label = NC_CROWD;
+  uint8_t confidencePct = 0;
+  uint32_t labelMs = 0;
+  uint32_t windows = 0;
+  uint32_t counts[NC_CLASS_COUNT] = {};
+
+  bool wantFrame() {
+    if (++strideCount < stride) return false;
+    strideCount = 0;
+    return true;
+  }
+
+  // Caller measures the cost of each processed frame (addFrame) and reports it here.
+  void noteCost(uint32_t us) {
+    lastCostUs = us;
+    if (us > maxCostUs) maxCostUs = us;
+    if (us > budgetUs && stride < 4) stride++;
+    else if (us * 3 < budgetUs && stride > 1) stride--;
+  }
+
+  // Returns true when a window closed (lastFeatures updated; label too if a model is set).
+  bool addFrame(const int32_t *s, int n, int shift, uint32_t now) {
+    if (!started) {
+      started = true;
+      windowStartMs = now;
+    }
+    fe.addFrame(s, n, shift);
+    if (now - windowStartMs < windowMs) return false;
+    windowStartMs = now;
+    if (fe.frames < minFrames) {
+      fe.resetWindow();
+      return false;
+    }
+    fe.features(lastFeatures);
+    windows++;
+    if (model) classify(now);
+    return true;
+  }
+
+  void classify(uint32_t now) {
+    int8_t x[NC_FEATURES];
+    int32_t logits[NC_CLASS_COUNT];
+    noiseClassifierQuantize(*model, lastFeatures, x);
+    int c = noiseClassifierInfer(*model, x, logits);
+
+    float sum = 0;
+    for (int k = 0; k < NC_CLASS_COUNT; k++) sum += expf((float)(logits[k] - logits[c]) * model->logitScale);
+    confidencePct = (uint8_t)lroundf(100.0f / sum);
+
+    label = (NoiseClass)c;
+    labelMs = now;
+    hasLabel = true;
+    counts[c]++;
+  }
+
+  // True while a fresh, confident label says the current noise is not people.
+  bool suppress(uint32_t now) const {
+    return hasLabel && (now - labelMs <= staleMs) && label != NC_CROWD && confidencePct >= minConfidencePct;
+  }
+};
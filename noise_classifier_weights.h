@@ -0,0 +1,38 @@
+#pragma once
+
+#include "noise_classifier.h"
+
+// Generated by tools/noise_classify.cpp (train): 960 windows, held-out int8 accuracy 98.0%.
+// Default weights: synthetic clips (noise_classify synth clips 60 1). Retrain on recordings from the installation site before enabling suppression.
+static const NoiseClassifierModel NOISE_CLASSIFIER_MODEL = {
+  { 70.01826f, 72.45404f, 73.32359f, 74.38035f, 74.98147f, 74.81367f, 75.52497f, 77.37132f, 77.54034f, 76.62339f, 75.42242f, 71.38692f, 67.40488f, 64.82838f, 62.45177f, 57.26441f, 6.86455f, 11.02685f, 12.69546f, 36.62148f },
+  { 0.066064f, 0.067791f, 0.068322f, 0.068383f, 0.071594f, 0.072919f, 0.075694f, 0.073180f, 0.070601f, 0.072106f, 0.072704f, 0.072837f, 0.072687f, 0.067741f, 0.063658f, 0.057567f, 0.120728f, 0.076549f, 0.442270f, 0.035982f },
+  {
+    { -15, -4, 9, -13, 9, 37, 5, -6, -13, -1, 5, 9, -14, 24, -11, 16, -4, -1, -21, -26 },
+    { 77, 28, 42, 37, 14, 50, 61, 33, 12, 5, -44, -2, 38, -7, -7, -1, -15, -18, 46, -28 },
+    { 21, 37, 2, -11, 13, 18, 18, -1, 12, -1, 7, -4, 4, 7, -6, 8, -10, 27, -78, 18 },
+    { 4, 20, 9, -7, -6, -30, 7, -31, 24, 3, 48, -24, 11, 16, -3, 3, -24, -35, -4, -18 },
+    { -24, -14, -23, -35, 34, 2, -16, -29, 9, 35, -16, -2, -21, -32, 31, 5, 45, 21, 76, 14 },
+    { 47, 22, -4, 9, -48, 5, 11, -18, -21, 0, -41, -9, 7, -14, -12, -30, 1, 42, -123, 19 },
+    { 18, 18, 12, 16, -28, 27, 3, -14, 27, 31, -3, 11, 3, 16, 7, 4, 54, 25, -31, 41 },
+    { -12, -11, -15, -1, 5, 17, -15, -24, -26, -31, -34, -2, -11, -2, -32, -31, -40, 38, -42, -19 },
+    { -10, -18, -57, 13, -15, -3, -27, 17, -27, 5, 17, 9, 4, 20, 43, -22, -8, -22, -11, 10 },
+    { 26, 9, -4, 42, 11, 3, 14, -1, -3, -8, -34, 25, -35, 7, -5, 4, 11, -25, 17, -42 },
+    { 30, 3, 45, -13, 32, 16, 34, 45, 3, 30, -16, 15, -3, 8, 8, 22, 1, 2, 0, -4 },
+    { -14, -4, -14, -1, 4, -7, -34, -32, -30, 15, 30, -1, 32, -9, 16, 19, -27, -27, 4, -21 },
+    { -58, -61, -28, -7, 16, -13, -22, 59, -6, 12, 56, -16, 37, -26, 5, -4, 29, 17, 127, 25 },
+    { -1, 7, 26, 48, 1, -17, -21, -24, -39, -10, 6, 35, 7, 31, 26, 0, -49, -77, -31, -58 },
+    { -28, 8, -21, -2, -32, -11, -1, 35, 4, -7, 0, 0, -12, -26, 44, -4, -7, -15, 27, 46 },
+    { 15, 7, 17, -11, -34, -13, 1, 9, -17, -14, 25, -6, -42, -64, -28, -2, -19, 1, -10, 15 },
+  },
+  { -205, -722, 337, 166, -44, -34, 442, -376, 477, 142, -723, 755, 612, 2293, 11, -893 },
+  553,
+  {
+    { 7, -109, -3, 17, -45, -60, -61, -45, 7, -10, -67, 42, -48, 127, 0, -39 },
+    { -6, -1, 68, -47, -38, 101, 43, 56, 1, -47, 18, -42, -60, -66, 0, 46 },
+    { -8, 10, -40, -5, 67, -43, 5, -41, 28, -28, -5, 3, 112, -65, 47, 29 },
+    { 6, 98, 11, -1, -34, -32, -59, -43, -51, 28, 34, -53, -28, 7, -47, 7 },
+  },
+  { 1292, -18, -198, -1076 },
+  0.00089980f
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stdint.h>
+#include "types.h"
+
+// LED decision + RED escalation state machine, shared by the firmware and host tools
+// (tools/noise_replay.cpp). Time is passed in by the caller and all side effects
+// (LEDs, MP3, recording, queueing) go through NoiseEngineHooks, so the engine itself
+// has no Arduino dependencies.
+
+enum WarningLevel { WARN_FIRST = 0, WARN_SECOND = 1, WARN_MAJOR = 2, WARN_MAJOR_REPEAT = 3 };
+
+struct NoiseEngineConfig {
+  int yellowThreshold = 65;
+  int redThreshold = 70;
+  int hysteresisDb = 3;
+  uint32_t firstWarningMs = 5000;
+  uint32_t secondWarningMs = 30000;
+  uint32_t majorWarningMs = 60000;
+  uint32_t majorRepeatIntervalMs = 180000;
+  uint32_t silenceResetWindowMs = 15000;
+};
+
+struct NoiseEngineHooks {
+  void *ctx = nullptr;
+  void (*onViolationStart)(void *ctx, uint32_t now) = nullptr;
+  // durationSec: configured step seconds, or elapsed seconds for MAJOR repeats.
+  void (*onWarning)(void *ctx, WarningLevel level, int durationSec, int value, uint32_t now) = nullptr;
+  void (*onViolationReset)(void *ctx, uint32_t now) = nullptr;
+};
+
+struct NoiseEngine {
+  NoiseEngineConfig cfg;
+  NoiseEngineHooks hooks;
+
+  LedState led = GREEN;
+
+  bool violationActive = false;
+  uint32_t redStartMs = 0;
+  bool firstLogged = false;
+  bool secondLogged = false;
+  bool majorLogged = false;
+  uint32_t lastMajorAlertMs = 0;
+  bool silenceRun = false;
+  uint32_t silenceStartMs = 0;
+
+  // RED/YELLOW switch on immediately; hysteresis applies only on the falling edge.
+  LedState updateLed(int value) {
+    switch (led) {
+      case GREEN:
+        if (value >= cfg.redThreshold)
+          led = RED;
+        else if (value >= cfg.yellowThreshold)
+          led = YELLOW;
+        break;
+
+      case YELLOW:
+        if (value >= cfg.redThreshold)
+          led = RED;
+        else if (value < cfg.yellowThreshold - cfg.hysteresisDb)
+          led = GREEN;
+        break;
+
+      case RED:
+        if (value < cfg.redThreshold - cfg.hysteresisDb)
+          led = YELLOW;
+        break;
+    }
+    return led;
+  }
+
+  // Escalation: FIRST -> SECOND -> MAJOR while above RED, MAJOR repeats every
+  // majorRepeatIntervalMs, and the whole violation resets only after
+  // silenceResetWindowMs continuously below RED.
+  // ignore: the caller knows this frame's noise doesn't count (e.g. a bell); it is treated as below RED.
+  void handleWarnings(int value, uint32_t now, bool ignore = false) {
+    if (value >= cfg.redThreshold && !ignore) {
+      silenceRun = false;
+      if (!violationActive) {
+        violationActive = true;
+        redStartMs = now;
+        firstLogged = secondLogged = majorLogged = false;
+        lastMajorAlertMs = 0;
+        if (hooks.onViolationStart) hooks.onViolationStart(hooks.ctx, now);
+      }
+
+      uint32_t d = now - redStartMs;
+      if (d >= cfg.firstWarningMs && !firstLogged) {
+        firstLogged = true;
+        fire(WARN_FIRST, (int)(cfg.firstWarningMs / 1000UL), value, now);
+      }
+      if (d >= cfg.secondWarningMs && !secondLogged) {
+        secondLogged = true;
+        fire(WARN_SECOND, (int)(cfg.secondWarningMs / 1000UL), value, now);
+      }
+      if (d >= cfg.majorWarningMs && !majorLogged) {
+        majorLogged = true;
+        lastMajorAlertMs = now;
+        fire(WARN_MAJOR, (int)(cfg.majorWarningMs / 1000UL), value, now);
+      }
+      if (majorLogged && lastMajorAlertMs != 0 && (now - lastMajorAlertMs >= cfg.majorRepeatIntervalMs)) {
+        lastMajorAlertMs = now;
+        fire(WARN_MAJOR_REPEAT, (int)(d / 1000UL), value, now);
+      }
+    } else {
+      if (!silenceRun) {
+        silenceRun = true;
+        silenceStartMs = now;
+      }
+      if (now - silenceStartMs >= cfg.silenceResetWindowMs) {
+        bool wasActive = violationActive;
+        violationActive = false;
+        firstLogged = secondLogged = majorLogged = false;
+        lastMajorAlertMs = 0;
+        silenceRun = false;
+        if (wasActive && hooks.onViolationReset) hooks.onViolationReset(hooks.ctx, now);
+      }
+    }
+  }
+
+  // Restart (or cancel) the silence window, e.g. after thresholds change at runtime.
+  void restartSilenceWindow(int value, uint32_t now) {
+    silenceRun = (value < cfg.redThreshold);
+    silenceStartMs = now;
+  }
+
+ private:
+  void fire(WarningLevel level, int durationSec, int value, uint32_t now) {
+    if (hooks.onWarning) hooks.onWarning(hooks.ctx, level, durationSec, value, now);
+  }
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+// Quiet-period duty-cycle policy.
+// After a sustained GREEN period the device drops to a slower frame rate, enables modem sleep,
+// lowers the CPU clock and batches uploads. The first frame at/above the yellow threshold
+// returns it to full rate, so wake latency is bounded by one quiet frame period.
+// No Arduino dependencies: the caller applies the side effects and feeds a (virtual) clock.
+
+enum PowerMode { POWER_ACTIVE = 0, POWER_QUIET = 1 };
+
+struct PowerPolicy {
+  // ---- tuning ----
+  bool enabled = true;
+  uint32_t quietAfterMs = 600000;       // GREEN this long before entering QUIET
+  uint32_t activeFrameMs = 50;
+  uint32_t quietFrameMs = 250;          // also the worst-case wake latency
+  uint32_t activeSyncIntervalMs = 3000;
+  uint32_t quietSyncIntervalMs = 60000;
+  uint16_t activeCpuMhz = 240;
+  uint16_t quietCpuMhz = 80;            // lowest clock that keeps Wi-Fi up
+
+  // Rough board draw at 3.3 V, used only for the estimated-energy counter.
+  uint32_t activeMilliwatts = 530;      // 240 MHz, Wi-Fi modem always on
+  uint32_t quietMilliwatts = 150;       // 80 MHz, modem sleep between DTIM beacons
+
+  // ---- state ----
+  PowerMode mode = POWER_ACTIVE;
+  uint32_t greenSinceMs = 0;
+  bool greenRun = false;
+  uint32_t lastUpdateMs = 0;
+  bool started = false;
+
+  // ---- stats ----
+  uint64_t energyMicroJoules = 0;
+  uint32_t quietEntries = 0;
+  uint32_t wakeups = 0;
+  uint32_t lastWakeLatencyMs = 0;       // gap between the previous quiet frame and the loud one
+
+  uint32_t frameIntervalMs() const { return mode == POWER_QUIET ? quietFrameMs : activeFrameMs; }
+  uint32_t syncIntervalMs() const { return mode == POWER_QUIET ? quietSyncIntervalMs : activeSyncIntervalMs; }
+  uint16_t cpuMhz() const { return mode == POWER_QUIET ? quietCpuMhz : activeCpuMhz; }
+  bool modemSleep() const { return mode == POWER_QUIET; }
+
+  uint32_t energyMilliJoules() const { return (uint32_t)(energyMicroJoules / 1000ULL); }
+
+  // Feed one frame. Returns true when the mode changed and side effects must be re-applied.
+  // loud: frame level at/above the yellow threshold; green: the LED decision is GREEN.
+  bool update(uint32_t now, bool loud, bool green) {
+    uint32_t dt = started ? (now - lastUpdateMs) : 0;
+    if (started) {
+      uint32_t mw = (mode == POWER_QUIET) ? quietMilliwatts : activeMilliwatts;
+      energyMicroJoules += (uint64_t)mw * dt;  // mW * ms = uJ
+    }
+    started = true;
+    lastUpdateMs = now;
+
+    if (mode == POWER_QUIET) {
+      if (loud || !enabled) {
+        mode = POWER_ACTIVE;
+        greenRun = false;
+        wakeups++;
+        lastWakeLatencyMs = dt;
+        return true;
+      }
+      return false;
+    }
+
+    if (!green || loud || !enabled) {
+      greenRun = false;
+      return false;
+    }
+    if (!greenRun) {
+      greenRun = true;
+      greenSinceMs = now;
+      return false;
+    }
+    if (now - greenSinceMs >= quietAfterMs) {
+      mode = POWER_QUIET;
+      quietEntries++;
+      return true;
+    }
+    return false;
+  }
+};
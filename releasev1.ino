@@ -11,9 +11,38 @@
 #include <Preferences.h>
 #include <HTTPClient.h>
 #include <WiFiClientSecure.h>
+#include <WiFiUdp.h>
 #include <esp_wifi_types.h>
 #include <esp_sntp.h>
 #include "web_ui.h"
+#include "sync_scheduler.h"
+#include "power_policy.h"
+#include "loop_profiler.h"
+#include "noise_engine.h"
+#include "settings_store.h"
+#include "ring_log.h"
+#include "sd_bench.h"
+#include "noise_classifier.h"
+#include "noise_classifier_weights.h"
+#include "event_queue.h"
+#include "clock_service.h"
+#include "event_log.h"
+#include "heap_stats.h"
+#include "zone_meter.h"
+#include "mp3_driver.h"
+#include "storage_budget.h"
+#include "loop_scheduler.h"
+#include "db_blob.h"
+#include "clip_stream.h"
+#include "live_feed.h"
+#include "trace_ring.h"
+#include "wifi_reconnect.h"
+#include "boot_stages.h"
+#include "dsp_pipeline.h"
+#include "file_export.h"
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <lwip/sockets.h>
 
 // ================= LED PWM =================
 // LEDC PWM is used so we can support brightness sliders.
@@ -79,6 +108,22 @@ unsigned long lastRtcPollMs = 0;
 
 static volatile bool ntpTimeSynced = false;
 static volatile bool tzReapplyRequested = false;
+static volatile bool ntpSamplePending = false;
+
+// Epoch time for getEpochMs(): esp_timer counter disciplined by NTP and the DS3231 (clock_service.h).
+ClockService clockService;
+
+// db series samples taken before the first clock sync, stamped once it arrives.
+struct PreSyncDbSample {
+  uint32_t monoMs;
+  int16_t db10;
+  uint8_t zone;
+};
+static const int PRESYNC_DB_CAP = 512;
+PreSyncDbSample preSyncDb[PRESYNC_DB_CAP];
+int preSyncDbHead = 0;
+int preSyncDbCount = 0;
+uint32_t preSyncDbDropped = 0;
 
 static void onNtpTimeSync(struct timeval *tv);
 
@@ -88,6 +133,8 @@ static void onNtpTimeSync(struct timeval *tv) {
   (void)tv;
   ntpTimeSynced = true;
   tzReapplyRequested = true;
+  // Runs in the SNTP task; loop() samples the freshly set system time against the counter.
+  ntpSamplePending = true;
 }
 
 static void applyTimezone() {
@@ -100,15 +147,13 @@ String networkPassword = "";
 
 bool wifiConnecting = false;
 bool wifiConnected = false;
-unsigned long wifiStartTime = 0;
-const unsigned long WIFI_TIMEOUT = 30000;
-unsigned long lastWifiRetryMs = 0;
-const unsigned long WIFI_RETRY_INTERVAL_MS = 20000;
-unsigned long nextWifiRetryAllowedMs = 0;
-bool staSuppressed = false;
-unsigned long staSuppressedUntilMs = 0;
 String wifiStatusMessage = "Not connected";
 
+// STA (re)connect: targeted association to the cached AP, scan fallback, backoff (wifi_reconnect.h).
+// onWiFiEvent() runs in the Wi-Fi event task and only queues; the loop drives wifiRc.
+WifiReconnect wifiRc;
+WifiEventQueue<16> wifiEvents;
+
 uint8_t lastStaDisconnectReason = 0;
 bool lastStaDisconnectReasonValid = false;
 
@@ -116,7 +161,25 @@ String lastScanJson = "[]";
 bool wifiScanRunning = false;
 unsigned long wifiScanStartMs = 0;
 
-Preferences preferences;
+// Boot tasks read and write NVS while loop() handlers do too. begin()..end() on the shared object
+// holds nvsLock, so one task's section never runs inside another's.
+SemaphoreHandle_t nvsLock = nullptr;
+
+class SharedPreferences : public Preferences {
+ public:
+  bool begin(const char *name, bool readOnly = false) {
+    if (nvsLock) xSemaphoreTakeRecursive(nvsLock, portMAX_DELAY);
+    return Preferences::begin(name, readOnly);
+  }
+  void end() {
+    Preferences::end();
+    if (nvsLock) xSemaphoreGiveRecursive(nvsLock);
+  }
+};
+
+SharedPreferences preferences;
+// "settings" namespace: one CRC-checked blob, committed from loop() after UI changes settle.
+SettingsStore<SharedPreferences> settingsStore;
 WebServer server(80);
 
 bool speakerEnabled = true;
@@ -141,11 +204,13 @@ void saveDeviceSettings();
 void logNetworkInfo(const String &tag);
 
 void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
+uint32_t wifiEpochS();
+void saveWifiApCache();
+void applyWifiAction(WifiRcAction a);
 
 void initLedPwm();
 void setNoiseLedPwm(LedState s);
-void updateStatusLed(unsigned long now);
-void delayWithStatus(unsigned long ms);
+unsigned long updateStatusLed(unsigned long now);
 void presetToRgb(int preset, int intensity, int &r, int &g, int &b);
 
 void markSupabaseFail();
@@ -171,6 +236,11 @@ void handleSdInfo();
 
 void handleNoiseLedTest();
 static void tickNoiseLedTest(unsigned long now);
+static void initLoopJobs();
+static void startBootTasks();
+static bool bootGate(BootStage stage);
+static bool sdGate();
+static void sleepUntilNextWork();
 
 void handleRtcInfo();
 void handleRtcSync();
@@ -179,19 +249,43 @@ void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
   if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
     lastStaDisconnectReason = info.wifi_sta_disconnected.reason;
     lastStaDisconnectReasonValid = true;
+    wifiEvents.push(WIFI_EV_DISCONNECTED, info.wifi_sta_disconnected.reason);
   } else if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED) {
     lastStaDisconnectReasonValid = false;
+    wifiEvents.push(WIFI_EV_ASSOC, 0);
+  } else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+    wifiEvents.push(WIFI_EV_GOT_IP, 0);
+  } else if (event == ARDUINO_EVENT_WIFI_STA_LOST_IP) {
+    wifiEvents.push(WIFI_EV_LOST_IP, 0);
   }
 }
 
 void handleSetDbLogConfig();
-bool appendDbSeriesRecord(uint64_t tsMs, int db10);
+bool appendDbSeriesRecord(uint64_t tsMs, int db10, uint8_t zone);
 bool tryBulkUploadDbSeries(unsigned long now);
+bool tryBulkUploadDbRing();
+bool tryBulkUploadDbBlobs();
+void initDbRing();
+void initStorageManager();
 uint64_t getEpochMs();
 
 int trySyncPendingEvents();
+int trySyncRamEvents();
 
 void handleSetAlertConfig();
+void handleSetLowPower();
+void handleSetClassifier();
+void handleSetEventQueue();
+void handleSetZones();
+void handleSetStorage();
+void handleSetClipStream();
+void handleSetLiveFeed();
+void handleTrace();
+void handleFiles();
+void handleSetAdminPassword();
+void handleSetLogLevel();
+void handleMetrics();
+static void applyPowerMode();
 
 const char* DEVICE_ID = "esp32_noise_01";
 
@@ -206,17 +300,366 @@ unsigned long lastSyncBackoffLogMs = 0;
 const unsigned long SYNC_IO_LOG_INTERVAL_MS = 10000;
 unsigned long lastSyncIoLogMs = 0;
 
-unsigned long nextSupabaseSyncAllowedMs = 0;
+// Per-class backoff, batch sizing and API liveness (see sync_scheduler.h).
+SyncScheduler syncSched;
+static const int SYNC_EVENT_BATCH_CAP = 40;
+int pendingEventsKnown = -1;
+
+// RED events wait here while the uplink is healthy; /pending_events.txt only gets spills (event_queue.h).
+static const int EVENT_QUEUE_CAP = 16;
+EventQueue<EVENT_QUEUE_CAP> eventQueue;
+bool dbSeriesRetryPending = false;
+
+// Quiet-period duty cycling (see power_policy.h).
+PowerPolicy powerPolicy;
+
+// ================= PROFILING =================
+// Per-stage latency histograms and counters, served at /metrics (see loop_profiler.h).
+LoopMetrics loopMetrics;
+
+// Allocation counters and heap snapshots, served in /status (see heap_stats.h).
+HeapStats heapStats;
+TaskHandle_t heapLoopTask = nullptr;
+unsigned long lastHeapSnapshotMs = 0;
+static const unsigned long HEAP_SNAPSHOT_MS = 10000;
+
+// Stall tracer (trace_ring.h): spans for named StageTimers, loop jobs, HTTP handlers and the slow
+// SD and network calls. The first stall freezes it; GET /trace downloads it as Chrome trace JSON
+// and /trace?rearm=1 records again.
+static const int TRACE_RECORDS = 2048;   // 16 KB: several seconds of a busy loop
+TraceRing<TRACE_RECORDS> traceRing;
+TaskHandle_t traceLoopTask = nullptr;
+TaskHandle_t clipTaskHandle = nullptr;
+uint16_t traceClipStreamId = 0;   // interned in setup(); the uploader task never interns
+
+// Staged boot (boot_stages.h): metering starts first, SD/RTC/Wi-Fi come up in these tasks.
+BootStages bootStages;
+BootHistory bootHistory;
+TaskHandle_t bootTasks[3] = { nullptr, nullptr, nullptr };   // sd, rtc, wifi; cleared on exit
+static const uint32_t MP3_BOOT_MS = 8000;   // module ignores the UART until it has booted
+bool sdBootBenched = false;                 // the SD task ran the benchmark; loop() logs it
+bool rtcBootSampleOk = false;               // second edge the RTC task caught; loop() applies it
+int64_t rtcBootSampleMono = 0;
+int64_t rtcBootSampleEpochUs = 0;
+
+#define TRACE_CAT2(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT2(a, b)
+#define TRACE_SPAN(name)                                                            \
+  static const uint16_t TRACE_CAT(traceId_, __LINE__) = traceRing.intern(name);      \
+  TraceScope<TraceRing<TRACE_RECORDS>> TRACE_CAT(traceSpan_, __LINE__)(traceRing, TRACE_CAT(traceId_, __LINE__))
+
+static uint32_t traceClockUs() { return (uint32_t)micros(); }
+
+static uint8_t traceTaskId() {
+  const TaskHandle_t t = xTaskGetCurrentTaskHandle();
+  if (t == traceLoopTask) return 0;
+  if (clipTaskHandle && t == clipTaskHandle) return 1;
+  for (TaskHandle_t b : bootTasks) {
+    if (b && t == b) return 2;
+  }
+  return TRACE_MAX_TASKS - 1;
+}
+
+static void traceJobSpan(const char *name, bool begin) {
+  const uint16_t id = traceRing.intern(name);
+  if (begin) traceRing.begin(id);
+  else traceRing.end(id);
+}
+
+// Periodic loop() work lives on a timer wheel; loop() sleeps until the next job deadline or audio
+// frame instead of a fixed delay (see loop_scheduler.h). Job stats are served at /metrics.
+LoopScheduler<20> loopJobs;
+static const uint32_t LOOP_JOB_PASS_BUDGET_US = 20000;   // later jobs wait a pass so frames keep their slot
+enum LoopJobPrio : uint8_t { JOB_PRIO_IO = 0, JOB_PRIO_UI = 1, JOB_PRIO_LOG = 2, JOB_PRIO_HOUSEKEEP = 3, JOB_PRIO_NET = 4 };
+int jobMp3 = -1;
+int jobNoiseLedTest = -1;
+int jobInternet = -1;
+int jobSync = -1;
+int jobDbSample = -1;
+int jobDbUpload = -1;
+int jobClipStream = -1;
+int jobFileExport = -1;
+int jobSdBench = -1;
+uint32_t nextFrameMs = 0;
+
+#if defined(CONFIG_HEAP_USE_HOOKS)
+// Called by the IDF allocator for every allocation/free on any task.
+extern "C" void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps) {
+  (void)caps;
+  if (ptr) heapStats.noteAlloc((uint32_t)size, heapLoopTask && xTaskGetCurrentTaskHandle() == heapLoopTask);
+}
+
+extern "C" void IRAM_ATTR esp_heap_trace_free_hook(void *ptr) {
+  if (ptr) heapStats.noteFree(heapLoopTask && xTaskGetCurrentTaskHandle() == heapLoopTask);
+}
+#endif
+
+static void onHeapAllocFailed(size_t size, uint32_t caps, const char *functionName) {
+  (void)caps;
+  (void)functionName;
+  heapStats.noteFailed((uint32_t)size);
+}
+
+// Walks the heap (takes the allocator lock), so it runs every HEAP_SNAPSHOT_MS and on /status.
+void snapshotHeap() {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  heapStats.snapshot(info.total_free_bytes, info.total_allocated_bytes, info.largest_free_block, info.minimum_free_bytes,
+                     info.allocated_blocks);
+  lastHeapSnapshotMs = millis();
+}
+
+// Scoped cycle-counter timer around one loop stage. The clock is latched at start; spans that
+// cross a CPU frequency change, or are long enough to wrap the 32-bit cycle counter, use
+// micros() (esp_timer, clock-independent). Keeps the old "<name> stall ms=" serial warning.
+// Named timers and the whole pass are also stall-tracer spans; a stall freezes the tracer.
+struct StageTimer {
+  LoopStage stage;
+  const char *stallName;
+  unsigned long stallMs;
+  uint32_t startCycles;
+  uint32_t startUs;
+  uint32_t startMhz;
+  int traceName;
+  bool done;
+
+  StageTimer(LoopStage s, const char *name = nullptr, unsigned long stall = 1000)
+    : stage(s), stallName(name), stallMs(stall), startCycles(ESP.getCycleCount()), startUs(micros()),
+      startMhz(getCpuFrequencyMhz()),
+      traceName(name ? traceRing.intern(name) : s == STAGE_LOOP ? traceRing.intern("loop") : -1), done(false) {
+    if (traceName >= 0) traceRing.begin((uint16_t)traceName);
+  }
+
+  ~StageTimer() { finish(); }
+
+  void finish() {
+    if (done) return;
+    done = true;
+    const uint32_t c0 = ESP.getCycleCount();
+    const uint32_t mhz = getCpuFrequencyMhz();
+    uint32_t us = micros() - startUs;
+    if (mhz == startMhz && us < 8000000UL) us = (c0 - startCycles) / mhz;
+    loopMetrics.stages[stage].record(us);
+    if (stage == STAGE_LOOP) loopMetrics.loopBusyUs += us;
+    if (traceName >= 0) traceRing.end((uint16_t)traceName);
+    if (stallName && (us / 1000UL) > stallMs) {
+      Serial.print(stallName);
+      Serial.print(" stall ms=");
+      Serial.println((unsigned long)(us / 1000UL));
+      traceRing.freeze(stallName, us / 1000UL);
+    }
+    loopMetrics.overheadNs += (uint64_t)(ESP.getCycleCount() - c0) * 1000U / mhz;
+  }
+};
+
 int lastPendingCountLogged = -9999;
 unsigned long lastPendingLogMs = 0;
 const unsigned long PENDING_LOG_INTERVAL_MS = 30000;
 
 const char* PENDING_EVENTS_PATH = "/pending_events.txt";
+static const size_t PENDING_LINE_MAX = 256;
 
 const char* DB_SERIES_PATH = "/db_series.txt";
 
+// Optional raw-sector ring for the db series: used instead of DB_SERIES_PATH when the card has an
+// MBR partition of type 0xDA ("non-FS data"). SD.begin() only mounts the FAT partition, so the ring
+// never touches the filesystem. Records are ts_ms (u64) + db10 (i16), little endian, plus a zone byte
+// for zones other than the first.
+static const uint8_t DB_RING_PART_TYPE = 0xDA;
+static const uint8_t DB_RING_RECORD_BYTES = 10;
+
+struct SdRawPartition {
+  uint32_t base = 0;
+  uint32_t count = 0;
+  uint32_t sectorCount() { return count; }
+  bool readSector(uint32_t i, uint8_t *b) { return SD.readRAW(b, base + i); }
+  bool writeSector(uint32_t i, const uint8_t *b) { return SD.writeRAW((uint8_t *)b, base + i); }
+};
+
+SdRawPartition dbRingPart;
+RingLog<SdRawPartition> dbRing;
+RingCursor dbRingTail;  // next record to upload, persisted in NVS "ringlog"
+
+// How the ring goes up: rows posts noise_db_series rows; blobs sends each closed hour as one
+// DBZ1 object per zone (db_blob.h) plus a noise_db_blobs index row. NVS "ringlog" key "mode".
+enum DbUploadMode : uint8_t { DB_UPLOAD_ROWS = 0, DB_UPLOAD_BLOBS = 1 };
+uint8_t dbUploadMode = DB_UPLOAD_ROWS;
+bool dbSeriesBacklog = false;     // blob mode stopped on its work budget with closed hours left
+uint32_t dbBlobsUploaded = 0;
+uint32_t dbBlobSamples = 0;
+uint32_t dbBlobBytes = 0;
+
+// SD card as the storage manager sees it (storage_budget.h). File calls open and close their file;
+// the root directory stays open across ticks while a scan lists it, so anything that remounts the
+// card checks isBusy() or calls dirClose() first (the next dirNext() then starts over).
+struct SdStorageFs {
+  File dir;
+  bool dirOpen = false;
+
+  bool isBusy() const { return dirOpen; }
+  void dirClose() {
+    if (dirOpen) dir.close();
+    dirOpen = false;
+  }
+
+  uint64_t freeBytes() { return SD.totalBytes() - SD.usedBytes(); }
+  int64_t size(const char *path) {
+    if (!SD.exists(path)) return -1;
+    File f = SD.open(path, FILE_READ);
+    if (!f) return -1;
+    int64_t n = (int64_t)f.size();
+    f.close();
+    return n;
+  }
+  int readAt(const char *path, uint32_t off, uint8_t *buf, int n) {
+    File f = SD.open(path, FILE_READ);
+    if (!f) return -1;
+    int got = 0;
+    if (off < f.size() && f.seek(off)) got = (int)f.read(buf, (size_t)n);
+    f.close();
+    return got;
+  }
+  bool append(const char *path, const uint8_t *buf, int n) {
+    TRACE_SPAN("sd.append");
+    File f = SD.open(path, FILE_APPEND);
+    if (!f) return false;
+    bool ok = f.write(buf, (size_t)n) == (size_t)n;
+    f.close();
+    return ok;
+  }
+  bool remove(const char *path) {
+    TRACE_SPAN("sd.remove");
+    return SD.remove(path);
+  }
+  bool rename(const char *from, const char *to) {
+    TRACE_SPAN("sd.rename");
+    return SD.rename(from, to);
+  }
+  bool dirNext(char *name, size_t cap, uint32_t &size) {
+    if (!dirOpen) {
+      dir = SD.open("/");
+      if (!dir) return false;
+      dirOpen = true;
+    }
+    while (true) {
+      File f = dir.openNextFile();
+      if (!f) {
+        dir.close();
+        dirOpen = false;
+        return false;
+      }
+      if (f.isDirectory()) {
+        f.close();
+        continue;
+      }
+      snprintf(name, cap, "%s", f.name());
+      size = (uint32_t)f.size();
+      f.close();
+      return true;
+    }
+  }
+};
+
+SdStorageFs storageFs;
+StorageManager<SdStorageFs> storageMgr;   // budgets in NVS "storage"; unset ones are shares of the card
+
+// /files lists the card with its own directory handle, so a listing never disturbs the storage
+// manager's scan.
+struct SdExportFs : SdStorageFs {
+  bool stat(const char *path, uint32_t &size, uint32_t &mtime) {
+    if (!SD.exists(path)) return false;
+    File f = SD.open(path, FILE_READ);
+    if (!f) return false;
+    const bool isDir = f.isDirectory();
+    size = (uint32_t)f.size();
+    mtime = (uint32_t)f.getLastWrite();
+    f.close();
+    return !isDir;
+  }
+  // Root files as "/name"; names too long to download are skipped.
+  bool listNext(char *name, size_t cap, uint32_t &size, uint32_t &mtime) {
+    if (!dirOpen) {
+      dir = SD.open("/");
+      if (!dir) return false;
+      dirOpen = true;
+    }
+    while (true) {
+      File f = dir.openNextFile();
+      if (!f) {
+        listEnd();
+        return false;
+      }
+      const char *n = f.name();
+      if (n[0] == '/') n++;
+      if (f.isDirectory() || strlen(n) + 2 > cap) {
+        f.close();
+        continue;
+      }
+      snprintf(name, cap, "/%s", n);
+      size = (uint32_t)f.size();
+      mtime = (uint32_t)f.getLastWrite();
+      f.close();
+      return true;
+    }
+  }
+  void listEnd() { dirClose(); }
+};
+
+// The download's socket, written without blocking: a slow client costs the loop nothing.
+struct FileExportSink {
+  WiFiClient client;
+  int write(const uint8_t *p, size_t n) {
+    const int fd = client.fd();
+    if (fd < 0) return -1;
+    const int w = ::send(fd, p, n, MSG_DONTWAIT);
+    if (w >= 0) return w;
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+  }
+  void close() { client.stop(); }
+};
+
+// One download at a time, streamed from jobFileExport through a single chunk buffer.
+SdExportFs exportFs;
+static uint8_t fileExportBuf[FILE_EXPORT_CHUNK];
+FileExport<SdExportFs, FileExportSink> fileExport;
+static const long FILE_LIST_DEFAULT = 100;
+static const long FILE_LIST_MAX = 500;
+String adminPassword;   // HTTP Basic password for user "admin" (NVS "admin" key "pw"); empty = /files off
+
 String lastRecordedWavPath = "";
 
+static const uint32_t MAJOR_CLIP_RATE = 16000;
+static const uint32_t MAJOR_CLIP_MS = 5000;
+
+// With the uplink up, a MAJOR clip streams to Storage while it is recorded (clip_stream.h). Its
+// event is queued at capture under the clip's SD name and held back from sync until the stream
+// ends; only a failed stream leaves the clip on SD for the usual upload. NVS "clipstream" key "en".
+bool clipStreamEnabled = true;
+ClipUpload clipUp;
+String clipLocalPath;   // SD name of the streaming clip; its queued event carries it until the end
+// The MAJOR event of a clip still streaming: sync leaves it queued until finishClipStream() says
+// where its audio is.
+static bool clipStreamHolds(const PendingEvent &e) {
+  return clipUp.getState() != CLIP_IDLE && clipLocalPath == e.audioPath;
+}
+uint32_t clipStreamOk = 0;
+uint32_t clipStreamFail = 0;
+uint32_t clipTtaLastMs = 0;   // last sample to Storage 2xx
+uint32_t clipTtaMaxMs = 0;
+static const size_t CLIP_HEAP_RESERVE = 64 * 1024;   // internal RAM left for the TLS session and the rest
+
+// Live levels for in-building displays (live_feed.h): one UDP multicast datagram per frame, or
+// per liveFeedPacer.intervalMs plus LED changes. Off by default; NVS "livefeed" keys en, ms,
+// group (a.b.c.d packed big-endian) and port.
+bool liveFeedEnabled = false;
+uint8_t liveFeedGroup[4] = { LIVE_FEED_GROUP[0], LIVE_FEED_GROUP[1], LIVE_FEED_GROUP[2], LIVE_FEED_GROUP[3] };
+uint16_t liveFeedPort = LIVE_FEED_PORT;
+LiveFeedPacer liveFeedPacer;
+WiFiUDP liveUdp;
+uint32_t liveFeedSeq = 0;
+uint32_t liveFeedSent = 0;
+uint32_t liveFeedErrors = 0;
+
 const unsigned long HTTP_TIMEOUT_MS = 6000;
 
 bool internetOk = false;
@@ -231,10 +674,8 @@ int dbChangeThreshold10 = 10;
 unsigned long dbHeartbeatMs = 8000;
 unsigned long dbBulkUploadIntervalMs = 3600000;
 
-unsigned long lastDbSampleMs = 0;
-int lastDbLogged10 = -999999;
-unsigned long lastDbRecordMs = 0;
 unsigned long lastDbBulkUploadMs = 0;
+static const uint32_t DB_UPLOAD_POLL_MS = 1000;   // while a retry backs off or events drain
 
 int mp3Volume = 30;
 
@@ -243,16 +684,16 @@ unsigned long lastMp3RxMs = 0;
 unsigned long lastMp3OkMs = 0;
 uint8_t mp3ConsecutiveFailCount = 0;
 bool mp3TfOnline = false;
-unsigned long lastMp3ProbeMs = 0;
-
-const int EVENT_LOG_MAX = 40;
-String eventLog[EVENT_LOG_MAX];
-int eventLogCount = 0;
-
-const int MONITOR_LOG_MAX = 80;
-String monitorLog[MONITOR_LOG_MAX];
-int monitorLogCount = 0;
-unsigned long lastMonitorLogTime = 0;
+static const uint32_t MP3_PROBE_MS = 5000;
+
+// Binary log rings, formatted only when read (/events, /monitor, Serial, SD export); see event_log.h.
+StructLog<6144> eventLogRing;
+StructLog<2048> monitorLogRing;
+#define EVLOG(sub, level, ...) eventLogRing.log((uint32_t)millis(), (sub), (level), __VA_ARGS__)
+uint32_t eventLogSerialSeq = 0;     // next record to echo on Serial
+uint32_t eventLogExportSeq = 0;     // next record to append to /event_log.txt
+static const int EVENT_LOG_SERIAL_BUDGET = 4;
+static const char *EVENT_LOG_EXPORT_PATH = "/event_log.txt";
 const unsigned long MONITOR_LOG_INTERVAL_MS = 250;
 
 // Philippines timezone (UTC +8)
@@ -261,6 +702,14 @@ const unsigned long MONITOR_LOG_INTERVAL_MS = 250;
 
 // ================= MP3 PLAYER =================
 HardwareSerial mp3(2);          // ADDED (UART2)
+// Commands are queued and paced from loop(); replies arrive through hooks (see mp3_driver.h).
+Mp3Driver<HardwareSerial> mp3Drv;
+static const uint8_t MP3_CMD_SELECT_DEV = 0x35;
+static const uint8_t MP3_CMD_VOLUME = 0x31;
+static const uint8_t MP3_CMD_PLAY_FOLDER = 0x42;
+static const uint8_t MP3_CMD_STOP = 0x16;
+static const uint8_t MP3_CMD_PAUSE = 0x0E;
+static const uint8_t MP3_CMD_QUERY_DEV = 0x18;
 
 // ================= PINS =================
 #define LED_GREEN   14
@@ -282,8 +731,13 @@ HardwareSerial mp3(2);          // ADDED (UART2)
 
 // ================= AUDIO =================
 #define BUFFER_LEN 256
-#define NOISE_FLOOR 25000
-#define SENSITIVITY 0.5
+
+// Level chain (dsp_pipeline.h): noise floor, sensitivity, smoothing, the averaging window and any
+// filters ahead of the RMS. DspProfileLegacy reads exactly as this firmware always has;
+// DspProfileAWeighted gives dB(A) with 125 ms time weighting.
+#define DSP_PROFILE DspProfileLegacy
+typedef DspPipeline<DSP_PROFILE> ZoneDsp;
+static_assert(DSP_PROFILE::blockLen == BUFFER_LEN, "DSP profile block length must match BUFFER_LEN");
 
 int YELLOW_THRESHOLD = 65;
 int RED_THRESHOLD = 70;
@@ -305,6 +759,21 @@ unsigned long lastSdFailMs = 0;
 bool sdInitOk = false;
 unsigned long lastSdBeginAttemptMs = 0;
 
+// SPI clock and write chunk picked by the SD benchmark (sd_bench.h); NVS namespace "sdtune".
+uint32_t sdSpiHz = SD_BENCH_SAFE_HZ;
+uint16_t sdWriteBufBytes = 512;
+bool sdTuned = false;
+uint32_t sdBenchWriteKBps = 0;
+uint32_t sdBenchReadKBps = 0;
+uint32_t sdBenchAppendUs = 0;
+SdBenchResult sdBenchLast;
+bool sdBenchHaveResult = false;
+const char* SD_BENCH_PATH = "/sdbench.tmp";
+// /sdinfo?bench=1 runs the sweep in a core 0 task. It remounts the card at every clock, so
+// sdReady() is false until jobSdBenchTick() sees the task finish.
+volatile bool sdBenchRunning = false;
+volatile bool sdBenchFinished = false;
+
 unsigned long lastSupabaseFailMs = 0;
 unsigned long lastSupabaseOkMs = 0;
 
@@ -348,7 +817,6 @@ int statusLedManualB = 0;
 bool setupComplete = false;
 
 #define HYSTERESIS_DB    3
-#define SMOOTH_ALPHA    0.1
 
 // ================= TIMING =================
 #define FIRST_WARNING_TIME   5000
@@ -358,23 +826,42 @@ bool setupComplete = false;
 #define LOG_INTERVAL_MS      2000
 #define DB_CHANGE_LOG        2
 
-#define AVG_WINDOW 10
-
 // ================= GLOBALS =================
-int32_t samples[BUFFER_LEN];
-
+// One I2S block (interleaved L/R when zoneCount == 2) and its per-zone split (zone_meter.h).
+int32_t i2sBlock[BUFFER_LEN * MAX_ZONES];
+int32_t zoneSamples[MAX_ZONES][BUFFER_LEN];
+int32_t *zoneFrame[MAX_ZONES] = { i2sBlock, zoneSamples[1] };   // each zone's samples; one zone reads i2sBlock in place
+int micFrameSamples = 0;  // valid samples per zone from the last readMicDB(), 0 on a drop
+
+// Zones: 1 = one mic on the left slot (the original wiring), 2 = a second mic with L/R high on the
+// right slot. Each zone has its own level, LED decision, escalation and db series.
+int zoneCount = 1;
+ZoneState zones[MAX_ZONES];
+ZoneDsp zoneDsp[MAX_ZONES];
+String zoneGroupId[MAX_ZONES];
+int micLoudestZone = 0;
+
+// /noise_log.txt lines are batched here: one open/append/close per flush instead of per line.
+char noiseLogBuf[512];
+size_t noiseLogLen = 0;
+unsigned long noiseLogFirstMs = 0;
+const unsigned long NOISE_LOG_FLUSH_MS = 60000;
+
+// Noise-source classifier (noise_classifier.h). It always labels; RED escalation ignores
+// confident non-crowd labels only when classifierSuppress is on.
+NoiseClassifier noiseClassifier;
+bool classifierSuppress = false;
+int classifierMinConfidence = 60;
+uint32_t classifierSuppressedFrames = 0;
+bool classifierSuppressing = false;
+
+// Loudest zone; drives the device-wide consumers (power policy, monitor, Serial, noise log).
 int rawDB = 0;
 double smoothDB = 0;
 int lastLoggedDB = -100;
 
-int avgBuffer[AVG_WINDOW];
-int avgIndex = 0;
-bool avgFilled = false;
-
-unsigned long redStartTime = 0;
-bool firstLogged = false;
-bool secondLogged = false;
-bool majorLogged = false;
+DspWindowAvg<DSP_PROFILE::avgWindow> levelAvg;
+int avgDB = 0;   // windowed average of smoothDB
 
 unsigned long lastLogTime = 0;
 LedState currentState = GREEN;
@@ -390,12 +877,10 @@ unsigned long firstWarningTimeMs = FIRST_WARNING_TIME;
 unsigned long secondWarningTimeMs = SECOND_WARNING_TIME;
 unsigned long majorWarningTimeMs = MAJOR_WARNING_TIME;
 
-unsigned long lastMajorAlertMs = 0;
-unsigned long silenceBelowRedStartMs = 0;
-
-String currentViolationGroupId = "";
+// LED decision + escalation state lives in each zone's engine (noise_engine.h); currentState is the
+// worst zone, which is what the noise LEDs show.
 
-String ledStateToString(LedState s) {
+const char *ledStateToString(LedState s) {
   switch (s) {
     case GREEN: return "GREEN";
     case YELLOW: return "YELLOW";
@@ -437,9 +922,10 @@ bool supabaseConfigured() {
   return (strlen(SUPABASE_URL) > 0) && (strlen(SUPABASE_API_KEY) > 0);
 }
 
-bool enqueuePendingEvent(const String &line) {
+bool enqueuePendingEvent(const char *line) {
   File f = SD.open(PENDING_EVENTS_PATH, FILE_APPEND);
   if (!f) {
+    loopMetrics.sdErrors++;
     sdAvailable = false;
     sdInitOk = false;
     lastSdFailMs = millis();
@@ -450,8 +936,26 @@ bool enqueuePendingEvent(const String &line) {
   return true;
 }
 
+// False until the SD boot task is done, so loop() never touches a card still being mounted, and
+// while an on-demand benchmark has it remounting.
 bool sdReady() {
-  return sdInitOk;
+  return sdInitOk && bootStages.ready(BOOT_SD) && !sdBenchRunning;
+}
+
+// Reads one line into buf (trimmed, NUL-terminated) without allocating. Over-long lines are cut at
+// len - 1 and the rest is skipped. Returns the trimmed length.
+size_t readPendingLine(File &in, char *buf, size_t len) {
+  size_t n = in.readBytesUntil('\n', buf, len - 1);
+  if (n == len - 1) {
+    while (in.available() && in.read() != '\n') {
+    }
+  }
+  buf[n] = '\0';
+  while (n > 0 && isspace((unsigned char)buf[n - 1])) buf[--n] = '\0';
+  size_t start = 0;
+  while (start < n && isspace((unsigned char)buf[start])) start++;
+  if (start > 0) memmove(buf, buf + start, n - start + 1);
+  return n - start;
 }
 
 static const char* sdCardTypeStr(uint8_t t) {
@@ -464,62 +968,354 @@ static const char* sdCardTypeStr(uint8_t t) {
   }
 }
 
+void loadSdTuning() {
+  preferences.begin("sdtune", true);
+  sdTuned = preferences.isKey("hz");
+  sdSpiHz = preferences.getUInt("hz", SD_BENCH_SAFE_HZ);
+  sdWriteBufBytes = (uint16_t)preferences.getUInt("buf", 512);
+  sdBenchWriteKBps = preferences.getUInt("wr", 0);
+  sdBenchReadKBps = preferences.getUInt("rd", 0);
+  sdBenchAppendUs = preferences.getUInt("app", 0);
+  preferences.end();
+  if (sdSpiHz < SD_BENCH_SAFE_HZ || sdSpiHz > 40000000) sdSpiHz = SD_BENCH_SAFE_HZ;
+  sdWriteBufBytes = constrain(sdWriteBufBytes, (uint16_t)512, (uint16_t)4096);
+}
+
+void saveSdTuning() {
+  preferences.begin("sdtune", false);
+  if (sdTuned) {
+    preferences.putUInt("hz", sdSpiHz);
+    preferences.putUInt("buf", sdWriteBufBytes);
+    preferences.putUInt("wr", sdBenchWriteKBps);
+    preferences.putUInt("rd", sdBenchReadKBps);
+    preferences.putUInt("app", sdBenchAppendUs);
+  } else {
+    preferences.clear();
+  }
+  preferences.end();
+}
+
+// Mounts at the tuned clock; if that no longer works (card swapped, wiring changed) it drops
+// back to SD_BENCH_SAFE_HZ and forgets the tuning so the next boot re-benchmarks.
+bool sdBegin() {
+  TRACE_SPAN("sdBegin");
+  if (SD.begin(SD_CS, SPI, sdSpiHz) && SD.cardType() != CARD_NONE) return true;
+  if (sdSpiHz == SD_BENCH_SAFE_HZ) return false;
+  SD.end();
+  Serial.println("SD mount failed at " + String((unsigned long)(sdSpiHz / 1000UL)) + " kHz, falling back to safe clock");
+  sdSpiHz = SD_BENCH_SAFE_HZ;
+  sdWriteBufBytes = 512;
+  sdTuned = false;
+  saveSdTuning();
+  return SD.begin(SD_CS, SPI, sdSpiHz) && SD.cardType() != CARD_NONE;
+}
+
+struct SdBenchIo {
+  File f;
+  bool mount(uint32_t hz) {
+    SD.end();
+    return SD.begin(SD_CS, SPI, hz) && SD.cardType() != CARD_NONE;
+  }
+  uint32_t nowUs() { return micros(); }
+  bool open(bool write, bool append) {
+    f = SD.open(SD_BENCH_PATH, write ? (append ? FILE_APPEND : FILE_WRITE) : FILE_READ);
+    return (bool)f;
+  }
+  size_t write(const uint8_t *b, size_t n) { return f.write(b, n); }
+  size_t read(uint8_t *b, size_t n) { return f.read(b, n); }
+  void close() { f.close(); }
+  void remove() { SD.remove(SD_BENCH_PATH); }
+  void idle() { yield(); }
+};
+
+// Blocks for a few seconds (~130 KB of I/O per clock step), so it only runs off the loop: from the
+// SD boot task, or from sdBenchTask() after startSdBench() flushed the ring.
+bool runSdBenchmark() {
+  TRACE_SPAN("runSdBenchmark");
+  if (!sdInitOk) return false;   // runs before sdReady() in both cases
+
+  uint8_t *scratch = (uint8_t *)malloc(4096);
+  if (!scratch) return false;
+  SdBenchIo io;
+  SdBenchConfig cfg;
+  bool ok = sdBenchRun(io, cfg, scratch, 4096, sdBenchLast);
+  free(scratch);
+  sdBenchHaveResult = true;
+
+  sdTuned = ok;
+  sdSpiHz = ok ? sdBenchLast.bestHz : SD_BENCH_SAFE_HZ;
+  sdWriteBufBytes = ok ? sdBenchLast.bestBufBytes : 512;
+  sdBenchWriteKBps = sdBenchLast.bestWriteKBps;
+  sdBenchReadKBps = sdBenchLast.bestReadKBps;
+  sdBenchAppendUs = sdBenchLast.bestAppendUs;
+  saveSdTuning();
+
+  sdInitOk = (SD.cardType() != CARD_NONE);
+  sdAvailable = sdInitOk;
+  if (!sdInitOk) {
+    lastSdFailMs = millis();
+    loopMetrics.sdErrors++;
+  }
+  return ok;
+}
+
+static void sdBenchTask(void *arg) {
+  (void)arg;
+  runSdBenchmark();
+  sdBenchFinished = true;
+  vTaskDelete(nullptr);
+}
+
+// Why the card cannot be remounted now, or nullptr. An export, a storage scan mid-listing or a
+// clip on its way to SD holds a File that the remount would invalidate.
+static const char *sdBenchBlocker() {
+  if (sdBenchRunning) return "benchmark already running";
+  if (!sdInitOk) return "no card";
+  if (fileExport.active) return "file export in progress";
+  if (storageFs.isBusy()) return "storage scan in progress";
+  if (clipUp.getState() != CLIP_IDLE) return "MAJOR clip in progress";
+  return nullptr;
+}
+
+static bool startSdBench() {
+  if (dbRing.ready && !dbRing.flush()) return false;
+  flushNoiseLog();
+  sdBenchFinished = false;
+  sdBenchRunning = true;
+  if (xTaskCreatePinnedToCore(sdBenchTask, "sd_bench", 6144, nullptr, 1, nullptr, 0) != pdPASS) {
+    sdBenchRunning = false;
+    return false;
+  }
+  loopJobs.kick(jobSdBench, millis());
+  return true;
+}
+
+// Separate from runSdBenchmark() because the event log is written from loop() only.
+void logSdBench() {
+  EVLOG(LOG_SD, LOG_INFO, "SD bench: {} kHz buf={} wr={}KB/s rd={}KB/s append={}us ({} ms)", (unsigned long)(sdSpiHz / 1000UL),
+        sdWriteBufBytes, (unsigned long)sdBenchWriteKBps, (unsigned long)sdBenchReadKBps, (unsigned long)sdBenchAppendUs,
+        (unsigned long)sdBenchLast.elapsedMs);
+}
+
 static bool tryInitSd(bool force) {
   unsigned long now = millis();
   const unsigned long COOLDOWN_MS = 30000;
   if (!force && lastSdBeginAttemptMs != 0 && (now - lastSdBeginAttemptMs < COOLDOWN_MS)) return false;
   lastSdBeginAttemptMs = now;
 
-  bool ok = SD.begin(SD_CS, SPI, 1000000);
-  uint8_t ct = SD.cardType();
-  sdInitOk = ok && (ct != CARD_NONE);
+  // sdBegin() may remount; initStorageManager() below restarts the scan on the new mount.
+  storageFs.dirClose();
+  sdInitOk = sdBegin();
   sdAvailable = sdInitOk;
-  if (!sdInitOk) lastSdFailMs = now;
+  if (!sdInitOk) {
+    lastSdFailMs = now;
+    loopMetrics.sdErrors++;
+  }
+  if (sdInitOk) initDbRing();
+  if (sdInitOk) initStorageManager();
   return sdInitOk;
 }
 
+static bool findDbRingPartition(uint32_t &base, uint32_t &count) {
+  uint8_t mbr[512];
+  if (!SD.readRAW(mbr, 0)) return false;
+  if (mbr[510] != 0x55 || mbr[511] != 0xAA) return false;
+  for (int i = 0; i < 4; i++) {
+    const uint8_t *e = mbr + 446 + i * 16;
+    if (e[4] != DB_RING_PART_TYPE) continue;
+    base = (uint32_t)e[8] | ((uint32_t)e[9] << 8) | ((uint32_t)e[10] << 16) | ((uint32_t)e[11] << 24);
+    count = (uint32_t)e[12] | ((uint32_t)e[13] << 8) | ((uint32_t)e[14] << 16) | ((uint32_t)e[15] << 24);
+    return base != 0 && count >= 2;
+  }
+  return false;
+}
+
+// Also runs on every SD re-init. A ring that is already up keeps its buffered records and the
+// tail cursor in RAM (newer than NVS) instead of recovering from the card and losing them.
+void initDbRing() {
+  uint32_t base = 0, count = 0;
+  if (!findDbRingPartition(base, count)) {
+    dbRing.ready = false;
+    return;
+  }
+  if (dbRing.ready && base == dbRingPart.base && count == dbRingPart.count && dbRing.resume()) return;
+  dbRing.ready = false;
+  dbRingPart.base = base;
+  dbRingPart.count = count;
+  if (!dbRing.begin(&dbRingPart)) return;
+
+  preferences.begin("ringlog", true);
+  dbRingTail.seq = preferences.getUInt("tseq", 0);
+  dbRingTail.rec = (uint16_t)preferences.getUInt("trec", 0);
+  dbUploadMode = preferences.getUInt("mode", DB_UPLOAD_ROWS) == DB_UPLOAD_BLOBS ? DB_UPLOAD_BLOBS : DB_UPLOAD_ROWS;
+  preferences.end();
+
+  Serial.println("DB ring: " + String((unsigned long)dbRingPart.count) + " sectors @" + String((unsigned long)dbRingPart.base) +
+                 " head=" + String((unsigned long)dbRing.headSeq) + " probes=" + String((unsigned long)dbRing.sectorReads));
+}
+
+// Budgets left at 0 in NVS follow the card: 40% recordings, 20% db series, 10% noise log,
+// 2% pending events (each capped at 1 GB), plus room for 8 MAJOR clips kept free.
+void initStorageManager() {
+  const uint64_t total = SD.totalBytes();
+  const uint32_t pct[STORE_CLASS_COUNT] = { 20, 10, 2, 40 };
+  const char *keys[STORE_CLASS_COUNT] = { "db", "noise", "pend", "rec" };
+  StorageConfig &c = storageMgr.cfg;
+  preferences.begin("storage", true);
+  for (int i = 0; i < STORE_CLASS_COUNT; i++) {
+    uint64_t share = total * pct[i] / 100ULL;
+    if (share > (1ULL << 30)) share = 1ULL << 30;
+    c.budget[i] = preferences.getUInt(keys[i], 0);
+    if (c.budget[i] == 0) c.budget[i] = (uint32_t)share;
+  }
+  c.retentionDays = (uint16_t)preferences.getUInt("ret", 14);
+  preferences.end();
+  c.retentionDays = constrain(c.retentionDays, (uint16_t)7, (uint16_t)14);
+  c.majorReserveBytes = 8UL * (44UL + 160000UL);
+  c.localOffsetSec = GMT_OFFSET_SEC;
+  storageMgr.begin(&storageFs);
+}
+
+void saveDbRingTail() {
+  preferences.begin("ringlog", false);
+  preferences.putUInt("tseq", dbRingTail.seq);
+  preferences.putUInt("trec", dbRingTail.rec);
+  preferences.end();
+}
+
+static void noteDbRingWriteFail() {
+  loopMetrics.sdErrors++;
+  sdAvailable = false;
+  sdInitOk = false;
+  lastSdFailMs = millis();
+}
+
 uint64_t getEpochMs() {
-  time_t sec = time(NULL);
-  if (sec <= 1000) return 0;
-  return ((uint64_t)sec * 1000ULL) + (uint64_t)(millis() % 1000);
+  return clockService.nowEpochMs(esp_timer_get_time());
 }
 
-bool appendDbSeriesRecord(uint64_t tsMs, int db10) {
+// device_id for a zone's rows, so zones go through the unchanged upload schema: the first zone
+// keeps DEVICE_ID (single-zone data looks exactly as before), zone 2 is DEVICE_ID + "_z2".
+const char *zoneDeviceId(uint8_t zone) {
+  static char ids[MAX_ZONES][48];
+  if (zone == 0 || zone >= MAX_ZONES) return DEVICE_ID;
+  if (ids[zone][0] == '\0') snprintf(ids[zone], sizeof(ids[zone]), "%s_z%d", DEVICE_ID, zone + 1);
+  return ids[zone];
+}
+
+// Counter value (µs) for an earlier millis() reading; millis() runs off the same esp_timer.
+static int64_t monoUsFromMillis(uint32_t ms) {
+  int64_t nowUs = esp_timer_get_time();
+  uint32_t nowMs = (uint32_t)(nowUs / 1000);
+  return nowUs - (int64_t)(uint32_t)(nowMs - ms) * 1000LL;
+}
+
+static void disciplineClockFromSystemTime(ClockSource src) {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  int64_t mono = esp_timer_get_time();
+  if (tv.tv_sec <= 1000) return;
+  if (!clockService.discipline(mono, (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec, src)) return;
+  if (clockService.syncs > 1) {
+    Serial.println("Clock " + String(CLOCK_SOURCE_NAMES[src]) + " offset_us=" + String((long long)clockService.lastOffsetUs) +
+                   " drift_ppb=" + String((long)clockService.driftPpb));
+  }
+}
+
+void bufferPreSyncDbSample(int db10, uint8_t zone) {
+  if (preSyncDbCount == PRESYNC_DB_CAP) {
+    preSyncDbHead = (preSyncDbHead + 1) % PRESYNC_DB_CAP;
+    preSyncDbCount--;
+    preSyncDbDropped++;
+  }
+  PreSyncDbSample &p = preSyncDb[(preSyncDbHead + preSyncDbCount) % PRESYNC_DB_CAP];
+  p.monoMs = millis();
+  p.db10 = (int16_t)db10;
+  p.zone = zone;
+  preSyncDbCount++;
+}
+
+// Once the clock is synced, gives buffered samples and RAM-queued events their epoch time.
+void stampPreSyncSamples() {
+  if (!clockService.synced) return;
+  for (int i = 0; i < eventQueue.count; i++) {
+    PendingEvent &e = eventQueue.items[i];
+    if (e.eventTsMs == 0) e.eventTsMs = clockService.toEpochMs(monoUsFromMillis(e.queuedMs));
+  }
+  int written = 0;
+  while (preSyncDbCount > 0) {
+    const PreSyncDbSample &p = preSyncDb[preSyncDbHead];
+    if (!appendDbSeriesRecord(clockService.toEpochMs(monoUsFromMillis(p.monoMs)), p.db10, p.zone)) break;
+    preSyncDbHead = (preSyncDbHead + 1) % PRESYNC_DB_CAP;
+    preSyncDbCount--;
+    written++;
+  }
+  if (written > 0) {
+    EVLOG(LOG_CLOCK, LOG_INFO, "Stamped {} pre-sync dB samples", written);
+  }
+}
+
+bool appendDbSeriesRecord(uint64_t tsMs, int db10, uint8_t zone) {
   if (!sdReady()) return false;
+  if (dbRing.ready) {
+    // Zone 1 records keep the original 10 bytes; other zones append their zone byte.
+    uint8_t rec[DB_RING_RECORD_BYTES + 1];
+    int16_t v = (int16_t)db10;
+    memcpy(rec, &tsMs, 8);
+    memcpy(rec + 8, &v, 2);
+    rec[DB_RING_RECORD_BYTES] = zone;
+    if (!dbRing.append(rec, zone ? DB_RING_RECORD_BYTES + 1 : DB_RING_RECORD_BYTES, millis())) {
+      noteDbRingWriteFail();
+      return false;
+    }
+    return true;
+  }
+  heapStats.markEvent();   // the VFS allocates per open()
   File f = SD.open(DB_SERIES_PATH, FILE_APPEND);
   if (!f) {
+    loopMetrics.sdErrors++;
     sdAvailable = false;
     sdInitOk = false;
     lastSdFailMs = millis();
     return false;
   }
-  f.print(String((unsigned long long)tsMs));
-  f.print('|');
-  f.println(db10);
+  char line[40];
+  int n = zone ? snprintf(line, sizeof(line), "%llu|%d|%d\r\n", (unsigned long long)tsMs, db10, (int)zone)
+               : snprintf(line, sizeof(line), "%llu|%d\r\n", (unsigned long long)tsMs, db10);
+  f.write((const uint8_t *)line, (size_t)n);
   f.close();
   return true;
 }
 
 bool tryBulkUploadDbSeries(unsigned long now) {
+  TRACE_SPAN("tryBulkUploadDbSeries");
   (void)now;
   if (!wifiConnected) {
-    logSupabaseStatus(getTimeString() + " | DB series upload skipped: offline");
+    EVLOG(LOG_DBS, LOG_DEBUG, "DB series upload skipped: offline");
     return false;
   }
   if (!internetOk) {
-    logSupabaseStatus(getTimeString() + " | DB series upload skipped: no internet");
+    EVLOG(LOG_DBS, LOG_DEBUG, "DB series upload skipped: no internet");
     return false;
   }
   if (!supabaseConfigured()) {
-    logSupabaseStatus(getTimeString() + " | DB series upload skipped: supabase not configured");
+    EVLOG(LOG_DBS, LOG_DEBUG, "DB series upload skipped: supabase not configured");
     return false;
   }
   if (!sdReady()) {
-    logSupabaseStatus(getTimeString() + " | DB series upload skipped: SD not available");
+    EVLOG(LOG_DBS, LOG_DEBUG, "DB series upload skipped: SD not available");
     return false;
   }
 
+  // This rewrites the file too; a half-done roll-up starts over afterwards.
+  storageMgr.cancel(STORE_DB_SERIES);
+
+  // Ring mode: drain any text file left from before the ring existed, then the ring.
   File in = SD.open(DB_SERIES_PATH, FILE_READ);
+  if (dbRing.ready && (!in || in.size() == 0)) {
+    if (in) in.close();
+    return tryBulkUploadDbRing();
+  }
   if (!in) return false;
 
   File out = SD.open("/db_series_tmp.txt", FILE_WRITE);
@@ -530,7 +1326,8 @@ bool tryBulkUploadDbSeries(unsigned long now) {
 
   unsigned long startMs = millis();
   const unsigned long maxWorkMs = 800;
-  const int maxBatch = 120;
+  const int maxBatch = SYNC_BATCH_CAP;
+  const int batchTarget = syncSched.batchSize(SYNC_PRIO_DB_SERIES, 60, maxBatch);
 
   bool didUploadAny = false;
 
@@ -556,7 +1353,7 @@ bool tryBulkUploadDbSeries(unsigned long now) {
 
     String lines[maxBatch];
     int n = 0;
-    while (in.available() && n < maxBatch) {
+    while (in.available() && n < batchTarget) {
       String line = in.readStringUntil('\n');
       line.trim();
       if (line.length() == 0) continue;
@@ -565,7 +1362,7 @@ bool tryBulkUploadDbSeries(unsigned long now) {
 
     if (n == 0) continue;
 
-    logSupabaseStatus(getTimeString() + " | DB series upload: batch=" + String(n));
+    EVLOG(LOG_DBS, LOG_INFO, "DB series upload: batch={}", n);
 
     String body = "[";
     for (int i = 0; i < n; i++) {
@@ -576,10 +1373,12 @@ bool tryBulkUploadDbSeries(unsigned long now) {
         continue;
       }
       String ts = lines[i].substring(0, p);
-      String db10s = lines[i].substring(p + 1);
+      int pz = lines[i].indexOf('|', p + 1);
+      String db10s = (pz < 0) ? lines[i].substring(p + 1) : lines[i].substring(p + 1, pz);
+      uint8_t zone = (pz < 0) ? 0 : (uint8_t)lines[i].substring(pz + 1).toInt();
       if (body.length() > 1) body += ",";
       body += "{";
-      body += "\"device_id\":\"" + String(DEVICE_ID) + "\",";
+      body += "\"device_id\":\"" + String(zoneDeviceId(zone)) + "\",";
       body += "\"ts_ms\":" + ts + ",";
       body += "\"db10\":" + db10s;
       body += "}";
@@ -591,7 +1390,8 @@ bool tryBulkUploadDbSeries(unsigned long now) {
     String url = String(SUPABASE_URL) + "/rest/v1/noise_db_series";
     bool ok = supabasePostJson(url, body, postCode, resp);
     if (!ok) {
-      logSupabaseStatus(getTimeString() + " | DB series upload FAIL | HTTP " + String(postCode) + " | " + truncateForLog(resp, 180));
+      syncSched.onFailure(SYNC_PRIO_DB_SERIES, millis(), esp_random());
+      EVLOG(LOG_DBS, LOG_WARN, "DB series upload FAIL | HTTP {} | {}", postCode, truncateForLog(resp, 180));
       for (int i = 0; i < n; i++) out.println(lines[i]);
       while (in.available()) {
         String rest = in.readStringUntil('\n');
@@ -601,7 +1401,8 @@ bool tryBulkUploadDbSeries(unsigned long now) {
       break;
     }
 
-    logSupabaseStatus(getTimeString() + " | DB series upload OK | HTTP " + String(postCode));
+    syncSched.onSuccess(SYNC_PRIO_DB_SERIES, millis());
+    EVLOG(LOG_DBS, LOG_INFO, "DB series upload OK | HTTP {}", postCode);
 
     didUploadAny = true;
   }
@@ -610,6 +1411,7 @@ bool tryBulkUploadDbSeries(unsigned long now) {
   out.close();
 
   if (didUploadAny) {
+    TRACE_SPAN("sd.swapDbSeries");
     SD.remove(DB_SERIES_PATH);
     SD.rename("/db_series_tmp.txt", DB_SERIES_PATH);
   } else {
@@ -618,16 +1420,242 @@ bool tryBulkUploadDbSeries(unsigned long now) {
   return didUploadAny;
 }
 
+bool tryBulkUploadDbRing() {
+  // Close the open sector first so the persisted tail never points into records that a reboot would lose.
+  if (!dbRing.flush()) {
+    noteDbRingWriteFail();
+    return false;
+  }
+  if (dbUploadMode == DB_UPLOAD_BLOBS) return tryBulkUploadDbBlobs();
+
+  unsigned long startMs = millis();
+  const unsigned long maxWorkMs = 800;
+  const int batchTarget = syncSched.batchSize(SYNC_PRIO_DB_SERIES, 60, SYNC_BATCH_CAP);
+
+  bool didUploadAny = false;
+
+  while (dbRing.hasData(dbRingTail) && (millis() - startMs <= maxWorkMs)) {
+    server.handleClient();
+    yield();
+
+    String body = "[";
+    int n = 0;
+    RingCursor next = dbRing.read(dbRingTail, (uint32_t)batchTarget, [&](const uint8_t *p, uint8_t len) {
+      if (len < DB_RING_RECORD_BYTES) return;
+      uint64_t ts;
+      int16_t db10;
+      memcpy(&ts, p, 8);
+      memcpy(&db10, p + 8, 2);
+      uint8_t zone = (len > DB_RING_RECORD_BYTES) ? p[DB_RING_RECORD_BYTES] : 0;
+      if (body.length() > 1) body += ",";
+      body += "{";
+      body += "\"device_id\":\"" + String(zoneDeviceId(zone)) + "\",";
+      body += "\"ts_ms\":" + String((unsigned long long)ts) + ",";
+      body += "\"db10\":" + String((int)db10);
+      body += "}";
+      n++;
+    });
+    body += "]";
+
+    if (n == 0) {
+      // Only unreadable sectors in this span; skip past them.
+      if (next.seq == dbRingTail.seq && next.rec == dbRingTail.rec) break;
+      dbRingTail = next;
+      continue;
+    }
+
+    EVLOG(LOG_DBS, LOG_INFO, "DB series upload (ring): batch={}", n);
+
+    int postCode = 0;
+    String resp;
+    String url = String(SUPABASE_URL) + "/rest/v1/noise_db_series";
+    if (!supabasePostJson(url, body, postCode, resp)) {
+      syncSched.onFailure(SYNC_PRIO_DB_SERIES, millis(), esp_random());
+      EVLOG(LOG_DBS, LOG_WARN, "DB series upload FAIL | HTTP {} | {}", postCode, truncateForLog(resp, 180));
+      break;
+    }
+
+    syncSched.onSuccess(SYNC_PRIO_DB_SERIES, millis());
+    EVLOG(LOG_DBS, LOG_INFO, "DB series upload OK | HTTP {}", postCode);
+    dbRingTail = next;
+    didUploadAny = true;
+  }
+
+  if (didUploadAny) saveDbRingTail();
+  return didUploadAny;
+}
+
+// Ring records for dbBlobEncodeHour(), read 32 at a time. position() is the cursor of the next
+// record not yet consumed, so the tail can stop exactly at the first record of the next hour.
+struct DbRingBlobSource {
+  static const int BATCH = 32;
+  RingCursor start;           // cursor of the batch's first record
+  RingCursor end;             // cursor after the batch
+  DbSample batch[BATCH];
+  uint8_t rawIndex[BATCH];    // record number within the batch (short records are skipped)
+  int n = 0;
+  int i = 0;
+
+  void begin(const RingCursor &from) {
+    start = end = from;
+    n = i = 0;
+  }
+
+  bool peek(DbSample &s) {
+    while (i >= n) {
+      if (!refill()) return false;
+    }
+    s = batch[i];
+    return true;
+  }
+
+  void pop() { i++; }
+
+  RingCursor position() {
+    if (i >= n) return end;
+    return dbRing.read(start, rawIndex[i], [](const uint8_t *, uint8_t) {});
+  }
+
+  bool refill() {
+    if (!dbRing.hasData(end)) return false;
+    server.handleClient();
+    yield();
+    start = end;
+    n = i = 0;
+    uint8_t rec = 0;
+    RingCursor next = dbRing.read(start, BATCH, [&](const uint8_t *p, uint8_t len) {
+      if (len >= DB_RING_RECORD_BYTES) {
+        DbSample &s = batch[n];
+        memcpy(&s.tsMs, p, 8);
+        memcpy(&s.db10, p + 8, 2);
+        s.zone = (len > DB_RING_RECORD_BYTES) ? p[DB_RING_RECORD_BYTES] : 0;
+        rawIndex[n++] = rec;
+      }
+      rec++;
+    });
+    if (next.seq == start.seq && next.rec == start.rec) return false;
+    end = next;
+    return true;
+  }
+};
+
+struct DbBlobFileSink {
+  File f;
+  bool write(const uint8_t *p, size_t len) { return f.write(p, len) == len; }
+};
+
+String dbBlobObjectPath(const DbBlobInfo &info) {
+  return String(zoneDeviceId(info.zone)) + "/db/" + String((unsigned long long)info.hourStartMs) + "_" +
+         String((unsigned long long)info.firstTsMs) + ".dbz";
+}
+
+// Blobs are streamed to /dbblob_<zone>.tmp, then PUT to the recordings bucket and indexed. The
+// object path and the index key are fixed by the hour and its first sample, so a retried hour
+// overwrites what a half-finished attempt left behind.
+struct DbBlobSupabaseDst {
+  DbBlobFileSink sinks[DB_BLOB_MAX_ZONES];
+
+  static String tmpPath(uint8_t zone) { return "/dbblob_" + String(zone) + ".tmp"; }
+
+  DbBlobFileSink *open(uint8_t zone, uint64_t hourStartMs) {
+    (void)hourStartMs;
+    heapStats.markEvent();   // the VFS allocates per open()
+    sinks[zone].f = SD.open(tmpPath(zone).c_str(), FILE_WRITE);
+    return sinks[zone].f ? &sinks[zone] : nullptr;
+  }
+
+  bool store(const DbBlobInfo &info) {
+    sinks[info.zone].f.close();
+    const String local = tmpPath(info.zone);
+    const String objPath = dbBlobObjectPath(info);
+    int code = 0;
+    String resp;
+    if (!supabaseUploadFileToRecordsBucket(objPath, local, code, resp, "application/octet-stream")) {
+      EVLOG(LOG_DBS, LOG_WARN, "DB blob upload FAIL | {} | HTTP {} | {}", objPath, code, truncateForLog(resp, 180));
+      return false;
+    }
+
+    String body;
+    body.reserve(320);
+    body += "{";
+    body += "\"device_id\":\"" + String(zoneDeviceId(info.zone)) + "\",";
+    body += "\"hour_start_ms\":" + String((unsigned long long)info.hourStartMs) + ",";
+    body += "\"ts_first_ms\":" + String((unsigned long long)info.firstTsMs) + ",";
+    body += "\"ts_last_ms\":" + String((unsigned long long)info.lastTsMs) + ",";
+    body += "\"samples\":" + String((unsigned long)info.samples) + ",";
+    body += "\"bytes\":" + String((unsigned long)info.bytes) + ",";
+    body += "\"crc32\":" + String((unsigned long)info.crc) + ",";
+    body += "\"db10_min\":" + String((int)info.minDb10) + ",";
+    body += "\"db10_max\":" + String((int)info.maxDb10) + ",";
+    body += "\"codec\":\"dbz1\",";
+    body += "\"object_path\":\"" + objPath + "\"";
+    body += "}";
+    String url = String(SUPABASE_URL) + "/rest/v1/noise_db_blobs?on_conflict=device_id,hour_start_ms,ts_first_ms";
+    if (!supabasePostJson(url, body, code, resp)) {
+      EVLOG(LOG_DBS, LOG_WARN, "DB blob index FAIL | {} | HTTP {} | {}", objPath, code, truncateForLog(resp, 180));
+      return false;
+    }
+    SD.remove(local.c_str());
+    dbBlobsUploaded++;
+    dbBlobSamples += info.samples;
+    dbBlobBytes += info.bytes;
+    return true;
+  }
+
+  void discard(uint8_t zone) {
+    if (sinks[zone].f) sinks[zone].f.close();
+    SD.remove(tmpPath(zone).c_str());
+  }
+};
+
+// Blob mode: one closed hour per step; the tail moves past an hour only after every zone's
+// object and index row for it are stored, and is saved per hour so a later failure does not
+// resend it. The hour being written waits for the next run.
+bool tryBulkUploadDbBlobs() {
+  unsigned long startMs = millis();
+  const unsigned long maxWorkMs = 800;
+  DbRingBlobSource src;
+  DbBlobSupabaseDst dst;
+  bool didUploadAny = false;
+  dbSeriesBacklog = false;
+
+  for (;;) {
+    src.begin(dbRingTail);
+    DbBlobInfo info[DB_BLOB_MAX_ZONES];
+    int n = 0;
+    const uint64_t nowEpochMs = clockService.synced ? getEpochMs() : 0;
+    DbBlobStep r = dbBlobEncodeHour<DbRingBlobSource, DbBlobSupabaseDst, DbBlobFileSink>(src, dst, nowEpochMs, info, &n);
+    if (r == DB_BLOB_FAILED) {
+      syncSched.onFailure(SYNC_PRIO_DB_SERIES, millis(), esp_random());
+      break;
+    }
+    if (r != DB_BLOB_STORED) break;
+
+    syncSched.onSuccess(SYNC_PRIO_DB_SERIES, millis());
+    dbRingTail = src.position();
+    saveDbRingTail();
+    didUploadAny = true;
+    uint32_t samples = 0, bytes = 0;
+    for (int i = 0; i < n; i++) {
+      samples += info[i].samples;
+      bytes += info[i].bytes;
+    }
+    EVLOG(LOG_DBS, LOG_INFO, "DB blob upload OK | hour={} zones={} samples={} bytes={}",
+          (unsigned long long)info[0].hourStartMs, n, (unsigned long)samples, (unsigned long)bytes);
+
+    if (millis() - startMs > maxWorkMs) {
+      dbSeriesBacklog = dbRing.hasData(dbRingTail);
+      break;
+    }
+  }
+  return didUploadAny;
+}
+
 String truncateForLog(const String &s, int maxLen) {
   if (s.length() <= (unsigned)maxLen) return s;
   return s.substring(0, maxLen) + "...";
 }
 
-void logSupabaseStatus(const String &line) {
-  appendEventLog(line);
-  Serial.println(line);
-}
-
 int countPendingEventsOnSD() {
   static unsigned long lastCountMs = 0;
   static int lastCount = -1;
@@ -657,10 +1685,12 @@ int countPendingEventsOnSD() {
   f.close();
   lastCount = count;
   lastCountMs = now;
+  pendingEventsKnown = count;
   return count;
 }
 
 bool supabasePostJson(const String &url, const String &jsonBody, int &httpCodeOut, String &responseOut) {
+  TRACE_SPAN("supabasePostJson");
   WiFiClientSecure client;
   client.setInsecure();
 
@@ -679,16 +1709,21 @@ bool supabasePostJson(const String &url, const String &jsonBody, int &httpCodeOu
   http.addHeader("Authorization", String("Bearer ") + SUPABASE_API_KEY);
   http.addHeader("Prefer", "return=representation,resolution=merge-duplicates");
 
+  unsigned long t0 = millis();
   httpCodeOut = http.POST((uint8_t*)jsonBody.c_str(), jsonBody.length());
   responseOut = http.getString();
   http.end();
+  loopMetrics.noteHttp(httpCodeOut);
   bool ok = (httpCodeOut >= 200 && httpCodeOut < 300);
+  if (ok) syncSched.noteTransfer(jsonBody.length(), millis() - t0);
   if (ok) markSupabaseOk();
   else markSupabaseFail();
   return ok;
 }
 
-bool supabaseUploadFileToRecordsBucket(const String &objectPath, const String &localFilePath, int &httpCodeOut, String &responseOut) {
+bool supabaseUploadFileToRecordsBucket(const String &objectPath, const String &localFilePath, int &httpCodeOut, String &responseOut,
+                                       const char *contentType) {
+  TRACE_SPAN("supabaseUploadFileToRecordsBucket");
   File f = SD.open(localFilePath.c_str(), FILE_READ);
   if (!f) {
     httpCodeOut = -1;
@@ -712,7 +1747,7 @@ bool supabaseUploadFileToRecordsBucket(const String &objectPath, const String &l
 
   http.setTimeout(HTTP_TIMEOUT_MS);
 
-  http.addHeader("Content-Type", "audio/wav");
+  http.addHeader("Content-Type", contentType);
   http.addHeader("apikey", SUPABASE_API_KEY);
   http.addHeader("Authorization", String("Bearer ") + SUPABASE_API_KEY);
   http.addHeader("x-upsert", "true");
@@ -720,6 +1755,7 @@ bool supabaseUploadFileToRecordsBucket(const String &objectPath, const String &l
   httpCodeOut = http.sendRequest("PUT", &f, f.size());
   responseOut = http.getString();
   http.end();
+  loopMetrics.noteHttp(httpCodeOut);
   f.close();
   return (httpCodeOut >= 200 && httpCodeOut < 300);
 }
@@ -728,6 +1764,11 @@ String makeStorageObjectPath(const String &eventId) {
   return String(DEVICE_ID) + "/" + eventId + ".wav";
 }
 
+// Streamed clips are named before their event exists: <device_id>/rec_<time>.wav
+String makeClipObjectPath(uint8_t zone, const String &localName) {
+  return String(zoneDeviceId(zone)) + localName;
+}
+
 String makePublicStorageUrl(const String &objectPath) {
   return String(SUPABASE_URL) + "/storage/v1/object/public/recordings/" + objectPath;
 }
@@ -741,20 +1782,30 @@ bool sendNoiseEventToSupabase(
   int decibel,
   bool buzzerTriggered,
   bool audioRecorded,
-  const String &audioLocalPath
+  const String &audioLocalPath,
+  uint8_t zone
 ) {
   if (!supabaseConfigured()) return false;
 
   String audioUrl = "";
-  if (audioRecorded && audioLocalPath.length() > 0) {
+  // "@<name>": the clip was streamed to Storage while it was recorded.
+  const bool streamed = audioLocalPath.startsWith("@");
+  if (audioRecorded && streamed) {
+    audioUrl = makePublicStorageUrl(makeClipObjectPath(zone, audioLocalPath.substring(1)));
+  } else if (audioRecorded && audioLocalPath.length() > 0 && !SD.exists(audioLocalPath)) {
+    // Past retention (or evicted for space) before it could be uploaded; the event still goes up.
+    EVLOG(LOG_SYNC, LOG_INFO, "Audio for {} no longer on SD; sending event without it", eventId);
+    audioRecorded = false;
+  }
+  if (audioRecorded && !streamed && audioLocalPath.length() > 0) {
     String objPath = makeStorageObjectPath(eventId);
     int upCode = 0;
     String upResp;
-    if (!supabaseUploadFileToRecordsBucket(objPath, audioLocalPath, upCode, upResp)) {
-      logSupabaseStatus(getTimeString() + " | Supabase upload FAIL | " + eventId + " | HTTP " + String(upCode) + " | " + truncateForLog(upResp, 180));
+    if (!supabaseUploadFileToRecordsBucket(objPath, audioLocalPath, upCode, upResp, "audio/wav")) {
+      EVLOG(LOG_SYNC, LOG_WARN, "Supabase upload FAIL | {} | HTTP {} | {}", eventId, upCode, truncateForLog(upResp, 180));
       return false;
     }
-    logSupabaseStatus(getTimeString() + " | Supabase upload OK | " + eventId + " | HTTP " + String(upCode));
+    EVLOG(LOG_SYNC, LOG_INFO, "Supabase upload OK | {} | HTTP {}", eventId, upCode);
     audioUrl = makePublicStorageUrl(objPath);
   }
 
@@ -764,7 +1815,7 @@ bool sendNoiseEventToSupabase(
   body += "{";
   body += "\"id\":\"" + eventId + "\",";
   body += "\"event_group_id\":\"" + groupId + "\",";
-  body += "\"device_id\":\"" + String(DEVICE_ID) + "\",";
+  body += "\"device_id\":\"" + String(zoneDeviceId(zone)) + "\",";
   body += "\"warning_level\":\"" + warningLevel + "\",";
   body += "\"warning_color\":\"RED\",";
   body += "\"duration_seconds\":" + String(durationSeconds) + ",";
@@ -783,14 +1834,14 @@ bool sendNoiseEventToSupabase(
   String response;
   if (!supabasePostJson(url, body, postCode, response)) {
     if (postCode == 409) {
-      logSupabaseStatus(getTimeString() + " | Supabase insert noise_events DUPLICATE (ok) | " + eventId + " | HTTP " + String(postCode) + " | " + truncateForLog(response, 180));
+      EVLOG(LOG_SYNC, LOG_INFO, "Supabase insert noise_events DUPLICATE (ok) | {} | HTTP {} | {}", eventId, postCode, truncateForLog(response, 180));
     } else {
-      logSupabaseStatus(getTimeString() + " | Supabase insert noise_events FAIL | " + eventId + " | HTTP " + String(postCode) + " | " + truncateForLog(response, 180));
+      EVLOG(LOG_SYNC, LOG_WARN, "Supabase insert noise_events FAIL | {} | HTTP {} | {}", eventId, postCode, truncateForLog(response, 180));
       return false;
     }
   }
   if (postCode >= 200 && postCode < 300) {
-    logSupabaseStatus(getTimeString() + " | Supabase insert noise_events OK | " + eventId + " | HTTP " + String(postCode));
+    EVLOG(LOG_SYNC, LOG_INFO, "Supabase insert noise_events OK | {} | HTTP {}", eventId, postCode);
   }
 
   if (audioUrl.length() > 0) {
@@ -807,74 +1858,102 @@ bool sendNoiseEventToSupabase(
     String response2;
     if (!supabasePostJson(url2, body2, post2Code, response2)) {
       if (post2Code == 409) {
-        logSupabaseStatus(getTimeString() + " | Supabase insert noise_event_audio DUPLICATE (ok) | " + eventId + " | HTTP " + String(post2Code) + " | " + truncateForLog(response2, 180));
+        EVLOG(LOG_SYNC, LOG_INFO, "Supabase insert noise_event_audio DUPLICATE (ok) | {} | HTTP {} | {}", eventId, post2Code, truncateForLog(response2, 180));
       } else {
-        logSupabaseStatus(getTimeString() + " | Supabase insert noise_event_audio FAIL | " + eventId + " | HTTP " + String(post2Code) + " | " + truncateForLog(response2, 180));
+        EVLOG(LOG_SYNC, LOG_WARN, "Supabase insert noise_event_audio FAIL | {} | HTTP {} | {}", eventId, post2Code, truncateForLog(response2, 180));
         return false;
       }
     }
     if (post2Code >= 200 && post2Code < 300) {
-      logSupabaseStatus(getTimeString() + " | Supabase insert noise_event_audio OK | " + eventId + " | HTTP " + String(post2Code));
+      EVLOG(LOG_SYNC, LOG_INFO, "Supabase insert noise_event_audio OK | {} | HTTP {}", eventId, post2Code);
     }
   }
 
   return true;
 }
 
-void queueRedWarningEvent(const String &warningLevel, uint64_t eventTsMs, const String &groupId, int durationSeconds, int decibel, bool audioRecorded, const String &audioLocalPath) {
-  String eventId = genUuidV4();
-  String line;
-  line.reserve(256);
-  line += eventId;
-  line += "|";
-  line += groupId;
-  line += "|";
-  line += warningLevel;
-  line += "|";
-  line += String(durationSeconds);
-  line += "|";
-  line += String(decibel);
-  line += "|";
-  line += (speakerEnabled ? "1" : "0");
-  line += "|";
-  line += (audioRecorded ? "1" : "0");
-  line += "|";
-  line += audioLocalPath;
-  line += "|";
-  line += String((unsigned long long)eventTsMs);
+bool eventUplinkUp() {
+  // Two failed uploads in a row count as "down" so events stop waiting in RAM for a dead link.
+  return wifiConnected && supabaseConfigured() &&
+         syncSched.failStreak[SYNC_PRIO_MAJOR] < 2 && syncSched.failStreak[SYNC_PRIO_WARNING] < 2;
+}
 
-  if (!sdReady()) {
-    logSupabaseStatus(getTimeString() + " | Queue FAIL (SD not available) | " + eventId);
-    sdAvailable = false;
-    lastSdFailMs = millis();
-    return;
-  }
+void noteSdEventLatency(uint64_t eventTsMs) {
+  uint64_t nowMs = getEpochMs();
+  if (eventTsMs == 0 || nowMs < eventTsMs) return;
+  uint64_t dt = nowMs - eventTsMs;
+  eventQueue.sdLatency.note(dt > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)dt);
+}
 
-  if (!enqueuePendingEvent(line)) {
-    logSupabaseStatus(getTimeString() + " | Queue FAIL (write error) | " + eventId);
-    sdAvailable = false;
-    lastSdFailMs = millis();
-    return;
-  }
+int spillEventQueue(EventSpillReason why) {
+  TRACE_SPAN("spillEventQueue");
+  if (eventQueue.count == 0 || !sdReady()) return 0;
+  int n = eventQueue.spill(why, [](const char *line, int len) {
+    (void)len;
+    return enqueuePendingEvent(line);
+  });
+  if (n > 0) {
+    if (pendingEventsKnown >= 0) pendingEventsKnown += n;
+    EVLOG(LOG_EVQ, LOG_INFO, "Spilled {} RAM event(s) to SD | reason={}", n, EVQ_SPILL_NAMES[why]);
+  }
+  return n;
+}
 
-  String msg = getTimeString() + " | Queued RED event | " + eventId + " | level=" + warningLevel;
-  if (!wifiConnected) {
-    msg += " | offline (wifi not connected)";
-  }
-  if (!supabaseConfigured()) {
-    msg += " | supabase not configured";
-  }
-  logSupabaseStatus(msg);
+// Runs from esp_restart(); best effort, a power cut gives no warning.
+static void onShutdownSpillEvents() {
+  spillEventQueue(EVQ_SPILL_SHUTDOWN);
+  flushNoiseLog();
+  // A settings change still inside its debounce window would otherwise be lost on a restart.
+  settingsStore.flush();
+}
 
-  // Immediate sync when online (may block briefly); batching below reduces repeated overhead.
-  if (wifiConnected && supabaseConfigured()) {
-    if (millis() >= nextSupabaseSyncAllowedMs) {
-      int uploaded = trySyncPendingEvents();
-      if (uploaded > 0) {
-        nextSupabaseSyncAllowedMs = millis();
+void queueRedWarningEvent(const String &warningLevel, uint64_t eventTsMs, const String &groupId, int durationSeconds, int decibel, bool audioRecorded, const String &audioLocalPath, uint8_t zone) {
+  String eventId = genUuidV4();
+  PendingEvent e;
+  pendingEventCopy(e.id, sizeof(e.id), eventId.c_str());
+  pendingEventCopy(e.groupId, sizeof(e.groupId), groupId.c_str());
+  pendingEventCopy(e.level, sizeof(e.level), warningLevel.c_str());
+  e.durationSeconds = durationSeconds;
+  e.decibel = decibel;
+  e.buzzer = speakerEnabled ? 1 : 0;
+  e.audio = audioRecorded ? 1 : 0;
+  pendingEventCopy(e.audioPath, sizeof(e.audioPath), audioLocalPath.c_str());
+  e.eventTsMs = eventTsMs;
+  e.queuedMs = millis();
+  e.zone = zone;
+
+  EventSpillReason route = eventQueue.route(eventUplinkUp());
+  bool inRam = (route == EVQ_SPILL_NONE) && eventQueue.push(e);
+
+  if (!inRam) {
+    char line[200];
+    int len = pendingEventFormat(e, line, sizeof(line));
+    if (!sdReady() || !enqueuePendingEvent(line)) {
+      sdAvailable = false;
+      lastSdFailMs = millis();
+      // Holding it in RAM beats dropping it; the loop spills it once the card is back.
+      if (eventQueue.push(e)) {
+        EVLOG(LOG_EVQ, LOG_WARN, "Queue SD FAIL, held in RAM | {}", eventId);
+        inRam = true;
       } else {
-        nextSupabaseSyncAllowedMs = millis() + SYNC_RETRY_BACKOFF_MS;
+        EVLOG(LOG_EVQ, LOG_WARN, "Queue FAIL (SD not available, RAM full) | {}", eventId);
+        return;
       }
+    } else {
+      eventQueue.queuedSd++;
+      eventQueue.sdBytes += (uint32_t)len + 1;
+      if (pendingEventsKnown >= 0) pendingEventsKnown++;
+    }
+  }
+
+  EVLOG(LOG_EVQ, LOG_INFO, "Queued RED event | {} | zone={} | level={} | {}{}{}", eventId, (int)zone + 1, warningLevel, inRam ? "ram" : "sd",
+        wifiConnected ? "" : " | offline (wifi not connected)", supabaseConfigured() ? "" : " | supabase not configured");
+
+  // Immediate sync when online (may block briefly); only if this event's class is not backing off.
+  if (wifiConnected && supabaseConfigured()) {
+    if (syncSched.due(syncPriorityForLevel(warningLevel.c_str()), millis())) {
+      if (inRam) trySyncRamEvents();
+      else trySyncPendingEvents();
     }
   }
 }
@@ -945,20 +2024,105 @@ void handleScanNetworks() {
   server.send(200, "application/json", lastScanJson);
 }
 
+// Appends one noise_events row (no audio) to a bulk insert body.
+void appendNoiseEventJson(String &out, const PendingEvent &e) {
+  char ts[40] = "";
+  if (e.eventTsMs != 0) snprintf(ts, sizeof(ts), "\"event_ts_ms\":%llu,", (unsigned long long)e.eventTsMs);
+  char obj[360];
+  snprintf(obj, sizeof(obj),
+           "{\"id\":\"%s\",\"event_group_id\":\"%s\",\"device_id\":\"%s\",\"warning_level\":\"%s\","
+           "\"warning_color\":\"RED\",\"duration_seconds\":%ld,\"decibel\":%ld,%s\"buzzer_triggered\":%s,"
+           "\"audio_recorded\":false}",
+           e.id, e.groupId, zoneDeviceId(e.zone), e.level, (long)e.durationSeconds, (long)e.decibel, ts, e.buzzer ? "true" : "false");
+  out += obj;
+}
+
+// Uploads events straight from the RAM queue: MAJOR first, audio events one at a time, the rest of
+// each class as one batch. Failed events stay queued; the loop spills them if the link stays down.
+int trySyncRamEvents() {
+  TRACE_SPAN("trySyncRamEvents");
+  if (eventQueue.count == 0 || !wifiConnected || !supabaseConfigured()) return 0;
+  int okCount = 0;
+
+  for (int pass = SYNC_PRIO_MAJOR; pass <= SYNC_PRIO_WARNING; pass++) {
+    if (!syncSched.due((SyncPriority)pass, millis())) continue;
+    bool classFailed = false;
+
+    for (int i = 0; i < eventQueue.count && !classFailed;) {
+      PendingEvent &e = eventQueue.items[i];
+      // A clip kept on SD waits for the card; a streamed one ("@...") is already in Storage.
+      const bool onSd = e.audioPath[0] != '\0' && e.audioPath[0] != '@';
+      if ((int)syncPriorityForLevel(e.level) != pass || !e.audio || (onSd && !sdReady()) || clipStreamHolds(e)) {
+        i++;
+        continue;
+      }
+      server.handleClient();
+      const uint32_t httpStartMs = millis();
+      bool ok = sendNoiseEventToSupabase(String(e.id), e.eventTsMs, String(e.groupId), String(e.level), e.durationSeconds, e.decibel, e.buzzer != 0, true, String(e.audioPath), e.zone);
+      if (!ok) {
+        EVLOG(LOG_SYNC, LOG_WARN, "Supabase sync FAIL (kept in RAM) | {}", e.id);
+        markSupabaseFail();
+        syncSched.onFailure((SyncPriority)pass, httpStartMs, esp_random());
+        classFailed = true;
+        break;
+      }
+      markSupabaseOk();
+      syncSched.onSuccess((SyncPriority)pass, millis());
+      eventQueue.noteUploaded(e, millis());
+      eventQueue.remove(i);
+      okCount++;
+    }
+    if (classFailed) continue;
+
+    int idx[EVENT_QUEUE_CAP];
+    int n = 0;
+    const int batchMax = syncSched.batchSize((SyncPriority)pass, 220, EVENT_QUEUE_CAP);
+    String batchJson;
+    batchJson.reserve(1024);
+    for (int i = 0; i < eventQueue.count && n < batchMax; i++) {
+      const PendingEvent &e = eventQueue.items[i];
+      if ((int)syncPriorityForLevel(e.level) != pass || e.audio) continue;
+      if (n > 0) batchJson += ",";
+      appendNoiseEventJson(batchJson, e);
+      idx[n++] = i;
+    }
+    if (n == 0) continue;
+
+    String url = String(SUPABASE_URL) + "/rest/v1/noise_events?on_conflict=id";
+    int postCode = 0;
+    String resp;
+    if (!supabasePostJson(url, "[" + batchJson + "]", postCode, resp)) {
+      EVLOG(LOG_SYNC, LOG_WARN, "Supabase bulk insert FAIL (kept in RAM) | HTTP {} | {}", postCode, truncateForLog(resp, 180));
+      syncSched.onFailure((SyncPriority)pass, millis(), esp_random());
+      continue;
+    }
+    syncSched.onSuccess((SyncPriority)pass, millis());
+    uint32_t ackMs = millis();
+    for (int k = n - 1; k >= 0; k--) {
+      eventQueue.noteUploaded(eventQueue.items[idx[k]], ackMs);
+      eventQueue.remove(idx[k]);
+    }
+    okCount += n;
+    EVLOG(LOG_SYNC, LOG_INFO, "Supabase bulk insert OK (ram) | count={} | HTTP {}", n, postCode);
+  }
+  return okCount;
+}
+
 int trySyncPendingEvents() {
+  TRACE_SPAN("trySyncPendingEvents");
   if (!wifiConnected) return 0;
 
   unsigned long now = millis();
   if (!sdAvailable && (lastSdFailMs != 0) && (now - lastSdFailMs < SYNC_RETRY_BACKOFF_MS)) {
     if ((lastSyncBackoffLogMs == 0) || (now - lastSyncBackoffLogMs >= SYNC_RETRY_BACKOFF_MS)) {
       lastSyncBackoffLogMs = now;
-      logSupabaseStatus(getTimeString() + " | Supabase sync delayed: SD backoff 30s");
+      EVLOG(LOG_SYNC, LOG_DEBUG, "Supabase sync delayed: SD backoff 30s");
     }
     return 0;
   }
 
   if (!sdReady()) {
-    logSupabaseStatus(getTimeString() + " | Supabase sync skipped: SD not available");
+    EVLOG(LOG_SYNC, LOG_DEBUG, "Supabase sync skipped: SD not available");
     sdAvailable = false;
     lastSdFailMs = now;
     return 0;
@@ -969,16 +2133,18 @@ int trySyncPendingEvents() {
   const unsigned long maxWorkMs = 1200;
   int okCount = 0;
   int processedCount = 0;
+  int keptCount = 0;
   bool loggedFirstLine = false;
   bool logThisAttempt = false;
   const int maxEventsThisAttempt = 12;
 
+  storageMgr.cancel(STORE_PENDING);
   File in = SD.open(PENDING_EVENTS_PATH, FILE_READ);
   if (!in) {
     if (!SD.exists(PENDING_EVENTS_PATH)) return 0;
     if ((lastSyncIoLogMs == 0) || (now - lastSyncIoLogMs >= SYNC_IO_LOG_INTERVAL_MS)) {
       lastSyncIoLogMs = now;
-      logSupabaseStatus(getTimeString() + " | Supabase sync skipped: cannot open pending_events.txt (read)");
+      EVLOG(LOG_SYNC, LOG_DEBUG, "Supabase sync skipped: cannot open pending_events.txt (read)");
     }
     return 0;
   }
@@ -992,7 +2158,7 @@ int trySyncPendingEvents() {
     in.close();
     if ((lastSyncIoLogMs == 0) || (now - lastSyncIoLogMs >= SYNC_IO_LOG_INTERVAL_MS)) {
       lastSyncIoLogMs = now;
-      logSupabaseStatus(getTimeString() + " | Supabase sync skipped: cannot open pending_events_tmp.txt (write)");
+      EVLOG(LOG_SYNC, LOG_DEBUG, "Supabase sync skipped: cannot open pending_events_tmp.txt (write)");
     }
     return 0;
   }
@@ -1000,26 +2166,38 @@ int trySyncPendingEvents() {
   logThisAttempt = ((lastSyncIoLogMs == 0) || (now - lastSyncIoLogMs >= SYNC_IO_LOG_INTERVAL_MS));
   if (logThisAttempt) {
     lastSyncIoLogMs = now;
-    logSupabaseStatus(getTimeString() + " | Supabase sync started | pending_size=" + String((unsigned long)in.size()) + " | avail=" + String((int)in.available()));
+    EVLOG(LOG_SYNC, LOG_DEBUG, "Supabase sync started | pending_size={} | avail={}", (unsigned long)in.size(), (int)in.available());
   }
 
   if (in.size() == 0) {
     in.close();
     out.close();
     SD.remove("/pending_events_tmp.txt");
+    pendingEventsKnown = 0;
     return 0;
   }
 
   startMs = millis();
 
   // Batch non-audio events into one POST to reduce overhead.
-  const int batchMax = 10;
+  // Batch size follows link quality (RSSI + measured throughput) via the sync scheduler.
+  const int batchMax = syncSched.batchSize(SYNC_PRIO_WARNING, 220, SYNC_EVENT_BATCH_CAP);
   String batchJson;
   batchJson.reserve(1024);
   bool batchHasAny = false;
   int batchCount = 0;
-  String batchLines[batchMax];
+  // Batched lines are remembered by file offset and re-read from SD only if the POST fails.
+  uint32_t batchPos[SYNC_EVENT_BATCH_CAP];
+  uint64_t batchTs[SYNC_EVENT_BATCH_CAP];
   int batchLineCount = 0;
+  char line[PENDING_LINE_MAX];
+  PendingEvent e;
+
+  // Priority passes over the queue: pass 0 uploads MAJOR lines, pass 1 FIRST/SECOND.
+  // Lines of a class that is out of budget, in backoff, or already failed this attempt are kept.
+  int pass = SYNC_PRIO_MAJOR;
+  bool draining = false;
+  bool classFailed = false;
 
   auto flushBatch = [&]() {
     if (!batchHasAny || batchCount <= 0) return;
@@ -1029,13 +2207,24 @@ int trySyncPendingEvents() {
     String resp;
     bool ok = supabasePostJson(url, body, postCode, resp);
     if (!ok) {
-      logSupabaseStatus(getTimeString() + " | Supabase bulk insert FAIL | HTTP " + String(postCode) + " | " + truncateForLog(resp, 180));
-      for (int i = 0; i < batchLineCount; i++) out.println(batchLines[i]);
+      EVLOG(LOG_SYNC, LOG_WARN, "Supabase bulk insert FAIL | HTTP {} | {}", postCode, truncateForLog(resp, 180));
+      const uint32_t resume = in.position();
+      char kept[PENDING_LINE_MAX];
+      for (int i = 0; i < batchLineCount; i++) {
+        in.seek(batchPos[i]);
+        if (readPendingLine(in, kept, sizeof(kept)) > 0) out.println(kept);
+      }
+      in.seek(resume);
+      keptCount += batchLineCount;
       markSupabaseFail();
+      syncSched.onFailure((SyncPriority)pass, millis(), esp_random());
+      classFailed = true;
     } else {
       markSupabaseOk();
+      syncSched.onSuccess((SyncPriority)pass, millis());
       okCount += batchCount;
-      logSupabaseStatus(getTimeString() + " | Supabase bulk insert OK | count=" + String(batchCount) + " | HTTP " + String(postCode));
+      for (int i = 0; i < batchLineCount; i++) noteSdEventLatency(batchTs[i]);
+      EVLOG(LOG_SYNC, LOG_INFO, "Supabase bulk insert OK | count={} | HTTP {}", batchCount, postCode);
     }
     batchJson = "";
     batchHasAny = false;
@@ -1043,155 +2232,97 @@ int trySyncPendingEvents() {
     batchLineCount = 0;
   };
 
-  while (in.available()) {
-    server.handleClient();
-    yield();
-
-    if ((processedCount > 0) && (millis() - startMs > maxWorkMs)) {
-      while (in.available()) {
-        String rest = in.readStringUntil('\n');
-        rest.trim();
-        if (rest.length() > 0) out.println(rest);
-      }
-      break;
-    }
-
-    String line = in.readStringUntil('\n');
-    line.trim();
-    if (line.length() == 0) continue;
+  for (pass = SYNC_PRIO_MAJOR; pass <= SYNC_PRIO_WARNING; pass++) {
+    classFailed = false;
+    const bool classDue = syncSched.due((SyncPriority)pass, millis());
+    in.seek(0);
 
-    if (!loggedFirstLine && logThisAttempt) {
-      logSupabaseStatus(getTimeString() + " | Supabase sync first_line=" + truncateForLog(line, 160));
-      loggedFirstLine = true;
-    }
+    while (in.available()) {
+      const uint32_t linePos = in.position();
+      if (readPendingLine(in, line, sizeof(line)) == 0) continue;
 
-    // Parse pending line (backward compatible)
-    String fields[10];
-    int fieldCount = 0;
-    int start = 0;
-    while (fieldCount < 10) {
-      int sep = line.indexOf('|', start);
-      if (sep < 0) {
-        fields[fieldCount++] = line.substring(start);
-        break;
+      if (!pendingEventParse(line, e)) {
+        if (pass == SYNC_PRIO_MAJOR) out.println(line);
+        continue;
       }
-      fields[fieldCount++] = line.substring(start, sep);
-      start = sep + 1;
-    }
-    if (fieldCount < 7) {
-      out.println(line);
-      continue;
-    }
 
-    // Old: 7 fields => id, level, dur, db, buz, audio, path
-    // New: 8 fields => id, groupId, level, dur, db, buz, audio, path
-    // New+: 9 fields => id, groupId, level, dur, db, buz, audio, path, eventTsMs
-    String eventId;
-    uint64_t eventTsMs = 0;
-    String groupId;
-    String warningLevel;
-    int durationSeconds = 0;
-    int decibel = 0;
-    bool buzzerTriggered = false;
-    bool audioRecorded = false;
-    String audioLocalPath;
-
-    if (fieldCount == 7) {
-      eventId = fields[0];
-      groupId = eventId;
-      warningLevel = fields[1];
-      durationSeconds = fields[2].toInt();
-      decibel = fields[3].toInt();
-      buzzerTriggered = (fields[4] == "1");
-      audioRecorded = (fields[5] == "1");
-      audioLocalPath = fields[6];
-    } else {
-      eventId = fields[0];
-      groupId = fields[1];
-      warningLevel = fields[2];
-      durationSeconds = fields[3].toInt();
-      decibel = fields[4].toInt();
-      buzzerTriggered = (fields[5] == "1");
-      audioRecorded = (fields[6] == "1");
-      audioLocalPath = fields[7];
-      if (fieldCount >= 9) {
-        eventTsMs = (uint64_t)strtoull(fields[8].c_str(), NULL, 10);
+      if ((int)syncPriorityForLevel(e.level) != pass) continue;
+
+      if (!draining && (processedCount > 0) && (millis() - startMs > maxWorkMs)) draining = true;
+      if (draining || !classDue || classFailed || clipStreamHolds(e)) {
+        out.println(line);
+        keptCount++;
+        continue;
       }
-    }
 
-    processedCount++;
-    if (processedCount == 1) {
-      logSupabaseStatus(getTimeString() + " | Supabase sync processing | id=" + eventId + " | audio=" + String(audioRecorded ? "1" : "0"));
-    }
+      server.handleClient();
+      yield();
 
-    if (!audioRecorded) {
-      // Add to bulk batch
-      if (!batchHasAny) {
-        batchJson = "";
-        batchHasAny = true;
-      }
-      if (batchCount > 0) batchJson += ",";
-      String obj;
-      obj.reserve(220);
-      obj += "{";
-      obj += "\"id\":\"" + eventId + "\",";
-      obj += "\"event_group_id\":\"" + groupId + "\",";
-      obj += "\"device_id\":\"" + String(DEVICE_ID) + "\",";
-      obj += "\"warning_level\":\"" + warningLevel + "\",";
-      obj += "\"warning_color\":\"RED\",";
-      obj += "\"duration_seconds\":" + String(durationSeconds) + ",";
-      obj += "\"decibel\":" + String(decibel) + ",";
-      if (eventTsMs != 0) {
-        obj += "\"event_ts_ms\":" + String((unsigned long long)eventTsMs) + ",";
-      }
-      obj += "\"buzzer_triggered\":" + String(buzzerTriggered ? "true" : "false") + ",";
-      obj += "\"audio_recorded\":false";
-      obj += "}";
-      batchJson += obj;
-      if (batchLineCount < batchMax) batchLines[batchLineCount++] = line;
-      batchCount++;
-
-      if (batchCount >= batchMax) {
-        flushBatch();
+      if (!loggedFirstLine && logThisAttempt) {
+        EVLOG(LOG_SYNC, LOG_DEBUG, "Supabase sync first_line={}", line);
+        loggedFirstLine = true;
       }
-    } else {
-      // Flush any pending non-audio batch before uploading audio
-      flushBatch();
 
-      unsigned long httpStartMs = millis();
-      if (processedCount == 1) {
-        logSupabaseStatus(getTimeString() + " | Supabase sync HTTP begin | id=" + eventId);
-      }
-      bool ok = sendNoiseEventToSupabase(eventId, eventTsMs, groupId, warningLevel, durationSeconds, decibel, buzzerTriggered, audioRecorded, audioLocalPath);
+      processedCount++;
       if (processedCount == 1) {
-        logSupabaseStatus(getTimeString() + " | Supabase sync HTTP end | id=" + eventId + " | ok=" + String(ok ? "1" : "0") + " | ms=" + String((unsigned long)(millis() - httpStartMs)));
+        EVLOG(LOG_SYNC, LOG_DEBUG, "Supabase sync processing | id={} | audio={}", e.id, e.audio ? "1" : "0");
       }
-      if (!ok) {
-        logSupabaseStatus(getTimeString() + " | Supabase sync FAIL (kept pending) | " + eventId);
-        markSupabaseFail();
-        out.println(line);
+
+      if (!e.audio) {
+        // Add to bulk batch
+        if (!batchHasAny) {
+          batchJson = "";
+          batchHasAny = true;
+        }
+        if (batchCount > 0) batchJson += ",";
+        appendNoiseEventJson(batchJson, e);
+        if (batchLineCount < SYNC_EVENT_BATCH_CAP) {
+          batchTs[batchLineCount] = e.eventTsMs;
+          batchPos[batchLineCount++] = linePos;
+        }
+        batchCount++;
+
+        if (batchCount >= batchMax) {
+          flushBatch();
+        }
       } else {
-        markSupabaseOk();
-        okCount++;
-      }
-    }
+        // Flush any pending non-audio batch before uploading audio
+        flushBatch();
 
-    if (processedCount >= maxEventsThisAttempt) {
-      while (in.available()) {
-        String rest = in.readStringUntil('\n');
-        rest.trim();
-        if (rest.length() > 0) out.println(rest);
+        unsigned long httpStartMs = millis();
+        if (processedCount == 1) {
+          EVLOG(LOG_SYNC, LOG_DEBUG, "Supabase sync HTTP begin | id={}", e.id);
+        }
+        bool ok = sendNoiseEventToSupabase(String(e.id), e.eventTsMs, String(e.groupId), String(e.level), e.durationSeconds, e.decibel, e.buzzer != 0, true, String(e.audioPath), e.zone);
+        if (processedCount == 1) {
+          EVLOG(LOG_SYNC, LOG_DEBUG, "Supabase sync HTTP end | id={} | ok={} | ms={}", e.id, ok ? "1" : "0", (unsigned long)(millis() - httpStartMs));
+        }
+        if (!ok) {
+          EVLOG(LOG_SYNC, LOG_WARN, "Supabase sync FAIL (kept pending) | {}", e.id);
+          markSupabaseFail();
+          syncSched.onFailure((SyncPriority)pass, httpStartMs, esp_random());
+          classFailed = true;
+          out.println(line);
+          keptCount++;
+        } else {
+          markSupabaseOk();
+          syncSched.onSuccess((SyncPriority)pass, millis());
+          noteSdEventLatency(e.eventTsMs);
+          okCount++;
+        }
       }
-      break;
+
+      if (processedCount >= maxEventsThisAttempt) draining = true;
     }
-  }
 
-  // Flush any remaining non-audio batch
-  flushBatch();
+    // Flush any remaining non-audio batch of this class
+    flushBatch();
+  }
 
   in.close();
   out.close();
 
+  TRACE_SPAN("sd.swapPending");
   bool hadOld = SD.exists(PENDING_EVENTS_PATH);
   if (hadOld) {
     SD.remove("/pending_events_old.txt");
@@ -1201,41 +2332,31 @@ int trySyncPendingEvents() {
   if (!SD.rename("/pending_events_tmp.txt", PENDING_EVENTS_PATH)) {
     if ((lastSyncIoLogMs == 0) || (now - lastSyncIoLogMs >= SYNC_IO_LOG_INTERVAL_MS)) {
       lastSyncIoLogMs = now;
-      logSupabaseStatus(getTimeString() + " | Supabase sync WARNING: rename tmp->pending failed");
+      EVLOG(LOG_SYNC, LOG_WARN, "Supabase sync WARNING: rename tmp->pending failed");
     }
     if (SD.exists("/pending_events_old.txt")) {
       SD.rename("/pending_events_old.txt", PENDING_EVENTS_PATH);
     }
   } else {
     SD.remove("/pending_events_old.txt");
+    pendingEventsKnown = keptCount;
   }
 
   if (processedCount == 0) {
     if (logThisAttempt) {
-      logSupabaseStatus(getTimeString() + " | Supabase sync ended | no_lines_processed");
+      EVLOG(LOG_SYNC, LOG_DEBUG, "Supabase sync ended | no_lines_processed");
     }
   }
 
   if (okCount > 0) {
-    logSupabaseStatus(getTimeString() + " | Supabase sync OK | uploaded=" + String(okCount));
+    EVLOG(LOG_SYNC, LOG_INFO, "Supabase sync OK | uploaded={}", okCount);
   }
 
   return okCount;
 }
 
-void appendEventLog(const String &line) {
-  if (eventLogCount < EVENT_LOG_MAX) {
-    eventLog[eventLogCount++] = line;
-    return;
-  }
-
-  for (int i = 1; i < EVENT_LOG_MAX; i++) {
-    eventLog[i - 1] = eventLog[i];
-  }
-  eventLog[EVENT_LOG_MAX - 1] = line;
-}
-
 bool checkInternetNow() {
+  TRACE_SPAN("checkInternetNow");
   if (WiFi.status() != WL_CONNECTED) return false;
 
   HTTPClient http;
@@ -1246,54 +2367,111 @@ bool checkInternetNow() {
   }
   int code = http.GET();
   http.end();
+  loopMetrics.noteHttp(code);
   return (code == 204);
 }
 
-void appendMonitorLog(const String &line) {
-  if (monitorLogCount < MONITOR_LOG_MAX) {
-    monitorLog[monitorLogCount++] = line;
-    return;
-  }
+DeviceSettings snapshotDeviceSettings() {
+  DeviceSettings s;
+  s.yellow = YELLOW_THRESHOLD;
+  s.red = RED_THRESHOLD;
+  s.speaker = speakerEnabled ? 1 : 0;
+  s.mp3Volume = mp3Volume;
 
-  for (int i = 1; i < MONITOR_LOG_MAX; i++) {
-    monitorLog[i - 1] = monitorLog[i];
-  }
-  monitorLog[MONITOR_LOG_MAX - 1] = line;
+  s.majorRepeatIntervalMs = (int32_t)majorRepeatIntervalMs;
+  s.silenceResetWindowMs = (int32_t)silenceResetWindowMs;
+
+  s.firstWarningMs = (int32_t)firstWarningTimeMs;
+  s.secondWarningMs = (int32_t)secondWarningTimeMs;
+  s.majorWarningMs = (int32_t)majorWarningTimeMs;
+
+  s.noiseGreenBrt = noiseGreenBrt;
+  s.noiseYellowBrt = noiseYellowBrt;
+  s.noiseRedBrt = noiseRedBrt;
+  s.statusLedBrt = statusLedBrt;
+  s.noiseLedsEnabled = noiseLedsEnabled ? 1 : 0;
+
+  s.micEnabled = micEnabled ? 1 : 0;
+  s.serialLoggingEnabled = serialLoggingEnabled ? 1 : 0;
+
+  s.statusRgbBoot = statusRgbBoot;
+  s.statusRgbAp = statusRgbAp;
+  s.statusRgbWifiOk = statusRgbWifiOk;
+  s.statusRgbNoInternet = statusRgbNoInternet;
+  s.statusRgbOffline = statusRgbOffline;
+
+  s.dbSampleIntervalMs = (int32_t)dbSampleIntervalMs;
+  s.dbChangeThreshold10 = dbChangeThreshold10;
+  s.dbHeartbeatMs = (int32_t)dbHeartbeatMs;
+  s.dbBulkUploadIntervalMs = (int32_t)dbBulkUploadIntervalMs;
+
+  s.lowPowerEnabled = powerPolicy.enabled ? 1 : 0;
+  s.lowPowerQuietMs = (int32_t)powerPolicy.quietAfterMs;
+
+  s.classifierSuppress = classifierSuppress ? 1 : 0;
+  s.classifierMinConfidence = classifierMinConfidence;
+
+  s.eventWriteThrough = (eventQueue.mode == EVQ_WRITE_THROUGH) ? 1 : 0;
+  s.eventMaxRamAgeMs = (int32_t)eventQueue.maxRamAgeMs;
+
+  s.zoneCount = zoneCount;
+  return s;
+}
+
+void applyDeviceSettings(const DeviceSettings &s) {
+  YELLOW_THRESHOLD = s.yellow;
+  RED_THRESHOLD = s.red;
+  speakerEnabled = s.speaker != 0;
+  mp3Volume = s.mp3Volume;
+
+  majorRepeatIntervalMs = (unsigned long)s.majorRepeatIntervalMs;
+  silenceResetWindowMs = (unsigned long)s.silenceResetWindowMs;
+
+  firstWarningTimeMs = (unsigned long)s.firstWarningMs;
+  secondWarningTimeMs = (unsigned long)s.secondWarningMs;
+  majorWarningTimeMs = (unsigned long)s.majorWarningMs;
+
+  noiseGreenBrt = s.noiseGreenBrt;
+  noiseYellowBrt = s.noiseYellowBrt;
+  noiseRedBrt = s.noiseRedBrt;
+  statusLedBrt = s.statusLedBrt;
+  noiseLedsEnabled = s.noiseLedsEnabled != 0;
+
+  micEnabled = s.micEnabled != 0;
+  serialLoggingEnabled = s.serialLoggingEnabled != 0;
+
+  statusRgbBoot = s.statusRgbBoot;
+  statusRgbAp = s.statusRgbAp;
+  statusRgbWifiOk = s.statusRgbWifiOk;
+  statusRgbNoInternet = s.statusRgbNoInternet;
+  statusRgbOffline = s.statusRgbOffline;
+
+  dbSampleIntervalMs = (unsigned long)s.dbSampleIntervalMs;
+  dbChangeThreshold10 = s.dbChangeThreshold10;
+  dbHeartbeatMs = (unsigned long)s.dbHeartbeatMs;
+  dbBulkUploadIntervalMs = (unsigned long)s.dbBulkUploadIntervalMs;
+
+  powerPolicy.enabled = s.lowPowerEnabled != 0;
+  powerPolicy.quietAfterMs = (uint32_t)s.lowPowerQuietMs;
+
+  classifierSuppress = s.classifierSuppress != 0;
+  classifierMinConfidence = s.classifierMinConfidence;
+
+  eventQueue.mode = s.eventWriteThrough ? EVQ_WRITE_THROUGH : EVQ_RAM_FIRST;
+  eventQueue.maxRamAgeMs = (uint32_t)s.eventMaxRamAgeMs;
+
+  zoneCount = constrain((int)s.zoneCount, 1, MAX_ZONES);
 }
 
 void loadDeviceSettings() {
-  preferences.begin("settings", true);
-  YELLOW_THRESHOLD = preferences.getInt("yellow", YELLOW_THRESHOLD);
-  RED_THRESHOLD = preferences.getInt("red", RED_THRESHOLD);
-  speakerEnabled = preferences.getBool("speaker", speakerEnabled);
-  mp3Volume = preferences.getInt("mp3vol", mp3Volume);
-
-  majorRepeatIntervalMs = (unsigned long)preferences.getInt("maj_int", (int)majorRepeatIntervalMs);
-  silenceResetWindowMs = (unsigned long)preferences.getInt("sil_win", (int)silenceResetWindowMs);
-
-  firstWarningTimeMs = (unsigned long)preferences.getInt("fw_ms", (int)firstWarningTimeMs);
-  secondWarningTimeMs = (unsigned long)preferences.getInt("sw_ms", (int)secondWarningTimeMs);
-  majorWarningTimeMs = (unsigned long)preferences.getInt("mw_ms", (int)majorWarningTimeMs);
-
-  noiseGreenBrt = preferences.getInt("ngbrt", noiseGreenBrt);
-  noiseYellowBrt = preferences.getInt("nybrt", noiseYellowBrt);
-  noiseRedBrt = preferences.getInt("nrbrt", noiseRedBrt);
-  statusLedBrt = preferences.getInt("stbrt", statusLedBrt);
-  noiseLedsEnabled = preferences.getBool("nleden", noiseLedsEnabled);
-
-  micEnabled = preferences.getBool("micen", micEnabled);
-  serialLoggingEnabled = preferences.getBool("serlog", serialLoggingEnabled);
-
-  statusRgbBoot = preferences.getInt("sr_boot", statusRgbBoot);
-  statusRgbAp = preferences.getInt("sr_ap", statusRgbAp);
-  statusRgbWifiOk = preferences.getInt("sr_wifi", statusRgbWifiOk);
-  statusRgbNoInternet = preferences.getInt("sr_noi", statusRgbNoInternet);
-  statusRgbOffline = preferences.getInt("sr_off", statusRgbOffline);
-
-  dbSampleIntervalMs = (unsigned long)preferences.getInt("db_samp", (int)dbSampleIntervalMs);
-  dbChangeThreshold10 = preferences.getInt("db_thr10", dbChangeThreshold10);
-  dbHeartbeatMs = (unsigned long)preferences.getInt("db_hb", (int)dbHeartbeatMs);
-  dbBulkUploadIntervalMs = (unsigned long)preferences.getInt("db_up", (int)dbBulkUploadIntervalMs);
+  // Globals hold the compiled-in defaults here; the store overlays the blob (or legacy keys).
+  DeviceSettings s = snapshotDeviceSettings();
+  settingsStore.nvs = &preferences;
+  SettingsLoadResult r = settingsStore.load(s);
+  applyDeviceSettings(s);
+  if (r == SETTINGS_MIGRATED_LEGACY) {
+    Serial.println("Settings migrated from per-key NVS to blob v" + String(SETTINGS_VERSION));
+  }
 
   noiseGreenBrt = constrain(noiseGreenBrt, 0, LEDC_MAX);
   noiseYellowBrt = constrain(noiseYellowBrt, 0, LEDC_MAX);
@@ -1320,44 +2498,20 @@ void loadDeviceSettings() {
   if (secondWarningTimeMs <= firstWarningTimeMs) secondWarningTimeMs = firstWarningTimeMs + 1000UL;
   if (majorWarningTimeMs <= secondWarningTimeMs) majorWarningTimeMs = secondWarningTimeMs + 1000UL;
 
+  powerPolicy.quietAfterMs = constrain(powerPolicy.quietAfterMs, (uint32_t)60000, (uint32_t)7200000);
+  classifierMinConfidence = constrain(classifierMinConfidence, 30, 100);
+  eventQueue.maxRamAgeMs = constrain(eventQueue.maxRamAgeMs, (uint32_t)5000, (uint32_t)600000);
+
   if (RED_THRESHOLD <= YELLOW_THRESHOLD) RED_THRESHOLD = constrain(YELLOW_THRESHOLD + 1, 0, 100);
-  preferences.end();
 }
 
+// Marks settings dirty; the flash write happens in flushDeviceSettings() once changes settle.
 void saveDeviceSettings() {
-  preferences.begin("settings", false);
-  preferences.putInt("yellow", YELLOW_THRESHOLD);
-  preferences.putInt("red", RED_THRESHOLD);
-  preferences.putBool("speaker", speakerEnabled);
-  preferences.putInt("mp3vol", mp3Volume);
-
-  preferences.putInt("maj_int", (int)majorRepeatIntervalMs);
-  preferences.putInt("sil_win", (int)silenceResetWindowMs);
-
-  preferences.putInt("fw_ms", (int)firstWarningTimeMs);
-  preferences.putInt("sw_ms", (int)secondWarningTimeMs);
-  preferences.putInt("mw_ms", (int)majorWarningTimeMs);
-
-  preferences.putInt("ngbrt", noiseGreenBrt);
-  preferences.putInt("nybrt", noiseYellowBrt);
-  preferences.putInt("nrbrt", noiseRedBrt);
-  preferences.putInt("stbrt", statusLedBrt);
-  preferences.putBool("nleden", noiseLedsEnabled);
-
-  preferences.putBool("micen", micEnabled);
-  preferences.putBool("serlog", serialLoggingEnabled);
-
-  preferences.putInt("sr_boot", statusRgbBoot);
-  preferences.putInt("sr_ap", statusRgbAp);
-  preferences.putInt("sr_wifi", statusRgbWifiOk);
-  preferences.putInt("sr_noi", statusRgbNoInternet);
-  preferences.putInt("sr_off", statusRgbOffline);
-
-  preferences.putInt("db_samp", (int)dbSampleIntervalMs);
-  preferences.putInt("db_thr10", dbChangeThreshold10);
-  preferences.putInt("db_hb", (int)dbHeartbeatMs);
-  preferences.putInt("db_up", (int)dbBulkUploadIntervalMs);
-  preferences.end();
+  settingsStore.update(snapshotDeviceSettings(), millis());
+}
+
+void flushDeviceSettings(unsigned long now) {
+  settingsStore.tick((uint32_t)now);
 }
 
 void markSupabaseFail() {
@@ -1365,15 +2519,17 @@ void markSupabaseFail() {
   lastSupabaseFailMs = millis();
   bool isErr = true;
   if (!wasErr && isErr) {
-    appendEventLog(getTimeString() + " | Supabase error detected");
+    EVLOG(LOG_SYNC, LOG_WARN, "Supabase error detected");
   }
 }
 
 void markSupabaseOk() {
   bool wasErr = (lastSupabaseFailMs != 0) && (millis() - lastSupabaseFailMs <= 60000);
   lastSupabaseOkMs = millis();
+  syncSched.noteApiOk(lastSupabaseOkMs);
+  internetOk = true;
   if (wasErr) {
-    appendEventLog(getTimeString() + " | Supabase OK");
+    EVLOG(LOG_SYNC, LOG_INFO, "Supabase OK");
   }
 }
 
@@ -1384,22 +2540,19 @@ void updateSdAvailability(unsigned long now) {
   static bool prev = true;
   bool ok = sdAvailable;
   if (prev != ok) {
-    appendEventLog(getTimeString() + String(ok ? " | SD card OK" : " | SD card NOT available"));
+    EVLOG(LOG_SD, ok ? LOG_INFO : LOG_WARN, ok ? "SD card OK" : "SD card NOT available");
     prev = ok;
   }
 }
 
 void logNetworkInfo(const String &tag) {
-  String line = getTimeString() + " | " + tag;
-  line += " | AP=" + WiFi.softAPIP().toString();
+  if (!eventLogRing.enabled(LOG_NET, LOG_INFO)) return;
   if (WiFi.status() == WL_CONNECTED) {
-    line += " | STA=" + WiFi.localIP().toString();
-    line += " | GW=" + WiFi.gatewayIP().toString();
+    EVLOG(LOG_NET, LOG_INFO, "{} | AP={} | STA={} | GW={}", tag, WiFi.softAPIP().toString(), WiFi.localIP().toString(),
+          WiFi.gatewayIP().toString());
   } else {
-    line += " | STA=not_connected";
+    EVLOG(LOG_NET, LOG_INFO, "{} | AP={} | STA=not_connected", tag, WiFi.softAPIP().toString());
   }
-  appendEventLog(line);
-  Serial.println(line);
 }
 
 void flickerActiveLed() {
@@ -1464,12 +2617,15 @@ static void setNoiseLedPwmForce(LedState s) {
   ledcWriteCompat(CH_NOISE_RED, (s == RED) ? LEDC_MAX : 0);
 }
 
-void updateStatusLed(unsigned long now) {
+// Returns the ms until the LED next needs updating: the next blink edge, else STATUS_LED_POLL_MS
+// so state changes (errors, Wi-Fi) still show promptly.
+unsigned long updateStatusLed(unsigned long now) {
+  const unsigned long STATUS_LED_POLL_MS = 250;
   if (statusLedManual) {
     ledcWriteCompat(CH_STATUS_R, statusLedManualR);
     ledcWriteCompat(CH_STATUS_G, statusLedManualG);
     ledcWriteCompat(CH_STATUS_B, statusLedManualB);
-    return;
+    return STATUS_LED_POLL_MS;
   }
 
   updateSdAvailability(now);
@@ -1540,13 +2696,18 @@ void updateStatusLed(unsigned long now) {
   }
 
   bool on = true;
+  unsigned long nextMs = STATUS_LED_POLL_MS;
   if (blink && periodMs > 0) {
-    on = ((now / (periodMs / 2)) % 2) == 0;
+    const unsigned long half = periodMs / 2;
+    on = ((now / half) % 2) == 0;
+    nextMs = min(nextMs, half - (now % half));
   }
+  if (isBooting && staConnected) nextMs = min(nextMs, 500 - (now % 500));
 
   ledcWriteCompat(CH_STATUS_R, on ? r : 0);
   ledcWriteCompat(CH_STATUS_G, on ? g : 0);
   ledcWriteCompat(CH_STATUS_B, on ? b : 0);
+  return nextMs;
 }
 
 void presetToRgb(int preset, int intensity, int &r, int &g, int &b) {
@@ -1565,14 +2726,6 @@ void presetToRgb(int preset, int intensity, int &r, int &g, int &b) {
   }
 }
 
-void delayWithStatus(unsigned long ms) {
-  unsigned long start = millis();
-  while (millis() - start < ms) {
-    updateStatusLed(millis());
-    delay(10);
-  }
-}
-
 String getTimeString() {
   time_t sec = time(NULL);
   if (sec <= 1000) {
@@ -1689,6 +2842,30 @@ static time_t timegmPortable(struct tm *t) {
   return (time_t)out;
 }
 
+// Waits (up to ~1.1 s) for the DS3231 seconds register to tick over, so the counter value lines up
+// with a whole second instead of anywhere inside it. Runs in the RTC boot task; loop() feeds the
+// sample to clockService, which only the loop task updates.
+static void sampleRtcEdge() {
+  if (!rtcPresent) return;
+  struct tm first;
+  if (!ds3231ReadTm(first)) return;
+  const int64_t startUs = esp_timer_get_time();
+  struct tm cur;
+  while (esp_timer_get_time() - startUs < 1100000LL) {
+    if (!ds3231ReadTm(cur)) return;
+    int64_t mono = esp_timer_get_time();
+    if (cur.tm_sec != first.tm_sec) {
+      time_t sec = timegmPortable(&cur);
+      if (sec <= 1000) return;
+      rtcBootSampleMono = mono;
+      rtcBootSampleEpochUs = (int64_t)sec * 1000000LL;
+      rtcBootSampleOk = true;
+      return;
+    }
+    delay(1);
+  }
+}
+
 static void initRtc() {
   Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
   Wire.setTimeOut(50);
@@ -1754,6 +2931,7 @@ static void maybeUpdateRtcFromSystemTime(unsigned long now) {
 }
 
 void handleRtcInfo() {
+  if (!bootGate(BOOT_RTC)) return;
   struct tm rtc;
   bool rtcReadOk = false;
   if (rtcPresent) {
@@ -1804,6 +2982,20 @@ void handleRtcInfo() {
   out += "\"tz\":\"" + jsonEscape(tz ? String(tz) : String("")) + "\",";
   out += "\"rtcAppliedToSystem\":" + String(rtcTimeAppliedToSystem ? "true" : "false") + ",";
   out += "\"rtcUpdatedFromSystem\":" + String(rtcUpdatedFromSystem ? "true" : "false") + ",";
+  out += "\"clockSource\":\"" + String(CLOCK_SOURCE_NAMES[clockService.source]) + "\",";
+  out += "\"clockEpochMs\":" + String((unsigned long long)getEpochMs()) + ",";
+  out += "\"clockDriftPpb\":" + String((long)clockService.driftPpb) + ",";
+  out += "\"clockDriftSamples\":" + String((unsigned long)clockService.driftSamples) + ",";
+  out += "\"clockLastOffsetUs\":" + String((long long)clockService.lastOffsetUs) + ",";
+  out += "\"clockMaxOffsetUs\":" + String((long long)clockService.maxAbsOffsetUs) + ",";
+  out += "\"clockSyncs\":" + String((unsigned long)clockService.syncs) + ",";
+  out += "\"clockSlews\":" + String((unsigned long)clockService.slews) + ",";
+  out += "\"clockSteps\":" + String((unsigned long)clockService.steps) + ",";
+  out += "\"clockBackwardSteps\":" + String((unsigned long)clockService.backwardSteps) + ",";
+  out += "\"clockClampedReads\":" + String((unsigned long)clockService.clampedReads) + ",";
+  out += "\"clockSinceSyncS\":" + String(clockService.synced ? (long)((esp_timer_get_time() - clockService.lastSyncMonoUs) / 1000000LL) : -1L) + ",";
+  out += "\"preSyncBuffered\":" + String(preSyncDbCount) + ",";
+  out += "\"preSyncDropped\":" + String((unsigned long)preSyncDbDropped) + ",";
   out += "\"i2cSda\":" + String(I2C_SDA_PIN) + ",";
   out += "\"i2cScl\":" + String(I2C_SCL_PIN);
   out += "}";
@@ -1812,6 +3004,7 @@ void handleRtcInfo() {
 }
 
 void handleRtcSync() {
+  if (!bootGate(BOOT_RTC)) return;
   time_t sysSec = time(NULL);
   bool sysTimeSet = (sysSec > 1000);
 
@@ -1832,135 +3025,55 @@ void handleRtcSync() {
   server.send(ok ? 200 : 409, "application/json", out);
 }
 
+// Each command carries the gap the module needs before the next one; the delays that used to
+// sit between these writes now live in the queue.
+static inline void mp3QueueSelectTf(uint16_t gapMs) {
+  const uint8_t tf = 0x01;
+  mp3Drv.send(MP3_CMD_SELECT_DEV, &tf, 1, gapMs);
+  loopJobs.kick(jobMp3, millis());
+}
+
 void setMP3Volume(uint8_t vol) {
   vol = constrain(vol, 0, 30);
-  uint8_t selectTF[] = {0x7E, 0x03, 0x35, 0x01, 0xEF};
-  uint8_t setVol[]   = {0x7E, 0x03, 0x31, vol, 0xEF};
-  mp3.write(selectTF, sizeof(selectTF));
-  delay(80);
-  mp3.write(setVol, sizeof(setVol));
+  mp3QueueSelectTf(80);
+  mp3Drv.send(MP3_CMD_VOLUME, &vol, 1, 0);
 }
 
 void playMP3(uint8_t track) {
   if (!speakerEnabled) return;
-  uint8_t selectTF[] = {0x7E, 0x03, 0x35, 0x01, 0xEF};
-  uint8_t setVol[]   = {0x7E, 0x03, 0x31, (uint8_t)constrain(mp3Volume, 0, 30), 0xEF};
-  uint8_t playCmd[]  = {0x7E, 0x04, 0x42, 0x01, track, 0xEF};
-
-  mp3.write(selectTF, sizeof(selectTF));
-  delay(200);
-  mp3.write(setVol, sizeof(setVol));
-  delay(200);
-  mp3.write(playCmd, sizeof(playCmd));
+  const uint8_t vol = (uint8_t)constrain(mp3Volume, 0, 30);
+  const uint8_t folderTrack[2] = {0x01, track};
+  mp3QueueSelectTf(200);
+  mp3Drv.send(MP3_CMD_VOLUME, &vol, 1, 200);
+  mp3Drv.send(MP3_CMD_PLAY_FOLDER, folderTrack, 2, 0);
 }
 
 void stopMP3() {
-  uint8_t selectTF[] = {0x7E, 0x03, 0x35, 0x01, 0xEF};
-  uint8_t stopCmd[]  = {0x7E, 0x02, 0x16, 0xEF};
-  uint8_t pauseCmd[] = {0x7E, 0x02, 0x0E, 0xEF};
-  mp3.write(selectTF, sizeof(selectTF));
-  delay(80);
-  mp3.write(stopCmd, sizeof(stopCmd));
-  delay(80);
-  mp3.write(pauseCmd, sizeof(pauseCmd));
-}
-
-static inline void mp3WriteCmd(uint8_t cmd, const uint8_t *data, size_t dataLen) {
-  uint8_t len = (uint8_t)(2 + dataLen);
-  mp3.write((uint8_t)0x7E);
-  mp3.write(len);
-  mp3.write(cmd);
-  for (size_t i = 0; i < dataLen; i++) mp3.write(data[i]);
-  mp3.write((uint8_t)0xEF);
-}
-
-static bool mp3ReadFrame(uint8_t &cmdOut, uint8_t *dataOut, size_t dataOutCap, size_t &dataLenOut, unsigned long timeoutMs) {
-  unsigned long start = millis();
-  bool started = false;
-  uint8_t len = 0;
-  uint8_t payload[16];
-  size_t payloadLen = 0;
-
-  while (millis() - start < timeoutMs) {
-    while (mp3.available()) {
-      uint8_t b = (uint8_t)mp3.read();
-      lastMp3RxMs = millis();
-
-      if (!started) {
-        if (b == 0x7E) {
-          started = true;
-          payloadLen = 0;
-          len = 0;
-        }
-        continue;
-      }
-
-      if (len == 0) {
-        len = b;
-        if (len < 2) {
-          started = false;
-          len = 0;
-        }
-        continue;
-      }
-
-      size_t needPayload = (size_t)(len - 1);
-      if (payloadLen < needPayload) {
-        if (payloadLen < sizeof(payload)) payload[payloadLen] = b;
-        payloadLen++;
-        continue;
-      }
-
-      if (b != 0xEF) {
-        started = false;
-        len = 0;
-        payloadLen = 0;
-        continue;
-      }
-
-      if (payloadLen < 1) {
-        started = false;
-        len = 0;
-        payloadLen = 0;
-        continue;
-      }
-
-      cmdOut = payload[0];
-      size_t dlen = (payloadLen >= 1) ? (payloadLen - 1) : 0;
-      dataLenOut = (dlen > dataOutCap) ? dataOutCap : dlen;
-      for (size_t i = 0; i < dataLenOut; i++) dataOut[i] = payload[i + 1];
-      return true;
-    }
-    delay(2);
-  }
-  return false;
+  // A stop pre-empts anything not yet sent (e.g. a play queued a moment ago).
+  mp3Drv.clear();
+  mp3QueueSelectTf(80);
+  mp3Drv.send(MP3_CMD_STOP, nullptr, 0, 80);
+  mp3Drv.send(MP3_CMD_PAUSE, nullptr, 0, 0);
 }
 
-static bool mp3Query1(uint8_t cmd, uint8_t &valOut) {
-  while (mp3.available()) mp3.read();
-  mp3WriteCmd(cmd, nullptr, 0);
-  uint8_t rcmd = 0;
-  uint8_t data[4];
-  size_t dlen = 0;
-  if (!mp3ReadFrame(rcmd, data, sizeof(data), dlen, 180)) return false;
-  if (rcmd != cmd) return false;
-  if (dlen < 1) return false;
-  valOut = data[0];
-  return true;
+static void onMp3Frame(void *ctx, const Mp3Frame &f, uint32_t now) {
+  (void)ctx;
+  (void)f;
+  lastMp3RxMs = now;
+  mp3Available = true;
+  lastMp3OkMs = now;
+  mp3ConsecutiveFailCount = 0;
 }
 
-static void probeMp3() {
-  uint8_t online = 0;
-  bool ok = mp3Query1(0x18, online);
-  const unsigned long now = millis();
-  if (ok) {
-    mp3ConsecutiveFailCount = 0;
-    mp3Available = true;
-    lastMp3OkMs = now;
-    mp3TfOnline = (online == 2);
-    return;
-  }
+static void onMp3Reply(void *ctx, const Mp3Frame &f, uint32_t now) {
+  (void)ctx;
+  (void)now;
+  if (f.cmd == MP3_CMD_QUERY_DEV && f.len >= 1) mp3TfOnline = (f.data[0] == 2);
+}
 
+static void onMp3Timeout(void *ctx, uint8_t cmd, uint32_t now) {
+  (void)ctx;
+  (void)cmd;
   // Don't immediately mark missing on a single failed probe; require sustained failures.
   if (mp3ConsecutiveFailCount < 255) mp3ConsecutiveFailCount++;
   const bool graceExpired = (lastMp3OkMs != 0) && (now - lastMp3OkMs >= 12000);
@@ -1970,6 +3083,13 @@ static void probeMp3() {
   }
 }
 
+// Queues the device query; the answer (or its absence) lands in onMp3Reply / onMp3Timeout.
+static void probeMp3() {
+  TRACE_SPAN("probeMp3");
+  mp3Drv.query(MP3_CMD_QUERY_DEV);
+  loopJobs.kick(jobMp3, millis());
+}
+
 void handleRoot() {
   String html = FPSTR(INDEX_HTML);
   html.replace("__SUPABASE_URL__", String(SUPABASE_URL));
@@ -2026,14 +3146,351 @@ void handleStatus() {
   out += "\"db_thr10\":" + String(dbChangeThreshold10) + ",";
   out += "\"db_hb\":" + String(dbHeartbeatMs) + ",";
   out += "\"db_up\":" + String(dbBulkUploadIntervalMs) + ",";
+  out += "\"db_mode\":\"" + String(dbUploadMode == DB_UPLOAD_BLOBS ? "blobs" : "rows") + "\",";
+  out += "\"db_blobs\":" + String((unsigned long)dbBlobsUploaded) + ",";
+  out += "\"db_blob_samples\":" + String((unsigned long)dbBlobSamples) + ",";
+  out += "\"db_blob_bytes\":" + String((unsigned long)dbBlobBytes) + ",";
+  out += "\"sd_hz\":" + String((unsigned long)sdSpiHz) + ",";
+  out += "\"sd_buf\":" + String(sdWriteBufBytes) + ",";
+  out += "\"sd_wr_kbps\":" + String((unsigned long)sdBenchWriteKBps) + ",";
+  out += "\"sd_rd_kbps\":" + String((unsigned long)sdBenchReadKBps) + ",";
+  out += "\"sd_append_us\":" + String((unsigned long)sdBenchAppendUs) + ",";
+  out += "\"db_ring\":" + String(dbRing.ready ? "true" : "false") + ",";
+  out += "\"db_ring_sectors\":" + String((unsigned long)dbRing.sectors) + ",";
+  out += "\"db_ring_writes\":" + String((unsigned long)dbRing.sectorWrites) + ",";
+  out += "\"db_ring_lost\":" + String((unsigned long)dbRing.sectorsOverwritten) + ",";
+  out += "\"evq_mode\":\"" + String(eventQueue.mode == EVQ_WRITE_THROUGH ? "sd" : "ram") + "\",";
+  out += "\"evq_ram\":" + String(eventQueue.count) + ",";
+  out += "\"evq_direct\":" + String((unsigned long)eventQueue.uploadedDirect) + ",";
+  out += "\"evq_spilled\":" + String((unsigned long)eventQueue.spilled) + ",";
+  out += "\"evq_last_spill\":\"" + String(EVQ_SPILL_NAMES[eventQueue.lastSpill]) + "\",";
+  out += "\"evq_sd_bytes\":" + String((unsigned long)eventQueue.sdBytes) + ",";
+  out += "\"evq_sd_saved\":" + String((unsigned long)eventQueue.sdBytesSaved) + ",";
+  out += "\"evq_lat_ram_ms\":" + String((unsigned long)eventQueue.ramLatency.avgMs()) + ",";
+  out += "\"evq_lat_sd_ms\":" + String((unsigned long)eventQueue.sdLatency.avgMs()) + ",";
+  out += "\"sync_ok\":" + String(syncSched.okCount) + ",";
+  out += "\"sync_fail\":" + String(syncSched.failCount) + ",";
+  out += "\"sync_batch\":" + String(syncSched.batchSize(SYNC_PRIO_WARNING, 220, SYNC_EVENT_BATCH_CAP)) + ",";
+  out += "\"probe_skip\":" + String(syncSched.probesSkipped) + ",";
+  out += "\"lp_en\":" + String(powerPolicy.enabled ? "true" : "false") + ",";
+  out += "\"lp_quiet_min\":" + String((unsigned long)(powerPolicy.quietAfterMs / 60000UL)) + ",";
+  out += "\"power_mode\":\"" + String(powerPolicy.mode == POWER_QUIET ? "QUIET" : "ACTIVE") + "\",";
+  out += "\"cpu_mhz\":" + String((unsigned long)getCpuFrequencyMhz()) + ",";
+  out += "\"energy_mj\":" + String((unsigned long)powerPolicy.energyMilliJoules()) + ",";
+  out += "\"lp_wake_ms\":" + String((unsigned long)powerPolicy.lastWakeLatencyMs) + ",";
+  out += "\"cls_en\":" + String(classifierSuppress ? "true" : "false") + ",";
+  out += "\"cls_min_conf\":" + String(classifierMinConfidence) + ",";
+  out += "\"cls_label\":\"" + String(noiseClassifier.hasLabel ? NOISE_CLASS_NAMES[noiseClassifier.label] : "") + "\",";
+  out += "\"cls_conf\":" + String(noiseClassifier.confidencePct) + ",";
+  out += "\"cls_us\":" + String((unsigned long)noiseClassifier.lastCostUs) + ",";
+  out += "\"cls_stride\":" + String(noiseClassifier.stride) + ",";
+  out += "\"cls_suppressed\":" + String((unsigned long)classifierSuppressedFrames) + ",";
   out += "\"mp3vol\":" + String(mp3Volume) + ",";
   out += "\"speaker\":" + String(speakerEnabled ? "true" : "false") + ",";
   out += "\"mp3err\":" + String((!mp3Available) ? "true" : "false") + ",";
+  out += "\"clk_src\":\"" + String(CLOCK_SOURCE_NAMES[clockService.source]) + "\",";
+  out += "\"clk_drift_ppb\":" + String((long)clockService.driftPpb) + ",";
+  out += "\"clk_offset_us\":" + String((long long)clockService.lastOffsetUs) + ",";
+  out += "\"nvs_writes\":" + String((unsigned long)settingsStore.commits) + ",";
+  out += "\"nvs_pending\":" + String(settingsStore.dirty ? "true" : "false") + ",";
+  out += "\"log_written\":" + String(eventLogRing.written) + ",";
+  out += "\"log_evicted\":" + String(eventLogRing.evicted) + ",";
+  out += "\"log_filtered\":" + String(eventLogRing.filtered) + ",";
+  out += "\"log_records\":" + String(eventLogRing.count) + ",";
+  out += "\"log_bytes\":" + String(eventLogRing.bytesUsed) + ",";
+  snapshotHeap();
+  out += "\"heap_free\":" + String(heapStats.freeBytes) + ",";
+  out += "\"heap_used\":" + String(heapStats.usedBytes) + ",";
+  out += "\"heap_largest\":" + String(heapStats.largestFree) + ",";
+  out += "\"heap_largest_min\":" + String(heapStats.minLargestFree) + ",";
+  out += "\"heap_min_free\":" + String(heapStats.minFree) + ",";
+  out += "\"heap_blocks\":" + String(heapStats.usedBlocks) + ",";
+  out += "\"heap_frag_pct\":" + String(heapStats.fragPct()) + ",";
+  out += "\"heap_alloc_fail\":" + String(heapStats.failed) + ",";
+  out += "\"heap_hooks\":" + String(heapStats.hooked ? "true" : "false") + ",";
+  out += "\"heap_allocs\":" + String(heapStats.allocs) + ",";
+  out += "\"heap_frees\":" + String(heapStats.frees) + ",";
+  out += "\"heap_loop_allocs\":" + String(heapStats.loopAllocs) + ",";
+  out += "\"heap_loop_alloc_kb\":" + String((unsigned long)(heapStats.loopAllocBytes / 1024ULL)) + ",";
+  out += "\"heap_frames\":" + String(heapStats.frames) + ",";
+  out += "\"heap_event_frames\":" + String(heapStats.eventFrames) + ",";
+  out += "\"heap_steady_alloc_frames\":" + String(heapStats.steadyAllocFrames) + ",";
+  out += "\"zones\":" + String(zoneCount) + ",";
+  out += "\"zone_db\":[";
+  for (int z = 0; z < zoneCount; z++) out += String(z ? "," : "") + String((int)zones[z].smoothDb);
+  out += "],\"zone_led\":[";
+  for (int z = 0; z < zoneCount; z++) out += String(z ? ",\"" : "\"") + ledStateToString(zones[z].engine.led) + "\"";
+  out += "],";
+  out += "\"avg_db\":" + String(avgDB) + ",";
+  out += "\"dsp_profile\":\"" + String(DSP_PROFILE::name) + "\",";
+  out += "\"store_free_kb\":" + String((unsigned long)(storageMgr.freeBytes / 1024ULL)) + ",";
+  out += "\"store_kb\":{";
+  for (int i = 0; i < STORE_CLASS_COUNT; i++) {
+    out += String(i ? ",\"" : "\"") + STORE_CLASS_NAMES[i] + "\":[" + String((unsigned long)(storageMgr.used[i] / 1024UL)) + "," +
+           String((unsigned long)(storageMgr.cfg.budget[i] / 1024UL)) + "]";
+  }
+  out += "},";
+  out += "\"store_recordings\":" + String(storageMgr.recCount) + ",";
+  out += "\"store_db_level\":" + String(storageMgr.dbLevel) + ",";
+  out += "\"store_pressure\":" + String(storageMgr.underPressure() ? "true" : "false") + ",";
+  out += "\"store_rec_expired\":" + String(storageMgr.stats.recExpired) + ",";
+  out += "\"store_rec_evicted\":" + String(storageMgr.stats.recEvicted + storageMgr.stats.madeRoom) + ",";
+  out += "\"store_pending_dropped\":" + String(storageMgr.stats.pendingDropped) + ",";
+  out += "\"store_db_dropped\":" + String(storageMgr.stats.dbLinesDropped) + ",";
+  out += "\"store_errors\":" + String(storageMgr.stats.errors) + ",";
+  out += "\"mp3_queue\":" + String(mp3Drv.count) + ",";
+  out += "\"mp3_queue_max\":" + String(mp3Drv.maxDepth) + ",";
+  out += "\"mp3_sent\":" + String(mp3Drv.sent) + ",";
+  out += "\"mp3_dropped\":" + String(mp3Drv.dropped) + ",";
+  out += "\"mp3_frames\":" + String(mp3Drv.parser.framesOk) + ",";
+  out += "\"mp3_bad_frames\":" + String(mp3Drv.parser.framesBad) + ",";
+  out += "\"mp3_timeouts\":" + String(mp3Drv.timeouts) + ",";
+  out += "\"clip_stream\":" + String(clipStreamEnabled ? "true" : "false") + ",";
+  out += "\"clip_ok\":" + String((unsigned long)clipStreamOk) + ",";
+  out += "\"clip_fail\":" + String((unsigned long)clipStreamFail) + ",";
+  out += "\"clip_tta_ms\":" + String((unsigned long)clipTtaLastMs) + ",";
+  out += "\"clip_tta_max_ms\":" + String((unsigned long)clipTtaMaxMs) + ",";
+  out += "\"live_feed\":" + String(liveFeedEnabled ? "true" : "false") + ",";
+  out += "\"live_feed_ms\":" + String((unsigned long)liveFeedPacer.intervalMs) + ",";
+  out += "\"live_feed_sent\":" + String((unsigned long)liveFeedSent) + ",";
+  out += "\"live_feed_err\":" + String((unsigned long)liveFeedErrors) + ",";
+  out += "\"files_active\":" + String(fileExport.active ? "true" : "false") + ",";
+  out += "\"files_chunk\":" + String((unsigned long)fileExport.chunk) + ",";
+  out += "\"files_exports\":" + String((unsigned long)fileExport.stats.exports) + ",";
+  out += "\"files_aborts\":" + String((unsigned long)fileExport.stats.aborts) + ",";
+  out += "\"files_sent_kb\":" + String((unsigned long)(fileExport.stats.bytes / 1024)) + ",";
+  out += "\"files_last_kbps\":" + String((unsigned long)fileExport.stats.lastKBps) + ",";
+  out += "\"files_max_kbps\":" + String((unsigned long)fileExport.stats.maxKBps) + ",";
+  out += "\"trace_frozen\":" + String(traceRing.frozen ? "true" : "false") + ",";
+  out += "\"trace_reason\":\"" + String(traceRing.frozen ? traceRing.freezeReason : "") + "\",";
+  out += "\"trace_stall_ms\":" + String((unsigned long)traceRing.freezeStallMs) + ",";
+  out += "\"trace_records\":" + String((unsigned long)traceRing.size()) + ",";
+  out += "\"trace_stalls\":" + String((unsigned long)traceRing.freezes) + ",";
+  static const char *const WIFI_RC_STATE_NAMES[] = { "idle", "fast", "scan", "up", "backoff" };
+  out += "\"wifi_rc_state\":\"" + String(WIFI_RC_STATE_NAMES[wifiRc.state]) + "\",";
+  out += "\"wifi_cached_ap\":" + String(wifiRc.cacheValid() ? "true" : "false") + ",";
+  out += "\"wifi_attempts\":" + String((unsigned long)wifiRc.attempts) + ",";
+  out += "\"wifi_fast_ok\":" + String((unsigned long)wifiRc.fastOk) + ",";
+  out += "\"wifi_fast_fail\":" + String((unsigned long)wifiRc.fastFail) + ",";
+  out += "\"wifi_scan_ok\":" + String((unsigned long)wifiRc.scanOk) + ",";
+  out += "\"wifi_scan_fail\":" + String((unsigned long)wifiRc.scanFail) + ",";
+  out += "\"wifi_drops\":" + String((unsigned long)wifiRc.drops) + ",";
+  out += "\"wifi_lease_reuse\":" + String((unsigned long)wifiRc.leaseReuses) + ",";
+  out += "\"wifi_reconnect_ms\":" + String((unsigned long)wifiRc.lastReconnectMs) + ",";
+  out += "\"wifi_reconnect_max_ms\":" + String((unsigned long)wifiRc.maxReconnectMs) + ",";
+  out += "\"wifi_reconnect_avg_ms\":" + String((unsigned long)wifiRc.avgReconnectMs()) + ",";
+  out += "\"wifi_events_dropped\":" + String((unsigned long)wifiEvents.dropped) + ",";
+  out += "\"boot_ttff_ms\":" + String((unsigned long)bootStages.firstFrameMs) + ",";
+  out += "\"boot_ttff_avg_ms\":" + String((unsigned long)bootHistory.avgMs()) + ",";
+  out += "\"boot_ttff_max_ms\":" + String((unsigned long)bootHistory.maxMs()) + ",";
+  out += "\"boot_count\":" + String((unsigned long)bootHistory.boots) + ",";
+  out += "\"boot_complete_ms\":" + String((unsigned long)bootStages.completeMs) + ",";
+  out += "\"boot_stages\":{";
+  for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+    const BootStageInfo &b = bootStages.st[i];
+    const bool ready = bootStages.ready((BootStage)i);
+    if (i) out += ",";
+    out += "\"" + String(BOOT_STAGE_NAMES[i]) + "\":{\"start_ms\":" + String((unsigned long)b.startMs) +
+           ",\"ready_ms\":" + String(ready ? (long)b.readyMs : -1L) + ",\"ok\":" + String(ready && b.ok ? "true" : "false") +
+           "}";
+  }
+  out += "},";
   out += "\"mp3tferr\":" + String((mp3Available && !mp3TfOnline) ? "true" : "false");
   out += "}";
   server.send(200, "application/json", out);
 }
 
+// Registers a handler inside a stall-tracer span named after its URI.
+static void onTraced(const char *uri, void (*fn)()) {
+  server.on(uri, [uri, fn]() {
+    TraceScope<TraceRing<TRACE_RECORDS>> span(traceRing, traceRing.intern(uri));
+    fn();
+  });
+}
+
+// Stall-tracer ring as Chrome trace JSON (open in ui.perfetto.dev). A ring that no stall has
+// frozen is held for the download; ?rearm=1 clears it and records again.
+void handleTrace() {
+  if (server.hasArg("rearm")) {
+    traceRing.rearm();
+    EVLOG(LOG_CFG, LOG_INFO, "Stall tracer re-armed");
+    server.send(204);
+    return;
+  }
+  const bool wasFrozen = traceRing.frozen;
+  traceRing.frozen = 1;
+  server.sendHeader("Content-Disposition", "attachment; filename=\"trace.json\"");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  String chunk;
+  chunk.reserve(1200);
+  auto emit = [&chunk](const char *line) {
+    chunk += line;
+    if (chunk.length() >= 1024) {
+      server.sendContent(chunk);
+      chunk = "";
+    }
+  };
+  traceRing.writeChrome(DEVICE_ID, emit);
+  if (chunk.length() > 0) server.sendContent(chunk);
+  server.sendContent("");
+  if (!wasFrozen) traceRing.frozen = 0;
+}
+
+void handleMetrics() {
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/plain; version=0.0.4", "");
+  String chunk;
+  chunk.reserve(1200);
+  auto emit = [&chunk](const char *line) {
+    chunk += line;
+    if (chunk.length() >= 1024) {
+      server.sendContent(chunk);
+      chunk = "";
+    }
+  };
+  loopMetrics.writePrometheus(DEVICE_ID, emit);
+  loopJobs.writePrometheus(DEVICE_ID, emit);
+  if (chunk.length() > 0) server.sendContent(chunk);
+  server.sendContent("");
+}
+
+// Admin-only routes: HTTP Basic as "admin". Without a password set they stay off.
+static bool requireAdmin() {
+  if (adminPassword.length() == 0) {
+    server.send(403, "text/plain", "set an admin password first (/setAdminPassword on the setup AP)");
+    return false;
+  }
+  if (server.authenticate("admin", adminPassword.c_str())) return true;
+  server.requestAuthentication(BASIC_AUTH, "noise-meter");
+  return false;
+}
+
+// True when the request came in over the setup AP, not the station network.
+static bool requestFromSetupAp() {
+  const wifi_mode_t mode = WiFi.getMode();
+  if (mode != WIFI_AP && mode != WIFI_AP_STA) return false;
+  return server.client().localIP() == WiFi.softAPIP();
+}
+
+// The first password can only be set from the setup AP (whoever can join it can already
+// change Wi-Fi); on the station network it stays refused. Changing it takes the current one.
+void handleSetAdminPassword() {
+  if (adminPassword.length() > 0) {
+    if (!requireAdmin()) return;
+  } else if (!requestFromSetupAp()) {
+    EVLOG(LOG_CFG, LOG_WARN, "Admin password bootstrap refused from {}", server.client().remoteIP().toString());
+    server.send(403, "text/plain", "the first admin password can only be set from the setup AP");
+    return;
+  }
+  const String pw = server.arg("pw");
+  if (pw.length() < 8 || pw.length() > 63) {
+    server.send(400, "text/plain", "pw must be 8..63 characters");
+    return;
+  }
+  const bool first = adminPassword.length() == 0;
+  preferences.begin("admin", false);
+  preferences.putString("pw", pw);
+  preferences.end();
+  adminPassword = pw;
+  EVLOG(LOG_CFG, LOG_INFO, "Admin password {}", first ? "set" : "changed");
+  server.send(204);
+}
+
+// One page of the card's root: name, size, mtime and the ETag a download of it carries.
+static void sendFileList() {
+  const long offset = server.hasArg("offset") ? server.arg("offset").toInt() : 0;
+  const long limit = server.hasArg("limit") ? server.arg("limit").toInt() : FILE_LIST_DEFAULT;
+  if (offset < 0 || limit < 1 || limit > FILE_LIST_MAX) {
+    server.send(400, "text/plain", "offset must be >= 0, limit 1.." + String(FILE_LIST_MAX));
+    return;
+  }
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  String chunk;
+  chunk.reserve(1200);
+  chunk += "{\"chunk\":" + String((unsigned long)fileExport.chunk) + ",\"files\":[";
+  char name[FILE_EXPORT_PATH_MAX];
+  char etag[24];
+  uint32_t size = 0, mtime = 0;
+  long index = 0, listed = 0;
+  bool more = false;
+  exportFs.listEnd();
+  while (exportFs.listNext(name, sizeof(name), size, mtime)) {
+    if (index++ < offset) continue;
+    if (listed == limit) {
+      more = true;
+      break;
+    }
+    fileEtag(size, mtime, etag, sizeof(etag));
+    etag[strlen(etag) - 1] = '\0';   // drop the closing quote; JSON gets both escaped
+    chunk += String(listed++ ? "," : "") + "{\"name\":\"" + name + "\",\"size\":" + String((unsigned long)size) +
+             ",\"mtime\":" + String((unsigned long)mtime) + ",\"etag\":\"\\\"" + (etag + 1) + "\\\"\"}";
+    if (chunk.length() >= 1024) {
+      server.sendContent(chunk);
+      chunk = "";
+    }
+  }
+  exportFs.listEnd();
+  chunk += "],\"next\":" + (more ? String(offset + limit) : String("null")) + "}";
+  server.sendContent(chunk);
+  server.sendContent("");
+}
+
+// Admin file export (file_export.h): without ?path a page of the listing, with it the file, honouring
+// Range, If-Range and If-None-Match. Only the headers go out here; jobFileExport streams the body.
+void handleFiles() {
+  if (!requireAdmin() || !sdGate()) return;
+  if (!sdReady()) {
+    server.send(503, "text/plain", "SD not available");
+    return;
+  }
+  if (!server.hasArg("path")) {
+    sendFileList();
+    return;
+  }
+  const String path = server.arg("path");
+  if (!fileExportPathOk(path.c_str())) {
+    server.send(400, "text/plain", "path must be an absolute SD path");
+    return;
+  }
+  uint32_t size = 0, mtime = 0;
+  if (!exportFs.stat(path.c_str(), size, mtime)) {
+    server.send(404, "text/plain", "NOT_FOUND");
+    return;
+  }
+  const FileExportPlan plan = fileExportPlan(size, mtime, server.header("Range").c_str(), server.header("If-Range").c_str(),
+                                             server.header("If-None-Match").c_str());
+  const bool head = server.method() == HTTP_HEAD;
+  if (!head && plan.len > 0 && fileExport.active) {
+    server.sendHeader("Retry-After", "5");
+    server.send(503, "text/plain", "another download is in progress");
+    return;
+  }
+  server.sendHeader("ETag", plan.etag);
+  server.sendHeader("Accept-Ranges", "bytes");
+  if (plan.status == 206) {
+    server.sendHeader("Content-Range", "bytes " + String((unsigned long)plan.start) + "-" +
+                                           String((unsigned long)(plan.start + plan.len - 1)) + "/" + String((unsigned long)size));
+  } else if (plan.status == 416) {
+    server.sendHeader("Content-Range", "bytes */" + String((unsigned long)size));
+  }
+  if (plan.status == 304 || plan.status == 416) {
+    server.send(plan.status);
+    return;
+  }
+  server.sendHeader("Content-Disposition", "attachment; filename=\"" + String(strrchr(path.c_str(), '/') + 1) + "\"");
+  server.setContentLength(plan.len);
+  server.send(plan.status, fileExportMime(path.c_str()), "");
+  if (head || plan.len == 0) return;
+  FileExportSink sink;
+  sink.client = server.client();
+  const uint32_t now = millis();
+  fileExport.begin(path.c_str(), plan.start, plan.len, sink, now);
+  loopJobs.kick(jobFileExport, now);
+  EVLOG(LOG_SD, LOG_INFO, "Export {}: {} bytes from {}", path.c_str(), (unsigned long)plan.len, (unsigned long)plan.start);
+}
+
 void handleNoiseLedTest() {
   String c = server.hasArg("c") ? server.arg("c") : String("");
   c.toLowerCase();
@@ -2059,6 +3516,7 @@ void handleNoiseLedTest() {
   noiseLedTestState = s;
   noiseLedTestUntilMs = millis() + 3000;
   setNoiseLedPwmForce(s);
+  loopJobs.kick(jobNoiseLedTest, millis());
   server.send(200, "text/plain", "OK");
 }
 
@@ -2112,11 +3570,11 @@ void handleSetAlertConfig() {
   if (majorWarningTimeMs <= secondWarningTimeMs) majorWarningTimeMs = secondWarningTimeMs + 1000UL;
 
   saveDeviceSettings();
-  if (majorRepeatIntervalMs != prevMaj) appendEventLog(getTimeString() + " | Major repeat min=" + String((int)(majorRepeatIntervalMs / 60000UL)));
-  if (silenceResetWindowMs != prevSil) appendEventLog(getTimeString() + " | Silence reset sec=" + String((int)(silenceResetWindowMs / 1000UL)));
-  if (firstWarningTimeMs != prevFw) appendEventLog(getTimeString() + " | First warning sec=" + String((int)(firstWarningTimeMs / 1000UL)));
-  if (secondWarningTimeMs != prevSw) appendEventLog(getTimeString() + " | Second warning sec=" + String((int)(secondWarningTimeMs / 1000UL)));
-  if (majorWarningTimeMs != prevMw) appendEventLog(getTimeString() + " | Major warning sec=" + String((int)(majorWarningTimeMs / 1000UL)));
+  if (majorRepeatIntervalMs != prevMaj) EVLOG(LOG_CFG, LOG_INFO, "Major repeat min={}", (int)(majorRepeatIntervalMs / 60000UL));
+  if (silenceResetWindowMs != prevSil) EVLOG(LOG_CFG, LOG_INFO, "Silence reset sec={}", (int)(silenceResetWindowMs / 1000UL));
+  if (firstWarningTimeMs != prevFw) EVLOG(LOG_CFG, LOG_INFO, "First warning sec={}", (int)(firstWarningTimeMs / 1000UL));
+  if (secondWarningTimeMs != prevSw) EVLOG(LOG_CFG, LOG_INFO, "Second warning sec={}", (int)(secondWarningTimeMs / 1000UL));
+  if (majorWarningTimeMs != prevMw) EVLOG(LOG_CFG, LOG_INFO, "Major warning sec={}", (int)(majorWarningTimeMs / 1000UL));
   server.send(204);
 }
 
@@ -2132,10 +3590,10 @@ void handleSetLedBrightness() {
 
   saveDeviceSettings();
   setNoiseLedPwm(currentState);
-  if (noiseGreenBrt != prevNg) appendEventLog(getTimeString() + " | Noise LED Green brightness=" + String(noiseGreenBrt));
-  if (noiseYellowBrt != prevNy) appendEventLog(getTimeString() + " | Noise LED Yellow brightness=" + String(noiseYellowBrt));
-  if (noiseRedBrt != prevNr) appendEventLog(getTimeString() + " | Noise LED Red brightness=" + String(noiseRedBrt));
-  if (statusLedBrt != prevSt) appendEventLog(getTimeString() + " | Status RGB brightness=" + String(statusLedBrt));
+  if (noiseGreenBrt != prevNg) EVLOG(LOG_CFG, LOG_INFO, "Noise LED Green brightness={}", noiseGreenBrt);
+  if (noiseYellowBrt != prevNy) EVLOG(LOG_CFG, LOG_INFO, "Noise LED Yellow brightness={}", noiseYellowBrt);
+  if (noiseRedBrt != prevNr) EVLOG(LOG_CFG, LOG_INFO, "Noise LED Red brightness={}", noiseRedBrt);
+  if (statusLedBrt != prevSt) EVLOG(LOG_CFG, LOG_INFO, "Status RGB brightness={}", statusLedBrt);
   server.send(204);
 }
 
@@ -2180,11 +3638,11 @@ void handleSetStatusRgb() {
   }
   statusLedManual = false;
   saveDeviceSettings();
-  if (statusRgbBoot != prevBoot) appendEventLog(getTimeString() + " | Status RGB Boot set");
-  if (statusRgbAp != prevAp) appendEventLog(getTimeString() + " | Status RGB AP set");
-  if (statusRgbWifiOk != prevWifi) appendEventLog(getTimeString() + " | Status RGB WiFi OK set");
-  if (statusRgbNoInternet != prevNoi) appendEventLog(getTimeString() + " | Status RGB No Internet set");
-  if (statusRgbOffline != prevOff) appendEventLog(getTimeString() + " | Status RGB Offline set");
+  if (statusRgbBoot != prevBoot) EVLOG(LOG_CFG, LOG_INFO, "Status RGB Boot set");
+  if (statusRgbAp != prevAp) EVLOG(LOG_CFG, LOG_INFO, "Status RGB AP set");
+  if (statusRgbWifiOk != prevWifi) EVLOG(LOG_CFG, LOG_INFO, "Status RGB WiFi OK set");
+  if (statusRgbNoInternet != prevNoi) EVLOG(LOG_CFG, LOG_INFO, "Status RGB No Internet set");
+  if (statusRgbOffline != prevOff) EVLOG(LOG_CFG, LOG_INFO, "Status RGB Offline set");
   server.send(204);
 }
 
@@ -2197,6 +3655,16 @@ void handleSetDbLogConfig() {
   if (server.hasArg("thr10")) dbChangeThreshold10 = server.arg("thr10").toInt();
   if (server.hasArg("hb")) dbHeartbeatMs = (unsigned long)server.arg("hb").toInt();
   if (server.hasArg("up")) dbBulkUploadIntervalMs = (unsigned long)server.arg("up").toInt();
+  if (server.hasArg("mode")) {
+    const uint8_t mode = server.arg("mode") == "blobs" ? DB_UPLOAD_BLOBS : DB_UPLOAD_ROWS;
+    if (mode != dbUploadMode) {
+      dbUploadMode = mode;
+      preferences.begin("ringlog", false);
+      preferences.putUInt("mode", dbUploadMode);
+      preferences.end();
+      EVLOG(LOG_CFG, LOG_INFO, "DB series upload mode={}", dbUploadMode == DB_UPLOAD_BLOBS ? "blobs" : "rows");
+    }
+  }
 
   dbSampleIntervalMs = constrain(dbSampleIntervalMs, (unsigned long)50, (unsigned long)5000);
   dbChangeThreshold10 = constrain(dbChangeThreshold10, 1, 200);
@@ -2204,43 +3672,227 @@ void handleSetDbLogConfig() {
   dbBulkUploadIntervalMs = constrain(dbBulkUploadIntervalMs, (unsigned long)60000, (unsigned long)86400000);
 
   saveDeviceSettings();
-  if (dbSampleIntervalMs != prevSamp) appendEventLog(getTimeString() + " | DB series sample_ms=" + String(dbSampleIntervalMs));
-  if (dbChangeThreshold10 != prevThr10) appendEventLog(getTimeString() + " | DB series change_db=" + String(dbChangeThreshold10 / 10.0f, 1));
-  if (dbHeartbeatMs != prevHb) appendEventLog(getTimeString() + " | DB series heartbeat_ms=" + String(dbHeartbeatMs));
-  if (dbBulkUploadIntervalMs != prevUp) appendEventLog(getTimeString() + " | DB series upload_ms=" + String(dbBulkUploadIntervalMs));
+  if (dbSampleIntervalMs != prevSamp) EVLOG(LOG_CFG, LOG_INFO, "DB series sample_ms={}", dbSampleIntervalMs);
+  if (dbChangeThreshold10 != prevThr10) EVLOG(LOG_CFG, LOG_INFO, "DB series change_db={}", dbChangeThreshold10 / 10.0f);
+  if (dbHeartbeatMs != prevHb) EVLOG(LOG_CFG, LOG_INFO, "DB series heartbeat_ms={}", dbHeartbeatMs);
+  if (dbBulkUploadIntervalMs != prevUp) EVLOG(LOG_CFG, LOG_INFO, "DB series upload_ms={}", dbBulkUploadIntervalMs);
+  // Both jobs were armed with the old intervals.
+  loopJobs.kick(jobDbSample, millis());
+  loopJobs.kick(jobDbUpload, millis());
   server.send(204);
 }
 
-void handleSetMicEnabled() {
-  if (server.hasArg("enabled")) {
-    bool prev = micEnabled;
-    micEnabled = (server.arg("enabled") == "1");
-    saveDeviceSettings();
-    if (!micEnabled) {
-      micZeroStartMs = 0;
-    }
-    if (micEnabled != prev) appendEventLog(getTimeString() + " | MIC set to " + String(micEnabled ? "ON" : "OFF"));
+void handleSetLowPower() {
+  bool prevEn = powerPolicy.enabled;
+  uint32_t prevQuiet = powerPolicy.quietAfterMs;
+  if (server.hasArg("enabled")) powerPolicy.enabled = (server.arg("enabled") == "1");
+  if (server.hasArg("quiet_min")) {
+    long v = server.arg("quiet_min").toInt();
+    if (v > 0) powerPolicy.quietAfterMs = (uint32_t)v * 60000UL;
   }
+  powerPolicy.quietAfterMs = constrain(powerPolicy.quietAfterMs, (uint32_t)60000, (uint32_t)7200000);
+
+  saveDeviceSettings();
+  if (powerPolicy.enabled != prevEn) EVLOG(LOG_CFG, LOG_INFO, "Low-power mode set to {}", powerPolicy.enabled ? "ON" : "OFF");
+  if (powerPolicy.quietAfterMs != prevQuiet) EVLOG(LOG_CFG, LOG_INFO, "Low-power quiet min={}", (int)(powerPolicy.quietAfterMs / 60000UL));
   server.send(204);
 }
 
-void handleSetSerialLoggingEnabled() {
-  if (server.hasArg("enabled")) {
-    bool prev = serialLoggingEnabled;
-    serialLoggingEnabled = (server.arg("enabled") == "1");
-    saveDeviceSettings();
-    if (serialLoggingEnabled != prev) appendEventLog(getTimeString() + " | Serial log set to " + String(serialLoggingEnabled ? "ON" : "OFF"));
+void handleSetClassifier() {
+  bool prevEn = classifierSuppress;
+  int prevConf = classifierMinConfidence;
+  if (server.hasArg("enabled")) classifierSuppress = (server.arg("enabled") == "1");
+  if (server.hasArg("min_conf")) classifierMinConfidence = server.arg("min_conf").toInt();
+  classifierMinConfidence = constrain(classifierMinConfidence, 30, 100);
+
+  saveDeviceSettings();
+  if (classifierSuppress != prevEn) EVLOG(LOG_CFG, LOG_INFO, "Classifier suppression set to {}", classifierSuppress ? "ON" : "OFF");
+  if (classifierMinConfidence != prevConf) EVLOG(LOG_CFG, LOG_INFO, "Classifier min confidence={}%", classifierMinConfidence);
+  server.send(204);
+}
+
+void handleSetZones() {
+  int prev = zoneCount;
+  if (server.hasArg("count")) zoneCount = constrain((int)server.arg("count").toInt(), 1, MAX_ZONES);
+  if (zoneCount != prev) {
+    // Zones past the first start over: levels, LED, escalation and db-series change detection.
+    for (int z = 1; z < MAX_ZONES; z++) {
+      NoiseEngine &e = zones[z].engine;
+      NoiseEngineHooks hooks = e.hooks;
+      NoiseEngineConfig cfg = e.cfg;
+      zones[z] = ZoneState();
+      zones[z].id = (uint8_t)z;
+      zoneDsp[z].reset();
+      zones[z].engine.hooks = hooks;
+      zones[z].engine.cfg = cfg;
+      zoneGroupId[z] = "";
+    }
+    micFrameSamples = 0;
+    startI2S();
+    EVLOG(LOG_CFG, LOG_INFO, "Zones={}", zoneCount);
   }
+  saveDeviceSettings();
   server.send(204);
 }
 
-void handleSetNoiseLedsEnabled() {
+// Budgets in KB; 0 puts a class back on its share of the card.
+void handleSetStorage() {
+  const char *args[STORE_CLASS_COUNT] = { "db_kb", "noise_kb", "pend_kb", "rec_kb" };
+  const char *keys[STORE_CLASS_COUNT] = { "db", "noise", "pend", "rec" };
+  preferences.begin("storage", false);
+  for (int i = 0; i < STORE_CLASS_COUNT; i++) {
+    if (!server.hasArg(args[i])) continue;
+    long kb = constrain(server.arg(args[i]).toInt(), 0L, 1048576L);
+    preferences.putUInt(keys[i], (uint32_t)kb * 1024UL);
+  }
+  if (server.hasArg("ret_days")) preferences.putUInt("ret", (uint32_t)constrain(server.arg("ret_days").toInt(), 7L, 14L));
+  preferences.end();
+  if (sdReady()) initStorageManager();
+  EVLOG(LOG_CFG, LOG_INFO, "Storage budgets KB: db={} noise={} pending={} rec={} | retention {}d",
+        (unsigned long)(storageMgr.cfg.budget[STORE_DB_SERIES] / 1024UL), (unsigned long)(storageMgr.cfg.budget[STORE_NOISE_LOG] / 1024UL),
+        (unsigned long)(storageMgr.cfg.budget[STORE_PENDING] / 1024UL), (unsigned long)(storageMgr.cfg.budget[STORE_RECORDINGS] / 1024UL),
+        storageMgr.cfg.retentionDays);
+  server.send(204);
+}
+
+void handleSetClipStream() {
   if (server.hasArg("enabled")) {
-    bool prev = noiseLedsEnabled;
-    noiseLedsEnabled = (server.arg("enabled") == "1");
-    saveDeviceSettings();
-    setNoiseLedPwm(currentState);
-    if (noiseLedsEnabled != prev) appendEventLog(getTimeString() + " | Noise LEDs set to " + String(noiseLedsEnabled ? "ON" : "OFF"));
+    bool en = server.arg("enabled").toInt() != 0;
+    if (en != clipStreamEnabled) {
+      clipStreamEnabled = en;
+      preferences.begin("clipstream", false);
+      preferences.putBool("en", clipStreamEnabled);
+      preferences.end();
+      EVLOG(LOG_CFG, LOG_INFO, "MAJOR clip streaming {}", clipStreamEnabled ? "on" : "off");
+    }
+  }
+  server.send(204);
+}
+
+static void loadLiveFeedConfig() {
+  preferences.begin("livefeed", true);
+  liveFeedEnabled = preferences.getBool("en", false);
+  liveFeedPacer.intervalMs = preferences.getUInt("ms", 0);
+  const uint32_t g = preferences.getUInt("group", 0);
+  liveFeedPort = (uint16_t)preferences.getUInt("port", LIVE_FEED_PORT);
+  preferences.end();
+  if (g != 0) {
+    for (int i = 0; i < 4; i++) liveFeedGroup[i] = (uint8_t)(g >> (24 - 8 * i));
+  }
+  if (liveFeedPort == 0) liveFeedPort = LIVE_FEED_PORT;
+}
+
+void handleSetLiveFeed() {
+  bool changed = false;
+  if (server.hasArg("enabled")) {
+    liveFeedEnabled = server.arg("enabled").toInt() != 0;
+    changed = true;
+  }
+  if (server.hasArg("ms")) {
+    long ms = server.arg("ms").toInt();
+    if (ms < 0 || ms > 60000) {
+      server.send(400, "text/plain", "ms must be 0..60000 (0 = every frame)");
+      return;
+    }
+    liveFeedPacer.intervalMs = (uint32_t)ms;
+    changed = true;
+  }
+  if (server.hasArg("group")) {
+    unsigned a, b, c, d;
+    char tail;
+    if (sscanf(server.arg("group").c_str(), "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 || a < 224 || a > 239 ||
+        b > 255 || c > 255 || d > 255) {
+      server.send(400, "text/plain", "group must be an IPv4 multicast address");
+      return;
+    }
+    liveFeedGroup[0] = (uint8_t)a;
+    liveFeedGroup[1] = (uint8_t)b;
+    liveFeedGroup[2] = (uint8_t)c;
+    liveFeedGroup[3] = (uint8_t)d;
+    changed = true;
+  }
+  if (server.hasArg("port")) {
+    long port = server.arg("port").toInt();
+    if (port < 1 || port > 65535) {
+      server.send(400, "text/plain", "port must be 1..65535");
+      return;
+    }
+    liveFeedPort = (uint16_t)port;
+    changed = true;
+  }
+  if (changed) {
+    preferences.begin("livefeed", false);
+    preferences.putBool("en", liveFeedEnabled);
+    preferences.putUInt("ms", liveFeedPacer.intervalMs);
+    preferences.putUInt("group", ((uint32_t)liveFeedGroup[0] << 24) | ((uint32_t)liveFeedGroup[1] << 16) |
+                                     ((uint32_t)liveFeedGroup[2] << 8) | liveFeedGroup[3]);
+    preferences.putUInt("port", liveFeedPort);
+    preferences.end();
+    liveFeedPacer.primed = false;
+    EVLOG(LOG_CFG, LOG_INFO, "Live feed {} -> {}.{}.{}.{}:{} every {} ms", liveFeedEnabled ? "on" : "off", liveFeedGroup[0],
+          liveFeedGroup[1], liveFeedGroup[2], liveFeedGroup[3], liveFeedPort, (unsigned long)liveFeedPacer.intervalMs);
+  }
+  server.send(204);
+}
+
+void handleSetEventQueue() {
+  EventDurability prevMode = eventQueue.mode;
+  uint32_t prevAge = eventQueue.maxRamAgeMs;
+  if (server.hasArg("mode")) {
+    String m = server.arg("mode");
+    if (m == "sd") eventQueue.mode = EVQ_WRITE_THROUGH;
+    else if (m == "ram") eventQueue.mode = EVQ_RAM_FIRST;
+  }
+  if (server.hasArg("max_age_s")) eventQueue.maxRamAgeMs = (uint32_t)server.arg("max_age_s").toInt() * 1000UL;
+  eventQueue.maxRamAgeMs = constrain(eventQueue.maxRamAgeMs, (uint32_t)5000, (uint32_t)600000);
+
+  saveDeviceSettings();
+  if (eventQueue.mode != prevMode) EVLOG(LOG_CFG, LOG_INFO, "Event queue mode set to {}", eventQueue.mode == EVQ_WRITE_THROUGH ? "sd" : "ram");
+  if (eventQueue.maxRamAgeMs != prevAge) EVLOG(LOG_CFG, LOG_INFO, "Event queue max RAM age={}s", (unsigned long)(eventQueue.maxRamAgeMs / 1000UL));
+  server.send(204);
+}
+
+static void applyPowerMode() {
+  heapStats.markEvent();
+  const bool quiet = (powerPolicy.mode == POWER_QUIET);
+  WiFi.setSleep(powerPolicy.modemSleep());
+  setCpuFrequencyMhz(powerPolicy.cpuMhz());
+  EVLOG(LOG_SYS, LOG_INFO, quiet ? "Power QUIET (low rate, modem sleep) | cpu={}" : "Power ACTIVE | cpu={}",
+        (int)getCpuFrequencyMhz());
+  // The sync job may be parked on the 60 s quiet interval; a loud frame should not wait that out.
+  if (!quiet) loopJobs.kick(jobSync, millis());
+}
+
+void handleSetMicEnabled() {
+  if (server.hasArg("enabled")) {
+    bool prev = micEnabled;
+    micEnabled = (server.arg("enabled") == "1");
+    saveDeviceSettings();
+    if (!micEnabled) {
+      micZeroStartMs = 0;
+    }
+    if (micEnabled != prev) EVLOG(LOG_CFG, LOG_INFO, "MIC set to {}", micEnabled ? "ON" : "OFF");
+  }
+  server.send(204);
+}
+
+void handleSetSerialLoggingEnabled() {
+  if (server.hasArg("enabled")) {
+    bool prev = serialLoggingEnabled;
+    serialLoggingEnabled = (server.arg("enabled") == "1");
+    saveDeviceSettings();
+    if (serialLoggingEnabled != prev) EVLOG(LOG_CFG, LOG_INFO, "Serial log set to {}", serialLoggingEnabled ? "ON" : "OFF");
+  }
+  server.send(204);
+}
+
+void handleSetNoiseLedsEnabled() {
+  if (server.hasArg("enabled")) {
+    bool prev = noiseLedsEnabled;
+    noiseLedsEnabled = (server.arg("enabled") == "1");
+    saveDeviceSettings();
+    setNoiseLedPwm(currentState);
+    if (noiseLedsEnabled != prev) EVLOG(LOG_CFG, LOG_INFO, "Noise LEDs set to {}", noiseLedsEnabled ? "ON" : "OFF");
   }
   server.send(204);
 }
@@ -2258,11 +3910,11 @@ void handleSetStatusColors() {
   if (server.hasArg("off")) statusColorOffline = constrain(server.arg("off").toInt(), SCP_OFF, SCP_WHITE);
   statusLedManual = false;
   saveDeviceSettings();
-  if (statusColorBoot != prevBoot) appendEventLog(getTimeString() + " | Status preset Boot changed");
-  if (statusColorAp != prevAp) appendEventLog(getTimeString() + " | Status preset AP changed");
-  if (statusColorWifiOk != prevWifi) appendEventLog(getTimeString() + " | Status preset WiFi OK changed");
-  if (statusColorNoInternet != prevNoi) appendEventLog(getTimeString() + " | Status preset No Internet changed");
-  if (statusColorOffline != prevOff) appendEventLog(getTimeString() + " | Status preset Offline changed");
+  if (statusColorBoot != prevBoot) EVLOG(LOG_CFG, LOG_INFO, "Status preset Boot changed");
+  if (statusColorAp != prevAp) EVLOG(LOG_CFG, LOG_INFO, "Status preset AP changed");
+  if (statusColorWifiOk != prevWifi) EVLOG(LOG_CFG, LOG_INFO, "Status preset WiFi OK changed");
+  if (statusColorNoInternet != prevNoi) EVLOG(LOG_CFG, LOG_INFO, "Status preset No Internet changed");
+  if (statusColorOffline != prevOff) EVLOG(LOG_CFG, LOG_INFO, "Status preset Offline changed");
   server.send(204);
 }
 
@@ -2277,9 +3929,9 @@ void handleStatusLedManual() {
   if (server.hasArg("r")) statusLedManualR = constrain(server.arg("r").toInt(), 0, LEDC_MAX);
   if (server.hasArg("g")) statusLedManualG = constrain(server.arg("g").toInt(), 0, LEDC_MAX);
   if (server.hasArg("b")) statusLedManualB = constrain(server.arg("b").toInt(), 0, LEDC_MAX);
-  if (statusLedManual != prevOn) appendEventLog(getTimeString() + " | Status LED manual=" + String(statusLedManual ? "ON" : "OFF"));
+  if (statusLedManual != prevOn) EVLOG(LOG_CFG, LOG_INFO, "Status LED manual={}", statusLedManual ? "ON" : "OFF");
   if (statusLedManualR != prevR || statusLedManualG != prevG || statusLedManualB != prevB) {
-    appendEventLog(getTimeString() + " | Status LED manual RGB updated");
+    EVLOG(LOG_CFG, LOG_INFO, "Status LED manual RGB updated");
   }
   server.send(204);
 }
@@ -2289,7 +3941,7 @@ void handleSetMp3Volume() {
     mp3Volume = constrain(server.arg("vol").toInt(), 0, 30);
     setMP3Volume((uint8_t)mp3Volume);
     saveDeviceSettings();
-    appendEventLog(getTimeString() + " | MP3 volume set to " + String(mp3Volume));
+    EVLOG(LOG_CFG, LOG_INFO, "MP3 volume set to {}", mp3Volume);
   }
   server.send(204);
 }
@@ -2308,16 +3960,11 @@ void handleSetThresholds() {
 
   saveDeviceSettings();
 
-  updateLEDState((int)smoothDB);
-
-  if ((int)smoothDB < RED_THRESHOLD) {
-    silenceBelowRedStartMs = millis();
-  } else {
-    silenceBelowRedStartMs = 0;
-  }
+  updateLEDState();
+  for (int z = 0; z < zoneCount; z++) zones[z].engine.restartSilenceWindow((int)zones[z].smoothDb, millis());
 
-  if (YELLOW_THRESHOLD != prevY) appendEventLog(getTimeString() + " | Yellow threshold=" + String(YELLOW_THRESHOLD));
-  if (RED_THRESHOLD != prevR) appendEventLog(getTimeString() + " | Red threshold=" + String(RED_THRESHOLD));
+  if (YELLOW_THRESHOLD != prevY) EVLOG(LOG_CFG, LOG_INFO, "Yellow threshold={}", YELLOW_THRESHOLD);
+  if (RED_THRESHOLD != prevR) EVLOG(LOG_CFG, LOG_INFO, "Red threshold={}", RED_THRESHOLD);
 
   server.sendHeader("Location", "/");
   server.send(303);
@@ -2332,7 +3979,7 @@ void handleToggleSpeaker() {
 void handleSetSpeaker() {
   if (server.hasArg("enabled")) {
     speakerEnabled = (server.arg("enabled") == "1");
-    appendEventLog(getTimeString() + " | Speaker set to " + String(speakerEnabled ? "ON" : "OFF"));
+    EVLOG(LOG_CFG, LOG_INFO, "Speaker set to {}", speakerEnabled ? "ON" : "OFF");
     saveDeviceSettings();
   }
   server.send(204);
@@ -2346,6 +3993,9 @@ void handleDisconnect() {
   networkSSID = "";
   networkPassword = "";
 
+  wifiRc.stop();
+  wifiRc.forget();
+  saveWifiApCache();
   WiFi.disconnect(false, true);
   delay(100);
   WiFi.mode(WIFI_AP_STA);
@@ -2353,7 +4003,7 @@ void handleDisconnect() {
   wifiConnecting = false;
   wifiConnected = false;
   wifiStatusMessage = "Disconnected";
-  appendEventLog(getTimeString() + " | WiFi disconnected");
+  EVLOG(LOG_NET, LOG_INFO, "WiFi disconnected");
   logNetworkInfo("WiFi disconnected");
 
   server.sendHeader("Location", "/");
@@ -2361,48 +4011,145 @@ void handleDisconnect() {
 }
 
 void handlePlayTest001() {
-  appendEventLog(getTimeString() + " | Speaker test: play 001");
+  EVLOG(LOG_AUDIO, LOG_INFO, "Speaker test: play 001");
   playMP3(0x01);
   server.sendHeader("Location", "/");
   server.send(303);
 }
 
 void handlePlayTest002() {
-  appendEventLog(getTimeString() + " | Speaker test: play 002");
+  EVLOG(LOG_AUDIO, LOG_INFO, "Speaker test: play 002");
   playMP3(0x02);
   server.sendHeader("Location", "/");
   server.send(303);
 }
 
 void handlePlayTest003() {
-  appendEventLog(getTimeString() + " | Speaker test: play 003");
+  EVLOG(LOG_AUDIO, LOG_INFO, "Speaker test: play 003");
   playMP3(0x03);
   server.sendHeader("Location", "/");
   server.send(303);
 }
 
 void handleStopMp3() {
-  appendEventLog(getTimeString() + " | Speaker: stop");
+  EVLOG(LOG_AUDIO, LOG_INFO, "Speaker: stop");
   stopMP3();
   server.send(204);
 }
 
+// Record stamps are millis(); they are mapped through the disciplined clock when read, so lines
+// logged before the first sync still get a real time once one arrives.
+static size_t formatLogTime(uint32_t monoMs, char *buf, size_t n) {
+  uint64_t ms = clockService.toEpochMs(monoUsFromMillis(monoMs));
+  if (ms == 0) return (size_t)snprintf(buf, n, "TIME_NOT_SET");
+  time_t sec = (time_t)(ms / 1000ULL);
+  struct tm timeinfo;
+  localtime_r(&sec, &timeinfo);
+  return strftime(buf, n, "%Y-%m-%d %H:%M:%S", &timeinfo);
+}
+
+// "time | message", or "time | level sub | message" when verbose. Returns the length.
+static size_t formatLogLine(const LogRecord &r, bool verbose, char *buf, size_t n) {
+  size_t o = formatLogTime(r.monoMs, buf, n);
+  int w = verbose ? snprintf(buf + o, n - o, " | %s %s | ", LOG_LEVEL_NAMES[r.level & 3],
+                             r.sub < LOG_SUB_COUNT ? LOG_SUB_NAMES[r.sub] : "?")
+                  : snprintf(buf + o, n - o, " | ");
+  if (w > 0) o += ((size_t)w < n - o) ? (size_t)w : n - o - 1;
+  return o + logFormatMessage(r, buf + o, n - o);
+}
+
+template <int N>
+static void streamLogRing(const StructLog<N> &ring) {
+  const bool verbose = server.hasArg("verbose") && server.arg("verbose") == "1";
+  const uint32_t since = server.hasArg("since") ? (uint32_t)server.arg("since").toInt() : 0;
+  server.sendHeader("X-Log-Next", String(ring.nextSeq));
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/plain", "");
+  String chunk;
+  chunk.reserve(1200);
+  char line[LOG_MAX_RECORD + 64];
+  ring.forEach(since, [&](const LogRecord &r) {
+    formatLogLine(r, verbose, line, sizeof(line));
+    chunk += line;
+    chunk += "\n";
+    if (chunk.length() >= 1024) {
+      server.sendContent(chunk);
+      chunk = "";
+    }
+  });
+  if (chunk.length() > 0) server.sendContent(chunk);
+  server.sendContent("");
+}
+
+// Appends records not yet exported to /event_log.txt. Returns the number written, -1 on SD failure.
+static int exportEventLog() {
+  if (!sdReady()) return -1;
+  File f = SD.open(EVENT_LOG_EXPORT_PATH, FILE_APPEND);
+  if (!f) return -1;
+  char line[LOG_MAX_RECORD + 64];
+  int n = 0;
+  eventLogExportSeq = eventLogRing.forEach(eventLogExportSeq, [&](const LogRecord &r) {
+    size_t len = formatLogLine(r, true, line, sizeof(line));
+    f.write((const uint8_t *)line, len);
+    f.write('\n');
+    n++;
+  });
+  f.close();
+  return n;
+}
+
+// Echoes a few new event records per loop so a burst of log calls never blocks on the UART.
+static void drainEventLogSerial() {
+  if (!serialLoggingEnabled) {
+    eventLogSerialSeq = eventLogRing.nextSeq;
+    return;
+  }
+  if (eventLogSerialSeq == eventLogRing.nextSeq) return;
+  char line[LOG_MAX_RECORD + 64];
+  eventLogSerialSeq = eventLogRing.forEach(eventLogSerialSeq, [&](const LogRecord &r) {
+    formatLogLine(r, false, line, sizeof(line));
+    Serial.println(line);
+  }, EVENT_LOG_SERIAL_BUDGET);
+}
+
 void handleEvents() {
-  String out;
-  for (int i = 0; i < eventLogCount; i++) {
-    out += eventLog[i];
-    out += "\n";
+  if (server.hasArg("export") && server.arg("export") == "1") {
+    int n = exportEventLog();
+    if (n < 0) server.send(503, "text/plain", "SD not available");
+    else server.send(200, "text/plain", String(n) + " record(s) appended to " + EVENT_LOG_EXPORT_PATH);
+    return;
   }
-  server.send(200, "text/plain", out);
+  streamLogRing(eventLogRing);
 }
 
 void handleMonitor() {
-  String out;
-  for (int i = 0; i < monitorLogCount; i++) {
-    out += monitorLog[i];
-    out += "\n";
+  streamLogRing(monitorLogRing);
+}
+
+void handleSetLogLevel() {
+  if (!server.hasArg("level")) {
+    server.send(400, "text/plain", "missing level");
+    return;
   }
-  server.send(200, "text/plain", out);
+  String lv = server.arg("level");
+  int level = -1;
+  for (int i = 0; i <= LOG_DEBUG; i++) {
+    if (lv == LOG_LEVEL_NAMES[i]) level = i;
+  }
+  String sub = server.hasArg("sub") ? server.arg("sub") : String("all");
+  int idx = -1;
+  for (int i = 0; i < LOG_SUB_COUNT; i++) {
+    if (sub == LOG_SUB_NAMES[i]) idx = i;
+  }
+  if (level < 0 || (idx < 0 && sub != "all")) {
+    server.send(400, "text/plain", "bad sub or level");
+    return;
+  }
+  for (int i = 0; i < LOG_SUB_COUNT; i++) {
+    if (idx < 0 || i == idx) eventLogRing.threshold[i] = (uint8_t)level;
+  }
+  EVLOG(LOG_CFG, LOG_INFO, "Log level {}={}", sub, LOG_LEVEL_NAMES[level]);
+  server.send(204);
 }
 
 static String maskSecretForLog(const String &s) {
@@ -2421,11 +4168,27 @@ static String maskSecretForLog(const String &s) {
 }
 
 void handleSdReinit() {
+  if (!sdGate()) return;
   bool ok = tryInitSd(true);
   server.send(200, "text/plain", ok ? "OK" : "FAIL");
 }
 
 void handleSdInfo() {
+  if (!sdGate()) return;
+  if (server.hasArg("bench") && server.arg("bench") == "1") {
+    const char *busy = sdBenchBlocker();
+    if (busy) {
+      server.send(409, "text/plain", String("SD benchmark refused: ") + busy);
+      return;
+    }
+    if (!startSdBench()) {
+      server.send(503, "text/plain", "SD benchmark could not start");
+      return;
+    }
+    server.send(202, "text/plain", "SD benchmark started; /sdinfo has the result in a few seconds");
+    return;
+  }
+
   uint8_t ct = SD.cardType();
   uint64_t sz = 0;
   if (ct != CARD_NONE) sz = SD.cardSize();
@@ -2435,7 +4198,27 @@ void handleSdInfo() {
   out += "\"sdInitOk\":" + String(sdInitOk ? "true" : "false") + ",";
   out += "\"sdAvailable\":" + String(sdAvailable ? "true" : "false") + ",";
   out += "\"cardType\":\"" + String(sdCardTypeStr(ct)) + "\",";  
-  out += "\"cardSizeMB\":" + String((unsigned long long)(sz / (1024ULL * 1024ULL)));
+  out += "\"cardSizeMB\":" + String((unsigned long long)(sz / (1024ULL * 1024ULL))) + ",";
+  out += "\"spiHz\":" + String((unsigned long)sdSpiHz) + ",";
+  out += "\"writeBuf\":" + String(sdWriteBufBytes) + ",";
+  out += "\"tuned\":" + String(sdTuned ? "true" : "false");
+  if (sdBenchHaveResult) {
+    out += ",\"bench\":{\"elapsedMs\":" + String((unsigned long)sdBenchLast.elapsedMs) + ",\"steps\":[";
+    for (int i = 0; i < sdBenchLast.stepCount; i++) {
+      const SdBenchStep &st = sdBenchLast.steps[i];
+      if (i > 0) out += ",";
+      out += "{\"hz\":" + String((unsigned long)st.hz);
+      out += ",\"ok\":" + String(st.verified ? "true" : "false");
+      out += ",\"appendAvgUs\":" + String((unsigned long)st.appendAvgUs);
+      out += ",\"appendMaxUs\":" + String((unsigned long)st.appendMaxUs);
+      for (int b = 0; b < SD_BENCH_BUF_COUNT; b++) {
+        out += ",\"wr" + String(SD_BENCH_BUFS[b]) + "\":" + String((unsigned long)st.writeKBps[b]);
+        out += ",\"rd" + String(SD_BENCH_BUFS[b]) + "\":" + String((unsigned long)st.readKBps[b]);
+      }
+      out += "}";
+    }
+    out += "]}";
+  }
   out += "}";
   server.send(200, "application/json", out);
 }
@@ -2459,12 +4242,12 @@ void handleNetworkConnection() {
     WiFi.disconnect(false, false);
     delay(500);
     Serial.println(String("WiFi begin (manual save) SSID=") + networkSSID);
-    WiFi.begin(networkSSID.c_str(), networkPassword.c_str());
+    // New credentials may mean a different network: the cached AP and lease no longer apply.
+    wifiRc.forget();
+    saveWifiApCache();
+    applyWifiAction(wifiRc.start(millis(), wifiEpochS()));
 
-    wifiConnecting = true;
     wifiConnected = false;
-    wifiStartTime = millis();
-    wifiStatusMessage = "Connecting...";
 
     server.sendHeader("Location", "/");
     server.send(303);
@@ -2488,19 +4271,72 @@ void connectToWiFi() {
     wifiConnecting = false;
     wifiConnected = false;
     wifiStatusMessage = "Not configured";
-    appendEventLog(getTimeString() + " | WiFi not configured");
+    EVLOG(LOG_NET, LOG_INFO, "WiFi not configured");
     logNetworkInfo("WiFi not configured");
     return;
   }
 
   if (networkSSID.length() > 0) {
-    lastWifiRetryMs = millis();
-    Serial.println(String("WiFi begin (boot) SSID=") + networkSSID);
-    WiFi.begin(networkSSID.c_str(), networkPassword.c_str());
-    wifiConnecting = true;
+    preferences.begin("wifi", true);
+    if (preferences.getBytes("ap", &wifiRc.cache, sizeof(wifiRc.cache)) != sizeof(wifiRc.cache)) wifiRc.cache = {};
+    preferences.end();
+    Serial.println(String("WiFi begin (boot) SSID=") + networkSSID + (wifiRc.cacheValid() ? " (cached AP)" : ""));
+    applyWifiAction(wifiRc.start(millis(), wifiEpochS()));
     wifiConnected = false;
-    wifiStartTime = millis();
-    wifiStatusMessage = "Connecting...";
+  }
+}
+
+uint32_t wifiEpochS() {
+  return (uint32_t)(getEpochMs() / 1000ULL);
+}
+
+void saveWifiApCache() {
+  if (!wifiRc.cacheDirty) return;
+  preferences.begin("wifi", false);
+  preferences.putBytes("ap", &wifiRc.cache, sizeof(wifiRc.cache));
+  preferences.end();
+  wifiRc.cacheDirty = false;
+}
+
+// Carries out what the reconnect machine asked for. Only the connect actions touch the
+// association; the machine ignores the ASSOC_LEAVE our own disconnect() produces.
+void applyWifiAction(WifiRcAction a) {
+  const WifiApCache &c = wifiRc.cache;
+  switch (a) {
+    case WIFI_ACT_CONNECT_FAST: {
+      TRACE_SPAN("wifi.beginFast");
+      if (wifiRc.leaseInUse) {
+        WiFi.config(IPAddress(c.ip), IPAddress(c.gateway), IPAddress(c.netmask), IPAddress(c.dns));
+      } else {
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+      }
+      WiFi.begin(networkSSID.c_str(), networkPassword.c_str(), c.channel, c.bssid);
+      wifiConnecting = true;
+      wifiStatusMessage = "Connecting...";
+      EVLOG(LOG_NET, LOG_INFO, "WiFi fast connect ch {}{}", c.channel, wifiRc.leaseInUse ? " (cached lease)" : "");
+      break;
+    }
+    case WIFI_ACT_CONNECT_SCAN: {
+      TRACE_SPAN("wifi.beginScan");
+      WiFi.disconnect(false, false);
+      WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+      WiFi.begin(networkSSID.c_str(), networkPassword.c_str());
+      wifiConnecting = true;
+      wifiStatusMessage = "Connecting...";
+      EVLOG(LOG_NET, LOG_INFO, "WiFi scan connect");
+      break;
+    }
+    case WIFI_ACT_STOP:
+      WiFi.disconnect(false, false);
+      wifiConnecting = false;
+      wifiStatusMessage = "Connection Failed";
+      break;
+    case WIFI_ACT_DHCP:
+      // Static lease served the fast connect; renew through DHCP like any other client.
+      WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+      break;
+    default:
+      break;
   }
 }
 
@@ -2543,19 +4379,47 @@ String makeRecordingFilename() {
   return String("/rec_") + String(millis()) + String(".wav");
 }
 
-bool recordINMP441Wav5s() {
-  const uint32_t sampleRate = 16000;
+// One DMA buffer of one zone as 16-bit PCM; with two zones the other channel of each interleaved
+// frame is skipped. Returns the sample count, 0 if the read failed.
+static size_t readZonePcm(uint8_t zone, int16_t *pcm) {
+  int32_t i2sBuf[BUFFER_LEN];
+  size_t bytesRead = 0;
+  esp_err_t err = i2s_read(I2S_PORT, (void*)i2sBuf, sizeof(i2sBuf), &bytesRead, portMAX_DELAY);
+  if (err != ESP_OK || bytesRead == 0) {
+    Serial.println("I2S read failed");
+    return 0;
+  }
+  const size_t stride = (size_t)zoneCount;
+  size_t nSamples = bytesRead / sizeof(int32_t) / stride;
+  for (size_t i = 0; i < nSamples; i++) {
+    int32_t s = i2sBuf[i * stride + zone] >> 14;
+    if (s > 32767) s = 32767;
+    if (s < -32768) s = -32768;
+    pcm[i] = (int16_t)s;
+  }
+  return nSamples;
+}
+
+// Mono clip of one zone, written to SD.
+bool recordINMP441Wav5s(uint8_t zone) {
+  TRACE_SPAN("recordINMP441Wav5s");
+  const uint32_t sampleRate = MAJOR_CLIP_RATE;
   const uint16_t bitsPerSample = 16;
   const uint16_t channels = 1;
-  const uint32_t durationMs = 5000;
+  const uint32_t durationMs = MAJOR_CLIP_MS;
   const uint32_t totalSamples = (sampleRate * durationMs) / 1000;
   const uint32_t targetDataBytes = totalSamples * channels * (bitsPerSample / 8);
 
-  if (!SD.begin(SD_CS, SPI, 1000000)) {
+  if (!sdReady() || !sdBegin()) {
     Serial.println("SD not available for recording");
     return false;
   }
 
+  // A MAJOR clip always gets written: the oldest recordings make way if the card is that full.
+  if (!storageMgr.makeRoom(targetDataBytes + 44 + 32768)) {
+    EVLOG(LOG_SD, LOG_WARN, "Recording: only {} KB free", (unsigned long)(storageMgr.freeBytes / 1024ULL));
+  }
+
   String filename = makeRecordingFilename();
   lastRecordedWavPath = filename;
   File f = SD.open(filename.c_str(), FILE_WRITE);
@@ -2570,36 +4434,41 @@ bool recordINMP441Wav5s() {
   }
 
   size_t bytesWritten = 0;
-  int32_t i2sBuf[BUFFER_LEN];
+  size_t captured = 0;
   int16_t pcmBuf[BUFFER_LEN];
 
-  while (bytesWritten < targetDataBytes) {
-    size_t bytesRead = 0;
-    esp_err_t err = i2s_read(I2S_PORT, (void*)i2sBuf, sizeof(i2sBuf), &bytesRead, portMAX_DELAY);
-    if (err != ESP_OK || bytesRead == 0) {
-      Serial.println("I2S read failed");
-      break;
-    }
+  // Stage PCM into the write size the SD benchmark found fastest.
+  static uint8_t stage[4096];
+  const size_t stageCap = constrain((size_t)sdWriteBufBytes, sizeof(pcmBuf), sizeof(stage));
+  size_t staged = 0;
 
-    size_t nSamples = bytesRead / sizeof(int32_t);
-    for (size_t i = 0; i < nSamples; i++) {
-      int32_t s = i2sBuf[i] >> 14;
-      if (s > 32767) s = 32767;
-      if (s < -32768) s = -32768;
-      pcmBuf[i] = (int16_t)s;
-    }
+  while (captured < targetDataBytes) {
+    size_t nSamples = readZonePcm(zone, pcmBuf);
+    if (nSamples == 0) break;
 
     size_t bytesToWrite = nSamples * sizeof(int16_t);
-    if (bytesWritten + bytesToWrite > targetDataBytes) {
-      bytesToWrite = targetDataBytes - bytesWritten;
+    if (captured + bytesToWrite > targetDataBytes) {
+      bytesToWrite = targetDataBytes - captured;
     }
 
-    size_t w = f.write((uint8_t*)pcmBuf, bytesToWrite);
-    bytesWritten += w;
-    if (w != bytesToWrite) {
-      Serial.println("SD write short");
-      break;
+    if (staged + bytesToWrite > stageCap) {
+      size_t w = f.write(stage, staged);
+      bytesWritten += w;
+      if (w != staged) {
+        staged = 0;
+        Serial.println("SD write short");
+        break;
+      }
+      staged = 0;
     }
+    memcpy(stage + staged, pcmBuf, bytesToWrite);
+    staged += bytesToWrite;
+    captured += bytesToWrite;
+  }
+  if (staged > 0) {
+    size_t w = f.write(stage, staged);
+    bytesWritten += w;
+    if (w != staged) Serial.println("SD write short");
   }
 
   writeWavHeader(f, sampleRate, bitsPerSample, channels, (uint32_t)bytesWritten);
@@ -2612,95 +4481,189 @@ bool recordINMP441Wav5s() {
   return bytesWritten > 0;
 }
 
-// ================= SETUP =================
-void setup() {
-  Serial.begin(115200);
-  delay(200);
+// ================= MAJOR CLIP STREAMING =================
+// Chunks come from PSRAM when the board has it, internal RAM otherwise.
+static void *clipAllocChunk(size_t n) {
+  void *p = heap_caps_malloc(n, MALLOC_CAP_SPIRAM);
+  return p ? p : heap_caps_malloc(n, MALLOC_CAP_8BIT);
+}
 
-  applyTimezone();
+static void clipFreeChunk(void *p) {
+  heap_caps_free(p);
+}
 
-  pinMode(LED_GREEN, OUTPUT);
-  pinMode(LED_YELLOW, OUTPUT);
-  pinMode(LED_RED, OUTPUT);
+static uint32_t clipNowMs() {
+  return millis();
+}
 
-  pinMode(STATUS_LED_R, OUTPUT);
-  pinMode(STATUS_LED_G, OUTPUT);
-  pinMode(STATUS_LED_B, OUTPUT);
+static void clipSleepMs(uint32_t ms) {
+  vTaskDelay(pdMS_TO_TICKS(ms));
+}
 
-  SPI.begin(18, 19, 23, SD_CS);
+struct ClipTlsConn {
+  WiFiClientSecure client;
+  bool connect(const char *host, uint16_t port) {
+    client.setInsecure();
+    return client.connect(host, port);
+  }
+  size_t write(const uint8_t *p, size_t n) { return client.write(p, n); }
+  int read(uint8_t *p, size_t n) {
+    if (client.available() > 0) return client.read(p, n);
+    return client.connected() ? 0 : -1;
+  }
+  void stop() { client.stop(); }
+};
+
+// Runs on core 0 next to the Wi-Fi stack while loop() records on core 1.
+static void clipStreamTask(void *arg) {
   {
-    bool ok = SD.begin(SD_CS, SPI, 1000000);
-    sdInitOk = ok && (SD.cardType() != CARD_NONE);
-    sdAvailable = sdInitOk;
+    TraceScope<TraceRing<TRACE_RECORDS>> span(traceRing, traceClipStreamId);
+    ClipTlsConn conn;
+    clipStreamRun(*(ClipUpload *)arg, conn, clipNowMs, clipSleepMs, 5000);
   }
+  vTaskDelete(nullptr);
+}
 
-  loadDeviceSettings();
+// Starts the upload of a clip about to be recorded. False (nothing started) when streaming is
+// off, one is still in flight, the uplink is down or RAM cannot hold the clip.
+static bool startClipStream(uint8_t zone, const String &localName, size_t total) {
+  if (!clipStreamEnabled || clipUp.getState() != CLIP_IDLE || !eventUplinkUp()) return false;
+  const bool psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM) >= total + CLIP_CHUNK_BYTES;
+  if (!psram && heap_caps_get_free_size(MALLOC_CAP_8BIT) < total + CLIP_HEAP_RESERVE) {
+    EVLOG(LOG_AUDIO, LOG_INFO, "Clip stream skipped: {} KB free", (unsigned long)(heap_caps_get_free_size(MALLOC_CAP_8BIT) / 1024));
+    return false;
+  }
+  heapStats.markEvent();
+  if (!clipUp.buf.reserve(total, clipAllocChunk, clipFreeChunk)) return false;
+
+  const char *host = strstr(SUPABASE_URL, "://");
+  host = host ? host + 3 : SUPABASE_URL;
+  size_t hostLen = strcspn(host, "/");
+  if (hostLen >= sizeof(clipUp.host)) hostLen = sizeof(clipUp.host) - 1;
+  memcpy(clipUp.host, host, hostLen);
+  clipUp.host[hostLen] = '\0';
+  clipUp.port = 443;
+  snprintf(clipUp.path, sizeof(clipUp.path), "/storage/v1/object/recordings/%s", makeClipObjectPath(zone, localName).c_str());
+  clipUp.apiKey = SUPABASE_API_KEY;
+  clipUp.contentType = "audio/wav";
+  clipUp.total = total;
+  clipUp.captured = 0;
+  clipUp.abort = 0;
+  clipUp.captureEndMs = 0;
+  clipUp.setState(CLIP_STREAMING);
+  if (xTaskCreatePinnedToCore(clipStreamTask, "clip_up", 10240, &clipUp, 1, &clipTaskHandle, 0) != pdPASS) {
+    clipUp.buf.clear();
+    clipUp.setState(CLIP_IDLE);
+    return false;
+  }
+  return true;
+}
 
-  initLedPwm();
+// Records into clipUp while its task sends it. A failed I2S read is padded with silence so the
+// clip still matches the length its header announced.
+static void recordClipToStream(uint8_t zone) {
+  const uint32_t dataBytes = (MAJOR_CLIP_RATE * MAJOR_CLIP_MS / 1000) * sizeof(int16_t);
+  uint8_t header[CLIP_WAV_HEADER_BYTES];
+  clipWavHeader(header, MAJOR_CLIP_RATE, 16, 1, dataBytes);
+  clipUp.buf.append(header, sizeof(header));
+  clipUp.publish(clipUp.buf.len);
 
-  initRtc();
-  applyRtcToSystemTimeIfNeeded();
-  
-  WiFi.mode(WIFI_AP_STA);
-  WiFi.onEvent(onWiFiEvent);
-  WiFi.setSleep(false);
-  WiFi.setAutoReconnect(false);
-  WiFi.persistent(false);
-  WiFi.softAP("ESP32_NOISE_Setup", "12345678");
-  logNetworkInfo("Boot");
-  connectToWiFi();
-
-  server.on("/", handleRoot);
-  server.on("/save", handleNetworkConnection);
-  server.on("/scan", handleScanNetworks);
-  server.on("/status", handleStatus);
-  server.on("/setThresholds", handleSetThresholds);
-  server.on("/setAlertConfig", handleSetAlertConfig);
-  server.on("/toggleSpeaker", handleToggleSpeaker);
-  server.on("/setSpeaker", handleSetSpeaker);
-  server.on("/disconnect", handleDisconnect);
-  server.on("/playTest001", handlePlayTest001);
-  server.on("/playTest002", handlePlayTest002);
-  server.on("/playTest003", handlePlayTest003);
-  server.on("/stopMp3", handleStopMp3);
-  server.on("/setMp3Volume", handleSetMp3Volume);
-  server.on("/setLedBrightness", handleSetLedBrightness);
-  server.on("/setNoiseLedsEnabled", handleSetNoiseLedsEnabled);
-  server.on("/setMicEnabled", handleSetMicEnabled);
-  server.on("/setSerialLogging", handleSetSerialLoggingEnabled);
-  server.on("/setStatusColors", handleSetStatusColors);
-  server.on("/setStatusRgb", handleSetStatusRgb);
-  server.on("/setDbLogConfig", handleSetDbLogConfig);
-  server.on("/statusLedManual", handleStatusLedManual);
-  server.on("/events", handleEvents);
-  server.on("/monitor", handleMonitor);
-  server.on("/sdreinit", handleSdReinit);
-  server.on("/sdinfo", handleSdInfo);
-  server.on("/testNoiseLed", handleNoiseLedTest);
-  server.on("/rtcinfo", handleRtcInfo);
-  server.on("/rtcsync", handleRtcSync);
-  server.begin();
-
-  // ===== TIME SYNC =====
-  sntp_set_time_sync_notification_cb(onNtpTimeSync);
-  configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-  Serial.println("Time sync started");
-
-  // ===== MP3 INIT (BOOT WAIT) =====  
-  delayWithStatus(8000);                              // MP3 boot time
-  mp3.begin(9600, SERIAL_8N1, 16, 17);      // RX, TX
+  int16_t pcmBuf[BUFFER_LEN];
+  while (clipUp.buf.len < clipUp.total) {
+    size_t n = readZonePcm(zone, pcmBuf);
+    if (n == 0) break;
+    size_t bytes = min(n * sizeof(int16_t), clipUp.total - clipUp.buf.len);
+    clipUp.buf.append((const uint8_t *)pcmBuf, bytes);
+    clipUp.publish(clipUp.buf.len);
+  }
+  memset(pcmBuf, 0, sizeof(pcmBuf));
+  while (clipUp.buf.len < clipUp.total) {
+    clipUp.buf.append((const uint8_t *)pcmBuf, min(sizeof(pcmBuf), clipUp.total - clipUp.buf.len));
+  }
+  clipUp.captureEndMs = millis();
+  clipUp.publish(clipUp.buf.len);
+}
 
-  probeMp3();
-  if (mp3Available) {
-    setMP3Volume((uint8_t)constrain(mp3Volume, 0, 30));
+// SD copy of a clip whose stream failed, in one pass from RAM.
+static bool writeClipToSd(const String &path) {
+  TRACE_SPAN("writeClipToSd");
+  if (!sdReady() || !sdBegin()) return false;
+  storageMgr.makeRoom(clipUp.buf.len + 32768);
+  heapStats.markEvent();   // the VFS allocates per open()
+  File f = SD.open(path.c_str(), FILE_WRITE);
+  if (!f) return false;
+  bool ok = true;
+  for (size_t off = 0; ok && off < clipUp.buf.len;) {
+    size_t n = min((size_t)4096, clipUp.buf.len - off);
+    const uint8_t *p = clipUp.buf.span(off, n);
+    ok = f.write(p, n) == n;
+    off += n;
   }
+  f.close();
+  return ok;
+}
+
+// MAJOR warning audio. True when it was streamed: the event is queued here, right after capture,
+// so a reset mid-stream still leaves it (sent without audio, as its SD file never appears). False
+// when it was recorded to lastRecordedWavPath as before; the caller queues it.
+bool recordMajorClip(uint8_t zone, uint64_t tsMs, const String &groupId, int durationSec, int value) {
+  const String name = makeRecordingFilename();
+  const size_t total = CLIP_WAV_HEADER_BYTES + (MAJOR_CLIP_RATE * MAJOR_CLIP_MS / 1000) * sizeof(int16_t);
+  if (!startClipStream(zone, name, total)) {
+    if (!recordINMP441Wav5s(zone)) lastRecordedWavPath = "";   // no card: the event goes up without a clip
+    return false;
+  }
+  recordClipToStream(zone);
+  clipLocalPath = name;
+  queueRedWarningEvent("MAJOR", tsMs, groupId, durationSec, value, true, name, zone);
+  loopJobs.kick(jobClipStream, millis());
+  return true;
+}
+
+// Settles the queued event once the upload finished: a stored clip points it at Storage; a failed
+// one, or an event already spilled to SD under the SD name, gets the SD copy written from RAM.
+static void finishClipStream(bool stored) {
+  const String &path = clipLocalPath;
+  bool needSdCopy = !stored;
+  if (stored) {
+    const uint32_t tta = clipUp.doneMs - clipUp.captureEndMs;
+    clipStreamOk++;
+    clipTtaLastMs = tta;
+    if (tta > clipTtaMaxMs) clipTtaMaxMs = tta;
+    EVLOG(LOG_SYNC, LOG_INFO, "Clip streamed | {} | {} KB | in Storage {} ms after the last sample", path,
+          (unsigned long)(clipUp.total / 1024), (unsigned long)tta);
+    needSdCopy = true;
+    for (int i = 0; i < eventQueue.count; i++) {
+      PendingEvent &e = eventQueue.items[i];
+      if (!clipStreamHolds(e)) continue;
+      pendingEventCopy(e.audioPath, sizeof(e.audioPath), ("@" + path).c_str());
+      needSdCopy = false;
+      break;
+    }
+  } else {
+    clipStreamFail++;
+    EVLOG(LOG_SYNC, LOG_WARN, "Clip stream FAIL | {} | {} | HTTP {} | keeping it on SD", path, (const char *)clipUp.error,
+          clipUp.httpCode);
+  }
+  if (needSdCopy && !writeClipToSd(path)) EVLOG(LOG_SD, LOG_WARN, "Clip SD copy FAIL | {}", path);
+  lastRecordedWavPath = path;
+  heapStats.markEvent();
+  clipUp.buf.clear();
+  clipUp.setState(CLIP_IDLE);
+}
+
+// ================= I2S =================
+// Left slot only for one zone; both slots (interleaved L/R) for two. Safe to call again after
+// zoneCount changes.
+void startI2S() {
+  static bool installed = false;
+  if (installed) i2s_driver_uninstall(I2S_PORT);
 
-  // ===== I2S SETUP =====
   i2s_config_t i2s_config = {
     .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
     .sample_rate = 16000,
     .bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT,
-    .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+    .channel_format = (zoneCount > 1) ? I2S_CHANNEL_FMT_RIGHT_LEFT : I2S_CHANNEL_FMT_ONLY_LEFT,
     .communication_format = I2S_COMM_FORMAT_I2S,
     .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
     .dma_buf_count = 4,
@@ -2717,20 +4680,590 @@ void setup() {
 
   i2s_driver_install(I2S_PORT, &i2s_config, 0, NULL);
   i2s_set_pin(I2S_PORT, &pin_config);
+  installed = true;
+}
+
+// ================= SETUP =================
+void setup() {
+  nvsLock = xSemaphoreCreateRecursiveMutex();
+  traceLoopTask = xTaskGetCurrentTaskHandle();
+  traceRing.clockUs = traceClockUs;
+  traceRing.taskId = traceTaskId;
+  traceRing.taskNames[1] = "clip_up";
+  traceRing.taskNames[2] = "boot";
+  traceClipStreamId = traceRing.intern("clipStreamRun");
+  Serial.begin(115200);
+  delay(200);
+
+  applyTimezone();
+
+  pinMode(LED_GREEN, OUTPUT);
+  pinMode(LED_YELLOW, OUTPUT);
+  pinMode(LED_RED, OUTPUT);
+
+  pinMode(STATUS_LED_R, OUTPUT);
+  pinMode(STATUS_LED_G, OUTPUT);
+  pinMode(STATUS_LED_B, OUTPUT);
+
+  loadDeviceSettings();
+  preferences.begin("clipstream", true);
+  clipStreamEnabled = preferences.getBool("en", true);
+  preferences.end();
+  loadLiveFeedConfig();
+  preferences.begin("admin", true);
+  adminPassword = preferences.getString("pw", "");
+  preferences.end();
+  fileExport.fs = &exportFs;
+  fileExport.buf = fileExportBuf;
+  refreshEngineConfig();
+  noiseClassifier.model = &NOISE_CLASSIFIER_MODEL;
+  esp_register_shutdown_handler(onShutdownSpillEvents);
+  heapLoopTask = xTaskGetCurrentTaskHandle();
+#if defined(CONFIG_HEAP_USE_HOOKS)
+  heapStats.hooked = true;
+#endif
+  heap_caps_register_failed_alloc_callback(onHeapAllocFailed);
+  snapshotHeap();
+  for (int z = 0; z < MAX_ZONES; z++) {
+    zones[z].id = (uint8_t)z;
+    zones[z].engine.hooks.ctx = &zones[z];
+    zones[z].engine.hooks.onViolationStart = onEngineViolationStart;
+    zones[z].engine.hooks.onWarning = onEngineWarning;
+    zones[z].engine.hooks.onViolationReset = onEngineViolationReset;
+  }
+
+  // Metering first: LEDs and I2S are up before anything slow starts.
+  bootStages.begin(BOOT_LEDS, millis());
+  initLedPwm();
+  bootStages.finish(BOOT_LEDS, millis(), true);
+  bootStages.begin(BOOT_I2S, millis());
+  startI2S();
+  bootStages.finish(BOOT_I2S, millis(), true);
+
+  startBootTasks();
+  powerPolicy.activeSyncIntervalMs = SUPABASE_SYNC_INTERVAL_MS;
+
+  // Routes only; server.begin() waits for the Wi-Fi stage (jobBootStages).
+  onTraced("/", handleRoot);
+  onTraced("/save", handleNetworkConnection);
+  onTraced("/scan", handleScanNetworks);
+  onTraced("/status", handleStatus);
+  onTraced("/metrics", handleMetrics);
+  onTraced("/setThresholds", handleSetThresholds);
+  onTraced("/setAlertConfig", handleSetAlertConfig);
+  onTraced("/toggleSpeaker", handleToggleSpeaker);
+  onTraced("/setSpeaker", handleSetSpeaker);
+  onTraced("/disconnect", handleDisconnect);
+  onTraced("/playTest001", handlePlayTest001);
+  onTraced("/playTest002", handlePlayTest002);
+  onTraced("/playTest003", handlePlayTest003);
+  onTraced("/stopMp3", handleStopMp3);
+  onTraced("/setMp3Volume", handleSetMp3Volume);
+  onTraced("/setStorage", handleSetStorage);
+  onTraced("/setClipStream", handleSetClipStream);
+  onTraced("/setLiveFeed", handleSetLiveFeed);
+  onTraced("/trace", handleTrace);
+  onTraced("/files", handleFiles);
+  onTraced("/setAdminPassword", handleSetAdminPassword);
+  onTraced("/setLedBrightness", handleSetLedBrightness);
+  onTraced("/setNoiseLedsEnabled", handleSetNoiseLedsEnabled);
+  onTraced("/setMicEnabled", handleSetMicEnabled);
+  onTraced("/setSerialLogging", handleSetSerialLoggingEnabled);
+  onTraced("/setStatusColors", handleSetStatusColors);
+  onTraced("/setStatusRgb", handleSetStatusRgb);
+  onTraced("/setDbLogConfig", handleSetDbLogConfig);
+  onTraced("/setLowPower", handleSetLowPower);
+  onTraced("/setClassifier", handleSetClassifier);
+  onTraced("/setEventQueue", handleSetEventQueue);
+  onTraced("/setZones", handleSetZones);
+  onTraced("/setLogLevel", handleSetLogLevel);
+  onTraced("/statusLedManual", handleStatusLedManual);
+  onTraced("/events", handleEvents);
+  onTraced("/monitor", handleMonitor);
+  onTraced("/sdreinit", handleSdReinit);
+  onTraced("/sdinfo", handleSdInfo);
+  onTraced("/testNoiseLed", handleNoiseLedTest);
+  onTraced("/rtcinfo", handleRtcInfo);
+  onTraced("/rtcsync", handleRtcSync);
+  static const char *FILE_EXPORT_HEADERS[] = { "Range", "If-Range", "If-None-Match" };
+  server.collectHeaders(FILE_EXPORT_HEADERS, 3);
+
+  // ===== MP3 INIT =====
+  // The UART can open now; the probe and volume go out once MP3_BOOT_MS has passed (BOOT_MP3).
+  bootStages.begin(BOOT_MP3, millis());
+  mp3.begin(9600, SERIAL_8N1, 16, 17);      // RX, TX
+  mp3Drv.port = &mp3;
+  mp3Drv.hooks.onFrame = onMp3Frame;
+  mp3Drv.hooks.onReply = onMp3Reply;
+  mp3Drv.hooks.onTimeout = onMp3Timeout;
+
+  initLoopJobs();
 
   Serial.println("=== Stable Noise Monitoring System ===");
+}
+
+// ================= STAGED BOOT =================
+// SD, RTC and the Wi-Fi radio each come up in a short-lived task on core 0 while loop() meters on
+// core 1. The tasks do not write the event log or clockService; jobBootStages() does that from
+// the loop when their stages turn ready, and runs the loop-side stages once their deps are up.
+
+static void bootSd() {
+  bootStages.begin(BOOT_SD, millis());
+  SPI.begin(18, 19, 23, SD_CS);
+  loadSdTuning();
+  sdInitOk = sdBegin();
+  sdAvailable = sdInitOk;
+  if (sdInitOk) initDbRing();
+  if (sdInitOk && !sdTuned) {
+    runSdBenchmark();
+    sdBootBenched = true;
+  }
+  if (sdInitOk) initStorageManager();
+  bootStages.finish(BOOT_SD, millis(), sdInitOk);
+}
+
+static void bootRtc() {
+  bootStages.begin(BOOT_RTC, millis());
+  initRtc();
+  applyRtcToSystemTimeIfNeeded();
+  sampleRtcEdge();
+  bootStages.finish(BOOT_RTC, millis(), rtcPresent);
+}
+
+static void bootWifi() {
+  bootStages.begin(BOOT_WIFI, millis());
+  WiFi.mode(WIFI_AP_STA);
+  WiFi.onEvent(onWiFiEvent);
+  WiFi.setSleep(false);
+  WiFi.setAutoReconnect(false);
+  WiFi.persistent(false);
+  WiFi.softAP("ESP32_NOISE_Setup", "12345678");
+  bootStages.finish(BOOT_WIFI, millis(), true);
+}
+
+static const struct {
+  void (*run)();
+  const char *name;
+  uint32_t stack;
+} BOOT_TASKS[] = { { bootSd, "boot_sd", 6144 }, { bootRtc, "boot_rtc", 3072 }, { bootWifi, "boot_wifi", 4096 } };
+
+static void bootTask(void *arg) {
+  const int i = (int)(intptr_t)arg;
+  BOOT_TASKS[i].run();
+  bootTasks[i] = nullptr;
+  vTaskDelete(nullptr);
+}
+
+static void startBootTasks() {
+  bootStages.need(BOOT_STA, BOOT_WIFI);
+  bootStages.need(BOOT_STA, BOOT_RTC);   // reusing the cached lease needs the time
+  bootStages.need(BOOT_HTTP, BOOT_WIFI);
+  bootStages.need(BOOT_NTP, BOOT_WIFI);
+
+  // Names the boot tasks record under are interned here: intern() may only append from one task.
+  static const char *const taskSpans[] = { "sdBegin", "runSdBenchmark", "sd.append", "sd.remove", "sd.rename" };
+  for (const char *n : taskSpans) traceRing.intern(n);
+
+  for (int i = 0; i < 3; i++) {
+    if (xTaskCreatePinnedToCore(bootTask, BOOT_TASKS[i].name, BOOT_TASKS[i].stack, (void *)(intptr_t)i, 1, &bootTasks[i], 0) ==
+        pdPASS) {
+      continue;
+    }
+    // Out of memory for the task: run the stage inline, as the old sequential boot did.
+    Serial.println(String("Boot task ") + BOOT_TASKS[i].name + " not started, running inline");
+    BOOT_TASKS[i].run();
+  }
+}
+
+// Handlers that touch a subsystem still coming up answer 503 instead of racing its boot task.
+static bool bootGate(BootStage stage) {
+  if (bootStages.ready(stage)) return true;
+  server.send(503, "text/plain", String(BOOT_STAGE_NAMES[stage]) + " still starting");
+  return false;
+}
+
+// bootGate(BOOT_SD), and also 503 while an on-demand benchmark is remounting the card.
+static bool sdGate() {
+  if (!bootGate(BOOT_SD)) return false;
+  if (!sdBenchRunning) return true;
+  server.send(503, "text/plain", "SD benchmark running");
+  return false;
+}
+
+static void onBootStageReady(BootStage stage) {
+  switch (stage) {
+    case BOOT_SD:
+      if (sdBootBenched) logSdBench();
+      EVLOG(LOG_SD, sdInitOk ? LOG_INFO : LOG_WARN, sdInitOk ? "SD ready" : "SD not available");
+      break;
+    case BOOT_RTC:
+      if (rtcBootSampleOk) clockService.discipline(rtcBootSampleMono, rtcBootSampleEpochUs, CLOCK_RTC);
+      break;
+    default:
+      break;
+  }
+  EVLOG(LOG_SYS, LOG_INFO, "Boot stage {} ready at {} ms ({} ms)", BOOT_STAGE_NAMES[stage],
+        (unsigned long)bootStages.st[stage].readyMs, (unsigned long)bootStages.tookMs(stage));
+}
+
+// Runs the loop-side boot stages as their dependencies come up, then records the boot and stops.
+static uint32_t jobBootStages(void *ctx, uint32_t now) {
+  (void)ctx;
+  if (!bootStages.st[BOOT_STA].started && bootStages.depsReady(BOOT_STA)) {
+    bootStages.begin(BOOT_STA, now);
+    logNetworkInfo("Boot");
+    connectToWiFi();
+    bootStages.finish(BOOT_STA, millis(), networkSSID.length() > 0);
+  }
+  if (!bootStages.st[BOOT_HTTP].started && bootStages.depsReady(BOOT_HTTP)) {
+    bootStages.begin(BOOT_HTTP, now);
+    server.begin();
+    bootStages.finish(BOOT_HTTP, millis(), true);
+  }
+  if (!bootStages.st[BOOT_NTP].started && bootStages.depsReady(BOOT_NTP)) {
+    bootStages.begin(BOOT_NTP, now);
+    sntp_set_time_sync_notification_cb(onNtpTimeSync);
+    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+    Serial.println("Time sync started");
+    bootStages.finish(BOOT_NTP, millis(), true);
+  }
+  if (!bootStages.ready(BOOT_MP3) && now >= MP3_BOOT_MS) {
+    // Both go out from loop(); the volume is harmless if the module turns out to be missing.
+    probeMp3();
+    setMP3Volume((uint8_t)constrain(mp3Volume, 0, 30));
+    bootStages.finish(BOOT_MP3, now, true);
+  }
+
+  static uint32_t seen = 0;
+  for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+    const BootStage stage = (BootStage)i;
+    if ((seen & BootStages::bit(stage)) || !bootStages.ready(stage)) continue;
+    seen |= BootStages::bit(stage);
+    onBootStageReady(stage);
+  }
+  if (!bootStages.complete()) return 20;
+
   setupComplete = true;
+  if (bootStages.firstFrameMs) {
+    preferences.begin("boot", false);
+    if (preferences.getBytes("hist", &bootHistory, sizeof(bootHistory)) != sizeof(bootHistory)) bootHistory.reset();
+    bootHistory.add(bootStages.firstFrameMs);
+    preferences.putBytes("hist", &bootHistory, sizeof(bootHistory));
+    preferences.end();
+  }
+  EVLOG(LOG_SYS, LOG_INFO, "Boot complete at {} ms, first dB frame at {} ms", (unsigned long)bootStages.completeMs,
+        (unsigned long)bootStages.firstFrameMs);
+  return LOOP_JOB_STOP;
+}
+
+// ================= LOOP JOBS =================
+// Each job returns the ms until its next run (see loop_scheduler.h). They run once per loop pass,
+// after the audio frame when one is due, so the sampling path keeps its heap-frame accounting.
+
+static uint32_t jobHeapSnapshot(void *ctx, uint32_t now) {
+  (void)ctx;
+  // /status snapshots too; only walk the heap again once the last one is HEAP_SNAPSHOT_MS old.
+  uint32_t age = now - lastHeapSnapshotMs;
+  if (age >= HEAP_SNAPSHOT_MS) {
+    snapshotHeap();
+    age = 0;
+  }
+  // Same 10 s housekeeping tick: hold the profiler to its 1% budget.
+  if (loopMetrics.checkOverheadBudget())
+    EVLOG(LOG_SYS, LOG_WARN, "Loop profiler over budget | overhead={}%", loopMetrics.overheadRatio() * 100.0f);
+  return HEAP_SNAPSHOT_MS - age;
+}
+
+static uint32_t jobMp3Tick(void *ctx, uint32_t now) {
+  (void)ctx;
+  mp3Drv.tick(now);
+  // Busy: pace the queue and catch the reply on time. Idle: only rare unsolicited frames, which
+  // the 256-byte UART buffer holds for far longer, so it can wait for another wakeup.
+  const bool idle = mp3Drv.idle();
+  loopJobs.setSlack(jobMp3, idle ? 500 : 0);
+  return idle ? 500 : 10;
+}
+
+static uint32_t jobMp3Probe(void *ctx, uint32_t now) {
+  (void)ctx;
+  (void)now;
+  probeMp3();
+  return MP3_PROBE_MS;
+}
+
+static uint32_t jobNoiseLedTestTick(void *ctx, uint32_t now) {
+  (void)ctx;
+  tickNoiseLedTest(now);
+  return noiseLedTestActive ? 50 : LOOP_JOB_STOP;   // re-armed by /testNoiseLed
+}
+
+static uint32_t jobRtcUpdate(void *ctx, uint32_t now) {
+  (void)ctx;
+  if (!bootStages.ready(BOOT_RTC)) return 1000;   // the boot task still owns the I2C bus
+  maybeUpdateRtcFromSystemTime(now);
+  return 15000;
+}
+
+static uint32_t jobStatusLed(void *ctx, uint32_t now) {
+  (void)ctx;
+  StageTimer t(STAGE_LED, "updateStatusLed");
+  return (uint32_t)updateStatusLed(now);
+}
+
+static uint32_t jobInternetCheck(void *ctx, uint32_t now) {
+  (void)ctx;
+  if (WiFi.status() != WL_CONNECTED) return INTERNET_CHECK_INTERVAL_MS;
+  syncSched.rssi = WiFi.RSSI();
+  // A recent 2xx from Supabase already proves the uplink; skip the blocking probe.
+  if (syncSched.livenessFresh(now)) {
+    internetOk = true;
+    syncSched.probesSkipped++;
+  } else {
+    StageTimer t(STAGE_SYNC, "checkInternetNow", 1500);
+    heapStats.markEvent();
+    internetOk = checkInternetNow();
+  }
+  lastInternetCheckMs = now;
+  return INTERNET_CHECK_INTERVAL_MS;
+}
+
+static uint32_t jobSupabaseSync(void *ctx, uint32_t now) {
+  (void)ctx;
+  heapStats.markEvent();
+  if (WiFi.status() != WL_CONNECTED) {
+    if ((lastPendingLogMs == 0) || (now - lastPendingLogMs >= PENDING_LOG_INTERVAL_MS)) {
+      StageTimer t(STAGE_SYNC, "countPendingEventsOnSD", 1500);
+      int pending = countPendingEventsOnSD();
+      if (pending >= 0 && (pending != lastPendingCountLogged || lastPendingLogMs == 0 || (now - lastPendingLogMs >= PENDING_LOG_INTERVAL_MS))) {
+        lastPendingCountLogged = pending;
+        lastPendingLogMs = now;
+        if (pending > 0) EVLOG(LOG_SYNC, LOG_DEBUG, "Supabase sync skipped: offline | pending={}", pending);
+      }
+    }
+  } else if (!supabaseConfigured()) {
+    int pending = countPendingEventsOnSD();
+    if (pending >= 0 && (pending != lastPendingCountLogged || (lastPendingLogMs == 0) || (now - lastPendingLogMs >= PENDING_LOG_INTERVAL_MS))) {
+      lastPendingCountLogged = pending;
+      lastPendingLogMs = now;
+      if (pending > 0) EVLOG(LOG_SYNC, LOG_DEBUG, "Supabase sync skipped: not configured | pending={}", pending);
+    }
+  } else {
+    if (syncSched.due(SYNC_PRIO_MAJOR, now) || syncSched.due(SYNC_PRIO_WARNING, now)) {
+      int pending = (pendingEventsKnown >= 0) ? pendingEventsKnown : countPendingEventsOnSD();
+      if (pending >= 0 && (pending != lastPendingCountLogged || (lastPendingLogMs == 0) || (now - lastPendingLogMs >= PENDING_LOG_INTERVAL_MS))) {
+        lastPendingCountLogged = pending;
+        lastPendingLogMs = now;
+        if (pending > 0) EVLOG(LOG_SYNC, LOG_DEBUG, "Supabase sync tick | pending={}", pending);
+      }
+
+      if (eventQueue.count > 0) {
+        StageTimer t(STAGE_SYNC, "trySyncRamEvents");
+        trySyncRamEvents();
+      }
+      if (pending > 0) {
+        StageTimer t(STAGE_SYNC, "trySyncPendingEvents");
+        trySyncPendingEvents();
+      }
+    }
+  }
+  lastSupabaseSyncTime = now;
+  return powerPolicy.syncIntervalMs();
+}
+
+// ===== CHANGE-BASED DB SERIES LOGGING (NO AUDIO STORED) =====
+static uint32_t jobDbSampleTick(void *ctx, uint32_t now) {
+  (void)ctx;
+  for (int z = 0; z < zoneCount; z++) {
+    ZoneState &zs = zones[z];
+    int db10 = (int)lroundf(zs.smoothDb * 10.0f);
+    bool changed = (zs.lastDbLogged10 == -999999) || (abs(db10 - zs.lastDbLogged10) >= dbChangeThreshold10);
+    bool heartbeatDue = (zs.lastDbRecordMs == 0) || (now - zs.lastDbRecordMs >= dbHeartbeatMs);
+    if (!changed && !heartbeatDue) continue;
+    uint64_t tsMs = getEpochMs();
+    if (tsMs == 0 || sdBenchRunning) {   // no clock yet, or the card is being benchmarked: stamp later
+      bufferPreSyncDbSample(db10, zs.id);
+      zs.lastDbLogged10 = db10;
+      zs.lastDbRecordMs = now;
+    } else {
+      bool ok;
+      {
+        StageTimer t(STAGE_SD_APPEND, "appendDbSeriesRecord");
+        ok = appendDbSeriesRecord(tsMs, db10, zs.id);
+      }
+      if (ok) {
+        zs.lastDbLogged10 = db10;
+        zs.lastDbRecordMs = now;
+      } else {
+        sdAvailable = false;
+        lastSdFailMs = now;
+        break;
+      }
+    }
+  }
+  // Sampling faster than frames arrive would only re-read the same smoothed level.
+  return max((uint32_t)dbSampleIntervalMs, powerPolicy.frameIntervalMs());
+}
+
+static uint32_t jobStorageTick(void *ctx, uint32_t now) {
+  (void)ctx;
+  if (sdReady() && storageMgr.due(now)) {
+    StageTimer t(STAGE_SD_APPEND, "storageMgr.tick");
+    heapStats.markEvent();   // the VFS allocates per open()
+    storageMgr.tick(now, getEpochMs());
+  }
+  return storageMgr.msUntilDue(now);
+}
+
+static uint32_t jobDbRingTick(void *ctx, uint32_t now) {
+  (void)ctx;
+  if (dbRing.ready && sdReady()) {
+    StageTimer t(STAGE_SD_APPEND, "dbRing.tick");
+    uint32_t errs = dbRing.writeErrors;
+    dbRing.tick(now);
+    if (dbRing.writeErrors != errs) noteDbRingWriteFail();
+  }
+  return 1000;
+}
+
+// DB series is the lowest sync priority: it waits while warning events are still draining,
+// and a failed upload retries on the scheduler's jittered backoff instead of a full interval.
+static uint32_t jobDbUploadTick(void *ctx, uint32_t now) {
+  (void)ctx;
+  const bool dbUploadDue = (now - lastDbBulkUploadMs >= dbBulkUploadIntervalMs) ||
+                           ((dbSeriesRetryPending || dbSeriesBacklog) && syncSched.due(SYNC_PRIO_DB_SERIES, now));
+  const bool eventsDraining = (pendingEventsKnown > 0 || eventQueue.count > 0) && wifiConnected &&
+                              (syncSched.due(SYNC_PRIO_MAJOR, now) || syncSched.due(SYNC_PRIO_WARNING, now));
+  if (dbUploadDue && !eventsDraining && syncSched.due(SYNC_PRIO_DB_SERIES, now)) {
+    StageTimer t(STAGE_SYNC, "tryBulkUploadDbSeries");
+    heapStats.markEvent();
+    tryBulkUploadDbSeries(now);
+    dbSeriesRetryPending = (syncSched.failStreak[SYNC_PRIO_DB_SERIES] > 0);
+    lastDbBulkUploadMs = now;
+  }
+  const uint32_t sinceUpload = now - lastDbBulkUploadMs;
+  if (dbSeriesRetryPending || dbSeriesBacklog || sinceUpload >= dbBulkUploadIntervalMs) return DB_UPLOAD_POLL_MS;
+  return dbBulkUploadIntervalMs - sinceUpload;
+}
+
+// Armed by recordMajorClip() while a streamed clip's upload is still running.
+static uint32_t jobClipStreamTick(void *ctx, uint32_t now) {
+  (void)ctx;
+  (void)now;
+  const uint8_t st = clipUp.getState();
+  if (st == CLIP_STREAMING) return 20;
+  if (st == CLIP_STORED || st == CLIP_FAILED) finishClipStream(st == CLIP_STORED);
+  return LOOP_JOB_STOP;
+}
+
+// Kicked by /sdinfo?bench=1; waits for sdBenchTask() and hands the card back to loop().
+static uint32_t jobSdBenchTick(void *ctx, uint32_t now) {
+  (void)ctx;
+  (void)now;
+  if (!sdBenchRunning) return LOOP_JOB_STOP;
+  if (!sdBenchFinished) return 100;
+  sdBenchRunning = false;
+  logSdBench();
+  return LOOP_JOB_STOP;
+}
+
+// Armed by /files once a download's headers are out; one chunk per run until the body is sent.
+static uint32_t jobFileExportTick(void *ctx, uint32_t now) {
+  (void)ctx;
+  if (!fileExport.active) return LOOP_JOB_STOP;
+  switch (fileExport.pump(now)) {
+    case FILE_EXPORT_SENT:
+      return 2;
+    case FILE_EXPORT_BLOCKED:
+      return 10;   // socket full: let Wi-Fi drain it
+    case FILE_EXPORT_DONE:
+      EVLOG(LOG_SD, LOG_INFO, "Export {} done: {} bytes in {} ms ({} KB/s)", fileExport.path,
+            (unsigned long)fileExport.stats.lastBytes, (unsigned long)fileExport.stats.lastMs,
+            (unsigned long)fileExport.stats.lastKBps);
+      return LOOP_JOB_STOP;
+    default:
+      EVLOG(LOG_SD, LOG_WARN, "Export {} aborted after {} bytes", fileExport.path, (unsigned long)fileExport.sent);
+      return LOOP_JOB_STOP;
+  }
+}
+
+static uint32_t jobMonitorLog(void *ctx, uint32_t now) {
+  (void)ctx;
+  const int smoothInt = (int)smoothDB;
+  bool changed = (smoothInt != lastMonitorDb) || (currentState != lastMonitorState);
+  if (changed) {
+    if (zoneCount > 1) {
+      monitorLogRing.log(now, LOG_MON, LOG_INFO, "dB: {} | LED: {} | z1 {} {} | z2 {} {}", smoothInt,
+                         ledStateToString(currentState), (int)zones[0].smoothDb, ledStateToString(zones[0].engine.led),
+                         (int)zones[1].smoothDb, ledStateToString(zones[1].engine.led));
+    } else {
+      monitorLogRing.log(now, LOG_MON, LOG_INFO, "dB: {} | LED: {}", smoothInt, ledStateToString(currentState));
+    }
+    lastMonitorDb = smoothInt;
+    lastMonitorState = currentState;
+  }
+  return MONITOR_LOG_INTERVAL_MS;
+}
+
+static uint32_t loopClockUs() { return (uint32_t)micros(); }
+
+static void initLoopJobs() {
+  const uint32_t now = millis();
+  loopJobs.clockUs = loopClockUs;
+  loopJobs.spanHook = traceJobSpan;
+  loopJobs.passBudgetUs = LOOP_JOB_PASS_BUDGET_US;
+  // name, fn, ctx, priority, per-run budget (us), slack = allowed lateness (ms), first run (ms from now)
+  loopJobs.add("boot", jobBootStages, nullptr, JOB_PRIO_NET, 2000000, 0, now, 0);
+  jobMp3 = loopJobs.add("mp3", jobMp3Tick, nullptr, JOB_PRIO_IO, 2000, 0, now, 0);
+  jobNoiseLedTest = loopJobs.add("led_test", jobNoiseLedTestTick, nullptr, JOB_PRIO_UI, 500, 0, now, 0);
+  loopJobs.add("status_led", jobStatusLed, nullptr, JOB_PRIO_UI, 1000, 100, now, 0);
+  jobDbSample = loopJobs.add("db_sample", jobDbSampleTick, nullptr, JOB_PRIO_LOG, 30000, 250, now, dbSampleIntervalMs);
+  loopJobs.add("monitor_log", jobMonitorLog, nullptr, JOB_PRIO_LOG, 500, 250, now, MONITOR_LOG_INTERVAL_MS);
+  loopJobs.add("db_ring", jobDbRingTick, nullptr, JOB_PRIO_LOG, 30000, 500, now, 1000);
+  loopJobs.add("storage", jobStorageTick, nullptr, JOB_PRIO_HOUSEKEEP, 50000, 20, now, 1000);
+  loopJobs.add("heap", jobHeapSnapshot, nullptr, JOB_PRIO_HOUSEKEEP, 2000, 1000, now, HEAP_SNAPSHOT_MS);
+  loopJobs.add("rtc", jobRtcUpdate, nullptr, JOB_PRIO_HOUSEKEEP, 5000, 2000, now, 0);
+  loopJobs.add("mp3_probe", jobMp3Probe, nullptr, JOB_PRIO_HOUSEKEEP, 500, 500, now, MP3_BOOT_MS + MP3_PROBE_MS);
+  jobInternet = loopJobs.add("internet", jobInternetCheck, nullptr, JOB_PRIO_NET, 1500000, 1000, now, 0);
+  jobSync = loopJobs.add("sync", jobSupabaseSync, nullptr, JOB_PRIO_NET, 1500000, 250, now, 0);
+  jobDbUpload = loopJobs.add("db_upload", jobDbUploadTick, nullptr, JOB_PRIO_NET, 3000000, 1000, now,
+                             dbBulkUploadIntervalMs);
+  jobClipStream = loopJobs.add("clip_stream", jobClipStreamTick, nullptr, JOB_PRIO_NET, 300000, 10, now, 0);
+  jobFileExport = loopJobs.add("file_export", jobFileExportTick, nullptr, JOB_PRIO_NET, 10000, 10, now, 0);
+  jobSdBench = loopJobs.add("sd_bench", jobSdBenchTick, nullptr, JOB_PRIO_HOUSEKEEP, 5000, 50, now, 0);
+  nextFrameMs = now;
+}
+
+// Sleeps until the next job deadline or audio frame. HTTP is only polled when the loop wakes, so
+// the sleep is capped at the quiet frame period, the wake latency QUIET mode already accepts.
+static void sleepUntilNextWork() {
+  const uint32_t now = millis();
+  uint32_t waitMs = min(loopJobs.msUntilNext(now), powerPolicy.quietFrameMs);
+  if (micEnabled) {
+    int32_t frameIn = (int32_t)(nextFrameMs - now);
+    waitMs = min(waitMs, (uint32_t)(frameIn > 0 ? frameIn : 0));
+  }
+  loopJobs.noteSleep(waitMs);
+  if (waitMs > 0) delay(waitMs);
 }
 
 // ================= LOOP =================
 void loop() {
   unsigned long now = millis();
+  StageTimer loopTimer(STAGE_LOOP);
 
   if (tzReapplyRequested) {
     tzReapplyRequested = false;
     applyTimezone();
   }
 
+  if (ntpSamplePending) {
+    ntpSamplePending = false;
+    disciplineClockFromSystemTime(CLOCK_NTP);
+  }
+  if (clockService.synced && (preSyncDbCount > 0 || eventQueue.count > 0) && sdReady()) {
+    stampPreSyncSamples();
+  }
+
   static bool timeSyncLogged = false;
   if (!timeSyncLogged) {
     if (ntpTimeSynced) {
@@ -2752,6 +5285,7 @@ void loop() {
   static unsigned long lastLoopStallLogMs = 0;
   if (lastLoopMs != 0) {
     unsigned long dt = now - lastLoopMs;
+    if (dt > 1500) traceRing.freeze("loop stall", dt);
     if (dt > 1500 && ((lastLoopStallLogMs == 0) || (now - lastLoopStallLogMs > 5000))) {
       lastLoopStallLogMs = now;
       Serial.println(String("Loop stall ms=") + dt + " | WiFiMode=" + String((int)WiFi.getMode()) + " | sta=" + String((int)WiFi.status()));
@@ -2759,34 +5293,22 @@ void loop() {
   }
   lastLoopMs = now;
 
-  while (mp3.available()) {
-    (void)mp3.read();
-    lastMp3RxMs = now;
-    mp3Available = true;
-    lastMp3OkMs = now;
-    mp3ConsecutiveFailCount = 0;
-  }
+  flushDeviceSettings(now);
 
-  tickNoiseLedTest(now);
-
-  maybeUpdateRtcFromSystemTime(now);
-
-  if (now - lastMp3ProbeMs >= 5000) {
-    lastMp3ProbeMs = now;
-    probeMp3();
+  {
+    StageTimer t(STAGE_HTTP, "server.handleClient");
+    server.handleClient();
   }
 
-  server.handleClient();
-
   // Error transition audit logs (avoid spamming; log only on change)
   const bool micErrNow = (micZeroStartMs != 0) && (now - micZeroStartMs >= 3000);
   if (micErrNow != lastMicErrState) {
-    appendEventLog(getTimeString() + String(micErrNow ? " | MIC error detected" : " | MIC OK"));
+    EVLOG(LOG_NOISE, micErrNow ? LOG_WARN : LOG_INFO, micErrNow ? "MIC error detected" : "MIC OK");
     lastMicErrState = micErrNow;
   }
   const bool supaErrNow = (lastSupabaseFailMs != 0) && (now - lastSupabaseFailMs <= 60000);
   if (supaErrNow != lastSupaErrState) {
-    appendEventLog(getTimeString() + String(supaErrNow ? " | Supabase error detected" : " | Supabase OK"));
+    EVLOG(LOG_SYNC, supaErrNow ? LOG_WARN : LOG_INFO, supaErrNow ? "Supabase error detected" : "Supabase OK");
     lastSupaErrState = supaErrNow;
   }
 
@@ -2798,142 +5320,97 @@ void loop() {
     logNetworkInfo("AP turned off");
   }
 
-  {
-    unsigned long t0 = millis();
-    updateStatusLed(now);
-    unsigned long dt = millis() - t0;
-    if (dt > 1000) {
-      Serial.println(String("updateStatusLed stall ms=") + dt);
-    }
-  }
+  // Passes without an audio frame still run due jobs, then sleep until the next deadline.
+  auto finishPass = [&]() {
+    loopJobs.run((uint32_t)now);
+    drainEventLogSerial();
+    loopTimer.finish();
+    sleepUntilNextWork();
+  };
 
-  // Single-attempt reconnect policy: after a failure, suppress further WiFi.begin() calls for a cooldown.
-  if (staSuppressed) {
-    if (now >= staSuppressedUntilMs) {
-      staSuppressed = false;
-      nextWifiRetryAllowedMs = 0;
-    } else {
-      if (wifiConnecting) {
+  // STA reconnect: driver events first, then timeouts. No cooldown: a dropped link starts a
+  // targeted attempt on the cached channel at once, and only failed scans back off.
+  {
+    const uint32_t epochS = wifiEpochS();
+    WifiEventMsg ev;
+    while (wifiEvents.pop(ev)) {
+      const WifiRcState before = wifiRc.state;
+      applyWifiAction(wifiRc.onEvent(ev.ev, ev.reason, (uint32_t)now, epochS));
+      if (before == WIFI_RC_UP && wifiRc.state != WIFI_RC_UP) {
+        EVLOG(LOG_NET, LOG_WARN, "WiFi link lost (reason {})", ev.reason);
+        logNetworkInfo("WiFi link lost");
+      } else if (before != WIFI_RC_UP && wifiRc.state == WIFI_RC_UP) {
+        wifiConnected = true;
         wifiConnecting = false;
-        WiFi.disconnect(false, false);
+        wifiStatusMessage = "Connected";
+        EVLOG(LOG_NET, LOG_INFO, "WiFi connected | IP: {} in {} ms", WiFi.localIP().toString(), wifiRc.lastReconnectMs);
+
+        apGraceUntilMs = now + AP_GRACE_MS;
+        WiFi.mode(WIFI_AP_STA);
+        logNetworkInfo("WiFi connected");
+        internetOk = checkInternetNow();
+        lastInternetCheckMs = now;
+        loopJobs.armAt(jobInternet, (uint32_t)now + INTERNET_CHECK_INTERVAL_MS);
+      } else if (before != WIFI_RC_BACKOFF && wifiRc.state == WIFI_RC_BACKOFF) {
+        EVLOG(LOG_NET, LOG_INFO, "WiFi connection failed (reason {}), retry in {} ms", ev.reason,
+              wifiRc.retryAtMs - (uint32_t)now);
+        if (WiFi.getMode() != WIFI_AP_STA) WiFi.mode(WIFI_AP_STA);
+        logNetworkInfo("WiFi connect failed");
       }
-      delay(50);
-      return;
-    }
-  }
-
-  if (staNowConnected && (now - lastInternetCheckMs >= INTERNET_CHECK_INTERVAL_MS)) {
-    unsigned long t0 = millis();
-    internetOk = checkInternetNow();
-    unsigned long dt = millis() - t0;
-    if (dt > 1500) {
-      Serial.println(String("checkInternetNow stall ms=") + dt + " | sta=" + String((int)WiFi.status()));
-    }
-    lastInternetCheckMs = now;
-  }
-
-  if (wifiConnecting) {
-    if (WiFi.status() == WL_CONNECTED) {
-      wifiConnected = true;
-      wifiConnecting = false;
-      wifiStatusMessage = "Connected";
-      appendEventLog(getTimeString() + " | WiFi connected | IP: " + WiFi.localIP().toString());
-
-      apGraceUntilMs = now + AP_GRACE_MS;
-      WiFi.mode(WIFI_AP_STA);
-      logNetworkInfo("WiFi connected");
-      internetOk = checkInternetNow();
-      lastInternetCheckMs = now;
-    } else if (millis() - wifiStartTime > WIFI_TIMEOUT) {
-      wifiConnecting = false;
-      wifiConnected = false;
-      wifiStatusMessage = "Connection Failed";
-      appendEventLog(getTimeString() + " | WiFi connection failed");
-
-      Serial.print("WiFi connect timeout. status=");
-      Serial.print(WiFi.status());
-      Serial.print(" reason=");
-      if (lastStaDisconnectReasonValid) {
-        Serial.print((int)lastStaDisconnectReason);
-        Serial.print(" ");
-        Serial.println(WiFi.disconnectReasonName((wifi_err_reason_t)lastStaDisconnectReason));
-      } else {
-        Serial.println("unknown");
+      if (ev.ev == WIFI_EV_GOT_IP && wifiRc.state == WIFI_RC_UP) {
+        // A DHCP address (first connect, or the handback after a reused lease) restarts the lease age.
+        wifiRc.noteLink(WiFi.BSSID(), (uint8_t)WiFi.channel(), (uint32_t)WiFi.localIP(), (uint32_t)WiFi.gatewayIP(),
+                        (uint32_t)WiFi.subnetMask(), (uint32_t)WiFi.dnsIP(), !wifiRc.leaseInUse, epochS);
+        saveWifiApCache();
       }
-
-      // Keep SoftAP stable; avoid restarting AP here.
+    }
+    const WifiRcState before = wifiRc.state;
+    applyWifiAction(wifiRc.poll((uint32_t)now, epochS));
+    if (before != WIFI_RC_BACKOFF && wifiRc.state == WIFI_RC_BACKOFF) {
+      EVLOG(LOG_NET, LOG_INFO, "WiFi connect timeout, retry in {} ms", wifiRc.retryAtMs - (uint32_t)now);
       if (WiFi.getMode() != WIFI_AP_STA) WiFi.mode(WIFI_AP_STA);
       logNetworkInfo("WiFi connect failed");
-
-      // Enter cooldown immediately after the first failed attempt to avoid repeated stalls.
-      staSuppressed = true;
-      staSuppressedUntilMs = now + 60000;
-      nextWifiRetryAllowedMs = staSuppressedUntilMs;
-      // Do not fall through into retry logic in the same loop iteration.
-      delay(50);
-      return;
     }
   }
 
-  if (now - lastSupabaseSyncTime >= SUPABASE_SYNC_INTERVAL_MS) {
-    if (!staNowConnected) {
-      if ((lastPendingLogMs == 0) || (now - lastPendingLogMs >= PENDING_LOG_INTERVAL_MS)) {
-        unsigned long t0 = millis();
-        int pending = countPendingEventsOnSD();
-        unsigned long dt = millis() - t0;
-        if (dt > 1500) {
-          Serial.println(String("countPendingEventsOnSD stall ms=") + dt);
-        }
-        if (pending >= 0 && (pending != lastPendingCountLogged || lastPendingLogMs == 0 || (now - lastPendingLogMs >= PENDING_LOG_INTERVAL_MS))) {
-          lastPendingCountLogged = pending;
-          lastPendingLogMs = now;
-          if (pending > 0) logSupabaseStatus(getTimeString() + " | Supabase sync skipped: offline | pending=" + String(pending));
-        }
-      }
-    } else if (!supabaseConfigured()) {
-      int pending = countPendingEventsOnSD();
-      if (pending >= 0 && (pending != lastPendingCountLogged || (lastPendingLogMs == 0) || (now - lastPendingLogMs >= PENDING_LOG_INTERVAL_MS))) {
-        lastPendingCountLogged = pending;
-        lastPendingLogMs = now;
-        if (pending > 0) logSupabaseStatus(getTimeString() + " | Supabase sync skipped: not configured | pending=" + String(pending));
-      }
-    } else {
-      if (now >= nextSupabaseSyncAllowedMs) {
-        int pending = countPendingEventsOnSD();
-        if (pending >= 0 && (pending != lastPendingCountLogged || (lastPendingLogMs == 0) || (now - lastPendingLogMs >= PENDING_LOG_INTERVAL_MS))) {
-          lastPendingCountLogged = pending;
-          lastPendingLogMs = now;
-          if (pending > 0) logSupabaseStatus(getTimeString() + " | Supabase sync tick | pending=" + String(pending));
-        }
-
-        if (pending > 0) {
-          int uploaded = trySyncPendingEvents();
-          if (uploaded > 0) {
-            nextSupabaseSyncAllowedMs = now;
-          } else {
-            nextSupabaseSyncAllowedMs = now + SYNC_RETRY_BACKOFF_MS;
-          }
-        }
-      }
+  {
+    EventSpillReason why = eventQueue.spillDue(eventUplinkUp(), (uint32_t)now);
+    if (why != EVQ_SPILL_NONE && sdReady()) {
+      StageTimer t(STAGE_SD_APPEND, "spillEventQueue");
+      spillEventQueue(why);
     }
-    lastSupabaseSyncTime = now;
   }
 
-  if (!micEnabled) {
-    delay(50);
+  if (!micEnabled || (int32_t)((uint32_t)now - nextFrameMs) < 0) {
+    finishPass();
     return;
   }
 
+  // Sampling + logging path: expected to make no heap allocations unless markEvent() was called.
+  heapStats.beginFrame();
   {
-    unsigned long t0 = millis();
+    StageTimer t(STAGE_MIC_READ, "readMicDB");
     rawDB = readMicDB();
-    unsigned long dt = millis() - t0;
-    if (dt > 1000) {
-      Serial.println(String("readMicDB stall ms=") + dt);
+  }
+  if (micFrameSamples > 0) bootStages.noteFirstFrame((uint32_t)now);
+  if (micFrameSamples > 0 && noiseClassifier.wantFrame()) {
+    StageTimer t(STAGE_CLASSIFY);
+    uint32_t c0 = micros();
+    // Same >> 14 scaling as the WAV recorder, so recorded clips train the model on identical input.
+    // With two zones the classifier listens to the louder one.
+    noiseClassifier.addFrame(zoneFrame[micLoudestZone], micFrameSamples, 14, (uint32_t)now);
+    noiseClassifier.noteCost(micros() - c0);
+  }
+  {
+    StageTimer t(STAGE_DSP);
+    smoothDB = 0;
+    for (int z = 0; z < zoneCount; z++) {
+      ZoneState &zs = zones[z];
+      zs.smoothDb = zoneDsp[z].smooth(zs.rawDb);
+      if (z == 0 || zs.smoothDb > smoothDB) smoothDB = zs.smoothDb;
     }
+    avgDB = levelAvg.add((int)smoothDB);
   }
-  smoothDB = smoothDB + SMOOTH_ALPHA * (rawDB - smoothDB);
-  int avgDB = getMovingAverage((int)smoothDB);
 
   int smoothInt = (int)smoothDB;
   if (serialLoggingEnabled && smoothInt != lastSerialDb) {
@@ -2950,225 +5427,246 @@ void loop() {
     micZeroStartMs = 0;
   }
 
-  updateLEDState((int)smoothDB);
-  handleRedWarnings((int)smoothDB, now);
-
-  // ===== CHANGE-BASED DB SERIES LOGGING (NO AUDIO STORED) =====
-  if (now - lastDbSampleMs >= dbSampleIntervalMs) {
-    lastDbSampleMs = now;
-
-    int db10 = (int)lroundf(smoothDB * 10.0f);
-    bool changed = (lastDbLogged10 == -999999) || (abs(db10 - lastDbLogged10) >= dbChangeThreshold10);
-    bool heartbeatDue = (lastDbRecordMs == 0) || (now - lastDbRecordMs >= dbHeartbeatMs);
-    if (changed || heartbeatDue) {
-      uint64_t tsMs = getEpochMs();
-      if (tsMs != 0) {
-        unsigned long t0 = millis();
-        bool ok = appendDbSeriesRecord(tsMs, db10);
-        unsigned long dt = millis() - t0;
-        if (dt > 1000) {
-          Serial.println(String("appendDbSeriesRecord stall ms=") + dt);
-        }
-        if (ok) {
-          lastDbLogged10 = db10;
-          lastDbRecordMs = now;
-        } else {
-          sdAvailable = false;
-          lastSdFailMs = now;
-        }
-      }
-    }
+  {
+    StageTimer t(STAGE_LED);
+    updateLEDState();
   }
-
-  if (now - lastDbBulkUploadMs >= dbBulkUploadIntervalMs) {
-    if (tryBulkUploadDbSeries(now)) {
-      lastDbBulkUploadMs = now;
-    } else {
-      // Avoid tight retry loops
-      lastDbBulkUploadMs = now;
-    }
+  {
+    StageTimer t(STAGE_WARNINGS);
+    handleRedWarnings(now);
+  }
+  if (liveFeedEnabled && wifiConnected) {
+    StageTimer t(STAGE_SYNC, "sendLiveFeed");
+    sendLiveFeed((uint32_t)now);
   }
 
-  if (now - lastMonitorLogTime >= MONITOR_LOG_INTERVAL_MS) {
-    bool changed = (smoothInt != lastMonitorDb) || (currentState != lastMonitorState);
-    if (changed) {
-      String line = getTimeString();
-      line += " | dB: ";
-      line += String(smoothInt);
-      line += " | LED: ";
-      line += ledStateToString(currentState);
-      appendMonitorLog(line);
-      lastMonitorDb = smoothInt;
-      lastMonitorState = currentState;
-    }
-    lastMonitorLogTime = now;
+  // Raw level wakes from QUIET so the EMA lag at the slow frame rate doesn't add latency.
+  if (powerPolicy.update(now, (rawDB >= YELLOW_THRESHOLD) || (smoothInt >= YELLOW_THRESHOLD), currentState == GREEN)) {
+    applyPowerMode();
   }
 
+  // Fixed cadence from the frame deadline, re-based if the pass ran a whole frame late.
+  nextFrameMs += powerPolicy.frameIntervalMs();
+  if ((int32_t)(nextFrameMs - (uint32_t)now) <= 0) nextFrameMs = (uint32_t)now + powerPolicy.frameIntervalMs();
+
+  loopJobs.run((uint32_t)now);
+
+  drainEventLogSerial();
   if ((now - lastLogTime >= LOG_INTERVAL_MS) &&
       abs((int)smoothDB - lastLoggedDB) >= DB_CHANGE_LOG) {
 
     {
-      unsigned long t0 = millis();
+      StageTimer t(STAGE_SD_APPEND, "logNoise");
       logNoise((int)smoothDB);
-      unsigned long dt = millis() - t0;
-      if (dt > 1000) {
-        Serial.println(String("logNoise stall ms=") + dt);
-      }
     }
     lastLoggedDB = (int)smoothDB;
     lastLogTime = now;
   }
-
-  delay(50);
-}
-
-// ================= MIC =================
-int readMicDB() {
-  size_t bytes_read = 0;
-  i2s_read(I2S_PORT, samples, sizeof(samples), &bytes_read, 100);
-  if (bytes_read == 0) return rawDB;
-
-  int count = bytes_read / 4;
-  double sum = 0;
-  for (int i = 0; i < count; i++) {
-    double s = samples[i];
-    sum += s * s;
+  if (noiseLogLen > 0 && now - noiseLogFirstMs >= NOISE_LOG_FLUSH_MS) {
+    StageTimer t(STAGE_SD_APPEND, "flushNoiseLog");
+    flushNoiseLog();
   }
+  heapStats.endFrame();
 
-  double rms_raw = sqrt(sum / count);
-  double rms = max(0.0, rms_raw - NOISE_FLOOR);
-  return (int)(20.0 * log10(rms + 1) * SENSITIVITY);
+  loopTimer.finish();
+  sleepUntilNextWork();
 }
 
-// ================= MOVING AVERAGE =================
-int getMovingAverage(int value) {
-  avgBuffer[avgIndex++] = value;
-  if (avgIndex >= AVG_WINDOW) {
-    avgIndex = 0;
-    avgFilled = true;
+// ================= LIVE FEED =================
+// Called once per frame after the LED decision, so a datagram never lags the LEDs by a frame.
+void sendLiveFeed(uint32_t now) {
+  uint8_t led[MAX_ZONES];
+  for (int z = 0; z < zoneCount; z++) led[z] = (uint8_t)zones[z].engine.led;
+  if (!liveFeedPacer.due(now, led, zoneCount)) return;
+
+  LiveFeedFrame f;
+  snprintf(f.id, sizeof(f.id), "%s", DEVICE_ID);
+  f.seq = liveFeedSeq++;
+  f.zones = (uint8_t)min(zoneCount, LIVE_FEED_MAX_ZONES);
+  f.flags = (powerPolicy.mode == POWER_QUIET) ? LIVE_FLAG_QUIET : 0;
+  if (clockService.synced) {
+    f.tsMs = getEpochMs();
+  } else {
+    f.tsMs = now;
+    f.flags |= LIVE_FLAG_UPTIME;
+  }
+  for (int z = 0; z < f.zones; z++) {
+    f.db10[z] = (int16_t)lround(zones[z].smoothDb * 10.0);
+    f.led[z] = led[z];
+  }
+  uint8_t pkt[LIVE_FEED_MAX_BYTES];
+  const size_t n = liveFeedEncode(pkt, sizeof(pkt), f);
+  // lwIP allocates the outgoing datagram on this task.
+  heapStats.markEvent();
+  const IPAddress group(liveFeedGroup[0], liveFeedGroup[1], liveFeedGroup[2], liveFeedGroup[3]);
+  if (n > 0 && liveUdp.beginPacket(group, liveFeedPort) && liveUdp.write(pkt, n) == n && liveUdp.endPacket()) {
+    liveFeedSent++;
+  } else {
+    liveFeedErrors++;
   }
+}
 
-  int sum = 0;
-  int count = avgFilled ? AVG_WINDOW : avgIndex;
-  for (int i = 0; i < count; i++) sum += avgBuffer[i];
-  return sum / count;
+// ================= MIC =================
+// Reads one block (BUFFER_LEN frames per zone), sets each zone's rawDb and returns the loudest
+// zone's level. The legacy profile takes its sum of squares from the deinterleave pass; filtering
+// profiles run their stages over each zone's samples.
+int readMicDB() {
+  size_t bytes_read = 0;
+  i2s_read(I2S_PORT, i2sBlock, sizeof(int32_t) * BUFFER_LEN * zoneCount, &bytes_read, 100);
+  if (bytes_read == 0) {
+    micFrameSamples = 0;
+    loopMetrics.frameDrops++;
+    return rawDB;
+  }
+  loopMetrics.frames++;
+
+  zoneFrame[0] = (zoneCount > 1) ? zoneSamples[0] : i2sBlock;
+  double sumSq[MAX_ZONES] = { 0, 0 };
+  int count = zoneSplit(i2sBlock, (int)(bytes_read / 4), zoneCount, zoneFrame, sumSq);
+  micFrameSamples = count;
+
+  int loudest = 0;
+  for (int z = 0; z < zoneCount; z++) {
+    zones[z].rawDb = ZoneDsp::filtered ? zoneDsp[z].levelDb(zoneFrame[z], count)
+                                       : zoneDsp[z].levelDbFromSumSq(sumSq[z], count);
+    if (zones[z].rawDb > zones[loudest].rawDb) loudest = z;
+  }
+  micLoudestZone = loudest;
+  return zones[loudest].rawDb;
 }
 
 // ================= LED =================
-void updateLEDState(int value) {
-  switch (currentState) {
-    case GREEN:
-      if (value >= RED_THRESHOLD)
-        currentState = RED;
-      else if (value >= YELLOW_THRESHOLD)
-        currentState = YELLOW;
-      break;
-
-    case YELLOW:
-      if (value >= RED_THRESHOLD)
-        currentState = RED;
-      else if (value < YELLOW_THRESHOLD - HYSTERESIS_DB)
-        currentState = GREEN;
-      break;
-
-    case RED:
-      if (value < RED_THRESHOLD - HYSTERESIS_DB)
-        currentState = YELLOW;
-      break;
+static void refreshEngineConfig() {
+  for (int z = 0; z < MAX_ZONES; z++) {
+    NoiseEngineConfig &c = zones[z].engine.cfg;
+    c.yellowThreshold = YELLOW_THRESHOLD;
+    c.redThreshold = RED_THRESHOLD;
+    c.hysteresisDb = HYSTERESIS_DB;
+    c.firstWarningMs = firstWarningTimeMs;
+    c.secondWarningMs = secondWarningTimeMs;
+    c.majorWarningMs = majorWarningTimeMs;
+    c.majorRepeatIntervalMs = majorRepeatIntervalMs;
+    c.silenceResetWindowMs = silenceResetWindowMs;
   }
+}
 
+void updateLEDState() {
+  refreshEngineConfig();
+  for (int z = 0; z < zoneCount; z++) zones[z].engine.updateLed((int)zones[z].smoothDb);
+  currentState = zoneWorstLed(zones, zoneCount);
   setNoiseLedPwm(currentState);
 }
 
 // ================= WARNING LOGIC =================
-void handleRedWarnings(int value, unsigned long now) {
-  if (value >= RED_THRESHOLD) {
-    silenceBelowRedStartMs = 0;
-    if (redStartTime == 0) {
-      redStartTime = now;
-      firstLogged = secondLogged = majorLogged = false;
-      lastMajorAlertMs = 0;
-      currentViolationGroupId = genUuidV4();
-    }
-
-    unsigned long d = now - redStartTime;
-    int elapsedSeconds = (int)(d / 1000UL);
-    int firstCfgSec = (int)(firstWarningTimeMs / 1000UL);
-    int secondCfgSec = (int)(secondWarningTimeMs / 1000UL);
-    int majorCfgSec = (int)(majorWarningTimeMs / 1000UL);
-    if (d >= firstWarningTimeMs && !firstLogged) {
-      uint64_t tsMs = getEpochMs();
-      logEvent((String("FIRST WARNING (RED ") + String(firstCfgSec) + "s)").c_str());
+// ctx is the zone (ZoneState) whose engine fired.
+static void onEngineViolationStart(void *ctx, uint32_t now) {
+  (void)now;
+  heapStats.markEvent();
+  zoneGroupId[((ZoneState *)ctx)->id] = genUuidV4();
+}
+
+static void onEngineViolationReset(void *ctx, uint32_t now) {
+  (void)now;
+  heapStats.markEvent();
+  zoneGroupId[((ZoneState *)ctx)->id] = "";
+}
+
+static void onEngineWarning(void *ctx, WarningLevel level, int durationSec, int value, uint32_t now) {
+  (void)now;
+  heapStats.markEvent();
+  const uint8_t zone = ((ZoneState *)ctx)->id;
+  const String &groupId = zoneGroupId[zone];
+  uint64_t tsMs = getEpochMs();
+  bool streamed = false;
+  switch (level) {
+    case WARN_FIRST:
+      logEvent("FIRST WARNING", durationSec);
       flickerActiveLed();
       playMP3(0x01);     // 001.mp3
-      queueRedWarningEvent("FIRST", tsMs, currentViolationGroupId, firstCfgSec, value, false, "");
-      firstLogged = true;
-    }
-    if (d >= secondWarningTimeMs && !secondLogged) {
-      uint64_t tsMs = getEpochMs();
-      logEvent((String("SECOND WARNING (RED ") + String(secondCfgSec) + "s)").c_str());
+      queueRedWarningEvent("FIRST", tsMs, groupId, durationSec, value, false, "", zone);
+      break;
+    case WARN_SECOND:
+      logEvent("SECOND WARNING", durationSec);
       flickerActiveLed();
       playMP3(0x02);     // 002.mp3
-      queueRedWarningEvent("SECOND", tsMs, currentViolationGroupId, secondCfgSec, value, false, "");
-      secondLogged = true;
-    }
-    if (d >= majorWarningTimeMs && !majorLogged) {
-      uint64_t tsMs = getEpochMs();
-      logEvent((String("MAJOR WARNING (RED ") + String(majorCfgSec) + "s)").c_str());
+      queueRedWarningEvent("SECOND", tsMs, groupId, durationSec, value, false, "", zone);
+      break;
+    case WARN_MAJOR:
+      logEvent("MAJOR WARNING", durationSec);
       flickerActiveLed();
-      recordINMP441Wav5s();
+      streamed = recordMajorClip(zone, tsMs, groupId, durationSec, value);
       playMP3(0x03);     // 003.mp3
-      queueRedWarningEvent("MAJOR", tsMs, currentViolationGroupId, majorCfgSec, value, true, lastRecordedWavPath);
-      majorLogged = true;
-      lastMajorAlertMs = now;
-    }
-
-    if (majorLogged && lastMajorAlertMs != 0 && (now - lastMajorAlertMs >= majorRepeatIntervalMs)) {
-      uint64_t tsMs = getEpochMs();
-      logEvent("MAJOR WARNING (REPEAT)");
+      if (!streamed) queueRedWarningEvent("MAJOR", tsMs, groupId, durationSec, value, true, lastRecordedWavPath, zone);
+      break;
+    case WARN_MAJOR_REPEAT:
+      logEvent("MAJOR WARNING", -1);
       flickerActiveLed();
-      recordINMP441Wav5s();
+      streamed = recordMajorClip(zone, tsMs, groupId, durationSec, value);
       playMP3(0x03);
-      queueRedWarningEvent("MAJOR", tsMs, currentViolationGroupId, elapsedSeconds, value, true, lastRecordedWavPath);
-      lastMajorAlertMs = now;
-    }
-  } else {
-    if (silenceBelowRedStartMs == 0) silenceBelowRedStartMs = now;
-    if (now - silenceBelowRedStartMs >= silenceResetWindowMs) {
-      redStartTime = 0;
-      firstLogged = secondLogged = majorLogged = false;
-      lastMajorAlertMs = 0;
-      silenceBelowRedStartMs = 0;
-      currentViolationGroupId = "";
+      if (!streamed) queueRedWarningEvent("MAJOR", tsMs, groupId, durationSec, value, true, lastRecordedWavPath, zone);
+      break;
+  }
+}
+
+// Each zone escalates on its own level; the classifier's verdict (on the louder zone) applies to
+// every zone that is above RED.
+void handleRedWarnings(unsigned long now) {
+  noiseClassifier.minConfidencePct = (uint8_t)classifierMinConfidence;
+  bool suppress = classifierSuppress && noiseClassifier.suppress((uint32_t)now);
+  bool ignored = false;
+  for (int z = 0; z < zoneCount; z++) {
+    int value = (int)zones[z].smoothDb;
+    bool ignore = suppress && (value >= RED_THRESHOLD);
+    ignored |= ignore;
+    zones[z].engine.handleWarnings(value, (uint32_t)now, ignore);
+  }
+  if (ignored) {
+    classifierSuppressedFrames++;
+    if (!classifierSuppressing) {
+      EVLOG(LOG_NOISE, LOG_INFO, "RED ignored: {} ({}%)", NOISE_CLASS_NAMES[noiseClassifier.label], noiseClassifier.confidencePct);
     }
   }
+  classifierSuppressing = ignored;
 }
 
 // ================= SD LOGGING =================
-void logNoise(int value) {
+// Until sdReady() the lines stay buffered; the SD boot task or a benchmark may be remounting.
+void flushNoiseLog() {
+  TRACE_SPAN("flushNoiseLog");
+  if (noiseLogLen == 0 || !sdReady()) return;
+  heapStats.markEvent();
   File f = SD.open("/noise_log.txt", FILE_APPEND);
   if (f) {
-    f.print("Time(ms): ");
-    f.print(millis());
-    f.print(" | dB: ");
-    f.println(value);
+    f.write((const uint8_t *)noiseLogBuf, noiseLogLen);
     f.close();
+  } else {
+    loopMetrics.sdErrors++;
   }
+  noiseLogLen = 0;
 }
 
-void logEvent(const char* msg) {
-  String timeStr = getTimeString();
-  int dbValue = (int)smoothDB;
+void logNoise(int value) {
+  char line[48];
+  int n = snprintf(line, sizeof(line), "Time(ms): %lu | dB: %d\r\n", (unsigned long)millis(), value);
+  if (noiseLogLen + (size_t)n > sizeof(noiseLogBuf)) flushNoiseLog();
+  if (noiseLogLen + (size_t)n > sizeof(noiseLogBuf)) return;   // no card yet and the buffer is full
+  if (noiseLogLen == 0) noiseLogFirstMs = millis();
+  memcpy(noiseLogBuf + noiseLogLen, line, (size_t)n);
+  noiseLogLen += (size_t)n;
+}
 
-  appendEventLog(timeStr + " | " + String(msg) + " | dB: " + String(dbValue));
+// durationSec < 0 marks a MAJOR repeat.
+void logEvent(const char* label, int durationSec) {
+  int dbValue = (int)smoothDB;
+  char msg[48];
+  if (durationSec >= 0) snprintf(msg, sizeof(msg), "%s (RED %ds)", label, durationSec);
+  else snprintf(msg, sizeof(msg), "%s (REPEAT)", label);
 
-  Serial.print("⚠️ ");
-  Serial.print(timeStr);
-  Serial.print(" | ");
-  Serial.print(msg);
-  Serial.print(" | dB: ");
-  Serial.println(dbValue);
+  EVLOG(LOG_NOISE, LOG_WARN, "{} | dB: {}", msg, dbValue);
 
+  if (!sdReady()) return;   // the event log above still has it
+  flushNoiseLog();
+  String timeStr = getTimeString();
   File f = SD.open("/noise_log.txt", FILE_APPEND);
   if (f) {
     f.print(timeStr);
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "crc32.h"
+
+// Circular log of 512-byte sectors on a raw block region (no filesystem).
+//
+// Sector layout: RingSectorHeader + up to RING_PAYLOAD_BYTES of records, each record
+// [len u8][len bytes]. Sector with sequence number seq always lives at slot seq % sectorCount,
+// so a healthy ring reads as "lap L" for slots [0..head] and "lap L-1" (or blank) after it,
+// and recovery finds the head with a binary search instead of scanning the card.
+//
+// The open sector is buffered in RAM and written when it fills up or flush() is called; either
+// way the head then advances, so each sector is written exactly once per lap. Every write is one
+// sector (flat latency), and a torn write can only hit the oldest sector being recycled: it fails
+// its CRC and recovery resumes after the previous sector.
+//
+// Dev is duck-typed: bool readSector(uint32_t, uint8_t*), bool writeSector(uint32_t, const uint8_t*),
+// uint32_t sectorCount(). The firmware wraps SD.readRAW/writeRAW; tools/ring_log_sim.cpp wraps a
+// file with power-cut and torn-write injection.
+
+static const uint32_t RING_SECTOR_BYTES = 512;
+static const uint32_t RING_MAGIC = 0x31474C52;  // "RLG1"
+
+struct RingSectorHeader {
+  uint32_t magic;
+  uint32_t seq;
+  uint16_t used;     // payload bytes in use
+  uint16_t records;
+  uint32_t crc;      // over header (crc = 0) + used payload bytes
+};
+
+static const uint32_t RING_PAYLOAD_BYTES = RING_SECTOR_BYTES - sizeof(RingSectorHeader);
+
+// Position of the next unread record: sector seq + record index inside it.
+struct RingCursor {
+  uint32_t seq = 0;
+  uint16_t rec = 0;
+};
+
+template <typename Dev>
+struct RingLog {
+  Dev *dev = nullptr;
+  uint32_t sectors = 0;
+  bool ready = false;
+
+  uint32_t flushAfterMs = 5000;   // max age of buffered records before the open sector is closed
+  uint32_t probeSkip = 8;         // slots to look past an unreadable sector during recovery
+
+  // Open (head) sector.
+  uint8_t buf[RING_SECTOR_BYTES];
+  uint32_t headSeq = 0;
+  uint16_t used = 0;
+  uint16_t records = 0;
+  bool pending = false;           // records in buf not yet on the device
+  uint32_t pendingSinceMs = 0;
+  bool empty = true;              // nothing ever written
+
+  // Stats.
+  uint32_t sectorWrites = 0;
+  uint32_t writeErrors = 0;
+  uint32_t sectorReads = 0;
+  uint32_t recordsAppended = 0;
+  uint32_t sectorsOverwritten = 0;  // lost to wrap-around before a reader got to them
+
+  bool begin(Dev *d) {
+    dev = d;
+    sectors = dev->sectorCount();
+    ready = false;
+    if (sectors < 2) return false;
+    recover();
+    ready = true;
+    return true;
+  }
+
+  // Re-attach after the device was re-initialised (SD re-mount). begin() would recover() and drop
+  // the open sector, so the RAM head is kept as long as the device still ends with our last
+  // closed sector. False (another card, or a ring changed under us): the caller runs begin().
+  bool resume() {
+    if (!ready || dev->sectorCount() != sectors) return false;
+    uint8_t tmp[RING_SECTOR_BYTES];
+    RingSectorHeader h;
+    if (headSeq == 0) return !readSlot(0, tmp, h);   // nothing closed yet: the ring must still be blank
+    return readSlot((headSeq - 1) % sectors, tmp, h) && h.seq == headSeq - 1;
+  }
+
+  bool append(const uint8_t *data, uint8_t len, uint32_t now) {
+    if (!ready) return false;
+    if (used + 1u + len > RING_PAYLOAD_BYTES) {
+      if (!writeHead()) return false;
+      advance();
+    }
+    uint8_t *p = buf + sizeof(RingSectorHeader) + used;
+    p[0] = len;
+    memcpy(p + 1, data, len);
+    used += 1 + len;
+    records++;
+    recordsAppended++;
+    empty = false;
+    if (!pending) pendingSinceMs = now;
+    pending = true;
+    return true;
+  }
+
+  // Writes the open sector once its oldest buffered record is flushAfterMs old.
+  bool tick(uint32_t now) {
+    if (!ready || !pending) return false;
+    if (now - pendingSinceMs < flushAfterMs) return false;
+    return flush();
+  }
+
+  bool flush() {
+    if (!ready || !pending) return true;
+    if (!writeHead()) return false;
+    advance();
+    return true;
+  }
+
+  // First record still on the ring; older cursors lost data to wrap-around.
+  RingCursor oldest() const {
+    RingCursor c;
+    c.seq = (headSeq + 1 > sectors) ? headSeq + 1 - sectors : 0;
+    c.rec = 0;
+    return c;
+  }
+
+  RingCursor end() const {
+    RingCursor c;
+    c.seq = headSeq;
+    c.rec = records;
+    return c;
+  }
+
+  bool hasData(const RingCursor &from) const {
+    RingCursor c = clamp(from);
+    return !empty && (c.seq < headSeq || (c.seq == headSeq && c.rec < records));
+  }
+
+  // Calls fn(data, len) for up to maxRecords records starting at `from`, and returns the
+  // cursor after the last one delivered. Unreadable sectors are skipped.
+  template <typename Fn>
+  RingCursor read(const RingCursor &from, uint32_t maxRecords, Fn fn) {
+    RingCursor c = clamp(from);
+    if (c.seq > from.seq) sectorsOverwritten += c.seq - from.seq;
+    uint8_t tmp[RING_SECTOR_BYTES];
+    uint32_t delivered = 0;
+    while (delivered < maxRecords && (c.seq < headSeq || (c.seq == headSeq && c.rec < records))) {
+      const uint8_t *sec = nullptr;
+      uint16_t secUsed = 0, secRecords = 0;
+      if (c.seq == headSeq) {
+        sec = buf;
+        secUsed = used;
+        secRecords = records;
+      } else {
+        RingSectorHeader h;
+        if (!readSlot(c.seq % sectors, tmp, h) || h.seq != c.seq) {
+          c.seq++;
+          c.rec = 0;
+          continue;
+        }
+        sec = tmp;
+        secUsed = h.used;
+        secRecords = h.records;
+      }
+
+      const uint8_t *p = sec + sizeof(RingSectorHeader);
+      const uint8_t *pe = p + secUsed;
+      uint16_t i = 0;
+      while (i < c.rec && p < pe) {
+        p += 1 + p[0];
+        i++;
+      }
+      while (i < secRecords && p < pe && delivered < maxRecords) {
+        uint8_t len = p[0];
+        if (p + 1 + len > pe) break;
+        fn(p + 1, len);
+        p += 1 + len;
+        i++;
+        delivered++;
+      }
+      if (i >= secRecords && c.seq < headSeq) {
+        c.seq++;
+        c.rec = 0;
+      } else {
+        c.rec = i;
+        if (c.seq == headSeq) break;
+      }
+    }
+    return c;
+  }
+
+ private:
+  RingCursor clamp(const RingCursor &from) const {
+    RingCursor o = oldest();
+    if (from.seq < o.seq) return o;
+    if (from.seq > headSeq) return end();
+    return from;
+  }
+
+  bool readSlot(uint32_t slot, uint8_t *dst, RingSectorHeader &h) {
+    sectorReads++;
+    if (!dev->readSector(slot, dst)) return false;
+    memcpy(&h, dst, sizeof(h));
+    if (h.magic != RING_MAGIC || h.used > RING_PAYLOAD_BYTES) return false;
+    if (h.seq % sectors != slot) return false;
+    uint32_t want = h.crc;
+    RingSectorHeader z = h;
+    z.crc = 0;
+    uint32_t crc = crc32Of((const uint8_t *)&z, sizeof(z));
+    crc = crc32Update(crc, dst + sizeof(h), h.used);
+    return crc == want;
+  }
+
+  // First readable slot in [from, from + probeSkip], or -1.
+  long firstValid(uint32_t from, uint32_t limit, uint8_t *tmp, RingSectorHeader &h) {
+    for (uint32_t i = from; i < limit && i <= from + probeSkip; i++) {
+      if (readSlot(i, tmp, h)) return (long)i;
+    }
+    return -1;
+  }
+
+  void recover() {
+    uint8_t tmp[RING_SECTOR_BYTES];
+    RingSectorHeader h;
+
+    used = records = 0;
+    pending = false;
+    empty = true;
+    headSeq = 0;
+
+    long ref = firstValid(0, sectors, tmp, h);
+    if (ref < 0) return;  // blank (or unreadable) ring: start fresh at seq 0
+    const uint32_t lap = h.seq / sectors;
+    RingSectorHeader best = h;
+
+    // Invariant: slot lo is in the current lap, slot hi is not (hi == sectors is a sentinel).
+    uint32_t lo = (uint32_t)ref, hi = sectors;
+    while (hi - lo > 1) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      long v = firstValid(mid, hi, tmp, h);
+      if (v >= 0 && h.seq / sectors == lap) {
+        lo = (uint32_t)v;
+        best = h;
+      } else {
+        hi = mid;
+      }
+    }
+
+    empty = false;
+    headSeq = best.seq + 1;
+  }
+
+  bool writeHead() {
+    RingSectorHeader h;
+    h.magic = RING_MAGIC;
+    h.seq = headSeq;
+    h.used = used;
+    h.records = records;
+    h.crc = 0;
+    uint32_t crc = crc32Of((const uint8_t *)&h, sizeof(h));
+    h.crc = crc32Update(crc, buf + sizeof(h), used);
+    memcpy(buf, &h, sizeof(h));
+    if (used < RING_PAYLOAD_BYTES) memset(buf + sizeof(h) + used, 0, RING_PAYLOAD_BYTES - used);
+
+    if (!dev->writeSector(headSeq % sectors, buf)) {
+      writeErrors++;
+      return false;
+    }
+    sectorWrites++;
+    pending = false;
+    return true;
+  }
+
+  void advance() {
+    headSeq++;
+    used = 0;
+    records = 0;
+  }
+};
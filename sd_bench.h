@@ -0,0 +1,172 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// SD card benchmark + SPI clock auto-tune.
+//
+// For each SPI clock (ascending) it remounts the card and measures:
+//   - small appends: open(APPEND) + ~24 bytes + close, like appendDbSeriesRecord()
+//   - sequential write and read-back bandwidth for each buffer size, verifying every byte
+// It stops at the first clock that fails to mount or verify; the fastest clock that passed is
+// then re-verified once more before being reported as stable.
+//
+// Io is duck-typed so the same code runs against the SD library or a simulated card on the host:
+//   bool mount(uint32_t hz); uint32_t nowUs();
+//   bool open(bool write, bool append); size_t write(const uint8_t*, size_t);
+//   size_t read(uint8_t*, size_t); void close(); void remove(); void idle();
+
+static const uint32_t SD_BENCH_CLOCKS[] = { 1000000, 4000000, 8000000, 10000000, 16000000, 20000000, 26000000, 40000000 };
+static const int SD_BENCH_CLOCK_COUNT = (int)(sizeof(SD_BENCH_CLOCKS) / sizeof(SD_BENCH_CLOCKS[0]));
+static const uint16_t SD_BENCH_BUFS[] = { 512, 4096 };
+static const int SD_BENCH_BUF_COUNT = (int)(sizeof(SD_BENCH_BUFS) / sizeof(SD_BENCH_BUFS[0]));
+static const uint32_t SD_BENCH_SAFE_HZ = 1000000;
+
+struct SdBenchConfig {
+  uint32_t seqBytes = 32768;   // per buffer size, per clock
+  int appendCount = 16;
+  uint16_t appendBytes = 24;
+  uint32_t maxHz = 40000000;
+};
+
+struct SdBenchStep {
+  uint32_t hz = 0;
+  bool mounted = false;
+  bool verified = false;
+  uint32_t appendAvgUs = 0;
+  uint32_t appendMaxUs = 0;
+  uint32_t writeKBps[SD_BENCH_BUF_COUNT] = {};
+  uint32_t readKBps[SD_BENCH_BUF_COUNT] = {};
+};
+
+struct SdBenchResult {
+  SdBenchStep steps[SD_BENCH_CLOCK_COUNT];
+  int stepCount = 0;
+  uint32_t bestHz = 0;          // 0: nothing passed, keep SD_BENCH_SAFE_HZ
+  uint16_t bestBufBytes = 0;
+  uint32_t bestWriteKBps = 0;
+  uint32_t bestReadKBps = 0;
+  uint32_t bestAppendUs = 0;
+  uint32_t elapsedMs = 0;
+};
+
+// Deterministic test data; the salt changes per pass so stale file contents can't verify.
+static inline uint8_t sdBenchPattern(uint32_t off, uint32_t salt) {
+  uint32_t x = (off ^ salt) * 2654435761u;
+  return (uint8_t)(x >> 24);
+}
+
+static inline uint32_t sdBenchKBps(uint32_t bytes, uint32_t us) {
+  if (us == 0) us = 1;
+  return (uint32_t)(((uint64_t)bytes * 1000000ULL) / ((uint64_t)us * 1024ULL));
+}
+
+template <typename Io>
+bool sdBenchSequential(Io &io, uint32_t totalBytes, uint16_t bufBytes, uint32_t salt, uint8_t *scratch,
+                       uint32_t &writeKBps, uint32_t &readKBps) {
+  io.remove();
+  if (!io.open(true, false)) return false;
+  uint32_t t0 = io.nowUs();
+  for (uint32_t off = 0; off < totalBytes; off += bufBytes) {
+    for (uint32_t i = 0; i < bufBytes; i++) scratch[i] = sdBenchPattern(off + i, salt);
+    if (io.write(scratch, bufBytes) != bufBytes) {
+      io.close();
+      return false;
+    }
+  }
+  io.close();  // includes the final flush, so it is part of the write time
+  writeKBps = sdBenchKBps(totalBytes, io.nowUs() - t0);
+  io.idle();
+
+  if (!io.open(false, false)) return false;
+  t0 = io.nowUs();
+  uint32_t bad = 0;
+  uint32_t off = 0;
+  while (off < totalBytes) {
+    size_t n = io.read(scratch, bufBytes);
+    if (n == 0) break;
+    for (size_t i = 0; i < n; i++) {
+      if (scratch[i] != sdBenchPattern(off + (uint32_t)i, salt)) bad++;
+    }
+    off += (uint32_t)n;
+  }
+  readKBps = sdBenchKBps(off, io.nowUs() - t0);
+  io.close();
+  io.idle();
+  return off == totalBytes && bad == 0;
+}
+
+template <typename Io>
+bool sdBenchStep(Io &io, const SdBenchConfig &cfg, uint32_t hz, uint8_t *scratch, size_t scratchLen, SdBenchStep &st) {
+  st = SdBenchStep();
+  st.hz = hz;
+  if (!io.mount(hz)) return false;
+  st.mounted = true;
+
+  io.remove();
+  uint64_t sumUs = 0;
+  for (int i = 0; i < cfg.appendCount; i++) {
+    uint32_t t0 = io.nowUs();
+    if (!io.open(true, true)) return false;
+    for (uint16_t k = 0; k < cfg.appendBytes && k < scratchLen; k++) scratch[k] = sdBenchPattern(k, hz + (uint32_t)i);
+    size_t w = io.write(scratch, cfg.appendBytes);
+    io.close();
+    uint32_t dt = io.nowUs() - t0;
+    if (w != cfg.appendBytes) return false;
+    sumUs += dt;
+    if (dt > st.appendMaxUs) st.appendMaxUs = dt;
+  }
+  st.appendAvgUs = cfg.appendCount > 0 ? (uint32_t)(sumUs / (uint64_t)cfg.appendCount) : 0;
+  io.idle();
+
+  for (int b = 0; b < SD_BENCH_BUF_COUNT; b++) {
+    if (SD_BENCH_BUFS[b] > scratchLen) continue;
+    uint32_t salt = hz ^ ((uint32_t)SD_BENCH_BUFS[b] << 16);
+    if (!sdBenchSequential(io, cfg.seqBytes, SD_BENCH_BUFS[b], salt, scratch, st.writeKBps[b], st.readKBps[b])) return false;
+  }
+  io.remove();
+  st.verified = true;
+  return true;
+}
+
+// Runs the sweep and leaves the card mounted at the chosen clock (or SD_BENCH_SAFE_HZ).
+template <typename Io>
+bool sdBenchRun(Io &io, const SdBenchConfig &cfg, uint8_t *scratch, size_t scratchLen, SdBenchResult &out) {
+  out = SdBenchResult();
+  const uint32_t start = io.nowUs();
+  int bestStep = -1;
+
+  for (int c = 0; c < SD_BENCH_CLOCK_COUNT && SD_BENCH_CLOCKS[c] <= cfg.maxHz; c++) {
+    SdBenchStep &st = out.steps[out.stepCount++];
+    bool ok = sdBenchStep(io, cfg, SD_BENCH_CLOCKS[c], scratch, scratchLen, st);
+    io.remove();
+    if (!ok) break;
+    bestStep = out.stepCount - 1;
+  }
+
+  // Confirm the winner once more; marginal clocks often pass one run and fail the next.
+  while (bestStep >= 0) {
+    SdBenchStep again;
+    if (sdBenchStep(io, cfg, out.steps[bestStep].hz, scratch, scratchLen, again)) break;
+    io.remove();
+    out.steps[bestStep].verified = false;
+    bestStep--;
+  }
+
+  if (bestStep >= 0) {
+    const SdBenchStep &st = out.steps[bestStep];
+    out.bestHz = st.hz;
+    out.bestAppendUs = st.appendAvgUs;
+    for (int b = 0; b < SD_BENCH_BUF_COUNT; b++) {
+      if (st.writeKBps[b] > out.bestWriteKBps) {
+        out.bestWriteKBps = st.writeKBps[b];
+        out.bestReadKBps = st.readKBps[b];
+        out.bestBufBytes = SD_BENCH_BUFS[b];
+      }
+    }
+  }
+
+  io.mount(out.bestHz ? out.bestHz : SD_BENCH_SAFE_HZ);
+  out.elapsedMs = (io.nowUs() - start) / 1000u;
+  return bestStep >= 0;
+}
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "crc32.h"
+
+// Device settings persisted as one versioned, CRC-checked NVS blob.
+//
+// - load(): reads the blob; if it is missing or corrupt, migrates the legacy per-key layout
+//   ("yellow", "red", ... in the same namespace) and writes the blob once.
+// - update(): records a new snapshot, tracks which fields changed, and (re)arms a debounce timer.
+// - tick(): commits when the settings have been quiet for debounceMs, or maxDelayMs after the
+//   first unsaved change, so a slider drag becomes a single flash write.
+//
+// The backend is duck-typed on the Preferences API (begin/end/getBytes/putBytes/getInt/getBool/isKey),
+// so the firmware passes its Preferences object and a host test can pass an in-memory fake.
+
+struct DeviceSettings {
+  int32_t yellow;
+  int32_t red;
+  uint8_t speaker;
+  int32_t mp3Volume;
+
+  int32_t majorRepeatIntervalMs;
+  int32_t silenceResetWindowMs;
+  int32_t firstWarningMs;
+  int32_t secondWarningMs;
+  int32_t majorWarningMs;
+
+  int32_t noiseGreenBrt;
+  int32_t noiseYellowBrt;
+  int32_t noiseRedBrt;
+  int32_t statusLedBrt;
+  uint8_t noiseLedsEnabled;
+  uint8_t micEnabled;
+  uint8_t serialLoggingEnabled;
+
+  int32_t statusRgbBoot;
+  int32_t statusRgbAp;
+  int32_t statusRgbWifiOk;
+  int32_t statusRgbNoInternet;
+  int32_t statusRgbOffline;
+
+  int32_t dbSampleIntervalMs;
+  int32_t dbChangeThreshold10;
+  int32_t dbHeartbeatMs;
+  int32_t dbBulkUploadIntervalMs;
+
+  uint8_t lowPowerEnabled;
+  int32_t lowPowerQuietMs;
+
+  // v2
+  uint8_t classifierSuppress;
+  int32_t classifierMinConfidence;
+
+  // v3
+  uint8_t eventWriteThrough;
+  int32_t eventMaxRamAgeMs;
+
+  // v4
+  int32_t zoneCount;
+  // Append new fields at the end and bump SETTINGS_VERSION; older blobs keep defaults for them.
+};
+
+static const uint16_t SETTINGS_MAGIC = 0x4E53;  // "NS"
+static const uint16_t SETTINGS_VERSION = 4;
+static const char *const SETTINGS_BLOB_KEY = "blob";
+
+struct SettingsBlobHeader {
+  uint16_t magic;
+  uint16_t version;
+  uint16_t payloadSize;
+  uint16_t reserved;
+  uint32_t crc;
+};
+
+enum SettingsFieldType { SF_INT = 0, SF_BOOL = 1 };
+
+struct SettingsField {
+  const char *legacyKey;  // pre-blob per-key name; fields added since v1 simply never match
+  uint16_t offset;
+  uint8_t type;
+};
+
+#define SETTINGS_FIELD(key, member, type) { key, (uint16_t)offsetof(DeviceSettings, member), type }
+static const SettingsField SETTINGS_FIELDS[] = {
+  SETTINGS_FIELD("yellow", yellow, SF_INT),
+  SETTINGS_FIELD("red", red, SF_INT),
+  SETTINGS_FIELD("speaker", speaker, SF_BOOL),
+  SETTINGS_FIELD("mp3vol", mp3Volume, SF_INT),
+  SETTINGS_FIELD("maj_int", majorRepeatIntervalMs, SF_INT),
+  SETTINGS_FIELD("sil_win", silenceResetWindowMs, SF_INT),
+  SETTINGS_FIELD("fw_ms", firstWarningMs, SF_INT),
+  SETTINGS_FIELD("sw_ms", secondWarningMs, SF_INT),
+  SETTINGS_FIELD("mw_ms", majorWarningMs, SF_INT),
+  SETTINGS_FIELD("ngbrt", noiseGreenBrt, SF_INT),
+  SETTINGS_FIELD("nybrt", noiseYellowBrt, SF_INT),
+  SETTINGS_FIELD("nrbrt", noiseRedBrt, SF_INT),
+  SETTINGS_FIELD("stbrt", statusLedBrt, SF_INT),
+  SETTINGS_FIELD("nleden", noiseLedsEnabled, SF_BOOL),
+  SETTINGS_FIELD("micen", micEnabled, SF_BOOL),
+  SETTINGS_FIELD("serlog", serialLoggingEnabled, SF_BOOL),
+  SETTINGS_FIELD("sr_boot", statusRgbBoot, SF_INT),
+  SETTINGS_FIELD("sr_ap", statusRgbAp, SF_INT),
+  SETTINGS_FIELD("sr_wifi", statusRgbWifiOk, SF_INT),
+  SETTINGS_FIELD("sr_noi", statusRgbNoInternet, SF_INT),
+  SETTINGS_FIELD("sr_off", statusRgbOffline, SF_INT),
+  SETTINGS_FIELD("db_samp", dbSampleIntervalMs, SF_INT),
+  SETTINGS_FIELD("db_thr10", dbChangeThreshold10, SF_INT),
+  SETTINGS_FIELD("db_hb", dbHeartbeatMs, SF_INT),
+  SETTINGS_FIELD("db_up", dbBulkUploadIntervalMs, SF_INT),
+  SETTINGS_FIELD("lp_en", lowPowerEnabled, SF_BOOL),
+  SETTINGS_FIELD("lp_quiet", lowPowerQuietMs, SF_INT),
+  SETTINGS_FIELD("cls_en", classifierSuppress, SF_BOOL),
+  SETTINGS_FIELD("cls_conf", classifierMinConfidence, SF_INT),
+  SETTINGS_FIELD("evq_wt", eventWriteThrough, SF_BOOL),
+  SETTINGS_FIELD("evq_age", eventMaxRamAgeMs, SF_INT),
+  SETTINGS_FIELD("zones", zoneCount, SF_INT),
+};
+#undef SETTINGS_FIELD
+static const int SETTINGS_FIELD_COUNT = (int)(sizeof(SETTINGS_FIELDS) / sizeof(SETTINGS_FIELDS[0]));
+
+// Bit i set = SETTINGS_FIELDS[i] differs between a and b.
+static inline uint32_t settingsDiffMask(const DeviceSettings &a, const DeviceSettings &b) {
+  uint32_t mask = 0;
+  const uint8_t *pa = (const uint8_t *)&a;
+  const uint8_t *pb = (const uint8_t *)&b;
+  for (int i = 0; i < SETTINGS_FIELD_COUNT; i++) {
+    const SettingsField &f = SETTINGS_FIELDS[i];
+    size_t n = (f.type == SF_BOOL) ? 1 : 4;
+    if (memcmp(pa + f.offset, pb + f.offset, n) != 0) mask |= (1u << i);
+  }
+  return mask;
+}
+
+enum SettingsLoadResult { SETTINGS_LOADED_BLOB = 0, SETTINGS_MIGRATED_LEGACY = 1, SETTINGS_DEFAULTS = 2 };
+
+template <typename Backend>
+struct SettingsStore {
+  Backend *nvs = nullptr;
+  const char *ns = "settings";
+
+  uint32_t debounceMs = 1500;
+  uint32_t maxDelayMs = 10000;
+
+  DeviceSettings committed;
+  DeviceSettings pending;
+  bool dirty = false;
+  uint32_t dirtyMask = 0;
+  uint32_t firstDirtyMs = 0;
+  uint32_t lastChangeMs = 0;
+
+  uint32_t commits = 0;
+  uint32_t commitFailures = 0;
+  uint32_t updatesCoalesced = 0;
+  SettingsLoadResult lastLoad = SETTINGS_DEFAULTS;
+
+  // s holds compiled-in defaults on entry and the effective settings on return.
+  SettingsLoadResult load(DeviceSettings &s) {
+    uint8_t buf[sizeof(SettingsBlobHeader) + sizeof(DeviceSettings) + 64];
+    nvs->begin(ns, true);
+    size_t n = nvs->getBytes(SETTINGS_BLOB_KEY, buf, sizeof(buf));
+    if (n >= sizeof(SettingsBlobHeader)) {
+      SettingsBlobHeader h;
+      memcpy(&h, buf, sizeof(h));
+      const uint8_t *payload = buf + sizeof(h);
+      if (h.magic == SETTINGS_MAGIC && h.payloadSize <= n - sizeof(h) &&
+          crc32Of(payload, h.payloadSize) == h.crc) {
+        // Older blob: copy what it has, keep defaults for fields added since.
+        // Newer blob (downgrade): copy the prefix this firmware knows about.
+        size_t copy = h.payloadSize < sizeof(DeviceSettings) ? h.payloadSize : sizeof(DeviceSettings);
+        memcpy(&s, payload, copy);
+        nvs->end();
+        committed = pending = s;
+        lastLoad = SETTINGS_LOADED_BLOB;
+        if (h.version != SETTINGS_VERSION || h.payloadSize != sizeof(DeviceSettings)) writeBlob(s);
+        return lastLoad;
+      }
+    }
+
+    bool anyLegacy = false;
+    uint8_t *ps = (uint8_t *)&s;
+    for (int i = 0; i < SETTINGS_FIELD_COUNT; i++) {
+      const SettingsField &f = SETTINGS_FIELDS[i];
+      if (!nvs->isKey(f.legacyKey)) continue;
+      anyLegacy = true;
+      if (f.type == SF_BOOL) {
+        uint8_t v = nvs->getBool(f.legacyKey, ps[f.offset] != 0) ? 1 : 0;
+        ps[f.offset] = v;
+      } else {
+        int32_t v;
+        memcpy(&v, ps + f.offset, 4);
+        v = (int32_t)nvs->getInt(f.legacyKey, (int)v);
+        memcpy(ps + f.offset, &v, 4);
+      }
+    }
+    nvs->end();
+
+    // Legacy keys are left in place so an older firmware image still boots with the same settings.
+    committed = pending = s;
+    lastLoad = anyLegacy ? SETTINGS_MIGRATED_LEGACY : SETTINGS_DEFAULTS;
+    writeBlob(s);
+    return lastLoad;
+  }
+
+  void update(const DeviceSettings &s, uint32_t now) {
+    uint32_t mask = settingsDiffMask(s, committed);
+    pending = s;
+    if (mask == 0) {
+      dirty = false;
+      dirtyMask = 0;
+      return;
+    }
+    if (dirty) updatesCoalesced++;
+    else firstDirtyMs = now;
+    dirty = true;
+    dirtyMask = mask;
+    lastChangeMs = now;
+  }
+
+  bool commitDue(uint32_t now) const {
+    if (!dirty) return false;
+    return (now - lastChangeMs >= debounceMs) || (now - firstDirtyMs >= maxDelayMs);
+  }
+
+  // Returns true if a flash write happened.
+  bool tick(uint32_t now) {
+    if (!commitDue(now)) return false;
+    return flush();
+  }
+
+  bool flush() {
+    if (!dirty) return false;
+    if (!writeBlob(pending)) return false;
+    committed = pending;
+    dirty = false;
+    dirtyMask = 0;
+    return true;
+  }
+
+ private:
+  bool writeBlob(const DeviceSettings &s) {
+    uint8_t buf[sizeof(SettingsBlobHeader) + sizeof(DeviceSettings)];
+    SettingsBlobHeader h;
+    h.magic = SETTINGS_MAGIC;
+    h.version = SETTINGS_VERSION;
+    h.payloadSize = (uint16_t)sizeof(DeviceSettings);
+    h.reserved = 0;
+    h.crc = crc32Of((const uint8_t *)&s, sizeof(DeviceSettings));
+    memcpy(buf, &h, sizeof(h));
+    memcpy(buf + sizeof(h), &s, sizeof(DeviceSettings));
+
+    nvs->begin(ns, false);
+    size_t w = nvs->putBytes(SETTINGS_BLOB_KEY, buf, sizeof(buf));
+    nvs->end();
+    if (w != sizeof(buf)) {
+      commitFailures++;
+      return false;
+    }
+    commits++;
+    return true;
+  }
+};
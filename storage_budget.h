@@ -0,0 +1,575 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "event_queue.h"
+
+// Keeps the SD card's growing files inside per-class byte budgets, a little at a time from loop().
+//
+// Classes and what happens when one outgrows its budget:
+// - db series (/db_series.txt): raw "ts|db10[|zone]" lines older than rawKeepHours are rolled up
+//   into rollupSec buckets, and those older than coarseAfterDays into coarseSec buckets. A bucket
+//   becomes one line in the same format, carrying the bucket's peak (the time and level of its
+//   loudest sample), so the upload path is unchanged. The roll-up also runs on a schedule as the
+//   file grows. If a pass leaves the file over budget the age thresholds halve (level 1..5); past
+//   that, or with no clock, the oldest lines are dropped.
+// - noise log (/noise_log.txt): rotated to /noise_log_old.txt at half the budget.
+// - pending events: oldest FIRST/SECOND lines are dropped; MAJOR lines are never dropped.
+// - recordings (rec_*.wav): deleted past retentionDays (plan.txt: 7-14 days), and oldest first
+//   while the class is over budget.
+// Free space below majorReserveBytes (room for a few MAJOR clips) counts as pressure: the old
+// noise log goes first, then the db series tightens, then the oldest recordings, then FIRST/SECOND
+// events. makeRoom() frees space right before a MAJOR clip is written.
+//
+// All work is incremental: tick() reads at most chunkBytes of a file being rewritten, or looks at
+// a few directory entries, or deletes/renames one file. A rewrite streams into a side file and
+// swaps it in at the end; lines appended to the source meanwhile are picked up before the swap.
+// cancel() abandons a rewrite (the upload paths call it before they rewrite the same file).
+//
+// Fs is duck-typed: uint64_t freeBytes(), int64_t size(const char*) (-1 if missing),
+// int readAt(const char*, uint32_t off, uint8_t*, int), bool append(const char*, const uint8_t*, int),
+// bool remove(const char*), bool rename(const char*, const char*), and
+// bool dirNext(char *name, size_t cap, uint32_t &size) listing root files one per call (false at the
+// end, after which it starts over). The firmware wraps SD; tools/storage_sim.cpp wraps an in-memory card.
+
+enum StoreClass : uint8_t { STORE_DB_SERIES, STORE_NOISE_LOG, STORE_PENDING, STORE_RECORDINGS, STORE_CLASS_COUNT };
+static const char *const STORE_CLASS_NAMES[] = { "db_series", "noise_log", "pending", "recordings" };
+
+static const int STORE_DB_MAX_LEVEL = 6;      // level 6 = drop oldest
+static const int STORE_LINE_MAX = 256;
+static const int STORE_OUT_BYTES = 512;
+static const int STORE_OLDEST = 8;            // delete candidates kept per directory scan
+static const int STORE_MAX_ZONES = 4;
+
+struct StorageConfig {
+  uint32_t budget[STORE_CLASS_COUNT] = { 8UL << 20, 4UL << 20, 1UL << 20, 64UL << 20 };
+  uint32_t majorReserveBytes = 1UL << 20;     // ~6 five-second clips
+  uint16_t retentionDays = 14;
+  uint16_t rawKeepHours = 48;
+  uint16_t rollupSec = 300;
+  uint16_t coarseAfterDays = 14;
+  uint16_t coarseSec = 3600;
+  int32_t localOffsetSec = 0;                 // recording names carry local time
+  uint32_t checkIntervalMs = 60000;
+  uint32_t workIntervalMs = 25;
+  uint16_t chunkBytes = 1024;
+  uint8_t scanPerTick = 16;
+};
+
+struct StoreRecording {
+  char path[32];
+  uint32_t size;
+  uint32_t epochSec;   // 0 = no date in the name
+};
+
+// "rec_YYYYMMDD_HHMMSS.wav" (optionally with a leading '/') -> local seconds since 1970; 0 if the
+// name has no date (recorded before the clock was set), -1 if it is not a recording.
+static inline int64_t storeRecordingLocalSec(const char *name) {
+  if (name[0] == '/') name++;
+  if (strncmp(name, "rec_", 4) != 0) return -1;
+  const size_t n = strlen(name);
+  if (n < 8 || strcmp(name + n - 4, ".wav") != 0) return -1;
+  const char *d = name + 4;
+  if (n != 4 + 15 + 4 || d[8] != '_') return 0;
+  int v[14];
+  for (int i = 0, j = 0; i < 15; i++) {
+    if (i == 8) continue;
+    if (d[i] < '0' || d[i] > '9') return 0;
+    v[j++] = d[i] - '0';
+  }
+  int y = v[0] * 1000 + v[1] * 100 + v[2] * 10 + v[3];
+  const int mo = v[4] * 10 + v[5], dd = v[6] * 10 + v[7];
+  const int hh = v[8] * 10 + v[9], mi = v[10] * 10 + v[11], ss = v[12] * 10 + v[13];
+  if (mo < 1 || mo > 12 || dd < 1 || dd > 31) return 0;
+  // days_from_civil (Howard Hinnant)
+  y -= mo <= 2;
+  const int era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = (unsigned)(y - era * 400);
+  const unsigned doy = (unsigned)((153 * (mo + (mo > 2 ? -3 : 9)) + 2) / 5 + dd - 1);
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  const int64_t days = (int64_t)era * 146097 + (int64_t)doe - 719468;
+  return days * 86400 + hh * 3600 + mi * 60 + ss;
+}
+
+struct StoreBucket {
+  bool active = false;
+  uint16_t sec = 0;
+  uint64_t index = 0;
+  uint64_t peakTs = 0;
+  int peakDb10 = 0;
+};
+
+struct StorageStats {
+  uint32_t checks = 0;
+  uint32_t recExpired = 0;       // recordings deleted for age
+  uint32_t recEvicted = 0;       // recordings deleted for budget or pressure
+  uint32_t dbJobs = 0;
+  uint32_t dbLinesIn = 0;
+  uint32_t dbLinesOut = 0;
+  uint32_t dbLinesDropped = 0;
+  uint32_t pendingDropped = 0;
+  uint32_t noiseRotations = 0;
+  uint32_t cancels = 0;
+  uint32_t starved = 0;          // checks that ended under pressure with nothing left to free
+  uint32_t errors = 0;
+  uint32_t madeRoom = 0;         // recordings deleted by makeRoom()
+};
+
+template <typename Fs>
+struct StorageManager {
+  enum Phase : uint8_t { IDLE, SCAN, ACT, REWRITE };
+
+  Fs *fs = nullptr;
+  StorageConfig cfg;
+  StorageStats stats;
+
+  const char *dbPath = "/db_series.txt";
+  const char *dbTmpPath = "/db_series_cmp.txt";
+  const char *noisePath = "/noise_log.txt";
+  const char *noiseOldPath = "/noise_log_old.txt";
+  const char *pendingPath = "/pending_events.txt";
+  const char *pendingTmpPath = "/pending_events_cmp.txt";
+
+  Phase phase = IDLE;
+  uint32_t nextCheckMs = 0;
+  uint32_t nextWorkMs = 0;
+
+  // Last measurement (kept current as files are deleted or rewritten).
+  uint64_t freeBytes = 0;
+  uint32_t used[STORE_CLASS_COUNT] = { 0, 0, 0, 0 };
+  uint32_t recCount = 0;
+  uint32_t noiseBytes = 0;       // current noise log alone
+  uint32_t noiseOldBytes = 0;
+  bool measured = false;
+  bool rescanSoon = false;       // deletions used up the candidate list with recordings left
+
+  StoreRecording oldest[STORE_OLDEST];
+  int oldestCount = 0;
+
+  uint8_t dbLevel = 0;
+  uint32_t dbSizeAfterJob = 0;
+  uint32_t pendingSizeAfterTrim = 0;
+
+  // Rewrite job.
+  StoreClass jobClass = STORE_DB_SERIES;
+  const char *jobSrc = nullptr;
+  const char *jobTmp = nullptr;
+  uint32_t jobReadOff = 0;
+  uint32_t jobDropUntil = 0;     // db drop mode: lines ending at or before this offset go
+  uint32_t jobDropNeed = 0;      // pending: bytes of FIRST/SECOND lines still to drop
+  uint8_t jobLevel = 0;
+  uint64_t jobNowMs = 0;
+  bool jobFailed = false;
+  char line[STORE_LINE_MAX];
+  uint16_t lineLen = 0;
+  bool lineOverflow = false;
+  uint8_t out[STORE_OUT_BYTES];
+  uint16_t outLen = 0;
+  StoreBucket acc[STORE_MAX_ZONES];
+
+  // Finishes or undoes a swap interrupted by a reset: a lone side file is the finished rewrite.
+  void begin(Fs *f) {
+    fs = f;
+    recoverSwap(dbPath, dbTmpPath);
+    recoverSwap(pendingPath, pendingTmpPath);
+    phase = IDLE;
+    nextCheckMs = 0;
+  }
+
+  bool busy() const { return phase != IDLE; }
+  bool due(uint32_t nowMs) const { return fs && (phase != IDLE || (int32_t)(nowMs - nextCheckMs) >= 0); }
+  // Time until due() turns true, for callers that sleep between ticks.
+  uint32_t msUntilDue(uint32_t nowMs) const {
+    int32_t d = (int32_t)((phase != IDLE ? nextWorkMs : nextCheckMs) - nowMs);
+    return d > 0 ? (uint32_t)d : 0;
+  }
+  bool underPressure() const { return measured && freeBytes < cfg.majorReserveBytes; }
+
+  // Starts a check on the next tick instead of waiting for checkIntervalMs.
+  void requestCheck(uint32_t nowMs) {
+    if (phase == IDLE) nextCheckMs = nowMs;
+  }
+
+  // Abandons a rewrite of `cls` (its source is about to be rewritten by someone else).
+  void cancel(StoreClass cls) {
+    if (phase != REWRITE || jobClass != cls) return;
+    fs->remove(jobTmp);
+    stats.cancels++;
+    phase = IDLE;
+  }
+
+  // Called right before a MAJOR clip is written: deletes the oldest recordings (at most
+  // maxDeletes) until `bytes` fit with nothing else touched. Returns whether they fit.
+  bool makeRoom(uint32_t bytes, int maxDeletes = 4) {
+    if (!fs) return false;
+    freeBytes = fs->freeBytes();
+    while (freeBytes < bytes && maxDeletes-- > 0 && oldestCount > 0) {
+      if (!deleteOldest()) break;
+      stats.madeRoom++;
+    }
+    return freeBytes >= bytes;
+  }
+
+  // epochMs = 0 when the clock is not set: age-based rules are skipped, size rules still apply.
+  void tick(uint32_t nowMs, uint64_t epochMs) {
+    if (!fs) return;
+    if (phase == IDLE) {
+      if ((int32_t)(nowMs - nextCheckMs) < 0) return;
+      startScan();
+    }
+    if ((int32_t)(nowMs - nextWorkMs) < 0) return;
+    nextWorkMs = nowMs + cfg.workIntervalMs;
+
+    switch (phase) {
+      case SCAN:
+        scanStep();
+        break;
+      case ACT:
+        if (!actStep(epochMs)) {
+          if (underPressure() && !rescanSoon) stats.starved++;
+          phase = IDLE;
+          nextCheckMs = rescanSoon ? nowMs : nowMs + cfg.checkIntervalMs;
+        }
+        break;
+      case REWRITE:
+        rewriteStep();
+        break;
+      case IDLE:
+        break;
+    }
+  }
+
+ private:
+  void recoverSwap(const char *src, const char *tmp) {
+    if (fs->size(tmp) < 0) return;
+    if (fs->size(src) < 0) fs->rename(tmp, src);
+    else fs->remove(tmp);
+  }
+
+  void startScan() {
+    stats.checks++;
+    oldestCount = 0;
+    used[STORE_RECORDINGS] = 0;
+    recCount = 0;
+    rescanSoon = false;
+    phase = SCAN;
+  }
+
+  void noteRecording(const char *name, uint32_t size, int64_t localSec) {
+    used[STORE_RECORDINGS] += size;
+    recCount++;
+    if (name[0] == '/') name++;
+    StoreRecording r;
+    const size_t n = strlen(name);
+    if (n + 2 > sizeof(r.path)) return;   // sketch names are short; never truncate one
+    r.path[0] = '/';
+    memcpy(r.path + 1, name, n + 1);
+    r.size = size;
+    r.epochSec = localSec > 0 ? (uint32_t)(localSec - cfg.localOffsetSec) : 0;
+    // Keep the STORE_OLDEST oldest (undated first, then by date), sorted oldest first.
+    int at = oldestCount;
+    while (at > 0 && (oldest[at - 1].epochSec > r.epochSec ||
+                      (oldest[at - 1].epochSec == r.epochSec && strcmp(oldest[at - 1].path, r.path) > 0)))
+      at--;
+    if (at >= STORE_OLDEST) return;
+    const int last = oldestCount < STORE_OLDEST ? oldestCount : STORE_OLDEST - 1;
+    memmove(&oldest[at + 1], &oldest[at], sizeof(StoreRecording) * (size_t)(last - at));
+    oldest[at] = r;
+    if (oldestCount < STORE_OLDEST) oldestCount++;
+  }
+
+  void scanStep() {
+    char name[48];
+    uint32_t size = 0;
+    for (int i = 0; i < cfg.scanPerTick; i++) {
+      if (!fs->dirNext(name, sizeof(name), size)) {
+        measureFiles();
+        phase = ACT;
+        return;
+      }
+      const int64_t sec = storeRecordingLocalSec(name);
+      if (sec >= 0) noteRecording(name, size, sec);
+    }
+  }
+
+  uint32_t fileSize(const char *path) {
+    int64_t s = fs->size(path);
+    return s > 0 ? (uint32_t)s : 0;
+  }
+
+  void measureFiles() {
+    used[STORE_DB_SERIES] = fileSize(dbPath);
+    noiseBytes = fileSize(noisePath);
+    noiseOldBytes = fileSize(noiseOldPath);
+    used[STORE_NOISE_LOG] = noiseBytes + noiseOldBytes;
+    used[STORE_PENDING] = fileSize(pendingPath);
+    freeBytes = fs->freeBytes();
+    measured = true;
+  }
+
+  bool deleteOldest() {
+    if (oldestCount == 0) return false;
+    const StoreRecording r = oldest[0];
+    memmove(&oldest[0], &oldest[1], sizeof(StoreRecording) * (size_t)(oldestCount - 1));
+    oldestCount--;
+    if (!fs->remove(r.path)) {
+      stats.errors++;
+      return false;
+    }
+    used[STORE_RECORDINGS] -= r.size < used[STORE_RECORDINGS] ? r.size : used[STORE_RECORDINGS];
+    if (recCount) recCount--;
+    freeBytes += r.size;
+    if (oldestCount == 0 && recCount > 0) rescanSoon = true;
+    return true;
+  }
+
+  bool removeOldNoiseLog() {
+    if (noiseOldBytes > 0 && !fs->remove(noiseOldPath)) {
+      stats.errors++;
+      return false;
+    }
+    freeBytes += noiseOldBytes;
+    noiseOldBytes = 0;
+    used[STORE_NOISE_LOG] = noiseBytes;
+    return true;
+  }
+
+  bool rotateNoiseLog() {
+    if (!removeOldNoiseLog()) return false;
+    if (!fs->rename(noisePath, noiseOldPath)) {
+      stats.errors++;
+      return false;
+    }
+    noiseOldBytes = noiseBytes;
+    noiseBytes = 0;
+    stats.noiseRotations++;
+    return true;
+  }
+
+  // One decision per call; false when there is nothing (more) to do.
+  bool actStep(uint64_t epochMs) {
+    const uint32_t epochSec = (uint32_t)(epochMs / 1000ULL);
+    const StoreRecording *r = oldestCount ? &oldest[0] : nullptr;
+
+    if (r && epochSec && r->epochSec && epochSec > r->epochSec + (uint32_t)cfg.retentionDays * 86400UL) {
+      if (!deleteOldest()) return false;
+      stats.recExpired++;
+      return true;
+    }
+    if (noiseBytes > cfg.budget[STORE_NOISE_LOG] / 2) return rotateNoiseLog();
+    if (r && used[STORE_RECORDINGS] > cfg.budget[STORE_RECORDINGS]) {
+      if (!deleteOldest()) return false;
+      stats.recEvicted++;
+      return true;
+    }
+
+    const uint32_t db = used[STORE_DB_SERIES];
+    const uint32_t dbBudget = cfg.budget[STORE_DB_SERIES];
+    if (db > dbBudget) {
+      // A pass that left the file over budget means the thresholds are too loose for this outage.
+      if (dbSizeAfterJob > dbBudget && dbLevel < STORE_DB_MAX_LEVEL) dbLevel++;
+      startDbJob(epochMs);
+      return true;
+    }
+    if (epochMs && db > dbSizeAfterJob + dbBudget / 8) {
+      if (db < dbBudget / 2 && dbLevel > 0) dbLevel--;
+      startDbJob(epochMs);
+      return true;
+    }
+
+    const uint32_t pend = used[STORE_PENDING];
+    if (pend > cfg.budget[STORE_PENDING] && pend > pendingSizeAfterTrim) {
+      startPendingJob(pend - cfg.budget[STORE_PENDING] * 3 / 4);
+      return true;
+    }
+
+    if (!underPressure()) return false;
+    const uint32_t shortBy = (uint32_t)(cfg.majorReserveBytes - freeBytes);
+    if (noiseOldBytes > 0) return removeOldNoiseLog();
+    if (db > 0 && dbLevel < STORE_DB_MAX_LEVEL) {
+      dbLevel++;
+      startDbJob(epochMs);
+      return true;
+    }
+    if (r) {
+      if (!deleteOldest()) return false;
+      stats.recEvicted++;
+      return true;
+    }
+    if (pend > pendingSizeAfterTrim && pend > 0) {
+      startPendingJob(shortBy);
+      return true;
+    }
+    return false;
+  }
+
+  void startJob(StoreClass cls, const char *src, const char *tmp) {
+    jobClass = cls;
+    jobSrc = src;
+    jobTmp = tmp;
+    jobReadOff = 0;
+    jobFailed = false;
+    lineLen = 0;
+    lineOverflow = false;
+    outLen = 0;
+    for (int z = 0; z < STORE_MAX_ZONES; z++) acc[z] = StoreBucket();
+    fs->remove(tmp);
+    phase = REWRITE;
+  }
+
+  void startDbJob(uint64_t epochMs) {
+    startJob(STORE_DB_SERIES, dbPath, dbTmpPath);
+    stats.dbJobs++;
+    jobLevel = dbLevel < STORE_DB_MAX_LEVEL ? dbLevel : STORE_DB_MAX_LEVEL - 1;   // drop mode still rolls up
+    jobNowMs = epochMs;
+    const uint32_t db = used[STORE_DB_SERIES];
+    const uint32_t keep = cfg.budget[STORE_DB_SERIES] * 3 / 4;
+    const bool drop = (dbLevel >= STORE_DB_MAX_LEVEL || epochMs == 0) && db > keep;
+    jobDropUntil = drop ? db - keep : 0;
+  }
+
+  void startPendingJob(uint32_t dropBytes) {
+    startJob(STORE_PENDING, pendingPath, pendingTmpPath);
+    jobDropNeed = dropBytes;
+  }
+
+  void emit(const char *s, int n) {
+    if (outLen + n + 2 > STORE_OUT_BYTES) flushOut();
+    memcpy(out + outLen, s, (size_t)n);
+    outLen += (uint16_t)n;
+    out[outLen++] = '\r';
+    out[outLen++] = '\n';
+  }
+
+  void flushOut() {
+    if (outLen == 0) return;
+    if (!fs->append(jobTmp, out, outLen)) jobFailed = true;
+    outLen = 0;
+  }
+
+  void emitBucket(int z) {
+    StoreBucket &b = acc[z];
+    if (!b.active) return;
+    char s[40];
+    int n = z ? snprintf(s, sizeof(s), "%llu|%d|%d", (unsigned long long)b.peakTs, b.peakDb10, z)
+              : snprintf(s, sizeof(s), "%llu|%d", (unsigned long long)b.peakTs, b.peakDb10);
+    emit(s, n);
+    stats.dbLinesOut++;
+    b.active = false;
+  }
+
+  void dbLine(uint32_t lineEndOff) {
+    stats.dbLinesIn++;
+    if (jobDropUntil && lineEndOff <= jobDropUntil) {
+      stats.dbLinesDropped++;
+      return;
+    }
+    char *p = nullptr;
+    const uint64_t ts = strtoull(line, &p, 10);
+    if (jobNowMs == 0 || p == line || *p != '|') {
+      emit(line, lineLen);
+      stats.dbLinesOut++;
+      return;
+    }
+    char *q = nullptr;
+    const int db10 = (int)strtol(p + 1, &q, 10);
+    const int zone = (*q == '|') ? (int)strtol(q + 1, nullptr, 10) : 0;
+    const int z = (zone >= 0 && zone < STORE_MAX_ZONES) ? zone : 0;
+    const uint64_t age = jobNowMs > ts ? jobNowMs - ts : 0;
+    const uint64_t rawKeepMs = ((uint64_t)cfg.rawKeepHours * 3600000ULL) >> jobLevel;
+    const uint64_t coarseMs = ((uint64_t)cfg.coarseAfterDays * 86400000ULL) >> jobLevel;
+    if (age < rawKeepMs || zone != z) {
+      emitBucket(z);
+      emit(line, lineLen);
+      stats.dbLinesOut++;
+      return;
+    }
+    const uint16_t sec = age >= coarseMs ? cfg.coarseSec : cfg.rollupSec;
+    const uint64_t index = ts / ((uint64_t)sec * 1000ULL);
+    StoreBucket &b = acc[z];
+    if (b.active && (b.sec != sec || b.index != index)) emitBucket(z);
+    if (!b.active) {
+      b.active = true;
+      b.sec = sec;
+      b.index = index;
+      b.peakTs = ts;
+      b.peakDb10 = db10;
+    } else if (db10 > b.peakDb10) {
+      b.peakTs = ts;
+      b.peakDb10 = db10;
+    }
+  }
+
+  void pendingLine() {
+    if (jobDropNeed > 0) {
+      PendingEvent e;
+      if (pendingEventParse(line, e) && strcmp(e.level, "MAJOR") != 0) {
+        const uint32_t n = (uint32_t)lineLen + 2;
+        jobDropNeed = n >= jobDropNeed ? 0 : jobDropNeed - n;
+        stats.pendingDropped++;
+        return;
+      }
+    }
+    emit(line, lineLen);
+  }
+
+  void endLine(uint32_t lineEndOff) {
+    while (lineLen > 0 && line[lineLen - 1] == '\r') lineLen--;
+    line[lineLen] = '\0';
+    if (lineOverflow) stats.errors++;       // cut to STORE_LINE_MAX - 1; kept as far as it goes
+    if (lineLen > 0) {
+      if (jobClass == STORE_DB_SERIES) dbLine(lineEndOff);
+      else pendingLine();
+    }
+    lineLen = 0;
+    lineOverflow = false;
+  }
+
+  void rewriteStep() {
+    uint8_t buf[1024];
+    const int want = cfg.chunkBytes < sizeof(buf) ? cfg.chunkBytes : (int)sizeof(buf);
+    const int n = fs->readAt(jobSrc, jobReadOff, buf, want);
+    if (n < 0) {
+      stats.errors++;
+      fs->remove(jobTmp);
+      phase = ACT;
+      return;
+    }
+    for (int i = 0; i < n; i++) {
+      const char c = (char)buf[i];
+      if (c == '\n') {
+        endLine(jobReadOff + (uint32_t)i + 1);
+      } else if (lineLen < STORE_LINE_MAX - 1) {
+        line[lineLen++] = c;
+      } else {
+        lineOverflow = true;
+      }
+    }
+    jobReadOff += (uint32_t)n;
+    if (n > 0 && !jobFailed) return;
+
+    // End of the source as it stands in this tick; nothing can append between here and the swap.
+    if (lineLen > 0) endLine(jobReadOff);
+    for (int z = 0; z < STORE_MAX_ZONES; z++) emitBucket(z);
+    flushOut();
+    const uint32_t before = jobReadOff;
+    if (jobFailed) {
+      stats.errors++;
+      fs->remove(jobTmp);
+    } else if (fs->size(jobTmp) < 0) {
+      fs->remove(jobSrc);   // everything was dropped
+    } else if (!fs->remove(jobSrc) || !fs->rename(jobTmp, jobSrc)) {
+      stats.errors++;
+    }
+    const uint32_t after = fileSize(jobSrc);
+    used[jobClass] = after;
+    if (before > after) freeBytes += before - after;
+    if (jobClass == STORE_DB_SERIES) dbSizeAfterJob = after;
+    else pendingSizeAfterTrim = after;
+    phase = ACT;
+  }
+};
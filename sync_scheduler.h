@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+
+// Adaptive Supabase sync policy.
+// Kept free of Arduino headers so the same code can be driven from a host simulation
+// with a virtual clock and a fake uplink.
+
+enum SyncPriority {
+  SYNC_PRIO_MAJOR = 0,      // MAJOR events (audio) drain first
+  SYNC_PRIO_WARNING = 1,    // FIRST / SECOND events
+  SYNC_PRIO_DB_SERIES = 2,  // db series rows
+  SYNC_PRIO_COUNT = 3
+};
+
+// Upper bound for any batch; callers size their fixed line buffers with this.
+static const int SYNC_BATCH_CAP = 120;
+
+static inline SyncPriority syncPriorityForLevel(const char *level) {
+  if (level && level[0] == 'M') return SYNC_PRIO_MAJOR;
+  return SYNC_PRIO_WARNING;
+}
+
+struct SyncScheduler {
+  // ---- tuning ----
+  uint32_t backoffMinMs = 2000;
+  uint32_t backoffMaxMs = 120000;
+  uint32_t majorBackoffMaxMs = 30000;  // MAJOR never waits longer than the old fixed retry
+  uint32_t livenessWindowMs = 30000;   // a 2xx within this window counts as "internet OK"
+  uint32_t targetRequestMs = 1500;     // aim for batches that finish in about this long
+
+  // ---- state ----
+  uint32_t nextAllowedMs[SYNC_PRIO_COUNT] = { 0, 0, 0 };
+  uint8_t failStreak[SYNC_PRIO_COUNT] = { 0, 0, 0 };
+  uint32_t lastApiOkMs = 0;
+  bool apiOkSeen = false;
+  int rssi = 0;                        // 0 = not measured yet (treated as a good link)
+  float bytesPerMs = 0.0f;             // EMA of measured upload throughput (0 = unknown)
+
+  // ---- counters ----
+  uint32_t okCount = 0;
+  uint32_t failCount = 0;
+  uint32_t probesSkipped = 0;
+
+  static bool reached(uint32_t now, uint32_t deadline) {
+    return (int32_t)(now - deadline) >= 0;
+  }
+
+  bool due(SyncPriority p, uint32_t now) const {
+    return reached(now, nextAllowedMs[p]);
+  }
+
+  uint32_t backoffRemainingMs(SyncPriority p, uint32_t now) const {
+    return due(p, now) ? 0 : (nextAllowedMs[p] - now);
+  }
+
+  // One call per upload that succeeded (okCount); onFailure() counts the failed ones.
+  void onSuccess(SyncPriority p, uint32_t now) {
+    failStreak[p] = 0;
+    nextAllowedMs[p] = now;
+    okCount++;
+    noteApiOk(now);
+  }
+
+  // Exponential backoff with "equal jitter": half the window is fixed, half is random,
+  // so a building's devices spread out instead of retrying in lockstep. Clip uploads pass the
+  // time they started: a 30 s transfer the link dropped has already waited out most of a window.
+  void onFailure(SyncPriority p, uint32_t now, uint32_t rnd) {
+    if (failStreak[p] < 16) failStreak[p]++;
+    const uint32_t cap = p == SYNC_PRIO_MAJOR ? majorBackoffMaxMs : backoffMaxMs;
+    uint32_t win = backoffMinMs;
+    for (uint8_t i = 1; i < failStreak[p] && win < cap; i++) win *= 2;
+    if (win > cap) win = cap;
+    uint32_t half = win / 2;
+    nextAllowedMs[p] = now + half + (rnd % (half + 1));
+    failCount++;
+  }
+
+  // Liveness only: any 2xx, including calls made outside the scheduled uploads.
+  void noteApiOk(uint32_t now) {
+    lastApiOkMs = now;
+    apiOkSeen = true;
+  }
+
+  bool livenessFresh(uint32_t now) const {
+    return apiOkSeen && (now - lastApiOkMs) < livenessWindowMs;
+  }
+
+  void noteTransfer(uint32_t bytes, uint32_t elapsedMs) {
+    if (elapsedMs == 0) elapsedMs = 1;
+    float sample = (float)bytes / (float)elapsedMs;
+    bytesPerMs = (bytesPerMs <= 0.0f) ? sample : (bytesPerMs + 0.25f * (sample - bytesPerMs));
+  }
+
+  // Batch size from link quality: RSSI sets a ceiling, measured throughput narrows it.
+  int batchSize(SyncPriority p, int itemBytes, int cap) const {
+    int rssiCap;
+    if (rssi >= -60) rssiCap = cap;
+    else if (rssi >= -70) rssiCap = cap / 2;
+    else if (rssi >= -80) rssiCap = cap / 4;
+    else rssiCap = cap / 8;
+    if (rssiCap < 1) rssiCap = 1;
+
+    int n = rssiCap;
+    if (bytesPerMs > 0.0f && itemBytes > 0) {
+      int tp = (int)((bytesPerMs * (float)targetRequestMs) / (float)itemBytes);
+      if (tp < n) n = tp;
+    }
+    // Shrink further while a class keeps failing.
+    n >>= (failStreak[p] > 3 ? 3 : failStreak[p]);
+    if (n < 1) n = 1;
+    if (n > cap) n = cap;
+    return n;
+  }
+};
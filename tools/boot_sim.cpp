@@ -0,0 +1,252 @@
+// Host model of the firmware boot: the old sequential setup() against the staged boot
+// (boot_stages.h), on a virtual millisecond clock.
+//
+// Stage costs are estimates from the driver timeouts and the firmware's own waits:
+//   Serial settle + NVS settings   215 ms     LED PWM 3 ms, I2S driver 12 ms
+//   SD mount 120 ms (a missing card: 2 x 300 ms timeouts), db ring 35 ms, storage manager 80 ms,
+//   first-boot SPI benchmark 4200 ms
+//   RTC probe 3 ms (absent: 50 ms I2C timeout), wait for the seconds edge 0-1000 ms
+//   Wi-Fi radio + setup AP 300 ms, STA begin 3 ms, server.begin 2 ms, configTime 1 ms
+//   MP3 module power-up 8000 ms; first dB frame one DMA buffer (16 ms) after the loop starts
+// The staged boot runs SD, RTC and Wi-Fi as tasks on core 0; they spend nearly all of that time
+// waiting on their bus or the Wi-Fi driver, so the model lets them overlap fully. Loop-side stages
+// start on the boot job's 20 ms tick once their dependencies are ready.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. boot_sim.cpp -o boot_sim
+//
+// Usage:
+//   boot_sim selftest        dependency, TTFF and history checks (exit status 1 on failure)
+//   boot_sim bench           time to first dB frame and to a complete boot, old vs staged
+//   boot_sim profile [n]     per-stage start/ready for scenario n, as /status reports it
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "boot_stages.h"
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+struct Scenario {
+  const char *name;
+  bool sdCard;
+  bool sdTuned;        // false: first boot with this card, the benchmark runs
+  bool rtc;
+  uint32_t rtcEdgeMs;  // wait for the DS3231 seconds register to tick
+};
+
+static const Scenario SCENARIOS[] = {
+  { "warm boot", true, true, true, 520 },
+  { "warm boot, late RTC edge", true, true, true, 1000 },
+  { "first boot with a card (bench)", true, false, true, 520 },
+  { "no SD card", false, true, true, 520 },
+  { "no RTC", true, true, false, 0 },
+};
+static const int SCENARIO_COUNT = (int)(sizeof(SCENARIOS) / sizeof(SCENARIOS[0]));
+
+static const uint32_t PREAMBLE_MS = 215;
+static const uint32_t LEDS_MS = 3;
+static const uint32_t I2S_MS = 12;
+static const uint32_t FRAME_MS = 16;
+static const uint32_t ROUTES_MS = 6;   // route table, MP3 UART, loop jobs, task creation
+static const uint32_t WIFI_MS = 300;
+static const uint32_t MP3_WAIT_MS = 8000;
+static const uint32_t BOOT_JOB_MS = 20;
+
+static uint32_t sdMs(const Scenario &sc) {
+  if (!sc.sdCard) return sc.sdTuned ? 600 : 300;   // tuned clock fails, then the safe clock
+  return 4 + 120 + 35 + (sc.sdTuned ? 0 : 4200) + 80;
+}
+
+static uint32_t rtcMs(const Scenario &sc) { return sc.rtc ? 3 + 2 + sc.rtcEdgeMs : 50; }
+
+struct BootOut {
+  uint32_t ttffMs;
+  uint32_t completeMs;
+  BootStages stages;
+};
+
+// setup() before this change: SD, settings, LEDs, RTC, Wi-Fi, routes, NTP, the 8 s MP3 wait,
+// then I2S. Every stage is timed like the staged boot so the profiles compare.
+static BootOut bootSequential(const Scenario &sc) {
+  BootOut o = {};
+  BootStages &b = o.stages;
+  uint32_t t = PREAMBLE_MS;
+  auto run = [&](BootStage s, uint32_t ms, bool ok) {
+    b.begin(s, t);
+    t += ms;
+    b.finish(s, t, ok);
+  };
+  run(BOOT_SD, sdMs(sc), sc.sdCard);
+  run(BOOT_LEDS, LEDS_MS, true);
+  run(BOOT_RTC, rtcMs(sc), sc.rtc);
+  run(BOOT_WIFI, WIFI_MS, true);
+  run(BOOT_STA, 3, true);
+  t += ROUTES_MS;
+  run(BOOT_HTTP, 2, true);
+  run(BOOT_NTP, 1, true);
+  b.begin(BOOT_MP3, t);
+  t += MP3_WAIT_MS;
+  b.finish(BOOT_MP3, t, true);
+  run(BOOT_I2S, I2S_MS, true);
+  b.noteFirstFrame(t + FRAME_MS);
+  o.ttffMs = b.firstFrameMs;
+  o.completeMs = b.completeMs;
+  return o;
+}
+
+static BootOut bootStaged(const Scenario &sc) {
+  BootOut o = {};
+  BootStages &b = o.stages;
+  b.need(BOOT_STA, BOOT_WIFI);
+  b.need(BOOT_STA, BOOT_RTC);
+  b.need(BOOT_HTTP, BOOT_WIFI);
+  b.need(BOOT_NTP, BOOT_WIFI);
+
+  uint32_t t = PREAMBLE_MS;
+  b.begin(BOOT_LEDS, t);
+  t += LEDS_MS;
+  b.finish(BOOT_LEDS, t, true);
+  b.begin(BOOT_I2S, t);
+  t += I2S_MS;
+  b.finish(BOOT_I2S, t, true);
+
+  // Tasks: one stage each, started back to back.
+  struct Task {
+    BootStage stage;
+    uint32_t startMs;
+    uint32_t durMs;
+    bool ok;
+  } tasks[3] = {
+    { BOOT_SD, t + 1, sdMs(sc), sc.sdCard },
+    { BOOT_RTC, t + 2, rtcMs(sc), sc.rtc },
+    { BOOT_WIFI, t + 3, WIFI_MS, true },
+  };
+  const uint32_t loopStart = t + ROUTES_MS;
+  b.begin(BOOT_MP3, loopStart - 1);
+  b.noteFirstFrame(loopStart + FRAME_MS);
+
+  for (uint32_t now = t; now < 20000 && !b.complete(); now++) {
+    for (Task &k : tasks) {
+      if (now == k.startMs) b.begin(k.stage, now);
+      if (now == k.startMs + k.durMs) b.finish(k.stage, now, k.ok);
+    }
+    if (now < loopStart || (now - loopStart) % BOOT_JOB_MS != 0) continue;
+    // jobBootStages()
+    if (!b.st[BOOT_STA].started && b.depsReady(BOOT_STA)) {
+      b.begin(BOOT_STA, now);
+      b.finish(BOOT_STA, now + 3, true);
+    }
+    if (!b.st[BOOT_HTTP].started && b.depsReady(BOOT_HTTP)) {
+      b.begin(BOOT_HTTP, now);
+      b.finish(BOOT_HTTP, now + 2, true);
+    }
+    if (!b.st[BOOT_NTP].started && b.depsReady(BOOT_NTP)) {
+      b.begin(BOOT_NTP, now);
+      b.finish(BOOT_NTP, now + 1, true);
+    }
+    if (!b.ready(BOOT_MP3) && now >= MP3_WAIT_MS) b.finish(BOOT_MP3, now, true);
+  }
+  o.ttffMs = b.firstFrameMs;
+  o.completeMs = b.completeMs;
+  return o;
+}
+
+static void printProfile(const BootOut &o) {
+  printf("  %-6s %9s %9s %8s %4s\n", "stage", "start_ms", "ready_ms", "took", "ok");
+  for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+    const BootStageInfo &s = o.stages.st[i];
+    printf("  %-6s %9u %9u %8u %4s\n", BOOT_STAGE_NAMES[i], s.startMs, s.readyMs, s.readyMs - s.startMs, s.ok ? "yes" : "no");
+  }
+  printf("  first dB frame %u ms, complete %u ms\n", o.ttffMs, o.completeMs);
+}
+
+static void bench(bool check) {
+  printf("\nms since app start; \"sta\" = station connect started, \"web\" = server.begin()\n");
+  printf("  %-32s %8s %8s %9s %9s %6s %6s\n", "scenario", "old ttff", "new ttff", "old done", "new done", "sta", "web");
+  for (const Scenario &sc : SCENARIOS) {
+    const BootOut o = bootSequential(sc);
+    const BootOut n = bootStaged(sc);
+    printf("  %-32s %8u %8u %9u %9u %6u %6u\n", sc.name, o.ttffMs, n.ttffMs, o.completeMs, n.completeMs,
+           n.stages.st[BOOT_STA].startMs, n.stages.st[BOOT_HTTP].startMs);
+    if (!check) continue;
+    const BootStages &b = n.stages;
+    char what[200];
+    snprintf(what, sizeof(what), "%s: first dB frame at %u ms (old %u ms)", sc.name, n.ttffMs, o.ttffMs);
+    expect(n.ttffMs < 1000 && o.ttffMs > MP3_WAIT_MS, what);
+    snprintf(what, sizeof(what), "%s: loop-side stages wait for their dependencies", sc.name);
+    expect(b.st[BOOT_STA].startMs >= std::max(b.st[BOOT_WIFI].readyMs, b.st[BOOT_RTC].readyMs) &&
+               b.st[BOOT_HTTP].startMs >= b.st[BOOT_WIFI].readyMs && b.st[BOOT_NTP].startMs >= b.st[BOOT_WIFI].readyMs &&
+               b.st[BOOT_MP3].readyMs >= MP3_WAIT_MS,
+           what);
+    snprintf(what, sizeof(what), "%s: complete no later than the old boot, sd ok=%d rtc ok=%d", sc.name, b.st[BOOT_SD].ok,
+             b.st[BOOT_RTC].ok);
+    expect(b.complete() && n.completeMs <= o.completeMs && b.st[BOOT_SD].ok == sc.sdCard && b.st[BOOT_RTC].ok == sc.rtc, what);
+  }
+}
+
+static void stageChecks() {
+  BootStages b;
+  b.need(BOOT_STA, BOOT_WIFI);
+  b.need(BOOT_STA, BOOT_RTC);
+  expect(!b.depsReady(BOOT_STA) && b.depsReady(BOOT_SD), "stage without deps may start at once");
+  b.finish(BOOT_WIFI, 300, true);
+  expect(!b.depsReady(BOOT_STA), "one of two deps is not enough");
+  b.finish(BOOT_RTC, 800, false);
+  expect(b.depsReady(BOOT_STA) && b.ready(BOOT_RTC) && !b.st[BOOT_RTC].ok, "a failed stage is still ready");
+  expect(b.st[BOOT_RTC].startMs == 800 && b.tookMs(BOOT_RTC) == 0, "finish() without begin() starts the stage there");
+
+  for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+    if (!b.ready((BootStage)i)) b.finish((BootStage)i, 1000 + i, true);
+  }
+  expect(b.complete() && b.completeMs == 1000 + BOOT_STAGE_COUNT - 1, "complete when the last stage finishes");
+  b.noteFirstFrame(250);
+  b.noteFirstFrame(400);
+  expect(b.firstFrameMs == 250, "first frame keeps the first time");
+
+  BootHistory h;
+  memset(&h, 0xA5, sizeof(h));   // whatever NVS returned for a missing or foreign blob
+  h.add(300);
+  expect(h.valid() && h.count == 1 && h.boots == 1 && h.maxMs() == 300, "invalid history resets before the first add");
+  for (uint32_t i = 0; i < 10; i++) h.add(200 + i * 10);
+  // Last 8 of 200..290: 220..290.
+  expect(h.count == BOOT_HISTORY_LEN && h.boots == 11 && h.maxMs() == 290 && h.avgMs() == 255,
+         "history keeps the last 8 boots");
+  h.add(100000);
+  expect(h.maxMs() == 0xFFFF, "ttff saturates at 65535 ms");
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) {
+    stageChecks();
+    bench(true);
+    return fails ? 1 : 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "bench")) {
+    bench(false);
+    return 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "profile")) {
+    const int i = argc >= 3 ? atoi(argv[2]) : 0;
+    if (i < 0 || i >= SCENARIO_COUNT) {
+      fprintf(stderr, "scenario 0..%d\n", SCENARIO_COUNT - 1);
+      return 2;
+    }
+    printf("%s, old boot:\n", SCENARIOS[i].name);
+    printProfile(bootSequential(SCENARIOS[i]));
+    printf("%s, staged boot:\n", SCENARIOS[i].name);
+    printProfile(bootStaged(SCENARIOS[i]));
+    return 0;
+  }
+  fprintf(stderr, "usage: boot_sim selftest | bench | profile [n]\n");
+  return 2;
+}
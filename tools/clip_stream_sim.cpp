@@ -0,0 +1,453 @@
+// Host measurement of how soon a MAJOR clip is available in Storage (clip_stream.h).
+//
+// A local Storage stand-in (HTTP/1.1 on 127.0.0.1, chunked or Content-Length PUTs, uplink rate
+// and round trip emulated on its side) receives the same 5 s clip two ways:
+//   stream   clipStreamRun() sends it while a recorder thread produces it in real time (32 KB/s),
+//            after a TLS-like connect delay
+//   sd       the old path: the clip is on SD when recording ends, then the sync reads it back over
+//            SPI and PUTs it with Content-Length
+// Time-to-available is measured from the last captured sample to the 2xx response.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -pthread -I.. clip_stream_sim.cpp -o clip_stream_sim
+//
+// Usage:
+//   clip_stream_sim [clip_s] [sd_kbps]   time-to-available on a few uplinks (default 5 s, 90 KB/s)
+//   clip_stream_sim selftest             byte-exact delivery, chunked framing, failures (server
+//                                        closing mid-clip, HTTP 500, refused connect, recorder
+//                                        abort) leaving the clip intact for the SD fallback
+//                                        (exit status 1 on failure)
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "clip_stream.h"
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+static const auto T0 = std::chrono::steady_clock::now();
+
+static uint32_t nowMs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - T0).count();
+}
+
+static void sleepMs(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// ----------------------------------------------------------------------------------------------
+// Storage stand-in
+
+enum StandInFail { SI_OK, SI_CLOSE_MID, SI_HTTP_500 };
+
+struct StandIn {
+  int listenFd = -1;
+  uint16_t port = 0;
+  uint32_t uplinkKBps = 0;   // 0 = unlimited
+  uint32_t rttMs = 0;
+  StandInFail failMode = SI_OK;
+  size_t closeAfter = 0;
+
+  // Last request
+  std::string method, path;
+  bool chunked = false, upsert = false;
+  size_t contentLength = 0;
+  std::vector<uint8_t> body;
+  bool complete = false;
+  std::thread th;
+
+  bool start() {
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listenFd, (sockaddr *)&a, sizeof(a)) != 0 || listen(listenFd, 4) != 0) return false;
+    socklen_t al = sizeof(a);
+    getsockname(listenFd, (sockaddr *)&a, &al);
+    port = ntohs(a.sin_port);
+    th = std::thread([this] { serveOne(); });
+    return true;
+  }
+
+  void join() {
+    if (th.joinable()) th.join();
+    if (listenFd >= 0) close(listenFd);
+    listenFd = -1;
+  }
+
+  // Reads with the uplink rate applied, so the client's writes back up the way a slow link would.
+  struct Reader {
+    StandIn *si;
+    int fd;
+    uint8_t buf[1024];
+    size_t have = 0, pos = 0;
+    uint64_t taken = 0;
+    uint32_t startMs = nowMs();
+    bool fill() {
+      if (si->uplinkKBps) {
+        const uint32_t due = startMs + (uint32_t)(taken / si->uplinkKBps);
+        const uint32_t now = nowMs();
+        if (due > now) sleepMs(due - now);
+      }
+      ssize_t r = recv(fd, buf, sizeof(buf), 0);
+      if (r <= 0) return false;
+      have = (size_t)r;
+      pos = 0;
+      taken += (uint64_t)r;
+      return true;
+    }
+    int get() {
+      if (pos >= have && !fill()) return -1;
+      return buf[pos++];
+    }
+    bool line(std::string &out) {
+      out.clear();
+      for (;;) {
+        int c = get();
+        if (c < 0) return false;
+        if (c == '\n') break;
+        if (c != '\r') out += (char)c;
+      }
+      return true;
+    }
+  };
+
+  void serveOne() {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) return;
+    int rcv = 8192;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcv, sizeof(rcv));
+    Reader r{ this, fd, {} };
+    std::string l;
+    if (r.line(l)) {
+      size_t sp = l.find(' '), sp2 = l.find(' ', sp + 1);
+      method = l.substr(0, sp);
+      path = l.substr(sp + 1, sp2 - sp - 1);
+      while (r.line(l) && !l.empty()) {
+        std::string k = l.substr(0, l.find(':'));
+        for (auto &ch : k) ch = (char)tolower(ch);
+        std::string v = l.substr(l.find(':') + 1);
+        while (!v.empty() && v[0] == ' ') v.erase(0, 1);
+        if (k == "transfer-encoding" && v == "chunked") chunked = true;
+        if (k == "x-upsert" && v == "true") upsert = true;
+        if (k == "content-length") contentLength = (size_t)strtoul(v.c_str(), nullptr, 10);
+      }
+      bool ok = true;
+      if (chunked) {
+        for (;;) {
+          if (!r.line(l)) {
+            ok = false;
+            break;
+          }
+          size_t n = strtoul(l.c_str(), nullptr, 16);
+          if (n == 0) {
+            r.line(l);
+            break;
+          }
+          for (size_t i = 0; i < n && ok; i++) {
+            int c = r.get();
+            if (c < 0) ok = false;
+            else body.push_back((uint8_t)c);
+            if (failMode == SI_CLOSE_MID && body.size() >= closeAfter) ok = false;
+          }
+          if (!ok || !r.line(l) || !l.empty()) {
+            ok = false;
+            break;
+          }
+        }
+      } else {
+        for (size_t i = 0; i < contentLength && ok; i++) {
+          int c = r.get();
+          if (c < 0) ok = false;
+          else body.push_back((uint8_t)c);
+          if (failMode == SI_CLOSE_MID && body.size() >= closeAfter) ok = false;
+        }
+      }
+      if (ok) {
+        sleepMs(rttMs / 2);
+        complete = failMode == SI_OK;
+        const char *resp = failMode == SI_HTTP_500 ? "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 2\r\n\r\n{}"
+                                                   : "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n{}";
+        send(fd, resp, strlen(resp), MSG_NOSIGNAL);
+      }
+    }
+    shutdown(fd, SHUT_RDWR);
+    close(fd);
+  }
+};
+
+// Loopback TCP with the TLS handshake and half the round trip added to connect.
+struct PosixConn {
+  uint16_t port = 0;
+  uint32_t handshakeMs = 0;
+  int fd = -1;
+
+  bool connect(const char *, uint16_t) {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    a.sin_port = htons(port);
+    if (::connect(fd, (sockaddr *)&a, sizeof(a)) != 0) {
+      close(fd);
+      fd = -1;
+      return false;
+    }
+    int snd = 8192;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &snd, sizeof(snd));
+    sleepMs(handshakeMs);
+    return true;
+  }
+  size_t write(const uint8_t *p, size_t n) {
+    ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+    return w > 0 ? (size_t)w : 0;
+  }
+  int read(uint8_t *p, size_t n) {
+    ssize_t r = recv(fd, p, n, MSG_DONTWAIT);
+    if (r > 0) return (int)r;
+    if (r == 0) return -1;
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+  }
+  void stop() {
+    if (fd >= 0) close(fd);
+    fd = -1;
+  }
+};
+
+static std::atomic<int> liveChunks{ 0 };
+static int allocFailAt = -1;   // fail the n-th allocation (test)
+
+static void *clipAlloc(size_t n) {
+  if (allocFailAt == 0) {
+    allocFailAt = -1;
+    return nullptr;
+  }
+  if (allocFailAt > 0) allocFailAt--;
+  liveChunks++;
+  return malloc(n);
+}
+
+static void clipFree(void *p) {
+  liveChunks--;
+  free(p);
+}
+
+// ----------------------------------------------------------------------------------------------
+// Scenarios
+
+static std::vector<uint8_t> makeClip(uint32_t seconds) {
+  const uint32_t dataBytes = 16000 * 2 * seconds;
+  std::vector<uint8_t> wav(CLIP_WAV_HEADER_BYTES + dataBytes);
+  clipWavHeader(wav.data(), 16000, 16, 1, dataBytes);
+  uint32_t x = 12345;
+  for (size_t i = CLIP_WAV_HEADER_BYTES; i < wav.size(); i++) {
+    x = x * 1664525u + 1013904223u;
+    wav[i] = (uint8_t)(x >> 24);
+  }
+  return wav;
+}
+
+struct Link {
+  const char *name;
+  uint32_t uplinkKBps;
+  uint32_t rttMs;
+  uint32_t handshakeMs;
+};
+
+struct StreamResult {
+  uint8_t state = CLIP_IDLE;
+  int httpCode = 0;
+  int32_t ttaMs = -1;
+  bool bytesMatch = false;
+  bool bufferIntact = false;
+  bool chunked = false, upsert = false;
+  char error[24] = "";
+};
+
+// Records `clip` in real time (one 512-byte DMA buffer every 16 ms) while streaming it.
+static StreamResult runStream(const std::vector<uint8_t> &clip, const Link &link, StandInFail failMode = SI_OK,
+                              bool serverUp = true, size_t abortAt = 0) {
+  StandIn si;
+  si.uplinkKBps = link.uplinkKBps;
+  si.rttMs = link.rttMs;
+  si.failMode = failMode;
+  si.closeAfter = clip.size() / 2;
+  uint16_t port = 1;
+  if (serverUp) {
+    si.start();
+    port = si.port;
+  }
+
+  static ClipUpload u;
+  u.total = clip.size();
+  u.captured = 0;
+  u.abort = 0;
+  u.captureEndMs = 0;
+  u.setState(CLIP_STREAMING);
+  snprintf(u.host, sizeof(u.host), "localhost");
+  snprintf(u.path, sizeof(u.path), "/storage/v1/object/recordings/esp32_noise_01/rec_test.wav");
+  u.apiKey = "test-key";
+  StreamResult res;
+  if (!u.buf.reserve(u.total, clipAlloc, clipFree)) return res;
+
+  PosixConn conn;
+  conn.port = port;
+  conn.handshakeMs = link.handshakeMs + link.rttMs / 2;
+  std::thread up([&] { clipStreamRun(u, conn, nowMs, sleepMs, 3000); });
+
+  const size_t dma = 512;
+  for (size_t off = 0; off < clip.size(); off += dma) {
+    if (abortAt && off >= abortAt) {
+      __atomic_store_n(&u.abort, 1, __ATOMIC_RELEASE);
+      break;
+    }
+    sleepMs(16);
+    const size_t n = std::min(dma, clip.size() - off);
+    u.buf.append(clip.data() + off, n);
+    if (off + n == clip.size()) u.captureEndMs = nowMs();
+    u.publish(u.buf.len);
+  }
+  up.join();
+  if (serverUp) si.join();
+
+  res.state = u.getState();
+  res.httpCode = u.httpCode;
+  res.ttaMs = u.captureEndMs ? (int32_t)(u.doneMs - u.captureEndMs) : -1;
+  res.bytesMatch = si.body == clip;
+  res.bufferIntact = u.buf.len == clip.size();
+  for (size_t i = 0; res.bufferIntact && i < clip.size(); i += CLIP_CHUNK_BYTES) {
+    size_t n = clip.size() - i;
+    const uint8_t *p = u.buf.span(i, n);
+    if (memcmp(p, clip.data() + i, n) != 0) res.bufferIntact = false;
+  }
+  res.chunked = si.chunked;
+  res.upsert = si.upsert;
+  snprintf(res.error, sizeof(res.error), "%s", u.error);
+  u.buf.clear();
+  return res;
+}
+
+// The old path from the end of recording: read the file back over SPI in 1436-byte pieces (what
+// HTTPClient pulls from a File per TCP segment) and PUT it with Content-Length.
+static int32_t runSdPath(const std::vector<uint8_t> &clip, const Link &link, uint32_t sdKBps) {
+  StandIn si;
+  si.uplinkKBps = link.uplinkKBps;
+  si.rttMs = link.rttMs;
+  si.start();
+  const uint32_t t0 = nowMs();
+  PosixConn c;
+  c.port = si.port;
+  c.handshakeMs = link.handshakeMs + link.rttMs / 2;
+  int32_t tta = -1;
+  if (c.connect("localhost", 443)) {
+    char head[256];
+    int n = snprintf(head, sizeof(head), "PUT /storage/v1/object/recordings/x.wav HTTP/1.1\r\nHost: localhost\r\nx-upsert: true\r\n"
+                     "Content-Type: audio/wav\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", clip.size());
+    clipWriteAll(c, (const uint8_t *)head, (size_t)n);
+    const uint32_t readFrom = nowMs();
+    uint64_t readBytes = 0;
+    for (size_t off = 0; off < clip.size(); off += 1436) {
+      const size_t k = std::min((size_t)1436, clip.size() - off);
+      readBytes += k;
+      const uint32_t due = readFrom + (uint32_t)(readBytes / sdKBps);
+      const uint32_t now = nowMs();
+      if (due > now) sleepMs(due - now);
+      clipWriteAll(c, clip.data() + off, k);
+    }
+    uint8_t ch;
+    for (;;) {
+      int r = c.read(&ch, 1);
+      if (r != 0) break;
+      sleepMs(1);
+    }
+    tta = (int32_t)(nowMs() - t0);
+    c.stop();
+  }
+  si.join();
+  return tta;
+}
+
+static const Link LINKS[] = {
+  { "good wifi (1 MB/s, 40 ms rtt)", 1000, 40, 600 },
+  { "fair wifi (100 KB/s, 80 ms rtt)", 100, 80, 800 },
+  { "weak (40 KB/s, 150 ms rtt)", 40, 150, 1200 },
+  { "below audio rate (24 KB/s, 150 ms)", 24, 150, 1200 },
+};
+
+static int bench(uint32_t clipS, uint32_t sdKBps) {
+  const std::vector<uint8_t> clip = makeClip(clipS);
+  printf("clip %u s (%zu bytes), SD read %u KB/s; time-to-available after the last sample:\n", clipS, clip.size(), sdKBps);
+  printf("  %-34s %10s %10s\n", "uplink", "stream ms", "sd ms");
+  for (const Link &l : LINKS) {
+    StreamResult s = runStream(clip, l);
+    int32_t sd = runSdPath(clip, l, sdKBps);
+    printf("  %-34s %10d %10d%s\n", l.name, (int)s.ttaMs, (int)sd, s.state == CLIP_STORED && s.bytesMatch ? "" : "  (stream FAILED)");
+  }
+  return 0;
+}
+
+static int selftest() {
+  const std::vector<uint8_t> clip = makeClip(1);
+  const Link lan = { "lan", 0, 10, 50 };
+
+  StreamResult s = runStream(clip, lan);
+  expect(s.state == CLIP_STORED && s.httpCode == 200 && s.bytesMatch, "streamed clip arrives byte for byte");
+  expect(s.chunked && s.upsert, "sent chunked with x-upsert");
+  expect(s.ttaMs >= 0 && s.ttaMs < 200, "available within a round trip of the last sample");
+
+  const Link weak = LINKS[2];
+  StreamResult w = runStream(clip, weak);
+  int32_t sd = runSdPath(clip, weak, 90);
+  char what[120];
+  snprintf(what, sizeof(what), "weak uplink: stream %d ms beats the SD round trip %d ms", (int)w.ttaMs, (int)sd);
+  expect(w.state == CLIP_STORED && w.bytesMatch && w.ttaMs < sd, what);
+
+  StreamResult mid = runStream(clip, lan, SI_CLOSE_MID);
+  expect(mid.state == CLIP_FAILED && mid.bufferIntact, "server closing mid-clip fails, clip intact for the SD copy");
+  StreamResult e500 = runStream(clip, lan, SI_HTTP_500);
+  expect(e500.state == CLIP_FAILED && e500.httpCode == 500 && e500.bufferIntact, "HTTP 500 fails, clip intact");
+  StreamResult refused = runStream(clip, lan, SI_OK, false);
+  expect(refused.state == CLIP_FAILED && !strcmp(refused.error, "connect") && refused.bufferIntact, "refused connect fails, clip intact");
+  StreamResult aborted = runStream(clip, lan, SI_OK, true, clip.size() / 3);
+  expect(aborted.state == CLIP_FAILED && !strcmp(aborted.error, "aborted"), "recorder abort ends the upload");
+
+  ClipBuffer b;
+  allocFailAt = 3;
+  const bool got = b.reserve(100000, clipAlloc, clipFree);
+  expect(!got && b.chunks == 0 && liveChunks == 0, "a failed reserve frees what it took");
+  expect(!b.reserve(CLIP_MAX_CHUNKS * CLIP_CHUNK_BYTES + 1, clipAlloc, clipFree) && liveChunks == 0, "oversized clip refused");
+  expect(liveChunks == 0, "no chunk leaked");
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  const uint32_t clipS = argc > 1 ? (uint32_t)atoi(argv[1]) : 5;
+  const uint32_t sdKBps = argc > 2 ? (uint32_t)atoi(argv[2]) : 90;
+  if (clipS < 1 || clipS > 5 || sdKBps < 1) {
+    fprintf(stderr, "usage: clip_stream_sim [clip_s 1..5] [sd_kbps]\n");
+    return 2;
+  }
+  return bench(clipS, sdKBps);
+}
@@ -0,0 +1,576 @@
+// Host benchmark and test for the hourly compressed db-series blobs (db_blob.h).
+//
+// Traces are the firmware's /db_series.txt format (ts_ms|db10[|zone], one sample per line), so a
+// card pulled from a device can be measured directly; without files a synthetic school week is
+// generated the way the sketch logs it (100 ms sampling, 1 dB change threshold, 8 s heartbeat,
+// a few ms of loop jitter on the timestamps). Each trace is cut into hours with the same
+// dbBlobEncodeHour() the firmware runs, then compared against the 10-byte ring records and the
+// noise_db_series JSON rows the row uploader sends, plus Gorilla's float XOR value coding for the
+// same stream.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. db_blob_bench.cpp -o db_blob_bench
+//
+// Usage:
+//   db_blob_bench [trace.txt ...]   bytes per sample, ratios and encode/decode throughput
+//   db_blob_bench selftest          round trips (random, out of order, extremes), corruption
+//                                   detection, and hour-by-hour upload against an in-memory
+//                                   Storage stand-in that fails uploads and index inserts at
+//                                   random (exit status 1 on failure)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "db_blob.h"
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+static volatile int64_t benchSink;   // keeps the decode loop from being optimised away
+
+static double nowSec() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct VecSink {
+  std::vector<uint8_t> v;
+  bool failWrites = false;
+  bool write(const uint8_t *p, size_t n) {
+    if (failWrites) return false;
+    v.insert(v.end(), p, p + n);
+    return true;
+  }
+};
+
+// Record stream with a committed position, like the ring and its persisted tail.
+struct VecSrc {
+  const std::vector<DbSample> *s = nullptr;
+  size_t pos = 0;
+  bool peek(DbSample &out) {
+    if (pos >= s->size()) return false;
+    out = (*s)[pos];
+    return true;
+  }
+  void pop() { pos++; }
+};
+
+// ----------------------------------------------------------------------------------------------
+// Traces
+
+static const uint64_t START_EPOCH_MS = 1709510400000ULL;   // Monday 2024-03-04 00:00 UTC
+static const int LOCAL_OFFSET_SEC = 7 * 3600;
+
+// Change-based logging as the sketch does it: a sample every 100 ms (late by a few ms now and
+// then), written when it moved 1 dB or 8 s passed. Zones share the room's level with an offset.
+static std::vector<DbSample> syntheticTrace(int days, int zones, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<DbSample> out;
+  int level[DB_BLOB_MAX_ZONES] = { 450, 430 };
+  int last[DB_BLOB_MAX_ZONES] = { -99999, -99999 };
+  uint64_t lastTs[DB_BLOB_MAX_ZONES] = { 0, 0 };
+  const uint64_t ticks = (uint64_t)days * 864000ULL;
+  for (uint64_t t = 0; t < ticks; t++) {
+    const uint64_t nominal = START_EPOCH_MS + t * 100ULL;
+    const uint32_t localSec = (uint32_t)((nominal / 1000ULL + LOCAL_OFFSET_SEC) % 86400ULL);
+    const int weekday = (int)(((nominal / 1000ULL + LOCAL_OFFSET_SEC) / 86400ULL + 4) % 7);
+    const bool school = weekday >= 1 && weekday <= 5 && localSec >= 7 * 3600 && localSec < 16 * 3600;
+    const uint32_t r = rng();
+    const uint64_t ts = nominal + ((r & 7) == 0 ? (r >> 3) % 12 : 0);
+    for (int z = 0; z < zones; z++) {
+      const int target = (school ? 520 : 360) - z * 30;
+      const int step = school ? 9 : 3;
+      level[z] += (int)(rng() % (2 * step + 1)) - step + (target - level[z]) / 40;
+      if (school && rng() % 3000 == 0) level[z] += 150 + (int)(rng() % 200);   // a shout
+      const int db10 = level[z];
+      if (db10 - last[z] >= 10 || last[z] - db10 >= 10 || ts - lastTs[z] >= 8000) {
+        DbSample s;
+        s.tsMs = ts;
+        s.db10 = (int16_t)db10;
+        s.zone = (uint8_t)z;
+        out.push_back(s);
+        last[z] = db10;
+        lastTs[z] = ts;
+      }
+    }
+  }
+  return out;
+}
+
+static bool loadTrace(const char *path, std::vector<DbSample> &out) {
+  FILE *f = fopen(path, "r");
+  if (!f) return false;
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    char *p = line;
+    unsigned long long ts = strtoull(p, &p, 10);
+    if (*p != '|') continue;
+    long db10 = strtol(p + 1, &p, 10);
+    long zone = (*p == '|') ? strtol(p + 1, &p, 10) : 0;
+    DbSample s;
+    s.tsMs = ts;
+    s.db10 = (int16_t)db10;
+    s.zone = (uint8_t)zone;
+    out.push_back(s);
+  }
+  fclose(f);
+  return true;
+}
+
+// ----------------------------------------------------------------------------------------------
+// Storage stand-in: a bucket with x-upsert PUTs and an index table with merge-duplicates on
+// (device_id, hour_start_ms, ts_first_ms), each failing at a configurable rate.
+
+struct IndexRow {
+  std::string objectPath;
+  DbBlobInfo info;
+};
+
+struct FakeStorage {
+  std::map<std::string, std::vector<uint8_t>> objects;
+  std::map<std::tuple<std::string, uint64_t, uint64_t>, IndexRow> index;
+  std::mt19937 rng{7};
+  int failPct = 0;
+  uint32_t puts = 0, putFails = 0, posts = 0, postFails = 0;
+
+  bool put(const std::string &path, const std::vector<uint8_t> &body) {
+    puts++;
+    if ((int)(rng() % 100) < failPct) {
+      putFails++;
+      return false;
+    }
+    objects[path] = body;
+    return true;
+  }
+  bool postIndex(const std::string &device, const std::string &path, const DbBlobInfo &info) {
+    posts++;
+    if ((int)(rng() % 100) < failPct) {
+      postFails++;
+      return false;
+    }
+    index[std::make_tuple(device, info.hourStartMs, info.firstTsMs)] = IndexRow{ path, info };
+    return true;
+  }
+};
+
+static std::string zoneDevice(uint8_t zone) {
+  return zone ? "esp32_noise_01_z" + std::to_string(zone + 1) : "esp32_noise_01";
+}
+
+// Same object naming as the sketch: <device>/db/<hour_start_ms>_<ts_first_ms>.dbz
+static std::string blobObjectPath(const DbBlobInfo &info) {
+  return zoneDevice(info.zone) + "/db/" + std::to_string(info.hourStartMs) + "_" + std::to_string(info.firstTsMs) + ".dbz";
+}
+
+struct StorageDst {
+  FakeStorage *st = nullptr;
+  VecSink sinks[DB_BLOB_MAX_ZONES];
+  int failOpenPct = 0;
+  std::mt19937 rng{11};
+
+  VecSink *open(uint8_t zone, uint64_t) {
+    if ((int)(rng() % 100) < failOpenPct) return nullptr;
+    sinks[zone].v.clear();
+    return &sinks[zone];
+  }
+  bool store(const DbBlobInfo &info) {
+    const std::string path = blobObjectPath(info);
+    if (!st->put(path, sinks[info.zone].v)) return false;
+    return st->postIndex(zoneDevice(info.zone), path, info);
+  }
+  void discard(uint8_t zone) { sinks[zone].v.clear(); }
+};
+
+struct MemDst {
+  VecSink sinks[DB_BLOB_MAX_ZONES];
+  std::vector<std::vector<uint8_t>> blobs;
+  VecSink *open(uint8_t zone, uint64_t) {
+    sinks[zone].v.clear();
+    return &sinks[zone];
+  }
+  bool store(const DbBlobInfo &info) {
+    blobs.push_back(sinks[info.zone].v);
+    return true;
+  }
+  void discard(uint8_t zone) { sinks[zone].v.clear(); }
+};
+
+// ----------------------------------------------------------------------------------------------
+// Comparison codings
+
+// Gorilla's value coding on db10 / 10 as a float32, in bits (timestamps coded as in the blob).
+struct GorillaValueBits {
+  uint32_t prev = 0;
+  int prevLead = -1, prevTrail = 0;
+  uint64_t bits = 0;
+  bool first = true;
+  void add(int16_t db10) {
+    float f = db10 / 10.0f;
+    uint32_t v;
+    memcpy(&v, &f, 4);
+    if (first) {
+      bits += 32;
+      first = false;
+    } else {
+      uint32_t x = v ^ prev;
+      if (x == 0) {
+        bits += 1;
+      } else {
+        int lead = __builtin_clz(x), trail = __builtin_ctz(x);
+        if (lead > 31) lead = 31;
+        if (prevLead >= 0 && lead >= prevLead && trail >= prevTrail) {
+          bits += 2 + (uint64_t)(32 - prevLead - prevTrail);
+        } else {
+          bits += 2 + 5 + 6 + (uint64_t)(32 - lead - trail);
+          prevLead = lead;
+          prevTrail = trail;
+        }
+      }
+    }
+    prev = v;
+  }
+};
+
+static uint32_t tsBits(int64_t dod) {
+  uint64_t u = dbBlobZigzag(dod);
+  if (u == 0) return 1;
+  if (u < (1u << 7)) return 9;
+  if (u < (1u << 10)) return 13;
+  if (u < (1u << 14)) return 18;
+  return 36;
+}
+
+// Row upload body size: what tryBulkUploadDbRing() posts, 60 rows per request.
+static uint64_t jsonRowBytes(const std::vector<DbSample> &s) {
+  uint64_t bytes = 0;
+  char row[128];
+  for (size_t i = 0; i < s.size(); i++) {
+    if (i % 60 == 0) bytes += 2;   // [ ]
+    else bytes += 1;               // ,
+    bytes += (uint64_t)snprintf(row, sizeof(row), "{\"device_id\":\"%s\",\"ts_ms\":%llu,\"db10\":%d}", zoneDevice(s[i].zone).c_str(),
+                                (unsigned long long)s[i].tsMs, (int)s[i].db10);
+  }
+  return bytes;
+}
+
+// ----------------------------------------------------------------------------------------------
+// Bench
+
+static void bench(const char *name, const std::vector<DbSample> &trace) {
+  if (trace.empty()) {
+    printf("%s: empty\n", name);
+    return;
+  }
+  // Encode the whole trace hour by hour; the last hour counts as closed.
+  auto encodeAll = [&](MemDst &dst) {
+    VecSrc src;
+    src.s = &trace;
+    for (;;) {
+      DbBlobStep r = dbBlobEncodeHour<VecSrc, MemDst, VecSink>(src, dst, UINT64_MAX);
+      if (r != DB_BLOB_STORED) break;
+    }
+  };
+  MemDst dst;
+  encodeAll(dst);
+  uint64_t blobBytes = 0;
+  for (auto &b : dst.blobs) blobBytes += b.size();
+
+  int reps = 0;
+  double t0 = nowSec(), t1 = t0;
+  while (t1 - t0 < 0.5) {
+    MemDst d;
+    encodeAll(d);
+    reps++;
+    t1 = nowSec();
+  }
+  const double encSps = (double)trace.size() * reps / (t1 - t0);
+
+  uint64_t decoded = 0;
+  int64_t sum = 0;
+  t0 = nowSec();
+  t1 = t0;
+  while (t1 - t0 < 0.5) {
+    for (auto &b : dst.blobs) {
+      DbBlobInfo info;
+      dbBlobDecode(b.data(), b.size(), info, [&](uint64_t ts, int16_t v) {
+        sum += (int64_t)ts + v;
+        decoded++;
+      });
+    }
+    t1 = nowSec();
+  }
+  benchSink = sum;
+  const double decSps = (double)decoded / (t1 - t0);
+
+  uint64_t ringBytes = 0;
+  for (auto &s : trace) ringBytes += s.zone ? 11 : 10;
+  const uint64_t jsonBytes = jsonRowBytes(trace);
+
+  // Same stream with Gorilla's value coding, per zone and hour like the blobs.
+  uint64_t gorillaBits = 0;
+  {
+    std::map<std::pair<uint64_t, int>, std::pair<GorillaValueBits, std::pair<uint64_t, int64_t>>> st;
+    for (auto &s : trace) {
+      auto key = std::make_pair(s.tsMs / DB_BLOB_HOUR_MS, (int)s.zone);
+      auto it = st.find(key);
+      if (it == st.end()) {
+        it = st.emplace(key, std::make_pair(GorillaValueBits(), std::make_pair(key.first * DB_BLOB_HOUR_MS, (int64_t)0))).first;
+        gorillaBits += (DB_BLOB_HEADER_BYTES + DB_BLOB_TRAILER_BYTES) * 8;
+      }
+      auto &ts = it->second.second;
+      int64_t delta = (int64_t)(s.tsMs - ts.first);
+      gorillaBits += tsBits(delta - ts.second);
+      ts.first = s.tsMs;
+      ts.second = delta;
+      it->second.first.add(s.db10);
+    }
+    for (auto &e : st) gorillaBits += e.second.first.bits + 7;   // + byte padding
+  }
+
+  const double n = (double)trace.size();
+  printf("%s: %zu samples, %zu blobs (hour x zone)\n", name, trace.size(), dst.blobs.size());
+  printf("  %-24s %10s %10s %10s\n", "coding", "bytes", "B/sample", "vs rows");
+  printf("  %-24s %10llu %10.2f %9.1fx\n", "JSON rows (60/request)", (unsigned long long)jsonBytes, jsonBytes / n, 1.0);
+  printf("  %-24s %10llu %10.2f %9.1fx\n", "ring records", (unsigned long long)ringBytes, ringBytes / n, (double)jsonBytes / ringBytes);
+  printf("  %-24s %10llu %10.2f %9.1fx\n", "Gorilla float XOR", (unsigned long long)(gorillaBits / 8), gorillaBits / 8 / n,
+         (double)jsonBytes / (gorillaBits / 8));
+  printf("  %-24s %10llu %10.2f %9.1fx\n", "DBZ1 blobs", (unsigned long long)blobBytes, blobBytes / n, (double)jsonBytes / blobBytes);
+  printf("  requests: %llu row POSTs -> %zu PUTs + %zu index rows\n", (unsigned long long)((trace.size() + 59) / 60),
+         dst.blobs.size(), dst.blobs.size());
+  printf("  encode %.1f M samples/s (%.1f MB/s of ring records), decode %.1f M samples/s\n", encSps / 1e6,
+         encSps * ((double)ringBytes / n) / 1e6, decSps / 1e6);
+}
+
+// ----------------------------------------------------------------------------------------------
+// Self-test
+
+static bool roundTrip(const std::vector<DbSample> &in, uint64_t hour, std::vector<uint8_t> *blobOut = nullptr) {
+  VecSink sink;
+  DbBlobWriter<VecSink> w;
+  w.begin(&sink, 0, hour);
+  for (auto &s : in) w.add(s.tsMs, s.db10);
+  const DbBlobInfo wi = w.finish();
+  if (!wi.ok || wi.bytes != sink.v.size() || wi.samples != in.size()) return false;
+  DbBlobInfo ri;
+  size_t i = 0;
+  bool same = true;
+  bool ok = dbBlobDecode(sink.v.data(), sink.v.size(), ri, [&](uint64_t ts, int16_t v) {
+    if (i >= in.size() || in[i].tsMs != ts || in[i].db10 != v) same = false;
+    i++;
+  });
+  if (blobOut) *blobOut = sink.v;
+  return ok && same && i == in.size() && ri.samples == wi.samples && ri.crc == wi.crc && ri.firstTsMs == wi.firstTsMs &&
+         ri.lastTsMs == wi.lastTsMs && ri.minDb10 == wi.minDb10 && ri.maxDb10 == wi.maxDb10 && ri.hourStartMs == hour;
+}
+
+static void selftestCodec() {
+  std::mt19937 rng(1);
+  const uint64_t hour = START_EPOCH_MS + 5 * DB_BLOB_HOUR_MS;
+  bool allOk = true;
+  for (int k = 0; k < 400; k++) {
+    std::vector<DbSample> in;
+    uint64_t ts = hour + rng() % 1000;
+    int16_t v = (int16_t)(rng() % 900);
+    const int n = (int)(rng() % 3000);
+    for (int i = 0; i < n; i++) {
+      const uint32_t r = rng();
+      switch (r % 8) {
+        case 0: ts -= rng() % 20000; break;                      // late-stamped, out of order
+        case 1: ts += rng() % 600000; break;                     // gap
+        default: ts += 100 + (r >> 8) % 9; break;
+      }
+      switch ((r >> 3) % 6) {
+        case 0: v = (int16_t)rng(); break;                       // anything an int16 holds
+        case 1: v = (int16_t)(v + (int)(rng() % 121) - 60); break;
+        default: v = (int16_t)(v + (int)(rng() % 21) - 10); break;
+      }
+      DbSample s;
+      s.tsMs = ts;
+      s.db10 = v;
+      in.push_back(s);
+    }
+    if (!roundTrip(in, hour)) allOk = false;
+  }
+  expect(allOk, "400 random blobs (gaps, out of order, full int16 range) decode exactly");
+
+  std::vector<DbSample> extremes;
+  const int16_t vals[] = { 0, -32768, 32767, -1, 1, 32767, -32768, 0 };
+  const uint64_t tss[] = { hour, hour + DB_BLOB_HOUR_MS - 1, hour, hour + 1, hour + 0x3FFFFFFFULL, hour, hour + 1, hour + 2 };
+  for (int i = 0; i < 8; i++) {
+    DbSample s;
+    s.tsMs = tss[i];
+    s.db10 = vals[i];
+    extremes.push_back(s);
+  }
+  std::vector<uint8_t> blob;
+  expect(roundTrip(extremes, hour) && roundTrip({}, hour, &blob), "extreme values and an empty blob round-trip");
+  expect(blob.size() == DB_BLOB_HEADER_BYTES + DB_BLOB_TRAILER_BYTES, "empty blob is header + trailer only");
+  {
+    VecSink sink;
+    DbBlobWriter<VecSink> w;
+    w.begin(&sink, 0, hour);
+    const bool near = w.add(hour + 1000, 1);
+    const bool far = w.add(hour + 0x400000000ULL, 2);
+    expect(near && !far && w.finish().samples == 1, "a sample weeks away from its neighbour is refused");
+  }
+
+  std::vector<DbSample> day = syntheticTrace(1, 1, 3);
+  std::vector<DbSample> nightHour;
+  for (auto &s : day) {
+    if (s.tsMs < START_EPOCH_MS + 19 * DB_BLOB_HOUR_MS && s.tsMs >= START_EPOCH_MS + 18 * DB_BLOB_HOUR_MS) nightHour.push_back(s);
+  }
+  roundTrip(nightHour, START_EPOCH_MS + 18 * DB_BLOB_HOUR_MS, &blob);   // 01:00 local
+  int missed = 0, delivered = 0;
+  for (size_t i = 0; i < blob.size(); i++) {
+    for (int bit = 0; bit < 8; bit++) {
+      std::vector<uint8_t> bad = blob;
+      bad[i] ^= (uint8_t)(1u << bit);
+      DbBlobInfo info;
+      if (dbBlobDecode(bad.data(), bad.size(), info, [&](uint64_t, int16_t) { delivered++; })) missed++;
+    }
+  }
+  expect(missed == 0 && delivered == 0, "every single-bit flip is rejected before any sample is delivered");
+  bool truncOk = true;
+  for (size_t n = 0; n < blob.size(); n += 7) {
+    DbBlobInfo info;
+    if (dbBlobDecode(blob.data(), n, info, [](uint64_t, int16_t) {})) truncOk = false;
+  }
+  expect(truncOk, "truncated blobs are rejected");
+
+  VecSink failing;
+  failing.failWrites = true;
+  DbBlobWriter<VecSink> w;
+  w.begin(&failing, 0, hour);
+  for (auto &s : nightHour) w.add(s.tsMs, s.db10);
+  expect(!w.finish().ok, "a failing sink marks the blob not ok");
+}
+
+// Uploads a trace hour by hour against the stand-in, restarting from the committed position after
+// every failure (as the firmware does from its persisted ring tail), and checks the bucket and
+// index end up holding each sample exactly once.
+static void selftestStorage(int failPct, const char *label) {
+  std::vector<DbSample> trace = syntheticTrace(2, 2, 5);
+  // A block of late-stamped samples (pre-sync buffer written after the clock synced) in hour 3.
+  const size_t at = trace.size() / 16;
+  std::vector<DbSample> late;
+  for (int i = 0; i < 40; i++) {
+    DbSample s;
+    s.tsMs = trace[at].tsMs - 3 * DB_BLOB_HOUR_MS + (uint64_t)i * 500;
+    s.db10 = (int16_t)(400 + i);
+    s.zone = (uint8_t)(i & 1);
+    late.push_back(s);
+  }
+  trace.insert(trace.begin() + (long)at, late.begin(), late.end());
+  // The trace stops 20 minutes into an hour.
+  const uint64_t lastHour = START_EPOCH_MS + 47 * DB_BLOB_HOUR_MS;
+  while (!trace.empty() && trace.back().tsMs >= lastHour + 20 * 60000ULL) trace.pop_back();
+
+  FakeStorage st;
+  st.failPct = failPct;
+  StorageDst dst;
+  dst.st = &st;
+  dst.failOpenPct = failPct / 4;
+  VecSrc src;
+  src.s = &trace;
+  size_t committed = 0;
+  int stored = 0, failed = 0, steps = 0;
+  DbBlobStep r = DB_BLOB_EMPTY;
+  const uint64_t nowMs = lastHour + 25 * 60000ULL;
+  for (; steps < 100000; steps++) {
+    src.pos = committed;
+    r = dbBlobEncodeHour<VecSrc, StorageDst, VecSink>(src, dst, nowMs);
+    if (r == DB_BLOB_STORED) {
+      committed = src.pos;
+      stored++;
+    } else if (r == DB_BLOB_FAILED) {
+      failed++;
+    } else {
+      break;
+    }
+  }
+  bool openHeld = (r == DB_BLOB_OPEN);
+  for (auto &e : st.index) {
+    if (e.second.info.hourStartMs == lastHour) openHeld = false;
+  }
+  const size_t openSamples = trace.size() - committed;
+
+  // The hour closes once wall time moves past it.
+  for (int k = 0; k < 1000; k++) {
+    src.pos = committed;
+    r = dbBlobEncodeHour<VecSrc, StorageDst, VecSink>(src, dst, lastHour + DB_BLOB_HOUR_MS + 1000);
+    if (r == DB_BLOB_STORED) committed = src.pos;
+    if (r != DB_BLOB_FAILED && r != DB_BLOB_STORED) break;
+    if (r == DB_BLOB_FAILED) failed++;
+  }
+
+  std::multiset<std::tuple<uint64_t, int, int>> want, got;
+  for (auto &s : trace) want.insert(std::make_tuple(s.tsMs, (int)s.zone, (int)s.db10));
+  bool indexOk = st.objects.size() == st.index.size();
+  for (auto &e : st.index) {
+    auto it = st.objects.find(e.second.objectPath);
+    if (it == st.objects.end()) {
+      indexOk = false;
+      continue;
+    }
+    DbBlobInfo info;
+    bool ok = dbBlobDecode(it->second.data(), it->second.size(), info, [&](uint64_t ts, int16_t v) {
+      got.insert(std::make_tuple(ts, (int)info.zone, (int)v));
+    });
+    if (!ok || info.crc != e.second.info.crc || info.bytes != e.second.info.bytes || info.samples != e.second.info.samples ||
+        info.firstTsMs != e.second.info.firstTsMs || info.lastTsMs != e.second.info.lastTsMs ||
+        info.maxDb10 != e.second.info.maxDb10) {
+      indexOk = false;
+    }
+  }
+
+  printf("  %s: %zu samples, %d hours stored in %d steps, %d failed attempts, PUT %u (%u failed), index %u (%u failed), %zu blobs\n",
+         label, trace.size(), stored, steps, failed, st.puts, st.putFails, st.posts, st.postFails, st.objects.size());
+  char what[160];
+  snprintf(what, sizeof(what), "%s: the open hour (%zu samples) waits until it closes", label, openSamples);
+  expect(openHeld && openSamples > 0, what);
+  snprintf(what, sizeof(what), "%s: every sample stored exactly once, nothing left uncommitted", label);
+  expect(got == want && committed == trace.size(), what);
+  snprintf(what, sizeof(what), "%s: one object per index row, rows match their blobs", label);
+  expect(indexOk, what);
+  snprintf(what, sizeof(what), "%s: late-stamped samples get their own blobs", label);
+  expect(st.index.size() == 2 * 48 + 2 + 2, what);
+}
+
+static int selftest() {
+  selftestCodec();
+  selftestStorage(0, "no failures");
+  selftestStorage(30, "30% failures");
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++) {
+      std::vector<DbSample> t;
+      if (!loadTrace(argv[i], t)) {
+        fprintf(stderr, "cannot read %s\n", argv[i]);
+        return 2;
+      }
+      bench(argv[i], t);
+    }
+    return 0;
+  }
+  bench("synthetic week, 1 zone", syntheticTrace(7, 1, 1));
+  bench("synthetic week, 2 zones", syntheticTrace(7, 2, 2));
+  return 0;
+}
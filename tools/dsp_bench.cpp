@@ -0,0 +1,366 @@
+// Host harness for the template DSP pipeline (dsp_pipeline.h).
+//
+// The reference is the chain the firmware ran before the pipeline: zoneSplit() from zone_meter.h,
+// then zoneLevelDb(), the EMA with SMOOTH_ALPHA from loop() and getMovingAverage(), copied here
+// as they were. Signals are synthetic 24-bit words as the INMP441 delivers them (value << 8):
+// tones, white and pink noise, bursts, a DC offset and dropped blocks.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. dsp_bench.cpp -o dsp_bench
+//
+// Usage:
+//   dsp_bench selftest           legacy profile against the old chain block for block, filter
+//                                responses against the analog A-weighting curve, DC removal and
+//                                decimation (exit status 1 on failure)
+//   dsp_bench bench [blocks]     ns per 256-sample block for the old chain and each profile
+//   dsp_bench response           A-weighting design at 16 and 8 kHz against IEC 61672, per third octave
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "dsp_pipeline.h"
+#include "zone_meter.h"
+
+static const int BUFFER_LEN = 256;
+static const double NOISE_FLOOR = 25000;
+static const double SENSITIVITY = 0.5;
+static const double SMOOTH_ALPHA = 0.1;
+static const int AVG_WINDOW = 10;
+static const double RATE = 16000;
+
+static_assert(DspProfileLegacy::blockLen == BUFFER_LEN, "profile block length");
+static_assert(DspDcBlock<16000, 10>::r > 0.995f && DspDcBlock<16000, 10>::r < 0.997f, "DC pole is a compile-time constant");
+static_assert(dspEmaAlpha(256, 16000, 125) > 0.120 && dspEmaAlpha(256, 16000, 125) < 0.121, "EMA alpha is a compile-time constant");
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+// ---------- the old chain ----------
+
+static int zoneLevelDb(double sumSq, int frames, double noiseFloor, double sensitivity) {
+  if (frames <= 0) return 0;
+  double rms = sqrt(sumSq / frames) - noiseFloor;
+  if (rms < 0) rms = 0;
+  return (int)(20.0 * log10(rms + 1) * sensitivity);
+}
+
+struct OldChain {
+  double smoothDb = 0;
+  int avgBuffer[AVG_WINDOW] = {};
+  int avgIndex = 0;
+  bool avgFilled = false;
+
+  int getMovingAverage(int value) {
+    avgBuffer[avgIndex++] = value;
+    if (avgIndex >= AVG_WINDOW) {
+      avgIndex = 0;
+      avgFilled = true;
+    }
+    int sum = 0;
+    int count = avgFilled ? AVG_WINDOW : avgIndex;
+    for (int i = 0; i < count; i++) sum += avgBuffer[i];
+    return sum / count;
+  }
+};
+
+// ---------- signals ----------
+
+struct SignalGen {
+  std::mt19937 rng{ 1234 };
+  std::normal_distribution<double> gauss{ 0.0, 1.0 };
+  double phase = 0;
+  double pink[7] = {};
+  long n = 0;
+
+  static int32_t word(double v) {
+    if (v > 8388607) v = 8388607;
+    if (v < -8388608) v = -8388608;
+    return (int32_t)lround(v) * 256;
+  }
+
+  void tone(int32_t *out, int len, double hz, double amp, double dc = 0) {
+    for (int i = 0; i < len; i++) {
+      out[i] = word(dc + amp * sin(phase));
+      phase += 2 * M_PI * hz / RATE;
+    }
+  }
+
+  void white(int32_t *out, int len, double rms) {
+    for (int i = 0; i < len; i++) out[i] = word(rms * gauss(rng));
+  }
+
+  // Paul Kellet's pink filter; roughly unit RMS for unit white input times 0.11.
+  void pinkNoise(int32_t *out, int len, double rms) {
+    for (int i = 0; i < len; i++) {
+      const double w = gauss(rng);
+      pink[0] = 0.99886 * pink[0] + w * 0.0555179;
+      pink[1] = 0.99332 * pink[1] + w * 0.0750759;
+      pink[2] = 0.96900 * pink[2] + w * 0.1538520;
+      pink[3] = 0.86650 * pink[3] + w * 0.3104856;
+      pink[4] = 0.55000 * pink[4] + w * 0.5329522;
+      pink[5] = -0.7616 * pink[5] - w * 0.0168980;
+      const double p = pink[0] + pink[1] + pink[2] + pink[3] + pink[4] + pink[5] + pink[6] + w * 0.5362;
+      pink[6] = w * 0.115926;
+      out[i] = word(p * 0.11 * rms);
+    }
+  }
+
+  // A mixed stretch: quiet room, speech-like bursts, loud tones, silence; some blocks dropped.
+  // Returns false for a dropped block.
+  bool mixed(int32_t *out, int len) {
+    const long b = n++;
+    const int seg = (int)((b / 150) % 6);
+    switch (seg) {
+      case 0: white(out, len, 60 + 20 * sin(b * 0.01)); break;
+      case 1: pinkNoise(out, len, 4000 * (1 + (b % 40 < 15 ? 2 : 0))); break;
+      case 2: tone(out, len, 440, 9000); break;
+      case 3: memset(out, 0, sizeof(int32_t) * (size_t)len); break;
+      case 4: white(out, len, 200000); break;
+      default: tone(out, len, 2000 + (b % 7) * 300, 50000, 20000); break;
+    }
+    return (b % 97) != 13;
+  }
+};
+
+// ---------- selftest ----------
+
+// Filtered RMS in 24-bit units after the stages settle.
+template <class Stages>
+static double stagesRms(double hz, double amp, double dc = 0, int blocks = 200) {
+  Stages st;
+  SignalGen g;
+  int32_t buf[BUFFER_LEN];
+  double sum = 0;
+  long n = 0;
+  for (int b = 0; b < blocks; b++) {
+    g.tone(buf, BUFFER_LEN, hz, amp, dc);
+    DspMeanSquare ms;
+    for (int i = 0; i < BUFFER_LEN; i++) st.push((float)(buf[i] >> 8), ms);
+    if (b >= blocks / 2) {
+      sum += ms.sum;
+      n += ms.n;
+    }
+  }
+  return sqrt(sum / n);
+}
+
+static double analogADb(double f) {
+  const double f2 = f * f;
+  const double r = 12194.217 * 12194.217 * f2 * f2 /
+                   ((f2 + 20.598997 * 20.598997) * sqrt((f2 + 107.65265 * 107.65265) * (f2 + 737.86223 * 737.86223)) *
+                    (f2 + 12194.217 * 12194.217));
+  return 20 * log10(r) + 2.0;
+}
+
+template <uint32_t Rate>
+static double designedADb(double f) {
+  double g = 1;
+  for (int i = 0; i < DSP_AWEIGHT_SECTIONS; i++) g *= dspBiquadGain(DspAWeight<Rate>::c.s[i], f, Rate);
+  return 20 * log10(g);
+}
+
+static void selftest() {
+  char msg[160];
+
+  // 1. Legacy profile: same raw, smoothed and averaged levels as the old chain, block for block,
+  //    through silence, noise, tones, clipping and dropped blocks.
+  {
+    OldChain old;
+    DspPipeline<DspProfileLegacy> direct, viaSplit;
+    DspWindowAvg<DspProfileLegacy::avgWindow> avg;
+    SignalGen g;
+    int32_t buf[BUFFER_LEN];
+    int oldRaw = 0, newRaw = 0, rawDiff = 0, splitDiff = 0, smoothDiff = 0, avgDiff = 0;
+    const int blocks = 20000;
+    for (int b = 0; b < blocks; b++) {
+      if (g.mixed(buf, BUFFER_LEN)) {
+        double sumSq[MAX_ZONES] = { 0, 0 };
+        int32_t *out[MAX_ZONES] = { buf, nullptr };
+        const int count = zoneSplit(buf, BUFFER_LEN, 1, out, sumSq);
+        oldRaw = zoneLevelDb(sumSq[0], count, NOISE_FLOOR, SENSITIVITY);
+        newRaw = direct.levelDb(buf, BUFFER_LEN);
+        if (viaSplit.levelDbFromSumSq(sumSq[0], count) != oldRaw) splitDiff++;
+      }
+      if (newRaw != oldRaw) rawDiff++;
+      old.smoothDb = old.smoothDb + SMOOTH_ALPHA * (oldRaw - old.smoothDb);
+      const double s = direct.smooth(newRaw);
+      if (s != old.smoothDb) smoothDiff++;
+      if (avg.add((int)s) != old.getMovingAverage((int)old.smoothDb)) avgDiff++;
+    }
+    snprintf(msg, sizeof(msg), "legacy: raw dB equal to zoneSplit+zoneLevelDb (%d/%d differ)", rawDiff, blocks);
+    expect(rawDiff == 0, msg);
+    snprintf(msg, sizeof(msg), "legacy: levelDbFromSumSq equal (%d differ)", splitDiff);
+    expect(splitDiff == 0, msg);
+    snprintf(msg, sizeof(msg), "legacy: EMA bit-identical (%d differ)", smoothDiff);
+    expect(smoothDiff == 0, msg);
+    snprintf(msg, sizeof(msg), "legacy: moving average equal (%d differ)", avgDiff);
+    expect(avgDiff == 0, msg);
+  }
+
+  // 2. A-weighting: the float cascade matches its design, and the design the analog curve.
+  {
+    const double freqs[] = { 31.5, 63, 125, 250, 500, 1000, 2000, 3150, 4000, 5000, 6300 };
+    const double ref16 = stagesRms<DspChain<DspAWeight<16000>>>(1000, 10000);
+    double worstImpl = 0, worstCurve = 0;
+    for (double f : freqs) {
+      const double got = 20 * log10(stagesRms<DspChain<DspAWeight<16000>>>(f, 10000) / ref16);
+      worstImpl = std::max(worstImpl, fabs(got - designedADb<16000>(f)));
+      worstCurve = std::max(worstCurve, fabs(designedADb<16000>(f) - analogADb(f)));
+    }
+    snprintf(msg, sizeof(msg), "A-weight 16 kHz: float cascade within %.3f dB of the design", worstImpl);
+    expect(worstImpl < 0.05, msg);
+    snprintf(msg, sizeof(msg), "A-weight 16 kHz: design within %.2f dB of IEC 61672 to 6.3 kHz", worstCurve);
+    expect(worstCurve < 1.0, msg);
+
+    double worst8 = 0;
+    for (double f : freqs) {
+      if (f > 3200) continue;
+      worst8 = std::max(worst8, fabs(designedADb<8000>(f) - analogADb(f)));
+    }
+    snprintf(msg, sizeof(msg), "A-weight 8 kHz: design within %.2f dB of IEC 61672 to 3.15 kHz", worst8);
+    expect(worst8 < 0.6, msg);
+    snprintf(msg, sizeof(msg), "A-weight: 0 dB at 1 kHz (%.4f / %.4f)", designedADb<16000>(1000), designedADb<8000>(1000));
+    expect(fabs(designedADb<16000>(1000)) < 1e-6 && fabs(designedADb<8000>(1000)) < 1e-6, msg);
+  }
+
+  // 3. DC removal: a large offset inflates the plain RMS, not the blocked one.
+  {
+    const double clean = stagesRms<DspChain<>>(500, 20000);
+    const double plainDc = stagesRms<DspChain<>>(500, 20000, 60000);
+    const double blocked = stagesRms<DspProfileDcBlocked::Stages>(500, 20000, 60000);
+    snprintf(msg, sizeof(msg), "DC block: 500 Hz tone with offset %.0f -> %.0f (plain %.0f)", clean, blocked, plainDc);
+    expect(fabs(20 * log10(blocked / clean)) < 0.1 && plainDc > 3 * clean, msg);
+  }
+
+  // 4. Decimated A-weighting reads like the full-rate one to 2 kHz (above that the boxcar droops:
+  //    -1.6 dB at 3 kHz).
+  {
+    double worst = 0;
+    const double f[] = { 63, 100, 250, 500, 1000, 1600, 2000 };
+    for (double hz : f) {
+      const double full = stagesRms<DspProfileAWeighted::Stages>(hz, 10000);
+      const double lite = stagesRms<DspProfileAWeightedLite::Stages>(hz, 10000);
+      worst = std::max(worst, fabs(20 * log10(lite / full)));
+    }
+    snprintf(msg, sizeof(msg), "lite profile: within %.2f dB of full rate, 63 Hz-2 kHz", worst);
+    expect(worst < 1.0, msg);
+  }
+
+  // 5. Levels: a 1 kHz tone reads the same in every profile; rumble reads lower weighted.
+  {
+    SignalGen g;
+    int32_t buf[BUFFER_LEN];
+    DspPipeline<DspProfileLegacy> legacy;
+    DspPipeline<DspProfileAWeighted> weighted;
+    int a = 0, w = 0;
+    for (int b = 0; b < 50; b++) {
+      g.tone(buf, BUFFER_LEN, 1000, 20000);
+      a = legacy.levelDb(buf, BUFFER_LEN);
+      w = weighted.levelDb(buf, BUFFER_LEN);
+    }
+    snprintf(msg, sizeof(msg), "1 kHz tone: legacy %d dB, A-weighted %d dB", a, w);
+    expect(abs(a - w) <= 1, msg);
+    for (int b = 0; b < 50; b++) {
+      g.tone(buf, BUFFER_LEN, 60, 20000);
+      a = legacy.levelDb(buf, BUFFER_LEN);
+      w = weighted.levelDb(buf, BUFFER_LEN);
+    }
+    snprintf(msg, sizeof(msg), "60 Hz hum: legacy %d dB, A-weighted %d dB", a, w);
+    expect(a - w >= 5, msg);
+  }
+
+  // 6. EMA time constant: a step reaches 63% after about tau.
+  {
+    DspPipeline<DspProfileAWeighted> p;
+    int blocks = 0;
+    while (p.smooth(100) < 63.2 && blocks < 1000) blocks++;
+    const double ms = (blocks + 1) * 1000.0 * DspProfileAWeighted::blockLen / DspProfileAWeighted::rateHz;
+    snprintf(msg, sizeof(msg), "fast weighting: 63%% of a step after %.0f ms (tau 125 ms)", ms);
+    expect(ms >= 110 && ms <= 145, msg);
+  }
+
+  printf(fails ? "\n%d check(s) failed\n" : "\nall checks passed\n", fails);
+}
+
+// ---------- bench ----------
+
+static volatile int sink;
+
+template <class F>
+static double nsPerBlock(int blocks, const std::vector<int32_t> &sig, F fn) {
+  const int nb = (int)(sig.size() / BUFFER_LEN);
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int b = 0; b < blocks; b++) sink = fn(&sig[(size_t)(b % nb) * BUFFER_LEN]);
+  const auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / blocks;
+}
+
+template <class P>
+static void benchProfile(const char *name, int blocks, const std::vector<int32_t> &sig, double base) {
+  DspPipeline<P> p;
+  const double ns = nsPerBlock(blocks, sig, [&](const int32_t *x) {
+    const int db = p.levelDb(x, BUFFER_LEN);
+    return (int)p.smooth(db);
+  });
+  printf("%-28s %8.1f ns/block  (%.2fx)\n", name, ns, ns / base);
+}
+
+static void bench(int blocks) {
+  std::vector<int32_t> sig((size_t)BUFFER_LEN * 64);
+  SignalGen g;
+  for (int b = 0; b < 64; b++) g.pinkNoise(&sig[(size_t)b * BUFFER_LEN], BUFFER_LEN, 5000);
+
+  OldChain old;
+  const double base = nsPerBlock(blocks, sig, [&](const int32_t *x) {
+    double sumSq[MAX_ZONES] = { 0, 0 };
+    int32_t *out[MAX_ZONES] = { (int32_t *)x, nullptr };
+    const int count = zoneSplit(x, BUFFER_LEN, 1, out, sumSq);
+    const int raw = zoneLevelDb(sumSq[0], count, NOISE_FLOOR, SENSITIVITY);
+    old.smoothDb = old.smoothDb + SMOOTH_ALPHA * (raw - old.smoothDb);
+    return (int)old.smoothDb;
+  });
+  printf("%-28s %8.1f ns/block\n", "old chain (zoneSplit)", base);
+  benchProfile<DspProfileLegacy>("legacy", blocks, sig, base);
+  benchProfile<DspProfileDcBlocked>("dc-blocked", blocks, sig, base);
+  benchProfile<DspProfileAWeighted>("a-weighted", blocks, sig, base);
+  benchProfile<DspProfileAWeightedLite>("a-weighted lite (8 kHz)", blocks, sig, base);
+}
+
+static void response() {
+  const double freqs[] = { 20,   31.5, 50,   63,   100,  125,  160,  200,  250,  315,  400,  500,  630,  800,
+                           1000, 1250, 1600, 2000, 2500, 3150, 4000, 5000, 6300, 7000 };
+  printf("%8s %9s %9s %9s\n", "Hz", "IEC", "16 kHz", "8 kHz");
+  for (double f : freqs) {
+    printf("%8.1f %9.2f %9.2f", f, analogADb(f), designedADb<16000>(f));
+    if (f < 3600) printf(" %9.2f", designedADb<8000>(f));
+    printf("\n");
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) {
+    selftest();
+    return fails ? 1 : 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "bench")) {
+    bench(argc >= 3 ? atoi(argv[2]) : 200000);
+    return 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "response")) {
+    response();
+    return 0;
+  }
+  fprintf(stderr, "usage: %s selftest | bench [blocks] | response\n", argv[0]);
+  return 2;
+}
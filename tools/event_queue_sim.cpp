@@ -0,0 +1,368 @@
+// Host simulation of RED event delivery: SD-first (every event appended to /pending_events.txt,
+// as before and in EVQ_WRITE_THROUGH mode) versus RAM-first (event_queue.h, EVQ_RAM_FIRST).
+//
+// Both pipelines see the same violations and the same uplink outages on a virtual clock and run
+// the same retry policy (sync_scheduler.h). The firmware loop blocks during SD and HTTP work, so
+// an event that arrives while the loop is busy waits for it; that wait is part of its latency.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. event_queue_sim.cpp -o event_queue_sim
+//
+// Usage:
+//   event_queue_sim [options]
+//     --hours N           simulated time (default 24)
+//     --gap-min N         mean minutes between violations (default 15)
+//     --up-min N          mean minutes between outages (default 240)
+//     --down-min N        mean outage length in minutes (default 10)
+//     --silent-pct N      outages where Wi-Fi stays up but uploads fail (default 50)
+//     --append-us N       SD open+append+close, /status sd_append_us (default 9000)
+//     --sd-wr-kbps N      SD write bandwidth, /status sd_wr_kbps (default 350)
+//     --sd-rd-kbps N      SD read bandwidth, /status sd_rd_kbps (default 700)
+//     --http-ms N         one batch POST (default 400)
+//     --audio-ms N        WAV upload + event + audio rows (default 2500)
+//     --timeout-ms N      failed request (default 5000)
+//     --max-age-s N       EventQueue::maxRamAgeMs (default 60)
+//     --seed N
+//
+// Pass a device's /status SD figures through the --append-us/--sd-*-kbps flags to model its card.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "event_queue.h"
+#include "sync_scheduler.h"
+
+struct SimConfig {
+  double hours = 24;
+  double gapMin = 15;
+  double upMin = 240;
+  double downMin = 10;
+  int silentPct = 50;
+  uint32_t appendUs = 9000;
+  uint32_t sdWrKBps = 350;
+  uint32_t sdRdKBps = 700;
+  uint32_t httpMs = 400;
+  uint32_t audioMs = 2500;
+  uint32_t timeoutMs = 5000;
+  uint32_t maxAgeS = 60;
+  uint32_t seed = 1;
+};
+
+static const uint32_t TICK_MS = 50;
+static const uint32_t SYNC_TICK_MS = 3000;      // activeSyncIntervalMs
+static const int MAX_EVENTS_PER_ATTEMPT = 12;   // trySyncPendingEvents()
+
+struct Outage {
+  uint32_t start, end;
+  bool silent;   // Wi-Fi up, API down
+};
+
+struct World {
+  std::vector<PendingEvent> events;   // sorted by queuedMs
+  std::vector<Outage> outages;
+
+  bool wifiUp(uint32_t t) const {
+    for (const Outage &o : outages)
+      if (t >= o.start && t < o.end && !o.silent) return false;
+    return true;
+  }
+  bool apiUp(uint32_t t) const {
+    for (const Outage &o : outages)
+      if (t >= o.start && t < o.end) return false;
+    return true;
+  }
+};
+
+static World buildWorld(const SimConfig &c) {
+  World w;
+  std::mt19937 rng(c.seed);
+  const uint32_t endMs = (uint32_t)(c.hours * 3600000.0);
+  std::exponential_distribution<double> gap(1.0 / (c.gapMin * 60000.0));
+  std::exponential_distribution<double> up(1.0 / (c.upMin * 60000.0));
+  std::exponential_distribution<double> down(1.0 / (c.downMin * 60000.0));
+  std::uniform_int_distribution<int> pct(0, 99);
+
+  uint64_t seq = 0;
+  for (double t = gap(rng); t < endMs; t += gap(rng)) {
+    // Escalation ladder of one violation: FIRST, SECOND, then MAJOR (with audio) if it keeps going.
+    const char *levels[3] = { "FIRST", "SECOND", "MAJOR" };
+    const uint32_t offs[3] = { 5000, 30000, 60000 };
+    int steps = 1 + (pct(rng) < 60) + (pct(rng) < 35);
+    char gid[37];
+    snprintf(gid, sizeof(gid), "g%035llu", (unsigned long long)seq);
+    for (int k = 0; k < steps; k++) {
+      PendingEvent e;
+      memset(&e, 0, sizeof(e));
+      snprintf(e.id, sizeof(e.id), "%08llx-0000-4000-8000-%012llx", (unsigned long long)seq, (unsigned long long)k);
+      pendingEventCopy(e.groupId, sizeof(e.groupId), gid);
+      pendingEventCopy(e.level, sizeof(e.level), levels[k]);
+      e.durationSeconds = (int32_t)(offs[k] / 1000);
+      e.decibel = 78;
+      e.buzzer = 1;
+      e.audio = (k == 2);
+      if (e.audio) snprintf(e.audioPath, sizeof(e.audioPath), "/recordings/rec_%llu.wav", (unsigned long long)seq);
+      e.queuedMs = (uint32_t)t + offs[k];
+      e.eventTsMs = e.queuedMs;
+      if (e.queuedMs < endMs) w.events.push_back(e);
+    }
+    seq++;
+  }
+  std::sort(w.events.begin(), w.events.end(), [](const PendingEvent &a, const PendingEvent &b) { return a.queuedMs < b.queuedMs; });
+
+  for (double t = up(rng); t < endMs; t += up(rng)) {
+    Outage o;
+    o.start = (uint32_t)t;
+    t += down(rng);
+    o.end = (uint32_t)t;
+    o.silent = pct(rng) < c.silentPct;
+    w.outages.push_back(o);
+  }
+  return w;
+}
+
+struct Result {
+  uint64_t sdBytesWritten = 0;
+  uint64_t sdBytesRead = 0;
+  uint32_t sdOps = 0;
+  uint32_t delivered = 0;
+  uint32_t viaRam = 0;
+  uint32_t spilled = 0;
+  uint32_t atRisk = 0;             // max events held only in RAM at any moment
+  std::vector<uint32_t> latMs;
+};
+
+struct Pipeline {
+  const SimConfig &c;
+  const World &w;
+  bool ramFirst;
+  SyncScheduler sched;
+  EventQueue<16> q;
+  std::vector<PendingEvent> file;   // /pending_events.txt
+  uint32_t t = 0;                   // loop clock; advances with blocking work
+  std::mt19937 rng;
+  Result r;
+
+  Pipeline(const SimConfig &cfg, const World &world, bool ram) : c(cfg), w(world), ramFirst(ram), rng(cfg.seed + 7) {
+    q.mode = ram ? EVQ_RAM_FIRST : EVQ_WRITE_THROUGH;
+    q.maxRamAgeMs = c.maxAgeS * 1000;
+  }
+
+  static uint32_t lineBytes(const PendingEvent &e) {
+    char buf[200];
+    return (uint32_t)pendingEventFormat(e, buf, sizeof(buf)) + 1;
+  }
+  uint32_t fileBytes() const {
+    uint32_t n = 0;
+    for (const PendingEvent &e : file) n += lineBytes(e);
+    return n;
+  }
+  void sdAppend(const PendingEvent &e) {
+    file.push_back(e);
+    r.sdBytesWritten += lineBytes(e);
+    r.sdOps++;
+    t += c.appendUs / 1000;
+  }
+  bool uplinkUp() const {
+    return w.wifiUp(t) && sched.failStreak[SYNC_PRIO_MAJOR] < 2 && sched.failStreak[SYNC_PRIO_WARNING] < 2;
+  }
+  // One request; returns success and advances the clock.
+  bool request(uint32_t costMs) {
+    bool ok = w.apiUp(t);
+    t += ok ? costMs : c.timeoutMs;
+    return ok;
+  }
+  void delivered(const PendingEvent &e, bool viaRam) {
+    r.delivered++;
+    if (viaRam) r.viaRam++;
+    r.latMs.push_back(t - e.queuedMs);
+  }
+
+  // Uploads a list (audio one by one, rest as one batch) for one class; returns the kept ones.
+  std::vector<PendingEvent> upload(SyncPriority p, std::vector<PendingEvent> list, bool viaRam) {
+    std::vector<PendingEvent> kept, batch;
+    bool failed = !sched.due(p, t);
+    for (const PendingEvent &e : list) {
+      if (failed) { kept.push_back(e); continue; }
+      if (!e.audio) { batch.push_back(e); continue; }
+      if (request(c.audioMs)) {
+        sched.onSuccess(p, t);
+        delivered(e, viaRam);
+      } else {
+        sched.onFailure(p, t, rng());
+        failed = true;
+        kept.push_back(e);
+      }
+    }
+    if (!batch.empty()) {
+      if (!failed && request(c.httpMs)) {
+        sched.onSuccess(p, t);
+        for (const PendingEvent &e : batch) delivered(e, viaRam);
+      } else {
+        if (!failed) sched.onFailure(p, t, rng());
+        kept.insert(kept.end(), batch.begin(), batch.end());
+      }
+    }
+    return kept;
+  }
+
+  // trySyncPendingEvents(): read the whole file, upload up to 12, rewrite the rest via tmp + rename.
+  void syncFile() {
+    if (file.empty() || !w.wifiUp(t)) return;
+    uint32_t bytes = fileBytes();
+    r.sdBytesRead += bytes;
+    r.sdOps += 3;  // open, open tmp, rename
+    t += bytes / std::max<uint32_t>(1, c.sdRdKBps) + 2 * c.appendUs / 1000;
+
+    std::vector<PendingEvent> take, rest;
+    for (size_t i = 0; i < file.size(); i++) (i < (size_t)MAX_EVENTS_PER_ATTEMPT ? take : rest).push_back(file[i]);
+    std::vector<PendingEvent> kept;
+    for (int p = SYNC_PRIO_MAJOR; p <= SYNC_PRIO_WARNING; p++) {
+      std::vector<PendingEvent> cls;
+      for (const PendingEvent &e : take)
+        if ((int)syncPriorityForLevel(e.level) == p) cls.push_back(e);
+      std::vector<PendingEvent> k = upload((SyncPriority)p, cls, false);
+      kept.insert(kept.end(), k.begin(), k.end());
+    }
+    kept.insert(kept.end(), rest.begin(), rest.end());
+    file = kept;
+    uint32_t outBytes = fileBytes();
+    r.sdBytesWritten += outBytes;
+    t += outBytes / std::max<uint32_t>(1, c.sdWrKBps);
+  }
+
+  void syncRam() {
+    if (q.count == 0 || !w.wifiUp(t)) return;
+    for (int p = SYNC_PRIO_MAJOR; p <= SYNC_PRIO_WARNING; p++) {
+      std::vector<PendingEvent> cls;
+      for (int i = 0; i < q.count; i++)
+        if ((int)syncPriorityForLevel(q.items[i].level) == p) cls.push_back(q.items[i]);
+      if (cls.empty()) continue;
+      std::vector<PendingEvent> kept = upload((SyncPriority)p, cls, true);
+      for (int i = q.count - 1; i >= 0; i--) {
+        if ((int)syncPriorityForLevel(q.items[i].level) != p) continue;
+        bool stillKept = false;
+        for (const PendingEvent &k : kept) stillKept |= (strcmp(k.id, q.items[i].id) == 0);
+        if (!stillKept) {
+          q.uploadedDirect++;
+          q.remove(i);
+        }
+      }
+    }
+  }
+
+  void onEvent(const PendingEvent &e) {
+    if (q.route(uplinkUp()) == EVQ_SPILL_NONE && q.push(e)) {
+      r.atRisk = std::max<uint32_t>(r.atRisk, (uint32_t)q.count);
+      if (w.wifiUp(t) && sched.due(syncPriorityForLevel(e.level), t)) syncRam();
+    } else {
+      sdAppend(e);
+      if (w.wifiUp(t) && sched.due(syncPriorityForLevel(e.level), t)) syncFile();
+    }
+  }
+
+  void spillTick() {
+    EventSpillReason why = q.spillDue(uplinkUp(), t);
+    if (why == EVQ_SPILL_NONE) return;
+    r.spilled += (uint32_t)q.spill(why, [&](const char *, int) {
+      sdAppend(q.items[0]);
+      return true;
+    });
+  }
+
+  Result run() {
+    const uint32_t endMs = (uint32_t)(c.hours * 3600000.0);
+    size_t next = 0;
+    uint32_t lastSync = 0;
+    // Run past the end so the last backlog drains.
+    while (t < endMs + 3600000u) {
+      while (next < w.events.size() && w.events[next].queuedMs <= t) onEvent(w.events[next++]);
+      if (ramFirst) spillTick();
+      if (t - lastSync >= SYNC_TICK_MS) {
+        lastSync = t;
+        if (!sched.due(SYNC_PRIO_MAJOR, t) && !sched.due(SYNC_PRIO_WARNING, t)) {
+          t += TICK_MS;
+          continue;
+        }
+        if (ramFirst) syncRam();
+        syncFile();
+      }
+      t += TICK_MS;
+    }
+    return r;
+  }
+};
+
+static uint32_t pctl(std::vector<uint32_t> v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  size_t i = (size_t)(p * (double)(v.size() - 1));
+  return v[i];
+}
+
+static void report(const char *name, const Result &r, size_t total) {
+  double mean = 0;
+  for (uint32_t l : r.latMs) mean += l;
+  if (!r.latMs.empty()) mean /= (double)r.latMs.size();
+  printf("%-10s delivered %5u/%-5zu  ram %5u  spilled %4u  sd_written %8llu B  sd_read %9llu B  sd_ops %6u  "
+         "latency mean %6.0f ms  p50 %6u  p95 %7u  max %7u  ram_at_risk %u\n",
+         name, r.delivered, total, r.viaRam, r.spilled, (unsigned long long)r.sdBytesWritten,
+         (unsigned long long)r.sdBytesRead, r.sdOps, mean, pctl(r.latMs, 0.5), pctl(r.latMs, 0.95),
+         pctl(r.latMs, 1.0), r.atRisk);
+}
+
+int main(int argc, char **argv) {
+  SimConfig c;
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    const char *v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (!v) {
+      fprintf(stderr, "missing value for %s\n", a);
+      return 2;
+    }
+    if (!strcmp(a, "--hours")) c.hours = atof(v);
+    else if (!strcmp(a, "--gap-min")) c.gapMin = atof(v);
+    else if (!strcmp(a, "--up-min")) c.upMin = atof(v);
+    else if (!strcmp(a, "--down-min")) c.downMin = atof(v);
+    else if (!strcmp(a, "--silent-pct")) c.silentPct = atoi(v);
+    else if (!strcmp(a, "--append-us")) c.appendUs = (uint32_t)atoi(v);
+    else if (!strcmp(a, "--sd-wr-kbps")) c.sdWrKBps = (uint32_t)atoi(v);
+    else if (!strcmp(a, "--sd-rd-kbps")) c.sdRdKBps = (uint32_t)atoi(v);
+    else if (!strcmp(a, "--http-ms")) c.httpMs = (uint32_t)atoi(v);
+    else if (!strcmp(a, "--audio-ms")) c.audioMs = (uint32_t)atoi(v);
+    else if (!strcmp(a, "--timeout-ms")) c.timeoutMs = (uint32_t)atoi(v);
+    else if (!strcmp(a, "--max-age-s")) c.maxAgeS = (uint32_t)atoi(v);
+    else if (!strcmp(a, "--seed")) c.seed = (uint32_t)atoi(v);
+    else {
+      fprintf(stderr, "unknown option %s\n", a);
+      return 2;
+    }
+    i++;
+  }
+
+  World w = buildWorld(c);
+  uint32_t downMs = 0;
+  for (const Outage &o : w.outages) downMs += o.end - o.start;
+  printf("%.1f h, %zu events, %zu outages (%.1f%% of the time)\n", c.hours, w.events.size(), w.outages.size(),
+         100.0 * downMs / (c.hours * 3600000.0));
+
+  Pipeline sd(c, w, false), ram(c, w, true);
+  Result a = sd.run(), b = ram.run();
+  report("sd-first", a, w.events.size());
+  report("ram-first", b, w.events.size());
+
+  double meanA = 0, meanB = 0;
+  for (uint32_t l : a.latMs) meanA += l;
+  for (uint32_t l : b.latMs) meanB += l;
+  if (!a.latMs.empty()) meanA /= a.latMs.size();
+  if (!b.latMs.empty()) meanB /= b.latMs.size();
+  printf("saved: %lld B written, %lld B read, %d SD ops, %.0f ms mean latency per event\n",
+         (long long)a.sdBytesWritten - (long long)b.sdBytesWritten, (long long)a.sdBytesRead - (long long)b.sdBytesRead,
+         (int)a.sdOps - (int)b.sdOps, meanA - meanB);
+  return 0;
+}
@@ -0,0 +1,529 @@
+// Host harness for the admin file export (file_export.h).
+//
+// DirFs stands in for the SD card: a host directory, read with open/pread/close per chunk the way
+// the firmware reopens the file for each one (no stdio buffers, so the only heap in play is the
+// exporter's own). SimSocket stands in for the client's TCP connection: a send buffer the size of
+// lwIP's default (5744 bytes) that the network drains at a fixed rate between loop-job runs, and
+// that can drop the connection after a given number of bytes. The job is rerun 2 ms after a pump
+// that made progress and 10 ms after one that found the socket full, as in the firmware.
+// malloc/free are interposed through glibc's __libc_* entry points (Linux/glibc only) to count
+// heap use while a download streams.
+//
+// bench uses a cost model, not measurements: a chunk read costs 1.2 ms to open and seek plus
+// 0.45 ms per KB (about 2.2 MB/s on a 20 MHz SPI bus), and Wi-Fi drains 1 MB/s.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. file_export_sim.cpp -o file_export_sim
+//
+// Usage:
+//   file_export_sim selftest [dir]   Range parsing, conditional requests, random ranges, resumed
+//                                    downloads, files changing underneath, stalls and the heap
+//                                    ceiling, on files written to dir (default /tmp) (exit status 1
+//                                    on failure)
+//   file_export_sim bench [kb]       download time, throughput and worst time per pump for chunk
+//                                    sizes 512..16384 at one and two reads per pump (default
+//                                    2048 KB file)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "file_export.h"
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+// ---------------- allocation hooks ----------------
+
+static bool hooksOn = false;
+static uint32_t heapAllocs = 0;
+
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *__libc_calloc(size_t, size_t);
+extern "C" void *__libc_realloc(void *, size_t);
+extern "C" void __libc_free(void *);
+
+extern "C" void *malloc(size_t n) {
+  if (hooksOn) heapAllocs++;
+  return __libc_malloc(n);
+}
+
+extern "C" void *calloc(size_t a, size_t b) {
+  if (hooksOn) heapAllocs++;
+  return __libc_calloc(a, b);
+}
+
+extern "C" void *realloc(void *q, size_t n) {
+  if (hooksOn) heapAllocs++;
+  return __libc_realloc(q, n);
+}
+
+extern "C" void free(void *p) { __libc_free(p); }
+
+// ---------------- SD shim ----------------
+
+struct DirFs {
+  std::string root;
+  uint32_t reads = 0;
+  uint32_t maxRead = 0;
+
+  void full(const char *path, char *out, size_t cap) const { snprintf(out, cap, "%s%s", root.c_str(), path); }
+
+  bool stat(const char *path, uint32_t &size, uint32_t &mtime) {
+    char p[512];
+    full(path, p, sizeof(p));
+    struct stat st;
+    if (::stat(p, &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    size = (uint32_t)st.st_size;
+    mtime = (uint32_t)st.st_mtime;
+    return true;
+  }
+
+  int readAt(const char *path, uint32_t off, uint8_t *buf, int n) {
+    char p[512];
+    full(path, p, sizeof(p));
+    const int fd = open(p, O_RDONLY);
+    if (fd < 0) return -1;
+    const ssize_t got = pread(fd, buf, (size_t)n, off);
+    close(fd);
+    reads++;
+    if ((uint32_t)n > maxRead) maxRead = (uint32_t)n;
+    return got < 0 ? -1 : (int)got;
+  }
+};
+
+// ---------------- client socket ----------------
+
+struct SimNet {
+  size_t sndBuf = 5744;     // lwIP TCP_SND_BUF default
+  size_t inFlight = 0;
+  uint32_t bytesPerMs = 1024;
+  long dropAfter = -1;      // close the connection once this many bytes were taken
+  bool closed = false;
+  bool stalled = false;     // the peer stopped reading
+  std::vector<uint8_t> got;
+
+  void advance(uint32_t ms) {
+    if (stalled) return;
+    const size_t d = (size_t)bytesPerMs * ms;
+    inFlight = d >= inFlight ? 0 : inFlight - d;
+  }
+};
+
+struct SimSocket {
+  SimNet *net = nullptr;
+
+  int write(const uint8_t *p, size_t n) {
+    if (!net || net->closed) return -1;
+    size_t room = net->sndBuf - net->inFlight;
+    if (room == 0) return 0;
+    if (n > room) n = room;
+    if (net->dropAfter >= 0 && (long)(net->got.size() + n) >= net->dropAfter) {
+      n = (size_t)(net->dropAfter - (long)net->got.size());
+      net->got.insert(net->got.end(), p, p + n);
+      net->closed = true;
+      return n ? (int)n : -1;
+    }
+    net->got.insert(net->got.end(), p, p + n);
+    net->inFlight += n;
+    return (int)n;
+  }
+
+  void close() {
+    if (net) net->closed = true;
+  }
+};
+
+static uint8_t chunkBuf[16384];
+
+typedef FileExport<DirFs, SimSocket> Exporter;
+
+// Runs a download to the end the way the loop job does. Returns the final step.
+static FileExportStep runExport(Exporter &ex, SimNet &net, uint32_t &now, uint32_t *worstPumpBytes = nullptr) {
+  FileExportStep st = FILE_EXPORT_SENT;
+  while (ex.active) {
+    const uint64_t before = ex.stats.bytes;
+    st = ex.pump(now);
+    if (worstPumpBytes && ex.stats.bytes - before > *worstPumpBytes) *worstPumpBytes = (uint32_t)(ex.stats.bytes - before);
+    const uint32_t wait = st == FILE_EXPORT_BLOCKED ? 10 : 2;
+    now += wait;
+    net.advance(wait);
+  }
+  return st;
+}
+
+// The test files are the fixture: without them no check means anything, so a write that fails
+// ends the run with exit status 2.
+static void cannotWrite(const std::string &path) {
+  fprintf(stderr, "cannot write %s\n", path.c_str());
+  exit(2);
+}
+
+static std::vector<uint8_t> writeFile(const std::string &path, size_t n, uint32_t seed) {
+  std::vector<uint8_t> d(n);
+  std::mt19937 rng(seed);
+  for (size_t i = 0; i < n; i++) d[i] = (uint8_t)rng();
+  FILE *f = fopen(path.c_str(), "wb");
+  if (!f) cannotWrite(path);
+  const bool ok = (n == 0 || fwrite(d.data(), 1, n, f) == n);
+  if (fclose(f) != 0 || !ok) cannotWrite(path);
+  return d;
+}
+
+static void appendFile(const std::string &path, std::vector<uint8_t> &d, size_t n) {
+  FILE *f = fopen(path.c_str(), "ab");
+  if (!f) cannotWrite(path);
+  bool ok = true;
+  for (size_t i = 0; i < n; i++) {
+    const uint8_t b = (uint8_t)(i * 7 + 3);
+    d.push_back(b);
+    ok = ok && fputc(b, f) != EOF;
+  }
+  if (fclose(f) != 0 || !ok) cannotWrite(path);
+}
+
+static void setMtime(const std::string &path, time_t t) {
+  struct timespec ts[2] = { { t, 0 }, { t, 0 } };
+  utimensat(AT_FDCWD, path.c_str(), ts, 0);
+}
+
+// ---------------- selftest ----------------
+
+static void selftestParsing() {
+  struct Case {
+    const char *h;
+    uint32_t size;
+    FileRangeKind kind;
+    uint32_t start, len;
+  };
+  const Case cases[] = {
+    { "bytes=0-0", 100, FILE_RANGE_OK, 0, 1 },
+    { "bytes=10-19", 100, FILE_RANGE_OK, 10, 10 },
+    { "bytes=90-", 100, FILE_RANGE_OK, 90, 10 },
+    { "bytes=90-500", 100, FILE_RANGE_OK, 90, 10 },
+    { "bytes=-10", 100, FILE_RANGE_OK, 90, 10 },
+    { "bytes=-500", 100, FILE_RANGE_OK, 0, 100 },
+    { " bytes= 5-6 ", 100, FILE_RANGE_OK, 5, 2 },
+    { "bytes=100-", 100, FILE_RANGE_UNSATISFIABLE, 0, 0 },
+    { "bytes=-0", 100, FILE_RANGE_UNSATISFIABLE, 0, 0 },
+    { "bytes=0-", 0, FILE_RANGE_UNSATISFIABLE, 0, 0 },
+    { "bytes=20-10", 100, FILE_RANGE_NONE, 0, 0 },
+    { "bytes=0-1,5-6", 100, FILE_RANGE_NONE, 0, 0 },
+    { "bytes=-", 100, FILE_RANGE_NONE, 0, 0 },
+    { "bytes=abc", 100, FILE_RANGE_NONE, 0, 0 },
+    { "items=0-5", 100, FILE_RANGE_NONE, 0, 0 },
+    { "bytes=99999999999-", 100, FILE_RANGE_NONE, 0, 0 },
+    { "", 100, FILE_RANGE_NONE, 0, 0 },
+  };
+  int bad = 0;
+  for (const Case &c : cases) {
+    uint32_t s = 0, l = 0;
+    const FileRangeKind k = fileParseRange(c.h, c.size, s, l);
+    if (k != c.kind || (k == FILE_RANGE_OK && (s != c.start || l != c.len))) {
+      printf("     '%s' size %u -> kind %d %u+%u\n", c.h, c.size, k, s, l);
+      bad++;
+    }
+  }
+  expect(bad == 0, "Range: single, open-ended, suffix, clamped, unsatisfiable and ignored forms");
+
+  char etag[24];
+  fileEtag(1000, 0x5f00, etag, sizeof(etag));
+  FileExportPlan p = fileExportPlan(1000, 0x5f00, "bytes=0-99", nullptr, etag);
+  expect(p.status == 304, "If-None-Match with the current ETag: 304");
+  p = fileExportPlan(1000, 0x5f00, nullptr, nullptr, "\"x\", W/\"3e8-5f00\"");
+  expect(p.status == 304, "If-None-Match list with a weak match: 304");
+  p = fileExportPlan(1000, 0x5f00, "bytes=500-", etag, nullptr);
+  expect(p.status == 206 && p.start == 500 && p.len == 500, "If-Range with the current ETag: 206");
+  p = fileExportPlan(1000, 0x5f01, "bytes=500-", etag, nullptr);
+  expect(p.status == 200 && p.start == 0 && p.len == 1000, "If-Range with a stale ETag: whole file");
+  p = fileExportPlan(1000, 0x5f00, "bytes=500-", "Wed, 21 Oct 2015 07:28:00 GMT", nullptr);
+  expect(p.status == 200 && p.len == 1000, "If-Range with a date: whole file");
+  p = fileExportPlan(1000, 0x5f00, "bytes=2000-", nullptr, nullptr);
+  expect(p.status == 416, "range past the end: 416");
+
+  const char *okPaths[] = { "/db_series.txt", "/rec_20240101_120000.wav", "/a/b.bin", "/..hidden" };
+  const char *badPaths[] = { "", "db_series.txt", "/", "/../etc", "/a/../b", "/a//b", "/a/", "/./x", "/a\\b", "/a\"b",
+                             "/0123456789012345678901234567890123456789012345678901234567890123" };
+  bool pathsOk = true;
+  for (const char *s : okPaths) pathsOk &= fileExportPathOk(s);
+  for (const char *s : badPaths) pathsOk &= !fileExportPathOk(s);
+  expect(pathsOk, "paths: absolute only, no . or .. components, bounded length");
+}
+
+static void selftestStreaming(const std::string &dir) {
+  char msg[200];
+  DirFs fs;
+  fs.root = dir;
+  const std::vector<uint8_t> small = writeFile(dir + "/small.txt", 1000, 1);
+  const std::vector<uint8_t> wav = writeFile(dir + "/rec_test.wav", 160044, 2);
+  std::vector<uint8_t> series = writeFile(dir + "/db_series.txt", 70001, 3);
+  writeFile(dir + "/empty.txt", 0, 4);
+
+  // 1. Random ranges, random chunk sizes and socket buffers: the body is exactly the slice.
+  {
+    std::mt19937 rng(7);
+    int bad = 0, runs = 0;
+    const char *names[] = { "/small.txt", "/rec_test.wav", "/db_series.txt" };
+    const std::vector<uint8_t> *data[] = { &small, &wav, &series };
+    for (int i = 0; i < 400; i++) {
+      const int f = (int)(rng() % 3);
+      const uint32_t size = (uint32_t)data[f]->size();
+      char range[48];
+      const uint32_t a = rng() % size, b = a + rng() % (size - a);
+      switch (rng() % 3) {
+        case 0: snprintf(range, sizeof(range), "bytes=%u-%u", a, b); break;
+        case 1: snprintf(range, sizeof(range), "bytes=%u-", a); break;
+        default: snprintf(range, sizeof(range), "bytes=-%u", (unsigned)(1 + rng() % size)); break;
+      }
+      uint32_t sz = 0, mt = 0;
+      fs.stat(names[f], sz, mt);
+      const FileExportPlan p = fileExportPlan(sz, mt, range, nullptr, nullptr);
+      Exporter ex;
+      ex.fs = &fs;
+      ex.buf = chunkBuf;
+      ex.chunk = (size_t)(256 << (rng() % 6));
+      SimNet net;
+      net.sndBuf = 512 + rng() % 6000;
+      net.bytesPerMs = 64 + rng() % 2000;
+      uint32_t now = 0;
+      ex.begin(names[f], p.start, p.len, SimSocket{ &net }, now);
+      const FileExportStep st = runExport(ex, net, now);
+      runs++;
+      if (p.status != 206 || st != FILE_EXPORT_DONE || net.got.size() != p.len ||
+          memcmp(net.got.data(), data[f]->data() + p.start, p.len) != 0) {
+        bad++;
+      }
+    }
+    snprintf(msg, sizeof(msg), "random ranges: %d/%d bodies equal the file slice", runs - bad, runs);
+    expect(bad == 0, msg);
+  }
+
+  // 2. A WAV download cut off four times, resumed with Range + If-Range each time.
+  {
+    uint32_t sz = 0, mt = 0;
+    fs.stat("/rec_test.wav", sz, mt);
+    const FileExportPlan first = fileExportPlan(sz, mt, nullptr, nullptr, nullptr);
+    std::vector<uint8_t> out;
+    const long cuts[] = { 1, 40000, 4096, 77777 };
+    int attempts = 0;
+    bool statusOk = true;
+    FileExportStep st = FILE_EXPORT_FAILED;
+    while (attempts < 10) {
+      char range[32];
+      snprintf(range, sizeof(range), "bytes=%zu-", out.size());
+      const FileExportPlan p = fileExportPlan(sz, mt, out.empty() ? nullptr : range, first.etag, nullptr);
+      statusOk &= p.status == (out.empty() ? 200 : 206) && p.start == out.size();
+      Exporter ex;
+      ex.fs = &fs;
+      ex.buf = chunkBuf;
+      SimNet net;
+      if (attempts < 4) net.dropAfter = cuts[attempts];
+      uint32_t now = 0;
+      ex.begin("/rec_test.wav", p.start, p.len, SimSocket{ &net }, now);
+      st = runExport(ex, net, now);
+      out.insert(out.end(), net.got.begin(), net.got.end());
+      attempts++;
+      if (st == FILE_EXPORT_DONE) break;
+    }
+    snprintf(msg, sizeof(msg), "resume: %d attempts, %zu bytes, identical to the file", attempts, out.size());
+    expect(st == FILE_EXPORT_DONE && attempts == 5 && statusOk && out == wav, msg);
+  }
+
+  // 3. A file appended during a download: the body is the length it started with; a resume with
+  //    the old ETag gets the whole, longer file.
+  {
+    uint32_t sz = 0, mt = 0;
+    fs.stat("/db_series.txt", sz, mt);
+    const FileExportPlan p = fileExportPlan(sz, mt, nullptr, nullptr, nullptr);
+    const std::vector<uint8_t> before = series;
+    Exporter ex;
+    ex.fs = &fs;
+    ex.buf = chunkBuf;
+    SimNet net;
+    net.bytesPerMs = 200;
+    uint32_t now = 0;
+    ex.begin("/db_series.txt", p.start, p.len, SimSocket{ &net }, now);
+    for (int i = 0; i < 5 && ex.active; i++) {
+      ex.pump(now);
+      now += 10;
+      net.advance(10);
+    }
+    appendFile(dir + "/db_series.txt", series, 300);
+    setMtime(dir + "/db_series.txt", (time_t)mt + 2);
+    const FileExportStep st = runExport(ex, net, now);
+    expect(st == FILE_EXPORT_DONE && net.got == before, "append during a download: the original length, unchanged bytes");
+    uint32_t sz2 = 0, mt2 = 0;
+    fs.stat("/db_series.txt", sz2, mt2);
+    const FileExportPlan r = fileExportPlan(sz2, mt2, "bytes=1000-", p.etag, nullptr);
+    expect(r.status == 200 && r.len == series.size(), "resume after an append: ETag changed, whole file");
+  }
+
+  // 4. A file rewritten shorter mid-download (roll-up, rotation) or removed: the download fails.
+  {
+    writeFile(dir + "/shrink.txt", 50000, 5);
+    Exporter ex;
+    ex.fs = &fs;
+    ex.buf = chunkBuf;
+    SimNet net;
+    net.bytesPerMs = 100;
+    uint32_t now = 0;
+    ex.begin("/shrink.txt", 0, 50000, SimSocket{ &net }, now);
+    ex.pump(now);
+    writeFile(dir + "/shrink.txt", 20000, 6);
+    const FileExportStep st = runExport(ex, net, now);
+    expect(st == FILE_EXPORT_FAILED && net.got.size() < 20000 && net.closed, "file shrank mid-download: aborted, connection closed");
+
+    ex.begin("/shrink.txt", 0, 20000, SimSocket{ &net }, now);
+    net.closed = false;
+    net.got.clear();
+    unlink((dir + "/shrink.txt").c_str());
+    expect(runExport(ex, net, now) == FILE_EXPORT_FAILED, "file removed mid-download: aborted");
+  }
+
+  // 5. A client that stops reading is dropped after idleTimeoutMs.
+  {
+    Exporter ex;
+    ex.fs = &fs;
+    ex.buf = chunkBuf;
+    SimNet net;
+    net.stalled = true;
+    uint32_t now = 0;
+    ex.begin("/rec_test.wav", 0, (uint32_t)wav.size(), SimSocket{ &net }, now);
+    const FileExportStep st = runExport(ex, net, now);
+    snprintf(msg, sizeof(msg), "stalled client: dropped after %u ms (idle timeout %u ms)", now, ex.idleTimeoutMs);
+    expect(st == FILE_EXPORT_FAILED && now >= ex.idleTimeoutMs && now <= ex.idleTimeoutMs + 20, msg);
+  }
+
+  // 6. One download at a time; an empty file streams nothing and finishes.
+  {
+    Exporter ex;
+    ex.fs = &fs;
+    ex.buf = chunkBuf;
+    SimNet a, b;
+    uint32_t now = 0;
+    const bool first = ex.begin("/small.txt", 0, 1000, SimSocket{ &a }, now);
+    const bool second = ex.begin("/small.txt", 0, 1000, SimSocket{ &b }, now);
+    runExport(ex, a, now);
+    expect(first && !second, "a second download while one streams is refused");
+    ex.begin("/empty.txt", 0, 0, SimSocket{ &b }, now);
+    expect(runExport(ex, b, now) == FILE_EXPORT_DONE && b.got.empty(), "empty file: no body, done");
+  }
+
+  // 7. Memory ceiling: a 32 MB download allocates nothing, reads at most one chunk at a time and
+  //    sends at most maxReadsPerPump chunks per pump.
+  {
+    const size_t big = 32u << 20;
+    writeFile(dir + "/big.bin", big, 8);
+    Exporter ex;
+    ex.fs = &fs;
+    ex.buf = chunkBuf;
+    SimNet net;
+    net.bytesPerMs = 4096;
+    net.got.reserve(big);
+    fs.maxRead = 0;
+    uint32_t now = 0, worst = 0;
+    ex.begin("/big.bin", 0, (uint32_t)big, SimSocket{ &net }, now);
+    heapAllocs = 0;
+    hooksOn = true;
+    const FileExportStep st = runExport(ex, net, now, &worst);
+    hooksOn = false;
+    snprintf(msg, sizeof(msg), "32 MB download: %u heap allocations, largest read %u B, at most %u B per pump, state %zu B + %zu B buffer",
+             heapAllocs, fs.maxRead, worst, sizeof(Exporter), ex.chunk);
+    expect(st == FILE_EXPORT_DONE && net.got.size() == big && heapAllocs == 0 && fs.maxRead <= ex.chunk &&
+               worst <= ex.chunk * ex.maxReadsPerPump + ex.chunk,
+           msg);
+    unlink((dir + "/big.bin").c_str());
+  }
+
+  unlink((dir + "/small.txt").c_str());
+  unlink((dir + "/rec_test.wav").c_str());
+  unlink((dir + "/db_series.txt").c_str());
+  unlink((dir + "/empty.txt").c_str());
+}
+
+// ---------------- bench ----------------
+
+// Modelled SD card: the read costs advance the virtual clock, the bytes come from memory.
+struct ModelFs {
+  std::vector<uint8_t> data;
+  uint32_t pumpUs = 0;
+
+  bool stat(const char *, uint32_t &size, uint32_t &mtime) {
+    size = (uint32_t)data.size();
+    mtime = 1;
+    return true;
+  }
+
+  int readAt(const char *, uint32_t off, uint8_t *buf, int n) {
+    memcpy(buf, data.data() + off, (size_t)n);
+    pumpUs += 1200 + (uint32_t)n * 450 / 1024;
+    return n;
+  }
+};
+
+static void bench(uint32_t kb) {
+  const size_t chunks[] = { 512, 1024, 2048, 4096, 8192, 16384 };
+  printf("%u KB file, Wi-Fi 1 MB/s, SD read 1.2 ms + 0.45 ms/KB\n", kb);
+  printf("%8s %6s %10s %9s %13s %8s\n", "chunk", "/pump", "total ms", "KB/s", "worst pump ms", "reads");
+  for (int perPump = 1; perPump <= 2; perPump++)
+  for (size_t c : chunks) {
+    ModelFs fs;
+    fs.data.assign((size_t)kb * 1024, 0x5a);
+    FileExport<ModelFs, SimSocket> ex;
+    ex.fs = &fs;
+    ex.buf = chunkBuf;
+    ex.chunk = c;
+    ex.maxReadsPerPump = perPump;
+    SimNet net;
+    net.bytesPerMs = 1024;
+    net.got.reserve(fs.data.size());
+    uint32_t now = 0, worstUs = 0;
+    ex.begin("/x", 0, (uint32_t)fs.data.size(), SimSocket{ &net }, now);
+    while (ex.active) {
+      fs.pumpUs = 0;
+      const FileExportStep st = ex.pump(now);
+      if (fs.pumpUs > worstUs) worstUs = fs.pumpUs;
+      // The pump's own SD time passes too: the network drains meanwhile.
+      const uint32_t wait = (st == FILE_EXPORT_BLOCKED ? 10 : 2) + fs.pumpUs / 1000;
+      now += wait;
+      net.advance(wait);
+    }
+    printf("%8zu %6d %10u %9u %13.1f %8u\n", c, perPump, now, (uint32_t)((uint64_t)kb * 1000 / (now ? now : 1)), worstUs / 1000.0,
+           ex.stats.reads);
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) {
+    std::string dir = argc >= 3 ? argv[2] : "/tmp";
+    dir += "/file_export_sim";
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+      fprintf(stderr, "cannot write %s\n", dir.c_str());
+      return 2;
+    }
+    selftestParsing();
+    selftestStreaming(dir);
+    rmdir(dir.c_str());
+    printf(fails ? "\n%d check(s) failed\n" : "\nall checks passed\n", fails);
+    return fails ? 1 : 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "bench")) {
+    bench(argc >= 3 ? (uint32_t)atoi(argv[2]) : 2048);
+    return 0;
+  }
+  fprintf(stderr, "usage: %s selftest [dir] | bench [kb]\n", argv[0]);
+  return 2;
+}
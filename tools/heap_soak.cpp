@@ -0,0 +1,413 @@
+// Host soak of the firmware's sampling + logging path with every allocation hooked.
+//
+// Replays N days of a classroom (lessons on weekdays, loud episodes that escalate to warnings,
+// quiet nights that drop the power policy to QUIET) through the same headers the firmware uses:
+// classifier, escalation engine, power policy, clock service, db-series ring, event queue and the
+// StructLog rings. Each frame follows loop(): mic RMS, classify, smoothing, LED/warnings, db series,
+// monitor log, Serial echo, /noise_log.txt batching. Frames are bracketed with HeapStats exactly as
+// in loop(); frames in which event-driven work ran are flagged, every other frame must not allocate.
+// Periodic work outside the frame (NTP discipline, event upload, hourly db-series upload, /events
+// reads) runs on the same virtual clock.
+//
+// malloc/calloc/realloc/free are interposed through glibc's __libc_* entry points, so this tool is
+// Linux/glibc only. --legacy swaps in the old String-style monitor, Serial and noise-log lines
+// (std::string standing in for Arduino String) to show what the path allocated before.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. heap_soak.cpp -o heap_soak
+//
+// Usage:
+//   heap_soak [--days N] [--seed N] [--legacy]
+//
+// Exit status is 1 if any steady-state frame allocated.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+
+#include "clock_service.h"
+#include "event_log.h"
+#include "event_queue.h"
+#include "heap_stats.h"
+#include "noise_classifier.h"
+#include "noise_classifier_weights.h"
+#include "noise_engine.h"
+#include "power_policy.h"
+#include "ring_log.h"
+
+// ---------------- allocation hooks ----------------
+
+static HeapStats heapStats;
+static bool hooksOn = false;
+
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *__libc_calloc(size_t, size_t);
+extern "C" void *__libc_realloc(void *, size_t);
+extern "C" void __libc_free(void *);
+
+extern "C" void *malloc(size_t n) {
+  void *p = __libc_malloc(n);
+  if (p && hooksOn) heapStats.noteAlloc((uint32_t)n, true);
+  return p;
+}
+
+extern "C" void *calloc(size_t a, size_t b) {
+  void *p = __libc_calloc(a, b);
+  if (p && hooksOn) heapStats.noteAlloc((uint32_t)(a * b), true);
+  return p;
+}
+
+extern "C" void *realloc(void *q, size_t n) {
+  void *p = __libc_realloc(q, n);
+  if (p && hooksOn) heapStats.noteAlloc((uint32_t)n, true);
+  return p;
+}
+
+extern "C" void free(void *p) {
+  if (p && hooksOn) heapStats.noteFree(true);
+  __libc_free(p);
+}
+
+// ---------------- firmware stand-ins ----------------
+
+static const int BUFFER_LEN = 256;
+static const double NOISE_FLOOR = 25000;
+static const double SENSITIVITY = 0.5;
+static const float SMOOTH_ALPHA = 0.1f;
+
+struct MemDisk {
+  static const uint32_t SECTORS = 2048;   // 1 MB region
+  uint8_t data[SECTORS][RING_SECTOR_BYTES];
+  uint32_t sectorCount() { return SECTORS; }
+  bool readSector(uint32_t i, uint8_t *b) {
+    memcpy(b, data[i], RING_SECTOR_BYTES);
+    return true;
+  }
+  bool writeSector(uint32_t i, const uint8_t *b) {
+    memcpy(data[i], b, RING_SECTOR_BYTES);
+    return true;
+  }
+};
+
+struct Rng {
+  uint64_t s;
+  uint32_t next() {
+    s ^= s << 13;
+    s ^= s >> 7;
+    s ^= s << 17;
+    return (uint32_t)s;
+  }
+  float uniform() { return (next() >> 8) * (1.0f / 16777216.0f); }
+};
+
+static MemDisk disk;
+static RingLog<MemDisk> dbRing;
+static RingCursor dbRingTail;
+static NoiseEngine engine;
+static NoiseClassifier classifier;
+static PowerPolicy power;
+static ClockService clockSvc;
+static EventQueue<16> eventQueue;
+static StructLog<6144> eventLog;
+static StructLog<2048> monitorLog;
+static int32_t pool[8][BUFFER_LEN];
+
+static int64_t monoUs = 0;
+static uint32_t nowMs() { return (uint32_t)(monoUs / 1000); }
+
+static char noiseLogBuf[512];
+static size_t noiseLogLen = 0;
+static uint32_t noiseLogFirstMs = 0;
+static uint64_t noiseLogBytes = 0;
+static uint64_t serialBytes = 0;
+static uint32_t eventLogSerialSeq = 0;
+static uint32_t warnings = 0;
+
+static bool legacy = false;
+static std::string legacyMonitor[80];
+static int legacyMonitorCount = 0;
+
+#define EVLOG(sub, level, ...) eventLog.log(nowMs(), (sub), (level), __VA_ARGS__)
+
+static void flushNoiseLog() {
+  if (noiseLogLen == 0) return;
+  heapStats.markEvent();
+  noiseLogBytes += noiseLogLen;
+  noiseLogLen = 0;
+}
+
+static void logNoise(int value) {
+  if (legacy) {
+    std::string line = "Time(ms): " + std::to_string(nowMs()) + " | dB: " + std::to_string(value) + "\r\n";
+    noiseLogBytes += line.size();
+    return;
+  }
+  char line[48];
+  int n = snprintf(line, sizeof(line), "Time(ms): %lu | dB: %d\r\n", (unsigned long)nowMs(), value);
+  if (noiseLogLen + (size_t)n > sizeof(noiseLogBuf)) flushNoiseLog();
+  if (noiseLogLen == 0) noiseLogFirstMs = nowMs();
+  memcpy(noiseLogBuf + noiseLogLen, line, (size_t)n);
+  noiseLogLen += (size_t)n;
+}
+
+static const char *ledName(LedState s) { return s == RED ? "RED" : s == YELLOW ? "YELLOW" : "GREEN"; }
+
+static std::string legacyTimeString() {
+  uint64_t ms = clockSvc.toEpochMs(monoUs);
+  if (ms == 0) return "TIME_NOT_SET";
+  time_t sec = (time_t)(ms / 1000);
+  struct tm t;
+  gmtime_r(&sec, &t);
+  char buf[25];
+  strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &t);
+  return std::string(buf);
+}
+
+static void onViolationStart(void *, uint32_t) { heapStats.markEvent(); }
+static void onViolationReset(void *, uint32_t) { heapStats.markEvent(); }
+
+static void onWarning(void *, WarningLevel level, int durationSec, int value, uint32_t now) {
+  heapStats.markEvent();
+  static const char *const names[] = { "FIRST", "SECOND", "MAJOR", "MAJOR" };
+  PendingEvent e;
+  snprintf(e.id, sizeof(e.id), "evt-%08lu", (unsigned long)++warnings);
+  pendingEventCopy(e.groupId, sizeof(e.groupId), e.id);
+  pendingEventCopy(e.level, sizeof(e.level), names[level]);
+  e.durationSeconds = durationSec;
+  e.decibel = value;
+  e.buzzer = 1;
+  e.audio = level >= WARN_MAJOR;
+  pendingEventCopy(e.audioPath, sizeof(e.audioPath), e.audio ? "/rec/x.wav" : "");
+  e.eventTsMs = clockSvc.nowEpochMs(monoUs);
+  e.queuedMs = now;
+  e.zone = 0;
+  EVLOG(LOG_NOISE, LOG_WARN, "{} WARNING (RED {}s) | dB: {}", names[level], durationSec, value);
+  if (!eventQueue.push(e)) {
+    eventQueue.spill(EVQ_SPILL_FULL, [](const char *, int) { return true; });
+    eventQueue.push(e);
+  }
+  EVLOG(LOG_EVQ, LOG_INFO, "Queued RED event | {} | level={} | ram", eventQueue.items[eventQueue.count - 1].id,
+        names[level]);
+}
+
+// ---------------- scenario ----------------
+
+// Target level for the current virtual minute: lessons 07:30-16:30 on weekdays with loud episodes.
+struct Scenario {
+  Rng rng;
+  float base = 40;
+  uint32_t episodeUntilMs = 0;
+  float episodeDb = 0;
+
+  float level(uint64_t ms) {
+    const uint64_t dayMs = 86400000ULL;
+    const int day = (int)(ms / dayMs);
+    const uint32_t tod = (uint32_t)(ms % dayMs);
+    const bool lesson = (day % 7) < 5 && tod >= 27000000u && tod < 59400000u;
+    base = lesson ? 58 : 38;
+    const uint32_t now = (uint32_t)ms;
+    if (lesson && (int32_t)(now - episodeUntilMs) > 0 && rng.uniform() < 0.00004f) {
+      episodeUntilMs = now + 5000 + (rng.next() % 120000);
+      episodeDb = 70 + rng.uniform() * 12;
+    }
+    float v = ((int32_t)(episodeUntilMs - now) > 0) ? episodeDb : base;
+    return v + (rng.uniform() + rng.uniform() + rng.uniform() - 1.5f) * 4.0f;
+  }
+};
+
+int main(int argc, char **argv) {
+  int days = 30;
+  uint64_t seed = 7;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--days") && i + 1 < argc) days = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--legacy")) legacy = true;
+    else {
+      fprintf(stderr, "usage: heap_soak [--days N] [--seed N] [--legacy]\n");
+      return 2;
+    }
+  }
+
+  // Synthetic mic frames (tone + noise at rising amplitude); the level itself comes from the scenario.
+  Rng frng{ 0x9E3779B97F4A7C15ULL };
+  for (int k = 0; k < 8; k++) {
+    const double amp = 40000.0 * pow(2.0, k);
+    for (int i = 0; i < BUFFER_LEN; i++) {
+      pool[k][i] = (int32_t)(amp * sin(i * 0.3 * (k + 1)) + amp * 0.3 * (frng.uniform() - 0.5f)) << 8;
+    }
+  }
+
+  dbRing.begin(&disk);
+  classifier.model = &NOISE_CLASSIFIER_MODEL;
+  engine.hooks.onViolationStart = onViolationStart;
+  engine.hooks.onWarning = onWarning;
+  engine.hooks.onViolationReset = onViolationReset;
+
+  Scenario sc;
+  sc.rng.s = seed * 2654435761ULL + 1;
+  Rng jitter{ seed + 99 };
+
+  const int64_t endUs = (int64_t)days * 86400LL * 1000000LL;
+  const int64_t driftPpm = 40;
+  const int64_t epoch0Us = 1767225600LL * 1000000LL;   // 2026-01-01 00:00:00 UTC
+  int64_t nextNtpUs = 45LL * 1000000LL;
+  uint32_t lastSyncMs = 0, lastUploadMs = 0, lastEventsReadMs = 0, lastMonitorMs = 0, lastLogMs = 0;
+  uint32_t lastDbSampleMs = 0, lastDbRecordMs = 0;
+  int lastDbLogged10 = -999999, lastMonitorDb = -1, lastLoggedDb = 0;
+  LedState lastMonitorState = GREEN;
+  float smoothDB = 0;
+  uint64_t frameAllocsMax = 0, uploaded = 0, eventsRendered = 0, dbUploaded = 0, preSyncSamples = 0;
+  char line[LOG_MAX_RECORD + 64];
+
+  hooksOn = true;
+  while (monoUs < endUs) {
+    const uint32_t now = nowMs();
+
+    // ---- outside the frame: clock, sync tick, hourly db upload, /events reads ----
+    if (monoUs >= nextNtpUs) {
+      const int64_t trueEpoch = epoch0Us + monoUs + monoUs * driftPpm / 1000000LL;
+      clockSvc.discipline(monoUs, trueEpoch + (int64_t)(jitter.next() % 20000) - 10000, CLOCK_NTP);
+      nextNtpUs = monoUs + 3600LL * 1000000LL;
+    }
+    if (now - lastSyncMs >= power.syncIntervalMs()) {
+      lastSyncMs = now;
+      while (eventQueue.count > 0) {
+        eventQueue.noteUploaded(eventQueue.items[0], now);
+        eventQueue.remove(0);
+        uploaded++;
+      }
+    }
+    if (now - lastEventsReadMs >= 600000) {
+      lastEventsReadMs = now;
+      eventLog.forEach(0, [&](const LogRecord &r) { eventsRendered += logFormatMessage(r, line, sizeof(line)); });
+    }
+
+    // ---- frame: same order as loop() ----
+    heapStats.beginFrame();
+    const float target = sc.level((uint64_t)now);
+    int k = (int)((target - 35) / 7);
+    k = k < 0 ? 0 : (k > 7 ? 7 : k);
+    const int32_t *samples = pool[k];
+
+    double sum = 0;
+    for (int i = 0; i < BUFFER_LEN; i++) {
+      double s = samples[i];
+      sum += s * s;
+    }
+    double rms = sqrt(sum / BUFFER_LEN) - NOISE_FLOOR;
+    volatile int micDb = (int)(20.0 * log10((rms > 0 ? rms : 0) + 1) * SENSITIVITY);
+    (void)micDb;
+    const int rawDB = (int)lroundf(target);
+
+    if (classifier.wantFrame()) {
+      classifier.addFrame(samples, BUFFER_LEN, 14, now);
+      classifier.noteCost(300);
+    }
+    smoothDB = smoothDB + SMOOTH_ALPHA * (rawDB - smoothDB);
+    const int smoothInt = (int)smoothDB;
+
+    if (legacy) {
+      std::string s = std::string("Raw: ") + std::to_string(rawDB) + " | Smooth: " + std::to_string(smoothInt);
+      serialBytes += s.size();
+    } else {
+      serialBytes += (uint32_t)snprintf(line, sizeof(line), "Raw: %d | Smooth: %d", rawDB, smoothInt);
+    }
+
+    const LedState led = engine.updateLed(smoothInt);
+    engine.handleWarnings(smoothInt, now, classifier.suppress(now));
+    if (power.update(now, rawDB >= engine.cfg.yellowThreshold, led == GREEN)) heapStats.markEvent();
+
+    if (now - lastDbSampleMs >= 100) {
+      lastDbSampleMs = now;
+      const int db10 = (int)lroundf(smoothDB * 10.0f);
+      const bool changed = lastDbLogged10 == -999999 || abs(db10 - lastDbLogged10) >= 10;
+      if (changed || lastDbRecordMs == 0 || now - lastDbRecordMs >= 8000) {
+        const uint64_t tsMs = clockSvc.nowEpochMs(monoUs);
+        if (tsMs == 0) {
+          preSyncSamples++;
+        } else {
+          uint8_t rec[10];
+          const int16_t v = (int16_t)db10;
+          memcpy(rec, &tsMs, 8);
+          memcpy(rec + 8, &v, 2);
+          dbRing.append(rec, sizeof(rec), now);
+        }
+        lastDbLogged10 = db10;
+        lastDbRecordMs = now;
+      }
+    }
+    dbRing.tick(now);
+
+    if (now - lastUploadMs >= 3600000) {
+      heapStats.markEvent();
+      lastUploadMs = now;
+      dbRing.flush();
+      while (dbRing.hasData(dbRingTail)) {
+        dbRingTail = dbRing.read(dbRingTail, 60, [&](const uint8_t *, uint8_t) { dbUploaded++; });
+      }
+    }
+
+    if (now - lastMonitorMs >= 250) {
+      if (smoothInt != lastMonitorDb || led != lastMonitorState) {
+        if (legacy) {
+          std::string m = legacyTimeString();
+          m += " | dB: ";
+          m += std::to_string(smoothInt);
+          m += " | LED: ";
+          m += ledName(led);
+          if (legacyMonitorCount < 80) {
+            legacyMonitor[legacyMonitorCount++] = m;
+          } else {
+            for (int i = 1; i < 80; i++) legacyMonitor[i - 1] = legacyMonitor[i];
+            legacyMonitor[79] = m;
+          }
+        } else {
+          monitorLog.log(now, LOG_MON, LOG_INFO, "dB: {} | LED: {}", smoothInt, ledName(led));
+        }
+        lastMonitorDb = smoothInt;
+        lastMonitorState = led;
+      }
+      lastMonitorMs = now;
+    }
+
+    eventLogSerialSeq = eventLog.forEach(eventLogSerialSeq, [&](const LogRecord &r) {
+      serialBytes += logFormatMessage(r, line, sizeof(line));
+    }, 4);
+
+    if (now - lastLogMs >= 2000 && abs(smoothInt - lastLoggedDb) >= 2) {
+      logNoise(smoothInt);
+      lastLoggedDb = smoothInt;
+      lastLogMs = now;
+    }
+    if (noiseLogLen > 0 && now - noiseLogFirstMs >= 60000) flushNoiseLog();
+
+    const uint32_t n = heapStats.endFrame();
+    if (n > frameAllocsMax) frameAllocsMax = n;
+
+    monoUs += (int64_t)power.frameIntervalMs() * 1000 + 2000;   // frame period + ~2 ms of work
+  }
+  hooksOn = false;
+
+  const uint32_t steadyFrames = heapStats.frames - heapStats.eventFrames;
+  printf("mode:                 %s\n", legacy ? "legacy (String-style lines)" : "current");
+  printf("simulated:            %d days, %u frames (%u quiet entries)\n", days, heapStats.frames, power.quietEntries);
+  printf("event frames:         %u (warnings=%u, events uploaded=%llu, db records uploaded=%llu)\n",
+         heapStats.eventFrames, warnings, (unsigned long long)uploaded, (unsigned long long)dbUploaded);
+  printf("steady frames:        %u\n", steadyFrames);
+  printf("steady alloc frames:  %u\n", heapStats.steadyAllocFrames);
+  printf("steady allocations:   %u (%.3f per steady frame)\n", heapStats.steadyAllocs,
+         steadyFrames ? (double)heapStats.steadyAllocs / steadyFrames : 0.0);
+  printf("max allocs in frame:  %llu\n", (unsigned long long)frameAllocsMax);
+  printf("all allocations:      %u (%llu KB), frees %u\n", heapStats.loopAllocs,
+         (unsigned long long)(heapStats.loopAllocBytes / 1024), heapStats.loopFrees);
+  printf("log ring:             written=%u evicted=%u; monitor written=%u\n", eventLog.written, eventLog.evicted,
+         monitorLog.written);
+  printf("clock:                drift=%ld ppb syncs=%u clamped=%u; pre-sync samples=%llu\n", (long)clockSvc.driftPpb,
+         clockSvc.syncs, clockSvc.clampedReads, (unsigned long long)preSyncSamples);
+  return heapStats.steadyAllocFrames == 0 ? 0 : 1;
+}
@@ -0,0 +1,365 @@
+// Host harness for the live-level multicast feed (live_feed.h, live_feed_rx.h).
+//
+// The format and table checks run the codec, the sender's pacing and the receiver's sequence
+// accounting on hand-made datagrams. The loopback runs simulate a building: every sender is its
+// own socket (its own source port, like a separate device) sending real datagrams to the group on
+// 127.0.0.1 at the firmware's frame rate, with phases spread across the frame. A receiver thread
+// aggregates them with LiveFeedReceiver; the run reports datagrams per second, loss and the
+// receiver's CPU time (its thread clock), per datagram and as a share of one core.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -pthread -I.. live_feed_bench.cpp -o live_feed_bench
+//
+// Usage:
+//   live_feed_bench selftest                    format, pacer and table checks plus a loopback
+//                                               run of 300 senders (exit status 1 on failure)
+//   live_feed_bench bench [seconds]             100..1000 senders, per frame and at 4 Hz
+//   live_feed_bench run <senders> <hz> [seconds]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "live_feed_rx.h"
+
+static const char *GROUP = "239.255.60.60";
+static const uint16_t PORT = LIVE_FEED_PORT + 17;   // stay off a real feed on the same host
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+static uint64_t clockNs(clockid_t id) {
+  timespec ts;
+  clock_gettime(id, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t wallMs() { return (uint32_t)(clockNs(CLOCK_MONOTONIC) / 1000000); }
+
+static LiveFeedFrame makeFrame(const char *id, uint32_t seq, uint8_t zones) {
+  LiveFeedFrame f;
+  snprintf(f.id, sizeof(f.id), "%s", id);
+  f.seq = seq;
+  f.tsMs = 1760000000000ull + seq * 50ull;
+  f.zones = zones;
+  for (int z = 0; z < zones; z++) {
+    f.db10[z] = (int16_t)(450 + 10 * z + (int)(seq % 200));
+    f.led[z] = (uint8_t)((seq / 40 + z) % 3);
+  }
+  return f;
+}
+
+// ---------------------------------------------------------------- format
+
+static void formatChecks() {
+  uint8_t p[LIVE_FEED_MAX_BYTES];
+  LiveFeedFrame f = makeFrame("esp32_noise_01", 0xA1B2C3D4u, 1);
+  f.db10[0] = -123;
+  f.flags = LIVE_FLAG_UPTIME;
+  size_t n = liveFeedEncode(p, sizeof(p), f);
+  expect(n == 35, "one-zone datagram is 35 bytes");
+  LiveFeedFrame g;
+  bool ok = liveFeedDecode(p, n, g) && !strcmp(g.id, f.id) && g.seq == f.seq && g.tsMs == f.tsMs && g.zones == 1 &&
+            g.flags == LIVE_FLAG_UPTIME && g.db10[0] == -123 && g.led[0] == f.led[0];
+  expect(ok, "round trip, one zone, negative level");
+
+  f = makeFrame("esp32_noise_01", 7, 2);
+  n = liveFeedEncode(p, sizeof(p), f);
+  ok = n == 38 && liveFeedDecode(p, n, g) && g.zones == 2 && g.db10[1] == f.db10[1] && g.led[1] == f.led[1];
+  expect(ok, "round trip, two zones");
+
+  char longId[LIVE_FEED_MAX_ID + 2];
+  memset(longId, 'x', sizeof(longId) - 1);
+  longId[sizeof(longId) - 1] = '\0';
+  LiveFeedFrame big = makeFrame("x", 1, 2);
+  memcpy(big.id, longId, LIVE_FEED_MAX_ID);
+  big.id[LIVE_FEED_MAX_ID] = '\0';
+  n = liveFeedEncode(p, sizeof(p), big);
+  expect(n == LIVE_FEED_MAX_BYTES, "longest id fills LIVE_FEED_MAX_BYTES");
+  expect(liveFeedEncode(p, n - 1, big) == 0, "encode refuses a short buffer");
+  LiveFeedFrame bad = makeFrame("a", 1, 3);
+  expect(liveFeedEncode(p, sizeof(p), bad) == 0, "encode refuses three zones");
+  bad = makeFrame("", 1, 1);
+  expect(liveFeedEncode(p, sizeof(p), bad) == 0, "encode refuses an empty id");
+
+  f = makeFrame("room_12", 3, 1);
+  n = liveFeedEncode(p, sizeof(p), f);
+  uint8_t q[LIVE_FEED_MAX_BYTES + 1];
+  bool allRejected = true;
+  for (size_t len = 0; len < n; len++) allRejected &= !liveFeedDecode(p, len, g);
+  memcpy(q, p, n);
+  q[n] = 0;
+  allRejected &= !liveFeedDecode(q, n + 1, g);
+  expect(allRejected, "truncated and padded datagrams rejected");
+  const size_t fields[] = { 0, 1, 2, 3, 16 };
+  allRejected = true;
+  for (size_t i : fields) {
+    memcpy(q, p, n);
+    q[i] ^= 0x40;
+    allRejected &= !liveFeedDecode(q, n, g);
+  }
+  expect(allRejected, "bad magic, version, id length or zone count rejected");
+
+  std::mt19937 rng(44);
+  uint32_t accepted = 0;
+  for (int i = 0; i < 200000; i++) {
+    size_t len = rng() % (LIVE_FEED_MAX_BYTES + 2);
+    for (size_t k = 0; k < len; k++) q[k] = (uint8_t)rng();
+    if (len >= 3 && (rng() & 1)) {
+      q[0] = 'N';
+      q[1] = 'L';
+      q[2] = LIVE_FEED_VERSION;
+    }
+    if (liveFeedDecode(q, len, g)) {
+      accepted++;
+      ok = strlen(g.id) >= 1 && strlen(g.id) <= (size_t)LIVE_FEED_MAX_ID && g.zones >= 1 && g.zones <= LIVE_FEED_MAX_ZONES;
+      if (!ok) break;
+    }
+  }
+  expect(ok, "random datagrams: anything accepted is well-formed");
+}
+
+// ---------------------------------------------------------------- pacer
+
+static void pacerChecks() {
+  LiveFeedPacer every;
+  uint8_t led[2] = { 0, 0 };
+  int sent = 0;
+  for (uint32_t t = 0; t < 1000; t += 50) sent += every.due(t, led, 2);
+  expect(sent == 20, "interval 0: every frame");
+
+  LiveFeedPacer slow;
+  slow.intervalMs = 250;
+  sent = 0;
+  for (uint32_t t = 0; t < 1000; t += 50) sent += slow.due(t, led, 2);
+  expect(sent == 4, "interval 250 ms at 50 ms frames: 4 per second");
+
+  LiveFeedPacer change;
+  change.intervalMs = 1000;
+  expect(change.due(0, led, 2), "first frame always goes out");
+  expect(!change.due(50, led, 2), "held back inside the interval");
+  led[1] = 2;
+  expect(change.due(100, led, 2), "zone 2 turning red goes out at once");
+  expect(!change.due(150, led, 2), "and only once");
+  expect(change.due(1100, led, 2), "interval restarts from the LED send");
+}
+
+// ---------------------------------------------------------------- table
+
+static void tableChecks() {
+  LiveFeedTable<16> t;
+  uint32_t now = 1000;
+  for (uint32_t s = 0; s < 10; s++) t.update(makeFrame("a", s, 1), now += 50);
+  LiveFeedDevice *a = t.find("a");
+  expect(a && a->received == 10 && a->lost == 0 && a->seq == 9, "in-order stream");
+
+  t.update(makeFrame("a", 12, 1), now += 50);
+  expect(a->lost == 2 && a->seq == 12, "gap of two counted as lost");
+  t.update(makeFrame("a", 11, 1), now += 1);
+  expect(a->lost == 1 && a->late == 1 && a->seq == 12, "late datagram fills the gap and is not applied");
+  t.update(makeFrame("a", 12, 1), now += 1);
+  expect(a->late == 2 && a->received == 11, "duplicate counted, not applied");
+
+  t.update(makeFrame("a", 500, 1), now += 10000);
+  expect(a->lost == 1 && a->seq == 500 && a->restarts == 0, "after silence a jump re-syncs without loss");
+  t.update(makeFrame("a", 0, 1), now += 50);
+  expect(a->restarts == 1 && a->seq == 0 && a->received == 13, "sequence far back: reboot, re-synced");
+  t.update(makeFrame("a", 1, 1), now += 50);
+  expect(a->lost == 1 && a->seq == 1, "counting resumes after the reboot");
+  expect(t.online(*a, now) && !t.online(*a, now + 5001), "online until staleMs of silence");
+
+  LiveFeedTable<8> small;
+  char id[8];
+  for (int i = 0; i < 10; i++) {
+    snprintf(id, sizeof(id), "d%d", i);
+    small.update(makeFrame(id, 0, 1), 0);
+  }
+  expect(small.count == 7 && small.dropped == 3, "full table keeps one hole and counts drops");
+  expect(small.find("d0") && !small.find("d9"), "lookups still terminate when full");
+}
+
+// ---------------------------------------------------------------- loopback
+
+struct RunResult {
+  int senders = 0;
+  uint32_t hz = 0;
+  uint64_t sent = 0;
+  uint64_t sendErrors = 0;
+  uint64_t received = 0;
+  int devices = 0;
+  uint64_t lost = 0;
+  double seconds = 0;
+  double rxCpuS = 0;
+  uint64_t batches = 0;
+};
+
+static bool runLoopback(int senders, uint32_t hz, double seconds, RunResult &res) {
+  LiveFeedReceiver<2048> *rx = new LiveFeedReceiver<2048>();
+  if (!rx->open(GROUP, PORT, "127.0.0.1")) {
+    perror("receiver");
+    delete rx;
+    return false;
+  }
+  std::vector<int> fds;
+  in_addr lo;
+  inet_pton(AF_INET, "127.0.0.1", &lo);
+  for (int i = 0; i < senders; i++) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    unsigned char loop = 1;
+    if (fd < 0 || setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &lo, sizeof(lo)) != 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0) {
+      perror("sender");
+      for (int s : fds) close(s);
+      rx->close();
+      delete rx;
+      return false;
+    }
+    fds.push_back(fd);
+  }
+  sockaddr_in to = {};
+  to.sin_family = AF_INET;
+  to.sin_port = htons(PORT);
+  inet_pton(AF_INET, GROUP, &to.sin_addr);
+
+  std::atomic<bool> stop(false);
+  uint64_t rxCpuNs = 0;
+  std::thread rxThread([&] {
+    const uint64_t c0 = clockNs(CLOCK_THREAD_CPUTIME_ID);
+    while (!stop.load()) rx->poll(20, wallMs());
+    while (rx->poll(50, wallMs()) > 0) {
+    }
+    rxCpuNs = clockNs(CLOCK_THREAD_CPUTIME_ID) - c0;
+  });
+
+  // Each sender sends on its own period with its phase spread over the frame, like devices that
+  // booted at different times.
+  const uint64_t periodNs = 1000000000ull / hz;
+  std::vector<uint64_t> due(senders);
+  std::vector<uint32_t> seq(senders, 0);
+  std::mt19937 rng(7);
+  const uint64_t t0 = clockNs(CLOCK_MONOTONIC);
+  for (int i = 0; i < senders; i++) due[i] = t0 + periodNs * (uint64_t)i / (uint64_t)senders;
+  const uint64_t end = t0 + (uint64_t)(seconds * 1e9);
+  char id[LIVE_FEED_MAX_ID + 1];
+  uint8_t p[LIVE_FEED_MAX_BYTES];
+  for (;;) {
+    const uint64_t now = clockNs(CLOCK_MONOTONIC);
+    if (now >= end) break;
+    for (int i = 0; i < senders; i++) {
+      if (due[i] > now) continue;
+      snprintf(id, sizeof(id), "sim_room_%04d", i);
+      LiveFeedFrame f = makeFrame(id, seq[i]++, (uint8_t)(1 + (i & 1)));
+      f.db10[0] = (int16_t)(400 + rng() % 400);
+      size_t n = liveFeedEncode(p, sizeof(p), f);
+      if (sendto(fds[i], p, n, 0, (sockaddr *)&to, sizeof(to)) == (ssize_t)n) {
+        res.sent++;
+      } else {
+        res.sendErrors++;
+      }
+      due[i] += periodNs;
+    }
+    timespec ts = { 0, 1000000 };
+    nanosleep(&ts, nullptr);
+  }
+  res.seconds = (double)(clockNs(CLOCK_MONOTONIC) - t0) / 1e9;
+  stop.store(true);
+  rxThread.join();
+
+  res.senders = senders;
+  res.hz = hz;
+  res.received = rx->datagrams;
+  res.devices = rx->table.count;
+  res.batches = rx->batches;
+  for (const LiveFeedDevice &d : rx->table.dev) {
+    if (!d.used) continue;
+    res.lost += d.lost;
+    // Datagrams lost after a device's last received one leave no gap behind them.
+    const int i = atoi(d.id + strlen("sim_room_"));
+    if (i >= 0 && i < senders && seq[i] > 0) res.lost += seq[i] - 1 - d.seq;
+  }
+  res.rxCpuS = (double)rxCpuNs / 1e9;
+  for (int s : fds) close(s);
+  rx->close();
+  delete rx;
+  return true;
+}
+
+static void printHeader() {
+  printf("  senders    hz   datagrams/s    loss %%   rx cpu %%   rx us/datagram   per batch\n");
+}
+
+static void printRun(const RunResult &r) {
+  const double rate = (double)r.received / r.seconds;
+  const double loss = r.sent ? 100.0 * (double)(r.sent - (r.received < r.sent ? r.received : r.sent)) / (double)r.sent : 0;
+  printf("  %7d  %4u   %11.0f   %7.3f   %8.2f   %14.2f   %9.1f\n", r.senders, r.hz, rate, loss,
+         100.0 * r.rxCpuS / r.seconds, r.received ? r.rxCpuS * 1e6 / (double)r.received : 0,
+         r.batches ? (double)r.received / (double)r.batches : 0);
+}
+
+static void loopbackChecks() {
+  RunResult r;
+  if (!runLoopback(300, 20, 2.0, r)) {
+    expect(false, "loopback multicast available");
+    return;
+  }
+  printHeader();
+  printRun(r);
+  expect(r.sendErrors == 0, "300 senders: no send errors");
+  expect(r.devices == 300, "300 senders: every device in the table");
+  expect(r.received + r.lost == r.sent, "300 senders: received + sequence gaps account for every datagram");
+  expect(r.received >= r.sent * 99 / 100, "300 senders at 20 Hz: under 1% loss");
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) {
+    formatChecks();
+    pacerChecks();
+    tableChecks();
+    loopbackChecks();
+    return fails ? 1 : 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "bench")) {
+    double seconds = argc >= 3 ? atof(argv[2]) : 5.0;
+    if (seconds <= 0) seconds = 5.0;
+    printf("loopback, %.0f s per run; every sender is its own socket\n", seconds);
+    printHeader();
+    const int counts[] = { 100, 300, 1000 };
+    const uint32_t rates[] = { 20, 4 };
+    for (uint32_t hz : rates) {
+      for (int n : counts) {
+        RunResult r;
+        if (!runLoopback(n, hz, seconds, r)) return 1;
+        printRun(r);
+      }
+    }
+    return 0;
+  }
+  if (argc >= 4 && !strcmp(argv[1], "run")) {
+    int n = atoi(argv[2]);
+    uint32_t hz = (uint32_t)atoi(argv[3]);
+    double seconds = argc >= 5 ? atof(argv[4]) : 5.0;
+    if (n <= 0 || hz == 0 || seconds <= 0) return 2;
+    RunResult r;
+    if (!runLoopback(n, hz, seconds, r)) return 1;
+    printHeader();
+    printRun(r);
+    return 0;
+  }
+  fprintf(stderr, "usage: live_feed_bench selftest | bench [seconds] | run <senders> <hz> [seconds]\n");
+  return 2;
+}
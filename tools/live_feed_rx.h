@@ -0,0 +1,95 @@
+#pragma once
+
+// Host-side receiver for the live-level feed (live_feed.h), for display and aggregator programs.
+//
+// Joins the multicast group on one interface, then poll() waits for traffic and drains the
+// socket in recvmmsg() batches into a LiveFeedTable, so a burst of datagrams costs one wakeup
+// and one system call per batch rather than one each. Linux only.
+//
+//   LiveFeedReceiver<1024> rx;
+//   if (!rx.open("239.255.60.60", LIVE_FEED_PORT, "0.0.0.0")) ...
+//   for (;;) {
+//     rx.poll(250, nowMs());
+//     for (const LiveFeedDevice &d : rx.table.dev) if (d.used) draw(d, rx.table.online(d, nowMs()));
+//   }
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../live_feed.h"
+
+template <int CAP>
+struct LiveFeedReceiver {
+  static const int BATCH = 64;
+
+  int fd = -1;
+  LiveFeedTable<CAP> table;
+  uint64_t datagrams = 0;
+  uint64_t bad = 0;       // not a well-formed datagram of this version
+  uint64_t batches = 0;
+
+  // iface is the local address whose interface joins the group ("0.0.0.0" lets the kernel pick).
+  bool open(const char *group, uint16_t port, const char *iface) {
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) return false;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    int rcvbuf = 1 << 20;   // rides out a scheduling hiccup at thousands of datagrams per second
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    a.sin_addr.s_addr = htonl(INADDR_ANY);
+    ip_mreq m = {};
+    if (bind(fd, (sockaddr *)&a, sizeof(a)) != 0 || inet_pton(AF_INET, group, &m.imr_multiaddr) != 1 ||
+        inet_pton(AF_INET, iface, &m.imr_interface) != 1 ||
+        setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &m, sizeof(m)) != 0) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+  }
+
+  // Waits up to timeoutMs for the first datagram, then handles everything queued. Returns the
+  // datagrams handled, or -1 on a socket error.
+  int poll(int timeoutMs, uint32_t nowMs) {
+    pollfd p = { fd, POLLIN, 0 };
+    int r = ::poll(&p, 1, timeoutMs);
+    if (r <= 0) return r < 0 && errno != EINTR ? -1 : 0;
+    uint8_t buf[BATCH][LIVE_FEED_MAX_BYTES + 1];   // one spare byte so oversized datagrams fail decode
+    iovec iov[BATCH];
+    mmsghdr msgs[BATCH];
+    for (int i = 0; i < BATCH; i++) {
+      iov[i] = { buf[i], sizeof(buf[i]) };
+      msgs[i] = {};
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int handled = 0;
+    for (;;) {
+      int n = recvmmsg(fd, msgs, BATCH, 0, nullptr);
+      if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? handled : -1;
+      batches++;
+      for (int i = 0; i < n; i++) {
+        LiveFeedFrame f;
+        if (!liveFeedDecode(buf[i], msgs[i].msg_len, f)) {
+          bad++;
+          continue;
+        }
+        table.update(f, nowMs);
+      }
+      datagrams += (uint64_t)n;
+      handled += n;
+      if (n < BATCH) return handled;
+    }
+  }
+};
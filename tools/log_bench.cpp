@@ -0,0 +1,129 @@
+// Host benchmark for the event log: the old eager path (strftime + String concatenation into a
+// shifted String array, as appendEventLog() did) versus StructLog (event_log.h).
+//
+// Reports, for a mix of the firmware's own log lines:
+//   - ns per call for each path, plus a call filtered out by the level threshold
+//   - bytes of RAM per retained entry: ring bytes / records for StructLog, and for the old path
+//     an Arduino String on ESP32 (16-byte object, heap block of len+1 rounded to 4, 8 bytes of
+//     allocator header once the text no longer fits the object's inline buffer)
+// Host timings are only a ratio; the absolute numbers on the ESP32 are several times higher.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. log_bench.cpp -o log_bench
+//
+// Usage:
+//   log_bench [iterations]   (default 2000000)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <string>
+
+#include "event_log.h"
+
+static const int OLD_LOG_MAX = 40;
+static std::string oldLog[OLD_LOG_MAX];
+static int oldLogCount = 0;
+
+static std::string oldTimeString() {
+  time_t sec = time(nullptr);
+  struct tm t;
+  localtime_r(&sec, &t);
+  char buf[25];
+  strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &t);
+  return std::string(buf);
+}
+
+static void oldAppend(const std::string &line) {
+  if (oldLogCount < OLD_LOG_MAX) {
+    oldLog[oldLogCount++] = line;
+    return;
+  }
+  for (int i = 1; i < OLD_LOG_MAX; i++) oldLog[i - 1] = oldLog[i];
+  oldLog[OLD_LOG_MAX - 1] = line;
+}
+
+static const char *EVENT_ID = "3f2b9c1e-7a44-4d0e-9a61-2c5e8b7d0f13";
+
+static void oldLine(int k, int i) {
+  switch (k) {
+    case 0:
+      oldAppend(oldTimeString() + " | Supabase insert noise_events OK | " + EVENT_ID + " | HTTP " + std::to_string(201));
+      break;
+    case 1:
+      oldAppend(oldTimeString() + " | DB series upload: batch=" + std::to_string(i & 63));
+      break;
+    case 2:
+      oldAppend(oldTimeString() + " | dB: " + std::to_string(40 + (i & 31)) + " | LED: " + "GREEN");
+      break;
+    default:
+      oldAppend(oldTimeString() + " | Queued RED event | " + EVENT_ID + " | level=" + "FIRST" + " | ram");
+      break;
+  }
+}
+
+template <int N>
+static void newLine(StructLog<N> &log, int k, int i) {
+  const uint32_t ms = (uint32_t)i;
+  switch (k) {
+    case 0: log.log(ms, LOG_SYNC, LOG_INFO, "Supabase insert noise_events OK | {} | HTTP {}", EVENT_ID, 201); break;
+    case 1: log.log(ms, LOG_DBS, LOG_INFO, "DB series upload: batch={}", i & 63); break;
+    case 2: log.log(ms, LOG_MON, LOG_INFO, "dB: {} | LED: {}", 40 + (i & 31), "GREEN"); break;
+    default: log.log(ms, LOG_EVQ, LOG_INFO, "Queued RED event | {} | level={} | {}{}{}", EVENT_ID, "FIRST", "ram", "", ""); break;
+  }
+}
+
+static size_t arduinoStringBytes(size_t len) {
+  const size_t object = 16;
+  if (len < 11) return object;
+  return object + ((len + 1 + 3) & ~(size_t)3) + 8;
+}
+
+template <typename Fn>
+static double nsPerCall(int iters, Fn fn) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; i++) fn(i);
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+}
+
+int main(int argc, char **argv) {
+  int iters = argc > 1 ? atoi(argv[1]) : 2000000;
+  if (iters < 1000) iters = 1000;
+
+  static StructLog<6144> ring;
+  static StructLog<6144> quiet;
+  for (int s = 0; s < LOG_SUB_COUNT; s++) quiet.threshold[s] = LOG_WARN;
+
+  double oldNs = nsPerCall(iters, [](int i) { oldLine(i & 3, i); });
+  double newNs = nsPerCall(iters, [](int i) { newLine(ring, i & 3, i); });
+  double offNs = nsPerCall(iters, [](int i) { newLine(quiet, i & 3, i); });
+
+  // Retained-entry cost over the same mix, after the ring has wrapped many times.
+  size_t oldBytes = 0;
+  for (int i = 0; i < oldLogCount; i++) oldBytes += arduinoStringBytes(oldLog[i].size());
+  double oldPer = oldLogCount ? (double)oldBytes / oldLogCount : 0;
+  double newPer = ring.count ? (double)ring.bytesUsed / ring.count : 0;
+
+  // Rendered size of the same records ("YYYY-mm-dd HH:MM:SS | " is 22 bytes), i.e. what an eager
+  // path would hold even with zero allocator overhead.
+  size_t textBytes = 0;
+  char buf[LOG_MAX_RECORD + 64];
+  ring.forEach(0, [&](const LogRecord &r) { textBytes += 22 + logFormatMessage(r, buf, sizeof(buf)); });
+
+  printf("calls:            %d per path\n", iters);
+  printf("eager String:     %8.1f ns/call\n", oldNs);
+  printf("StructLog:        %8.1f ns/call  (%.1fx)\n", newNs, oldNs / newNs);
+  printf("StructLog (off):  %8.1f ns/call\n", offNs);
+  printf("RAM per entry:    String %.1f B, StructLog %.1f B (rendered text %.1f B)\n", oldPer, newPer,
+         ring.count ? (double)textBytes / ring.count : 0.0);
+  printf("retained:         old %d lines in %u B, ring %u records in 6144 B\n", oldLogCount, (unsigned)oldBytes,
+         (unsigned)ring.count);
+  printf("ring: written=%u evicted=%u filtered(off)=%u\n", (unsigned)ring.written, (unsigned)ring.evicted,
+         (unsigned)quiet.filtered);
+  return 0;
+}
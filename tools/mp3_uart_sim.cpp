@@ -0,0 +1,350 @@
+// Host harness for the non-blocking MP3 driver (mp3_driver.h).
+//
+// A fake UART port delivers scripted byte streams at 9600 baud (about one byte per ms of virtual
+// time) and records every frame the driver writes with its send time. A scripted module answers
+// the device query (0x18) after a configurable delay, or not at all, and can corrupt its replies.
+// The driver is ticked every virtual millisecond, as loop() would, and each tick is timed on the
+// wall clock.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. mp3_uart_sim.cpp -o mp3_uart_sim
+//
+// Usage:
+//   mp3_uart_sim selftest            parser, pacing, query/timeout and overflow checks, then a
+//                                    one-hour soak with corrupt replies (exit status 1 on failure)
+//   mp3_uart_sim soak [hours]        soak only, printing counters and tick times
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "mp3_driver.h"
+
+struct TxFrame {
+  uint32_t ms;
+  std::vector<uint8_t> bytes;
+};
+
+struct FakePort {
+  struct RxByte {
+    uint8_t b;
+    uint32_t at;
+  };
+  std::deque<RxByte> rx;
+  std::vector<TxFrame> tx;
+  uint32_t now = 0;
+
+  int available() {
+    int n = 0;
+    for (const RxByte &r : rx) {
+      if (r.at > now) break;
+      n++;
+    }
+    return n;
+  }
+  int read() {
+    if (rx.empty() || rx.front().at > now) return -1;
+    uint8_t b = rx.front().b;
+    rx.pop_front();
+    return b;
+  }
+  size_t write(const uint8_t *p, size_t n) {
+    tx.push_back({now, std::vector<uint8_t>(p, p + n)});
+    return n;
+  }
+
+  // Queues bytes arriving back to back from `at` at 9600 baud (~1.04 ms per byte).
+  void inject(const std::vector<uint8_t> &bytes, uint32_t at) {
+    uint32_t t = at;
+    if (!rx.empty() && rx.back().at > t) t = rx.back().at;
+    for (size_t i = 0; i < bytes.size(); i++) rx.push_back({bytes[i], t + (uint32_t)((i * 1042) / 1000)});
+  }
+};
+
+typedef Mp3Driver<FakePort> Driver;
+
+struct Events {
+  int frames = 0;
+  int replies = 0;
+  int timeouts = 0;
+  uint8_t lastReplyVal = 0;
+  uint32_t lastReplyMs = 0;
+  uint32_t lastTimeoutMs = 0;
+};
+
+static void onFrame(void *ctx, const Mp3Frame &f, uint32_t now) {
+  (void)f;
+  (void)now;
+  ((Events *)ctx)->frames++;
+}
+
+static void onReply(void *ctx, const Mp3Frame &f, uint32_t now) {
+  Events *e = (Events *)ctx;
+  e->replies++;
+  e->lastReplyVal = f.len ? f.data[0] : 0;
+  e->lastReplyMs = now;
+}
+
+static void onTimeout(void *ctx, uint8_t cmd, uint32_t now) {
+  (void)cmd;
+  Events *e = (Events *)ctx;
+  e->timeouts++;
+  e->lastTimeoutMs = now;
+}
+
+struct Rig {
+  FakePort port;
+  Driver drv;
+  Events ev;
+  double maxTickUs = 0;
+  int maxBytesPerTick = 0;
+  std::vector<float> tickUs;
+
+  Rig() {
+    drv.port = &port;
+    drv.hooks.ctx = &ev;
+    drv.hooks.onFrame = onFrame;
+    drv.hooks.onReply = onReply;
+    drv.hooks.onTimeout = onTimeout;
+  }
+
+  void tick() {
+    const uint32_t before = drv.bytesRx;
+    auto t0 = std::chrono::steady_clock::now();
+    drv.tick(port.now);
+    auto t1 = std::chrono::steady_clock::now();
+    const double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    if (us > maxTickUs) maxTickUs = us;
+    tickUs.push_back((float)us);
+    const int n = (int)(drv.bytesRx - before);
+    if (n > maxBytesPerTick) maxBytesPerTick = n;
+  }
+
+  void run(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+      tick();
+      port.now++;
+    }
+  }
+};
+
+static std::vector<uint8_t> frame(uint8_t cmd, std::initializer_list<uint8_t> data) {
+  std::vector<uint8_t> f = {MP3_FRAME_START, (uint8_t)(2 + data.size()), cmd};
+  for (uint8_t b : data) f.push_back(b);
+  f.push_back(MP3_FRAME_END);
+  return f;
+}
+
+// Same sequences as playMP3() / stopMP3() in the sketch.
+static void queuePlay(Driver &d, uint8_t track) {
+  const uint8_t tf = 0x01, vol = 30;
+  const uint8_t ft[2] = {0x01, track};
+  d.send(0x35, &tf, 1, 200);
+  d.send(0x31, &vol, 1, 200);
+  d.send(0x42, ft, 2, 0);
+}
+
+static void queueStop(Driver &d) {
+  const uint8_t tf = 0x01;
+  d.clear();
+  d.send(0x35, &tf, 1, 80);
+  d.send(0x16, nullptr, 0, 80);
+  d.send(0x0E, nullptr, 0, 0);
+}
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+static void parserChecks() {
+  Mp3FrameParser p;
+  auto feedAll = [&](const std::vector<uint8_t> &bytes, std::vector<Mp3Frame> &got) {
+    for (uint8_t b : bytes)
+      if (p.feed(b)) got.push_back(p.frame);
+  };
+
+  std::vector<Mp3Frame> got;
+  feedAll(frame(0x18, {0x02}), got);
+  expect(got.size() == 1 && got[0].cmd == 0x18 && got[0].len == 1 && got[0].data[0] == 2, "parser: clean frame");
+
+  got.clear();
+  feedAll({0x00, 0xFF, 0x13, 0xEF}, got);
+  feedAll(frame(0x3D, {0x00, 0x05}), got);
+  expect(got.size() == 1 && got[0].cmd == 0x3D && got[0].len == 2 && p.bytesSkipped == 4, "parser: skips line noise before a frame");
+
+  got.clear();
+  const uint32_t bad0 = p.framesBad;
+  std::vector<uint8_t> corrupt = frame(0x18, {0x02});
+  corrupt.back() = 0x55;   // lost EF
+  feedAll(corrupt, got);
+  feedAll(frame(0x18, {0x01}), got);
+  expect(got.size() == 1 && got[0].data[0] == 1 && p.framesBad == bad0 + 1, "parser: bad end byte drops one frame, next one parses");
+
+  got.clear();
+  std::vector<uint8_t> early = {MP3_FRAME_START, 0x03, 0x18, 0x02};   // EF replaced by the next start
+  feedAll(early, got);
+  feedAll(frame(0x18, {0x02}), got);
+  expect(got.size() == 1 && p.framesBad == bad0 + 2, "parser: 7E in place of EF starts the next frame");
+
+  got.clear();
+  feedAll({MP3_FRAME_START, 0x01}, got);
+  feedAll({MP3_FRAME_START, 0xF0}, got);
+  feedAll(frame(0x18, {0x02}), got);
+  expect(got.size() == 1 && p.framesBad == bad0 + 4, "parser: rejects LEN < 2 and oversize LEN");
+
+  got.clear();
+  feedAll(frame(0x0E, {}), got);
+  expect(got.size() == 1 && got[0].cmd == 0x0E && got[0].len == 0, "parser: command-only frame");
+}
+
+static void pacingChecks() {
+  Rig r;
+  queuePlay(r.drv, 0x02);
+  r.run(600);
+  const std::vector<TxFrame> &tx = r.port.tx;
+  bool ok = tx.size() == 3 && tx[1].ms - tx[0].ms == 200 && tx[2].ms - tx[1].ms == 200;
+  ok = ok && tx[2].bytes == std::vector<uint8_t>({0x7E, 0x04, 0x42, 0x01, 0x02, 0xEF});
+  expect(ok, "play: select, volume, play with 200 ms gaps, same bytes as before");
+
+  Rig s;
+  queuePlay(s.drv, 0x01);
+  s.run(50);   // select sent, volume and play waiting
+  queueStop(s.drv);
+  s.run(400);
+  ok = s.port.tx.size() == 4 && s.port.tx[1].bytes[2] == 0x35 && s.port.tx[2].bytes[2] == 0x16 && s.port.tx[3].bytes[2] == 0x0E;
+  ok = ok && s.port.tx[1].ms == 200 && s.port.tx[2].ms - s.port.tx[1].ms == 80;
+  expect(ok, "stop: drops the queued play, keeps the gap owed to the last command");
+}
+
+static void queryChecks() {
+  Rig r;
+  r.drv.query(0x18);
+  r.run(5);
+  r.port.inject(frame(0x18, {0x02}), r.port.now + 30);
+  r.run(100);
+  expect(r.ev.replies == 1 && r.ev.lastReplyVal == 2 && r.ev.timeouts == 0, "query: reply delivered through onReply");
+
+  r.drv.query(0x18);
+  r.run(300);
+  expect(r.ev.timeouts == 1 && r.ev.lastTimeoutMs - r.port.tx.back().ms == 180, "query: silence times out after 180 ms");
+
+  r.port.inject(frame(0x18, {0x02}), r.port.now);
+  r.run(20);
+  expect(r.ev.replies == 1 && r.ev.frames == 2, "query: late reply counts as a frame, not as an answer");
+
+  const uint32_t sent0 = r.drv.sent;
+  r.drv.query(0x18);
+  const bool second = r.drv.query(0x18);
+  r.run(5);
+  const uint8_t vol = 10;
+  r.drv.send(0x31, &vol, 1, 0);
+  r.run(5);
+  expect(!second && r.drv.sent == sent0 + 2 && r.drv.queryPending, "query: duplicate skipped, commands still flow while it waits");
+  r.run(300);
+
+  Rig o;
+  int accepted = 0;
+  for (int i = 0; i < 20; i++) accepted += o.drv.send(0x31, &vol, 1, 10) ? 1 : 0;
+  expect(accepted == 12 && o.drv.dropped == 8 && o.drv.maxDepth == 12, "queue: overflow drops and counts instead of blocking");
+}
+
+static void noiseChecks() {
+  Rig r;
+  std::vector<uint8_t> junk(4096);
+  std::mt19937 rng(7);
+  for (uint8_t &b : junk) b = (uint8_t)(rng() & 0xFF);
+  r.port.rx.clear();
+  for (uint8_t b : junk) r.port.rx.push_back({b, 0});   // all of it already in the FIFO
+  r.drv.query(0x18);
+  r.tick();
+  expect(r.maxBytesPerTick == r.drv.rxBudget && r.port.tx.size() == 1, "rx: 4 KB backlog read in budgeted slices, TX not starved");
+  r.run(400);
+  expect(r.port.rx.empty() && r.maxBytesPerTick <= r.drv.rxBudget, "rx: backlog drained over later ticks");
+}
+
+// Probes every 5 s like loop(); the module answers 20-60 ms later, corrupts 5% of replies and
+// ignores 5% of probes. Every probe must end in exactly one reply or one timeout.
+static int soak(double hours, bool verbose) {
+  Rig r;
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<int> pct(0, 99);
+  std::uniform_int_distribution<int> delay(20, 60);
+  const uint32_t total = (uint32_t)(hours * 3600000.0);
+  uint32_t probes = 0, corrupted = 0, ignored = 0, noise = 0;
+  size_t txSeen = 0;
+  for (uint32_t ms = 0; ms < total; ms++) {
+    if (ms % 5000 == 0) {
+      if (r.drv.query(0x18)) probes++;
+    }
+    if (ms % 47000 == 0) queuePlay(r.drv, (uint8_t)(1 + ms % 3));
+    if (pct(rng) == 0 && pct(rng) < 5) {
+      r.port.inject({(uint8_t)(rng() & 0xFF), (uint8_t)(rng() & 0xFF)}, ms);
+      noise++;
+    }
+    r.tick();
+    for (; txSeen < r.port.tx.size(); txSeen++) {
+      const TxFrame &t = r.port.tx[txSeen];
+      if (t.bytes[2] != 0x18) continue;
+      const int p = pct(rng);
+      if (p < 5) {
+        ignored++;
+        continue;
+      }
+      std::vector<uint8_t> reply = frame(0x18, {0x02});
+      if (p < 10) {
+        reply[1 + (rng() % 3)] ^= 0x5A;
+        corrupted++;
+      }
+      r.port.inject(reply, ms + delay(rng));
+    }
+    r.port.now++;
+  }
+  r.run(500);
+
+  // The max includes whatever the host scheduler did mid-tick; the tail percentile is the driver.
+  std::vector<float> &t = r.tickUs;
+  const size_t k = t.size() - 1 - t.size() / 10000;
+  std::nth_element(t.begin(), t.begin() + (long)k, t.end());
+  const double p9999 = t[k];
+
+  const bool accounted = (uint32_t)(r.ev.replies + r.ev.timeouts) == probes;
+  if (verbose || !accounted) {
+    printf("soak %.1f h: probes=%u replies=%d timeouts=%d (ignored=%u corrupted=%u noise bursts=%u)\n", hours, probes,
+           r.ev.replies, r.ev.timeouts, ignored, corrupted, noise);
+    printf("  frames ok=%u bad=%u skipped=%u sent=%u dropped=%u max queue=%d\n", r.drv.parser.framesOk,
+           r.drv.parser.framesBad, r.drv.parser.bytesSkipped, r.drv.sent, r.drv.dropped, r.drv.maxDepth);
+    printf("  tick p99.99 %.2f us, slowest %.2f us, most bytes in one tick %d\n", p9999, r.maxTickUs, r.maxBytesPerTick);
+  }
+  expect(accounted, "soak: every probe ends in one reply or one timeout");
+  expect(r.ev.timeouts >= (int)ignored && r.drv.dropped == 0, "soak: ignored or corrupted probes time out, nothing dropped");
+  expect(p9999 < 50.0 && r.maxBytesPerTick <= r.drv.rxBudget, "soak: ticks stay in the tens of microseconds, reads bounded");
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) {
+    parserChecks();
+    pacingChecks();
+    queryChecks();
+    noiseChecks();
+    soak(1.0, true);
+    return fails ? 1 : 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "soak")) {
+    double hours = argc >= 3 ? atof(argv[2]) : 24.0;
+    if (hours <= 0) hours = 1.0;
+    return soak(hours, true);
+  }
+  fprintf(stderr, "usage: mp3_uart_sim selftest | soak [hours]\n");
+  return 2;
+}
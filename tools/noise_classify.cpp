@@ -0,0 +1,615 @@
+// Host harness for the noise-source classifier (noise_classifier.h).
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. noise_classify.cpp -o noise_classify
+//
+// Clips are 16 kHz mono WAV (16-bit PCM, as written by recordINMP441Wav5s(), or 32-bit PCM),
+// laid out as <dir>/<class>/*.wav with <class> one of crowd, impulsive, tonal, machinery.
+// They are cut into 256-sample frames every 50 ms, exactly what the firmware sees at full rate.
+//
+// Usage:
+//   noise_classify synth <dir> [clips_per_class] [seed]   write synthetic labelled clips
+//   noise_classify train <dir> [-o weights.h] [--epochs N] [--holdout PCT] [--note TEXT]
+//                                                        train, quantize, report held-out int8
+//                                                        accuracy, write noise_classifier_weights.h
+//   noise_classify eval <dir>                            confusion matrix of the compiled-in model
+//   noise_classify bench                                 per-frame and per-window inference cost
+//
+// Typical loop: record clips on the device (/record), sort them into class folders, then
+//   noise_classify train clips -o ../noise_classifier_weights.h && rebuild both.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "noise_classifier.h"
+#include "noise_classifier_weights.h"
+
+namespace fs = std::filesystem;
+
+static const int FRAME_HOP = 800;  // 50 ms at 16 kHz
+
+struct Window {
+  float f[NC_FEATURES];
+  int label;
+};
+
+// ---------- WAV I/O ----------
+
+static bool readWav(const std::string &path, std::vector<int32_t> &out) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  uint8_t hdr[12];
+  if (fread(hdr, 1, 12, f) != 12 || memcmp(hdr, "RIFF", 4) || memcmp(hdr + 8, "WAVE", 4)) {
+    fclose(f);
+    return false;
+  }
+  uint16_t fmt = 0, channels = 0, bits = 0;
+  uint32_t rate = 0;
+  for (;;) {
+    uint8_t ch[8];
+    if (fread(ch, 1, 8, f) != 8) break;
+    uint32_t len = ch[4] | (ch[5] << 8) | (ch[6] << 16) | ((uint32_t)ch[7] << 24);
+    if (!memcmp(ch, "fmt ", 4)) {
+      uint8_t b[16];
+      if (len < 16 || fread(b, 1, 16, f) != 16) break;
+      fmt = b[0] | (b[1] << 8);
+      channels = b[2] | (b[3] << 8);
+      rate = b[4] | (b[5] << 8) | (b[6] << 16) | ((uint32_t)b[7] << 24);
+      bits = b[14] | (b[15] << 8);
+      fseek(f, (long)(len - 16 + (len & 1)), SEEK_CUR);
+    } else if (!memcmp(ch, "data", 4)) {
+      if (fmt != 1 || channels != 1 || rate != 16000 || (bits != 16 && bits != 32)) break;
+      size_t n = len / (bits / 8);
+      out.resize(n);
+      for (size_t i = 0; i < n; i++) {
+        if (bits == 16) {
+          int16_t v;
+          if (fread(&v, 2, 1, f) != 1) { out.resize(i); break; }
+          out[i] = v;
+        } else {
+          int32_t v;
+          if (fread(&v, 4, 1, f) != 1) { out.resize(i); break; }
+          out[i] = v >> 16;
+        }
+      }
+      fclose(f);
+      return true;
+    } else {
+      fseek(f, (long)(len + (len & 1)), SEEK_CUR);
+    }
+  }
+  fclose(f);
+  return false;
+}
+
+static bool writeWav(const std::string &path, const std::vector<int16_t> &pcm) {
+  FILE *f = fopen(path.c_str(), "wb");
+  if (!f) return false;
+  uint32_t dataLen = (uint32_t)(pcm.size() * 2);
+  uint32_t riffLen = 36 + dataLen;
+  uint32_t rate = 16000, byteRate = 32000;
+  uint16_t one = 1, blockAlign = 2, bits = 16;
+  uint32_t fmtLen = 16;
+  fwrite("RIFF", 1, 4, f); fwrite(&riffLen, 4, 1, f); fwrite("WAVE", 1, 4, f);
+  fwrite("fmt ", 1, 4, f); fwrite(&fmtLen, 4, 1, f); fwrite(&one, 2, 1, f); fwrite(&one, 2, 1, f);
+  fwrite(&rate, 4, 1, f); fwrite(&byteRate, 4, 1, f); fwrite(&blockAlign, 2, 1, f); fwrite(&bits, 2, 1, f);
+  fwrite("data", 1, 4, f); fwrite(&dataLen, 4, 1, f);
+  fwrite(pcm.data(), 2, pcm.size(), f);
+  fclose(f);
+  return true;
+}
+
+// ---------- features ----------
+
+static int classOf(const std::string &name) {
+  for (int c = 0; c < NC_CLASS_COUNT; c++)
+    if (name == NOISE_CLASS_NAMES[c]) return c;
+  return -1;
+}
+
+// Runs a clip through the same NoiseClassifier the firmware uses; one Window per closed window.
+static void clipWindows(const std::vector<int32_t> &pcm, int label, const NoiseClassifierModel *model,
+                        std::vector<Window> &out, std::vector<int> *pred) {
+  NoiseClassifier nc;
+  nc.model = model;
+  uint32_t now = 0;
+  for (size_t off = 0; off + NC_FFT <= pcm.size(); off += FRAME_HOP, now += 50) {
+    if (!nc.addFrame(&pcm[off], NC_FFT, 0, now)) continue;
+    Window w;
+    memcpy(w.f, nc.lastFeatures, sizeof(w.f));
+    w.label = label;
+    out.push_back(w);
+    if (pred) pred->push_back(model ? (int)nc.label : -1);
+  }
+}
+
+static bool loadDir(const std::string &dir, std::vector<std::vector<int32_t>> &clips, std::vector<int> &labels) {
+  std::error_code ec;
+  if (!fs::is_directory(dir, ec)) return false;
+  std::vector<std::pair<std::string, int>> files;
+  for (const auto &cls : fs::directory_iterator(dir, ec)) {
+    if (!cls.is_directory()) continue;
+    int c = classOf(cls.path().filename().string());
+    if (c < 0) continue;
+    for (const auto &e : fs::directory_iterator(cls.path(), ec)) {
+      if (e.path().extension() == ".wav" || e.path().extension() == ".WAV") files.push_back({ e.path().string(), c });
+    }
+  }
+  std::sort(files.begin(), files.end());
+  for (const auto &fl : files) {
+    std::vector<int32_t> pcm;
+    if (!readWav(fl.first, pcm)) {
+      fprintf(stderr, "skip %s (not 16 kHz mono PCM)\n", fl.first.c_str());
+      continue;
+    }
+    clips.push_back(std::move(pcm));
+    labels.push_back(fl.second);
+  }
+  return !clips.empty();
+}
+
+// ---------- synthetic clips ----------
+
+struct Biquad {
+  float b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0, z1 = 0, z2 = 0;
+  void bandpass(float f0, float q) {
+    float w = 2.0f * NC_PI * f0 / 16000.0f, al = sinf(w) / (2.0f * q), a0 = 1.0f + al;
+    b0 = al / a0; b1 = 0; b2 = -al / a0; a1 = -2.0f * cosf(w) / a0; a2 = (1.0f - al) / a0;
+  }
+  void lowpass(float f0, float q) {
+    float w = 2.0f * NC_PI * f0 / 16000.0f, al = sinf(w) / (2.0f * q), c = cosf(w), a0 = 1.0f + al;
+    b0 = (1 - c) / 2 / a0; b1 = (1 - c) / a0; b2 = (1 - c) / 2 / a0; a1 = -2.0f * c / a0; a2 = (1.0f - al) / a0;
+  }
+  float run(float x) {
+    float y = b0 * x + z1;
+    z1 = b1 * x - a1 * y + z2;
+    z2 = b2 * x - a2 * y;
+    return y;
+  }
+};
+
+static std::vector<int16_t> synthClip(int cls, std::mt19937 &rng, float seconds) {
+  std::uniform_real_distribution<float> U(0.0f, 1.0f);
+  std::normal_distribution<float> N(0.0f, 1.0f);
+  const int n = (int)(seconds * 16000.0f);
+  std::vector<float> x(n, 0.0f);
+
+  // Room tone under everything.
+  Biquad room;
+  room.lowpass(2000.0f, 0.7f);
+  const float roomLvl = 20.0f + 60.0f * U(rng);
+  for (int i = 0; i < n; i++) x[i] += roomLvl * room.run(N(rng));
+
+  if (cls == NC_CROWD) {
+    int voices = 3 + (int)(U(rng) * 15);
+    for (int v = 0; v < voices; v++) {
+      float f0 = 90.0f + 160.0f * U(rng), ph = 0, lvl = 300.0f + 900.0f * U(rng);
+      Biquad f1, f2, f3;
+      float syl = 0;
+      int sylLeft = 0;
+      for (int i = 0; i < n; i++) {
+        if (sylLeft-- <= 0) {
+          // New syllable (~4 Hz) with fresh formants, or a pause.
+          sylLeft = (int)(16000.0f * (0.12f + 0.2f * U(rng)));
+          syl = U(rng) < 0.75f ? 1.0f : 0.0f;
+          f1.bandpass(300.0f + 600.0f * U(rng), 5.0f);
+          f2.bandpass(900.0f + 1600.0f * U(rng), 8.0f);
+          f3.bandpass(2300.0f + 900.0f * U(rng), 10.0f);
+          f0 *= 0.9f + 0.2f * U(rng);
+          if (f0 < 80.0f) f0 = 80.0f;
+          if (f0 > 300.0f) f0 = 300.0f;
+        }
+        ph += f0 / 16000.0f;
+        float src = 0.0f;
+        if (ph >= 1.0f) {
+          ph -= 1.0f;
+          src = 1.0f;  // glottal pulse train
+        }
+        src += 0.05f * N(rng);
+        float y = 4.0f * f1.run(src) + 3.0f * f2.run(src) + 1.5f * f3.run(src);
+        x[i] += lvl * syl * y;
+      }
+    }
+  } else if (cls == NC_IMPULSIVE) {
+    float rate = 0.5f + 3.5f * U(rng);
+    for (int i = 0; i < n; i++) {
+      if (U(rng) < rate / 16000.0f) {
+        float amp = 3000.0f + 12000.0f * U(rng), tau = 16000.0f * (0.01f + 0.08f * U(rng));
+        Biquad tone;
+        tone.lowpass(800.0f + 5000.0f * U(rng), 0.7f);
+        for (int k = 0; i + k < n && k < (int)(tau * 5); k++) x[i + k] += amp * expf(-(float)k / tau) * tone.run(N(rng));
+      }
+    }
+  } else if (cls == NC_TONAL) {
+    // Bell / alarm / PA chime: a few partials, either continuous ringing or beeping.
+    float f = 600.0f + 2600.0f * U(rng);
+    float partials[3] = { 1.0f, 2.0f + 0.8f * U(rng), 3.0f + 1.5f * U(rng) };
+    float beepHz = U(rng) < 0.5f ? 0.0f : 1.0f + 4.0f * U(rng);
+    float lvl = 2000.0f + 6000.0f * U(rng);
+    float ph[3] = { 0, 0, 0 };
+    for (int i = 0; i < n; i++) {
+      float gate = beepHz > 0 ? (fmodf((float)i * beepHz / 16000.0f, 1.0f) < 0.5f ? 1.0f : 0.0f) : 1.0f;
+      float y = 0;
+      for (int p = 0; p < 3; p++) {
+        ph[p] += f * partials[p] / 16000.0f;
+        if (ph[p] > 1.0f) ph[p] -= 1.0f;
+        y += sinf(2.0f * NC_PI * ph[p]) / (float)(p + 1);
+      }
+      x[i] += lvl * gate * y;
+    }
+  } else {
+    // Fan / HVAC / projector: steady shaped noise, mains hum, blade-pass tone.
+    Biquad shape;
+    shape.lowpass(300.0f + 2500.0f * U(rng), 0.7f);
+    float noiseLvl = 1500.0f + 5000.0f * U(rng);
+    float mains = U(rng) < 0.5f ? 50.0f : 60.0f, hum = 200.0f + 1500.0f * U(rng);
+    float blade = 100.0f + 300.0f * U(rng), bladeLvl = 300.0f * U(rng);
+    for (int i = 0; i < n; i++) {
+      float t = (float)i / 16000.0f;
+      x[i] += noiseLvl * shape.run(N(rng));
+      x[i] += hum * (sinf(2.0f * NC_PI * mains * t) + 0.5f * sinf(4.0f * NC_PI * mains * t) + 0.3f * sinf(6.0f * NC_PI * mains * t));
+      x[i] += bladeLvl * sinf(2.0f * NC_PI * blade * t);
+    }
+  }
+
+  std::vector<int16_t> pcm(n);
+  for (int i = 0; i < n; i++) pcm[i] = (int16_t)std::max(-32768.0f, std::min(32767.0f, x[i]));
+  return pcm;
+}
+
+static int cmdSynth(int argc, char **argv) {
+  if (argc < 3) return 2;
+  std::string dir = argv[2];
+  int perClass = argc > 3 ? atoi(argv[3]) : 40;
+  unsigned seed = argc > 4 ? (unsigned)atoi(argv[4]) : 1;
+  std::mt19937 rng(seed);
+  for (int c = 0; c < NC_CLASS_COUNT; c++) {
+    fs::create_directories(fs::path(dir) / NOISE_CLASS_NAMES[c]);
+    for (int k = 0; k < perClass; k++) {
+      char name[64];
+      snprintf(name, sizeof(name), "syn_%u_%03d.wav", seed, k);
+      std::string path = (fs::path(dir) / NOISE_CLASS_NAMES[c] / name).string();
+      if (!writeWav(path, synthClip(c, rng, 5.0f))) {
+        fprintf(stderr, "cannot write %s\n", path.c_str());
+        return 1;
+      }
+    }
+  }
+  printf("wrote %d clips per class to %s\n", perClass, dir.c_str());
+  return 0;
+}
+
+// ---------- training ----------
+
+struct FloatMlp {
+  float w1[NC_HIDDEN][NC_FEATURES], b1[NC_HIDDEN];
+  float w2[NC_CLASS_COUNT][NC_HIDDEN], b2[NC_CLASS_COUNT];
+
+  void init(std::mt19937 &rng) {
+    std::normal_distribution<float> N(0.0f, 1.0f);
+    for (int j = 0; j < NC_HIDDEN; j++) {
+      for (int i = 0; i < NC_FEATURES; i++) w1[j][i] = N(rng) * sqrtf(2.0f / NC_FEATURES);
+      b1[j] = 0;
+    }
+    for (int c = 0; c < NC_CLASS_COUNT; c++) {
+      for (int j = 0; j < NC_HIDDEN; j++) w2[c][j] = N(rng) * sqrtf(2.0f / NC_HIDDEN);
+      b2[c] = 0;
+    }
+  }
+
+  void forward(const float *x, float *h, float *p) const {
+    for (int j = 0; j < NC_HIDDEN; j++) {
+      float a = b1[j];
+      for (int i = 0; i < NC_FEATURES; i++) a += w1[j][i] * x[i];
+      h[j] = a > 0 ? a : 0;
+    }
+    float mx = -1e30f;
+    for (int c = 0; c < NC_CLASS_COUNT; c++) {
+      float a = b2[c];
+      for (int j = 0; j < NC_HIDDEN; j++) a += w2[c][j] * h[j];
+      p[c] = a;
+      mx = std::max(mx, a);
+    }
+    float s = 0;
+    for (int c = 0; c < NC_CLASS_COUNT; c++) s += (p[c] = expf(p[c] - mx));
+    for (int c = 0; c < NC_CLASS_COUNT; c++) p[c] /= s;
+  }
+};
+
+// Inputs as the device will see them: standardized, then rounded to the int8 grid.
+static void standardize(const NoiseClassifierModel &m, const float *f, float *x) {
+  int8_t q[NC_FEATURES];
+  noiseClassifierQuantize(m, f, q);
+  for (int i = 0; i < NC_FEATURES; i++) x[i] = (float)q[i] / NC_INPUT_SCALE;
+}
+
+static void trainMlp(FloatMlp &net, const NoiseClassifierModel &norm, const std::vector<Window> &train, int epochs,
+                     std::mt19937 &rng) {
+  net.init(rng);
+  FloatMlp vel;
+  memset(&vel, 0, sizeof(vel));
+  std::vector<size_t> order(train.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+
+  // Class-balanced loss: folders rarely hold the same amount of audio per class.
+  float classW[NC_CLASS_COUNT] = {};
+  for (const Window &w : train) classW[w.label] += 1.0f;
+  for (int c = 0; c < NC_CLASS_COUNT; c++) classW[c] = classW[c] > 0 ? (float)train.size() / (NC_CLASS_COUNT * classW[c]) : 0;
+
+  const float lr0 = 0.01f, momentum = 0.9f, l2 = 1e-4f;
+  for (int ep = 0; ep < epochs; ep++) {
+    std::shuffle(order.begin(), order.end(), rng);
+    const float lr = lr0 * (1.0f - (float)ep / (float)epochs) + 1e-3f;
+    for (size_t idx : order) {
+      const Window &w = train[idx];
+      float x[NC_FEATURES], h[NC_HIDDEN], p[NC_CLASS_COUNT];
+      standardize(norm, w.f, x);
+      net.forward(x, h, p);
+      float dOut[NC_CLASS_COUNT], dH[NC_HIDDEN] = {};
+      for (int c = 0; c < NC_CLASS_COUNT; c++) dOut[c] = (p[c] - (c == w.label ? 1.0f : 0.0f)) * classW[w.label];
+      for (int c = 0; c < NC_CLASS_COUNT; c++) {
+        for (int j = 0; j < NC_HIDDEN; j++) {
+          dH[j] += dOut[c] * net.w2[c][j];
+          vel.w2[c][j] = momentum * vel.w2[c][j] - lr * (dOut[c] * h[j] + l2 * net.w2[c][j]);
+          net.w2[c][j] += vel.w2[c][j];
+        }
+        vel.b2[c] = momentum * vel.b2[c] - lr * dOut[c];
+        net.b2[c] += vel.b2[c];
+      }
+      for (int j = 0; j < NC_HIDDEN; j++) {
+        if (h[j] <= 0) continue;
+        for (int i = 0; i < NC_FEATURES; i++) {
+          vel.w1[j][i] = momentum * vel.w1[j][i] - lr * (dH[j] * x[i] + l2 * net.w1[j][i]);
+          net.w1[j][i] += vel.w1[j][i];
+        }
+        vel.b1[j] = momentum * vel.b1[j] - lr * dH[j];
+        net.b1[j] += vel.b1[j];
+      }
+    }
+  }
+}
+
+static int8_t q8(float v, float scale) {
+  long q = lroundf(v / scale);
+  return (int8_t)std::max(-127L, std::min(127L, q));
+}
+
+static void quantizeModel(const FloatMlp &net, const std::vector<Window> &calib, NoiseClassifierModel &m) {
+  float maxW1 = 1e-9f, maxW2 = 1e-9f, maxH = 1e-9f;
+  for (int j = 0; j < NC_HIDDEN; j++)
+    for (int i = 0; i < NC_FEATURES; i++) maxW1 = std::max(maxW1, fabsf(net.w1[j][i]));
+  for (int c = 0; c < NC_CLASS_COUNT; c++)
+    for (int j = 0; j < NC_HIDDEN; j++) maxW2 = std::max(maxW2, fabsf(net.w2[c][j]));
+  for (const Window &w : calib) {
+    float x[NC_FEATURES], h[NC_HIDDEN], p[NC_CLASS_COUNT];
+    standardize(m, w.f, x);
+    net.forward(x, h, p);
+    for (int j = 0; j < NC_HIDDEN; j++) maxH = std::max(maxH, h[j]);
+  }
+  const float sW1 = maxW1 / 127.0f, sW2 = maxW2 / 127.0f, sH = maxH / 127.0f;
+  const float sAcc1 = sW1 / NC_INPUT_SCALE;
+  for (int j = 0; j < NC_HIDDEN; j++) {
+    for (int i = 0; i < NC_FEATURES; i++) m.w1[j][i] = q8(net.w1[j][i], sW1);
+    m.b1[j] = (int32_t)lroundf(net.b1[j] / sAcc1);
+  }
+  m.m1 = (int32_t)lroundf(sAcc1 / sH * 65536.0f);
+  for (int c = 0; c < NC_CLASS_COUNT; c++) {
+    for (int j = 0; j < NC_HIDDEN; j++) m.w2[c][j] = q8(net.w2[c][j], sW2);
+    m.b2[c] = (int32_t)lroundf(net.b2[c] / (sW2 * sH));
+  }
+  m.logitScale = sW2 * sH;
+}
+
+static void printConfusion(const int conf[NC_CLASS_COUNT][NC_CLASS_COUNT]) {
+  int total = 0, right = 0;
+  printf("%-10s", "true\\pred");
+  for (int c = 0; c < NC_CLASS_COUNT; c++) printf("%10s", NOISE_CLASS_NAMES[c]);
+  printf("%10s\n", "recall");
+  for (int t = 0; t < NC_CLASS_COUNT; t++) {
+    int row = 0;
+    printf("%-10s", NOISE_CLASS_NAMES[t]);
+    for (int p = 0; p < NC_CLASS_COUNT; p++) {
+      printf("%10d", conf[t][p]);
+      row += conf[t][p];
+    }
+    printf("%9.1f%%\n", row ? 100.0 * conf[t][t] / row : 0.0);
+    total += row;
+    right += conf[t][t];
+  }
+  // The firmware only acts on "not crowd", so that is the number that matters for suppression.
+  int crowdAsOther = 0, crowdTotal = 0;
+  for (int p = 0; p < NC_CLASS_COUNT; p++) crowdTotal += conf[NC_CROWD][p];
+  crowdAsOther = crowdTotal - conf[NC_CROWD][NC_CROWD];
+  printf("accuracy %.1f%% (%d windows), crowd wrongly suppressed %.1f%%\n", total ? 100.0 * right / total : 0.0, total,
+         crowdTotal ? 100.0 * crowdAsOther / crowdTotal : 0.0);
+}
+
+static void evalInt8(const NoiseClassifierModel &m, const std::vector<Window> &ws, int conf[NC_CLASS_COUNT][NC_CLASS_COUNT]) {
+  for (const Window &w : ws) {
+    int8_t x[NC_FEATURES];
+    int32_t logits[NC_CLASS_COUNT];
+    noiseClassifierQuantize(m, w.f, x);
+    conf[w.label][noiseClassifierInfer(m, x, logits)]++;
+  }
+}
+
+static bool writeHeader(const std::string &path, const NoiseClassifierModel &m, size_t windows, float acc,
+                        const char *note) {
+  FILE *f = fopen(path.c_str(), "w");
+  if (!f) return false;
+  fprintf(f, "#pragma once\n\n#include \"noise_classifier.h\"\n\n");
+  fprintf(f, "// Generated by tools/noise_classify.cpp (train): %zu windows, held-out int8 accuracy %.1f%%.\n", windows, acc);
+  if (note) fprintf(f, "// %s\n", note);
+  fprintf(f, "static const NoiseClassifierModel NOISE_CLASSIFIER_MODEL = {\n  {");
+  for (int i = 0; i < NC_FEATURES; i++) fprintf(f, "%s%.5ff", i ? ", " : " ", m.featMean[i]);
+  fprintf(f, " },\n  {");
+  for (int i = 0; i < NC_FEATURES; i++) fprintf(f, "%s%.6ff", i ? ", " : " ", m.featInvStd[i]);
+  fprintf(f, " },\n  {\n");
+  for (int j = 0; j < NC_HIDDEN; j++) {
+    fprintf(f, "    {");
+    for (int i = 0; i < NC_FEATURES; i++) fprintf(f, "%s%d", i ? ", " : " ", m.w1[j][i]);
+    fprintf(f, " },\n");
+  }
+  fprintf(f, "  },\n  {");
+  for (int j = 0; j < NC_HIDDEN; j++) fprintf(f, "%s%d", j ? ", " : " ", (int)m.b1[j]);
+  fprintf(f, " },\n  %d,\n  {\n", (int)m.m1);
+  for (int c = 0; c < NC_CLASS_COUNT; c++) {
+    fprintf(f, "    {");
+    for (int j = 0; j < NC_HIDDEN; j++) fprintf(f, "%s%d", j ? ", " : " ", m.w2[c][j]);
+    fprintf(f, " },\n");
+  }
+  fprintf(f, "  },\n  {");
+  for (int c = 0; c < NC_CLASS_COUNT; c++) fprintf(f, "%s%d", c ? ", " : " ", (int)m.b2[c]);
+  fprintf(f, " },\n  %.8ff\n};\n", m.logitScale);
+  fclose(f);
+  return true;
+}
+
+static int cmdTrain(int argc, char **argv) {
+  if (argc < 3) return 2;
+  std::string dir = argv[2], outPath = "noise_classifier_weights.h";
+  int epochs = 60, holdoutPct = 20;
+  const char *note = nullptr;
+  for (int i = 3; i < argc; i++) {
+    if (!strcmp(argv[i], "-o") && i + 1 < argc) outPath = argv[++i];
+    else if (!strcmp(argv[i], "--epochs") && i + 1 < argc) epochs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--holdout") && i + 1 < argc) holdoutPct = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--note") && i + 1 < argc) note = argv[++i];
+  }
+
+  std::vector<std::vector<int32_t>> clips;
+  std::vector<int> labels;
+  if (!loadDir(dir, clips, labels)) {
+    fprintf(stderr, "no labelled clips under %s\n", dir.c_str());
+    return 1;
+  }
+
+  // Split by clip, not by window, so held-out windows never share audio with training ones.
+  std::vector<Window> train, test;
+  for (size_t k = 0; k < clips.size(); k++) {
+    bool hold = (int)((k * 7919u) % 100u) < holdoutPct;
+    clipWindows(clips[k], labels[k], nullptr, hold ? test : train, nullptr);
+  }
+  if (train.empty()) {
+    fprintf(stderr, "clips too short (need >= 1 s)\n");
+    return 1;
+  }
+
+  NoiseClassifierModel m;
+  memset(&m, 0, sizeof(m));
+  for (int i = 0; i < NC_FEATURES; i++) {
+    double s = 0, s2 = 0;
+    for (const Window &w : train) {
+      s += w.f[i];
+      s2 += (double)w.f[i] * w.f[i];
+    }
+    double mean = s / train.size(), var = s2 / train.size() - mean * mean;
+    m.featMean[i] = (float)mean;
+    m.featInvStd[i] = (float)(1.0 / sqrt(var > 1e-6 ? var : 1e-6));
+  }
+
+  std::mt19937 rng(12345);
+  FloatMlp net;
+  trainMlp(net, m, train, epochs, rng);
+  quantizeModel(net, train, m);
+
+  int confTrain[NC_CLASS_COUNT][NC_CLASS_COUNT] = {}, confTest[NC_CLASS_COUNT][NC_CLASS_COUNT] = {};
+  evalInt8(m, train, confTrain);
+  evalInt8(m, test, confTest);
+  printf("== train (int8) ==\n");
+  printConfusion(confTrain);
+  float acc = 0;
+  if (!test.empty()) {
+    printf("== held-out (int8) ==\n");
+    printConfusion(confTest);
+    int right = 0;
+    for (int c = 0; c < NC_CLASS_COUNT; c++) right += confTest[c][c];
+    acc = 100.0f * (float)right / (float)test.size();
+  }
+
+  if (!writeHeader(outPath, m, train.size() + test.size(), acc, note)) {
+    fprintf(stderr, "cannot write %s\n", outPath.c_str());
+    return 1;
+  }
+  printf("wrote %s\n", outPath.c_str());
+  return 0;
+}
+
+static int cmdEval(int argc, char **argv) {
+  if (argc < 3) return 2;
+  std::vector<std::vector<int32_t>> clips;
+  std::vector<int> labels;
+  if (!loadDir(argv[2], clips, labels)) {
+    fprintf(stderr, "no labelled clips under %s\n", argv[2]);
+    return 1;
+  }
+  // Same streaming path as the firmware (NoiseClassifier::addFrame -> classify).
+  int conf[NC_CLASS_COUNT][NC_CLASS_COUNT] = {};
+  for (size_t k = 0; k < clips.size(); k++) {
+    std::vector<Window> ws;
+    std::vector<int> pred;
+    clipWindows(clips[k], labels[k], &NOISE_CLASSIFIER_MODEL, ws, &pred);
+    for (int p : pred) conf[labels[k]][p]++;
+  }
+  printConfusion(conf);
+  return 0;
+}
+
+static int cmdBench() {
+  std::mt19937 rng(7);
+  std::vector<int16_t> pcm16 = synthClip(NC_CROWD, rng, 4.0f);
+  std::vector<int32_t> pcm(pcm16.begin(), pcm16.end());
+
+  NoiseFrontend fe;
+  fe.init();
+  const int iters = 20000;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; i++) {
+    size_t off = ((size_t)i * FRAME_HOP) % (pcm.size() - NC_FFT);
+    fe.addFrame(&pcm[off], NC_FFT, 0);
+    if (fe.frames >= 20) {
+      float f[NC_FEATURES];
+      fe.features(f);
+    }
+  }
+  double frameUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / iters;
+
+  float feats[NC_FEATURES];
+  for (int i = 0; i < NC_FEATURES; i++) feats[i] = NOISE_CLASSIFIER_MODEL.featMean[i];
+  volatile int sink = 0;
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters * 10; i++) {
+    int8_t x[NC_FEATURES];
+    int32_t logits[NC_CLASS_COUNT];
+    feats[i % NC_FEATURES] += 0.01f;
+    noiseClassifierQuantize(NOISE_CLASSIFIER_MODEL, feats, x);
+    sink += noiseClassifierInfer(NOISE_CLASSIFIER_MODEL, x, logits);
+  }
+  double inferUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / (iters * 10);
+
+  printf("frontend per frame: %.2f us   mlp per window: %.3f us   (host; MACs per window: %d)\n", frameUs, inferUs,
+         NC_FEATURES * NC_HIDDEN + NC_HIDDEN * NC_CLASS_COUNT);
+  printf("state: frontend %zu bytes, model %zu bytes\n", sizeof(NoiseFrontend), sizeof(NoiseClassifierModel));
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2) {
+    if (!strcmp(argv[1], "synth")) return cmdSynth(argc, argv);
+    if (!strcmp(argv[1], "train")) return cmdTrain(argc, argv);
+    if (!strcmp(argv[1], "eval")) return cmdEval(argc, argv);
+    if (!strcmp(argv[1], "bench")) return cmdBench();
+  }
+  fprintf(stderr, "usage: noise_classify synth|train|eval|bench ... (see header)\n");
+  return 2;
+}
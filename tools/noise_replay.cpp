@@ -0,0 +1,334 @@
+// Offline replay of recorded db series through the firmware's LED/escalation engine.
+//
+// Runs one or more db_series files (ts_ms|db10 per line, as written to /db_series.txt, with a
+// third |zone field for zones other than the first) through a grid of threshold/timing
+// configurations in parallel and prints one CSV row per configuration with FIRST/SECOND/MAJOR
+// counts and LED dwell times. One zone is replayed at a time; the other zones' lines are skipped.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -pthread -I.. noise_replay.cpp -o noise_replay
+//
+// Usage:
+//   noise_replay [options] db_series.txt [more.txt ...]
+//   noise_replay selftest   line parsing and zone filtering (exit status 1 on failure)
+//     --zone N                zone to replay, 1-based as in the event log (default 1)
+//     --yellow A:B[:STEP]     yellow threshold range (default 65)
+//     --red A:B[:STEP]        red threshold range (default 70)
+//     --hyst A:B[:STEP]       hysteresis dB (default 3)
+//     --first A:B[:STEP]      FIRST warning seconds (default 5)
+//     --second A:B[:STEP]     SECOND warning seconds (default 30)
+//     --major A:B[:STEP]      MAJOR warning seconds (default 60)
+//     --repeat A:B[:STEP]     MAJOR repeat seconds (default 180)
+//     --silence A:B[:STEP]    silence reset seconds (default 15)
+//     --tick-ms N             engine step, matches the firmware frame period (default 50)
+//     --gap-ms N              reset the engine across recording gaps longer than this (default 60000)
+//     --threads N             worker threads (default: hardware concurrency)
+//
+// Samples are held between records (the firmware logs on change + heartbeat), the same
+// int dB value the firmware fed to updateLEDState()/handleRedWarnings().
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "noise_engine.h"
+
+struct Sample {
+  uint64_t tsMs;
+  int16_t db10;
+};
+
+struct Range {
+  long lo, hi, step;
+};
+
+struct Result {
+  NoiseEngineConfig cfg;
+  uint32_t violations = 0;
+  uint32_t first = 0;
+  uint32_t second = 0;
+  uint32_t major = 0;
+  uint32_t majorRepeat = 0;
+  uint64_t dwellMs[3] = { 0, 0, 0 };
+};
+
+static bool parseRange(const char *s, Range &out) {
+  char *end = nullptr;
+  out.lo = strtol(s, &end, 10);
+  out.hi = out.lo;
+  out.step = 1;
+  if (*end == ':') {
+    out.hi = strtol(end + 1, &end, 10);
+    if (*end == ':') out.step = strtol(end + 1, &end, 10);
+  }
+  return *end == '\0' && out.step > 0 && out.hi >= out.lo;
+}
+
+// One db series line: ts_ms|db10, plus |zone (0-based) for zones other than the first.
+static bool parseSeriesLine(const char *line, Sample &s, int &zone) {
+  char *end = nullptr;
+  s.tsMs = strtoull(line, &end, 10);
+  if (end == line || *end != '|' || s.tsMs == 0) return false;
+  const char *p = end + 1;
+  s.db10 = (int16_t)strtol(p, &end, 10);
+  if (end == p) return false;
+  zone = 0;
+  if (*end == '|') {
+    p = end + 1;
+    zone = (int)strtol(p, &end, 10);
+    if (end == p || zone < 0) return false;
+  }
+  return *end == '\0' || *end == '\r' || *end == '\n';
+}
+
+// Appends the samples of `zone` (0-based); lines of other zones are counted in `otherZones`.
+static void loadSeriesFile(FILE *f, int zone, std::vector<Sample> &out, size_t &otherZones) {
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    Sample s;
+    int z = 0;
+    if (!parseSeriesLine(line, s, z)) continue;
+    if (z != zone) {
+      otherZones++;
+      continue;
+    }
+    out.push_back(s);
+  }
+}
+
+static bool loadSeries(const char *path, int zone, std::vector<Sample> &out, size_t &otherZones) {
+  FILE *f = fopen(path, "r");
+  if (!f) return false;
+  loadSeriesFile(f, zone, out, otherZones);
+  fclose(f);
+  return true;
+}
+
+static void onWarning(void *ctx, WarningLevel level, int, int, uint32_t) {
+  Result *r = (Result *)ctx;
+  switch (level) {
+    case WARN_FIRST: r->first++; break;
+    case WARN_SECOND: r->second++; break;
+    case WARN_MAJOR: r->major++; break;
+    case WARN_MAJOR_REPEAT: r->majorRepeat++; break;
+  }
+}
+
+static void onViolationStart(void *ctx, uint32_t) {
+  ((Result *)ctx)->violations++;
+}
+
+static void replay(const std::vector<Sample> &series, uint32_t tickMs, uint32_t gapMs, Result &r) {
+  NoiseEngine e;
+  e.cfg = r.cfg;
+  e.hooks.ctx = &r;
+  e.hooks.onWarning = onWarning;
+  e.hooks.onViolationStart = onViolationStart;
+
+  // Engine clock is a 32-bit millis() like the firmware; it only ever sees differences.
+  uint32_t clock = 1;
+  for (size_t i = 0; i < series.size(); i++) {
+    const int value = series[i].db10 / 10;
+    uint64_t span = (i + 1 < series.size()) ? (series[i + 1].tsMs - series[i].tsMs) : tickMs;
+    if (span > gapMs) {
+      // Device was off or not logging: count one tick, then start fresh like a reboot.
+      e.updateLed(value);
+      e.handleWarnings(value, clock);
+      r.dwellMs[e.led] += tickMs;
+      clock += tickMs;
+      NoiseEngine fresh;
+      fresh.cfg = e.cfg;
+      fresh.hooks = e.hooks;
+      e = fresh;
+      continue;
+    }
+    for (uint64_t t = 0; t < span; t += tickMs) {
+      e.updateLed(value);
+      e.handleWarnings(value, clock);
+      uint32_t step = (uint32_t)std::min<uint64_t>(tickMs, span - t);
+      r.dwellMs[e.led] += step;
+      clock += step;
+    }
+  }
+}
+
+static std::vector<long> expand(const Range &r) {
+  std::vector<long> v;
+  for (long x = r.lo; x <= r.hi; x += r.step) v.push_back(x);
+  return v;
+}
+
+// ---------------------------------------------------------------- selftest
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+static void selftest() {
+  Sample s;
+  int z = -1;
+  expect(parseSeriesLine("1788220800000|712\r\n", s, z) && s.tsMs == 1788220800000ULL && s.db10 == 712 && z == 0,
+         "first zone: ts_ms|db10 with the firmware's CRLF");
+  expect(parseSeriesLine("1788220800050|-15|1\r\n", s, z) && s.db10 == -15 && z == 1,
+         "zone suffix: ts_ms|db10|zone parses as the second zone");
+  expect(!parseSeriesLine("0|700\n", s, z) && !parseSeriesLine("garbage\n", s, z) && !parseSeriesLine("1|2|x\n", s, z),
+         "unset clock, garbage and a bad zone field are skipped");
+
+  FILE *f = tmpfile();
+  if (!f) {
+    expect(false, "tmpfile");
+    return;
+  }
+  fputs("1000|600\r\n1000|900|1\r\n2000|610\r\n2000|910|1\r\n3000|920|1\r\n", f);
+  std::vector<Sample> zone1, zone2;
+  size_t other1 = 0, other2 = 0;
+  rewind(f);
+  loadSeriesFile(f, 0, zone1, other1);
+  rewind(f);
+  loadSeriesFile(f, 1, zone2, other2);
+  fclose(f);
+  expect(zone1.size() == 2 && other1 == 3 && zone1[0].db10 == 600 && zone1[1].db10 == 610,
+         "--zone 1 keeps only the lines without a zone field");
+  expect(zone2.size() == 3 && other2 == 2 && zone2[0].db10 == 900 && zone2[2].db10 == 920,
+         "--zone 2 keeps only the |1 lines");
+}
+
+int main(int argc, char **argv) {
+  Range yellow = { 65, 65, 1 }, red = { 70, 70, 1 }, hyst = { 3, 3, 1 };
+  Range first = { 5, 5, 1 }, second = { 30, 30, 1 }, major = { 60, 60, 1 };
+  Range repeat = { 180, 180, 1 }, silence = { 15, 15, 1 };
+  uint32_t tickMs = 50;
+  uint32_t gapMs = 60000;
+  int zone = 0;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<const char *> files;
+
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) {
+    selftest();
+    return fails ? 1 : 0;
+  }
+
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    const char *v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    Range *target = nullptr;
+    if (!strcmp(a, "--yellow")) target = &yellow;
+    else if (!strcmp(a, "--red")) target = &red;
+    else if (!strcmp(a, "--hyst")) target = &hyst;
+    else if (!strcmp(a, "--first")) target = &first;
+    else if (!strcmp(a, "--second")) target = &second;
+    else if (!strcmp(a, "--major")) target = &major;
+    else if (!strcmp(a, "--repeat")) target = &repeat;
+    else if (!strcmp(a, "--silence")) target = &silence;
+
+    if (target) {
+      if (!v || !parseRange(v, *target)) {
+        fprintf(stderr, "bad range for %s\n", a);
+        return 2;
+      }
+      i++;
+    } else if (!strcmp(a, "--tick-ms") && v) {
+      tickMs = (uint32_t)std::max(1L, atol(v));
+      i++;
+    } else if (!strcmp(a, "--gap-ms") && v) {
+      gapMs = (uint32_t)std::max(1L, atol(v));
+      i++;
+    } else if (!strcmp(a, "--zone") && v) {
+      zone = (int)atol(v) - 1;
+      if (zone < 0) {
+        fprintf(stderr, "bad zone %s\n", v);
+        return 2;
+      }
+      i++;
+    } else if (!strcmp(a, "--threads") && v) {
+      threads = (unsigned)std::max(1L, atol(v));
+      i++;
+    } else if (a[0] == '-') {
+      fprintf(stderr, "unknown option %s\n", a);
+      return 2;
+    } else {
+      files.push_back(a);
+    }
+  }
+
+  if (files.empty()) {
+    fprintf(stderr, "usage: noise_replay [options] db_series.txt [...] | selftest\n");
+    return 2;
+  }
+
+  std::vector<Sample> series;
+  size_t otherZones = 0;
+  for (const char *f : files) {
+    if (!loadSeries(f, zone, series, otherZones)) {
+      fprintf(stderr, "cannot read %s\n", f);
+      return 1;
+    }
+  }
+  std::stable_sort(series.begin(), series.end(), [](const Sample &a, const Sample &b) { return a.tsMs < b.tsMs; });
+  if (series.empty()) {
+    fprintf(stderr, "no samples for zone %d (%zu lines of other zones)\n", zone + 1, otherZones);
+    return 1;
+  }
+
+  // Build the grid, skipping combinations the firmware would reject/clamp.
+  std::vector<Result> results;
+  for (long y : expand(yellow))
+    for (long rd : expand(red))
+      for (long h : expand(hyst))
+        for (long f1 : expand(first))
+          for (long f2 : expand(second))
+            for (long f3 : expand(major))
+              for (long rp : expand(repeat))
+                for (long sl : expand(silence)) {
+                  if (rd <= y || f2 <= f1 || f3 <= f2) continue;
+                  Result r;
+                  r.cfg.yellowThreshold = (int)y;
+                  r.cfg.redThreshold = (int)rd;
+                  r.cfg.hysteresisDb = (int)h;
+                  r.cfg.firstWarningMs = (uint32_t)f1 * 1000UL;
+                  r.cfg.secondWarningMs = (uint32_t)f2 * 1000UL;
+                  r.cfg.majorWarningMs = (uint32_t)f3 * 1000UL;
+                  r.cfg.majorRepeatIntervalMs = (uint32_t)rp * 1000UL;
+                  r.cfg.silenceResetWindowMs = (uint32_t)sl * 1000UL;
+                  results.push_back(r);
+                }
+
+  const auto t0 = std::chrono::steady_clock::now();
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; t++) {
+    pool.emplace_back([&]() {
+      for (size_t i = next++; i < results.size(); i = next++) replay(series, tickMs, gapMs, results[i]);
+    });
+  }
+  for (auto &th : pool) th.join();
+  const double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  const double spanS = (double)(series.back().tsMs - series.front().tsMs) / 1000.0;
+  fprintf(stderr, "zone=%d samples=%zu other_zones=%zu span_days=%.2f configs=%zu threads=%u wall_s=%.3f speedup=%.0fx\n",
+          zone + 1, series.size(), otherZones, spanS / 86400.0, results.size(), threads, wallS,
+          wallS > 0 ? (spanS * (double)results.size()) / wallS : 0.0);
+
+  printf("yellow,red,hyst,first_s,second_s,major_s,repeat_s,silence_s,violations,first,second,major,major_repeat,green_s,yellow_s,red_s\n");
+  for (const Result &r : results) {
+    printf("%d,%d,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.1f,%.1f,%.1f\n",
+           r.cfg.yellowThreshold, r.cfg.redThreshold, r.cfg.hysteresisDb,
+           (unsigned long)(r.cfg.firstWarningMs / 1000UL), (unsigned long)(r.cfg.secondWarningMs / 1000UL),
+           (unsigned long)(r.cfg.majorWarningMs / 1000UL), (unsigned long)(r.cfg.majorRepeatIntervalMs / 1000UL),
+           (unsigned long)(r.cfg.silenceResetWindowMs / 1000UL),
+           (unsigned long)r.violations, (unsigned long)r.first, (unsigned long)r.second,
+           (unsigned long)r.major, (unsigned long)r.majorRepeat,
+           r.dwellMs[GREEN] / 1000.0, r.dwellMs[YELLOW] / 1000.0, r.dwellMs[RED] / 1000.0);
+  }
+  return 0;
+}
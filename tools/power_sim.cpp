@@ -0,0 +1,258 @@
+// Host harness for the quiet-period duty-cycle policy (power_policy.h) on a virtual millisecond
+// clock: wake latency and duty cycle for the always-on loop and a few QUIET settings.
+//
+// A simulated week of one classroom drives the frame loop as loop() does: a frame every
+// frameIntervalMs(), each reading one 256-sample block (16 ms at 16 kHz), the legacy EMA
+// (alpha 0.1 per frame) and PowerPolicy::update() with raw-or-smoothed >= YELLOW as "loud" and
+// smoothed < YELLOW as GREEN. The week (estimates, not recordings):
+//   weekdays 08:00-15:30  lessons at 52-60 dB, 12 loud episodes an hour (2-60 s, 66-78 dB),
+//                         breaks at 10:00 and 12:00 (20 min at 68-74 dB)
+//   weekdays 17:30-18:00  cleaning, 30 min at 62-67 dB
+//   any time              background 30-40 dB, one short bang an hour (60-150 ms, 70-80 dB)
+// Wake latency runs from the onset of a loud episode to the frame that leaves QUIET. A bang is
+// "seen" if any frame's block overlaps it: a seen bang wakes the loop like any loud frame, an unseen
+// one is what the slower QUIET frame rate gives up.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. power_sim.cpp -o power_sim
+//
+// Usage:
+//   power_sim selftest     state machine checks plus the week per policy (exit status 1 on failure)
+//   power_sim bench        duty cycle, energy and wake latency per policy
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "power_policy.h"
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+static const uint32_t DAY_MS = 86400000;
+static const uint32_t WEEK_MS = 7 * DAY_MS;
+static const uint32_t BLOCK_MS = 16;
+static const int YELLOW = 65;
+static const double SMOOTH_ALPHA = 0.1;
+
+struct Sound {
+  uint32_t startMs;
+  uint32_t endMs;
+  int db;
+  bool episode;   // a loud episode (wake latency); false: a short bang
+};
+
+struct Week {
+  std::vector<Sound> sounds;   // sorted by start
+  // Lessons, cleaning and background: the level between sounds.
+  int bedDb(uint32_t t) const {
+    const uint32_t day = t / DAY_MS, tod = t % DAY_MS;
+    const bool weekday = day < 5;
+    const uint32_t h = tod / 3600000, m = (tod / 60000) % 60;
+    const uint32_t minute = h * 60 + m;
+    if (weekday && minute >= 8 * 60 && minute < 15 * 60 + 30) return 52 + (int)((t / 7000) % 9);
+    if (weekday && minute >= 17 * 60 + 30 && minute < 18 * 60) return 62 + (int)((t / 5000) % 6);
+    return 30 + (int)((t / 11000) % 11);
+  }
+};
+
+static Week makeWeek(uint32_t seed) {
+  std::mt19937 rng(seed);
+  Week w;
+  auto uni = [&](uint32_t lo, uint32_t hi) { return lo + (uint32_t)(rng() % (hi - lo + 1)); };
+  std::exponential_distribution<double> bangGap(1.0 / 3600000.0);
+  for (double t = bangGap(rng); t < WEEK_MS; t += bangGap(rng)) {
+    const uint32_t s = (uint32_t)t;
+    w.sounds.push_back({ s, s + uni(60, 150), (int)uni(70, 80), false });
+  }
+  std::exponential_distribution<double> episodeGap(12.0 / 3600000.0);
+  for (uint32_t day = 0; day < 5; day++) {
+    const uint32_t d0 = day * DAY_MS;
+    for (double t = d0 + 8 * 3600000.0 + episodeGap(rng); t < d0 + 15.5 * 3600000.0; t += episodeGap(rng)) {
+      const uint32_t s = (uint32_t)t;
+      w.sounds.push_back({ s, s + uni(2000, 60000), (int)uni(66, 78), true });
+    }
+    for (uint32_t h : { 10u, 12u }) {
+      const uint32_t s = d0 + h * 3600000 + uni(0, 120000);
+      w.sounds.push_back({ s, s + 20 * 60000, (int)uni(68, 74), true });
+    }
+  }
+  std::sort(w.sounds.begin(), w.sounds.end(), [](const Sound &a, const Sound &b) { return a.startMs < b.startMs; });
+  return w;
+}
+
+struct PolicyCase {
+  const char *name;
+  bool enabled;
+  uint32_t quietAfterMs;
+  uint32_t quietFrameMs;
+};
+
+static const PolicyCase POLICIES[] = {
+  { "always on (old loop)", false, 600000, 250 },
+  { "QUIET after 10 min, 250 ms (default)", true, 600000, 250 },
+  { "QUIET after 2 min, 250 ms", true, 120000, 250 },
+  { "QUIET after 30 min, 250 ms", true, 1800000, 250 },
+  { "QUIET after 10 min, 500 ms", true, 600000, 500 },
+};
+static const int POLICY_COUNT = (int)(sizeof(POLICIES) / sizeof(POLICIES[0]));
+
+struct WeekOut {
+  uint64_t quietMs = 0;
+  uint64_t frames = 0;
+  uint32_t quietEntries = 0;
+  double avgMw = 0;
+  double whPerDay = 0;
+  std::vector<uint32_t> wakeMs;   // episodes that started in QUIET
+  int episodesMissed = 0;         // episodes over before any frame saw them
+  int bangs = 0;
+  int bangsSeen = 0;
+  uint32_t maxLastWakeMs = 0;     // largest PowerPolicy::lastWakeLatencyMs
+};
+
+static WeekOut runWeek(const Week &w, const PolicyCase &pc) {
+  PowerPolicy p;
+  p.enabled = pc.enabled;
+  p.quietAfterMs = pc.quietAfterMs;
+  p.quietFrameMs = pc.quietFrameMs;
+  WeekOut o;
+  const size_t n = w.sounds.size();
+  std::vector<char> seen(n, 0);
+  std::vector<char> startedQuiet(n, 0);
+  std::vector<char> startedChecked(n, 0);
+  size_t first = 0;   // sounds before this one ended before the current block
+  double smooth = 35.0;
+  uint32_t t = 0;
+  while (t < WEEK_MS) {
+    const uint32_t blockFrom = t >= BLOCK_MS ? t - BLOCK_MS : 0;
+    while (first < n && w.sounds[first].endMs <= blockFrom) first++;
+    int raw = w.bedDb(t);
+    for (size_t i = first; i < n && w.sounds[i].startMs < t; i++) {
+      // Mode when the sound began: the last frame before its onset decided it.
+      if (!startedChecked[i]) {
+        startedChecked[i] = 1;
+        startedQuiet[i] = p.mode == POWER_QUIET;
+      }
+      if (w.sounds[i].endMs <= blockFrom) continue;
+      raw = std::max(raw, w.sounds[i].db);
+      if (!seen[i]) {
+        seen[i] = 1;
+        if (w.sounds[i].episode && startedQuiet[i]) o.wakeMs.push_back(t - w.sounds[i].startMs);
+      }
+    }
+    smooth += SMOOTH_ALPHA * (raw - smooth);
+    const bool loud = raw >= YELLOW || (int)smooth >= YELLOW;
+    const PowerMode before = p.mode;
+    p.update(t, loud, (int)smooth < YELLOW);
+    if (before == POWER_QUIET && p.mode == POWER_ACTIVE) o.maxLastWakeMs = std::max(o.maxLastWakeMs, p.lastWakeLatencyMs);
+    o.frames++;
+    const uint32_t step = p.frameIntervalMs();
+    if (p.mode == POWER_QUIET) o.quietMs += step;
+    t += step;
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (w.sounds[i].episode) {
+      if (!seen[i]) o.episodesMissed++;
+    } else {
+      o.bangs++;
+      o.bangsSeen += seen[i];
+    }
+  }
+  o.quietEntries = p.quietEntries;
+  o.avgMw = (double)p.energyMicroJoules / (double)WEEK_MS;
+  o.whPerDay = (double)p.energyMicroJoules / 7.0 / 3.6e9;
+  return o;
+}
+
+static uint32_t pct(std::vector<uint32_t> v, double q) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t)(q * (double)(v.size() - 1) + 0.5))];
+}
+
+static void machineChecks() {
+  PowerPolicy p;
+  p.quietAfterMs = 10000;
+  uint32_t t = 0;
+  for (; t < 10000; t += 50) p.update(t, false, true);
+  expect(p.mode == POWER_ACTIVE, "still ACTIVE just before quietAfterMs of GREEN");
+  expect(p.update(t, false, true) && p.mode == POWER_QUIET && p.frameIntervalMs() == 250 && p.cpuMhz() == 80 && p.modemSleep(),
+         "QUIET after quietAfterMs of GREEN: 250 ms frames, 80 MHz, modem sleep");
+  t += 250;
+  expect(!p.update(t, false, false) && p.mode == POWER_QUIET, "a non-GREEN, not loud frame stays QUIET");
+  t += 250;
+  expect(p.update(t, true, false) && p.mode == POWER_ACTIVE && p.wakeups == 1 && p.lastWakeLatencyMs == 250,
+         "the first loud frame wakes, latency one quiet frame");
+
+  PowerPolicy r;
+  r.quietAfterMs = 10000;
+  for (t = 0; t < 9000; t += 50) r.update(t, false, true);
+  r.update(t, false, false);
+  for (t += 50; t < 18000; t += 50) r.update(t, false, true);
+  expect(r.mode == POWER_ACTIVE, "a YELLOW frame restarts the GREEN run");
+
+  PowerPolicy off;
+  off.enabled = false;
+  off.quietAfterMs = 1000;
+  for (t = 0; t <= 60000; t += 50) off.update(t, false, true);
+  expect(off.mode == POWER_ACTIVE && off.quietEntries == 0, "disabled: never QUIET");
+  expect(off.energyMilliJoules() == 60 * off.activeMilliwatts, "energy: 60 s ACTIVE is 60 x 530 mJ");
+}
+
+static void bench(bool check) {
+  const Week w = makeWeek(42);
+  printf("\none simulated week; wake = onset of a loud episode that began in QUIET to the frame leaving QUIET\n");
+  printf("  %-38s %7s %9s %7s %8s %8s %8s %8s %7s %7s\n", "policy", "quiet %", "frames/d", "avg mW", "Wh/day", "entries",
+         "wake p50", "wake max", "missed", "bangs");
+  WeekOut base;
+  for (int i = 0; i < POLICY_COUNT; i++) {
+    const PolicyCase &pc = POLICIES[i];
+    const WeekOut o = runWeek(w, pc);
+    if (i == 0) base = o;
+    printf("  %-38s %7.1f %9.0f %7.0f %8.2f %8u %8u %8u %7d %6.0f%%\n", pc.name, 100.0 * (double)o.quietMs / WEEK_MS,
+           (double)o.frames / 7.0, o.avgMw, o.whPerDay, o.quietEntries, pct(o.wakeMs, 0.5), pct(o.wakeMs, 1.0), o.episodesMissed,
+           100.0 * o.bangsSeen / (o.bangs ? o.bangs : 1));
+    if (!check) continue;
+    char what[200];
+    if (!pc.enabled) {
+      snprintf(what, sizeof(what), "%s: never QUIET, %.0f mW", pc.name, o.avgMw);
+      expect(o.quietEntries == 0 && o.wakeMs.empty(), what);
+      continue;
+    }
+    snprintf(what, sizeof(what), "%s: every wake within one quiet frame (max %u ms, %zu wakes)", pc.name, pct(o.wakeMs, 1.0),
+             o.wakeMs.size());
+    expect(!o.wakeMs.empty() && pct(o.wakeMs, 1.0) <= pc.quietFrameMs && o.maxLastWakeMs <= pc.quietFrameMs, what);
+    snprintf(what, sizeof(what), "%s: no loud episode missed", pc.name);
+    expect(o.episodesMissed == 0, what);
+    snprintf(what, sizeof(what), "%s: %.0f%% of the week QUIET, %.0f%% less energy than always on", pc.name,
+           100.0 * (double)o.quietMs / WEEK_MS, 100.0 * (1.0 - o.avgMw / base.avgMw));
+    expect(o.quietMs > 0 && o.avgMw < base.avgMw, what);
+    if (i == 1) {
+      snprintf(what, sizeof(what), "default: QUIET over half the week (%.0f%%), at least 30%% less energy", 100.0 * (double)o.quietMs / WEEK_MS);
+      expect(o.quietMs > WEEK_MS / 2 && o.avgMw < base.avgMw * 0.7, what);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) {
+    machineChecks();
+    bench(true);
+    return fails ? 1 : 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "bench")) {
+    bench(false);
+    return 0;
+  }
+  fprintf(stderr, "usage: power_sim selftest | bench\n");
+  return 2;
+}
@@ -0,0 +1,414 @@
+// Host harness for the raw-sector db ring (ring_log.h) on a file-backed block device that can
+// lose power in the middle of a sector write.
+//
+// FileDisk keeps the ring in a temporary file, one 512-byte sector per slot. A power cut stops
+// the device after a chosen number of sector writes; the write it interrupts lands only its first
+// `torn` bytes (0 = nothing, 512 = all of it but never acknowledged). A slot can also be made
+// unreadable. "Rebooting" is a fresh RingLog on the same file.
+//
+// Records carry a serial number and a pattern derived from it, so a recovered ring can be checked
+// record by record. The selftest runs:
+//   power cuts   random ring sizes, record lengths and cut points (torn 0..512 bytes); after the
+//                reboot the ring must hold exactly the closed sectors [oldest, head), in order,
+//                with every record intact, and keep appending across a second reboot
+//   bad sectors  unreadable slots are skipped by recovery (probeSkip) and by read()
+//   re-init      resume() keeps the buffered open sector on an SD re-mount (begin() would drop
+//                it) and refuses a different card
+// The bench prints recovery reads and time per ring size.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. ring_log_sim.cpp -o ring_log_sim
+//
+// Usage:
+//   ring_log_sim selftest   run the checks above (exit status 1 on failure)
+//   ring_log_sim bench      recovery cost per ring size
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <set>
+#include <vector>
+
+#include "ring_log.h"
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+// ---------------------------------------------------------------- block device
+
+struct FileDisk {
+  FILE *f = nullptr;
+  uint32_t count = 0;
+  long writesLeft = -1;       // power cut after this many more writes (-1: never)
+  uint32_t torn = 0;          // bytes of the interrupted write that reach the file
+  bool dead = false;
+  std::set<uint32_t> badSlots;
+  uint32_t writes = 0;
+
+  bool open(uint32_t sectors) {
+    f = tmpfile();
+    count = sectors;
+    if (!f) return false;
+    static const uint8_t zero[RING_SECTOR_BYTES] = {};
+    for (uint32_t i = 0; i < sectors; i++) fwrite(zero, 1, sizeof(zero), f);
+    fflush(f);
+    return true;
+  }
+  void close() {
+    if (f) fclose(f);
+    f = nullptr;
+  }
+  // Power back on: same file, no faults pending.
+  void powerOn() {
+    writesLeft = -1;
+    dead = false;
+  }
+
+  uint32_t sectorCount() { return count; }
+
+  bool readSector(uint32_t i, uint8_t *b) {
+    if (dead || i >= count || badSlots.count(i)) return false;
+    if (fseek(f, (long)i * RING_SECTOR_BYTES, SEEK_SET) != 0) return false;
+    return fread(b, 1, RING_SECTOR_BYTES, f) == RING_SECTOR_BYTES;
+  }
+
+  bool writeSector(uint32_t i, const uint8_t *b) {
+    if (dead || i >= count) return false;
+    uint32_t n = RING_SECTOR_BYTES;
+    if (writesLeft == 0) {
+      dead = true;
+      n = torn;
+    } else if (writesLeft > 0) {
+      writesLeft--;
+    }
+    if (n > 0) {
+      fseek(f, (long)i * RING_SECTOR_BYTES, SEEK_SET);
+      fwrite(b, 1, n, f);
+      fflush(f);
+    }
+    if (dead) return false;
+    writes++;
+    return true;
+  }
+};
+
+struct Rng {
+  uint64_t s;
+  uint32_t next() {
+    s ^= s << 13;
+    s ^= s >> 7;
+    s ^= s << 17;
+    return (uint32_t)s;
+  }
+  uint32_t below(uint32_t n) { return next() % n; }
+};
+
+// ---------------------------------------------------------------- records
+
+static uint8_t recordLen(uint32_t serial, uint32_t salt) { return (uint8_t)(6 + (serial * 7 + salt) % 40); }
+
+static uint8_t makeRecord(uint32_t serial, uint32_t salt, uint8_t *out) {
+  const uint8_t len = recordLen(serial, salt);
+  memcpy(out, &serial, 4);
+  for (uint8_t i = 4; i < len; i++) out[i] = (uint8_t)(serial * 31 + i * 17 + salt);
+  return len;
+}
+
+static bool checkRecord(const uint8_t *p, uint8_t len, uint32_t salt, uint32_t &serial) {
+  if (len < 6) return false;
+  memcpy(&serial, p, 4);
+  uint8_t want[64];
+  return makeRecord(serial, salt, want) == len && memcmp(want, p, len) == 0;
+}
+
+// Reads the whole ring from oldest(); false if any record is damaged.
+static bool readAll(RingLog<FileDisk> &r, uint32_t salt, std::vector<uint32_t> &serials) {
+  bool intact = true;
+  RingCursor c = r.oldest();
+  while (r.hasData(c)) {
+    RingCursor next = r.read(c, 64, [&](const uint8_t *p, uint8_t len) {
+      uint32_t s = 0;
+      if (checkRecord(p, len, salt, s)) serials.push_back(s);
+      else intact = false;
+    });
+    if (next.seq == c.seq && next.rec == c.rec) break;
+    c = next;
+  }
+  return intact;
+}
+
+static bool contiguous(const std::vector<uint32_t> &v) {
+  for (size_t i = 1; i < v.size(); i++) {
+    if (v[i] != v[i - 1] + 1) return false;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------- power cuts
+
+struct CutStats {
+  int trials = 0;
+  int failed = 0;
+  uint64_t recordsLostInRam = 0;
+  uint64_t probes = 0;
+};
+
+// One boot-append-cut-reboot-append-reboot cycle. Returns false on the first broken invariant.
+static bool powerCutTrial(Rng &rng, uint32_t trial, CutStats &st) {
+  const uint32_t sectors = 2 + rng.below(40);
+  const uint32_t salt = trial;
+  FileDisk disk;
+  if (!disk.open(sectors)) return false;
+
+  // The ring has already wrapped a few times on most trials before the cut.
+  RingLog<FileDisk> ring;
+  ring.begin(&disk);
+  const uint32_t closeBefore = rng.below(sectors * 4 + 1);
+  disk.writesLeft = closeBefore;
+  disk.torn = rng.below(RING_SECTOR_BYTES + 1);
+
+  std::vector<uint32_t> firstSerialOfSeq;   // per closed sector
+  uint32_t serial = 0, now = 0;
+  uint32_t lastDurable = UINT32_MAX;        // last serial in a sector whose write was acknowledged
+  uint32_t openFirst = 0;
+  bool cut = false;
+  while (!cut && serial < 100000) {
+    uint8_t rec[64];
+    const uint8_t len = makeRecord(serial, salt, rec);
+    const uint32_t headBefore = ring.headSeq;
+    if (ring.records == 0) openFirst = serial;
+    if (!ring.append(rec, len, now)) {
+      cut = true;
+      break;
+    }
+    if (ring.headSeq != headBefore) {        // append closed the full sector first
+      firstSerialOfSeq.push_back(openFirst);
+      lastDurable = serial - 1;
+      openFirst = serial;
+    }
+    serial++;
+    now += 100 + rng.below(400);
+    if (rng.below(8) == 0) {                // tick() after a quiet spell closes a part sector
+      const uint32_t h = ring.headSeq;
+      const uint32_t first = openFirst;
+      if (!ring.tick(now + ring.flushAfterMs)) {
+        if (ring.pending) cut = true;
+      } else if (ring.headSeq != h) {
+        firstSerialOfSeq.push_back(first);
+        lastDurable = serial - 1;
+      }
+    }
+  }
+  // The CRC covers the header and the used bytes only, so a torn write that got that far is a
+  // complete sector: recovery rightly keeps it, although the write was never acknowledged.
+  if (cut && disk.torn >= sizeof(RingSectorHeader) + ring.used) {
+    firstSerialOfSeq.push_back(openFirst);
+    lastDurable = serial - 1;
+  } else {
+    st.recordsLostInRam += ring.records;
+  }
+
+  // Reboot.
+  disk.powerOn();
+  RingLog<FileDisk> r2;
+  r2.begin(&disk);
+  st.probes += r2.sectorReads;
+  std::vector<uint32_t> got;
+  const bool intact = readAll(r2, salt, got);
+
+  const uint32_t closed = (uint32_t)firstSerialOfSeq.size();
+  bool ok = intact && contiguous(got) && r2.headSeq == closed;
+  if (ok && closed > 0) {
+    const uint32_t oldestSeq = closed > sectors - 1 ? closed - (sectors - 1) : 0;
+    ok = !got.empty() && got.front() == firstSerialOfSeq[oldestSeq] && got.back() == lastDurable;
+  }
+  if (ok && closed == 0) ok = got.empty();
+
+  // Keep logging after the reboot, then reboot once more: the new records follow the old ones.
+  if (ok) {
+    uint32_t next = got.empty() ? 1000000 : got.back() + 1;
+    const uint32_t more = 1 + rng.below(sectors * 20);
+    for (uint32_t i = 0; i < more; i++) {
+      uint8_t rec[64];
+      const uint8_t len = makeRecord(next + i, salt, rec);
+      ok = ok && r2.append(rec, len, now);
+    }
+    ok = ok && r2.flush();
+    RingLog<FileDisk> r3;
+    r3.begin(&disk);
+    std::vector<uint32_t> again;
+    ok = ok && readAll(r3, salt, again) && contiguous(again) && !again.empty() && again.back() == next + more - 1;
+  }
+
+  disk.close();
+  st.trials++;
+  if (!ok) st.failed++;
+  return ok;
+}
+
+static void powerCutChecks() {
+  Rng rng = { 0x9E3779B97F4A7C15ULL };
+  CutStats st;
+  uint32_t firstBad = UINT32_MAX;
+  for (uint32_t t = 0; t < 3000; t++) {
+    if (!powerCutTrial(rng, t, st) && firstBad == UINT32_MAX) firstBad = t;
+  }
+  char what[200];
+  snprintf(what, sizeof(what), "power cut mid-append, %d trials: every closed sector recovered in order, records intact "
+           "(%d failed%s)", st.trials, st.failed, firstBad == UINT32_MAX ? "" : ", see first failing trial");
+  expect(st.failed == 0, what);
+  if (firstBad != UINT32_MAX) printf("     first failing trial: %u\n", firstBad);
+  snprintf(what, sizeof(what), "only the open sector is lost: %.1f records per cut on average, %.1f recovery reads",
+           (double)st.recordsLostInRam / st.trials, (double)st.probes / st.trials);
+  expect(st.recordsLostInRam <= (uint64_t)st.trials * (RING_PAYLOAD_BYTES / 7), what);
+}
+
+// ---------------------------------------------------------------- bad sectors
+
+static void badSectorChecks() {
+  FileDisk disk;
+  disk.open(64);
+  RingLog<FileDisk> ring;
+  ring.begin(&disk);
+  uint32_t serial = 0;
+  for (int s = 0; s < 64 + 20; s++) {   // wrap once, head at 20
+    uint8_t rec[64];
+    const uint8_t len = makeRecord(serial++, 1, rec);
+    ring.append(rec, len, 0);
+    ring.flush();
+  }
+  const uint32_t head = ring.headSeq;
+  disk.badSlots = { 5, 6, 7 };
+  RingLog<FileDisk> r2;
+  r2.begin(&disk);
+  expect(r2.headSeq == head, "unreadable slots inside the current lap: recovery probes past them to the head");
+  std::vector<uint32_t> got;
+  const bool intact = readAll(r2, 1, got);
+  expect(intact && got.size() == 63 - 3 && got.back() == serial - 1, "unreadable sectors are skipped on read, the rest intact");
+
+  // The last sectors themselves unreadable: their records are gone either way, and the ring
+  // resumes right after the last readable one instead of losing its place.
+  disk.badSlots = { 17, 18, 19 };
+  RingLog<FileDisk> r3;
+  r3.begin(&disk);
+  expect(r3.headSeq == head - 3, "unreadable slots just below the head: resumes after the last readable sector");
+  disk.close();
+}
+
+// ---------------------------------------------------------------- re-init
+
+static void reinitChecks() {
+  FileDisk disk;
+  disk.open(32);
+  RingLog<FileDisk> ring;
+  ring.begin(&disk);
+  uint32_t serial = 0;
+  for (int i = 0; i < 200; i++) {
+    uint8_t rec[64];
+    const uint8_t len = makeRecord(serial++, 2, rec);
+    ring.append(rec, len, 0);
+  }
+  const uint16_t buffered = ring.records;
+  expect(ring.pending && buffered > 0, "records buffered in the open sector before the re-init");
+
+  // Same card re-mounted: the RAM head stays, and its records reach the card on the next flush.
+  expect(ring.resume() && ring.pending && ring.records == buffered, "resume() on the same card keeps the open sector");
+  ring.flush();
+  RingLog<FileDisk> after;
+  after.begin(&disk);
+  std::vector<uint32_t> got;
+  expect(readAll(after, 2, got) && got.size() == serial && got.back() == serial - 1,
+         "after resume() + flush() every record is on the card");
+
+  // What the re-init used to do: begin() recovers from the card and drops the buffer.
+  for (int i = 0; i < 20; i++) {
+    uint8_t rec[64];
+    const uint8_t len = makeRecord(serial++, 2, rec);
+    after.append(rec, len, 0);
+  }
+  const uint16_t lost = after.records;
+  after.begin(&disk);
+  char what[120];
+  snprintf(what, sizeof(what), "begin() on a re-init drops the %u buffered records resume() keeps", (unsigned)lost);
+  expect(lost > 0 && after.records == 0 && !after.pending, what);
+
+  // Another card with its own ring in the slot: resume() refuses, begin() takes over.
+  FileDisk other;
+  other.open(32);
+  RingLog<FileDisk> otherRing;
+  otherRing.begin(&other);
+  for (int i = 0; i < 50; i++) {
+    uint8_t rec[64];
+    const uint8_t len = makeRecord(500000 + i, 2, rec);
+    otherRing.append(rec, len, 0);
+    otherRing.flush();
+  }
+  RingLog<FileDisk> moved;
+  moved.begin(&disk);
+  moved.dev = &other;
+  expect(!moved.resume(), "resume() on a different card: refused");
+  expect(moved.begin(&other) && moved.headSeq == otherRing.headSeq, "begin() then recovers that card's own head");
+
+  // Nothing closed yet: a blank card is fine, one with a ring is not.
+  FileDisk blank;
+  blank.open(32);
+  RingLog<FileDisk> fresh;
+  fresh.begin(&blank);
+  uint8_t rec[64];
+  fresh.append(rec, makeRecord(1, 2, rec), 0);
+  expect(fresh.resume() && fresh.records == 1, "resume() before the first sector closed: blank card accepted");
+  fresh.dev = &other;
+  expect(!fresh.resume(), "resume() before the first sector closed: a card with a ring refused");
+
+  disk.close();
+  other.close();
+  blank.close();
+}
+
+// ---------------------------------------------------------------- bench
+
+static void bench() {
+  printf("\nrecovery cost (head at ~37%% of the second lap)\n");
+  printf("  %10s %10s %10s %12s\n", "sectors", "MB", "reads", "recover us");
+  for (uint32_t sectors : { 256u, 4096u, 65536u }) {
+    FileDisk disk;
+    if (!disk.open(sectors)) return;
+    RingLog<FileDisk> ring;
+    ring.begin(&disk);
+    uint8_t rec[64];
+    const uint32_t total = sectors + sectors * 37 / 100;
+    for (uint32_t s = 0; s < total; s++) {
+      ring.append(rec, makeRecord(s, 3, rec), 0);
+      ring.flush();
+    }
+    RingLog<FileDisk> r2;
+    const auto t0 = std::chrono::steady_clock::now();
+    r2.begin(&disk);
+    const auto t1 = std::chrono::steady_clock::now();
+    printf("  %10u %10.1f %10u %12lld%s\n", sectors, sectors * 512.0 / 1048576.0, r2.sectorReads,
+           (long long)std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count(),
+           r2.headSeq == total ? "" : "  (head mismatch)");
+    disk.close();
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) {
+    powerCutChecks();
+    badSectorChecks();
+    reinitChecks();
+    return fails ? 1 : 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "bench")) {
+    bench();
+    return 0;
+  }
+  fprintf(stderr, "usage: ring_log_sim selftest | bench\n");
+  return 2;
+}
@@ -0,0 +1,660 @@
+// Host harness for the tickless loop scheduler (loop_scheduler.h).
+//
+// Everything runs on a virtual clock: the scheduler's microsecond clock reads it, jobs advance it
+// by their simulated cost, and the driver "sleeps" by jumping it to the next deadline. The wheel
+// checks arm dozens of jobs with periods from 1 ms to well past the top level's span and verify
+// that every run starts exactly on its deadline, across a millis() wrap. The loop model compares
+// the old fixed-delay loop() with the tickless one using the firmware's job table. The trace run
+// attaches the stall tracer (trace_ring.h) to the loop model and writes the frozen ring as Chrome
+// trace JSON.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. sched_sim.cpp -o sched_sim
+//
+// Usage:
+//   sched_sim selftest          wheel, priority, budget, slack and skip checks plus the loop
+//                               model (exit status 1 on failure)
+//   sched_sim loop [minutes]    loop model only: wakeups and job lateness, old vs tickless
+//   sched_sim trace [out.json]  loop model with a 2.5 s TLS connect in one sync run; writes the
+//                               trace the stall froze (default stall_trace.json)
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "loop_scheduler.h"
+#include "trace_ring.h"
+
+static uint64_t vclockUs = 0;
+static uint32_t vclock() { return (uint32_t)vclockUs; }
+static uint32_t vnowMs() { return (uint32_t)(vclockUs / 1000); }
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+// A job that checks each run lands on its deadline and charges a fixed cost to the clock.
+struct Probe {
+  uint32_t period = 0;
+  uint32_t nextDue = 0;
+  uint32_t costUs = 0;
+  uint32_t runs = 0;
+  uint32_t offBeat = 0;      // runs that did not start exactly on the deadline
+  uint32_t lastRunMs = 0;
+  std::vector<int> *order = nullptr;
+  int tag = 0;
+};
+
+static uint32_t probeJob(void *ctx, uint32_t now) {
+  Probe *p = (Probe *)ctx;
+  if (now != p->nextDue) p->offBeat++;
+  p->runs++;
+  p->lastRunMs = now;
+  p->nextDue = now + p->period;
+  if (p->order) p->order->push_back(p->tag);
+  vclockUs += p->costUs;
+  return p->period;
+}
+
+static uint32_t logUniformPeriod(std::mt19937 &rng) {
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  return (uint32_t)std::max(1.0, pow(10.0, u(rng) * 6.6));   // 1 ms .. ~66 min
+}
+
+// Sleeps exactly until each deadline; every run must be on time.
+static void wheelTickless(uint32_t startMs, uint32_t spanMs, const char *label) {
+  std::mt19937 rng(7);
+  LoopScheduler<64> s;
+  std::vector<Probe> probes(60);
+  vclockUs = (uint64_t)startMs * 1000;
+  s.clockUs = vclock;
+  for (size_t i = 0; i < probes.size(); i++) {
+    Probe &p = probes[i];
+    p.period = logUniformPeriod(rng);
+    uint32_t first = rng() % (p.period + 1);
+    p.nextDue = startMs + first;
+    s.add("p", probeJob, &p, 0, 0, 0, startMs, first);
+  }
+  const uint64_t endUs = vclockUs + (uint64_t)spanMs * 1000;
+  uint32_t sleeps = 0;
+  bool spun = false;
+  while (vclockUs < endUs) {
+    uint32_t now = vnowMs();
+    s.run(now);
+    uint32_t wait = s.msUntilNext(now);
+    if (wait == 0) {
+      spun = true;
+      break;
+    }
+    sleeps++;
+    vclockUs = (uint64_t)(now + wait - startMs) * 1000 + (uint64_t)startMs * 1000;
+  }
+
+  uint32_t offBeat = 0, lateMax = 0, wrong = 0;
+  uint64_t runs = 0;
+  const uint32_t endMs = startMs + spanMs;
+  for (size_t i = 0; i < probes.size(); i++) {
+    const Probe &p = probes[i];
+    offBeat += p.offBeat;
+    lateMax = std::max(lateMax, s.jobs[i].lateMaxMs);
+    runs += p.runs;
+    if ((int32_t)(p.nextDue - endMs) < 0) wrong++;   // a deadline inside the span was never run
+  }
+  char what[200];
+  snprintf(what, sizeof(what), "%s: %llu runs in %u sleeps, all on their deadline (off-beat %u, late max %u ms, missed %u)",
+           label, (unsigned long long)runs, sleeps, offBeat, lateMax, wrong);
+  expect(!spun && offBeat == 0 && lateMax == 0 && wrong == 0, what);
+  snprintf(what, sizeof(what), "%s: %u cascades", label, s.cascades);
+  expect(s.cascades > 0, what);
+}
+
+// Steps the clock by random jumps; runs may be late by at most the jump, and runs + skipped
+// periods account for every deadline.
+static void wheelJumps() {
+  std::mt19937 rng(11);
+  LoopScheduler<64> s;
+  std::vector<Probe> probes(40);
+  const uint32_t startMs = 1000;
+  vclockUs = (uint64_t)startMs * 1000;
+  s.clockUs = vclock;
+  for (size_t i = 0; i < probes.size(); i++) {
+    probes[i].period = logUniformPeriod(rng);
+    probes[i].nextDue = startMs;
+    s.add("p", probeJob, &probes[i], 0, 0, 0, startMs, 0);
+  }
+  uint32_t maxJump = 0;
+  uint32_t now = startMs;
+  for (int step = 0; step < 200000; step++) {
+    s.run(now);
+    uint32_t jump = 1 + rng() % 3000;
+    maxJump = std::max(maxJump, jump);
+    now += jump;
+    vclockUs = (uint64_t)now * 1000;
+  }
+  s.run(now);
+  uint32_t lateMax = 0, unaccounted = 0;
+  for (size_t i = 0; i < probes.size(); i++) {
+    const LoopJob &j = s.jobs[i];
+    lateMax = std::max(lateMax, j.lateMaxMs);
+    // Every period between the first deadline and the current one was either run or skipped.
+    uint64_t periods = (uint64_t)(j.due - startMs) / probes[i].period;
+    if (periods != (uint64_t)j.runs + j.skipped && periods != (uint64_t)j.runs + j.skipped + 1) unaccounted++;
+  }
+  char what[160];
+  snprintf(what, sizeof(what), "random jumps: late max %u ms <= max jump %u ms, every period run or skipped (%u off)",
+           lateMax, maxJump, unaccounted);
+  expect(lateMax < maxJump && unaccounted == 0, what);
+}
+
+static void priorityChecks() {
+  LoopScheduler<8> s;
+  vclockUs = 0;
+  s.clockUs = vclock;
+  std::vector<int> order;
+  Probe a, b, c;
+  a.period = b.period = c.period = 100;
+  a.order = b.order = c.order = &order;
+  a.tag = 1;
+  b.tag = 2;
+  c.tag = 3;
+  a.nextDue = b.nextDue = c.nextDue = 100;
+  s.add("low", probeJob, &a, 3, 0, 0, 0, 100);
+  s.add("high", probeJob, &b, 0, 0, 0, 0, 100);
+  s.add("mid", probeJob, &c, 1, 0, 0, 0, 100);
+  vclockUs = 100000;
+  s.run(100);
+  expect(order == std::vector<int>({ 2, 3, 1 }), "same deadline: jobs run in priority order");
+
+  // Pass budget: 15 ms jobs against a 20 ms pass budget.
+  LoopScheduler<8> t;
+  vclockUs = 0;
+  t.clockUs = vclock;
+  t.passBudgetUs = 20000;
+  order.clear();
+  Probe x, y, z;
+  for (Probe *p : { &x, &y, &z }) {
+    p->period = 1000;
+    p->costUs = 15000;
+    p->order = &order;
+    p->nextDue = 10;
+  }
+  x.tag = 1;
+  y.tag = 2;
+  z.tag = 3;
+  t.add("x", probeJob, &x, 0, 10000, 0, 0, 10);
+  t.add("y", probeJob, &y, 1, 0, 0, 0, 10);
+  t.add("z", probeJob, &z, 2, 0, 0, 0, 10);
+  vclockUs = 10000;
+  t.run(10);
+  bool firstPass = (order == std::vector<int>({ 1, 2 })) && t.jobs[2].deferred == 1 && t.msUntilNext(vnowMs()) == 0;
+  t.run(vnowMs());
+  expect(firstPass && order.size() == 3 && order[2] == 3 && t.passesDeferred == 1,
+         "pass budget: third job deferred to the next pass, which runs without sleeping");
+  expect(t.jobs[0].overruns == 1 && t.jobs[1].overruns == 0, "per-job budget: 15 ms run over a 10 ms budget is an overrun");
+  char what[160];
+  snprintf(what, sizeof(what), "deferred job lateness recorded (%u ms)", t.jobs[2].lateMaxMs);
+  expect(t.jobs[2].lateMaxMs >= 30, what);
+}
+
+static uint32_t stopAfterTwo(void *ctx, uint32_t now) {
+  (void)now;
+  int *n = (int *)ctx;
+  return ++*n >= 2 ? LOOP_JOB_STOP : 50;
+}
+
+static void rearmChecks() {
+  LoopScheduler<8> s;
+  vclockUs = 0;
+  s.clockUs = vclock;
+  int n = 0;
+  int id = s.add("once", stopAfterTwo, &n, 0, 0, 0, 0, 10);
+  for (uint32_t t = 0; t <= 1000; t++) s.run(t);
+  bool stopped = (n == 2) && !s.jobs[id].armed && s.msUntilNext(1000) == LOOP_SCHED_IDLE;
+  s.kick(id, 1000);
+  s.run(1000);
+  expect(stopped && n == 3, "LOOP_JOB_STOP disarms; kick() runs it on the next pass");
+
+  // Falling behind skips missed periods instead of bursting, and keeps the phase.
+  LoopScheduler<8> k;
+  vclockUs = 0;
+  k.clockUs = vclock;
+  Probe p;
+  p.period = 100;
+  p.nextDue = 100;
+  k.add("p", probeJob, &p, 0, 0, 0, 0, 100);
+  k.run(100);
+  k.run(1050);   // a 950 ms stall
+  uint32_t runsAfterStall = p.runs;
+  uint32_t nextIn = k.msUntilNext(1050);
+  k.run(1100);
+  char what[160];
+  snprintf(what, sizeof(what), "stall: %u runs, %u skipped, next deadline %u ms out on the old phase", runsAfterStall,
+           k.jobs[0].skipped, nextIn);
+  expect(runsAfterStall == 2 && k.jobs[0].skipped == 8 && nextIn == 50 && p.runs == 3, what);
+}
+
+static void slackChecks() {
+  LoopScheduler<8> s;
+  vclockUs = 0;
+  s.clockUs = vclock;
+  Probe tight, loose;
+  tight.period = 250;
+  loose.period = 250;
+  tight.nextDue = 250;
+  loose.nextDue = 100;
+  s.add("tight", probeJob, &tight, 0, 0, 0, 0, 250);
+  s.add("loose", probeJob, &loose, 0, 0, 200, 0, 100);
+  uint32_t now = 0, wakes = 0;
+  while (now < 10000) {
+    s.run(now);
+    now += s.msUntilNext(now);
+    vclockUs = (uint64_t)now * 1000;
+    wakes++;
+  }
+  char what[160];
+  snprintf(what, sizeof(what), "slack: a 250 ms job 150 ms ahead of another rides its wakeups (%u wakes, %u+%u runs, late max %u ms)",
+           wakes, tight.runs, loose.runs, s.jobs[1].lateMaxMs);
+  expect(wakes <= 41 && tight.runs == 39 && loose.runs == 39 && s.jobs[1].lateMaxMs == 150 && tight.offBeat == 0, what);
+}
+
+// ---- loop model ----
+// The firmware's job table (releasev1.ino initLoopJobs) with costs typical of the real work.
+struct ModelJob {
+  const char *name;
+  uint32_t periodMs;
+  uint32_t slackMs;
+  uint32_t costUs;
+  uint8_t prio;
+};
+
+static const ModelJob MODEL_JOBS[] = {
+  { "mp3", 500, 500, 40, 0 },          // idle module
+  { "status_led", 250, 100, 30, 1 },   // steady colour
+  { "db_sample", 100, 250, 900, 2 },
+  { "monitor_log", 250, 250, 20, 2 },
+  { "db_ring", 1000, 500, 300, 2 },
+  { "storage", 60000, 20, 8000, 3 },
+  { "heap", 10000, 1000, 400, 3 },
+  { "rtc", 15000, 2000, 50, 3 },
+  { "mp3_probe", 5000, 500, 20, 3 },
+  { "internet", 10000, 1000, 200, 4 },
+  { "sync", 3000, 250, 2000, 4 },
+  { "db_upload", 3600000, 1000, 400000, 4 },
+};
+static const int MODEL_JOB_COUNT = (int)(sizeof(MODEL_JOBS) / sizeof(MODEL_JOBS[0]));
+static const uint32_t FRAME_COST_US = 6000;   // i2s read + DSP + classifier + LEDs
+
+struct ModelCtx {
+  const ModelJob *job;
+  uint32_t frameMs;
+};
+
+static uint32_t modelJob(void *ctx, uint32_t now) {
+  (void)now;
+  ModelCtx *m = (ModelCtx *)ctx;
+  vclockUs += m->job->costUs;
+  uint32_t period = m->job->periodMs;
+  if (!strcmp(m->job->name, "db_sample")) period = std::max(period, m->frameMs);
+  if (!strcmp(m->job->name, "sync") && m->frameMs > 50) period = 60000;
+  return period;
+}
+
+struct ModelResult {
+  double wakesPerSec;
+  double frames;
+  double lateAvgMs;
+  uint32_t lateMaxMs;
+  double awakePct;
+  int overSlack;     // jobs that ran later than their slack (+10 ms of other jobs' run time)
+};
+
+// Old loop(): every check polled each pass, then delay(frame). With the mic off it returned
+// early into delay(50) before the frame.
+static ModelResult modelOld(uint32_t frameMs, bool mic, uint32_t minutes) {
+  std::vector<uint32_t> last(MODEL_JOB_COUNT, 0);
+  uint64_t lateSum = 0, runs = 0, busyUs = 0;
+  uint32_t lateMax = 0, passes = 0;
+  vclockUs = 0;
+  const uint64_t endUs = (uint64_t)minutes * 60000000ULL;
+  while (vclockUs < endUs) {
+    uint64_t t0 = vclockUs;
+    uint32_t now = vnowMs();
+    if (mic) vclockUs += FRAME_COST_US;
+    for (int i = 0; i < MODEL_JOB_COUNT; i++) {
+      uint32_t period = MODEL_JOBS[i].periodMs;
+      if (!strcmp(MODEL_JOBS[i].name, "sync") && frameMs > 50) period = 60000;
+      if (!strcmp(MODEL_JOBS[i].name, "status_led") || !strcmp(MODEL_JOBS[i].name, "mp3")) period = 0;   // every pass
+      if (now - last[i] < period) continue;
+      uint32_t due = last[i] + period;
+      uint32_t late = (period && last[i]) ? now - due : 0;
+      lateSum += late;
+      lateMax = std::max(lateMax, late);
+      runs++;
+      last[i] = now;
+      vclockUs += MODEL_JOBS[i].costUs;
+    }
+    busyUs += vclockUs - t0;
+    passes++;
+    vclockUs += (uint64_t)(mic ? frameMs : 50) * 1000;
+  }
+  ModelResult r;
+  r.overSlack = 0;
+  r.wakesPerSec = passes / (minutes * 60.0);
+  r.frames = mic ? passes : 0;
+  r.lateAvgMs = runs ? (double)lateSum / runs : 0;
+  r.lateMaxMs = lateMax;
+  r.awakePct = 100.0 * busyUs / endUs;
+  return r;
+}
+
+// New loop(): frames on a fixed cadence, jobs on the wheel, sleep until whichever is next.
+static ModelResult modelTickless(uint32_t frameMs, bool mic, uint32_t minutes, LoopScheduler<16> &s) {
+  std::vector<ModelCtx> ctx(MODEL_JOB_COUNT);
+  vclockUs = 0;
+  s.clockUs = vclock;
+  s.passBudgetUs = 20000;
+  for (int i = 0; i < MODEL_JOB_COUNT; i++) {
+    ctx[i].job = &MODEL_JOBS[i];
+    ctx[i].frameMs = frameMs;
+    s.add(MODEL_JOBS[i].name, modelJob, &ctx[i], MODEL_JOBS[i].prio, 0, MODEL_JOBS[i].slackMs, 0,
+          std::min<uint32_t>(MODEL_JOBS[i].periodMs, 3600000));
+  }
+  uint32_t nextFrame = 0, wakes = 0, frames = 0;
+  uint64_t busyUs = 0;
+  const uint64_t endUs = (uint64_t)minutes * 60000000ULL;
+  while (vclockUs < endUs) {
+    uint64_t t0 = vclockUs;
+    uint32_t now = vnowMs();
+    if (mic && (int32_t)(now - nextFrame) >= 0) {
+      vclockUs += FRAME_COST_US;
+      frames++;
+      nextFrame += frameMs;
+      if ((int32_t)(nextFrame - now) <= 0) nextFrame = now + frameMs;
+    }
+    s.run(now);
+    busyUs += vclockUs - t0;
+    uint32_t after = vnowMs();
+    uint32_t wait = std::min<uint32_t>(s.msUntilNext(after), 250);
+    int32_t frameIn = (int32_t)(nextFrame - after);
+    if (mic) wait = std::min<uint32_t>(wait, frameIn > 0 ? (uint32_t)frameIn : 0);
+    s.noteSleep(wait);
+    if (wait) wakes++;
+    vclockUs = (uint64_t)(after + wait) * 1000 + (wait ? 0 : vclockUs % 1000);
+  }
+  uint64_t lateSum = 0, runs = 0;
+  uint32_t lateMax = 0;
+  for (int i = 0; i < s.count; i++) {
+    lateSum += s.jobs[i].lateSumMs;
+    runs += s.jobs[i].runs;
+    lateMax = std::max(lateMax, s.jobs[i].lateMaxMs);
+  }
+  ModelResult r;
+  r.overSlack = 0;
+  for (int i = 0; i < s.count; i++) {
+    if (s.jobs[i].lateMaxMs > s.jobs[i].slackMs + 10) r.overSlack++;
+  }
+  r.wakesPerSec = wakes / (minutes * 60.0);
+  r.frames = frames;
+  r.lateAvgMs = runs ? (double)lateSum / runs : 0;
+  r.lateMaxMs = lateMax;
+  r.awakePct = 100.0 * busyUs / endUs;
+  return r;
+}
+
+struct ModelCase {
+  const char *mode;
+  uint32_t frameMs;
+  bool mic;
+};
+
+static void loopModel(uint32_t minutes, bool check) {
+  static const ModelCase CASES[] = { { "active", 50, true }, { "quiet", 250, true }, { "mic off", 50, false } };
+  printf("\nloop model, %u min of virtual time\n", minutes);
+  printf("%-8s %-9s %10s %10s %12s %12s %9s\n", "mode", "loop", "wakes/s", "frames/s", "late avg ms", "late max ms",
+         "awake %");
+  for (const ModelCase &c : CASES) {
+    ModelResult o = modelOld(c.frameMs, c.mic, minutes);
+    LoopScheduler<16> s;
+    ModelResult n = modelTickless(c.frameMs, c.mic, minutes, s);
+    printf("%-8s %-9s %10.2f %10.2f %12.2f %12u %9.2f\n", c.mode, "delay", o.wakesPerSec, o.frames / (minutes * 60.0),
+           o.lateAvgMs, o.lateMaxMs, o.awakePct);
+    printf("%-8s %-9s %10.2f %10.2f %12.2f %12u %9.2f\n", c.mode, "tickless", n.wakesPerSec, n.frames / (minutes * 60.0),
+           n.lateAvgMs, n.lateMaxMs, n.awakePct);
+    if (!check) continue;
+    char what[200];
+    if (c.mic) {
+      snprintf(what, sizeof(what), "%s: frames at the nominal rate (%.2f/s vs %.2f/s with delay)", c.mode,
+               n.frames / (minutes * 60.0), o.frames / (minutes * 60.0));
+      expect(n.frames / (minutes * 60.0) >= 0.99 * 1000.0 / c.frameMs && n.frames >= o.frames, what);
+      snprintf(what, sizeof(what), "%s: no more wakeups than frames + 10%% (%.2f/s)", c.mode, n.wakesPerSec);
+      expect(n.wakesPerSec <= 1.1 * 1000.0 / c.frameMs, what);
+    } else {
+      snprintf(what, sizeof(what), "%s: %.2f wakeups/s instead of %.2f", c.mode, n.wakesPerSec, o.wakesPerSec);
+      expect(n.wakesPerSec <= 5.0, what);
+    }
+    snprintf(what, sizeof(what), "%s: every job within its slack (late avg %.2f ms, max %u ms; delay loop %.2f / %u)",
+             c.mode, n.lateAvgMs, n.lateMaxMs, o.lateAvgMs, o.lateMaxMs);
+    expect(n.overSlack == 0 && (!c.mic || n.lateAvgMs < o.lateAvgMs), what);
+  }
+}
+
+// ---- stall trace ----
+// The tickless loop model with the tracer attached the way releasev1.ino attaches it: the
+// scheduler's span hook around every job, spans for the pass, the frame and handleClient, and
+// the same 1.5 s gap between passes as the stall detector. One sync run blocks in a TLS connect.
+static TraceRing<2048> simTrace;
+
+static void simSpan(const char *name, bool begin) {
+  const uint16_t id = simTrace.intern(name);
+  if (begin) simTrace.begin(id);
+  else simTrace.end(id);
+}
+
+struct SimSpan {
+  uint16_t id;
+  explicit SimSpan(const char *name) : id(simTrace.intern(name)) { simTrace.begin(id); }
+  ~SimSpan() { simTrace.end(id); }
+};
+
+static uint32_t stallAtMs = 0;
+static uint32_t stallConnectMs = 0;
+static bool stallFired = false;
+
+static uint32_t traceJob(void *ctx, uint32_t now) {
+  ModelCtx *m = (ModelCtx *)ctx;
+  if (!strcmp(m->job->name, "sync") && !stallFired && now >= stallAtMs) {
+    stallFired = true;
+    SimSpan a("trySyncPendingEvents");
+    vclockUs += 300;
+    {
+      SimSpan b("supabasePostJson");
+      {
+        SimSpan c("http.connect");
+        vclockUs += (uint64_t)stallConnectMs * 1000;
+      }
+      vclockUs += 4000;
+    }
+    SimSpan d("sd.swapPending");
+    vclockUs += 15000;
+    return m->job->periodMs;
+  }
+  if (!strcmp(m->job->name, "mp3_probe")) {
+    SimSpan a("probeMp3");
+    return modelJob(ctx, now);
+  }
+  return modelJob(ctx, now);
+}
+
+struct TraceResult {
+  uint32_t passes = 0;
+  uint32_t windowMs = 0;     // time the frozen ring covers
+  std::string json;
+};
+
+static TraceResult traceModel(uint32_t seconds, uint32_t stallAtS, uint32_t connectMs) {
+  static LoopScheduler<16> s;
+  s = LoopScheduler<16>();
+  simTrace = TraceRing<2048>();
+  std::vector<ModelCtx> ctx(MODEL_JOB_COUNT);
+  vclockUs = 0;
+  stallAtMs = stallAtS * 1000;
+  stallConnectMs = connectMs;
+  stallFired = false;
+  simTrace.clockUs = vclock;
+  s.clockUs = vclock;
+  s.spanHook = simSpan;
+  s.passBudgetUs = 20000;
+  const uint32_t frameMs = 50;
+  for (int i = 0; i < MODEL_JOB_COUNT; i++) {
+    ctx[i].job = &MODEL_JOBS[i];
+    ctx[i].frameMs = frameMs;
+    s.add(MODEL_JOBS[i].name, traceJob, &ctx[i], MODEL_JOBS[i].prio, 0, MODEL_JOBS[i].slackMs, 0,
+          std::min<uint32_t>(MODEL_JOBS[i].periodMs, 3600000));
+  }
+  TraceResult r;
+  uint32_t nextFrame = 0, lastPassMs = 0;
+  const uint64_t endUs = (uint64_t)seconds * 1000000ULL;
+  while (vclockUs < endUs) {
+    const uint32_t now = vnowMs();
+    {
+      SimSpan pass("loop");
+      if (r.passes > 0 && now - lastPassMs > 1500) simTrace.freeze("loop stall", now - lastPassMs);
+      lastPassMs = now;
+      r.passes++;
+      {
+        SimSpan h("server.handleClient");
+        vclockUs += 80;
+      }
+      if ((int32_t)(now - nextFrame) >= 0) {
+        SimSpan f("readMicDB");
+        vclockUs += FRAME_COST_US;
+        nextFrame += frameMs;
+        if ((int32_t)(nextFrame - now) <= 0) nextFrame = now + frameMs;
+      }
+      s.run(now);
+    }
+    const uint32_t after = vnowMs();
+    uint32_t wait = std::min<uint32_t>(s.msUntilNext(after), 250);
+    const int32_t frameIn = (int32_t)(nextFrame - after);
+    wait = std::min<uint32_t>(wait, frameIn > 0 ? (uint32_t)frameIn : 0);
+    vclockUs = (uint64_t)(after + wait) * 1000 + (wait ? 0 : vclockUs % 1000);
+  }
+  const uint32_t n = simTrace.size();
+  if (n) r.windowMs = (simTrace.rec[(simTrace.head - 1) & 2047].tsUs - simTrace.rec[(simTrace.head - n) & 2047].tsUs) / 1000;
+  simTrace.writeChrome("sim", [&r](const char *line) { r.json += line; });
+  return r;
+}
+
+static int countOf(const std::string &s, const char *needle) {
+  int n = 0;
+  for (size_t at = s.find(needle); at != std::string::npos; at = s.find(needle, at + 1)) n++;
+  return n;
+}
+
+static void traceChecks() {
+  TraceRing<8> t;
+  static const char nameA[] = "alpha";
+  char copy[8];
+  strcpy(copy, nameA);
+  const uint16_t a = t.intern(nameA);
+  expect(a == 1 && t.intern(copy) == a && t.intern("beta") == 2, "trace: names interned once, by content");
+  bool allX = true;
+  static char many[TRACE_MAX_NAMES + 4][8];
+  for (int i = 0; i < TRACE_MAX_NAMES + 4; i++) {
+    snprintf(many[i], sizeof(many[i]), "n%d", i);
+    uint16_t id = t.intern(many[i]);
+    if (i >= TRACE_MAX_NAMES - 3 && id != 0) allX = false;
+  }
+  expect(allX, "trace: a full name table maps new names to id 0");
+
+  TraceRing<8> w;
+  vclockUs = 0;
+  w.clockUs = vclock;
+  const uint16_t outer = w.intern("outer"), inner = w.intern("inner");
+  w.begin(outer);
+  for (int i = 0; i < 6; i++) {
+    vclockUs += 10;
+    w.begin(inner);
+    vclockUs += 10;
+    w.end(inner);
+  }
+  std::string js;
+  w.writeChrome("t", [&js](const char *line) { js += line; });
+  expect(w.size() == 8 && countOf(js, "\"ph\":\"B\"") == countOf(js, "\"ph\":\"E\"") &&
+             countOf(js, "\"name\":\"outer\"") == 0,
+         "trace: wrapped ring drops the overwritten begin's end and stays balanced");
+  w.begin(outer);
+  w.freeze("stall", 2000);
+  w.freeze("later", 3000);
+  w.end(outer);
+  w.begin(inner);
+  js.clear();
+  w.writeChrome("t", [&js](const char *line) { js += line; });
+  expect(w.frozen && w.freezes == 2 && w.dropped == 2 && !strcmp(w.freezeReason, "stall") && w.freezeStallMs == 2000,
+         "trace: first freeze wins, later records dropped");
+  expect(countOf(js, "\"ph\":\"B\"") == countOf(js, "\"ph\":\"E\"") && countOf(js, "\"name\":\"stall\"") == 1,
+         "trace: span open at the freeze is closed in the export");
+  w.rearm();
+  w.begin(inner);
+  expect(!w.frozen && w.size() == 1, "trace: rearm records again");
+
+  TraceResult r = traceModel(30, 20, 2500);
+  char what[200];
+  snprintf(what, sizeof(what), "trace: loop model froze on the stall (%s, %u ms; ring covers %u ms)", simTrace.freezeReason,
+           simTrace.freezeStallMs, r.windowMs);
+  expect(simTrace.frozen && !strcmp(simTrace.freezeReason, "loop stall") && simTrace.freezeStallMs >= 2500 &&
+             simTrace.freezes == 1,
+         what);
+  expect(countOf(r.json, "\"name\":\"http.connect\",\"ph\":\"B\"") == 1 &&
+             countOf(r.json, "\"name\":\"supabasePostJson\",\"ph\":\"B\"") == 1,
+         "trace: the blocking connect is in the frozen ring");
+  expect(countOf(r.json, "\"ph\":\"B\"") == countOf(r.json, "\"ph\":\"E\"") && simTrace.dropped > 0 && r.windowMs > 2500,
+         "trace: export balanced; recording stopped after the freeze");
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) {
+    wheelTickless(0, 6 * 3600 * 1000, "tickless 6 h");
+    wheelTickless(0xFFFFFFFFu - 1800 * 1000, 3600 * 1000, "across millis() wrap");
+    wheelJumps();
+    priorityChecks();
+    rearmChecks();
+    slackChecks();
+    loopModel(60, true);
+    traceChecks();
+    return fails ? 1 : 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "trace")) {
+    const char *path = argc >= 3 ? argv[2] : "stall_trace.json";
+    TraceResult r = traceModel(30, 20, 2500);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+      perror(path);
+      return 1;
+    }
+    fwrite(r.json.data(), 1, r.json.size(), f);
+    fclose(f);
+    printf("%s: %s after %u passes, stall %u ms; %u records covering %u ms, %u dropped after the freeze\n", path,
+           simTrace.frozen ? simTrace.freezeReason : "not frozen", r.passes, simTrace.freezeStallMs, simTrace.size(),
+           r.windowMs, simTrace.dropped);
+    return 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "loop")) {
+    uint32_t minutes = argc >= 3 ? (uint32_t)atoi(argv[2]) : 60;
+    if (minutes == 0) minutes = 60;
+    loopModel(minutes, false);
+    return 0;
+  }
+  fprintf(stderr, "usage: sched_sim selftest | loop [minutes] | trace [out.json]\n");
+  return 2;
+}
@@ -0,0 +1,231 @@
+// Host harness for the SD benchmark / SPI clock auto-tune (sd_bench.h) on a simulated card.
+//
+// SimCard implements the benchmark's Io on a RAM block device with a virtual microsecond clock.
+// The cost model (estimates, not measurements of a particular card): SPI transfers at the mount
+// clock with ~10% framing; 250 us of program time per 512 B sector for single-block writes and
+// 120 us for multi-block ones (4 KB buffers); 1.5 ms per open (directory lookup), 2 ms per close
+// (FAT and directory update), 20 ms per mount. A card profile sets the highest clock it mounts at,
+// the highest clock it reads back cleanly (above that every read has flipped bits) and,
+// optionally, one marginal clock that passes once and then fails.
+//
+// Every mount() bumps the card's generation. A handle opened before it is stale afterwards, the
+// way SD.end()/SD.begin() invalidates every File the firmware holds. That is why the firmware
+// runs the sweep off the loop and refuses it during a /files export or a MAJOR clip.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. sd_bench_sim.cpp -o sd_bench_sim
+//
+// Usage:
+//   sd_bench_sim selftest   clock choice, fallbacks and cleanup per card profile (exit status 1 on failure)
+//   sd_bench_sim bench      the sweep per card profile
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "sd_bench.h"
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+// ---------------------------------------------------------------- simulated card
+
+struct CardProfile {
+  const char *name;
+  uint32_t maxMountHz;   // 0: never mounts
+  uint32_t maxCleanHz;   // reads above this clock come back corrupted
+  uint32_t marginalHz;   // passes its first run, fails the confirmation (0: none)
+};
+
+struct SimCard {
+  CardProfile prof;
+  uint64_t clockUs = 0;
+  uint32_t hz = 0;                 // 0: not mounted
+  uint32_t generation = 0;         // bumped on every mount
+  uint32_t mounts = 0;
+  uint32_t lastMountHz = 0;
+  int marginalRuns = 0;            // mounts at the marginal clock so far
+
+  std::vector<uint8_t> file;       // the one test file
+  bool exists = false;
+  bool isOpen = false;
+  bool writing = false;
+  size_t pos = 0;
+
+  uint32_t maxCallUs = 0;          // longest single Io call
+
+  explicit SimCard(const CardProfile &p) : prof(p) {}
+
+  void spend(uint64_t us, uint64_t t0) {
+    clockUs += us;
+    const uint64_t call = clockUs - t0;
+    if (call > maxCallUs) maxCallUs = (uint32_t)call;
+  }
+  uint64_t spiUs(size_t bytes) const { return hz ? (uint64_t)bytes * 8ULL * 1100000ULL / hz : 0; }
+
+  // ---- sd_bench.h Io ----
+  bool mount(uint32_t newHz) {
+    const uint64_t t0 = clockUs;
+    isOpen = false;
+    generation++;
+    mounts++;
+    lastMountHz = newHz;
+    if (prof.marginalHz && newHz == prof.marginalHz) marginalRuns++;
+    spend(20000, t0);
+    hz = (prof.maxMountHz && newHz <= prof.maxMountHz) ? newHz : 0;
+    return hz != 0;
+  }
+  uint32_t nowUs() { return (uint32_t)clockUs; }
+  bool open(bool write, bool append) {
+    const uint64_t t0 = clockUs;
+    if (!hz) return false;
+    spend(1500 + spiUs(1024), t0);
+    if (!write && !exists) return false;
+    if (write && !append) file.clear();
+    exists = true;
+    isOpen = true;
+    writing = write;
+    pos = write ? file.size() : 0;
+    return true;
+  }
+  size_t write(const uint8_t *b, size_t n) {
+    const uint64_t t0 = clockUs;
+    if (!isOpen || !writing) return 0;
+    const size_t sectors = (n + 511) / 512;
+    spend(80 + spiUs(n) + sectors * (n >= 4096 ? 120 : 250), t0);
+    file.insert(file.end(), b, b + n);
+    return n;
+  }
+  size_t read(uint8_t *b, size_t n) {
+    const uint64_t t0 = clockUs;
+    if (!isOpen || writing || pos >= file.size()) return 0;
+    if (n > file.size() - pos) n = file.size() - pos;
+    spend(60 + spiUs(n) + (n + 511) / 512 * 40, t0);
+    memcpy(b, file.data() + pos, n);
+    bool corrupt = hz > prof.maxCleanHz;
+    if (prof.marginalHz && hz == prof.marginalHz && marginalRuns > 1) corrupt = true;
+    if (corrupt) b[n / 2] ^= 0x10;
+    pos += n;
+    return n;
+  }
+  void close() {
+    const uint64_t t0 = clockUs;
+    if (isOpen && writing) spend(2000 + spiUs(1024), t0);
+    else spend(200, t0);
+    isOpen = false;
+  }
+  void remove() {
+    if (!hz) return;
+    spend(1500, clockUs);
+    file.clear();
+    exists = false;
+  }
+  void idle() {}
+};
+
+static const CardProfile PROFILES[] = {
+  { "good card (clean to 26 MHz)", 40000000, 26000000, 0 },
+  { "slow wiring (mounts to 10 MHz)", 10000000, 40000000, 0 },
+  { "marginal at 26 MHz", 40000000, 26000000, 26000000 },
+  { "fast card (clean to 40 MHz)", 40000000, 40000000, 0 },
+  { "corrupts even at 1 MHz", 40000000, 0, 0 },
+  { "no card", 0, 0, 0 },
+};
+static const int PROFILE_COUNT = (int)(sizeof(PROFILES) / sizeof(PROFILES[0]));
+
+struct RunOut {
+  bool ok;
+  SdBenchResult r;
+  uint32_t mounts;
+  uint32_t lastMountHz;
+  uint32_t maxCallUs;
+  bool fileLeft;
+  bool foreignStale;
+};
+
+static RunOut runProfile(const CardProfile &p) {
+  SimCard card(p);
+  card.mount(SD_BENCH_SAFE_HZ);
+  const uint32_t foreignGen = card.generation;   // e.g. the /files export's open handle
+  static uint8_t scratch[4096];
+  SdBenchConfig cfg;
+  RunOut o;
+  o.ok = sdBenchRun(card, cfg, scratch, sizeof(scratch), o.r);
+  o.mounts = card.mounts - 1;
+  o.lastMountHz = card.lastMountHz;
+  o.maxCallUs = card.maxCallUs;
+  o.fileLeft = card.exists;
+  o.foreignStale = card.generation != foreignGen;
+  return o;
+}
+
+// ---------------------------------------------------------------- checks
+
+static void selftest() {
+  char what[200];
+  const RunOut good = runProfile(PROFILES[0]);
+  snprintf(what, sizeof(what), "good card: picks 26 MHz, the fastest clock that reads back clean (got %u)", good.r.bestHz);
+  expect(good.ok && good.r.bestHz == 26000000, what);
+  expect(!good.r.steps[good.r.stepCount - 1].verified && good.r.steps[good.r.stepCount - 1].hz == 40000000,
+         "good card: the sweep stops at the first clock that fails to verify");
+  expect(good.lastMountHz == 26000000, "good card: left mounted at the chosen clock");
+  expect(!good.fileLeft, "good card: the test file is removed");
+  expect(good.r.bestBufBytes == 4096 && good.r.bestWriteKBps > 0 && good.r.bestReadKBps > 0 && good.r.bestAppendUs > 0,
+         "good card: 4 KB buffers win with multi-block writes");
+
+  const RunOut slow = runProfile(PROFILES[1]);
+  snprintf(what, sizeof(what), "mounts only to 10 MHz: picks 10 MHz (got %u)", slow.r.bestHz);
+  expect(slow.ok && slow.r.bestHz == 10000000 && !slow.r.steps[slow.r.stepCount - 1].mounted, what);
+
+  const RunOut marginal = runProfile(PROFILES[2]);
+  snprintf(what, sizeof(what), "marginal 26 MHz: fails the confirmation, falls back to 20 MHz (got %u)", marginal.r.bestHz);
+  expect(marginal.ok && marginal.r.bestHz == 20000000 && marginal.lastMountHz == 20000000, what);
+
+  const RunOut fast = runProfile(PROFILES[3]);
+  expect(fast.ok && fast.r.bestHz == 40000000 && fast.r.stepCount == SD_BENCH_CLOCK_COUNT, "fast card: every clock passes, 40 MHz");
+
+  const RunOut bad = runProfile(PROFILES[4]);
+  expect(!bad.ok && bad.r.bestHz == 0 && bad.lastMountHz == SD_BENCH_SAFE_HZ,
+         "corrupt at every clock: reports failure and remounts at the safe clock");
+
+  const RunOut none = runProfile(PROFILES[5]);
+  expect(!none.ok && none.r.bestHz == 0 && none.r.stepCount == 1, "no card: one failed mount, no tuning");
+
+  // Why it runs off the loop and not during an export or a clip.
+  snprintf(what, sizeof(what), "good card: %u ms in total, %u remounts; far past the 64 ms of I2S DMA the loop can miss",
+           good.r.elapsedMs, good.mounts);
+  expect(good.r.elapsedMs > 64, what);
+  expect(good.foreignStale && good.mounts >= (uint32_t)good.r.stepCount + 1,
+         "a handle opened before the sweep is stale after it (every step remounts)");
+}
+
+static void bench() {
+  printf("\nSD auto-tune sweep per card profile (cost model, not a measurement)\n");
+  printf("  %-32s %6s %8s %6s %8s %8s %9s %9s %8s %9s\n", "card", "steps", "best MHz", "buf", "wr KB/s", "rd KB/s",
+         "append us", "total ms", "mounts", "max call");
+  for (int i = 0; i < PROFILE_COUNT; i++) {
+    const RunOut o = runProfile(PROFILES[i]);
+    printf("  %-32s %6d %8.1f %6u %8u %8u %9u %9u %8u %6.1f ms\n", PROFILES[i].name, o.r.stepCount, o.r.bestHz / 1e6,
+           o.r.bestBufBytes, o.r.bestWriteKBps, o.r.bestReadKBps, o.r.bestAppendUs, o.r.elapsedMs, o.mounts,
+           o.maxCallUs / 1000.0);
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) {
+    selftest();
+    return fails ? 1 : 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "bench")) {
+    bench();
+    return 0;
+  }
+  fprintf(stderr, "usage: sd_bench_sim selftest | bench\n");
+  return 2;
+}
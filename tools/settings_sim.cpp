@@ -0,0 +1,313 @@
+// Host harness for the settings blob (settings_store.h) on an in-memory Preferences fake that
+// counts every NVS write.
+//
+// The selftest seeds the legacy per-key layout the old firmware wrote ("yellow", "red", ...),
+// boots through load() and then drives the debounce with UI-like update() patterns, asserting
+// the number of flash writes for each:
+//   migration          legacy keys -> blob once; the next boot reads the blob and writes nothing
+//   corrupt / old blob CRC failure falls back to the legacy keys; a v3 blob is rewritten once
+//   slider drag        updates every 100 ms for 5 s -> one write, debounceMs after the last one
+//   long drag          updates every 200 ms for 30 s -> one write per maxDelayMs, plus the tail
+//   no-op / revert     changing a value and back before the debounce -> no write
+//   failed write       putBytes() short -> counted, still dirty, retried on the next tick
+//   shutdown           flush() commits a pending change at once
+// The bench prints the writes per scenario next to the old per-key save, which rewrote every
+// key on each change.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. settings_sim.cpp -o settings_sim
+//
+// Usage:
+//   settings_sim selftest   run the checks above (exit status 1 on failure)
+//   settings_sim bench      NVS writes per scenario, blob vs old per-key save
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "settings_store.h"
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+// ---------------------------------------------------------------- fake NVS
+
+// One namespace is enough: the store only ever opens "settings".
+struct FakeNvs {
+  std::map<std::string, std::vector<uint8_t>> blobs;
+  std::map<std::string, int32_t> ints;
+  std::map<std::string, bool> bools;
+  bool open = false;
+  bool readOnly = false;
+  uint32_t writes = 0;         // put* calls that reached flash
+  uint32_t opens = 0;
+  size_t shortWrites = 0;      // fail the next N putBytes() calls
+
+  bool begin(const char *name, bool ro) {
+    (void)name;
+    open = true;
+    readOnly = ro;
+    opens++;
+    return true;
+  }
+  void end() { open = false; }
+
+  bool isKey(const char *k) const { return blobs.count(k) || ints.count(k) || bools.count(k); }
+  size_t getBytes(const char *k, void *buf, size_t maxLen) const {
+    auto it = blobs.find(k);
+    if (it == blobs.end() || it->second.size() > maxLen) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+  int getInt(const char *k, int def) const {
+    auto it = ints.find(k);
+    return it == ints.end() ? def : it->second;
+  }
+  bool getBool(const char *k, bool def) const {
+    auto it = bools.find(k);
+    return it == bools.end() ? def : it->second;
+  }
+
+  size_t putBytes(const char *k, const void *buf, size_t len) {
+    if (!open || readOnly) return 0;
+    if (shortWrites) {
+      shortWrites--;
+      return 0;
+    }
+    const uint8_t *p = (const uint8_t *)buf;
+    blobs[k].assign(p, p + len);
+    writes++;
+    return len;
+  }
+  size_t putInt(const char *k, int32_t v) {
+    ints[k] = v;
+    writes++;
+    return 4;
+  }
+  size_t putBool(const char *k, bool v) {
+    bools[k] = v;
+    writes++;
+    return 1;
+  }
+};
+
+// ---------------------------------------------------------------- fixtures
+
+static DeviceSettings defaults() {
+  DeviceSettings s;
+  memset(&s, 0, sizeof(s));
+  s.yellow = 65;
+  s.red = 70;
+  s.speaker = 1;
+  s.mp3Volume = 20;
+  s.majorRepeatIntervalMs = 300000;
+  s.silenceResetWindowMs = 30000;
+  s.firstWarningMs = 5000;
+  s.secondWarningMs = 15000;
+  s.majorWarningMs = 60000;
+  s.noiseGreenBrt = s.noiseYellowBrt = s.noiseRedBrt = 128;
+  s.statusLedBrt = 64;
+  s.noiseLedsEnabled = s.micEnabled = 1;
+  s.dbSampleIntervalMs = 1000;
+  s.dbChangeThreshold10 = 10;
+  s.dbHeartbeatMs = 60000;
+  s.dbBulkUploadIntervalMs = 3600000;
+  s.lowPowerEnabled = 1;
+  s.lowPowerQuietMs = 600000;
+  s.classifierSuppress = 1;
+  s.classifierMinConfidence = 70;
+  s.eventMaxRamAgeMs = 60000;
+  s.zoneCount = 1;
+  return s;
+}
+
+// What the old saveDeviceSettings() left behind: every v1 key, no blob.
+static void seedLegacy(FakeNvs &nvs) {
+  nvs.ints["yellow"] = 58;
+  nvs.ints["red"] = 72;
+  nvs.bools["speaker"] = false;
+  nvs.ints["mp3vol"] = 25;
+  nvs.ints["maj_int"] = 600000;
+  nvs.ints["fw_ms"] = 3000;
+  nvs.bools["micen"] = true;
+  nvs.ints["db_up"] = 7200000;
+  nvs.bools["lp_en"] = false;
+  nvs.ints["lp_quiet"] = 1200000;
+}
+
+// put*() calls in the old saveDeviceSettings(), made on every save.
+static const uint32_t OLD_SAVE_PUTS = 25;
+
+// Updates `count` times, `stepMs` apart, ticking every 50 ms as loop() does, then runs on for
+// tailMs. f(i, s) mutates the settings for update i. Returns the writes made.
+template <typename F>
+static uint32_t drive(SettingsStore<FakeNvs> &st, FakeNvs &nvs, uint32_t &now, int count, uint32_t stepMs, uint32_t tailMs,
+                      F f) {
+  const uint32_t w0 = nvs.writes;
+  DeviceSettings s = st.pending;
+  uint32_t nextUpdate = now;
+  const uint32_t end = now + (uint32_t)count * stepMs + tailMs;
+  int done = 0;
+  for (; now < end; now += 50) {
+    if (done < count && now >= nextUpdate) {
+      f(done, s);
+      st.update(s, now);
+      done++;
+      nextUpdate += stepMs;
+    }
+    st.tick(now);
+  }
+  return nvs.writes - w0;
+}
+
+// ---------------------------------------------------------------- checks
+
+static void migrationChecks() {
+  FakeNvs nvs;
+  seedLegacy(nvs);
+  SettingsStore<FakeNvs> st;
+  st.nvs = &nvs;
+  DeviceSettings s = defaults();
+  expect(st.load(s) == SETTINGS_MIGRATED_LEGACY, "legacy keys: load() reports a migration");
+  expect(nvs.writes == 1 && st.commits == 1, "legacy keys: exactly one NVS write (the blob)");
+  expect(s.yellow == 58 && s.red == 72 && s.speaker == 0 && s.mp3Volume == 25 && s.majorRepeatIntervalMs == 600000 &&
+         s.firstWarningMs == 3000 && s.dbBulkUploadIntervalMs == 7200000 && s.lowPowerEnabled == 0 &&
+         s.lowPowerQuietMs == 1200000,
+         "legacy keys: every stored value lands in the blob");
+  expect(s.secondWarningMs == 15000 && s.classifierMinConfidence == 70 && s.zoneCount == 1,
+         "legacy keys: fields the old firmware never wrote keep their defaults");
+  expect(nvs.ints.count("yellow") && nvs.bools.count("speaker"), "legacy keys are left for an older image");
+
+  SettingsStore<FakeNvs> again;
+  again.nvs = &nvs;
+  DeviceSettings s2 = defaults();
+  expect(again.load(s2) == SETTINGS_LOADED_BLOB && nvs.writes == 1, "second boot: reads the blob, no write");
+  expect(memcmp(&s, &s2, sizeof(s)) == 0, "second boot: same settings as the migration produced");
+
+  FakeNvs empty;
+  SettingsStore<FakeNvs> fresh;
+  fresh.nvs = &empty;
+  DeviceSettings s3 = defaults();
+  expect(fresh.load(s3) == SETTINGS_DEFAULTS && empty.writes == 1, "empty NVS: defaults, one blob write");
+
+  // Corrupt blob: the CRC check fails and the legacy keys win again.
+  nvs.blobs[SETTINGS_BLOB_KEY][sizeof(SettingsBlobHeader) + 2] ^= 0x5A;
+  SettingsStore<FakeNvs> corrupt;
+  corrupt.nvs = &nvs;
+  DeviceSettings s4 = defaults();
+  const uint32_t w0 = nvs.writes;
+  expect(corrupt.load(s4) == SETTINGS_MIGRATED_LEGACY && nvs.writes == w0 + 1 && s4.yellow == 58,
+         "corrupt blob: falls back to the legacy keys, one rewrite");
+
+  // A v3 blob (no zoneCount yet): loaded, zoneCount defaulted, rewritten once as v4.
+  FakeNvs old;
+  DeviceSettings v3 = defaults();
+  v3.yellow = 61;
+  const uint16_t v3Size = (uint16_t)offsetof(DeviceSettings, zoneCount);
+  SettingsBlobHeader h = { SETTINGS_MAGIC, 3, v3Size, 0, crc32Of((const uint8_t *)&v3, v3Size) };
+  std::vector<uint8_t> blob(sizeof(h) + v3Size);
+  memcpy(blob.data(), &h, sizeof(h));
+  memcpy(blob.data() + sizeof(h), &v3, v3Size);
+  old.blobs[SETTINGS_BLOB_KEY] = blob;
+  SettingsStore<FakeNvs> up;
+  up.nvs = &old;
+  DeviceSettings s5 = defaults();
+  s5.zoneCount = 2;
+  expect(up.load(s5) == SETTINGS_LOADED_BLOB && s5.yellow == 61 && s5.zoneCount == 2 && old.writes == 1,
+         "v3 blob: values kept, new field defaulted, upgraded with one write");
+  SettingsStore<FakeNvs> up2;
+  up2.nvs = &old;
+  DeviceSettings s6 = defaults();
+  expect(up2.load(s6) == SETTINGS_LOADED_BLOB && old.writes == 1, "upgraded blob: next boot writes nothing");
+}
+
+static void debounceChecks() {
+  FakeNvs nvs;
+  SettingsStore<FakeNvs> st;
+  st.nvs = &nvs;
+  DeviceSettings s = defaults();
+  st.load(s);
+  uint32_t now = 1000;
+  char what[160];
+
+  uint32_t w = drive(st, nvs, now, 50, 100, 3000, [](int i, DeviceSettings &d) { d.noiseGreenBrt = 10 + i; });
+  snprintf(what, sizeof(what), "slider drag (50 updates in 5 s): %u write(s), want 1", w);
+  expect(w == 1 && !st.dirty && st.committed.noiseGreenBrt == 59, what);
+
+  w = drive(st, nvs, now, 150, 200, 3000, [](int i, DeviceSettings &d) { d.dbHeartbeatMs = 1000 + i * 100; });
+  const uint32_t want = 30000 / st.maxDelayMs;
+  snprintf(what, sizeof(what), "long drag (150 updates in 30 s): %u write(s), want %u-%u (one per maxDelayMs + tail)", w, want,
+           want + 1);
+  expect(w >= want && w <= want + 1 && !st.dirty && st.committed.dbHeartbeatMs == 1000 + 149 * 100, what);
+
+  const int32_t red = st.committed.red;
+  w = drive(st, nvs, now, 2, 300, 3000, [red](int i, DeviceSettings &d) { d.red = i == 0 ? red + 1 : red; });
+  expect(w == 0 && !st.dirty, "change and revert inside the debounce: no write");
+
+  w = drive(st, nvs, now, 5, 100, 3000, [](int, DeviceSettings &) {});
+  expect(w == 0, "saves without a change: no write");
+
+  DeviceSettings d = st.pending;
+  d.yellow = 60;
+  st.update(d, now);
+  nvs.shortWrites = 1;
+  now += st.debounceMs;
+  expect(!st.tick(now) && st.dirty && st.commitFailures == 1, "short putBytes(): counted, still dirty");
+  now += 50;
+  expect(st.tick(now) && !st.dirty && st.committed.yellow == 60, "failed write retried on the next tick");
+
+  d.yellow = 62;
+  st.update(d, now);
+  const uint32_t w0 = nvs.writes;
+  expect(!st.tick(now + 100) && st.flush() && nvs.writes == w0 + 1 && st.committed.yellow == 62,
+         "shutdown flush(): pending change written before the debounce");
+  expect(!st.flush() && nvs.writes == w0 + 1, "flush() with nothing pending: no write");
+}
+
+static void bench() {
+  struct Row {
+    const char *name;
+    int updates;
+    uint32_t stepMs;
+  };
+  const Row rows[] = {
+    { "one toggle", 1, 100 },
+    { "slider drag, 5 s", 50, 100 },
+    { "slider drag, 30 s", 150, 200 },
+    { "three toggles, 1 s apart", 3, 1000 },
+  };
+  printf("\nNVS writes per UI pattern (old: every key rewritten per save)\n");
+  printf("  %-32s %8s %10s %10s\n", "pattern", "updates", "old puts", "blob puts");
+  for (const Row &r : rows) {
+    FakeNvs nvs;
+    SettingsStore<FakeNvs> st;
+    st.nvs = &nvs;
+    DeviceSettings s = defaults();
+    st.load(s);
+    uint32_t now = 1000;
+    const uint32_t w = drive(st, nvs, now, r.updates, r.stepMs, 12000, [](int i, DeviceSettings &d) { d.statusLedBrt = i; });
+    printf("  %-32s %8d %10u %10u\n", r.name, r.updates, (unsigned)(r.updates * OLD_SAVE_PUTS), w);
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) {
+    migrationChecks();
+    debounceChecks();
+    return fails ? 1 : 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "bench")) {
+    bench();
+    return 0;
+  }
+  fprintf(stderr, "usage: settings_sim selftest | bench\n");
+  return 2;
+}
@@ -0,0 +1,358 @@
+// Host simulation of a long offline period for the SD storage manager (storage_budget.h).
+//
+// An in-memory FAT-like card (capacity, cluster rounding, root directory) receives what the
+// firmware writes while it cannot upload: the change-based db series, /noise_log.txt flushed once
+// a minute, pending RED events, and a 5 s WAV per MAJOR warning (makeRoom() first, as the sketch
+// does). School days are loud from 07:00 to 16:00; nights and weekends only get heartbeats.
+// The manager is ticked from a 1 s virtual loop (every workIntervalMs while it has work), and each
+// tick's card operations are counted to show the work stays bounded.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. storage_sim.cpp -o storage_sim
+//
+// Usage:
+//   storage_sim [days] [card_mb]       default 183 days (6 months) on a 64 MB card; checks that no
+//                                      append fails, no MAJOR clip is lost, hourly peaks survive the
+//                                      roll-ups and per-tick work is bounded (exit status 1 on failure)
+//   storage_sim --db-kb <n> [days] [card_mb]   db series budget squeezed to n KB (tighter roll-ups,
+//                                      then dropping the oldest lines)
+//   storage_sim --unmanaged [days] [card_mb]   same outage without the manager, for comparison
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "storage_budget.h"
+
+struct MemCard {
+  uint64_t capacity = 0;
+  uint32_t cluster = 16384;
+  std::map<std::string, std::vector<uint8_t>> files;
+  std::string dirCursor;
+  bool dirStarted = false;
+
+  // Operations since the last reset, to bound per-tick work.
+  int reads = 0, appends = 0, removes = 0, renames = 0, dirs = 0;
+  uint64_t readBytes = 0;
+
+  uint64_t clusters(size_t n) const { return (n + cluster - 1) / cluster; }
+  uint64_t usedBytes() const {
+    uint64_t u = 0;
+    for (auto &f : files) u += clusters(f.second.size()) * cluster;
+    return u;
+  }
+  uint64_t freeBytes() const { return capacity - usedBytes(); }
+
+  int64_t size(const char *p) const {
+    auto it = files.find(p);
+    return it == files.end() ? -1 : (int64_t)it->second.size();
+  }
+  int readAt(const char *p, uint32_t off, uint8_t *buf, int n) {
+    reads++;
+    auto it = files.find(p);
+    if (it == files.end()) return -1;
+    const std::vector<uint8_t> &v = it->second;
+    if (off >= v.size()) return 0;
+    const int m = (int)std::min<size_t>((size_t)n, v.size() - off);
+    memcpy(buf, v.data() + off, (size_t)m);
+    readBytes += (uint64_t)m;
+    return m;
+  }
+  bool append(const char *p, const uint8_t *buf, int n) {
+    appends++;
+    std::vector<uint8_t> &v = files[p];
+    const uint64_t grow = clusters(v.size() + (size_t)n) - clusters(v.size());
+    if (grow * cluster > freeBytes()) {
+      if (v.empty()) files.erase(p);
+      return false;
+    }
+    v.insert(v.end(), buf, buf + n);
+    return true;
+  }
+  bool remove(const char *p) {
+    removes++;
+    return files.erase(p) > 0;
+  }
+  bool rename(const char *a, const char *b) {
+    renames++;
+    auto it = files.find(a);
+    if (it == files.end()) return false;
+    files[b] = std::move(it->second);
+    files.erase(a);
+    return true;
+  }
+  bool dirNext(char *name, size_t cap, uint32_t &sz) {
+    dirs++;
+    auto it = dirStarted ? files.upper_bound(dirCursor) : files.begin();
+    if (it == files.end()) {
+      dirStarted = false;
+      return false;
+    }
+    dirStarted = true;
+    dirCursor = it->first;
+    snprintf(name, cap, "%s", it->first.c_str() + 1);   // FAT returns names without the slash
+    sz = (uint32_t)it->second.size();
+    return true;
+  }
+  void resetOps() {
+    reads = appends = removes = renames = dirs = 0;
+    readBytes = 0;
+  }
+};
+
+static const uint64_t START_EPOCH_MS = 1788220800000ULL;   // 2026-09-01 00:00 UTC
+static const int32_t LOCAL_OFFSET_SEC = 8 * 3600;
+static const uint32_t WAV_BYTES = 44 + 160000;
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+struct Outage {
+  MemCard card;
+  StorageManager<MemCard> mgr;
+  bool managed = true;
+  std::mt19937 rng{42};
+
+  uint64_t appendFails[STORE_CLASS_COUNT] = { 0, 0, 0, 0 };
+  uint64_t written[STORE_CLASS_COUNT] = { 0, 0, 0, 0 };
+  uint32_t majors = 0, majorsLost = 0, warnings = 0;
+  int firstFailDay = -1;
+  std::map<uint64_t, int> rawHourPeak;   // hour index -> max db10 as generated
+
+  int maxReads = 0, maxAppends = 0, maxRemoves = 0, maxRenames = 0, maxDirs = 0;
+  uint64_t maxReadBytes = 0;
+  uint64_t ticks = 0;
+
+  void fail(StoreClass c, int day) {
+    appendFails[c]++;
+    if (firstFailDay < 0) firstFailDay = day;
+  }
+
+  void write(StoreClass c, const char *path, const char *s, int n, int day) {
+    if (card.append(path, (const uint8_t *)s, n)) written[c] += (uint64_t)n;
+    else fail(c, day);
+  }
+
+  void tickManager(uint32_t nowMs, uint64_t epochMs) {
+    card.resetOps();
+    mgr.tick(nowMs, epochMs);
+    ticks++;
+    maxReads = std::max(maxReads, card.reads);
+    maxAppends = std::max(maxAppends, card.appends);
+    maxRemoves = std::max(maxRemoves, card.removes);
+    maxRenames = std::max(maxRenames, card.renames);
+    maxDirs = std::max(maxDirs, card.dirs);
+    maxReadBytes = std::max(maxReadBytes, card.readBytes);
+  }
+
+  void recordMajor(uint64_t epochMs, int day) {
+    majors++;
+    if (managed) mgr.makeRoom(WAV_BYTES + 4096);
+    const time_t local = (time_t)(epochMs / 1000ULL) + LOCAL_OFFSET_SEC;
+    struct tm t;
+    gmtime_r(&local, &t);
+    char path[40];
+    strftime(path, sizeof(path), "/rec_%Y%m%d_%H%M%S.wav", &t);
+    std::vector<uint8_t> wav(WAV_BYTES, 0x11);
+    if (card.append(path, wav.data(), (int)wav.size())) {
+      written[STORE_RECORDINGS] += WAV_BYTES;
+    } else {
+      majorsLost++;
+      fail(STORE_RECORDINGS, day);
+    }
+    queueEvent("MAJOR", epochMs, path, day);
+  }
+
+  void queueEvent(const char *level, uint64_t epochMs, const char *audioPath, int day) {
+    PendingEvent e;
+    memset(&e, 0, sizeof(e));
+    snprintf(e.id, sizeof(e.id), "%08x-0000-4000-8000-%012llx", (unsigned)rng(), (unsigned long long)epochMs);
+    snprintf(e.groupId, sizeof(e.groupId), "%s", e.id);
+    snprintf(e.level, sizeof(e.level), "%s", level);
+    e.durationSeconds = 60;
+    e.decibel = 85;
+    e.audio = audioPath ? 1 : 0;
+    snprintf(e.audioPath, sizeof(e.audioPath), "%s", audioPath ? audioPath : "");
+    e.eventTsMs = epochMs;
+    char line[256];
+    int n = pendingEventFormat(e, line, sizeof(line) - 2);
+    line[n++] = '\r';
+    line[n++] = '\n';
+    write(STORE_PENDING, "/pending_events.txt", line, n, day);
+    warnings++;
+  }
+
+  void run(int days) {
+    mgr.cfg.localOffsetSec = LOCAL_OFFSET_SEC;
+    if (managed) mgr.begin(&card);
+
+    char noiseBuf[4096];
+    int noiseLen = 0;
+    int db10 = 450;
+    uint32_t lastDbRecSec = 0;
+    int lastDb10 = -99999;
+    const uint32_t total = (uint32_t)days * 86400U;
+    for (uint32_t sec = 0; sec < total; sec++) {
+      const uint64_t epochMs = START_EPOCH_MS + (uint64_t)sec * 1000ULL;
+      const int day = (int)(sec / 86400U);
+      const uint32_t localSec = (uint32_t)((epochMs / 1000ULL + LOCAL_OFFSET_SEC) % 86400ULL);
+      const int weekday = (int)(((epochMs / 1000ULL + LOCAL_OFFSET_SEC) / 86400ULL + 4) % 7);   // 0 = Sunday
+      const bool school = weekday >= 1 && weekday <= 5 && localSec >= 7 * 3600 && localSec < 16 * 3600;
+
+      // Level: a random walk around 48 dB in class, 38 dB otherwise.
+      if (sec % 2 == 0) {
+        const int target = school ? 480 : 380;
+        db10 += (int)(rng() % 41) - 20 + (target - db10) / 10;
+        const bool changed = db10 - lastDb10 >= 10 || lastDb10 - db10 >= 10;
+        if (changed || sec - lastDbRecSec >= 8) {
+          char line[40];
+          int n = snprintf(line, sizeof(line), "%llu|%d\r\n", (unsigned long long)epochMs, db10);
+          write(STORE_DB_SERIES, "/db_series.txt", line, n, day);
+          const uint64_t hour = epochMs / 3600000ULL;
+          auto it = rawHourPeak.find(hour);
+          if (it == rawHourPeak.end() || db10 > it->second) rawHourPeak[hour] = db10;
+          lastDb10 = db10;
+          lastDbRecSec = sec;
+        }
+        noiseLen += snprintf(noiseBuf + noiseLen, sizeof(noiseBuf) - (size_t)noiseLen, "Time(ms): %lu | dB: %d\r\n",
+                             (unsigned long)(sec * 1000U), db10 / 10);
+      }
+      if (sec % 60 == 59) {
+        write(STORE_NOISE_LOG, "/noise_log.txt", noiseBuf, noiseLen, day);
+        noiseLen = 0;
+      }
+
+      // About ten RED warnings per school day, one in four a MAJOR with a clip.
+      if (school && rng() % 3240 == 0) {
+        if (rng() % 4 == 0) recordMajor(epochMs, day);
+        else queueEvent(rng() % 2 ? "FIRST" : "SECOND", epochMs, nullptr, day);
+      }
+
+      if (!managed) continue;
+      const uint32_t nowMs = sec * 1000U;
+      tickManager(nowMs, epochMs);
+      for (uint32_t ms = mgr.cfg.workIntervalMs; ms < 1000 && mgr.busy(); ms += mgr.cfg.workIntervalMs) {
+        tickManager(nowMs + ms, epochMs);
+      }
+    }
+  }
+
+  // Every hour still in the db series (except the oldest, which drop mode may have cut) must
+  // carry the same peak as the raw samples had.
+  void hourlyPeaks(uint32_t &hours, uint32_t &mismatched, uint32_t &lines) {
+    std::map<uint64_t, int> got;
+    lines = 0;
+    auto it = card.files.find("/db_series.txt");
+    if (it == card.files.end()) return;
+    std::string s(it->second.begin(), it->second.end());
+    size_t p = 0;
+    while (p < s.size()) {
+      size_t e = s.find('\n', p);
+      if (e == std::string::npos) e = s.size();
+      const std::string line = s.substr(p, e - p);
+      p = e + 1;
+      const size_t bar = line.find('|');
+      if (bar == std::string::npos) continue;
+      lines++;
+      const uint64_t ts = strtoull(line.c_str(), nullptr, 10);
+      const int db = atoi(line.c_str() + bar + 1);
+      auto g = got.find(ts / 3600000ULL);
+      if (g == got.end() || db > g->second) got[ts / 3600000ULL] = db;
+    }
+    hours = 0;
+    mismatched = 0;
+    bool first = true;
+    for (auto &h : got) {
+      if (first) {
+        first = false;
+        continue;
+      }
+      hours++;
+      if (rawHourPeak[h.first] != h.second) mismatched++;
+    }
+  }
+
+  void print(int days) {
+    printf("outage %d days, card %llu MB, %s\n", days, (unsigned long long)(card.capacity >> 20),
+           managed ? "managed" : "unmanaged");
+    printf("written: db %.1f MB, noise log %.1f MB, pending %.2f MB, recordings %.1f MB (%u MAJOR, %u warnings)\n",
+           written[STORE_DB_SERIES] / 1048576.0, written[STORE_NOISE_LOG] / 1048576.0, written[STORE_PENDING] / 1048576.0,
+           written[STORE_RECORDINGS] / 1048576.0, majors, warnings);
+    uint64_t totalFails = 0;
+    for (int c = 0; c < STORE_CLASS_COUNT; c++) totalFails += appendFails[c];
+    printf("append failures: %llu (db %llu, noise %llu, pending %llu, recordings %llu), first on day %d, MAJOR clips lost %u\n",
+           (unsigned long long)totalFails, (unsigned long long)appendFails[0], (unsigned long long)appendFails[1],
+           (unsigned long long)appendFails[2], (unsigned long long)appendFails[3], firstFailDay, majorsLost);
+    printf("card at end: %.1f MB used, %.1f MB free\n", card.usedBytes() / 1048576.0, card.freeBytes() / 1048576.0);
+    if (!managed) return;
+    const StorageStats &s = mgr.stats;
+    printf("on card: db %.2f MB, noise %.2f MB, pending %.1f KB, recordings %.1f MB (%u files)\n",
+           card.size("/db_series.txt") / 1048576.0,
+           (std::max<int64_t>(0, card.size("/noise_log.txt")) + std::max<int64_t>(0, card.size("/noise_log_old.txt"))) / 1048576.0,
+           std::max<int64_t>(0, card.size("/pending_events.txt")) / 1024.0, mgr.used[STORE_RECORDINGS] / 1048576.0, mgr.recCount);
+    printf("manager: checks=%u db jobs=%u (level %u) lines in=%u out=%u dropped=%u\n", s.checks, s.dbJobs, mgr.dbLevel,
+           s.dbLinesIn, s.dbLinesOut, s.dbLinesDropped);
+    printf("         recordings expired=%u evicted=%u made room=%u, noise rotations=%u, pending dropped=%u, starved=%u errors=%u\n",
+           s.recExpired, s.recEvicted, s.madeRoom, s.noiseRotations, s.pendingDropped, s.starved, s.errors);
+    printf("per tick (max of %llu): reads=%d (%llu bytes) appends=%d removes=%d renames=%d dir entries=%d\n",
+           (unsigned long long)ticks, maxReads, (unsigned long long)maxReadBytes, maxAppends, maxRemoves, maxRenames, maxDirs);
+  }
+};
+
+int main(int argc, char **argv) {
+  bool managed = true;
+  int dbKb = 0;
+  int a = 1;
+  for (; argc > a && argv[a][0] == '-'; a++) {
+    if (!strcmp(argv[a], "--unmanaged")) managed = false;
+    else if (!strcmp(argv[a], "--db-kb") && argc > a + 1) dbKb = atoi(argv[++a]);
+  }
+  const int days = argc > a ? atoi(argv[a]) : 183;
+  const int cardMb = argc > a + 1 ? atoi(argv[a + 1]) : 64;
+  if (days < 1 || cardMb < 8) {
+    fprintf(stderr, "usage: storage_sim [--unmanaged] [--db-kb n] [days] [card_mb >= 8]\n");
+    return 2;
+  }
+
+  Outage o;
+  o.managed = managed;
+  o.card.capacity = (uint64_t)cardMb << 20;
+  // Budgets as a share of the card, the way the sketch sizes them.
+  const uint64_t cap = o.card.capacity;
+  o.mgr.cfg.budget[STORE_RECORDINGS] = (uint32_t)(cap * 40 / 100);
+  o.mgr.cfg.budget[STORE_DB_SERIES] = (uint32_t)(cap * 20 / 100);
+  o.mgr.cfg.budget[STORE_NOISE_LOG] = (uint32_t)(cap * 10 / 100);
+  o.mgr.cfg.budget[STORE_PENDING] = (uint32_t)(cap * 2 / 100);
+  o.mgr.cfg.majorReserveBytes = 8 * WAV_BYTES;
+  if (dbKb > 0) o.mgr.cfg.budget[STORE_DB_SERIES] = (uint32_t)dbKb * 1024U;
+  o.run(days);
+  o.print(days);
+  if (!managed) return 0;
+
+  uint32_t hours = 0, mismatched = 0, lines = 0;
+  o.hourlyPeaks(hours, mismatched, lines);
+  printf("db series: %u lines covering %u hours, %u hourly peaks differ from raw\n", lines, hours, mismatched);
+
+  uint64_t totalFails = 0;
+  for (int c = 0; c < STORE_CLASS_COUNT; c++) totalFails += o.appendFails[c];
+  expect(totalFails == 0, "no append failed");
+  expect(o.majorsLost == 0, "every MAJOR clip was written");
+  expect(mismatched == 0 && hours > 0, "roll-ups keep each hour's peak");
+  expect(o.maxReads <= 1 && o.maxAppends <= 3 && o.maxRemoves <= 2 && o.maxRenames <= 1 &&
+             o.maxDirs <= o.mgr.cfg.scanPerTick + 1 && o.maxReadBytes <= o.mgr.cfg.chunkBytes,
+         "per-tick work bounded");
+  expect(o.mgr.stats.errors == 0, "no manager errors");
+  return fails ? 1 : 0;
+}
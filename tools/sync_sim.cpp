@@ -0,0 +1,531 @@
+// Host model of event and db-series sync: the old fixed policy against SyncScheduler
+// (sync_scheduler.h), on a virtual millisecond clock.
+//
+// Each device is the firmware's loop reduced to what touches the uplink; every HTTPS call blocks
+// the loop for its whole duration, as it does on the device. A day brings FIRST/SECOND warnings,
+// MAJOR events with a 5 s clip, and db series lines every 2 s. Time to dashboard is measured
+// from a MAJOR event being queued, or from Wi-Fi coming back if that is later, to the 2xx of its
+// event POST.
+//
+// The old policy is the previous loop(): a sync tick every 3 s, the pending file in arrival order
+// (at most 12 events or 1.2 s per attempt, non-audio events in batches of 10), a fixed 30 s
+// backoff after an attempt that uploaded nothing, a google generate_204 probe every 10 s, and 120
+// db lines once an hour. The new policy is trySyncPendingEvents() and jobDbUploadTick() as they
+// are now: MAJOR then FIRST/SECOND passes, per-class jittered backoff, batches from RSSI and
+// measured throughput, db uploads held back while events drain, the probe skipped after a 2xx.
+//
+// Link model (estimates, not measurements): every request opens a new TLS session (600 ms), then
+// moves its bytes at the scenario's throughput. A weak link drops connections at a fixed rate, so
+// a request fails with probability 1 - exp(-duration * rate). While the API is down a request
+// fails on the 6 s HTTP timeout. Scenarios run 10 devices for the sample size; in the building
+// scenario 30 devices share one API that answers 503 beyond a number of requests started per
+// second.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. sync_sim.cpp -o sync_sim
+//
+// Usage:
+//   sync_sim selftest     scheduler checks plus the scenarios (exit status 1 on failure)
+//   sync_sim bench        MAJOR time to dashboard per scenario, old policy vs SyncScheduler
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "sync_scheduler.h"
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+// ---------------------------------------------------------------- workload + link
+
+static const uint32_t SIM_MS = 4 * 3600 * 1000;
+static const uint32_t TLS_MS = 600;
+static const uint32_t PROBE_MS = 300;
+static const uint32_t HTTP_TIMEOUT_MS = 6000;
+static const uint32_t CLIP_BYTES = 160044;   // 5 s, 16 kHz, 16-bit WAV
+static const uint32_t EVENT_BYTES = 220;
+static const uint32_t DB_LINE_BYTES = 60;
+static const uint32_t DB_LINE_MS = 2000;
+static const uint32_t DB_UPLOAD_INTERVAL_MS = 3600000;
+static const uint32_t DB_UPLOAD_POLL_MS = 1000;
+static const uint32_t SYNC_INTERVAL_MS = 3000;
+static const uint32_t PROBE_INTERVAL_MS = 10000;
+static const int SYNC_EVENT_BATCH_CAP = 40;
+
+struct Scenario {
+  const char *name;
+  int rssi;
+  float bytesPerMs;         // uplink throughput once connected
+  float dropsPerMin;        // connection drops on this link
+  uint32_t offlineUntilMs;  // no Wi-Fi before this: events pile up, nothing is sent
+  uint32_t apiDownFromMs;   // API unreachable in [from, to)
+  uint32_t apiDownToMs;
+  int devices;
+  int apiPerSec;            // requests the shared API takes per second (0 = unlimited)
+  float majorsPerHour;
+  float warningsPerHour;
+};
+
+static const Scenario SCENARIOS[] = {
+  { "good link", -55, 60.0f, 0.05f, 0, 0, 0, 10, 0, 3, 30 },
+  { "weak link (-78 dBm, 6 KB/s)", -78, 6.0f, 3.0f, 0, 0, 0, 10, 0, 3, 30 },
+  { "back after 2 h offline", -55, 60.0f, 0.05f, 2 * 3600000, 0, 0, 10, 0, 3, 200 },
+  { "API down 20 min", -55, 60.0f, 0.05f, 0, 3600000, 4800000, 10, 0, 3, 30 },
+  { "building: 30 devices, API down 20 min", -60, 40.0f, 0.05f, 0, 3600000, 4800000, 30, 25, 3, 30 },
+};
+static const int SCENARIO_COUNT = (int)(sizeof(SCENARIOS) / sizeof(SCENARIOS[0]));
+
+struct Event {
+  uint32_t createdMs;
+  bool major;          // MAJOR with a clip; FIRST/SECOND otherwise
+  uint32_t ackMs;      // 0 = not on the dashboard yet
+};
+
+static std::vector<Event> makeEvents(const Scenario &sc, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::exponential_distribution<double> majorGap(sc.majorsPerHour / 3600000.0);
+  std::exponential_distribution<double> warnGap(sc.warningsPerHour / 3600000.0);
+  std::vector<Event> ev;
+  for (double t = majorGap(rng); t < SIM_MS - 1800000.0; t += majorGap(rng)) ev.push_back({ (uint32_t)t + 1, true, 0 });
+  for (double t = warnGap(rng); t < SIM_MS - 1800000.0; t += warnGap(rng)) ev.push_back({ (uint32_t)t + 1, false, 0 });
+  std::sort(ev.begin(), ev.end(), [](const Event &a, const Event &b) { return a.createdMs < b.createdMs; });
+  return ev;
+}
+
+// The API side, shared by every device of a scenario.
+struct Api {
+  const Scenario *sc = nullptr;
+  std::map<uint32_t, int> started;   // requests started per second
+  uint32_t rejected = 0;
+
+  bool request(std::mt19937 &rng, uint32_t t, uint32_t bytes, uint32_t &durMs) {
+    if (t >= sc->apiDownFromMs && t < sc->apiDownToMs) {
+      durMs = HTTP_TIMEOUT_MS;
+      return false;
+    }
+    int &n = started[t / 1000];
+    n++;
+    if (sc->apiPerSec > 0 && n > sc->apiPerSec) {
+      durMs = TLS_MS;
+      rejected++;
+      return false;
+    }
+    durMs = TLS_MS + (uint32_t)((float)bytes / sc->bytesPerMs);
+    const double pFail = 1.0 - exp(-(double)durMs * sc->dropsPerMin / 60000.0);
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng) >= pFail;
+  }
+
+  int peakPerSec(uint32_t fromMs) const {
+    int peak = 0;
+    for (const auto &kv : started) {
+      if (kv.first * 1000 >= fromMs) peak = std::max(peak, kv.second);
+    }
+    return peak;
+  }
+};
+
+// ---------------------------------------------------------------- devices
+
+struct Device {
+  Api *api = nullptr;
+  std::mt19937 rng;
+  std::vector<Event> events;
+  size_t admitted = 0;
+  std::vector<Event *> queue;   // pending, in arrival order
+  uint32_t t = 0;               // the loop is busy until t
+  uint32_t dbSent = 0;
+  uint32_t requests = 0;
+  uint32_t failed = 0;
+  uint32_t probes = 0;
+
+  Device(Api *a, const std::vector<Event> &ev, uint32_t seed, uint32_t phaseMs) : api(a), rng(seed), events(ev), t(phaseMs) {}
+  virtual ~Device() {}
+  virtual void step() = 0;
+
+  bool online() const { return t >= api->sc->offlineUntilMs; }
+
+  void admit() {
+    while (admitted < events.size() && events[admitted].createdMs <= t) queue.push_back(&events[admitted++]);
+  }
+
+  uint32_t dbPending() const { return t / DB_LINE_MS - dbSent; }
+
+  bool post(uint32_t bytes) {
+    uint32_t d = 0;
+    const bool ok = api->request(rng, t, bytes, d);
+    t += d;
+    requests++;
+    if (!ok) failed++;
+    return ok;
+  }
+
+  // sendNoiseEventToSupabase(): the clip to Storage, then the event row.
+  bool uploadMajor() { return post(CLIP_BYTES) && post(EVENT_BYTES); }
+
+  void dropAcked() {
+    queue.erase(std::remove_if(queue.begin(), queue.end(), [](const Event *e) { return e->ackMs != 0; }), queue.end());
+  }
+};
+
+struct OldDevice : Device {
+  uint32_t nextProbeMs = 0, nextTickMs = 0, nextAllowedMs = 0, lastDbMs = 0;
+
+  using Device::Device;
+
+  int attempt() {
+    const uint32_t start = t;
+    int processed = 0, ok = 0;
+    std::vector<Event *> batch;
+    auto flush = [&]() {
+      if (batch.empty()) return;
+      if (post((uint32_t)batch.size() * EVENT_BYTES)) {
+        for (Event *e : batch) e->ackMs = t;
+        ok += (int)batch.size();
+      }
+      batch.clear();
+    };
+    for (Event *e : queue) {
+      if (processed > 0 && t - start > 1200) break;
+      processed++;
+      if (!e->major) {
+        batch.push_back(e);
+        if (batch.size() >= 10) flush();
+      } else {
+        flush();
+        if (uploadMajor()) {
+          e->ackMs = t;
+          ok++;
+        }
+      }
+      if (processed >= 12) break;
+    }
+    flush();
+    dropAcked();
+    return ok;
+  }
+
+  void step() override {
+    admit();
+    if (!online()) {
+      t = api->sc->offlineUntilMs;
+      return;
+    }
+    const uint32_t now = t;
+    if (now >= nextProbeMs) {
+      nextProbeMs = now + PROBE_INTERVAL_MS;
+      probes++;
+      t += PROBE_MS;
+      return;
+    }
+    if (now >= nextTickMs) {
+      nextTickMs = now + SYNC_INTERVAL_MS;
+      if (now >= nextAllowedMs && !queue.empty()) nextAllowedMs = attempt() > 0 ? now : now + 30000;
+      return;
+    }
+    if (now - lastDbMs >= DB_UPLOAD_INTERVAL_MS) {
+      lastDbMs = now;
+      const uint32_t n = std::min<uint32_t>(120, dbPending());
+      if (n > 0 && post(n * DB_LINE_BYTES)) dbSent += n;
+      return;
+    }
+    t = std::min(std::min(nextProbeMs, nextTickMs), lastDbMs + DB_UPLOAD_INTERVAL_MS);
+  }
+};
+
+struct NewDevice : Device {
+  SyncScheduler sched;
+  uint32_t nextProbeMs = 0, nextSyncMs = 0, nextDbMs = 0, lastDbMs = 0;
+  bool dbRetryPending = false;
+
+  NewDevice(Api *a, const std::vector<Event> &ev, uint32_t seed, uint32_t phaseMs) : Device(a, ev, seed, phaseMs) {
+    sched.rssi = a->sc->rssi;
+  }
+
+  bool postJson(SyncPriority p, uint32_t bytes) {
+    const uint32_t t0 = t;
+    if (!post(bytes)) {
+      sched.onFailure(p, t, rng());
+      return false;
+    }
+    sched.noteTransfer(bytes, t - t0);
+    sched.onSuccess(p, t);
+    return true;
+  }
+
+  void attempt() {
+    const uint32_t start = t;
+    int processed = 0;
+    bool draining = false;
+    const int batchMax = sched.batchSize(SYNC_PRIO_WARNING, (int)EVENT_BYTES, SYNC_EVENT_BATCH_CAP);
+    for (int pass = SYNC_PRIO_MAJOR; pass <= SYNC_PRIO_WARNING; pass++) {
+      const SyncPriority p = (SyncPriority)pass;
+      const bool classDue = sched.due(p, t);
+      bool classFailed = false;
+      std::vector<Event *> batch;
+      auto flush = [&]() {
+        if (batch.empty()) return;
+        if (postJson(p, (uint32_t)batch.size() * EVENT_BYTES)) {
+          for (Event *e : batch) e->ackMs = t;
+        } else {
+          classFailed = true;
+        }
+        batch.clear();
+      };
+      for (Event *e : queue) {
+        if ((e->major ? SYNC_PRIO_MAJOR : SYNC_PRIO_WARNING) != p) continue;
+        if (!draining && processed > 0 && t - start > 1200) draining = true;
+        if (draining || !classDue || classFailed) continue;
+        processed++;
+        if (!e->major) {
+          batch.push_back(e);
+          if ((int)batch.size() >= batchMax) flush();
+        } else {
+          flush();
+          if (classFailed) continue;
+          const uint32_t t0 = t;
+          if (uploadMajor()) {
+            sched.onSuccess(p, t);
+            e->ackMs = t;
+          } else {
+            sched.onFailure(p, t0, rng());
+            classFailed = true;
+          }
+        }
+        if (processed >= 12) draining = true;
+      }
+      flush();
+    }
+    dropAcked();
+  }
+
+  // jobDbUploadTick()
+  uint32_t dbTick() {
+    const uint32_t now = t;
+    const bool backlog = dbPending() > 0 && dbSent > 0 && dbPending() >= 120;
+    const bool due = (now - lastDbMs >= DB_UPLOAD_INTERVAL_MS) ||
+                     ((dbRetryPending || backlog) && sched.due(SYNC_PRIO_DB_SERIES, now));
+    const bool eventsDraining = !queue.empty() && (sched.due(SYNC_PRIO_MAJOR, now) || sched.due(SYNC_PRIO_WARNING, now));
+    if (due && !eventsDraining && sched.due(SYNC_PRIO_DB_SERIES, now)) {
+      const uint32_t n = std::min<uint32_t>((uint32_t)sched.batchSize(SYNC_PRIO_DB_SERIES, (int)DB_LINE_BYTES, 120), dbPending());
+      if (n > 0 && postJson(SYNC_PRIO_DB_SERIES, n * DB_LINE_BYTES)) dbSent += n;
+      dbRetryPending = sched.failStreak[SYNC_PRIO_DB_SERIES] > 0;
+      lastDbMs = now;
+    }
+    const uint32_t since = t - lastDbMs;
+    if (dbRetryPending || backlog || since >= DB_UPLOAD_INTERVAL_MS) return DB_UPLOAD_POLL_MS;
+    return DB_UPLOAD_INTERVAL_MS - since;
+  }
+
+  void step() override {
+    admit();
+    if (!online()) {
+      t = api->sc->offlineUntilMs;
+      return;
+    }
+    const uint32_t now = t;
+    if (now >= nextProbeMs) {
+      nextProbeMs = now + PROBE_INTERVAL_MS;
+      if (!sched.livenessFresh(now)) {
+        probes++;
+        t += PROBE_MS;
+        return;
+      }
+      sched.probesSkipped++;
+    }
+    if (now >= nextSyncMs) {
+      nextSyncMs = now + SYNC_INTERVAL_MS;
+      if ((sched.due(SYNC_PRIO_MAJOR, now) || sched.due(SYNC_PRIO_WARNING, now)) && !queue.empty()) attempt();
+      return;
+    }
+    if (now >= nextDbMs) {
+      nextDbMs = now + dbTick();
+      return;
+    }
+    t = std::min(std::min(nextProbeMs, nextSyncMs), nextDbMs);
+  }
+};
+
+// ---------------------------------------------------------------- runs
+
+struct RunOut {
+  std::vector<uint32_t> ttdMs;   // MAJOR events that reached the dashboard
+  int majors = 0;
+  int unsent = 0;                // MAJOR events still queued at the end
+  uint32_t requests = 0;
+  uint32_t failed = 0;
+  uint32_t probes = 0;
+  uint32_t rejected = 0;
+  int peakPerSec = 0;            // API requests started in one second, from the outage on
+};
+
+static uint32_t pct(std::vector<uint32_t> v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t)(p * (double)(v.size() - 1) + 0.5))];
+}
+
+static RunOut run(int si, bool newPolicy) {
+  const Scenario &sc = SCENARIOS[si];
+  Api api;
+  api.sc = &sc;
+  std::vector<Device *> devs;
+  std::mt19937 phase(7000 + (uint32_t)si);
+  for (int d = 0; d < sc.devices; d++) {
+    const std::vector<Event> ev = makeEvents(sc, 1000u * (uint32_t)si + (uint32_t)d);
+    const uint32_t seed = 5000u * (uint32_t)si + (uint32_t)d;
+    const uint32_t ph = sc.devices > 1 ? phase() % 3000 : 0;
+    if (newPolicy) devs.push_back(new NewDevice(&api, ev, seed, ph));
+    else devs.push_back(new OldDevice(&api, ev, seed, ph));
+  }
+  // Always advance the device that is furthest behind, so the API sees requests in time order.
+  while (true) {
+    Device *next = nullptr;
+    for (Device *d : devs) {
+      if (d->t < SIM_MS && (!next || d->t < next->t)) next = d;
+    }
+    if (!next) break;
+    next->step();
+  }
+  RunOut o;
+  for (Device *d : devs) {
+    for (const Event &e : d->events) {
+      if (!e.major) continue;
+      o.majors++;
+      if (e.ackMs) o.ttdMs.push_back(e.ackMs - std::max(e.createdMs, sc.offlineUntilMs));
+      else o.unsent++;
+    }
+    o.requests += d->requests;
+    o.failed += d->failed;
+    o.probes += d->probes;
+    delete d;
+  }
+  o.rejected = api.rejected;
+  o.peakPerSec = api.peakPerSec(sc.apiDownFromMs ? sc.apiDownFromMs : 0);
+  return o;
+}
+
+// ---------------------------------------------------------------- checks
+
+static void schedulerChecks() {
+  SyncScheduler s;
+  std::mt19937 rng(1);
+  bool windowsOk = true;
+  uint32_t majorMax = 0;
+  for (int k = 1; k <= 10; k++) {
+    s.onFailure(SYNC_PRIO_WARNING, 0, rng());
+    s.onFailure(SYNC_PRIO_MAJOR, 0, rng());
+    uint32_t win = s.backoffMinMs;
+    for (int i = 1; i < k && win < s.backoffMaxMs; i++) win *= 2;
+    win = std::min(win, s.backoffMaxMs);
+    const uint32_t wait = s.nextAllowedMs[SYNC_PRIO_WARNING];
+    windowsOk &= wait >= win / 2 && wait <= win;
+    majorMax = std::max(majorMax, s.nextAllowedMs[SYNC_PRIO_MAJOR]);
+  }
+  expect(windowsOk, "backoff: failure k waits between half and all of min(2 s * 2^(k-1), 120 s)");
+  expect(majorMax <= s.majorBackoffMaxMs && majorMax >= s.majorBackoffMaxMs / 2, "MAJOR backoff stops at 30 s");
+  expect(!s.due(SYNC_PRIO_WARNING, 1000) && s.due(SYNC_PRIO_DB_SERIES, 0), "backoff is per class");
+
+  std::vector<uint32_t> waits;
+  for (int d = 0; d < 200; d++) {
+    SyncScheduler x;
+    for (int k = 0; k < 4; k++) x.onFailure(SYNC_PRIO_WARNING, 0, rng());
+    waits.push_back(x.nextAllowedMs[SYNC_PRIO_WARNING]);
+  }
+  std::sort(waits.begin(), waits.end());
+  const uint32_t spread = waits.back() - waits.front();
+  char what[160];
+  snprintf(what, sizeof(what), "jitter: 200 devices after 4 failures retry over %u ms of an 8000 ms window", spread);
+  expect(spread >= 3000, what);
+
+  s.onSuccess(SYNC_PRIO_MAJOR, 5000);
+  expect(s.failStreak[SYNC_PRIO_MAJOR] == 0 && s.due(SYNC_PRIO_MAJOR, 5000), "success clears the backoff at once");
+
+  SyncScheduler c;
+  c.onSuccess(SYNC_PRIO_MAJOR, 100);
+  c.noteApiOk(100);   // markSupabaseOk() after the same call
+  c.noteApiOk(200);
+  c.onFailure(SYNC_PRIO_WARNING, 300, 0);
+  expect(c.okCount == 1 && c.failCount == 1 && c.livenessFresh(200),
+         "one success counts once; liveness notes alone count nothing");
+  expect(c.livenessFresh(200 + c.livenessWindowMs - 1) && !c.livenessFresh(200 + c.livenessWindowMs),
+         "liveness lasts 30 s after the last 2xx");
+
+  SyncScheduler b;
+  const int rssis[] = { -50, -65, -75, -85 };
+  int prev = 1 << 30;
+  bool monotone = true;
+  for (int r : rssis) {
+    b.rssi = r;
+    const int n = b.batchSize(SYNC_PRIO_WARNING, 220, 40);
+    monotone &= n <= prev && n >= 1;
+    prev = n;
+  }
+  expect(monotone && prev == 5, "batch ceiling falls with RSSI (40 at -50 dBm, 5 at -85 dBm)");
+  b.rssi = -50;
+  b.noteTransfer(2200, 1000);   // 2.2 bytes/ms: 1500 ms of it is 15 events
+  expect(b.batchSize(SYNC_PRIO_WARNING, 220, 40) == 15, "throughput narrows the batch to what fits in 1.5 s");
+  b.onFailure(SYNC_PRIO_WARNING, 0, 0);
+  b.onFailure(SYNC_PRIO_WARNING, 0, 0);
+  expect(b.batchSize(SYNC_PRIO_WARNING, 220, 40) == 3, "two failures quarter the batch");
+}
+
+static void bench(bool check) {
+  printf("\nMAJOR time to dashboard (s); 4 h simulated; requests include failures\n");
+  printf("  %-38s %-6s %6s %7s %7s %7s %6s %8s %6s %6s %9s\n", "scenario", "policy", "majors", "p50", "p95", "max", "unsent",
+         "requests", "failed", "probes", "peak/s");
+  for (int si = 0; si < SCENARIO_COUNT; si++) {
+    const RunOut r[2] = { run(si, false), run(si, true) };
+    for (int k = 0; k < 2; k++) {
+      const RunOut &o = r[k];
+      printf("  %-38s %-6s %6d %7.1f %7.1f %7.1f %6d %8u %6u %6u %9d\n", k ? "" : SCENARIOS[si].name, k ? "new" : "old", o.majors,
+             pct(o.ttdMs, 0.5) / 1000.0, pct(o.ttdMs, 0.95) / 1000.0, pct(o.ttdMs, 1.0) / 1000.0, o.unsent, o.requests,
+             o.failed, o.probes, o.peakPerSec);
+    }
+    if (!check) continue;
+    const Scenario &sc = SCENARIOS[si];
+    const RunOut &o = r[0], &n = r[1];
+    const uint32_t oldP95 = pct(o.ttdMs, 0.95), newP95 = pct(n.ttdMs, 0.95);
+    char what[200];
+    snprintf(what, sizeof(what), "%s: every MAJOR reaches the dashboard, p95 %.1f s (old %.1f s)", sc.name, newP95 / 1000.0,
+             oldP95 / 1000.0);
+    // Jitter may land a retry up to a few seconds after the old fixed one; more than 5% is a regression.
+    expect(n.unsent == 0 && newP95 <= oldP95 + oldP95 / 20, what);
+    if (sc.offlineUntilMs || sc.dropsPerMin >= 1.0f) {
+      snprintf(what, sizeof(what), "%s: MAJOR ahead of the backlog and of dropped transfers", sc.name);
+      expect(newP95 < oldP95, what);
+    }
+    snprintf(what, sizeof(what), "%s: %u internet probes (old %u)", sc.name, n.probes, o.probes);
+    expect(n.probes < o.probes, what);
+    if (sc.apiPerSec > 0) {
+      snprintf(what, sizeof(what), "%s: at most %d requests in one second after the outage (old %d)", sc.name, n.peakPerSec,
+               o.peakPerSec);
+      expect(n.peakPerSec * 3 <= o.peakPerSec * 2, what);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) {
+    schedulerChecks();
+    bench(true);
+    return fails ? 1 : 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "bench")) {
+    bench(false);
+    return 0;
+  }
+  fprintf(stderr, "usage: sync_sim selftest | bench\n");
+  return 2;
+}
@@ -0,0 +1,443 @@
+// Host harness for the Wi-Fi reconnect state machine (wifi_reconnect.h).
+//
+// A simulated driver and access point run on a virtual millisecond clock. The driver mimics the
+// ESP32 STA: a targeted begin (BSSID + channel) associates in ~150 ms or reports NO_AP_FOUND
+// after probing that one channel; a plain begin scans all channels first; association is
+// followed by DHCP unless a static address was configured; a dead AP is noticed by beacon
+// timeout. Events reach the machine through WifiEventQueue exactly as onWiFiEvent() feeds it.
+// The AP can reboot (optionally onto another channel), vanish for minutes or reject the password.
+//
+// The old policy for comparison is the previous connect logic given a retry after a drop (it had
+// none): a full scan-and-associate with DHCP, a 30 s timeout, then 60 s of suppressed retries.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. wifi_sim.cpp -o wifi_sim
+//
+// Usage:
+//   wifi_sim selftest     state machine checks plus the scenarios (exit status 1 on failure)
+//   wifi_sim bench        outage per scenario, old policy vs fast reconnect
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "wifi_reconnect.h"
+
+static int fails = 0;
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) fails++;
+}
+
+// ---------------------------------------------------------------- simulated AP + driver
+
+static const uint32_t SCAN_PER_CHANNEL_MS = 120;   // active scan dwell
+static const uint32_t ASSOC_MS = 150;              // auth + assoc + 4-way handshake
+static const uint32_t DHCP_MS = 1400;              // DISCOVER/OFFER/REQUEST/ACK on a busy school LAN
+static const uint32_t PROBE_FAIL_MS = 700;         // targeted probe on one channel finds nothing
+static const uint32_t BEACON_TIMEOUT_MS = 6000;
+static const uint32_t AUTH_FAIL_MS = 900;
+
+struct SimAp {
+  uint8_t bssid[6] = { 0x24, 0x0A, 0xC4, 0x11, 0x22, 0x33 };
+  uint8_t channel = 6;
+  bool passwordOk = true;
+  std::vector<std::pair<uint32_t, uint32_t>> down;   // [from, to) ms
+  uint32_t newChannelAfterMs = 0;                    // channel changes after this outage ends
+  uint8_t newChannel = 0;
+
+  bool upAt(uint32_t t) const {
+    for (auto &d : down) {
+      if (t >= d.first && t < d.second) return false;
+    }
+    return true;
+  }
+  uint8_t channelAt(uint32_t t) const { return (newChannel && t >= newChannelAfterMs) ? newChannel : channel; }
+};
+
+struct Pending {
+  uint32_t at;
+  uint8_t ev;
+  uint8_t reason;
+  uint32_t gen;
+};
+
+struct SimDriver {
+  SimAp *ap = nullptr;
+  WifiEventQueue<8> *queue = nullptr;
+  std::vector<Pending> pending;
+  uint32_t gen = 0;             // bumps on every begin/disconnect, voiding older pending events
+  bool associated = false;
+  bool apWasDown = false;       // AP went away under an association; it forgot us when it came back
+  bool staticIp = false;
+  uint32_t associatedAt = 0;
+  uint32_t begins = 0;
+  uint32_t scans = 0;
+  uint32_t dhcpRuns = 0;
+
+  void schedule(uint32_t at, uint8_t ev, uint8_t reason = 0) { pending.push_back({ at, ev, reason, gen }); }
+
+  void disconnect(uint32_t now) {
+    gen++;
+    pending.clear();
+    if (associated) {
+      associated = false;
+      schedule(now + 1, WIFI_EV_DISCONNECTED, WIFI_RC_REASON_ASSOC_LEAVE);
+    }
+  }
+
+  void associateAt(uint32_t t) {
+    if (!ap->passwordOk) {
+      schedule(t + AUTH_FAIL_MS, WIFI_EV_DISCONNECTED, WIFI_RC_REASON_4WAY_TIMEOUT);
+      return;
+    }
+    schedule(t + ASSOC_MS, WIFI_EV_ASSOC);
+    if (!staticIp) dhcpRuns++;
+    schedule(t + ASSOC_MS + (staticIp ? 5 : DHCP_MS), WIFI_EV_GOT_IP);
+  }
+
+  void beginTargeted(uint32_t now, const uint8_t *bssid, uint8_t channel, bool useStatic) {
+    disconnect(now);
+    begins++;
+    staticIp = useStatic;
+    if (ap->upAt(now) && ap->channelAt(now) == channel && !memcmp(bssid, ap->bssid, 6)) {
+      associateAt(now);
+    } else {
+      schedule(now + PROBE_FAIL_MS, WIFI_EV_DISCONNECTED, WIFI_RC_REASON_NO_AP_FOUND);
+    }
+  }
+
+  void beginScan(uint32_t now) {
+    disconnect(now);
+    begins++;
+    scans++;
+    staticIp = false;
+    const uint32_t scanDone = now + 13 * SCAN_PER_CHANNEL_MS;
+    if (ap->upAt(scanDone)) {
+      associateAt(scanDone);
+    } else {
+      schedule(scanDone, WIFI_EV_DISCONNECTED, WIFI_RC_REASON_NO_AP_FOUND);
+    }
+  }
+
+  void dhcp(uint32_t now) {
+    staticIp = false;
+    dhcpRuns++;
+    schedule(now + 2, WIFI_EV_LOST_IP);
+    schedule(now + DHCP_MS, WIFI_EV_GOT_IP);
+  }
+
+  // Delivers due events to the queue. A dead AP drops the link after the beacon timeout; one that
+  // rebooted sooner deauthenticates us the first time we transmit after it is back.
+  void tick(uint32_t now) {
+    if (associated && ap->upAt(now) && apWasDown) {
+      associated = false;
+      apWasDown = false;
+      gen++;
+      pending.clear();
+      queue->push(WIFI_EV_DISCONNECTED, 7);   // CLASS3_FRAME_FROM_NONASSOC_STA
+    }
+    if (associated && !ap->upAt(now)) {
+      apWasDown = true;
+      uint32_t silentSince = now;
+      while (silentSince > associatedAt && !ap->upAt(silentSince - 1)) silentSince--;
+      if (silentSince < now && now - silentSince >= BEACON_TIMEOUT_MS) {
+        associated = false;
+        apWasDown = false;
+        gen++;
+        pending.clear();
+        queue->push(WIFI_EV_DISCONNECTED, 200);   // BEACON_TIMEOUT
+      }
+    }
+    std::vector<Pending> later;
+    for (const Pending &p : pending) {
+      if (p.gen != gen) continue;
+      if (p.at > now) {
+        later.push_back(p);
+        continue;
+      }
+      if (p.ev == WIFI_EV_ASSOC) {
+        associated = true;
+        apWasDown = false;
+        associatedAt = now;
+      }
+      queue->push(p.ev, p.reason);
+    }
+    pending.swap(later);
+  }
+};
+
+// ---------------------------------------------------------------- runs
+
+enum Policy { POLICY_OLD, POLICY_NEW };
+
+struct Scenario {
+  const char *name;
+  bool startUp;              // device already associated at t=0 (else it is booting)
+  uint32_t downFrom;
+  uint32_t downTo;
+  uint8_t newChannel;        // AP comes back on this channel (0 = same)
+  bool cached;               // boot: cache present
+  uint32_t leaseAgeS;        // boot: cached lease age (UINT32_MAX = clock unknown)
+  bool wrongPassword;
+};
+
+struct RunOut {
+  uint32_t outageMs = 0;     // AP down (or boot) to IP
+  bool reconnected = false;
+  uint32_t begins = 0;
+  uint32_t scans = 0;
+  uint32_t dhcpRuns = 0;
+  WifiReconnect m;
+};
+
+static const uint32_t EPOCH_BASE = 1760000000u;
+
+static RunOut runScenario(const Scenario &sc, Policy policy, uint32_t horizonMs) {
+  SimAp ap;
+  ap.passwordOk = !sc.wrongPassword;
+  if (sc.downTo > sc.downFrom) ap.down.push_back({ sc.downFrom, sc.downTo });
+  if (sc.newChannel) {
+    ap.newChannel = sc.newChannel;
+    ap.newChannelAfterMs = sc.downTo;
+  }
+  WifiEventQueue<8> q;
+  SimDriver drv;
+  drv.ap = &ap;
+  drv.queue = &q;
+  RunOut out;
+  WifiReconnect &m = out.m;
+
+  auto epochAt = [&](uint32_t t) -> uint32_t { return EPOCH_BASE + t / 1000; };
+  auto carryOut = [&](WifiRcAction a, uint32_t now) {
+    switch (a) {
+      case WIFI_ACT_CONNECT_FAST: drv.beginTargeted(now, m.cache.bssid, m.cache.channel, m.leaseInUse); break;
+      case WIFI_ACT_CONNECT_SCAN: drv.beginScan(now); break;
+      case WIFI_ACT_STOP: drv.disconnect(now); break;
+      case WIFI_ACT_DHCP: drv.dhcp(now); break;
+      default: break;
+    }
+  };
+
+  const uint32_t lossAt = sc.startUp ? sc.downFrom : 0;   // outage as the device's users see it
+  bool waiting = true;
+  // Old policy state
+  uint32_t oldAttemptAt = 0, oldSuppressUntil = 0;
+  bool oldTrying = false, oldUp = false;
+
+  if (sc.startUp) {
+    m.noteLink(ap.bssid, ap.channel, 0x0A00000Au, 0x0100000Au, 0x00FFFFFFu, 0x0100000Au, true, epochAt(0) - 600);
+    m.cacheDirty = false;
+    m.state = WIFI_RC_UP;
+    drv.associated = true;
+    drv.associatedAt = 0;
+    oldUp = true;
+    waiting = false;
+  } else {
+    if (sc.cached) {
+      const uint32_t leaseEpoch = sc.leaseAgeS == UINT32_MAX ? 0 : epochAt(0) - sc.leaseAgeS;
+      m.noteLink(ap.bssid, ap.channel, 0x0A00000Au, 0x0100000Au, 0x00FFFFFFu, 0x0100000Au, true, leaseEpoch);
+      m.cacheDirty = false;
+    }
+    if (policy == POLICY_NEW) {
+      carryOut(m.start(0, sc.leaseAgeS == UINT32_MAX ? 0 : epochAt(0)), 0);
+    } else {
+      drv.beginScan(0);
+      oldTrying = true;
+      oldAttemptAt = 0;
+    }
+  }
+
+  for (uint32_t now = 1; now <= horizonMs; now++) {
+    drv.tick(now);
+    const uint32_t epochS = (!sc.startUp && sc.leaseAgeS == UINT32_MAX) ? 0 : epochAt(now);
+    WifiEventMsg e;
+    while (q.pop(e)) {
+      if (policy == POLICY_NEW) {
+        const WifiRcState before = m.state;
+        carryOut(m.onEvent(e.ev, e.reason, now, epochS), now);
+        if (before == WIFI_RC_UP && m.state != WIFI_RC_UP) waiting = true;
+        if (e.ev == WIFI_EV_GOT_IP && m.state == WIFI_RC_UP) {
+          m.noteLink(ap.bssid, ap.channelAt(now), 0x0A00000Au, 0x0100000Au, 0x00FFFFFFu, 0x0100000Au, !m.leaseInUse, epochS);
+          if (waiting && !out.reconnected) {
+            out.reconnected = true;
+            out.outageMs = now - lossAt;
+          }
+          waiting = false;
+        }
+      } else {
+        if (e.ev == WIFI_EV_DISCONNECTED && e.reason != WIFI_RC_REASON_ASSOC_LEAVE) {
+          if (oldUp) {
+            oldUp = false;
+            waiting = true;
+            // What the request describes: a fresh full attempt, then cooldown on failure.
+            drv.beginScan(now);
+            oldTrying = true;
+            oldAttemptAt = now;
+          }
+        } else if (e.ev == WIFI_EV_GOT_IP && oldTrying) {
+          oldTrying = false;
+          oldUp = true;
+          if (waiting && !out.reconnected) {
+            out.reconnected = true;
+            out.outageMs = now - lossAt;
+          }
+          waiting = false;
+        }
+      }
+    }
+    if (policy == POLICY_NEW) {
+      carryOut(m.poll(now, epochS), now);
+    } else {
+      if (oldTrying && now - oldAttemptAt > 30000) {
+        oldTrying = false;
+        drv.disconnect(now);
+        oldSuppressUntil = now + 60000;
+      }
+      if (!oldTrying && !oldUp && oldSuppressUntil && now >= oldSuppressUntil) {
+        oldSuppressUntil = 0;
+        drv.beginScan(now);
+        oldTrying = true;
+        oldAttemptAt = now;
+      }
+    }
+    if (out.reconnected && now > sc.downTo + 70000) break;
+  }
+  out.begins = drv.begins;
+  out.scans = drv.scans;
+  out.dhcpRuns = drv.dhcpRuns;
+  return out;
+}
+
+static const Scenario SCENARIOS[] = {
+  { "AP reboot 30 s", true, 1000, 31000, 0, true, 0, false },
+  { "AP reboot 30 s, new channel", true, 1000, 31000, 11, true, 0, false },
+  { "AP blip 3 s", true, 1000, 4000, 0, true, 0, false },
+  { "AP down 5 min", true, 1000, 301000, 0, true, 0, false },
+  { "boot, cache + fresh lease", false, 0, 0, 0, true, 300, false },
+  { "boot, cache, clock unknown", false, 0, 0, 0, true, UINT32_MAX, false },
+  { "boot, no cache", false, 0, 0, 0, false, 0, false },
+};
+
+static void printScenario(const Scenario &sc, const RunOut &o, const RunOut &n) {
+  char oldMs[24], newMs[24];
+  if (o.reconnected) snprintf(oldMs, sizeof(oldMs), "%u", o.outageMs);
+  else snprintf(oldMs, sizeof(oldMs), "never");
+  if (n.reconnected) snprintf(newMs, sizeof(newMs), "%u", n.outageMs);
+  else snprintf(newMs, sizeof(newMs), "never");
+  printf("  %-30s %10s %10s %9u %7u %6u\n", sc.name, oldMs, newMs, n.begins, n.scans, n.dhcpRuns);
+}
+
+static void bench(bool check) {
+  printf("\noutage = AP down (or boot) to IP, ms; last three columns are the new policy's\n");
+  printf("  %-30s %10s %10s %9s %7s %6s\n", "scenario", "old", "new", "attempts", "scans", "dhcp");
+  for (const Scenario &sc : SCENARIOS) {
+    RunOut o = runScenario(sc, POLICY_OLD, sc.downTo + 400000);
+    RunOut n = runScenario(sc, POLICY_NEW, sc.downTo + 400000);
+    printScenario(sc, o, n);
+    if (!check) continue;
+    char what[200];
+    const uint32_t afterAp = n.outageMs - std::min(n.outageMs, sc.downTo - sc.downFrom);
+    snprintf(what, sizeof(what), "%s: up %u ms after the AP, never later than the old policy", sc.name, afterAp);
+    // Worst case: the AP returns just after a scan started a full backoff wait.
+    const uint32_t bound = n.m.backoffMaxMs + n.m.fastTimeoutMs + 13 * SCAN_PER_CHANNEL_MS + ASSOC_MS + DHCP_MS;
+    expect(n.reconnected && afterAp <= bound && (!o.reconnected || n.outageMs <= o.outageMs), what);
+    if (sc.cached && sc.leaseAgeS != UINT32_MAX && !sc.startUp) {
+      expect(n.outageMs < 500 && n.scans == 0, "boot with a fresh lease: no scan, no DHCP wait");
+    }
+  }
+}
+
+// ---------------------------------------------------------------- machine checks
+
+static void machineChecks() {
+  const uint8_t bssid[6] = { 1, 2, 3, 4, 5, 6 };
+  WifiReconnect m;
+  expect(m.start(0, 0) == WIFI_ACT_CONNECT_SCAN && m.state == WIFI_RC_SCAN, "no cache: first attempt scans");
+  m.onEvent(WIFI_EV_ASSOC, 0, 300, 0);
+  m.onEvent(WIFI_EV_GOT_IP, 0, 2000, 0);
+  m.noteLink(bssid, 6, 10, 1, 0xFFFFFF, 1, true, 0);
+  expect(m.state == WIFI_RC_UP && m.cacheDirty && m.cacheValid() && m.lastReconnectMs == 2000, "scan connect fills the cache");
+  m.cacheDirty = false;
+  m.noteLink(bssid, 6, 10, 1, 0xFFFFFF, 1, false, 0);
+  expect(!m.cacheDirty, "unchanged link leaves the cache clean (no NVS write)");
+
+  expect(m.onEvent(WIFI_EV_DISCONNECTED, 200, 10000, 0) == WIFI_ACT_CONNECT_FAST && !m.leaseInUse,
+         "link loss: targeted attempt at once; no lease reuse without a clock");
+  expect(m.onEvent(WIFI_EV_DISCONNECTED, WIFI_RC_REASON_ASSOC_LEAVE, 10001, 0) == WIFI_ACT_NONE && m.state == WIFI_RC_FAST,
+         "our own disconnect is ignored");
+  expect(m.onEvent(WIFI_EV_DISCONNECTED, WIFI_RC_REASON_NO_AP_FOUND, 10700, 0) == WIFI_ACT_CONNECT_SCAN,
+         "targeted miss falls through to a scan");
+  expect(m.onEvent(WIFI_EV_DISCONNECTED, WIFI_RC_REASON_NO_AP_FOUND, 12300, 0) == WIFI_ACT_STOP && m.state == WIFI_RC_BACKOFF &&
+             m.retryAtMs == 12300 + 1000,
+         "failed scan backs off 1 s");
+  uint32_t now = 12300;
+  uint32_t lastBackoff = 0;
+  for (int i = 0; i < 8; i++) {
+    now = m.retryAtMs;
+    WifiRcAction a = m.poll(now, 0);
+    if (a != WIFI_ACT_CONNECT_FAST) break;
+    m.onEvent(WIFI_EV_DISCONNECTED, WIFI_RC_REASON_NO_AP_FOUND, now += 700, 0);
+    m.onEvent(WIFI_EV_DISCONNECTED, WIFI_RC_REASON_NO_AP_FOUND, now += 1600, 0);
+    lastBackoff = m.retryAtMs - now;
+  }
+  char what[160];
+  snprintf(what, sizeof(what), "backoff doubles to the %u ms cap (last %u ms)", m.backoffMaxMs, lastBackoff);
+  expect(lastBackoff == m.backoffMaxMs, what);
+
+  WifiReconnect w;
+  w.noteLink(bssid, 6, 10, 1, 0xFFFFFF, 1, true, EPOCH_BASE);
+  w.start(0, EPOCH_BASE + 60);
+  expect(w.state == WIFI_RC_FAST && w.leaseInUse && w.leaseReuses == 1, "fresh lease reused as a static address");
+  w.onEvent(WIFI_EV_DISCONNECTED, WIFI_RC_REASON_4WAY_TIMEOUT, 900, EPOCH_BASE);
+  w.onEvent(WIFI_EV_DISCONNECTED, WIFI_RC_REASON_4WAY_TIMEOUT, 3000, EPOCH_BASE);
+  expect(w.state == WIFI_RC_BACKOFF && w.retryAtMs == 3000 + w.authBackoffMs, "wrong password backs off authBackoffMs");
+  expect(w.poll(3000 + w.authBackoffMs, EPOCH_BASE) == WIFI_ACT_CONNECT_SCAN, "after an auth failure the retry scans");
+
+  WifiReconnect h;
+  h.noteLink(bssid, 6, 10, 1, 0xFFFFFF, 1, true, EPOCH_BASE);
+  h.start(0, EPOCH_BASE + 10);
+  h.onEvent(WIFI_EV_GOT_IP, 0, 160, EPOCH_BASE);
+  expect(h.poll(h.dhcpHandbackMs - 1, EPOCH_BASE) == WIFI_ACT_NONE && h.poll(h.dhcpHandbackMs + 160, EPOCH_BASE) == WIFI_ACT_DHCP &&
+             h.poll(h.dhcpHandbackMs + 200, EPOCH_BASE) == WIFI_ACT_NONE,
+         "static lease handed back to DHCP once, after dhcpHandbackMs");
+  h.onEvent(WIFI_EV_LOST_IP, 0, h.dhcpHandbackMs + 170, EPOCH_BASE);
+  h.onEvent(WIFI_EV_GOT_IP, 0, h.dhcpHandbackMs + 1500, EPOCH_BASE);
+  expect(h.state == WIFI_RC_UP && h.ipUp && h.reconnects == 1, "handback IP loss is not a reconnect");
+
+  WifiReconnect s;
+  s.noteLink(bssid, 6, 10, 1, 0xFFFFFF, 1, true, EPOCH_BASE);
+  s.start(0, EPOCH_BASE + s.leaseMaxAgeS + 1);
+  expect(s.state == WIFI_RC_FAST && !s.leaseInUse, "stale lease: targeted association, DHCP address");
+  s.forget();
+  expect(!s.cacheValid() && s.cacheDirty, "new credentials forget the cached AP");
+  s.stop();
+  expect(s.onEvent(WIFI_EV_DISCONNECTED, WIFI_RC_REASON_NO_AP_FOUND, 5000, 0) == WIFI_ACT_NONE && s.state == WIFI_RC_IDLE,
+         "stopped machine ignores events");
+
+  WifiEventQueue<4> q;
+  for (uint8_t i = 0; i < 6; i++) q.push(WIFI_EV_DISCONNECTED, i);
+  WifiEventMsg e;
+  bool inOrder = true;
+  for (uint8_t i = 0; i < 4; i++) inOrder &= q.pop(e) && e.reason == i;
+  expect(inOrder && !q.pop(e) && q.dropped == 2, "event queue keeps order and counts overflow");
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) {
+    machineChecks();
+    bench(true);
+    return fails ? 1 : 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "bench")) {
+    bench(false);
+    return 0;
+  }
+  fprintf(stderr, "usage: wifi_sim selftest | bench\n");
+  return 2;
+}
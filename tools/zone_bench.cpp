@@ -0,0 +1,397 @@
+// Host harness for two-zone capture (zone_meter.h).
+//
+// Feeds stereo WAV through the firmware's per-zone pipeline: zoneSplit() over the interleaved
+// block, dspLevelDb(), EMA smoothing, a NoiseEngine per zone, and the db-series change detector.
+// WAV samples are 16-bit (as written by recordINMP441Wav5s()) or 32-bit PCM; 16-bit ones are
+// shifted back up by 14 bits so the levels match what the INMP441 delivers. One 256-frame block is
+// taken every 50 ms of audio, the loop's full-rate cadence.
+//
+// Build (host):
+//   g++ -O2 -std=c++17 -I.. zone_bench.cpp -o zone_bench
+//
+// Usage:
+//   zone_bench run <stereo.wav>      per-zone levels, LED time, warnings and db-series records
+//   zone_bench selftest [dir]        writes a stereo WAV where each zone gets its own loud stretch,
+//                                    replays it and checks that each zone escalates independently
+//                                    (exit status 1 on failure)
+//   zone_bench bench [iterations]    ns per block: old mono readMicDB() loop, one zone, two zones
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dsp_pipeline.h"
+#include "event_queue.h"
+#include "zone_meter.h"
+
+static const int BUFFER_LEN = 256;
+static const double NOISE_FLOOR = 25000;
+static const double SENSITIVITY = 0.5;
+static const double SMOOTH_ALPHA = 0.1;
+static const int FRAME_HOP = 800;   // 50 ms at 16 kHz
+static const int DB_CHANGE10 = 10;
+static const uint32_t DB_HEARTBEAT_MS = 8000;
+
+// ---------- WAV I/O ----------
+
+static bool readWav(const std::string &path, std::vector<int32_t> &out, int &channels) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  uint8_t hdr[12];
+  if (fread(hdr, 1, 12, f) != 12 || memcmp(hdr, "RIFF", 4) || memcmp(hdr + 8, "WAVE", 4)) {
+    fclose(f);
+    return false;
+  }
+  uint16_t fmt = 0, ch = 0, bits = 0;
+  uint32_t rate = 0;
+  bool ok = false;
+  for (;;) {
+    uint8_t c[8];
+    if (fread(c, 1, 8, f) != 8) break;
+    uint32_t len = c[4] | (c[5] << 8) | (c[6] << 16) | ((uint32_t)c[7] << 24);
+    if (!memcmp(c, "fmt ", 4)) {
+      uint8_t b[16];
+      if (len < 16 || fread(b, 1, 16, f) != 16) break;
+      fmt = b[0] | (b[1] << 8);
+      ch = b[2] | (b[3] << 8);
+      rate = b[4] | (b[5] << 8) | (b[6] << 16) | ((uint32_t)b[7] << 24);
+      bits = b[14] | (b[15] << 8);
+      fseek(f, (long)(len - 16 + (len & 1)), SEEK_CUR);
+    } else if (!memcmp(c, "data", 4)) {
+      if (fmt != 1 || ch < 1 || ch > MAX_ZONES || rate != 16000 || (bits != 16 && bits != 32)) break;
+      size_t n = len / (bits / 8);
+      out.resize(n);
+      size_t i = 0;
+      for (; i < n; i++) {
+        if (bits == 16) {
+          int16_t v;
+          if (fread(&v, 2, 1, f) != 1) break;
+          out[i] = (int32_t)v * (1 << 14);
+        } else {
+          int32_t v;
+          if (fread(&v, 4, 1, f) != 1) break;
+          out[i] = v;
+        }
+      }
+      out.resize(i - i % ch);
+      channels = ch;
+      ok = true;
+      break;
+    } else {
+      fseek(f, (long)(len + (len & 1)), SEEK_CUR);
+    }
+  }
+  fclose(f);
+  return ok;
+}
+
+static bool writeWav16(const std::string &path, const std::vector<int16_t> &pcm, int channels) {
+  FILE *f = fopen(path.c_str(), "wb");
+  if (!f) return false;
+  const uint32_t rate = 16000;
+  const uint32_t dataBytes = (uint32_t)(pcm.size() * 2);
+  const uint32_t byteRate = rate * channels * 2;
+  const uint16_t align = (uint16_t)(channels * 2);
+  const uint16_t bits = 16, fmt = 1, ch = (uint16_t)channels;
+  const uint32_t riff = 36 + dataBytes, fmtLen = 16;
+  fwrite("RIFF", 1, 4, f);
+  fwrite(&riff, 4, 1, f);
+  fwrite("WAVEfmt ", 1, 8, f);
+  fwrite(&fmtLen, 4, 1, f);
+  fwrite(&fmt, 2, 1, f);
+  fwrite(&ch, 2, 1, f);
+  fwrite(&rate, 4, 1, f);
+  fwrite(&byteRate, 4, 1, f);
+  fwrite(&align, 2, 1, f);
+  fwrite(&bits, 2, 1, f);
+  fwrite("data", 1, 4, f);
+  fwrite(&dataBytes, 4, 1, f);
+  bool ok = fwrite(pcm.data(), 2, pcm.size(), f) == pcm.size();
+  fclose(f);
+  return ok;
+}
+
+// ---------- replay ----------
+
+struct Warning {
+  int zone;
+  WarningLevel level;
+  uint32_t ms;
+};
+
+struct ZoneReport {
+  uint32_t blocks = 0;
+  double sumDb = 0;
+  int maxDb = 0;
+  uint32_t ledMs[3] = { 0, 0, 0 };
+  uint32_t dbRecords = 0;
+};
+
+static std::vector<Warning> warnings;
+
+// ctx is the zone, as in the firmware.
+static void onWarning(void *ctx, WarningLevel level, int, int, uint32_t now) {
+  warnings.push_back({ ((ZoneState *)ctx)->id, level, now });
+}
+
+struct Replay {
+  ZoneState zones[MAX_ZONES];
+  ZoneReport report[MAX_ZONES];
+  int zoneCount = 1;
+
+  void run(const std::vector<int32_t> &interleaved, int channels) {
+    zoneCount = channels;
+    for (int z = 0; z < MAX_ZONES; z++) {
+      zones[z].id = (uint8_t)z;
+      zones[z].engine.hooks.ctx = &zones[z];
+      zones[z].engine.hooks.onWarning = onWarning;
+    }
+    static int32_t split[MAX_ZONES][BUFFER_LEN];
+    int32_t *out[MAX_ZONES] = { split[0], split[1] };
+    const size_t frames = interleaved.size() / channels;
+    uint32_t now = 0;
+    for (size_t pos = 0; pos + BUFFER_LEN <= frames; pos += FRAME_HOP, now += 50) {
+      double sumSq[MAX_ZONES] = { 0, 0 };
+      int n = zoneSplit(&interleaved[pos * channels], BUFFER_LEN * channels, channels, out, sumSq);
+      for (int z = 0; z < zoneCount; z++) {
+        ZoneState &zs = zones[z];
+        ZoneReport &rep = report[z];
+        zs.rawDb = dspLevelDb(sumSq[z], n, NOISE_FLOOR, SENSITIVITY);
+        zs.smoothDb = zs.smoothDb + SMOOTH_ALPHA * (zs.rawDb - zs.smoothDb);
+        const int v = (int)zs.smoothDb;
+        rep.ledMs[zs.engine.updateLed(v)] += 50;
+        zs.engine.handleWarnings(v, now);
+        rep.blocks++;
+        rep.sumDb += v;
+        if (v > rep.maxDb) rep.maxDb = v;
+
+        const int db10 = (int)lround(zs.smoothDb * 10.0);
+        if (zs.lastDbLogged10 == -999999 || abs(db10 - zs.lastDbLogged10) >= DB_CHANGE10 ||
+            now - zs.lastDbRecordMs >= DB_HEARTBEAT_MS) {
+          zs.lastDbLogged10 = db10;
+          zs.lastDbRecordMs = now;
+          rep.dbRecords++;
+        }
+      }
+    }
+  }
+
+  void print() const {
+    static const char *const levels[] = { "FIRST", "SECOND", "MAJOR", "MAJOR(repeat)" };
+    for (int z = 0; z < zoneCount; z++) {
+      const ZoneReport &r = report[z];
+      const double total = r.blocks * 50.0;
+      printf("zone %d: blocks=%u mean=%.1f dB max=%d dB  LED green=%.0f%% yellow=%.0f%% red=%.0f%%  db records=%u\n",
+             z + 1, r.blocks, r.blocks ? r.sumDb / r.blocks : 0.0, r.maxDb, 100.0 * r.ledMs[GREEN] / total,
+             100.0 * r.ledMs[YELLOW] / total, 100.0 * r.ledMs[RED] / total, r.dbRecords);
+    }
+    for (const Warning &w : warnings) printf("  zone %d %-13s at %6.2f s\n", w.zone + 1, levels[w.level], w.ms / 1000.0);
+  }
+};
+
+// ---------- selftest ----------
+
+// The pre-zone readMicDB(): one pass over a mono block.
+static int monoDb(const int32_t *s, int n) {
+  double sum = 0;
+  for (int i = 0; i < n; i++) {
+    double v = s[i];
+    sum += v * v;
+  }
+  double rms = std::max(0.0, sqrt(sum / n) - NOISE_FLOOR);
+  return (int)(20.0 * log10(rms + 1) * SENSITIVITY);
+}
+
+// Best of 9 rounds, so a busy host doesn't skew one variant.
+
+
+// Zone 1 loud for [0, 65) s, zone 2 loud for [90, 155) s, 180 s total. Loud is crowd-like noise
+// around 77 dB after the level mapping, quiet is around 55 dB.
+static std::vector<int16_t> synthStereo(uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> g(0.0f, 1.0f);
+  const int rate = 16000, seconds = 180;
+  std::vector<int16_t> pcm((size_t)rate * seconds * 2);
+  for (int i = 0; i < rate * seconds; i++) {
+    const double t = (double)i / rate;
+    const bool loud1 = t < 65.0;
+    const bool loud2 = t >= 90.0 && t < 155.0;
+    const float a1 = loud1 ? 3000.0f : 20.0f;
+    const float a2 = loud2 ? 3000.0f : 20.0f;
+    pcm[2 * i] = (int16_t)std::max(-32768.0f, std::min(32767.0f, a1 * g(rng)));
+    pcm[2 * i + 1] = (int16_t)std::max(-32768.0f, std::min(32767.0f, a2 * g(rng)));
+  }
+  return pcm;
+}
+
+static int selftest(const std::string &dir) {
+  const std::string path = dir + "/zone_selftest.wav";
+  if (!writeWav16(path, synthStereo(7), 2)) {
+    fprintf(stderr, "cannot write %s\n", path.c_str());
+    return 2;
+  }
+  std::vector<int32_t> pcm;
+  int channels = 0;
+  if (!readWav(path, pcm, channels) || channels != 2) {
+    fprintf(stderr, "cannot read back %s\n", path.c_str());
+    return 2;
+  }
+  Replay r;
+  r.run(pcm, channels);
+  r.print();
+
+  int fails = 0;
+  auto expect = [&](bool ok, const char *what) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) fails++;
+  };
+  int perZone[MAX_ZONES] = { 0, 0 };
+  bool inWindow = true;
+  for (const Warning &w : warnings) {
+    perZone[w.zone]++;
+    const uint32_t lo = w.zone == 0 ? 0 : 90000, hi = w.zone == 0 ? 65000 : 155000;
+    inWindow &= (w.ms >= lo && w.ms <= hi && w.level != WARN_MAJOR_REPEAT);
+  }
+  expect(perZone[0] == 3, "zone 1 escalates FIRST, SECOND, MAJOR during its own loud stretch");
+  expect(perZone[1] == 3, "zone 2 escalates FIRST, SECOND, MAJOR during its own loud stretch");
+  expect(inWindow, "no warning outside the zone's loud stretch");
+  expect(!r.zones[0].engine.violationActive && !r.zones[1].engine.violationActive, "both zones reset after silence");
+  expect(r.report[0].ledMs[RED] > 50000 && r.report[1].ledMs[RED] > 50000, "each zone spends its loud stretch RED");
+  expect(r.report[0].dbRecords > 0 && r.report[1].dbRecords > 0, "each zone has its own db series");
+
+  // The integer sum of squares must give the same level as the old double loop, block for block.
+  bool sameDb = true;
+  {
+    static int32_t split[MAX_ZONES][BUFFER_LEN];
+    int32_t *out[MAX_ZONES] = { split[0], split[1] };
+    for (size_t pos = 0; pos + BUFFER_LEN <= pcm.size() / 2; pos += FRAME_HOP) {
+      double sumSq[MAX_ZONES] = { 0, 0 };
+      int n = zoneSplit(&pcm[pos * 2], BUFFER_LEN * 2, 2, out, sumSq);
+      for (int z = 0; z < 2; z++) sameDb &= dspLevelDb(sumSq[z], n, NOISE_FLOOR, SENSITIVITY) == monoDb(split[z], n);
+    }
+  }
+  expect(sameDb, "per-zone levels match the old readMicDB() loop exactly");
+
+  PendingEvent e;
+  memset(&e, 0, sizeof(e));
+  pendingEventCopy(e.id, sizeof(e.id), "id");
+  pendingEventCopy(e.groupId, sizeof(e.groupId), "g");
+  pendingEventCopy(e.level, sizeof(e.level), "MAJOR");
+  char line[200];
+  PendingEvent back;
+  e.zone = 1;
+  pendingEventFormat(e, line, sizeof(line));
+  bool zoneKept = pendingEventParse(line, back) && back.zone == 1;
+  e.zone = 0;
+  pendingEventFormat(e, line, sizeof(line));
+  bool oldFormat = pendingEventParse(line, back) && back.zone == 0 && std::count(line, line + strlen(line), '|') == 8;
+  expect(zoneKept && oldFormat, "pending-event lines carry the zone, zone 1 keeps the 9-field line");
+  return fails ? 1 : 0;
+}
+
+// ---------- bench ----------
+
+template <typename Fn>
+static double nsPerBlock(int iters, Fn fn) {
+  const int rounds = 9;
+  const int per = iters / rounds;
+  double best = 1e30;
+  for (int r = 0; r < rounds; r++) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < per; i++) fn(i);
+    auto t1 = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::nano>(t1 - t0).count() / per);
+  }
+  return best;
+}
+
+static int bench(int iters) {
+  std::mt19937 rng(3);
+  std::normal_distribution<float> g(0.0f, 1.0f);
+  const int blocks = 64;
+  std::vector<int32_t> mono((size_t)blocks * BUFFER_LEN), stereo((size_t)blocks * BUFFER_LEN * 2);
+  for (auto &v : mono) v = (int32_t)(g(rng) * 3000.0f) * (1 << 14);
+  for (auto &v : stereo) v = (int32_t)(g(rng) * 3000.0f) * (1 << 14);
+
+  static int32_t split[MAX_ZONES][BUFFER_LEN];
+  int32_t *out[MAX_ZONES] = { split[0], split[1] };
+  ZoneState zones[MAX_ZONES];
+  volatile int sink = 0;
+  uint32_t now = 0;
+
+  auto zonePipeline = [&](ZoneState &zs, int raw) {
+    zs.rawDb = raw;
+    zs.smoothDb = zs.smoothDb + SMOOTH_ALPHA * (zs.rawDb - zs.smoothDb);
+    zs.engine.updateLed((int)zs.smoothDb);
+    zs.engine.handleWarnings((int)zs.smoothDb, now);
+    return (int)zs.smoothDb;
+  };
+
+  double oldNs = nsPerBlock(iters, [&](int i) {
+    sink = sink + zonePipeline(zones[0], monoDb(&mono[(size_t)(i % blocks) * BUFFER_LEN], BUFFER_LEN));
+    now += 50;
+  });
+  double oneNs = nsPerBlock(iters, [&](int i) {
+    double sumSq[MAX_ZONES] = { 0, 0 };
+    int32_t *block = &mono[(size_t)(i % blocks) * BUFFER_LEN];
+    int32_t *inPlace[MAX_ZONES] = { block, split[1] };   // as the firmware: one zone reads the block in place
+    int n = zoneSplit(block, BUFFER_LEN, 1, inPlace, sumSq);
+    sink = sink + zonePipeline(zones[0], dspLevelDb(sumSq[0], n, NOISE_FLOOR, SENSITIVITY));
+    now += 50;
+  });
+  double twoNs = nsPerBlock(iters, [&](int i) {
+    double sumSq[MAX_ZONES] = { 0, 0 };
+    int n = zoneSplit(&stereo[(size_t)(i % blocks) * BUFFER_LEN * 2], BUFFER_LEN * 2, 2, out, sumSq);
+    for (int z = 0; z < 2; z++) sink = sink + zonePipeline(zones[z], dspLevelDb(sumSq[z], n, NOISE_FLOOR, SENSITIVITY));
+    now += 50;
+  });
+  // Reference: deinterleave first, then run the mono loop once per zone.
+  double naiveNs = nsPerBlock(iters, [&](int i) {
+    const int32_t *in = &stereo[(size_t)(i % blocks) * BUFFER_LEN * 2];
+    for (int k = 0; k < BUFFER_LEN; k++) {
+      split[0][k] = in[2 * k];
+      split[1][k] = in[2 * k + 1];
+    }
+    for (int z = 0; z < 2; z++) sink = sink + zonePipeline(zones[z], monoDb(split[z], BUFFER_LEN));
+    now += 50;
+  });
+  (void)sink;
+
+  printf("blocks:                  %d x %d frames\n", iters, BUFFER_LEN);
+  printf("mono readMicDB (old):    %7.1f ns/block\n", oldNs);
+  printf("zoneSplit, 1 zone:       %7.1f ns/block\n", oneNs);
+  printf("zoneSplit, 2 zones:      %7.1f ns/block  (%.2fx the old mono path)\n", twoNs, twoNs / oldNs);
+  printf("split then 2 mono passes:%7.1f ns/block  (%.2fx)\n", naiveNs, naiveNs / oldNs);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 3 && !strcmp(argv[1], "run")) {
+    std::vector<int32_t> pcm;
+    int channels = 0;
+    if (!readWav(argv[2], pcm, channels)) {
+      fprintf(stderr, "%s: need 16 kHz PCM WAV, 16 or 32 bit, 1 or 2 channels\n", argv[2]);
+      return 2;
+    }
+    Replay r;
+    r.run(pcm, channels);
+    r.print();
+    return 0;
+  }
+  if (argc >= 2 && !strcmp(argv[1], "selftest")) return selftest(argc >= 3 ? argv[2] : "/tmp");
+  if (argc >= 2 && !strcmp(argv[1], "bench")) {
+    int iters = argc >= 3 ? atoi(argv[2]) : 2000000;
+    if (iters < 1000) iters = 1000;
+    return bench(iters);
+  }
+  fprintf(stderr, "usage: zone_bench run <stereo.wav> | selftest [dir] | bench [iterations]\n");
+  return 2;
+}
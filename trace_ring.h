@@ -0,0 +1,169 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Stall tracer: a fixed ring of begin/end span records that answers "what was the loop doing"
+// when a pass stalls.
+//
+// A record is 8 bytes: microsecond timestamp (32-bit, wraps every 71 min; a ring covers
+// seconds), interned name id, phase and task id. Writers claim a slot with one atomic add, so the
+// loop task and helper tasks can record at the same time without a lock. Names are pointers to
+// string literals, interned once per call site (intern() appends to the name table, so call it
+// from one task; other tasks use ids interned up front).
+//
+// freeze() stops recording and keeps the ring as it was when the stall was noticed; the first
+// freeze wins until rearm(). writeChrome() emits Chrome Trace Event JSON (chrome://tracing,
+// ui.perfetto.dev), ts 0 = oldest record. It drops end records whose begin was overwritten and
+// closes spans still open at the newest record, so every span it shows is balanced.
+// No Arduino dependencies; `tools/sched_sim.cpp trace` writes traces from the loop model.
+
+static const int TRACE_MAX_NAMES = 96;
+static const int TRACE_MAX_TASKS = 4;
+
+enum TracePhase : uint8_t {
+  TRACE_BEGIN = 'B',
+  TRACE_END = 'E',
+  TRACE_INSTANT = 'i',
+};
+
+struct TraceRecord {
+  uint32_t tsUs;
+  uint16_t name;
+  uint8_t phase;
+  uint8_t task;
+};
+
+template <int N>
+struct TraceRing {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+  TraceRecord rec[N];
+  uint32_t head = 0;          // records ever written; the ring holds the last N
+  uint8_t frozen = 0;
+  uint32_t dropped = 0;       // records refused while frozen
+  uint32_t freezes = 0;       // stalls noticed, including ones after the first
+  const char *freezeReason = "";
+  uint32_t freezeStallMs = 0;
+  uint32_t freezeTsUs = 0;
+
+  const char *names[TRACE_MAX_NAMES] = { "?" };
+  int nameCount = 1;          // id 0 is the overflow name
+  const char *taskNames[TRACE_MAX_TASKS] = { "loop", "task1", "task2", "other" };
+
+  uint32_t (*clockUs)() = nullptr;
+  uint8_t (*taskId)() = nullptr;   // 0 = loop task; nullptr = everything on 0
+
+  uint16_t intern(const char *name) {
+    for (int i = 1; i < nameCount; i++) {
+      if (names[i] == name) return (uint16_t)i;
+    }
+    for (int i = 1; i < nameCount; i++) {
+      if (!strcmp(names[i], name)) return (uint16_t)i;
+    }
+    if (nameCount >= TRACE_MAX_NAMES) return 0;
+    names[nameCount] = name;
+    return (uint16_t)nameCount++;
+  }
+
+  void begin(uint16_t name) { put(name, TRACE_BEGIN); }
+  void end(uint16_t name) { put(name, TRACE_END); }
+  void instant(uint16_t name) { put(name, TRACE_INSTANT); }
+
+  void put(uint16_t name, uint8_t phase) {
+    if (__atomic_load_n(&frozen, __ATOMIC_RELAXED)) {
+      __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+      return;
+    }
+    const uint32_t i = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    TraceRecord &r = rec[i & (N - 1)];
+    r.tsUs = clockUs ? clockUs() : 0;
+    r.name = name;
+    r.phase = phase;
+    r.task = taskId ? taskId() : 0;
+  }
+
+  // Marks the stall with an instant record and stops recording. reason must be a literal.
+  void freeze(const char *reason, uint32_t stallMs) {
+    freezes++;
+    if (frozen) return;
+    instant(intern(reason));
+    freezeReason = reason;
+    freezeStallMs = stallMs;
+    freezeTsUs = clockUs ? clockUs() : 0;
+    __atomic_store_n(&frozen, 1, __ATOMIC_RELEASE);
+  }
+
+  void rearm() {
+    head = 0;
+    dropped = 0;
+    __atomic_store_n(&frozen, 0, __ATOMIC_RELEASE);
+  }
+
+  uint32_t size() const { return head < (uint32_t)N ? head : (uint32_t)N; }
+
+  // Emits the ring as one JSON object, one event per emit() call. Call while frozen (or from
+  // the only task that records), so writers do not overwrite what is being read.
+  template <typename Emit>
+  void writeChrome(const char *deviceId, Emit emit) const {
+    char line[192];
+    const uint32_t n = size();
+    const uint32_t first = head - n;
+    const uint32_t t0 = n ? rec[first & (N - 1)].tsUs : 0;
+    snprintf(line, sizeof(line),
+             "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"device\":\"%s\",\"frozen\":%s,\"reason\":\"%s\","
+             "\"stall_ms\":%lu,\"records\":%lu,\"dropped\":%lu,\"t0_us\":%lu},\"traceEvents\":[\n",
+             deviceId, frozen ? "true" : "false", frozen ? freezeReason : "", (unsigned long)freezeStallMs,
+             (unsigned long)n, (unsigned long)dropped, (unsigned long)t0);
+    emit(line);
+    const char *sep = "";
+    for (int t = 0; t < TRACE_MAX_TASKS; t++) {
+      snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+               sep, t, taskNames[t]);
+      emit(line);
+      sep = ",\n";
+    }
+    int depth[TRACE_MAX_TASKS] = { 0 };
+    uint32_t lastTs = 0;
+    for (uint32_t i = first; i != head; i++) {
+      const TraceRecord &r = rec[i & (N - 1)];
+      const int task = r.task < TRACE_MAX_TASKS ? r.task : TRACE_MAX_TASKS - 1;
+      const uint32_t ts = r.tsUs - t0;
+      if (ts > lastTs) lastTs = ts;
+      const char *name = r.name < nameCount ? names[r.name] : "?";
+      if (r.phase == TRACE_BEGIN) {
+        depth[task]++;
+      } else if (r.phase == TRACE_END) {
+        if (depth[task] == 0) continue;   // its begin was overwritten
+        depth[task]--;
+      } else if (r.phase != TRACE_INSTANT) {
+        continue;
+      }
+      if (r.phase == TRACE_INSTANT) {
+        snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%lu,\"pid\":1,\"tid\":%d}", name,
+                 (unsigned long)ts, task);
+      } else {
+        snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu,\"pid\":1,\"tid\":%d}", name, (char)r.phase,
+                 (unsigned long)ts, task);
+      }
+      emit(line);
+    }
+    for (int t = 0; t < TRACE_MAX_TASKS; t++) {
+      for (; depth[t] > 0; depth[t]--) {
+        snprintf(line, sizeof(line), ",\n{\"ph\":\"E\",\"ts\":%lu,\"pid\":1,\"tid\":%d}", (unsigned long)lastTs, t);
+        emit(line);
+      }
+    }
+    emit("\n]}\n");
+  }
+};
+
+// Records one span for the lifetime of the object.
+template <typename Ring>
+struct TraceScope {
+  Ring &ring;
+  uint16_t name;
+  TraceScope(Ring &r, uint16_t n) : ring(r), name(n) { ring.begin(name); }
+  ~TraceScope() { ring.end(name); }
+};
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Event-driven Wi-Fi (re)connect with a cached access point and DHCP lease.
+//
+// The last good BSSID, channel and lease (IP, gateway, netmask, DNS and when it was obtained)
+// are kept in a WifiApCache the firmware persists in NVS. A connect first tries a targeted
+// association: that BSSID on that channel, no scan. When the lease is younger than leaseMaxAgeS
+// (and the clock is known), its address is applied as a static IP so there is no DHCP exchange
+// either; dhcpHandbackMs after such a connect the firmware switches back to DHCP so the lease is
+// renewed the normal way. A targeted attempt that fails (AP gone from that channel, timeout)
+// falls through to a full scan-and-associate at once; a scan that fails backs off exponentially
+// (backoffMinMs..backoffMaxMs, authBackoffMs after a wrong password) and the next round starts
+// targeted again.
+//
+// The driver's events (onWiFiEvent runs in the Wi-Fi event task) go through WifiEventQueue, a
+// single-producer single-consumer ring; the loop drains it into onEvent(), calls poll() for
+// timeouts and carries out the returned WifiRcAction. Association loss while up starts a
+// targeted attempt immediately: no cooldown. Reconnect time runs from losing the link (or from
+// start()) to having an IP.
+// No Arduino dependencies; tools/wifi_sim.cpp runs it against a simulated driver and AP.
+
+// ESP-IDF wifi_err_reason_t values the machine tells apart.
+static const uint8_t WIFI_RC_REASON_ASSOC_LEAVE = 8;           // our own disconnect()
+static const uint8_t WIFI_RC_REASON_4WAY_TIMEOUT = 15;         // usually a wrong password
+static const uint8_t WIFI_RC_REASON_NO_AP_FOUND = 201;
+static const uint8_t WIFI_RC_REASON_AUTH_FAIL = 202;
+static const uint8_t WIFI_RC_REASON_HANDSHAKE_TIMEOUT = 204;
+
+static const uint8_t WIFI_AP_CACHE_VERSION = 1;
+
+// Persisted as raw bytes (NVS blob); addresses as IPAddress's uint32_t.
+struct WifiApCache {
+  uint8_t version;
+  uint8_t channel;
+  uint8_t bssid[6];
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t netmask;
+  uint32_t dns;
+  uint32_t leaseEpochS;   // when DHCP handed out ip; 0 = clock was not set
+};
+
+enum WifiRcState : uint8_t {
+  WIFI_RC_IDLE = 0,       // no credentials, or stopped
+  WIFI_RC_FAST,           // targeted association to the cached AP
+  WIFI_RC_SCAN,           // full scan-and-associate
+  WIFI_RC_UP,             // associated with an IP
+  WIFI_RC_BACKOFF,        // waiting to retry
+};
+
+enum WifiRcAction : uint8_t {
+  WIFI_ACT_NONE = 0,
+  WIFI_ACT_CONNECT_FAST,  // begin(ssid, pass, cache.channel, cache.bssid); static lease if leaseInUse
+  WIFI_ACT_CONNECT_SCAN,  // DHCP, begin(ssid, pass)
+  WIFI_ACT_STOP,          // end the failed attempt
+  WIFI_ACT_DHCP,          // hand the static lease back to DHCP
+};
+
+enum WifiRcEvent : uint8_t {
+  WIFI_EV_ASSOC = 0,
+  WIFI_EV_GOT_IP,
+  WIFI_EV_LOST_IP,
+  WIFI_EV_DISCONNECTED,
+};
+
+struct WifiEventMsg {
+  uint8_t ev;
+  uint8_t reason;
+};
+
+// One producer (the Wi-Fi event task), one consumer (the loop).
+template <int N>
+struct WifiEventQueue {
+  WifiEventMsg q[N];
+  uint32_t head = 0;
+  uint32_t tail = 0;
+  uint32_t dropped = 0;
+
+  bool push(uint8_t ev, uint8_t reason) {
+    const uint32_t h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    if (h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) >= (uint32_t)N) {
+      dropped++;
+      return false;
+    }
+    q[h % N] = { ev, reason };
+    __atomic_store_n(&head, h + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  bool pop(WifiEventMsg &m) {
+    const uint32_t t = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+    if (t == __atomic_load_n(&head, __ATOMIC_ACQUIRE)) return false;
+    m = q[t % N];
+    __atomic_store_n(&tail, t + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+};
+
+struct WifiReconnect {
+  uint32_t fastTimeoutMs = 5000;     // targeted association plus DHCP when the lease is not reused
+  uint32_t scanTimeoutMs = 20000;
+  uint32_t backoffMinMs = 1000;
+  uint32_t backoffMaxMs = 15000;
+  uint32_t authBackoffMs = 60000;    // wrong password: do not hammer the AP
+  uint32_t leaseMaxAgeS = 1800;      // well inside any sane DHCP lease time
+  uint32_t dhcpHandbackMs = 30000;
+
+  WifiRcState state = WIFI_RC_IDLE;
+  WifiApCache cache = {};
+  bool cacheDirty = false;           // firmware saves the cache and clears this
+  bool leaseInUse = false;           // the current attempt/link runs on the cached lease
+  bool ipUp = false;
+  uint8_t lastReason = 0;
+
+  uint32_t attemptStartMs = 0;
+  uint32_t retryAtMs = 0;
+  uint32_t backoffMs = 0;
+  uint32_t downSinceMs = 0;
+  uint32_t upSinceMs = 0;
+  bool handbackPending = false;
+  bool lastFailAuth = false;
+
+  // Stats
+  uint32_t attempts = 0;
+  uint32_t fastOk = 0;
+  uint32_t scanOk = 0;
+  uint32_t fastFail = 0;
+  uint32_t scanFail = 0;
+  uint32_t drops = 0;                // link lost while up
+  uint32_t leaseReuses = 0;
+  uint32_t reconnects = 0;           // completed connects, each with a reconnect time
+  uint32_t lastReconnectMs = 0;
+  uint32_t maxReconnectMs = 0;
+  uint64_t sumReconnectMs = 0;
+
+  bool cacheValid() const { return cache.version == WIFI_AP_CACHE_VERSION && cache.channel >= 1 && cache.channel <= 14; }
+
+  bool leaseUsable(uint32_t epochS) const {
+    return cacheValid() && cache.ip != 0 && cache.leaseEpochS != 0 && epochS >= cache.leaseEpochS &&
+           epochS - cache.leaseEpochS <= leaseMaxAgeS;
+  }
+
+  // epochS is 0 while the clock is unknown (then no lease is reused).
+  WifiRcAction start(uint32_t now, uint32_t epochS) {
+    downSinceMs = now;
+    backoffMs = 0;
+    lastFailAuth = false;
+    return attempt(now, epochS, true);
+  }
+
+  WifiRcAction stop() {
+    state = WIFI_RC_IDLE;
+    ipUp = false;
+    handbackPending = false;
+    return WIFI_ACT_STOP;
+  }
+
+  // New credentials: the cached AP and lease belong to the old network.
+  void forget() {
+    cache = {};
+    cacheDirty = true;
+  }
+
+  WifiRcAction onEvent(uint8_t ev, uint8_t reason, uint32_t now, uint32_t epochS) {
+    switch (ev) {
+      case WIFI_EV_GOT_IP:
+        ipUp = true;
+        if (state == WIFI_RC_FAST || state == WIFI_RC_SCAN) {
+          if (state == WIFI_RC_FAST) fastOk++;
+          else scanOk++;
+          state = WIFI_RC_UP;
+          upSinceMs = now;
+          backoffMs = 0;
+          lastFailAuth = false;
+          handbackPending = leaseInUse;
+          const uint32_t took = now - downSinceMs;
+          lastReconnectMs = took;
+          if (took > maxReconnectMs) maxReconnectMs = took;
+          sumReconnectMs += took;
+          reconnects++;
+        }
+        return WIFI_ACT_NONE;
+      case WIFI_EV_LOST_IP:
+        ipUp = false;   // DHCP handback or an expired lease; the association is what counts
+        return WIFI_ACT_NONE;
+      case WIFI_EV_DISCONNECTED:
+        lastReason = reason;
+        ipUp = false;
+        if (state == WIFI_RC_UP) {
+          drops++;
+          downSinceMs = now;
+          handbackPending = false;
+          return attempt(now, epochS, true);
+        }
+        if (reason == WIFI_RC_REASON_ASSOC_LEAVE) return WIFI_ACT_NONE;   // our own disconnect()
+        if (state == WIFI_RC_FAST) {
+          fastFail++;
+          return attempt(now, epochS, false);
+        }
+        if (state == WIFI_RC_SCAN) return fail(now, reason);
+        return WIFI_ACT_NONE;
+      default:
+        return WIFI_ACT_NONE;
+    }
+  }
+
+  WifiRcAction poll(uint32_t now, uint32_t epochS) {
+    switch (state) {
+      case WIFI_RC_FAST:
+        if (now - attemptStartMs < fastTimeoutMs) return WIFI_ACT_NONE;
+        fastFail++;
+        return attempt(now, epochS, false);
+      case WIFI_RC_SCAN:
+        if (now - attemptStartMs < scanTimeoutMs) return WIFI_ACT_NONE;
+        return fail(now, 0);
+      case WIFI_RC_BACKOFF:
+        if ((int32_t)(now - retryAtMs) < 0) return WIFI_ACT_NONE;
+        return attempt(now, epochS, !lastFailAuth);
+      case WIFI_RC_UP:
+        if (!handbackPending || now - upSinceMs < dhcpHandbackMs) return WIFI_ACT_NONE;
+        handbackPending = false;
+        leaseInUse = false;
+        return WIFI_ACT_DHCP;
+      default:
+        return WIFI_ACT_NONE;
+    }
+  }
+
+  // With the link up, what the driver reports. leaseFromDhcp: ip came from DHCP just now (not the
+  // reused static lease), so its age restarts. Marks the cache dirty only when something changed.
+  void noteLink(const uint8_t *bssid, uint8_t channel, uint32_t ip, uint32_t gateway, uint32_t netmask, uint32_t dns,
+                bool leaseFromDhcp, uint32_t epochS) {
+    WifiApCache c = cache;
+    c.version = WIFI_AP_CACHE_VERSION;
+    c.channel = channel;
+    memcpy(c.bssid, bssid, 6);
+    c.ip = ip;
+    c.gateway = gateway;
+    c.netmask = netmask;
+    c.dns = dns;
+    if (leaseFromDhcp) c.leaseEpochS = epochS;
+    if (memcmp(&c, &cache, sizeof(c)) != 0) {
+      cache = c;
+      cacheDirty = true;
+    }
+  }
+
+  uint32_t avgReconnectMs() const { return reconnects ? (uint32_t)(sumReconnectMs / reconnects) : 0; }
+
+ private:
+  WifiRcAction attempt(uint32_t now, uint32_t epochS, bool targeted) {
+    attempts++;
+    attemptStartMs = now;
+    ipUp = false;
+    if (targeted && cacheValid()) {
+      state = WIFI_RC_FAST;
+      leaseInUse = leaseUsable(epochS);
+      if (leaseInUse) leaseReuses++;
+      return WIFI_ACT_CONNECT_FAST;
+    }
+    state = WIFI_RC_SCAN;
+    leaseInUse = false;
+    return WIFI_ACT_CONNECT_SCAN;
+  }
+
+  WifiRcAction fail(uint32_t now, uint8_t reason) {
+    scanFail++;
+    lastFailAuth = reason == WIFI_RC_REASON_AUTH_FAIL || reason == WIFI_RC_REASON_4WAY_TIMEOUT ||
+                   reason == WIFI_RC_REASON_HANDSHAKE_TIMEOUT;
+    backoffMs = backoffMs ? backoffMs * 2 : backoffMinMs;
+    if (backoffMs > backoffMaxMs) backoffMs = backoffMaxMs;
+    retryAtMs = now + (lastFailAuth && authBackoffMs > backoffMs ? authBackoffMs : backoffMs);
+    state = WIFI_RC_BACKOFF;
+    return WIFI_ACT_STOP;
+  }
+};
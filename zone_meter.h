@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "noise_engine.h"
+
+// Per-zone level metering for stereo capture.
+//
+// Two INMP441s share one I2S bus; the L/R select pin puts each on its own slot, and the driver
+// hands back interleaved frames (zone 1 = L/R low = left, zone 2 = L/R high = right). zoneSplit()
+// walks a DMA block once, copying each channel into its own buffer (for the classifier and the
+// recorder) and accumulating each zone's sum of squares, so a second zone costs one extra
+// multiply-add and store per frame rather than a second pass. The sums go to dspLevelDb()
+// (dsp_pipeline.h) for the level.
+//
+// The INMP441 sends 24-bit samples left-aligned in 32-bit words, so the low byte is zero and
+// (v >> 8)^2 summed in 64-bit integers is exact (2^46 per sample, 2^55 per block). That replaces
+// the double multiply-add, which the ESP32 does in software (it has no double-precision FPU).
+//
+// Each zone carries its own smoothing, LED decision, escalation engine and db-series change
+// detector. One zone is the same single-mic pipeline as before.
+// No Arduino dependencies; tools/zone_bench.cpp runs the same code on stereo WAV files.
+
+static const int MAX_ZONES = 2;
+
+struct ZoneState {
+  uint8_t id = 0;
+  int rawDb = 0;
+  double smoothDb = 0;
+  int lastDbLogged10 = -999999;
+  uint32_t lastDbRecordMs = 0;
+  NoiseEngine engine;
+};
+
+// Deinterleaves `samples` words of an I2S block into out[z] and adds each zone's sum of squares
+// to sumSq[z]. Returns the frames per zone. With one zone, out[0] may be `in` itself (no copy).
+static inline int zoneSplit(const int32_t *in, int samples, int zones, int32_t *const *out, double *sumSq) {
+  if (zones <= 1) {
+    int64_t s0 = 0;
+    for (int i = 0; i < samples; i++) {
+      const int32_t v = in[i] >> 8;
+      s0 += (int64_t)v * v;
+    }
+    if (out[0] != in) memcpy(out[0], in, sizeof(int32_t) * (size_t)samples);
+    sumSq[0] += (double)s0 * 65536.0;
+    return samples;
+  }
+  const int frames = samples / 2;
+  int32_t *o0 = out[0];
+  int32_t *o1 = out[1];
+  int64_t s0 = 0, s1 = 0;
+  for (int i = 0; i < frames; i++) {
+    const int32_t l = in[2 * i];
+    const int32_t r = in[2 * i + 1];
+    o0[i] = l;
+    o1[i] = r;
+    s0 += (int64_t)(l >> 8) * (l >> 8);
+    s1 += (int64_t)(r >> 8) * (r >> 8);
+  }
+  sumSq[0] += (double)s0 * 65536.0;
+  sumSq[1] += (double)s1 * 65536.0;
+  return frames;
+}
+
+// The LED shows the loudest zone.
+static inline LedState zoneWorstLed(const ZoneState *z, int zones) {
+  LedState s = GREEN;
+  for (int i = 0; i < zones; i++) {
+    if (z[i].engine.led == RED) return RED;
+    if (z[i].engine.led == YELLOW) s = YELLOW;
+  }
+  return s;
+}